@@ -1,6 +1,7 @@
 #ifndef SORBET_TREES_H
 #define SORBET_TREES_H
 
+#include "common/SmallObjectPool.h"
 #include "common/common.h"
 #include "core/Context.h"
 #include "core/LocalVariable.h"
@@ -28,10 +29,52 @@
 
 namespace sorbet::ast {
 
+// One for each kind of node, so that they can be told apart with a switch rather than a chain of casts, see
+// `cast_tree` and `TreeMap`.
+enum class Tag : u1 {
+    ClassDef,
+    MethodDef,
+    If,
+    While,
+    Break,
+    Retry,
+    Next,
+    Return,
+    RescueCase,
+    Rescue,
+    Field,
+    Local,
+    UnresolvedIdent,
+    RestArg,
+    KeywordArg,
+    OptionalArg,
+    BlockArg,
+    ShadowArg,
+    Assign,
+    Send,
+    Cast,
+    Hash,
+    Array,
+    Literal,
+    UnresolvedConstantLit,
+    ConstantLit,
+    ZSuperArgs,
+    Block,
+    InsSeq,
+    EmptyTree,
+};
+
 class Expression {
 public:
-    Expression(core::Loc loc);
+    Expression(Tag tag, core::Loc loc);
     virtual ~Expression() = default;
+    // Trees are millions of small nodes, which are cheaper to get from a pool than from malloc one at a time.
+    static void *operator new(size_t size) {
+        return SmallObjectPool::allocate(size);
+    }
+    static void operator delete(void *ptr, size_t size) {
+        SmallObjectPool::deallocate(ptr, size);
+    }
     virtual std::string toStringWithTabs(const core::GlobalState &gs, int tabs = 0) const = 0;
     std::string toString(const core::GlobalState &gs) const {
         return toStringWithTabs(gs);
@@ -41,6 +84,7 @@ public:
     std::unique_ptr<Expression> deepCopy() const;
     virtual void _sanityCheck() = 0;
     const core::Loc loc;
+    const Tag tag;
 
     class DeepCopyError {};
 
@@ -59,7 +103,14 @@ struct ParsedFile {
 template <class To> To *cast_tree(Expression *what) {
     static_assert(!std::is_pointer<To>::value, "To has to be a pointer");
     static_assert(std::is_assignable<Expression *&, To *>::value, "Ill Formed To, has to be a subclass of Expression");
-    return fast_cast<Expression, To>(what);
+    if constexpr (std::is_final<To>::value) {
+        if (what == nullptr || what->tag != To::TAG) {
+            return nullptr;
+        }
+        return static_cast<To *>(what);
+    } else {
+        return fast_cast<Expression, To>(what);
+    }
 }
 
 // A variant of cast_tree that preserves the const-ness (if const in, then const out)
@@ -75,7 +126,7 @@ template <class To> bool isa_tree(Expression *what) {
 
 class Reference : public Expression {
 public:
-    Reference(core::Loc loc);
+    Reference(Tag tag, core::Loc loc);
 };
 // CheckSize(Reference, 16, 8);
 
@@ -84,7 +135,7 @@ public:
     core::Loc declLoc;
     core::SymbolRef symbol;
 
-    Declaration(core::Loc loc, core::Loc declLoc, core::SymbolRef symbol);
+    Declaration(Tag tag, core::Loc loc, core::Loc declLoc, core::SymbolRef symbol);
 };
 // CheckSize(Declaration, 24, 8);
 
@@ -92,6 +143,8 @@ enum ClassDefKind : u1 { Module, Class };
 
 class ClassDef final : public Declaration {
 public:
+    static constexpr Tag TAG = Tag::ClassDef;
+
     ClassDefKind kind;
     static constexpr int EXPECTED_RHS_COUNT = 4;
     typedef InlinedVector<std::unique_ptr<Expression>, EXPECTED_RHS_COUNT> RHS_store;
@@ -121,6 +174,8 @@ private:
 
 class MethodDef final : public Declaration {
 public:
+    static constexpr Tag TAG = Tag::MethodDef;
+
     std::unique_ptr<Expression> rhs;
 
     static constexpr int EXPECTED_ARGS_COUNT = 2;
@@ -157,6 +212,8 @@ private:
 
 class If final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::If;
+
     std::unique_ptr<Expression> cond;
     std::unique_ptr<Expression> thenp;
     std::unique_ptr<Expression> elsep;
@@ -175,6 +232,8 @@ private:
 
 class While final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::While;
+
     std::unique_ptr<Expression> cond;
     std::unique_ptr<Expression> body;
 
@@ -191,6 +250,8 @@ private:
 
 class Break final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::Break;
+
     std::unique_ptr<Expression> expr;
 
     Break(core::Loc loc, std::unique_ptr<Expression> expr);
@@ -206,6 +267,8 @@ private:
 
 class Retry final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::Retry;
+
     Retry(core::Loc loc);
     virtual std::string toStringWithTabs(const core::GlobalState &gs, int tabs = 0) const;
     virtual std::string showRaw(const core::GlobalState &gs, int tabs = 0);
@@ -219,6 +282,8 @@ private:
 
 class Next final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::Next;
+
     std::unique_ptr<Expression> expr;
 
     Next(core::Loc loc, std::unique_ptr<Expression> expr);
@@ -234,6 +299,8 @@ private:
 
 class Return final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::Return;
+
     std::unique_ptr<Expression> expr;
 
     Return(core::Loc loc, std::unique_ptr<Expression> expr);
@@ -249,6 +316,8 @@ private:
 
 class RescueCase final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::RescueCase;
+
     static constexpr int EXPECTED_EXCEPTION_COUNT = 2;
     typedef InlinedVector<std::unique_ptr<Expression>, EXPECTED_EXCEPTION_COUNT> EXCEPTION_store;
 
@@ -273,6 +342,8 @@ private:
 
 class Rescue final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::Rescue;
+
     static constexpr int EXPECTED_RESCUE_CASE_COUNT = 2;
     typedef InlinedVector<std::unique_ptr<RescueCase>, EXPECTED_RESCUE_CASE_COUNT> RESCUE_CASE_store;
 
@@ -295,6 +366,8 @@ private:
 
 class Field final : public Reference {
 public:
+    static constexpr Tag TAG = Tag::Field;
+
     core::SymbolRef symbol;
 
     Field(core::Loc loc, core::SymbolRef symbol);
@@ -310,6 +383,8 @@ private:
 
 class Local final : public Reference {
 public:
+    static constexpr Tag TAG = Tag::Local;
+
     core::LocalVariable localVariable;
 
     Local(core::Loc loc, core::LocalVariable localVariable1);
@@ -325,6 +400,8 @@ private:
 
 class UnresolvedIdent final : public Reference {
 public:
+    static constexpr Tag TAG = Tag::UnresolvedIdent;
+
     enum VarKind {
         Local,
         Instance,
@@ -347,6 +424,8 @@ private:
 
 class RestArg final : public Reference {
 public:
+    static constexpr Tag TAG = Tag::RestArg;
+
     std::unique_ptr<Reference> expr;
 
     RestArg(core::Loc loc, std::unique_ptr<Reference> arg);
@@ -362,6 +441,8 @@ private:
 
 class KeywordArg final : public Reference {
 public:
+    static constexpr Tag TAG = Tag::KeywordArg;
+
     std::unique_ptr<Reference> expr;
 
     KeywordArg(core::Loc loc, std::unique_ptr<Reference> expr);
@@ -377,6 +458,8 @@ private:
 
 class OptionalArg final : public Reference {
 public:
+    static constexpr Tag TAG = Tag::OptionalArg;
+
     std::unique_ptr<Reference> expr;
     std::unique_ptr<Expression> default_;
 
@@ -393,6 +476,8 @@ private:
 
 class BlockArg final : public Reference {
 public:
+    static constexpr Tag TAG = Tag::BlockArg;
+
     std::unique_ptr<Reference> expr;
 
     BlockArg(core::Loc loc, std::unique_ptr<Reference> expr);
@@ -408,6 +493,8 @@ private:
 
 class ShadowArg final : public Reference {
 public:
+    static constexpr Tag TAG = Tag::ShadowArg;
+
     std::unique_ptr<Reference> expr;
 
     ShadowArg(core::Loc loc, std::unique_ptr<Reference> expr);
@@ -423,6 +510,8 @@ private:
 
 class Assign final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::Assign;
+
     std::unique_ptr<Expression> lhs;
     std::unique_ptr<Expression> rhs;
 
@@ -441,6 +530,8 @@ class Block;
 
 class Send final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::Send;
+
     core::NameRef fun;
 
     static const int PRIVATE_OK = 1 << 0;
@@ -472,6 +563,8 @@ private:
 
 class Cast final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::Cast;
+
     // The name of the cast operator.
     core::NameRef cast;
 
@@ -491,6 +584,8 @@ private:
 
 class Hash final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::Hash;
+
     static constexpr int EXPECTED_ENTRY_COUNT = 2;
     typedef InlinedVector<std::unique_ptr<Expression>, EXPECTED_ENTRY_COUNT> ENTRY_store;
 
@@ -511,6 +606,8 @@ private:
 
 class Array final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::Array;
+
     static constexpr int EXPECTED_ENTRY_COUNT = 4;
     typedef InlinedVector<std::unique_ptr<Expression>, EXPECTED_ENTRY_COUNT> ENTRY_store;
 
@@ -530,6 +627,8 @@ private:
 
 class Literal final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::Literal;
+
     core::TypePtr value;
 
     Literal(core::Loc loc, const core::TypePtr &value);
@@ -552,6 +651,8 @@ private:
 
 class UnresolvedConstantLit final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::UnresolvedConstantLit;
+
     core::NameRef cnst;
     std::unique_ptr<Expression> scope;
 
@@ -568,6 +669,8 @@ private:
 
 class ConstantLit final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::ConstantLit;
+
     core::SymbolRef symbol; // If this is a normal constant. This symbol may be already dealiased.
     core::SymbolRef
         resolutionScope; // for constats that failed resolution, symbol will be set to StubModule and resolutionScope
@@ -589,6 +692,8 @@ private:
 
 class ZSuperArgs final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::ZSuperArgs;
+
     // null if no block passed
     ZSuperArgs(core::Loc loc);
     virtual std::string toStringWithTabs(const core::GlobalState &gs, int tabs = 0) const;
@@ -603,6 +708,8 @@ private:
 
 class Block final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::Block;
+
     MethodDef::ARGS_store args;
     std::unique_ptr<Expression> body;
 
@@ -617,6 +724,8 @@ public:
 
 class InsSeq final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::InsSeq;
+
     static constexpr int EXPECTED_STATS_COUNT = 4;
     typedef InlinedVector<std::unique_ptr<Expression>, EXPECTED_STATS_COUNT> STATS_store;
     // Statements
@@ -638,6 +747,8 @@ private:
 
 class EmptyTree final : public Expression {
 public:
+    static constexpr Tag TAG = Tag::EmptyTree;
+
     EmptyTree();
     virtual std::string toStringWithTabs(const core::GlobalState &gs, int tabs = 0) const;
     virtual std::string showRaw(const core::GlobalState &gs, int tabs = 0);
@@ -677,4 +788,13 @@ private:
 
 } // namespace sorbet::ast
 
+namespace sorbet {
+template <typename Base, typename To>
+struct TypecaseCast<Base, To, std::enable_if_t<std::is_base_of<ast::Expression, Base>::value>> {
+    static To *cast(Base *base) {
+        return ast::cast_tree<To>(base);
+    }
+};
+} // namespace sorbet
+
 #endif // SORBET_TREES_H
@@ -0,0 +1,89 @@
+#ifndef SORBET_TREEMAP_PARALLEL_H
+#define SORBET_TREEMAP_PARALLEL_H
+
+#include "ast/treemap/treemap.h"
+#include "common/Counters.h"
+#include "common/concurrency/ConcurrentQueue.h"
+#include "common/concurrency/WorkerPool.h"
+#include "core/ErrorQueue.h"
+
+namespace sorbet::ast {
+
+/**
+ * Walks each of `trees` with `TreeMap::apply` in parallel on `workers`, for passes that only read global state, and
+ * returns them in the order they were given in.
+ *
+ * Each thread walks with its own walker, made by `makeWalker()`. Once every tree has been walked, `finish(walker)` is
+ * called on the calling thread for each of them (in no particular order), to merge whatever they collected. The errors
+ * the walks report are reported in the order of `trees`, as if they had been walked one after another on the calling
+ * thread, and the threads' counters are merged into the calling thread's.
+ */
+template <class MakeWalker, class Finish>
+std::vector<ParsedFile> parallelTreeMap(core::Context ctx, WorkerPool &workers, std::vector<ParsedFile> trees,
+                                        ConstExprStr jobName, MakeWalker makeWalker, Finish finish) {
+    using Walker = decltype(makeWalker());
+    struct Walked {
+        int index;
+        ParsedFile tree;
+        std::vector<core::ErrorQueueMessage> errors;
+    };
+    struct ThreadResult {
+        std::unique_ptr<Walker> walker;
+        std::vector<Walked> walked;
+        CounterState counters;
+    };
+
+    auto fileq = std::make_shared<ConcurrentBoundedQueue<std::pair<int, ParsedFile>>>(trees.size());
+    auto resultq = std::make_shared<BlockingBoundedQueue<ThreadResult>>(trees.size());
+    for (int i = 0; i < trees.size(); i++) {
+        fileq->push(std::make_pair(i, std::move(trees[i])), 1);
+    }
+
+    workers.multiplexJob(jobName, [ctx, fileq, resultq, &makeWalker]() {
+        ThreadResult threadResult;
+        std::pair<int, ParsedFile> job;
+        for (auto result = fileq->try_pop(job); !result.done(); result = fileq->try_pop(job)) {
+            if (result.gotItem()) {
+                if (threadResult.walker == nullptr) {
+                    threadResult.walker = std::make_unique<Walker>(makeWalker());
+                }
+                Walked walked{job.first, std::move(job.second), {}};
+                {
+                    core::ErrorQueue::CaptureErrors capture(*ctx.state.errorQueue, walked.errors);
+                    walked.tree.tree = TreeMap::apply(ctx, *threadResult.walker, std::move(walked.tree.tree));
+                }
+                threadResult.walked.emplace_back(std::move(walked));
+            }
+        }
+        if (!threadResult.walked.empty()) {
+            threadResult.counters = getAndClearThreadCounters();
+            auto walkedCount = threadResult.walked.size();
+            resultq->push(std::move(threadResult), walkedCount);
+        }
+    });
+
+    std::vector<std::vector<core::ErrorQueueMessage>> errors(trees.size());
+    {
+        ThreadResult threadResult;
+        for (auto result = resultq->wait_pop_timed(threadResult, WorkerPool::BLOCK_INTERVAL(), ctx.state.tracer());
+             !result.done();
+             result = resultq->wait_pop_timed(threadResult, WorkerPool::BLOCK_INTERVAL(), ctx.state.tracer())) {
+            if (result.gotItem()) {
+                counterConsume(std::move(threadResult.counters));
+                for (auto &walked : threadResult.walked) {
+                    trees[walked.index] = std::move(walked.tree);
+                    errors[walked.index] = std::move(walked.errors);
+                }
+                finish(*threadResult.walker);
+            }
+        }
+    }
+    for (auto &fileErrors : errors) {
+        ctx.state.errorQueue->pushCapturedErrors(std::move(fileErrors));
+    }
+    return trees;
+}
+
+} // namespace sorbet::ast
+
+#endif
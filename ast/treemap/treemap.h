@@ -631,6 +631,12 @@ private:
         return v;
     }
 
+    // Only valid once `what->tag` has been checked to be `T::TAG`.
+    template <class T> static unique_ptr<T> downcast(unique_ptr<Expression> what) {
+        ENFORCE(what->tag == T::TAG);
+        return unique_ptr<T>(static_cast<T *>(what.release()));
+    }
+
     unique_ptr<Expression> mapIt(unique_ptr<Expression> what, CTX ctx) {
         if (what == nullptr) {
             return what;
@@ -638,62 +644,59 @@ private:
         auto loc = what->loc;
 
         try {
-            // TODO: reorder by frequency
             if constexpr (HAS_MEMBER_preTransformExpression<FUNC>::value) {
                 what = PostPonePreTransform_Expression<FUNC, CTX, HAS_MEMBER_preTransformExpression<FUNC>::value>::call(
                     ctx, move(what), func);
             }
 
-            if (isa_tree<EmptyTree>(what.get()) || isa_tree<ZSuperArgs>(what.get())) {
-                return what;
-            }
-
-            if (isa_tree<UnresolvedConstantLit>(what.get())) {
-                return mapUnresolvedConstantLit(
-                    std::unique_ptr<UnresolvedConstantLit>(static_cast<UnresolvedConstantLit *>(what.release())), ctx);
-            } else if (isa_tree<ConstantLit>(what.get())) {
-                return mapConstantLit(std::unique_ptr<ConstantLit>(static_cast<ConstantLit *>(what.release())), ctx);
-            } else if (isa_tree<Send>(what.get())) {
-                return mapSend(std::unique_ptr<Send>(static_cast<Send *>(what.release())), ctx);
-            } else if (isa_tree<Literal>(what.get())) {
-                return mapLiteral(std::unique_ptr<Literal>(static_cast<Literal *>(what.release())), ctx);
-            } else if (UnresolvedIdent *u = cast_tree<UnresolvedIdent>(what.get())) {
-                return mapUnresolvedIdent(
-                    std::unique_ptr<UnresolvedIdent>(static_cast<UnresolvedIdent *>(what.release())), ctx);
-            } else if (isa_tree<Local>(what.get())) {
-                return mapLocal(std::unique_ptr<Local>(static_cast<Local *>(what.release())), ctx);
-            } else if (isa_tree<MethodDef>(what.get())) {
-                return mapMethodDef(std::unique_ptr<MethodDef>(static_cast<MethodDef *>(what.release())), ctx);
-            } else if (isa_tree<InsSeq>(what.get())) {
-                return mapInsSeq(std::unique_ptr<InsSeq>(static_cast<InsSeq *>(what.release())), ctx);
-            } else if (isa_tree<Hash>(what.get())) {
-                return mapHash(std::unique_ptr<Hash>(static_cast<Hash *>(what.release())), ctx);
-            } else if (isa_tree<ClassDef>(what.get())) {
-                return mapClassDef(std::unique_ptr<ClassDef>(static_cast<ClassDef *>(what.release())), ctx);
-            } else if (isa_tree<If>(what.get())) {
-                return mapIf(std::unique_ptr<If>(static_cast<If *>(what.release())), ctx);
-            } else if (isa_tree<While>(what.get())) {
-                return mapWhile(std::unique_ptr<While>(static_cast<While *>(what.release())), ctx);
-            } else if (isa_tree<Break>(what.get())) {
-                return mapBreak(std::unique_ptr<Break>(static_cast<Break *>(what.release())), ctx);
-            } else if (isa_tree<Retry>(what.get())) {
-                return mapRetry(std::unique_ptr<Retry>(static_cast<Retry *>(what.release())), ctx);
-            } else if (isa_tree<Next>(what.get())) {
-                return mapNext(std::unique_ptr<Next>(static_cast<Next *>(what.release())), ctx);
-            } else if (isa_tree<Return>(what.get())) {
-                return mapReturn(std::unique_ptr<Return>(static_cast<Return *>(what.release())), ctx);
-            } else if (isa_tree<Rescue>(what.get())) {
-                return mapRescue(std::unique_ptr<Rescue>(static_cast<Rescue *>(what.release())), ctx);
-            } else if (isa_tree<Field>(what.get())) {
-                return mapField(std::unique_ptr<Field>(static_cast<Field *>(what.release())), ctx);
-            } else if (isa_tree<Assign>(what.get())) {
-                return mapAssign(std::unique_ptr<Assign>(static_cast<Assign *>(what.release())), ctx);
-            } else if (isa_tree<Array>(what.get())) {
-                return mapArray(std::unique_ptr<Array>(static_cast<Array *>(what.release())), ctx);
-            } else if (isa_tree<Cast>(what.get())) {
-                return mapCast(std::unique_ptr<Cast>(static_cast<Cast *>(what.release())), ctx);
-            } else {
-                Exception::raise("should never happen. Forgot to add new tree kind? {}", what->nodeName());
+            switch (what->tag) {
+                case Tag::EmptyTree:
+                case Tag::ZSuperArgs:
+                    return what;
+                case Tag::UnresolvedConstantLit:
+                    return mapUnresolvedConstantLit(downcast<UnresolvedConstantLit>(move(what)), ctx);
+                case Tag::ConstantLit:
+                    return mapConstantLit(downcast<ConstantLit>(move(what)), ctx);
+                case Tag::Send:
+                    return mapSend(downcast<Send>(move(what)), ctx);
+                case Tag::Literal:
+                    return mapLiteral(downcast<Literal>(move(what)), ctx);
+                case Tag::UnresolvedIdent:
+                    return mapUnresolvedIdent(downcast<UnresolvedIdent>(move(what)), ctx);
+                case Tag::Local:
+                    return mapLocal(downcast<Local>(move(what)), ctx);
+                case Tag::MethodDef:
+                    return mapMethodDef(downcast<MethodDef>(move(what)), ctx);
+                case Tag::InsSeq:
+                    return mapInsSeq(downcast<InsSeq>(move(what)), ctx);
+                case Tag::Hash:
+                    return mapHash(downcast<Hash>(move(what)), ctx);
+                case Tag::ClassDef:
+                    return mapClassDef(downcast<ClassDef>(move(what)), ctx);
+                case Tag::If:
+                    return mapIf(downcast<If>(move(what)), ctx);
+                case Tag::While:
+                    return mapWhile(downcast<While>(move(what)), ctx);
+                case Tag::Break:
+                    return mapBreak(downcast<Break>(move(what)), ctx);
+                case Tag::Retry:
+                    return mapRetry(downcast<Retry>(move(what)), ctx);
+                case Tag::Next:
+                    return mapNext(downcast<Next>(move(what)), ctx);
+                case Tag::Return:
+                    return mapReturn(downcast<Return>(move(what)), ctx);
+                case Tag::Rescue:
+                    return mapRescue(downcast<Rescue>(move(what)), ctx);
+                case Tag::Field:
+                    return mapField(downcast<Field>(move(what)), ctx);
+                case Tag::Assign:
+                    return mapAssign(downcast<Assign>(move(what)), ctx);
+                case Tag::Array:
+                    return mapArray(downcast<Array>(move(what)), ctx);
+                case Tag::Cast:
+                    return mapCast(downcast<Cast>(move(what)), ctx);
+                default:
+                    Exception::raise("should never happen. Forgot to add new tree kind? {}", what->nodeName());
             }
         } catch (SorbetException &e) {
             Exception::failInFuzzer();
@@ -719,6 +722,123 @@ public:
         }
     }
 };
+/**
+ * For walks that only look at trees, and don't need the owner that `TreeMap` keeps in `ctx`: calls `func(Expression *)`
+ * on every node `TreeMap` would visit, parents before their children. It keeps the nodes still to visit on a stack of
+ * its own rather than recursing, so deeply nested trees (like long chains of sends) don't need a deep native stack.
+ */
+class TreeWalk {
+    template <class Exprs> static void pushAll(std::vector<Expression *> &stack, Exprs &exprs) {
+        for (auto it = exprs.rbegin(); it != exprs.rend(); ++it) {
+            stack.emplace_back(it->get());
+        }
+    }
+
+    template <class Args> static void pushArgDefaults(std::vector<Expression *> &stack, Args &args) {
+        for (auto it = args.rbegin(); it != args.rend(); ++it) {
+            // Only OptionalArgs have subexpressions within them.
+            if (auto *optArg = cast_tree<OptionalArg>(it->get())) {
+                stack.emplace_back(optArg->default_.get());
+            }
+        }
+    }
+
+public:
+    template <typename FUNC> static void visit(Expression *root, FUNC &&func) {
+        std::vector<Expression *> stack{root};
+        while (!stack.empty()) {
+            auto *what = stack.back();
+            stack.pop_back();
+            if (what == nullptr) {
+                continue;
+            }
+            func(what);
+            // Children are pushed last to first, so that they're visited in the order `TreeMap` visits them in.
+            switch (what->tag) {
+                case Tag::ClassDef:
+                    // Like `TreeMap`, we don't walk the ancestors.
+                    pushAll(stack, static_cast<ClassDef *>(what)->rhs);
+                    break;
+                case Tag::MethodDef: {
+                    auto *v = static_cast<MethodDef *>(what);
+                    stack.emplace_back(v->rhs.get());
+                    pushArgDefaults(stack, v->args);
+                    break;
+                }
+                case Tag::If: {
+                    auto *v = static_cast<If *>(what);
+                    stack.insert(stack.end(), {v->elsep.get(), v->thenp.get(), v->cond.get()});
+                    break;
+                }
+                case Tag::While: {
+                    auto *v = static_cast<While *>(what);
+                    stack.insert(stack.end(), {v->body.get(), v->cond.get()});
+                    break;
+                }
+                case Tag::Break:
+                    stack.emplace_back(static_cast<Break *>(what)->expr.get());
+                    break;
+                case Tag::Next:
+                    stack.emplace_back(static_cast<Next *>(what)->expr.get());
+                    break;
+                case Tag::Return:
+                    stack.emplace_back(static_cast<Return *>(what)->expr.get());
+                    break;
+                case Tag::RescueCase: {
+                    auto *v = static_cast<RescueCase *>(what);
+                    stack.insert(stack.end(), {v->body.get(), v->var.get()});
+                    pushAll(stack, v->exceptions);
+                    break;
+                }
+                case Tag::Rescue: {
+                    auto *v = static_cast<Rescue *>(what);
+                    stack.insert(stack.end(), {v->ensure.get(), v->else_.get()});
+                    pushAll(stack, v->rescueCases);
+                    stack.emplace_back(v->body.get());
+                    break;
+                }
+                case Tag::Assign: {
+                    auto *v = static_cast<Assign *>(what);
+                    stack.insert(stack.end(), {v->rhs.get(), v->lhs.get()});
+                    break;
+                }
+                case Tag::Send: {
+                    auto *v = static_cast<Send *>(what);
+                    stack.emplace_back(v->block.get());
+                    pushAll(stack, v->args);
+                    stack.emplace_back(v->recv.get());
+                    break;
+                }
+                case Tag::Block: {
+                    auto *v = static_cast<Block *>(what);
+                    stack.emplace_back(v->body.get());
+                    pushArgDefaults(stack, v->args);
+                    break;
+                }
+                case Tag::Hash: {
+                    auto *v = static_cast<Hash *>(what);
+                    pushAll(stack, v->values);
+                    pushAll(stack, v->keys);
+                    break;
+                }
+                case Tag::Array:
+                    pushAll(stack, static_cast<Array *>(what)->elems);
+                    break;
+                case Tag::InsSeq: {
+                    auto *v = static_cast<InsSeq *>(what);
+                    stack.emplace_back(v->expr.get());
+                    pushAll(stack, v->stats);
+                    break;
+                }
+                case Tag::Cast:
+                    stack.emplace_back(static_cast<Cast *>(what)->arg.get());
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+};
 } // namespace sorbet::ast
 
 #endif // SORBET_TREEMAP_H
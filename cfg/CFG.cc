@@ -1,6 +1,7 @@
 #include "cfg/CFG.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_split.h"
+#include "common/BitSet.h"
 
 // helps debugging
 template class std::unique_ptr<sorbet::cfg::CFG>;
@@ -33,16 +34,48 @@ CFG::ReadsAndWrites CFG::findAllReadsAndWrites(core::Context ctx) {
     target.reads.resize(maxBasicBlockId);
     target.writes.resize(maxBasicBlockId);
     target.dead.resize(maxBasicBlockId);
-    vector<UnorderedSet<core::LocalVariable>> readsAndWrites(maxBasicBlockId);
+    vector<vector<int>> readsAndWrites(maxBasicBlockId);
+
+    auto idOf = [&target](core::LocalVariable var) -> int {
+        auto [it, inserted] = target.ids.try_emplace(var, target.variables.size());
+        if (inserted) {
+            target.variables.emplace_back(var);
+        }
+        return it->second;
+    };
+
+    // What the block being visited has added to its lists so far. Cleared after every block, which only costs as much
+    // as the block's lists are long.
+    BitSet blockReadsSeen;
+    BitSet blockWritesSeen;
+    BitSet blockReadsAndWritesSeen;
 
     for (unique_ptr<BasicBlock> &bb : this->basicBlocks) {
         auto &blockWrites = target.writes[bb->id];
         auto &blockReads = target.reads[bb->id];
         auto &blockDead = target.dead[bb->id];
         auto &blockReadsAndWrites = readsAndWrites[bb->id];
+        auto addRead = [&](core::LocalVariable var) {
+            auto id = idOf(var);
+            if (blockReadsSeen.add(id)) {
+                blockReads.emplace_back(id);
+            }
+            return id;
+        };
+        auto addReadAndWrite = [&](int id) {
+            if (blockReadsAndWritesSeen.add(id)) {
+                blockReadsAndWrites.emplace_back(id);
+            }
+        };
+        auto addUse = [&](core::LocalVariable var) { addReadAndWrite(addRead(var)); };
+
         for (Binding &bind : bb->exprs) {
-            blockWrites.insert(bind.bind.variable);
-            blockReadsAndWrites.insert(bind.bind.variable);
+            auto bindId = idOf(bind.bind.variable);
+            bool firstWrite = blockWritesSeen.add(bindId);
+            if (firstWrite) {
+                blockWrites.emplace_back(bindId);
+            }
+            addReadAndWrite(bindId);
             /*
              * When we write to an alias, we rely on the type information being
              * propagated through block arguments from the point of
@@ -50,62 +83,62 @@ CFG::ReadsAndWrites CFG::findAllReadsAndWrites(core::Context ctx) {
              * variable serves to represent this.
              */
             if (bind.bind.variable.isAliasForGlobal(ctx) && cast_instruction<Alias>(bind.value.get()) == nullptr) {
-                blockReads.insert(bind.bind.variable);
+                addRead(bind.bind.variable);
             }
 
             if (auto *v = cast_instruction<Ident>(bind.value.get())) {
-                blockReads.insert(v->what);
-                blockReadsAndWrites.insert(v->what);
+                addUse(v->what);
             } else if (auto *v = cast_instruction<Send>(bind.value.get())) {
-                blockReads.insert(v->recv.variable);
-                blockReadsAndWrites.insert(v->recv.variable);
+                addUse(v->recv.variable);
                 for (auto &arg : v->args) {
-                    blockReads.insert(arg.variable);
-                    blockReadsAndWrites.insert(arg.variable);
+                    addUse(arg.variable);
                 }
             } else if (auto *v = cast_instruction<TAbsurd>(bind.value.get())) {
-                blockReads.insert(v->what.variable);
+                addRead(v->what.variable);
             } else if (auto *v = cast_instruction<Return>(bind.value.get())) {
-                blockReads.insert(v->what.variable);
-                blockReadsAndWrites.insert(v->what.variable);
+                addUse(v->what.variable);
             } else if (auto *v = cast_instruction<BlockReturn>(bind.value.get())) {
-                blockReads.insert(v->what.variable);
-                blockReadsAndWrites.insert(v->what.variable);
+                addUse(v->what.variable);
             } else if (auto *v = cast_instruction<Cast>(bind.value.get())) {
-                blockReads.insert(v->value.variable);
-                blockReadsAndWrites.insert(v->value.variable);
+                addUse(v->value.variable);
             } else if (auto *v = cast_instruction<LoadSelf>(bind.value.get())) {
-                blockReads.insert(v->fallback);
-                blockReadsAndWrites.insert(v->fallback);
+                addUse(v->fallback);
             }
 
-            auto fnd = blockReads.find(bind.bind.variable);
-            if (fnd == blockReads.end()) {
-                blockDead.insert(bind.bind.variable);
+            // Reads only accumulate, so it's enough to check the first write.
+            if (firstWrite && !blockReadsSeen.contains(bindId)) {
+                blockDead.emplace_back(bindId);
             }
         }
         if (bb->bexit.cond.variable.exists()) {
-            blockReads.insert(bb->bexit.cond.variable);
-            blockReadsAndWrites.insert(bb->bexit.cond.variable);
+            addUse(bb->bexit.cond.variable);
+        }
+
+        for (auto id : blockReads) {
+            blockReadsSeen.remove(id);
+        }
+        for (auto id : blockWrites) {
+            blockWritesSeen.remove(id);
+        }
+        for (auto id : blockReadsAndWrites) {
+            blockReadsAndWritesSeen.remove(id);
         }
     }
-    UnorderedMap<core::LocalVariable, pair<int, int>> usageCounts;
 
     {
-        Timer timeit(ctx.state.tracer(), "privates1");
-
+        Timer timeit(ctx.state.tracer(), "privates");
+        // A variable that is only mentioned in one block is private to it, and no other block needs to know that it
+        // is written.
+        vector<int> usageCounts(target.variables.size());
         for (auto blockId = 0; blockId < maxBasicBlockId; blockId++) {
-            for (auto &el : readsAndWrites[blockId]) {
-                usageCounts.try_emplace(el, make_pair(0, blockId)).first->second.first += 1;
+            for (auto id : readsAndWrites[blockId]) {
+                usageCounts[id]++;
             }
         }
-    }
-    {
-        Timer timeit(ctx.state.tracer(), "privates2");
-        for (const auto &[local, usages] : usageCounts) {
-            if (usages.first == 1) {
-                target.writes[usages.second].erase(local);
-            }
+        for (auto &blockWrites : target.writes) {
+            blockWrites.erase(remove_if(blockWrites.begin(), blockWrites.end(),
+                                        [&usageCounts](int id) { return usageCounts[id] == 1; }),
+                              blockWrites.end());
         }
     }
 
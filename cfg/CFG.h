@@ -63,6 +63,13 @@ public:
     BasicBlock() {
         counterInc("basicblocks");
     };
+    // Pooled for the same reason as Instruction.
+    static void *operator new(size_t size) {
+        return SmallObjectPool::allocate(size);
+    }
+    static void operator delete(void *ptr, size_t size) {
+        SmallObjectPool::deallocate(ptr, size);
+    }
 
     std::string toString(core::Context ctx);
 };
@@ -111,14 +118,25 @@ public:
     void sanityCheck(core::Context ctx);
 
     struct ReadsAndWrites {
-        std::vector<UnorderedSet<core::LocalVariable>> reads;
-        std::vector<UnorderedSet<core::LocalVariable>> writes;
+        // Every variable read or written in the CFG, numbered densely. The per-block lists below hold these numbers,
+        // each at most once, in no particular order.
+        std::vector<core::LocalVariable> variables;
+        UnorderedMap<core::LocalVariable, int> ids;
+
+        std::vector<std::vector<int>> reads;
+        std::vector<std::vector<int>> writes;
 
         // The "dead" set reports, for each block, variables that are *only*
         // read in that block after being written; they are thus dead on entry,
         // which we take advantage of when building dataflow information for
         // inference.
-        std::vector<UnorderedSet<core::LocalVariable>> dead;
+        std::vector<std::vector<int>> dead;
+
+        // Returns -1 if `var` is neither read nor written.
+        int idOf(core::LocalVariable var) const {
+            auto fnd = ids.find(var);
+            return fnd == ids.end() ? -1 : fnd->second;
+        }
     };
     ReadsAndWrites findAllReadsAndWrites(core::Context ctx);
 
@@ -1,6 +1,7 @@
 #ifndef SORBET_INSTRUCTIONS_H
 #define SORBET_INSTRUCTIONS_H
 
+#include "common/SmallObjectPool.h"
 #include "core/Context.h"
 #include "core/GlobalState.h"
 #include "core/LocalVariable.h"
@@ -32,6 +33,13 @@ public:
 class Instruction {
 public:
     virtual ~Instruction() = default;
+    // A CFG is built and thrown away for every method, so the next one gets its instructions back from the pool.
+    static void *operator new(size_t size) {
+        return SmallObjectPool::allocate(size);
+    }
+    static void operator delete(void *ptr, size_t size) {
+        SmallObjectPool::deallocate(ptr, size);
+    }
     virtual std::string toString(core::Context ctx) = 0;
     Instruction() = default;
     bool isSynthetic = false;
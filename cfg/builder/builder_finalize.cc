@@ -1,4 +1,5 @@
 #include "cfg/builder/builder.h"
+#include "common/BitSet.h"
 #include "core/Names.h"
 
 #include <algorithm> // sort, remove, unique
@@ -232,7 +233,11 @@ void CFGBuilder::removeDeadAssigns(core::Context ctx, const CFG::ReadsAndWrites
         return;
     }
 
+    BitSet blockReads;
     for (auto &it : cfg.basicBlocks) {
+        for (auto id : RnW.reads[it->id]) {
+            blockReads.add(id);
+        }
         /* remove dead variables */
         for (auto expIt = it->exprs.begin(); expIt != it->exprs.end(); /* nothing */) {
             Binding &bind = *expIt;
@@ -241,8 +246,8 @@ void CFGBuilder::removeDeadAssigns(core::Context ctx, const CFG::ReadsAndWrites
                 continue;
             }
 
-            auto fnd = RnW.reads[it->id].find(bind.bind.variable);
-            bool wasRead = fnd != RnW.reads[it->id].end(); // read in the same block
+            auto id = RnW.idOf(bind.bind.variable);
+            bool wasRead = id >= 0 && blockReads.contains(id); // read in the same block
             if (!wasRead) {
                 for (const auto &arg : it->bexit.thenb->args) {
                     if (arg.variable == bind.bind.variable) {
@@ -276,35 +281,38 @@ void CFGBuilder::removeDeadAssigns(core::Context ctx, const CFG::ReadsAndWrites
                 ++expIt;
             }
         }
+        for (auto id : RnW.reads[it->id]) {
+            blockReads.remove(id);
+        }
     }
 }
 
 void CFGBuilder::computeMinMaxLoops(core::Context ctx, const CFG::ReadsAndWrites &RnW, CFG &cfg) {
+    // Accumulate by variable number first, so that each variable costs one lookup in the maps below rather than one
+    // per mention.
+    vector<int> minLoops(RnW.variables.size(), INT_MAX);
+    vector<int> maxLoopWrite(RnW.variables.size(), -1);
     for (const auto &bb : cfg.basicBlocks) {
-        for (const core::LocalVariable what : RnW.reads[bb->id]) {
-            const auto minIt = cfg.minLoops.find(what);
-            int curMin = minIt != cfg.minLoops.end() ? minIt->second : INT_MAX;
-            if (curMin > bb->outerLoops) {
-                curMin = bb->outerLoops;
-            }
-            cfg.minLoops[what] = curMin;
+        for (auto id : RnW.reads[bb->id]) {
+            minLoops[id] = min(minLoops[id], bb->outerLoops);
         }
     }
     for (const auto &bb : cfg.basicBlocks) {
         for (const auto &expr : bb->exprs) {
-            auto what = expr.bind.variable;
-            const auto minIt = cfg.minLoops.find(what);
-            const auto maxIt = cfg.maxLoopWrite.find(what);
-            int curMin = minIt != cfg.minLoops.end() ? minIt->second : INT_MAX;
-            int curMax = maxIt != cfg.maxLoopWrite.end() ? maxIt->second : 0;
-            if (curMin > bb->outerLoops) {
-                curMin = bb->outerLoops;
-            }
-            if (curMax < bb->outerLoops) {
-                curMax = bb->outerLoops;
-            }
-            cfg.minLoops[what] = curMin;
-            cfg.maxLoopWrite[what] = curMax;
+            auto id = RnW.ids.at(expr.bind.variable);
+            minLoops[id] = min(minLoops[id], bb->outerLoops);
+            maxLoopWrite[id] = max(maxLoopWrite[id], bb->outerLoops);
+        }
+    }
+    for (int id = 0; id < RnW.variables.size(); id++) {
+        auto what = RnW.variables[id];
+        if (minLoops[id] != INT_MAX) {
+            auto &curMin = cfg.minLoops.try_emplace(what, INT_MAX).first->second;
+            curMin = min(curMin, minLoops[id]);
+        }
+        if (maxLoopWrite[id] >= 0) {
+            auto &curMax = cfg.maxLoopWrite.try_emplace(what, 0).first->second;
+            curMax = max(curMax, maxLoopWrite[id]);
         }
     }
 }
@@ -319,70 +327,113 @@ void CFGBuilder::fillInBlockArguments(core::Context ctx, const CFG::ReadsAndWrit
     //
     //  every node gets the intersection between two sets suggested by those overestimations.
     //
-    // This solution is  (|BB| + |symbols-mentioned|) * (|cycles|) + |answer_size| in complexity.
-    // making this quadratic in anything will be bad.
+    // Both are solved with a worklist over bitsets indexed by RnW's variable numbers: a block is only revisited when
+    // the bound of a neighbour it depends on grew, and merging two bounds goes a word at a time.
 
-    const vector<UnorderedSet<core::LocalVariable>> &readsByBlock = RnW.reads;
-    const vector<UnorderedSet<core::LocalVariable>> &writesByBlock = RnW.writes;
-    const vector<UnorderedSet<core::LocalVariable>> &deadByBlock = RnW.dead;
+    const vector<vector<int>> &readsByBlock = RnW.reads;
+    const vector<vector<int>> &writesByBlock = RnW.writes;
+    const vector<vector<int>> &deadByBlock = RnW.dead;
 
     // iterate ver basic blocks in reverse and found upper bounds on what could a block need.
-    vector<UnorderedSet<core::LocalVariable>> upperBounds1(cfg.maxBasicBlockId);
-    bool changed = true;
+    vector<BitSet> upperBounds1(cfg.maxBasicBlockId);
     {
         Timer timeit(ctx.state.tracer(), "upperBounds1");
+        // Any variable that we write and do not read is dead on entry to
+        // this block, and we do not require it.
+        vector<vector<int>> killedByBlock(cfg.maxBasicBlockId);
         for (BasicBlock *bb : cfg.forwardsTopoSort) {
+            auto &killed = killedByBlock[bb->id];
+            for (auto dead : deadByBlock[bb->id]) {
+                // TODO(nelhage) We can't erase for variables inside loops, due
+                // to how our "pinning" type inference works. We can remove this
+                // inner condition when we get a better type inference
+                // algorithm.
+                if (bb->outerLoops <= cfg.minLoops[RnW.variables[dead]]) {
+                    killed.emplace_back(dead);
+                }
+            }
             auto &upperBoundsForBlock = upperBounds1[bb->id];
-            upperBoundsForBlock.insert(readsByBlock[bb->id].begin(), readsByBlock[bb->id].end());
+            for (auto id : readsByBlock[bb->id]) {
+                upperBoundsForBlock.add(id);
+            }
+            for (auto id : killed) {
+                upperBoundsForBlock.remove(id);
+            }
         }
-        while (changed) {
-            changed = false;
-            for (BasicBlock *bb : cfg.forwardsTopoSort) {
-                auto &upperBoundsForBlock = upperBounds1[bb->id];
-                int sz = upperBoundsForBlock.size();
-                if (bb->bexit.thenb != cfg.deadBlock()) {
-                    upperBoundsForBlock.insert(upperBounds1[bb->bexit.thenb->id].begin(),
-                                               upperBounds1[bb->bexit.thenb->id].end());
-                }
-                if (bb->bexit.elseb != cfg.deadBlock()) {
-                    upperBoundsForBlock.insert(upperBounds1[bb->bexit.elseb->id].begin(),
-                                               upperBounds1[bb->bexit.elseb->id].end());
-                }
-                // Any variable that we write and do not read is dead on entry to
-                // this block, and we do not require it.
-                for (auto dead : deadByBlock[bb->id]) {
-                    // TODO(nelhage) We can't erase for variables inside loops, due
-                    // to how our "pinning" type inference works. We can remove this
-                    // inner condition when we get a better type inference
-                    // algorithm.
-                    if (bb->outerLoops <= cfg.minLoops[dead]) {
-                        upperBoundsForBlock.erase(dead);
-                    }
-                }
 
-                changed = changed || (upperBoundsForBlock.size() != sz);
+        // Seeded so that blocks are first visited in the order of forwardsTopoSort, which mostly puts successors
+        // first.
+        vector<BasicBlock *> worklist(cfg.forwardsTopoSort.rbegin(), cfg.forwardsTopoSort.rend());
+        vector<bool> inWorklist(cfg.maxBasicBlockId);
+        for (BasicBlock *bb : worklist) {
+            inWorklist[bb->id] = true;
+        }
+        while (!worklist.empty()) {
+            BasicBlock *bb = worklist.back();
+            worklist.pop_back();
+            inWorklist[bb->id] = false;
+
+            auto &upperBoundsForBlock = upperBounds1[bb->id];
+            bool changed = false;
+            if (bb->bexit.thenb != cfg.deadBlock()) {
+                changed = upperBoundsForBlock.addAll(upperBounds1[bb->bexit.thenb->id]) || changed;
+            }
+            if (bb->bexit.elseb != cfg.deadBlock()) {
+                changed = upperBoundsForBlock.addAll(upperBounds1[bb->bexit.elseb->id]) || changed;
+            }
+            if (!changed) {
+                continue;
+            }
+            for (auto id : killedByBlock[bb->id]) {
+                upperBoundsForBlock.remove(id);
+            }
+            for (BasicBlock *parent : bb->backEdges) {
+                if (!inWorklist[parent->id]) {
+                    inWorklist[parent->id] = true;
+                    worklist.emplace_back(parent);
+                }
             }
         }
     }
 
-    vector<UnorderedSet<core::LocalVariable>> upperBounds2(cfg.maxBasicBlockId);
-
-    changed = true;
+    vector<BitSet> upperBounds2(cfg.maxBasicBlockId);
     {
         Timer timeit(ctx.state.tracer(), "upperBounds2");
-        while (changed) {
-            changed = false;
-            for (auto it = cfg.forwardsTopoSort.rbegin(); it != cfg.forwardsTopoSort.rend(); ++it) {
-                BasicBlock *bb = *it;
-                auto &upperBoundsForBlock = upperBounds2[bb->id];
-                int sz = upperBoundsForBlock.size();
-                for (BasicBlock *edge : bb->backEdges) {
-                    if (edge != cfg.deadBlock()) {
-                        upperBoundsForBlock.insert(writesByBlock[edge->id].begin(), writesByBlock[edge->id].end());
-                        upperBoundsForBlock.insert(upperBounds2[edge->id].begin(), upperBounds2[edge->id].end());
-                    }
+        // What a block passes on to its successors: its own writes plus its bound.
+        vector<BitSet> outgoing(cfg.maxBasicBlockId);
+        for (BasicBlock *bb : cfg.forwardsTopoSort) {
+            for (auto id : writesByBlock[bb->id]) {
+                outgoing[bb->id].add(id);
+            }
+        }
+
+        // Seeded so that blocks are first visited in reverse forwardsTopoSort order, which mostly puts predecessors
+        // first.
+        vector<BasicBlock *> worklist(cfg.forwardsTopoSort.begin(), cfg.forwardsTopoSort.end());
+        vector<bool> inWorklist(cfg.maxBasicBlockId);
+        for (BasicBlock *bb : worklist) {
+            inWorklist[bb->id] = true;
+        }
+        while (!worklist.empty()) {
+            BasicBlock *bb = worklist.back();
+            worklist.pop_back();
+            inWorklist[bb->id] = false;
+
+            auto &upperBoundsForBlock = upperBounds2[bb->id];
+            bool changed = false;
+            for (BasicBlock *edge : bb->backEdges) {
+                if (edge != cfg.deadBlock()) {
+                    changed = upperBoundsForBlock.addAll(outgoing[edge->id]) || changed;
+                }
+            }
+            if (!changed || !outgoing[bb->id].addAll(upperBoundsForBlock)) {
+                continue;
+            }
+            for (BasicBlock *succ : {bb->bexit.thenb, bb->bexit.elseb}) {
+                if (!inWorklist[succ->id]) {
+                    inWorklist[succ->id] = true;
+                    worklist.emplace_back(succ);
                 }
-                changed = changed || (upperBounds2[bb->id].size() != sz);
             }
         }
     }
@@ -390,16 +441,10 @@ void CFGBuilder::fillInBlockArguments(core::Context ctx, const CFG::ReadsAndWrit
         Timer timeit(ctx.state.tracer(), "upperBoundsMerge");
         /** Combine two upper bounds */
         for (auto &it : cfg.basicBlocks) {
-            auto set2 = upperBounds2[it->id];
-
-            int set1Sz = set2.size();
-            int set2Sz = upperBounds1[it->id].size();
-            it->args.reserve(set1Sz > set2Sz ? set2Sz : set1Sz);
-            for (auto el : upperBounds1[it->id]) {
-                if (set2.find(el) != set2.end()) {
-                    it->args.emplace_back(el);
-                }
-            }
+            auto &set1 = upperBounds1[it->id];
+            set1.retainAll(upperBounds2[it->id]);
+            it->args.reserve(set1.size());
+            set1.forEach([&](int id) { it->args.emplace_back(RnW.variables[id]); });
             fast_sort(it->args, [](const auto &lhs, const auto &rhs) -> bool { return lhs.variable < rhs.variable; });
             histogramInc("cfgbuilder.blockArguments", it->args.size());
         }
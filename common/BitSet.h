@@ -0,0 +1,102 @@
+#ifndef SORBET_COMMON_BITSET_H
+#define SORBET_COMMON_BITSET_H
+
+#include "common/common.h"
+#include <vector>
+
+namespace sorbet {
+
+/**
+ * A set of small non-negative integers, one bit each, for dataflow analyses over densely numbered things like the
+ * local variables of a method. Unlike `std::vector<bool>`, set operations go a word at a time. The set grows as
+ * elements are added; there is no fixed universe.
+ */
+class BitSet final {
+    static constexpr int WORD_BITS = 64;
+    std::vector<u8> words;
+
+public:
+    BitSet() = default;
+    // Pre-allocates room for elements below `size`.
+    explicit BitSet(int size) : words((size + WORD_BITS - 1) / WORD_BITS) {}
+
+    bool contains(int i) const {
+        ENFORCE(i >= 0);
+        auto word = i / WORD_BITS;
+        return word < words.size() && (words[word] & (u8(1) << (i % WORD_BITS))) != 0;
+    }
+
+    // Returns whether `i` was not in the set before.
+    bool add(int i) {
+        ENFORCE(i >= 0);
+        auto word = i / WORD_BITS;
+        if (word >= words.size()) {
+            words.resize(word + 1);
+        }
+        auto bit = u8(1) << (i % WORD_BITS);
+        bool added = (words[word] & bit) == 0;
+        words[word] |= bit;
+        return added;
+    }
+
+    void remove(int i) {
+        ENFORCE(i >= 0);
+        auto word = i / WORD_BITS;
+        if (word < words.size()) {
+            words[word] &= ~(u8(1) << (i % WORD_BITS));
+        }
+    }
+
+    // Adds every element of `other`. Returns whether that changed this set.
+    bool addAll(const BitSet &other) {
+        if (other.words.size() > words.size()) {
+            words.resize(other.words.size());
+        }
+        u8 added = 0;
+        for (int word = 0; word < other.words.size(); word++) {
+            added |= other.words[word] & ~words[word];
+            words[word] |= other.words[word];
+        }
+        return added != 0;
+    }
+
+    // Removes every element that is not in `other`.
+    void retainAll(const BitSet &other) {
+        if (words.size() > other.words.size()) {
+            words.resize(other.words.size());
+        }
+        for (int word = 0; word < words.size(); word++) {
+            words[word] &= other.words[word];
+        }
+    }
+
+    bool empty() const {
+        for (auto word : words) {
+            if (word != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int size() const {
+        int result = 0;
+        for (auto word : words) {
+            result += __builtin_popcountll(word);
+        }
+        return result;
+    }
+
+    // Calls `fn(i)` for every element `i`, in increasing order.
+    template <class F> void forEach(F fn) const {
+        for (int word = 0; word < words.size(); word++) {
+            for (u8 bits = words[word]; bits != 0; bits &= bits - 1) {
+                fn(word * WORD_BITS + __builtin_ctzll(bits));
+            }
+        }
+    }
+};
+
+} // namespace sorbet
+
+#endif // SORBET_COMMON_BITSET_H
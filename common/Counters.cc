@@ -2,9 +2,11 @@
 #include "absl/strings/str_cat.h"
 #include "common/Counters_impl.h"
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <iomanip> // set
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -83,6 +85,46 @@ void CounterImpl::prodCounterAdd(const char *counter, unsigned long value) {
     this->counters[counter] += value;
 }
 
+int CounterImpl::latencyBucket(u8 nanos) {
+    if (nanos < LATENCY_SUB_BUCKETS) {
+        return nanos;
+    }
+    const int exponent = 63 - __builtin_clzll(nanos);
+    const int shift = exponent - LATENCY_SUB_BUCKET_BITS;
+    return ((shift + 1) << LATENCY_SUB_BUCKET_BITS) + ((nanos >> shift) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+u8 CounterImpl::latencyBucketMax(int bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+    const int shift = (bucket >> LATENCY_SUB_BUCKET_BITS) - 1;
+    const u8 mantissa = LATENCY_SUB_BUCKETS + (bucket & (LATENCY_SUB_BUCKETS - 1));
+    return ((mantissa + 1) << shift) - 1;
+}
+
+u8 CounterImpl::latencyPercentile(const UnorderedMap<int, CounterType> &buckets, double percentile) {
+    vector<pair<int, CounterType>> sorted(buckets.begin(), buckets.end());
+    fast_sort(sorted, [](const auto &e1, const auto &e2) -> bool { return e1.first < e2.first; });
+    const auto total = absl::c_accumulate(sorted, 0.0, [](double sum, const auto &e) { return sum + e.second; });
+    const double rank = total * percentile / 100.0;
+    CounterType seen = 0;
+    for (auto &e : sorted) {
+        seen += e.second;
+        if (seen >= rank) {
+            return latencyBucketMax(e.first);
+        }
+    }
+    return sorted.empty() ? 0 : latencyBucketMax(sorted.back().first);
+}
+
+void CounterImpl::latencyAdd(const char *measure, int bucket, unsigned long value) {
+    if (fuzz_mode) {
+        return;
+    }
+    this->latencies[measure][bucket] += value;
+}
+
 void CounterImpl::timingAdd(CounterImpl::Timing timing) {
     if (fuzz_mode) {
         return;
@@ -92,7 +134,105 @@ void CounterImpl::timingAdd(CounterImpl::Timing timing) {
 
 thread_local CounterImpl counterState;
 
+namespace {
+// A slot's name is null until its StaticCounter finishes registering, which happens before any thread can add to it.
+atomic<const char *> staticCounterNames[StaticCounter::MAX_COUNTERS];
+atomic<int> staticCounterCount{0};
+} // namespace
+
+thread_local unsigned long StaticCounter::values[StaticCounter::MAX_COUNTERS];
+
+StaticCounter::StaticCounter(ConstExprStr name) : slot(staticCounterCount.fetch_add(1)) {
+    if (slot >= MAX_COUNTERS) {
+        Exception::raise("More than {} StaticCounters", MAX_COUNTERS);
+    }
+    staticCounterNames[slot].store(name.str);
+}
+
+void CounterImpl::takeStaticCounters() {
+    const int count = min(staticCounterCount.load(), StaticCounter::MAX_COUNTERS);
+    for (int slot = 0; slot < count; slot++) {
+        staticCounters[slot] += StaticCounter::values[slot];
+        StaticCounter::values[slot] = 0;
+    }
+}
+
+namespace {
+// Counters handed over by `counterPublish`, waiting for the next thread that collects its counters.
+mutex publishedMutex;
+CounterImpl publishedCounters; // guarded by publishedMutex
+bool hasPublishedCounters = false; // guarded by publishedMutex
+
+// Merges `from`, which is left unspecified, into `into`.
+void mergeCounters(CounterImpl &into, CounterImpl &from) {
+    for (int slot = 0; slot < StaticCounter::MAX_COUNTERS; slot++) {
+        into.staticCounters[slot] += from.staticCounters[slot];
+    }
+
+    // Counters are often merged into a thread that has none of its own yet, in which case the maps are taken whole
+    // rather than rehashed key by key.
+    if (into.countersByCategory.empty()) {
+        swap(into.countersByCategory, from.countersByCategory);
+    }
+    if (into.histograms.empty()) {
+        swap(into.histograms, from.histograms);
+    }
+    if (into.counters.empty()) {
+        swap(into.counters, from.counters);
+    }
+    if (into.latencies.empty()) {
+        swap(into.latencies, from.latencies);
+    }
+    if (into.timings.empty()) {
+        swap(into.timings, from.timings);
+    }
+
+    for (auto &cat : from.countersByCategory) {
+        for (auto &e : cat.second) {
+            into.prodCategoryCounterAdd(cat.first, e.first, e.second);
+        }
+    }
+
+    for (auto &hist : from.histograms) {
+        for (auto &e : hist.second) {
+            into.prodHistogramAdd(hist.first, e.first, e.second);
+        }
+    }
+
+    for (auto &e : from.counters) {
+        into.prodCounterAdd(e.first, e.second);
+    }
+    for (auto &latency : from.latencies) {
+        for (auto &e : latency.second) {
+            into.latencyAdd(latency.first, e.first, e.second);
+        }
+    }
+    for (auto &e : from.timings) {
+        into.timingAdd(e);
+    }
+}
+
+void takePublishedCounters() {
+    lock_guard<mutex> lck(publishedMutex);
+    if (!hasPublishedCounters) {
+        return;
+    }
+    mergeCounters(counterState, publishedCounters);
+    publishedCounters.clear();
+    publishedCounters.timings.clear();
+    hasPublishedCounters = false;
+}
+} // namespace
+
+void counterPublish(CounterState cs) {
+    lock_guard<mutex> lck(publishedMutex);
+    mergeCounters(publishedCounters, *cs.counters);
+    hasPublishedCounters = true;
+}
+
 CounterState getAndClearThreadCounters() {
+    takePublishedCounters();
+    counterState.takeStaticCounters();
     auto state = make_unique<CounterImpl>(move(counterState));
     counterState.clear();
     return CounterState(move(state));
@@ -103,7 +243,9 @@ void CounterImpl::clear() {
     this->stringsByPtr.clear();
     this->histograms.clear();
     this->counters.clear();
+    this->latencies.clear();
     this->countersByCategory.clear();
+    this->staticCounters.fill(0);
 }
 
 UnorderedMap<long, long> getAndClearHistogram(ConstExprStr histogram) {
@@ -122,24 +264,7 @@ UnorderedMap<long, long> getAndClearHistogram(ConstExprStr histogram) {
 }
 
 void counterConsume(CounterState cs) {
-    for (auto &cat : cs.counters->countersByCategory) {
-        for (auto &e : cat.second) {
-            counterState.prodCategoryCounterAdd(cat.first, e.first, e.second);
-        }
-    }
-
-    for (auto &hist : cs.counters->histograms) {
-        for (auto &e : hist.second) {
-            counterState.prodHistogramAdd(hist.first, e.first, e.second);
-        }
-    }
-
-    for (auto &e : cs.counters->counters) {
-        counterState.prodCounterAdd(e.first, e.second);
-    }
-    for (auto &e : cs.counters->timings) {
-        counterState.timingAdd(e);
-    }
+    mergeCounters(counterState, *cs.counters);
 }
 
 void counterAdd(ConstExprStr counter, unsigned long value) {
@@ -170,6 +295,8 @@ void categoryCounterAdd(ConstExprStr category, ConstExprStr counter, unsigned lo
     counterState.categoryCounterAdd(category.str, counter.str, value);
 }
 
+atomic<TimingSink *> timingSink{nullptr};
+
 int genThreadId() {
     static atomic<int> counter{0};
     return ++counter;
@@ -198,9 +325,21 @@ void timingAdd(ConstExprStr measure, std::chrono::time_point<std::chrono::steady
                                             // for workaround
     CounterImpl::Timing tim{0,    measure.str, start, end, getThreadId(), givenArgs2StoredArgs(move(args)),
                             self, previous};
+    if (auto *sink = timingSink.load()) {
+        sink->add(tim);
+        return;
+    }
     counterState.timingAdd(tim);
 }
 
+void setTimingSink(TimingSink *sink) {
+    timingSink.store(sink);
+}
+
+void latencyAdd(ConstExprStr measure, chrono::nanoseconds duration) {
+    counterState.latencyAdd(measure.str, CounterImpl::latencyBucket(duration.count()), 1);
+}
+
 void prodCategoryCounterAdd(ConstExprStr category, ConstExprStr counter, unsigned long value) {
     counterState.prodCategoryCounterAdd(category.str, counter.str, value);
 }
@@ -245,13 +384,28 @@ void CounterImpl::canonicalize() {
         out.prodCounterAdd(internKey(e.first), e.second);
     }
 
+    for (auto &latency : this->latencies) {
+        for (auto &e : latency.second) {
+            out.latencyAdd(internKey(latency.first), e.first, e.second);
+        }
+    }
+
     for (auto &e : this->timings) {
         out.timingAdd(e);
     }
 
+    const int count = min(staticCounterCount.load(), StaticCounter::MAX_COUNTERS);
+    for (int slot = 0; slot < count; slot++) {
+        if (this->staticCounters[slot] != 0) {
+            out.prodCounterAdd(internKey(staticCounterNames[slot].load()), this->staticCounters[slot]);
+        }
+    }
+    this->staticCounters.fill(0);
+
     this->countersByCategory = std::move(out.countersByCategory);
     this->histograms = std::move(out.histograms);
     this->counters = std::move(out.counters);
+    this->latencies = std::move(out.latencies);
     this->timings = std::move(out.timings);
 }
 
@@ -264,6 +418,8 @@ bool shouldShow(vector<string> &wantNames, string_view name) {
 }
 
 string getCounterStatistics(vector<string> names) {
+    takePublishedCounters();
+    counterState.takeStaticCounters();
     counterState.canonicalize();
 
     fmt::memory_buffer buf;
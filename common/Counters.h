@@ -54,6 +54,7 @@ struct CounterState {
 private:
     friend CounterState getAndClearThreadCounters();
     friend void counterConsume(CounterState cs);
+    friend void counterPublish(CounterState cs);
     friend class core::Proto;
     friend class StatsD;
     friend class sorbet::web_tracer_framework::Tracing;
@@ -68,6 +69,9 @@ struct Counters {
 
 CounterState getAndClearThreadCounters();
 void counterConsume(CounterState cs);
+// Hands `cs` to whichever thread next calls `getAndClearThreadCounters` or `getCounterStatistics`. For threads that
+// record counters after the work they report them with has been handed back, like WorkerPool's workers.
+void counterPublish(CounterState cs);
 
 void prodCounterInc(ConstExprStr counter);
 void prodCounterAdd(ConstExprStr counter, unsigned long value);
@@ -81,6 +85,37 @@ void histogramInc(ConstExprStr histogram, int key);
 void histogramAdd(ConstExprStr histogram, int key, unsigned long value);
 void prodHistogramInc(ConstExprStr histogram, int key);
 void prodHistogramAdd(ConstExprStr histogram, int key, unsigned long value);
+
+// A counter for hot code, which can't afford the hash map lookup `prodCounterInc` does. Each one is given a fixed slot
+// in a per-thread array when it is constructed, so adding to it is a single array add and it is always enabled. Slots
+// stay in arrays while threads' counters are merged, and become the counter `name` only once counters are reported.
+//
+// Must have static storage duration, e.g.
+//
+//     static StaticCounter typechecked("types.input.methods.typechecked");
+//     typechecked.inc();
+class StaticCounter final {
+public:
+    static constexpr int MAX_COUNTERS = 256;
+
+    explicit StaticCounter(ConstExprStr name);
+    StaticCounter(const StaticCounter &) = delete;
+
+    void add(unsigned long value) const {
+        values[slot] += value;
+    }
+
+    void inc() const {
+        add(1);
+    }
+
+private:
+    friend struct CounterImpl;
+
+    static thread_local unsigned long values[MAX_COUNTERS];
+    const int slot;
+};
+
 /* Does not aggregate over measures, instead, reports them separately.
  * Use with care, as it can make us report a LOT of data. */
 struct FlowId {
@@ -91,6 +126,9 @@ void timingAdd(ConstExprStr measure, std::chrono::time_point<std::chrono::steady
                std::chrono::time_point<std::chrono::steady_clock> end,
                std::vector<std::pair<ConstExprStr, std::string>> args, FlowId self, FlowId previous);
 
+// Records how long one run of `measure` took, for the latency percentiles reported to statsd. Always enabled.
+void latencyAdd(ConstExprStr measure, std::chrono::nanoseconds duration);
+
 UnorderedMap<long, long> getAndClearHistogram(ConstExprStr histogram);
 std::string getCounterStatistics(std::vector<std::string> names);
 
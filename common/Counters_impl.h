@@ -1,7 +1,9 @@
 #ifndef SORBET_COUNTERS_IMPL_H
 #define SORBET_COUNTERS_IMPL_H
 
+#include "common/Counters.h"
 #include "common/common.h"
+#include <array>
 #include <string_view>
 
 namespace sorbet {
@@ -14,6 +16,8 @@ struct CounterImpl {
 
     void canonicalize();
     void clear();
+    // Moves the calling thread's StaticCounter slots into `staticCounters`.
+    void takeStaticCounters();
 
     const char *internKey(const char *str);
 
@@ -26,6 +30,17 @@ struct CounterImpl {
     void counterAdd(const char *counter, unsigned long value);
     void prodCounterAdd(const char *counter, unsigned long value);
 
+    // Latencies are bucketed by their logarithm, with LATENCY_SUB_BUCKETS buckets per power of two, so percentiles
+    // read back from them are within 1/LATENCY_SUB_BUCKETS of the truth.
+    static constexpr int LATENCY_SUB_BUCKET_BITS = 2;
+    static constexpr int LATENCY_SUB_BUCKETS = 1 << LATENCY_SUB_BUCKET_BITS;
+    static int latencyBucket(u8 nanos);
+    // The largest latency that falls into `bucket`.
+    static u8 latencyBucketMax(int bucket);
+    // The latency `percentile` (in [0, 100]) of those recorded in `buckets` are at most, up to bucketing.
+    static u8 latencyPercentile(const UnorderedMap<int, CounterType> &buckets, double percentile);
+    void latencyAdd(const char *measure, int bucket, unsigned long value);
+
     // std::string_view isn't hashable, so we use an unordered map. We could
     // implement hash ourselves, but this is the slowpath anyways.
     UnorderedMap<std::string_view, const char *> strings_by_value;
@@ -44,9 +59,26 @@ struct CounterImpl {
     void timingAdd(Timing timing);
     UnorderedMap<const char *, UnorderedMap<int, CounterType>> histograms;
     UnorderedMap<const char *, CounterType> counters;
+    // Bucketed latencies of every Timer, see `latencyBucket`.
+    UnorderedMap<const char *, UnorderedMap<int, CounterType>> latencies;
     std::vector<Timing> timings;
     UnorderedMap<const char *, UnorderedMap<const char *, CounterType>> countersByCategory;
+    // StaticCounter values by slot, so that merging them is an array add. `canonicalize` moves them into `counters`
+    // under their names.
+    std::array<CounterType, StaticCounter::MAX_COUNTERS> staticCounters{};
+};
+
+// Receives the timing of every Timer as it completes, instead of it being kept in the thread's counters until exit.
+// Called from whichever thread the Timer ran on.
+class TimingSink {
+public:
+    virtual ~TimingSink() = default;
+    virtual void add(const CounterImpl::Timing &timing) = 0;
 };
+
+// Installs `sink`, or uninstalls the current one if null. The sink must outlive every Timer that completes while it's
+// installed.
+void setTimingSink(TimingSink *sink);
 } // namespace sorbet
 
 #endif
@@ -1,6 +1,7 @@
 #ifndef SORBET_COMMON_FILEOPS_HPP
 #define SORBET_COMMON_FILEOPS_HPP
 #include "common/common.h"
+#include <functional>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -13,9 +14,16 @@ public:
     static bool isFile(std::string_view path, std::string_view ignorePattern, const int pos);
     static bool isFolder(std::string_view path, std::string_view ignorePattern, const int pos);
     static std::string read(std::string_view filename);
+    // Like `read`, except that if the file is longer than `headBytes`, it passes the first `headBytes` to `skipRest`,
+    // and if that returns true, returns only them and never reads the rest.
+    static std::string readOrHead(std::string_view filename, size_t headBytes,
+                                  const std::function<bool(std::string_view)> &skipRest);
+    // Asks the OS to start reading `filename` into the page cache without waiting for it. Ignores errors.
+    static void prefetch(std::string_view filename);
     static void write(std::string_view filename, const std::vector<sorbet::u1> &data);
     static void append(std::string_view filename, std::string_view text);
     static void write(std::string_view filename, std::string_view text);
+    // Writes `text` to `filename` unless that is already its content. Returns whether it wrote.
     static bool writeIfDifferent(std::string_view filename, std::string_view text);
     static bool dirExists(std::string_view path);
     static void createDir(std::string_view path);
@@ -47,6 +55,8 @@ public:
      * Throws FileReadException on EOF or error.
      */
     static int readFd(int fd, std::vector<char> &output, int timeoutMs = 100);
+    /** Like the above, but reads up to `size` bytes into `output`. */
+    static int readFd(int fd, char *output, size_t size, int timeoutMs = 100);
     /**
      * Attempts to read data up to a newline (\n) from the given file descriptor.
      * Timeout is specified in milliseconds.
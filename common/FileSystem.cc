@@ -4,10 +4,28 @@
 namespace sorbet {
 using namespace std;
 
+string FileSystem::readFileOrHead(string_view path, size_t headBytes,
+                                  const function<bool(string_view)> &skipRest) const {
+    auto contents = readFile(path);
+    if (contents.size() > headBytes && skipRest(string_view(contents).substr(0, headBytes))) {
+        contents.resize(headBytes);
+    }
+    return contents;
+}
+
 string OSFileSystem::readFile(string_view path) const {
     return FileOps::read(path);
 }
 
+string OSFileSystem::readFileOrHead(string_view path, size_t headBytes,
+                                    const function<bool(string_view)> &skipRest) const {
+    return FileOps::readOrHead(path, headBytes, skipRest);
+}
+
+void OSFileSystem::prefetchFile(string_view path) const {
+    FileOps::prefetch(path);
+}
+
 void OSFileSystem::writeFile(string_view filename, string_view text) {
     return FileOps::write(filename, text);
 }
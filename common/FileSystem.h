@@ -2,6 +2,7 @@
 #define COMMON_FILESYSTEM_H
 
 #include "common/common.h"
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -18,6 +19,20 @@ public:
     /** Read the file at the given path. Throws a `FileNotFoundException` if not found. */
     virtual std::string readFile(std::string_view path) const = 0;
 
+    /**
+     * Reads the file at the given path like `readFile`, except that if it is longer than `headBytes`, it passes the
+     * first `headBytes` to `skipRest`, and if that returns true, returns only them. By default, this reads the whole
+     * file either way.
+     */
+    virtual std::string readFileOrHead(std::string_view path, size_t headBytes,
+                                       const std::function<bool(std::string_view)> &skipRest) const;
+
+    /**
+     * Hints that the file at the given path is about to be read, so that it can start loading in the background.
+     * Never throws, and does nothing by default.
+     */
+    virtual void prefetchFile(std::string_view path) const {}
+
     /** Writes the specified data to the given file. */
     virtual void writeFile(std::string_view filename, std::string_view text) = 0;
 
@@ -44,6 +59,9 @@ public:
     OSFileSystem() = default;
 
     std::string readFile(std::string_view path) const override;
+    std::string readFileOrHead(std::string_view path, size_t headBytes,
+                               const std::function<bool(std::string_view)> &skipRest) const override;
+    void prefetchFile(std::string_view path) const override;
     void writeFile(std::string_view filename, std::string_view text) override;
     std::vector<std::string> listFilesInDir(std::string_view path, const UnorderedSet<std::string> &extensions,
                                             bool recursive, const std::vector<std::string> &absoluteIgnorePatterns,
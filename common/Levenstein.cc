@@ -1,15 +1,64 @@
 #include "common/Levenstein.h"
 #include "common/common.h"
+#include <array>
 #include <vector>
 
 using namespace std;
 
+namespace {
+
+// Myers' bit-parallel algorithm, in the formulation from Hyyrö, "Explaining and extending the bit-parallel approximate
+// string matching algorithm of Myers" (2001): the column of the DP matrix for `pattern` is kept as bit vectors of its
+// vertical deltas, so that every character of `text` costs a handful of word operations instead of a pass over the
+// column. `pattern` must not be longer than 64 bytes.
+int myersDistance(string_view pattern, string_view text, int bound) {
+    // Bit `i` of entry `c` is set when `pattern[i] == c`. Every entry is zero between calls.
+    thread_local array<uint64_t, 256> peq{};
+
+    const int m = pattern.size();
+    const int n = text.size();
+    for (int i = 0; i < m; i++) {
+        peq[(unsigned char)pattern[i]] |= uint64_t(1) << i;
+    }
+
+    const uint64_t last = uint64_t(1) << (m - 1);
+    uint64_t pv = ~uint64_t(0);
+    uint64_t mv = 0;
+    int score = m;
+    for (int j = 0; j < n; j++) {
+        const uint64_t eq = peq[(unsigned char)text[j]];
+        const uint64_t xv = eq | mv;
+        const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if ((ph & last) != 0) {
+            score++;
+        } else if ((mh & last) != 0) {
+            score--;
+        }
+        // Each remaining character can lower the score by at most one.
+        if (score - (n - j - 1) > bound) {
+            score = INT_MAX;
+            break;
+        }
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+
+    for (int i = 0; i < m; i++) {
+        peq[(unsigned char)pattern[i]] = 0;
+    }
+    return score;
+}
+
+} // namespace
+
 int sorbet::Levenstein::distance(string_view s1, string_view s2, int bound) noexcept {
     if (s1.data() == s2.data() && s1.size() == s2.size()) {
         return 0;
     }
-    // A mildly tweaked version from
-    // https://en.wikibooks.org/wiki/Algorithm_Implementation/Strings/Levenshtein_distance#C++
     int s1len = s1.size();
     int s2len = s2.size();
     if (s2len < s1len) {
@@ -20,19 +69,33 @@ int sorbet::Levenstein::distance(string_view s1, string_view s2, int bound) noex
     if (s2len - s1len > bound) {
         return INT_MAX;
     }
+    if (s1len == 0) {
+        return s2len;
+    }
+    if (s1len <= 64) {
+        return myersDistance(s1, s2, bound);
+    }
 
+    // A mildly tweaked version from
+    // https://en.wikibooks.org/wiki/Algorithm_Implementation/Strings/Levenshtein_distance#C++
     vector<int> column(s1len + 1);
     absl::c_iota(column, 0);
 
     for (int x = 1; x <= s2len; x++) {
         column[0] = x;
         int lastDiagonal = x - 1;
+        int columnMin = column[0];
         for (auto y = 1; y <= s1len; y++) {
             int oldDiagonal = column[y];
             auto possibilities = {column[y] + 1, column[y - 1] + 1, lastDiagonal + (s1[y - 1] == s2[x - 1] ? 0 : 1)};
             column[y] = min(possibilities);
+            columnMin = min(columnMin, column[y]);
             lastDiagonal = oldDiagonal;
         }
+        // The minimum of a column never exceeds that of the next one.
+        if (columnMin > bound) {
+            return INT_MAX;
+        }
     }
     int result = column[s1len];
     return result;
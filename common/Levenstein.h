@@ -6,6 +6,7 @@ namespace sorbet {
 
 class Levenstein {
 public:
+    // The edit distance between `s1` and `s2`, or INT_MAX once it is known to be greater than `bound`.
     static int distance(std::string_view s1, std::string_view s2, int bound) noexcept;
 };
 
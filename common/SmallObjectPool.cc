@@ -0,0 +1,124 @@
+#include "common/SmallObjectPool.h"
+#include "common/common.h"
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+using namespace std;
+
+namespace sorbet {
+
+namespace {
+constexpr size_t ALIGNMENT = alignof(max_align_t);
+constexpr size_t SIZE_CLASSES = SmallObjectPool::MAX_SIZE / ALIGNMENT;
+constexpr size_t SLAB_SIZE = 64 * 1024;
+
+atomic<size_t> allSlabBytes{0};
+
+struct FreeObject {
+    FreeObject *next;
+};
+
+size_t sizeClassOf(size_t size) {
+    return (size + ALIGNMENT - 1) / ALIGNMENT - 1;
+}
+
+// Free lists of threads that have exited, for the remaining ones to adopt.
+struct OrphanedObjects {
+    mutex mtx;
+    array<FreeObject *, SIZE_CLASSES> freeLists{};
+    // Checked without taking `mtx`: whether any of `freeLists` might be non-empty.
+    atomic<bool> any{false};
+};
+
+OrphanedObjects &orphans() {
+    // Leaked, so that it outlives the thread-local pools of every thread, including the main one.
+    static auto *orphans = new OrphanedObjects();
+    return *orphans;
+}
+
+class ThreadPool final {
+    array<FreeObject *, SIZE_CLASSES> freeLists{};
+    char *slabNext = nullptr;
+    char *slabEnd = nullptr;
+
+    bool adoptOrphans(size_t sizeClass) {
+        auto &orphaned = orphans();
+        if (!orphaned.any.load(memory_order_relaxed)) {
+            return false;
+        }
+        unique_lock<mutex> lock(orphaned.mtx);
+        freeLists[sizeClass] = orphaned.freeLists[sizeClass];
+        orphaned.freeLists[sizeClass] = nullptr;
+        orphaned.any = absl::c_any_of(orphaned.freeLists, [](auto *list) { return list != nullptr; });
+        return freeLists[sizeClass] != nullptr;
+    }
+
+public:
+    ~ThreadPool() {
+        auto &orphaned = orphans();
+        unique_lock<mutex> lock(orphaned.mtx);
+        for (size_t sizeClass = 0; sizeClass < SIZE_CLASSES; sizeClass++) {
+            while (auto *object = freeLists[sizeClass]) {
+                freeLists[sizeClass] = object->next;
+                object->next = orphaned.freeLists[sizeClass];
+                orphaned.freeLists[sizeClass] = object;
+                orphaned.any = true;
+            }
+        }
+        // The rest of the current slab is lost, which is at most one object's worth of every size class.
+    }
+
+    void *allocate(size_t sizeClass) {
+        auto *object = freeLists[sizeClass];
+        if (object != nullptr || adoptOrphans(sizeClass)) {
+            object = freeLists[sizeClass];
+            freeLists[sizeClass] = object->next;
+            return object;
+        }
+        auto size = (sizeClass + 1) * ALIGNMENT;
+        if (static_cast<size_t>(slabEnd - slabNext) < size) {
+            slabNext = static_cast<char *>(::operator new(SLAB_SIZE));
+            slabEnd = slabNext + SLAB_SIZE;
+            allSlabBytes.fetch_add(SLAB_SIZE, memory_order_relaxed);
+        }
+        auto *result = slabNext;
+        slabNext += size;
+        return result;
+    }
+
+    void deallocate(void *ptr, size_t sizeClass) {
+        auto *object = static_cast<FreeObject *>(ptr);
+        object->next = freeLists[sizeClass];
+        freeLists[sizeClass] = object;
+    }
+};
+
+thread_local ThreadPool threadPool;
+} // namespace
+
+void *SmallObjectPool::allocate(size_t size) {
+#ifndef HAS_SANITIZER
+    if (size <= MAX_SIZE) {
+        return threadPool.allocate(sizeClassOf(size));
+    }
+#endif
+    return ::operator new(size);
+}
+
+void SmallObjectPool::deallocate(void *ptr, size_t size) noexcept {
+#ifndef HAS_SANITIZER
+    if (size <= MAX_SIZE) {
+        threadPool.deallocate(ptr, sizeClassOf(size));
+        return;
+    }
+#endif
+    ::operator delete(ptr);
+}
+
+size_t SmallObjectPool::slabBytes() {
+    return allSlabBytes.load(memory_order_relaxed);
+}
+
+} // namespace sorbet
@@ -0,0 +1,29 @@
+#ifndef SORBET_SMALLOBJECTPOOL_H
+#define SORBET_SMALLOBJECTPOOL_H
+#include <cstddef>
+
+namespace sorbet {
+
+/**
+ * Memory for small objects that are allocated and freed by the million, like AST nodes. Every thread carves objects
+ * out of large slabs by bumping a pointer, and keeps freed objects on one free list per size for reuse, so neither
+ * allocating nor freeing takes a lock or goes to malloc. Objects may be freed on another thread than the one that
+ * allocated them. Slabs are never returned to malloc; what a thread freed is handed to other threads when it exits.
+ *
+ * Sizes above MAX_SIZE, and all sizes in sanitizer builds (so that they keep catching use-after-free), go to
+ * `::operator new` instead.
+ */
+class SmallObjectPool final {
+public:
+    static constexpr size_t MAX_SIZE = 256;
+
+    static void *allocate(size_t size);
+    // `size` must be the one passed to `allocate`.
+    static void deallocate(void *ptr, size_t size) noexcept;
+    // Bytes of slabs taken from malloc so far, by all threads. Since slabs are never returned, this includes the
+    // objects that were freed but are kept for reuse.
+    static size_t slabBytes();
+};
+
+} // namespace sorbet
+#endif // SORBET_SMALLOBJECTPOOL_H
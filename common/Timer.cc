@@ -37,6 +37,7 @@ FlowId Timer::getFlowEdge() {
 Timer::~Timer() {
     auto clock = chrono::steady_clock::now();
     auto dur = clock - start;
+    sorbet::latencyAdd(this->name, dur);
     if (dur > std::chrono::milliseconds(1)) {
         // the trick ^^^ is to skip double comparison in the common case and use the most efficient represnetation.
         auto dur = std::chrono::duration<double, std::milli>(clock - start);
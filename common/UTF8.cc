@@ -0,0 +1,91 @@
+#include "common/UTF8.h"
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t HIGH_BITS = 0x8080808080808080ULL;
+
+// The number of leading bytes of `s`, starting at `from`, that are ASCII. Source files are nearly all ASCII, so this
+// looks at a word at a time and only stops at the word that holds the first byte with its high bit set.
+size_t asciiPrefix(string_view s, size_t from) {
+    auto i = from;
+    const auto *data = s.data();
+    for (; i + sizeof(uint64_t) <= s.size(); i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        if ((word & HIGH_BITS) != 0) {
+            break;
+        }
+    }
+    while (i < s.size() && (static_cast<unsigned char>(data[i]) & 0x80) == 0) {
+        i++;
+    }
+    return i;
+}
+
+// The length of the well-formed multi-byte sequence at `s[i]`, or 0 if there is none. The ranges of the second byte
+// are the ones from Table 3-7 of the Unicode standard, which is what rules out overlongs, surrogates and code points
+// past U+10FFFF; every other continuation byte is in 0x80..0xBF.
+int sequenceLength(string_view s, size_t i) {
+    auto byte = [&](size_t at) -> unsigned int { return at < s.size() ? static_cast<unsigned char>(s[at]) : 0; };
+    auto lead = byte(i);
+    int len;
+    unsigned int lo = 0x80, hi = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        len = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        len = 3;
+        if (lead == 0xE0) {
+            lo = 0xA0;
+        } else if (lead == 0xED) {
+            hi = 0x9F;
+        }
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        len = 4;
+        if (lead == 0xF0) {
+            lo = 0x90;
+        } else if (lead == 0xF4) {
+            hi = 0x8F;
+        }
+    } else {
+        return 0;
+    }
+    auto second = byte(i + 1);
+    if (second < lo || second > hi) {
+        return 0;
+    }
+    for (int k = 2; k < len; k++) {
+        if ((byte(i + k) & 0xC0) != 0x80) {
+            return 0;
+        }
+    }
+    return len;
+}
+
+} // namespace
+
+namespace sorbet {
+
+size_t UTF8::firstInvalid(string_view s) noexcept {
+    size_t i = 0;
+    while (true) {
+        i = asciiPrefix(s, i);
+        if (i == s.size()) {
+            return i;
+        }
+        auto len = sequenceLength(s, i);
+        if (len == 0) {
+            return i;
+        }
+        i += len;
+    }
+}
+
+bool UTF8::isAscii(string_view s) noexcept {
+    return asciiPrefix(s, 0) == s.size();
+}
+
+} // namespace sorbet
@@ -0,0 +1,21 @@
+#ifndef SORBET_UTF8_H
+#define SORBET_UTF8_H
+#include <string_view>
+
+namespace sorbet {
+
+class UTF8 {
+public:
+    // The offset of the first byte of `s` that doesn't start a well-formed UTF-8 sequence, or `s.size()` when all of
+    // `s` is well-formed. Overlong encodings, surrogates and code points above U+10FFFF are not well-formed.
+    static size_t firstInvalid(std::string_view s) noexcept;
+
+    static bool isValid(std::string_view s) noexcept {
+        return firstInvalid(s) == s.size();
+    }
+
+    static bool isAscii(std::string_view s) noexcept;
+};
+
+} // namespace sorbet
+#endif // SORBET_UTF8_H
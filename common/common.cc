@@ -1,4 +1,5 @@
 #include "common/common.h"
+#include "absl/synchronization/mutex.h"
 #include "common/Exception.h"
 #include "common/FileOps.h"
 #include "os/os.h"
@@ -10,7 +11,11 @@
 #include <cxxabi.h>
 #include <dirent.h>
 #include <exception>
+#include <fcntl.h>
+#include <functional>
 #include <memory>
+#include <thread>
+#include <unistd.h>
 #include <vector>
 
 using namespace std;
@@ -49,6 +54,45 @@ string sorbet::FileOps::read(string_view filename) {
     throw sorbet::FileNotFoundException();
 }
 
+string sorbet::FileOps::readOrHead(string_view filename, size_t headBytes,
+                                   const function<bool(string_view)> &skipRest) {
+    FILE *fp = std::fopen((string(filename)).c_str(), "rb");
+    if (fp) {
+        string contents;
+        fseek(fp, 0, SEEK_END);
+        size_t size = ftell(fp);
+        rewind(fp);
+        contents.resize(min(size, headBytes));
+        auto readBytes = fread(&contents[0], 1, contents.size(), fp);
+        if (readBytes == contents.size() && size > headBytes) {
+            if (skipRest(contents)) {
+                fclose(fp);
+                return contents;
+            }
+            contents.resize(size);
+            readBytes += fread(&contents[headBytes], 1, size - headBytes, fp);
+        }
+        fclose(fp);
+        if (readBytes != contents.size()) {
+            // Error reading file?
+            throw sorbet::FileNotFoundException();
+        }
+        return contents;
+    }
+    throw sorbet::FileNotFoundException();
+}
+
+void sorbet::FileOps::prefetch(string_view filename) {
+#ifdef __linux__
+    int fd = open(string(filename).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+#endif
+}
+
 void sorbet::FileOps::write(string_view filename, const vector<sorbet::u1> &data) {
     FILE *fp = std::fopen(string(filename).c_str(), "wb");
     if (fp) {
@@ -89,7 +133,11 @@ void sorbet::FileOps::write(string_view filename, string_view text) {
 }
 
 bool sorbet::FileOps::writeIfDifferent(string_view filename, string_view text) {
-    if (!exists(filename) || text != read(filename)) {
+    // Contents of a different size can't be the same, so a single stat settles most changed files without reading
+    // them. Unchanged files are left alone, mtime included, so that tools watching them don't see a change.
+    struct stat buffer;
+    if (stat(string(filename).c_str(), &buffer) != 0 || buffer.st_size != (off_t)text.size() ||
+        text != read(filename)) {
         write(filename, text);
         return true;
     }
@@ -120,6 +168,10 @@ string_view sorbet::FileOps::getExtension(string_view path) {
 }
 
 int sorbet::FileOps::readFd(int fd, std::vector<char> &output, int timeoutMs) {
+    return readFd(fd, output.data(), output.size(), timeoutMs);
+}
+
+int sorbet::FileOps::readFd(int fd, char *output, size_t size, int timeoutMs) {
     // Prepare to use select()
     fd_set set;
     FD_ZERO(&set);
@@ -138,7 +190,7 @@ int sorbet::FileOps::readFd(int fd, std::vector<char> &output, int timeoutMs) {
         // A timeout occurred.
         return 0;
     } else {
-        auto read = ::read(fd, output.data(), output.size());
+        auto read = ::read(fd, output, size);
         if (read == 0) {
             throw sorbet::FileReadException("EOF");
         } else if (read < 0) {
@@ -227,51 +279,191 @@ bool sorbet::FileOps::isFileIgnored(string_view basePath, string_view filePath,
     return false;
 }
 
-void appendFilesInDir(string_view basePath, string_view path, const sorbet::UnorderedSet<string> &extensions,
-                      bool recursive, vector<string> &result, const std::vector<std::string> &absoluteIgnorePatterns,
-                      const std::vector<std::string> &relativeIgnorePatterns) {
-    DIR *dir;
-    struct dirent *entry;
-
-    if ((dir = opendir(string(path).c_str())) == nullptr) {
-        switch (errno) {
-            case ENOTDIR:
-                throw sorbet::FileNotDirException();
-            default:
-                // Mirrors other FileOps functions: Assume other errors are from FileNotFound.
-                throw sorbet::FileNotFoundException();
+namespace {
+// The ignore patterns, compiled once for a crawl. The crawl only checks a path once the directory it is in has passed
+// the check, so a pattern can only match a path by ending where the path ends: an absolute pattern then matches iff it
+// is the whole path, and a relative one iff it is one of the path's suffixes that start at a '/'. Each check is a few
+// hash lookups, rather than a search of the path for every pattern.
+class IgnoreMatcher {
+    sorbet::UnorderedSet<string_view> absolute;
+    sorbet::UnorderedSet<string_view> relative;
+    size_t maxRelativeLength = 0;
+    // Patterns that don't start with a '/' (which `sorbet::options` never makes) can match in the middle of a name, so
+    // they are left to `FileOps::isFileIgnored`.
+    bool compiled = true;
+    const vector<string> &absoluteIgnorePatterns;
+    const vector<string> &relativeIgnorePatterns;
+
+public:
+    IgnoreMatcher(const vector<string> &absoluteIgnorePatterns, const vector<string> &relativeIgnorePatterns)
+        : absoluteIgnorePatterns(absoluteIgnorePatterns), relativeIgnorePatterns(relativeIgnorePatterns) {
+        for (auto &p : absoluteIgnorePatterns) {
+            compiled = compiled && !p.empty() && p[0] == '/';
+            absolute.insert(p);
+        }
+        for (auto &p : relativeIgnorePatterns) {
+            compiled = compiled && !p.empty() && p[0] == '/';
+            relative.insert(p);
+            maxRelativeLength = max(maxRelativeLength, p.size());
         }
     }
 
-    while ((entry = readdir(dir)) != nullptr) {
-        auto fullPath = fmt::format("{}/{}", path, entry->d_name);
-        if (sorbet::FileOps::isFileIgnored(basePath, fullPath, absoluteIgnorePatterns, relativeIgnorePatterns)) {
-            continue;
-        } else if (entry->d_type == DT_DIR) {
-            if (!recursive || strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-                continue;
+    // `fullPath` is in `basePath`, and the directory it is in isn't ignored.
+    bool isIgnored(string_view basePath, string_view fullPath) const {
+        if (!compiled) {
+            return sorbet::FileOps::isFileIgnored(basePath, fullPath, absoluteIgnorePatterns, relativeIgnorePatterns);
+        }
+        auto relativePath = fullPath.substr(basePath.length());
+        if (absolute.contains(relativePath)) {
+            return true;
+        }
+        for (auto pos = relativePath.rfind('/'); pos != string_view::npos; pos = relativePath.rfind('/', pos - 1)) {
+            auto suffix = relativePath.substr(pos);
+            if (suffix.length() > maxRelativeLength) {
+                break;
             }
-            appendFilesInDir(basePath, fullPath, extensions, recursive, result, absoluteIgnorePatterns,
-                             relativeIgnorePatterns);
-        } else {
-            auto dotLocation = fullPath.rfind('.');
-            // Note: Can't call substr with an index > string length, so explicitly check if a dot isn't found.
-            if (dotLocation != string::npos) {
-                auto ext = fullPath.substr(dotLocation);
-                if (extensions.find(ext) != extensions.end()) {
-                    result.emplace_back(fullPath);
+            if (relative.contains(suffix)) {
+                return true;
+            }
+            if (pos == 0) {
+                break;
+            }
+        }
+        return false;
+    }
+};
+
+// Crawling is mostly waiting on the file system (and on network file systems, mostly waiting on the network), so a few
+// threads listing directories at once find files much faster than one. The crawl can't use a `WorkerPool`, which is
+// built on top of this library.
+constexpr int MAX_CRAWL_THREADS = 8;
+
+class DirectoryCrawl {
+    const string_view basePath;
+    const sorbet::UnorderedSet<string> &extensions;
+    const bool recursive;
+    const IgnoreMatcher ignore;
+
+    absl::Mutex mtx;
+    // Directories found that no thread has listed yet.
+    vector<string> pending GUARDED_BY(mtx);
+    // How many threads are listing a directory, and so could add to `pending`.
+    int listing GUARDED_BY(mtx) = 0;
+    // The first error the crawl ran into. Once there is one, the crawl stops.
+    exception_ptr error GUARDED_BY(mtx);
+    vector<string> result GUARDED_BY(mtx);
+
+    // Lists one directory, returning the directories in it to crawl next.
+    vector<string> listDir(const string &path, vector<string> &files) const {
+        DIR *dir;
+        struct dirent *entry;
+
+        if ((dir = opendir(path.c_str())) == nullptr) {
+            switch (errno) {
+                case ENOTDIR:
+                    throw sorbet::FileNotDirException();
+                default:
+                    // Mirrors other FileOps functions: Assume other errors are from FileNotFound.
+                    throw sorbet::FileNotFoundException();
+            }
+        }
+
+        vector<string> dirs;
+        while ((entry = readdir(dir)) != nullptr) {
+            auto fullPath = fmt::format("{}/{}", path, entry->d_name);
+            if (ignore.isIgnored(basePath, fullPath)) {
+                continue;
+            } else if (entry->d_type == DT_DIR) {
+                if (!recursive || strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+                    continue;
+                }
+                dirs.emplace_back(move(fullPath));
+            } else {
+                auto dotLocation = fullPath.rfind('.');
+                // Note: Can't call substr with an index > string length, so explicitly check if a dot isn't found.
+                if (dotLocation != string::npos) {
+                    auto ext = fullPath.substr(dotLocation);
+                    if (extensions.find(ext) != extensions.end()) {
+                        files.emplace_back(move(fullPath));
+                    }
                 }
             }
         }
+        closedir(dir);
+        return dirs;
     }
-    closedir(dir);
-}
+
+    void crawl() {
+        vector<string> files;
+        absl::MutexLock lck(&mtx);
+        while (true) {
+            mtx.Await(absl::Condition(
+                +[](DirectoryCrawl *crawl) -> bool {
+                    return !crawl->pending.empty() || crawl->listing == 0 || crawl->error != nullptr;
+                },
+                this));
+            if (pending.empty() || error != nullptr) {
+                break;
+            }
+            auto path = move(pending.back());
+            pending.pop_back();
+            listing++;
+            mtx.Unlock();
+            vector<string> dirs;
+            exception_ptr listError;
+            try {
+                dirs = listDir(path, files);
+            } catch (...) {
+                listError = current_exception();
+            }
+            mtx.Lock();
+            listing--;
+            if (listError != nullptr && error == nullptr) {
+                error = listError;
+            }
+            move(dirs.begin(), dirs.end(), back_inserter(pending));
+        }
+        move(files.begin(), files.end(), back_inserter(result));
+    }
+
+public:
+    DirectoryCrawl(string_view basePath, const sorbet::UnorderedSet<string> &extensions, bool recursive,
+                   const vector<string> &absoluteIgnorePatterns, const vector<string> &relativeIgnorePatterns)
+        : basePath(basePath), extensions(extensions), recursive(recursive),
+          ignore(absoluteIgnorePatterns, relativeIgnorePatterns) {}
+
+    vector<string> run() {
+        // The first directory is listed on this thread, so that a path that isn't a directory throws before any
+        // threads are started, and a crawl that doesn't recurse never starts any.
+        vector<string> files;
+        auto dirs = listDir(string(basePath), files);
+        {
+            absl::MutexLock lck(&mtx);
+            result = move(files);
+            pending = move(dirs);
+        }
+        {
+            vector<unique_ptr<Joinable>> threads;
+            auto threadCount = min(MAX_CRAWL_THREADS, max(1, (int)thread::hardware_concurrency()));
+            for (int i = 1; i < threadCount && recursive; i++) {
+                threads.emplace_back(runInAThread("crawlDirs", [this]() { crawl(); }));
+            }
+            crawl();
+            // Destroying the threads joins them.
+        }
+        absl::MutexLock lck(&mtx);
+        if (error != nullptr) {
+            rethrow_exception(error);
+        }
+        return move(result);
+    }
+};
+} // namespace
 
 vector<string> sorbet::FileOps::listFilesInDir(string_view path, const UnorderedSet<string> &extensions, bool recursive,
                                                const std::vector<std::string> &absoluteIgnorePatterns,
                                                const std::vector<std::string> &relativeIgnorePatterns) {
-    vector<string> result;
-    appendFilesInDir(path, path, extensions, recursive, result, absoluteIgnorePatterns, relativeIgnorePatterns);
+    auto result = DirectoryCrawl(path, extensions, recursive, absoluteIgnorePatterns, relativeIgnorePatterns).run();
     fast_sort(result);
     return result;
 }
@@ -11,8 +11,11 @@
 #include "blockingconcurrentqueue.h"
 #include "common/Timer.h"
 #include "common/common.h"
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <iterator>
+#include <vector>
 
 struct DequeueResult {
     bool returned;
@@ -25,6 +28,16 @@ struct DequeueResult {
     }
 };
 
+/**
+ * What the current thread has done with any AbstractConcurrentBoundedQueue so far. WorkerPool reads these before and
+ * after running a multiplexed job to tell how many items each worker processed and how long it was blocked.
+ */
+struct ConcurrentQueueThreadStats {
+    uint64_t pops = 0;
+    std::chrono::nanoseconds waited{0};
+};
+inline thread_local ConcurrentQueueThreadStats concurrentQueueThreadStats;
+
 /* A thread safe lock free queue that has safe publication guarantees, that is only used to process N elements */
 template <class Elem, class Queue> class AbstractConcurrentBoundedQueue {
     Queue _queue;
@@ -43,12 +56,40 @@ public:
         ENFORCE(elementsLeftToPush.load(std::memory_order_relaxed) >= 0);
     }
 
+    // Pushes all of `elems` at once, each counting as one element.
+    inline void push_bulk(std::vector<Elem> &&elems) noexcept {
+        _queue.enqueue_bulk(std::make_move_iterator(elems.begin()), elems.size());
+        elementsLeftToPush.fetch_add(-(int)elems.size(), std::memory_order_release);
+        ENFORCE(elementsLeftToPush.load(std::memory_order_relaxed) >= 0);
+        elems.clear();
+    }
+
+    // Like `try_pop`, but replaces the contents of `elems` with up to `max` elements. It got an item if it got any.
+    inline DequeueResult try_pop_bulk(std::vector<Elem> &elems, size_t max) noexcept {
+        elems.clear();
+        DequeueResult ret;
+        ret.shouldRetry = elementsLeftToPush.load(std::memory_order_acquire) != 0;
+        auto popped = _queue.try_dequeue_bulk(std::back_inserter(elems), max);
+        ret.returned = popped > 0;
+        elementsPopped.fetch_add(popped, std::memory_order_relaxed);
+        concurrentQueueThreadStats.pops += popped;
+        return ret;
+    }
+
+    // How many elements to claim at once with `try_pop_bulk`: at most `max`, and fewer as the queue empties, so that
+    // the consumers still finish at about the same time. Chunks only pay off when each element is quick to process.
+    inline size_t chunkSize(size_t max) noexcept {
+        size_t left = std::max(0, bound - elementsPopped.load(std::memory_order_relaxed));
+        return std::clamp<size_t>(left / 64, 1, max);
+    }
+
     inline DequeueResult try_pop(Elem &elem) noexcept {
         DequeueResult ret;
         ret.shouldRetry = elementsLeftToPush.load(std::memory_order_acquire) != 0;
         ret.returned = _queue.try_dequeue(elem);
         if (ret.returned) {
             elementsPopped.fetch_add(1, std::memory_order_relaxed);
+            concurrentQueueThreadStats.pops++;
         }
         return ret;
     }
@@ -61,12 +102,15 @@ public:
             ret.shouldRetry = elementsLeftToPush.load(std::memory_order_acquire) != 0;
             if (ret.shouldRetry) {
                 sorbet::Timer time(log, "wait_pop_timed");
+                auto start = std::chrono::steady_clock::now();
                 ret.returned = _queue.wait_dequeue_timed(elem, timeout);
+                concurrentQueueThreadStats.waited += std::chrono::steady_clock::now() - start;
             } else { // all elements has been pushed, no need to wait.
                 ret.returned = _queue.try_dequeue(elem);
             }
             if (ret.returned) {
                 elementsPopped.fetch_add(1, std::memory_order_relaxed);
+                concurrentQueueThreadStats.pops++;
             }
             return ret;
         }
@@ -1,8 +1,11 @@
 #ifndef SORBET_WORKERPOOL_H
 #define SORBET_WORKERPOOL_H
 
+#include "absl/synchronization/mutex.h"
+#include "common/ConstExprStr.h"
 #include "common/common.h"
 #include "spdlog/spdlog.h"
+#include <atomic>
 namespace spd = spdlog;
 namespace sorbet {
 class WorkerPool {
@@ -12,8 +15,36 @@ public:
         return 250ms;
     }
     typedef std::function<void()> Task;
-    static std::unique_ptr<WorkerPool> create(int size, spd::logger &logger);
-    virtual void multiplexJob(std::string_view taskName, Task t) = 0;
+
+    /**
+     * Tracks a set of tasks handed to `submit`, so that they can be waited on as a unit with `wait`.
+     * A TaskGroup must outlive all the tasks submitted to it; `wait` on it before it goes out of scope.
+     */
+    class TaskGroup {
+        friend class WorkerPoolImpl;
+        absl::Mutex mtx;
+        int pending = 0; // guarded by mtx
+
+    public:
+        TaskGroup() = default;
+        TaskGroup(const TaskGroup &) = delete;
+        TaskGroup &operator=(const TaskGroup &) = delete;
+        ~TaskGroup();
+    };
+
+    // With `numaAware`, workers are spread over the NUMA nodes in contiguous runs, each bound to its node's cores and,
+    // when jemalloc is linked in, allocating from an arena its node shares, so that what a worker allocates is in its
+    // node's memory. Ignored on machines with only one node.
+    static std::unique_ptr<WorkerPool> create(int size, spd::logger &logger, bool numaAware = false);
+    // Runs `t` once on every worker thread. `t` is expected to pull work from a shared queue. Each thread's busy time,
+    // time blocked popping from a queue, and number of items popped are reported to the web tracer, and their totals to
+    // the `worker_pool.*` counters under `taskName`.
+    virtual void multiplexJob(ConstExprStr taskName, Task t) = 0;
+    // Schedules a single task. Tasks are picked up by idle workers, which steal from each other once their own queue
+    // is empty. Tasks may themselves `submit` and `wait`. With a pool of size 0 the task runs immediately.
+    virtual void submit(TaskGroup &group, Task t) = 0;
+    // Blocks until every task submitted to `group` has finished. The waiting thread runs pending tasks meanwhile.
+    virtual void wait(TaskGroup &group) = 0;
     virtual ~WorkerPool() = 0;
     WorkerPool() = default;
     WorkerPool(WorkerPool &) = delete;
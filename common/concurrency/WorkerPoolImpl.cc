@@ -1,25 +1,129 @@
 #include "common/concurrency/WorkerPoolImpl.h"
 #include "absl/strings/str_cat.h"
+#include "common/Counters.h"
+#include "common/concurrency/ConcurrentQueue.h"
 #include "common/concurrency/WorkerPool.h"
 
+#ifdef __linux__
+// Provided by jemalloc, when it is linked in.
+extern "C" int mallctl(const char *name, void *oldp, size_t *oldlenp, void *newp, size_t newlen)
+    __attribute__((weak));
+#endif
+
 using namespace std;
 namespace sorbet {
-unique_ptr<WorkerPool> WorkerPool::create(int size, spd::logger &logger) {
-    return make_unique<WorkerPoolImpl>(size, logger);
+namespace {
+// Which pool (if any) the current thread is a worker of, and its index in that pool.
+thread_local const WorkerPoolImpl *currentPool = nullptr;
+thread_local int currentWorker = -1;
+
+// How long a thread in `wait` sleeps before rechecking the steal queues for tasks it can help with.
+constexpr auto WAIT_HELP_INTERVAL = absl::Milliseconds(1);
+
+bool isZero(int *counter) {
+    return *counter == 0;
+}
+
+u8 toMillis(chrono::nanoseconds duration) {
+    return chrono::duration_cast<chrono::milliseconds>(duration).count();
+}
+
+// Shared by the copies of one multiplexed job that run on each worker.
+struct MultiplexStats {
+    const chrono::steady_clock::time_point enqueued = chrono::steady_clock::now();
+    atomic<int> running;
+    atomic<u8> busyNanos{0};
+    atomic<u8> items{0};
+
+    MultiplexStats(int threads) : running(threads) {}
+};
+
+// Runs one copy of a multiplexed job on the current thread. Every copy adds a span to the web tracer with how long it
+// was busy, how long it was blocked in `wait_pop_timed`, and how many items it popped; the last one to finish adds
+// the job's totals to the `worker_pool.*` counters, where idle time is everything that's not busy time in
+// `threads * span`, so it includes threads that finished early or started late.
+void runMultiplexed(ConstExprStr taskName, const WorkerPool::Task &t, MultiplexStats &stats, int threads) {
+    auto popsBefore = concurrentQueueThreadStats.pops;
+    auto waitedBefore = concurrentQueueThreadStats.waited;
+    auto start = chrono::steady_clock::now();
+    t();
+    auto end = chrono::steady_clock::now();
+    auto items = concurrentQueueThreadStats.pops - popsBefore;
+    auto waited = concurrentQueueThreadStats.waited - waitedBefore;
+    auto busy = chrono::duration_cast<chrono::nanoseconds>(end - start) - waited;
+
+    stats.busyNanos.fetch_add(busy.count());
+    stats.items.fetch_add(items);
+    timingAdd(taskName, start, end,
+              {{"busy_ms", to_string(toMillis(busy))}, {"wait_ms", to_string(toMillis(waited))},
+               {"items", to_string(items)}},
+              FlowId{0}, FlowId{0});
+
+    if (stats.running.fetch_sub(1) == 1) {
+        auto span = chrono::duration_cast<chrono::nanoseconds>(end - stats.enqueued);
+        auto totalBusy = chrono::nanoseconds(stats.busyNanos.load());
+        auto totalIdle = max(span * threads - totalBusy, chrono::nanoseconds(0));
+        prodCategoryCounterAdd("worker_pool.busy_ms", taskName, toMillis(totalBusy));
+        prodCategoryCounterAdd("worker_pool.idle_ms", taskName, toMillis(totalIdle));
+        prodCategoryCounterAdd("worker_pool.span_ms", taskName, toMillis(span));
+        prodCategoryCounterAdd("worker_pool.items", taskName, stats.items.load());
+    }
+}
+
+// Makes a new jemalloc arena, for the threads of one NUMA node to share. Its pages are first touched by those threads,
+// so the kernel places them in the node's memory.
+optional<unsigned> createArena() {
+#ifdef __linux__
+    unsigned arena;
+    size_t size = sizeof(arena);
+    if (mallctl != nullptr && mallctl("arenas.create", &arena, &size, nullptr, 0) == 0) {
+        return arena;
+    }
+#endif
+    return nullopt;
+}
+
+void useArena(unsigned arena) {
+#ifdef __linux__
+    mallctl("thread.arena", nullptr, nullptr, &arena, sizeof(arena));
+#endif
+}
+} // namespace
+
+unique_ptr<WorkerPool> WorkerPool::create(int size, spd::logger &logger, bool numaAware) {
+    return make_unique<WorkerPoolImpl>(size, logger, numaAware);
 }
 
 WorkerPool::~WorkerPool() {
     // see https://eli.thegreenplace.net/2010/11/13/pure-virtual-destructors-in-c
 }
 
-WorkerPoolImpl::WorkerPoolImpl(int size, spd::logger &logger) : size(size), logger(logger) {
+WorkerPool::TaskGroup::~TaskGroup() {
+    absl::MutexLock lck(&mtx);
+    ENFORCE(pending == 0, "TaskGroup destroyed without waiting for its tasks");
+}
+
+WorkerPoolImpl::WorkerPoolImpl(int size, spd::logger &logger, bool numaAware) : size(size), logger(logger) {
     logger.debug("Creating {} worker threads", size);
     if (sorbet::emscripten_build) {
         ENFORCE(size == 0);
         this->size = 0;
     } else {
-        bool pinThreads = (size > 0) && (size == thread::hardware_concurrency());
+        vector<vector<int>> nodes;
+        vector<optional<unsigned>> arenas;
+        if (numaAware && size > 0) {
+            nodes = numaNodeCores();
+            logger.debug("Spreading worker threads over {} NUMA nodes", nodes.size());
+            for (int node = 0; node < nodes.size(); node++) {
+                arenas.emplace_back(createArena());
+            }
+        }
+        bool pinThreads = nodes.empty() && (size > 0) && (size == thread::hardware_concurrency());
         threadQueues.reserve(size);
+        stealQueues.reserve(size + 1);
+        for (int i = 0; i < size + 1; i++) {
+            stealQueues.emplace_back(make_unique<StealQueue>());
+        }
         for (int i = 0; i < size; i++) {
             auto &last = threadQueues.emplace_back(make_unique<Queue>());
             auto *ptr = last.get();
@@ -28,9 +132,25 @@ WorkerPoolImpl::WorkerPoolImpl(int size, spd::logger &logger) : size(size), logg
             if (pinThreads) {
                 pinToCore = i;
             }
+            // Neighbouring workers share a node, since that's where `popTask` looks for work to steal first.
+            vector<int> nodeCores;
+            optional<unsigned> arena;
+            if (!nodes.empty()) {
+                auto node = (long)i * nodes.size() / size;
+                nodeCores = nodes[node];
+                arena = arenas[node];
+            }
             threads.emplace_back(runInAThread(
                 threadIdleName,
-                [ptr, &logger, threadIdleName]() {
+                [this, i, ptr, &logger, threadIdleName, nodeCores, arena]() {
+                    currentPool = this;
+                    currentWorker = i;
+                    if (!nodeCores.empty() && !bindThreadToCores(pthread_self(), nodeCores)) {
+                        logger.debug("Failed to bind worker thread to its NUMA node");
+                    }
+                    if (arena) {
+                        useArena(*arena);
+                    }
                     bool repeat = true;
                     while (repeat) {
                         Task_ task;
@@ -55,16 +175,20 @@ WorkerPoolImpl::~WorkerPoolImpl() {
     // join will be called when destructing joinable;
 }
 
-void WorkerPoolImpl::multiplexJob(string_view taskName, WorkerPool::Task t) {
+void WorkerPoolImpl::multiplexJob(ConstExprStr taskName, WorkerPool::Task t) {
     if (size > 0) {
-        multiplexJob_([t{move(t)}, taskName] {
-            setCurrentThreadName(taskName);
-            t();
+        auto stats = make_shared<MultiplexStats>(size);
+        multiplexJob_([t{move(t)}, taskName, stats, threads = size] {
+            setCurrentThreadName(string_view(taskName.str, taskName.size));
+            runMultiplexed(taskName, t, *stats, threads);
+            // The job has already handed its own counters back, so these would otherwise stay on this thread.
+            counterPublish(getAndClearThreadCounters());
             return true;
         });
     } else {
         // main thread is the worker.
-        t();
+        MultiplexStats stats(1);
+        runMultiplexed(taskName, t, stats, 1);
     }
 }
 
@@ -75,4 +199,108 @@ void WorkerPoolImpl::multiplexJob_(WorkerPoolImpl::Task_ t) {
     }
 }
 
+int WorkerPoolImpl::currentQueueIndex() const {
+    if (currentPool == this) {
+        return currentWorker;
+    }
+    return size;
+}
+
+bool WorkerPoolImpl::popTask(int queueIdx, SubmittedTask &out) {
+    {
+        auto &own = *stealQueues[queueIdx];
+        absl::MutexLock lck(&own.mtx);
+        if (!own.tasks.empty()) {
+            // Newest first from our own queue: it's the most likely to still be in cache, and for nested tasks it's
+            // the one the thread that spawned it is about to wait on.
+            out = move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (int i = 1; i < stealQueues.size(); i++) {
+        auto &victim = *stealQueues[(queueIdx + i) % stealQueues.size()];
+        absl::MutexLock lck(&victim.mtx);
+        if (!victim.tasks.empty()) {
+            // Oldest first when stealing, to take the biggest chunk of remaining work.
+            out = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPoolImpl::runTask(SubmittedTask &task) {
+    task.task();
+    task.task = nullptr;
+    absl::MutexLock lck(&task.group->mtx);
+    task.group->pending--;
+}
+
+void WorkerPoolImpl::drainStealQueues(int workerIdx) {
+    SubmittedTask task;
+    while (popTask(workerIdx, task)) {
+        runTask(task);
+    }
+}
+
+void WorkerPoolImpl::wakeWorker() {
+    // Hand a drain job to the first worker that doesn't already have one pending. If they all do, every worker will
+    // look at the steal queues soon anyways.
+    int start = nextToWake.fetch_add(1, memory_order_relaxed);
+    for (int i = 0; i < size; i++) {
+        int idx = (start + i) % size;
+        auto &stealQueue = *stealQueues[idx];
+        if (!stealQueue.drainScheduled.exchange(true)) {
+            threadQueues[idx]->enqueue([this, idx]() {
+                // Clear the flag before looking for work, so that a task submitted after we stop looking wakes us up.
+                stealQueues[idx]->drainScheduled.store(false);
+                drainStealQueues(idx);
+                return true;
+            });
+            return;
+        }
+    }
+}
+
+void WorkerPoolImpl::submit(TaskGroup &group, Task t) {
+    {
+        absl::MutexLock lck(&group.mtx);
+        group.pending++;
+    }
+    SubmittedTask task{move(t), &group};
+    if (size == 0) {
+        // main thread is the worker.
+        runTask(task);
+        return;
+    }
+    {
+        auto &queue = *stealQueues[currentQueueIndex()];
+        absl::MutexLock lck(&queue.mtx);
+        queue.tasks.emplace_back(move(task));
+    }
+    wakeWorker();
+}
+
+void WorkerPoolImpl::wait(TaskGroup &group) {
+    int queueIdx = currentQueueIndex();
+    while (true) {
+        {
+            absl::MutexLock lck(&group.mtx);
+            if (group.pending == 0) {
+                return;
+            }
+        }
+        SubmittedTask task;
+        if (popTask(queueIdx, task)) {
+            runTask(task);
+            continue;
+        }
+        // Nothing to help with; the remaining tasks are running on other threads.
+        group.mtx.LockWhenWithTimeout(absl::Condition(isZero, &group.pending), WAIT_HELP_INTERVAL);
+        group.mtx.Unlock();
+    }
+}
+
 }; // namespace sorbet
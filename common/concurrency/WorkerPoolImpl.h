@@ -5,6 +5,7 @@
 #include "common/concurrency/WorkerPool.h"
 #include "common/os/os.h"
 #include "spdlog/spdlog.h"
+#include <deque>
 #include <memory>
 #include <vector>
 namespace spd = spdlog;
@@ -78,18 +79,42 @@ class WorkerPoolImpl : public WorkerPool {
     };
     typedef std::function<bool()> Task_; // return value indicates if the worker should continie gathering jobs
     typedef moodycamel::BlockingConcurrentQueue<Task_, ConcurrentQueueCustomTraits> Queue;
+
+    struct SubmittedTask {
+        Task task;
+        TaskGroup *group;
+    };
+    // Tasks from `submit`. Each worker owns one deque, which it pops from the back of, and other threads steal from the
+    // front of. The last deque is for tasks submitted from outside of the pool.
+    struct StealQueue {
+        absl::Mutex mtx;
+        std::deque<SubmittedTask> tasks;
+        // Set while a `drainStealQueues` job is sitting in the worker's `threadQueues` entry, so we don't flood it.
+        std::atomic<bool> drainScheduled{false};
+    };
+
     // ORDER IS IMPORTANT. threads must be killed before Queues.
     std::vector<std::unique_ptr<Queue>> threadQueues;
+    std::vector<std::unique_ptr<StealQueue>> stealQueues;
     std::vector<std::unique_ptr<Joinable>> threads;
+    std::atomic<int> nextToWake{0};
     spd::logger &logger;
 
     void multiplexJob_(Task_ t);
+    // Index into `stealQueues` of the calling thread.
+    int currentQueueIndex() const;
+    bool popTask(int queueIdx, SubmittedTask &out);
+    void runTask(SubmittedTask &task);
+    void drainStealQueues(int workerIdx);
+    void wakeWorker();
 
 public:
-    WorkerPoolImpl(int size, spd::logger &logger);
+    WorkerPoolImpl(int size, spd::logger &logger, bool numaAware = false);
     ~WorkerPoolImpl();
 
-    void multiplexJob(std::string_view taskName, Task t) override;
+    void multiplexJob(ConstExprStr taskName, Task t) override;
+    void submit(TaskGroup &group, Task t) override;
+    void wait(TaskGroup &group) override;
 };
 };     // namespace sorbet
 #endif // SORBET_WORKERPOOL_IMPL_H
@@ -0,0 +1,68 @@
+#include "gtest/gtest.h"
+// violates our requirements, thus has to go first
+#include "common/Counters.h"
+#include "common/concurrency/ConcurrentQueue.h"
+#include "common/concurrency/WorkerPool.h"
+#include "spdlog/sinks/null_sink.h"
+#include <atomic>
+
+using namespace std;
+
+namespace sorbet {
+
+namespace {
+shared_ptr<spdlog::logger> nullLogger() {
+    static auto logger = make_shared<spdlog::logger>("null", make_shared<spdlog::sinks::null_sink_mt>());
+    return logger;
+}
+} // namespace
+
+TEST(WorkerPoolTest, SubmitRunsEveryTask) { // NOLINT
+    for (int size : {0, 1, 4}) {
+        auto workers = WorkerPool::create(size, *nullLogger());
+        atomic<int> done{0};
+        WorkerPool::TaskGroup group;
+        for (int i = 0; i < 1000; i++) {
+            workers->submit(group, [&done]() { done.fetch_add(1); });
+        }
+        workers->wait(group);
+        EXPECT_EQ(1000, done.load());
+    }
+}
+
+TEST(WorkerPoolTest, NestedSubmitAndWait) { // NOLINT
+    for (int size : {0, 2}) {
+        auto workers = WorkerPool::create(size, *nullLogger());
+        atomic<int> done{0};
+        WorkerPool::TaskGroup outer;
+        for (int i = 0; i < 16; i++) {
+            workers->submit(outer, [&workers, &done]() {
+                WorkerPool::TaskGroup inner;
+                for (int j = 0; j < 16; j++) {
+                    workers->submit(inner, [&done]() { done.fetch_add(1); });
+                }
+                workers->wait(inner);
+            });
+        }
+        workers->wait(outer);
+        EXPECT_EQ(16 * 16, done.load());
+    }
+}
+
+TEST(WorkerPoolTest, MultiplexJobCountsItems) { // NOLINT
+    getAndClearThreadCounters();
+    auto workers = WorkerPool::create(0, *nullLogger());
+    auto queue = make_shared<ConcurrentBoundedQueue<int>>(5);
+    for (int i = 0; i < 5; i++) {
+        queue->push(move(i), 1);
+    }
+    workers->multiplexJob("multiplexTest", [queue]() {
+        int item;
+        for (auto result = queue->try_pop(item); !result.done(); result = queue->try_pop(item)) {
+        }
+    });
+    auto stats = getCounterStatistics({"worker_pool.items"});
+    EXPECT_NE(string::npos, stats.find("multiplexTest :              5,"));
+}
+
+} // namespace sorbet
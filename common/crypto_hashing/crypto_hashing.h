@@ -24,5 +24,18 @@ inline std::array<u1, 64> hash64(std::string_view data) {
     ENFORCE(err == 0);
     return res;
 };
+
+// BLAKE2b with a 16 byte digest. Not a prefix of `hash64`: the digest length is part of what BLAKE2b hashes.
+inline std::array<u1, 16> hash16(std::string_view data) {
+    std::array<u1, 16> res;
+
+#ifndef EMSCRIPTEN
+    int err = blake2b(&res[0], data.begin(), nullptr, std::size(res), data.size(), 0);
+#else
+    int err = blake2b(&res[0], std::size(res), data.begin(), data.size(), nullptr, 0);
+#endif
+    ENFORCE(err == 0);
+    return res;
+};
 } // namespace sorbet::crypto_hashing
 #endif // RUBY_TYPER_CRYPTO_HASHING_H
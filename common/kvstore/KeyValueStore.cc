@@ -1,11 +1,20 @@
 #include "common/kvstore/KeyValueStore.h"
+#include "absl/strings/escaping.h"
+#include "common/Counters.h"
+#include "common/FileOps.h"
+#include "common/crypto_hashing/crypto_hashing.h"
 
+#include <atomic>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <utility>
 
 using namespace std;
 namespace sorbet {
 constexpr string_view OLD_VERSION_KEY = "VERSION"sv;
 constexpr string_view VERSION_KEY = "DB_FORMAT_VERSION"sv;
+constexpr string_view GENERATION_KEY = "RUN_GENERATION"sv;
 constexpr size_t MAX_DB_SIZE_BYTES =
     1L * 1024 * 1024 * 1024; // 1G. This is both maximum fs db size and max virtual memory usage.
 
@@ -14,8 +23,13 @@ static void throw_mdb_error(string_view what, int err) {
     throw invalid_argument(string(what));
 }
 
-KeyValueStore::KeyValueStore(string version, string path, string flavor)
-    : path(move(path)), flavor(move(flavor)), writerId(this_thread::get_id()) {
+namespace {
+atomic<u8> nextStoreId = 1;
+}
+
+KeyValueStore::KeyValueStore(string version, string path, string flavor, u4 maxUnusedRuns)
+    : id(nextStoreId++), path(move(path)), flavor(move(flavor)), writerId(this_thread::get_id()),
+      maxUnusedRuns(maxUnusedRuns) {
     int rc;
     rc = mdb_env_create(&env);
     if (rc != 0) {
@@ -25,7 +39,8 @@ KeyValueStore::KeyValueStore(string version, string path, string flavor)
     if (rc != 0) {
         goto fail;
     }
-    rc = mdb_env_set_maxdbs(env, 3);
+    // Each flavor has a database of entries, and one of the runs that last used them.
+    rc = mdb_env_set_maxdbs(env, 6);
     if (rc != 0) {
         goto fail;
     }
@@ -43,6 +58,7 @@ KeyValueStore::KeyValueStore(string version, string path, string flavor)
             clear();
             writeString(VERSION_KEY, version);
         }
+        generation = runGeneration();
         return;
     }
 fail:
@@ -74,44 +90,157 @@ void KeyValueStore::write(string_view key, const vector<u1> &value) {
     if (rc != 0) {
         throw invalid_argument("failed write into database");
     }
+    markUsed(key);
 }
 
-u1 *KeyValueStore::read(string_view key) {
-    MDB_txn *txn = nullptr;
-    int rc = 0;
-    {
-        absl::ReaderMutexLock lk(&readers_mtx);
-        auto fnd = readers.find(this_thread::get_id());
-        if (fnd != readers.end()) {
-            txn = fnd->second;
-            ENFORCE(txn != nullptr);
-        }
+MDB_txn *KeyValueStore::readTransaction() {
+    if (this_thread::get_id() == writerId) {
+        // Sees what this thread wrote and hasn't committed yet.
+        return txn;
     }
-    if (txn == nullptr) {
-        absl::WriterMutexLock lk(&readers_mtx);
-        auto &txn_store = readers[this_thread::get_id()];
-        ENFORCE(txn_store == nullptr);
-        rc = mdb_txn_begin(env, nullptr, MDB_RDONLY, &txn_store);
-        txn = txn_store;
+    // The read transaction of the store this thread last read from, so that reading again takes no lock. Stores are
+    // told apart by `id` rather than by address, which a later store can reuse.
+    struct ReadTransaction {
+        u8 storeId = 0;
+        MDB_txn *txn = nullptr;
+    };
+    thread_local ReadTransaction last;
+    if (last.storeId == id) {
+        return last.txn;
     }
-    if (rc != 0) {
-        throw_mdb_error("failed to create read transaction"sv, rc);
+    absl::MutexLock lk(&readers_mtx);
+    auto &txn_store = readers[this_thread::get_id()];
+    if (txn_store == nullptr) {
+        auto rc = mdb_txn_begin(env, nullptr, MDB_RDONLY, &txn_store);
+        if (rc != 0) {
+            readers.erase(this_thread::get_id());
+            throw_mdb_error("failed to create read transaction"sv, rc);
+        }
     }
+    last = {id, txn_store};
+    return txn_store;
+}
 
+u1 *KeyValueStore::read(string_view key) {
+    auto txn = readTransaction();
     MDB_val kv;
     kv.mv_size = key.size();
     kv.mv_data = (void *)key.data();
     MDB_val data;
-    rc = mdb_get(txn, dbi, &kv, &data);
+    auto rc = mdb_get(txn, dbi, &kv, &data);
     if (rc != 0) {
         if (rc == MDB_NOTFOUND) {
             return nullptr;
         }
         throw_mdb_error("failed read from the database"sv, rc);
     }
+    markUsed(key);
     return (u1 *)data.mv_data;
 }
 
+void KeyValueStore::markUsed(string_view key) {
+    if (maxUnusedRuns == 0) {
+        return;
+    }
+    absl::MutexLock lk(&used_mtx);
+    used.emplace(key);
+}
+
+u4 KeyValueStore::runGeneration() {
+    // Stores opened again later in the same process belong to the same run.
+    static absl::Mutex mtx;
+    static UnorderedMap<string, u4> generations;
+    absl::MutexLock lk(&mtx);
+    auto &result = generations[fmt::format("{}\n{}", path, flavor)];
+    if (result == 0) {
+        u4 last = 0;
+        if (auto raw = read(GENERATION_KEY)) {
+            memcpy(&last, raw, sizeof(last));
+        }
+        result = last + 1;
+        vector<u1> rawData(sizeof(result));
+        memcpy(rawData.data(), &result, sizeof(result));
+        write(GENERATION_KEY, rawData);
+        if (maxUnusedRuns != 0) {
+            // Before this run uses any, so that the runs counted are whole.
+            removeUnused(result);
+        }
+    }
+    return result;
+}
+
+void KeyValueStore::writeGenerations() {
+    UnorderedSet<string> usedKeys;
+    {
+        absl::MutexLock lk(&used_mtx);
+        swap(usedKeys, used);
+    }
+    MDB_val dv;
+    dv.mv_size = sizeof(generation);
+    dv.mv_data = &generation;
+    for (auto &key : usedKeys) {
+        MDB_val kv;
+        kv.mv_size = key.size();
+        kv.mv_data = (void *)key.data();
+        auto rc = mdb_put(txn, generationsDbi, &kv, &dv, 0);
+        if (rc != 0) {
+            throw_mdb_error("failed to write into the database"sv, rc);
+        }
+    }
+}
+
+void KeyValueStore::removeUnused(u4 currentGeneration) {
+    MDB_cursor *cursor;
+    auto rc = mdb_cursor_open(txn, dbi, &cursor);
+    if (rc != 0) {
+        throw_mdb_error("failed to open a cursor"sv, rc);
+    }
+    MDB_val genVal;
+    genVal.mv_size = sizeof(currentGeneration);
+    genVal.mv_data = &currentGeneration;
+    int removed = 0;
+    MDB_val kv;
+    MDB_val dv;
+    for (rc = mdb_cursor_get(cursor, &kv, &dv, MDB_FIRST); rc == 0; rc = mdb_cursor_get(cursor, &kv, &dv, MDB_NEXT)) {
+        // `kv` points into the database, which the writes below can move.
+        string key((const char *)kv.mv_data, kv.mv_size);
+        if (key == VERSION_KEY || key == GENERATION_KEY || key == OLD_VERSION_KEY) {
+            continue;
+        }
+        MDB_val keyVal;
+        keyVal.mv_size = key.size();
+        keyVal.mv_data = key.data();
+        MDB_val lastUsed;
+        rc = mdb_get(txn, generationsDbi, &keyVal, &lastUsed);
+        if (rc == MDB_NOTFOUND) {
+            // Written before runs were counted, so count from now.
+            rc = mdb_put(txn, generationsDbi, &keyVal, &genVal, 0);
+        } else if (rc == 0) {
+            u4 lastUsedGeneration;
+            memcpy(&lastUsedGeneration, lastUsed.mv_data, sizeof(lastUsedGeneration));
+            // None of the last `maxUnusedRuns` runs before this one used it.
+            if (currentGeneration - lastUsedGeneration > maxUnusedRuns) {
+                rc = mdb_cursor_del(cursor, 0);
+                if (rc == 0) {
+                    rc = mdb_del(txn, generationsDbi, &keyVal, nullptr);
+                }
+                removed++;
+            }
+        }
+        if (rc != 0) {
+            mdb_cursor_close(cursor);
+            throw_mdb_error("failed to remove unused entries"sv, rc);
+        }
+    }
+    mdb_cursor_close(cursor);
+    if (rc != MDB_NOTFOUND) {
+        throw_mdb_error("failed to remove unused entries"sv, rc);
+    }
+    if (removed > 0) {
+        prodCounterAdd("cache.unused_entries_removed", removed);
+    }
+}
+
 void KeyValueStore::clear() {
     if (writerId != this_thread::get_id()) {
         throw invalid_argument("KeyValueStore can only write from thread that created it");
@@ -120,6 +249,10 @@ void KeyValueStore::clear() {
     if (rc != 0) {
         goto fail;
     }
+    rc = mdb_drop(txn, generationsDbi, 0);
+    if (rc != 0) {
+        goto fail;
+    }
     rc = mdb_txn_commit(txn);
     if (rc != 0) {
         goto fail;
@@ -161,6 +294,10 @@ void KeyValueStore::refreshMainTransaction() {
     if (rc != 0) {
         goto fail;
     }
+    rc = mdb_dbi_open(txn, (flavor + ".generations").c_str(), MDB_CREATE, &generationsDbi);
+    if (rc != 0) {
+        goto fail;
+    }
     // Per the docs for mdb_dbi_open:
     //
     // The database handle will be private to the current transaction
@@ -181,17 +318,28 @@ void KeyValueStore::refreshMainTransaction() {
     if (rc != 0) {
         goto fail;
     }
-    {
-        absl::WriterMutexLock lk(&readers_mtx);
-        readers[writerId] = txn;
-    }
     return;
 fail:
     throw_mdb_error("failed to create transaction"sv, rc);
 }
 
+bool KeyValueStore::flush() {
+    if (writerId != this_thread::get_id()) {
+        throw invalid_argument("KeyValueStore can only write from thread that created it");
+    }
+    writeGenerations();
+    // The transaction is freed whether or not the commit succeeds.
+    bool flushed = mdb_txn_commit(txn) == 0;
+    auto rc = mdb_txn_begin(env, nullptr, 0, &txn);
+    if (rc != 0) {
+        throw_mdb_error("failed to create transaction"sv, rc);
+    }
+    return flushed;
+}
+
 bool KeyValueStore::commit(unique_ptr<KeyValueStore> k) {
     int rc;
+    k->writeGenerations();
     k->commited = true;
     rc = mdb_txn_commit(k->txn);
 
@@ -203,4 +351,101 @@ bool KeyValueStore::commit(unique_ptr<KeyValueStore> k) {
     return true;
 }
 
+namespace {
+// Writes a compacted copy of the database at `path` into the existing directory `toDir`.
+void copyCompacted(const string &path, const string &toDir) {
+    MDB_env *env;
+    auto rc = mdb_env_create(&env);
+    if (rc != 0) {
+        throw_mdb_error("failed to create database"sv, rc);
+    }
+    rc = mdb_env_set_mapsize(env, MAX_DB_SIZE_BYTES);
+    if (rc == 0) {
+        rc = mdb_env_set_maxdbs(env, 6);
+    }
+    if (rc == 0) {
+        rc = mdb_env_open(env, path.c_str(), 0, 0664);
+    }
+    if (rc == 0) {
+        rc = mdb_env_copy2(env, toDir.c_str(), MDB_CP_COMPACT);
+    }
+    mdb_env_close(env);
+    if (rc != 0) {
+        throw_mdb_error("failed to compact the database"sv, rc);
+    }
+}
+
+string sharedDatabasePath(const string &version, const string &sharedPath) {
+    auto versionHash = crypto_hashing::hash16(version);
+    return fmt::format("{}/{}.mdb", sharedPath,
+                       absl::BytesToHexString(string_view((const char *)versionHash.data(), versionHash.size())));
+}
+} // namespace
+
+void KeyValueStore::compact(const string &path) {
+    auto compactedPath = path + "/compacted";
+    if (mkdir(compactedPath.c_str(), 0775) != 0 && errno != EEXIST) {
+        throw_mdb_error("failed to create a directory for the compacted database"sv, errno);
+    }
+    copyCompacted(path, compactedPath);
+    if (rename((compactedPath + "/data.mdb").c_str(), (path + "/data.mdb").c_str()) != 0) {
+        throw_mdb_error("failed to replace the database with the compacted one"sv, errno);
+    }
+    rmdir(compactedPath.c_str());
+}
+
+bool KeyValueStore::seed(const string &version, const string &path, const string &sharedPath) {
+    auto localPath = path + "/data.mdb";
+    if (FileOps::exists(localPath)) {
+        return false;
+    }
+    FILE *from = fopen(sharedDatabasePath(version, sharedPath).c_str(), "rb");
+    if (from == nullptr) {
+        return false;
+    }
+    // Copied next to where it goes and renamed into place, so that a store opened meanwhile never sees a partial one.
+    auto copyPath = fmt::format("{}.{}", localPath, getpid());
+    FILE *to = fopen(copyPath.c_str(), "wb");
+    bool copied = to != nullptr;
+    vector<char> buffer(1 << 20);
+    while (copied) {
+        auto readBytes = fread(buffer.data(), 1, buffer.size(), from);
+        if (readBytes == 0) {
+            copied = ferror(from) == 0;
+            break;
+        }
+        copied = fwrite(buffer.data(), 1, readBytes, to) == readBytes;
+    }
+    fclose(from);
+    if (to != nullptr) {
+        copied = fclose(to) == 0 && copied;
+    }
+    copied = copied && rename(copyPath.c_str(), localPath.c_str()) == 0;
+    if (!copied) {
+        unlink(copyPath.c_str());
+    }
+    return copied;
+}
+
+void KeyValueStore::publish(const string &version, const string &path, const string &sharedPath) {
+    auto copyDir = sharedPath + "/publishing-XXXXXX";
+    if (mkdtemp(copyDir.data()) == nullptr) {
+        throw_mdb_error("failed to create a directory in the shared cache"sv, errno);
+    }
+    try {
+        copyCompacted(path, copyDir);
+    } catch (invalid_argument &) {
+        rmdir(copyDir.c_str());
+        throw;
+    }
+    // Renaming is atomic, so that runs seeding from the old database meanwhile still read all of it.
+    auto renamed = rename((copyDir + "/data.mdb").c_str(), sharedDatabasePath(version, sharedPath).c_str()) == 0;
+    auto err = errno;
+    unlink((copyDir + "/data.mdb").c_str());
+    rmdir(copyDir.c_str());
+    if (!renamed) {
+        throw_mdb_error("failed to store the database in the shared cache"sv, err);
+    }
+}
+
 } // namespace sorbet
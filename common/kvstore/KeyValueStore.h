@@ -14,16 +14,33 @@ namespace sorbet {
 class KeyValueStore {
     MDB_env *env;
     MDB_dbi dbi;
+    // The last run that used each entry of `dbi`.
+    MDB_dbi generationsDbi;
     MDB_txn *txn;
+    // Tells stores apart for the threads reading from them, see `readTransaction`.
+    const u8 id;
     const std::string path;
     const std::string flavor;
     const std::thread::id writerId;
-    UnorderedMap<std::thread::id, MDB_txn *> readers;
+    const u4 maxUnusedRuns;
+    // Which run this process is, of those that opened the store.
+    u4 generation = 0;
+    // The read transactions of the threads other than the writer, which each thread only looks up here on its first
+    // read.
+    UnorderedMap<std::thread::id, MDB_txn *> readers GUARDED_BY(readers_mtx);
     absl::Mutex readers_mtx;
+    // The entries read or written since the last commit, which are marked as used by this run then.
+    UnorderedSet<std::string> used GUARDED_BY(used_mtx);
+    absl::Mutex used_mtx;
     bool commited = false;
 
     void clear();
     void refreshMainTransaction();
+    MDB_txn *readTransaction();
+    u4 runGeneration();
+    void markUsed(std::string_view key);
+    void writeGenerations();
+    void removeUnused(u4 currentGeneration);
 
 public:
     /**
@@ -42,16 +59,42 @@ public:
      * other options that may affect the cached data. Two
      * `KeyValueStore`s opened with different `flavor`s will not share
      * any entries, but each will see their own set of values.
+     *
+     * If `maxUnusedRuns` isn't 0, the first store a process opens with this `path` and `flavor` removes the entries
+     * that none of the last `maxUnusedRuns` processes to open it read or wrote, so that entries for old versions of
+     * files don't pile up. The removal is kept when the store is committed.
      */
-    KeyValueStore(std::string version, std::string path, std::string flavor);
+    KeyValueStore(std::string version, std::string path, std::string flavor, u4 maxUnusedRuns = 0);
     /** returns nullptr if not found*/
     u1 *read(std::string_view key);
     std::string_view readString(std::string_view key);
     void writeString(std::string_view key, std::string_view value);
     /** can only be called from main thread */
     void write(std::string_view key, const std::vector<u1> &value);
+    /**
+     * Commits everything written so far and keeps the store open for further writes. Pointers returned by `read` on
+     * this thread are invalidated. Can only be called from main thread. Returns false if the commit failed, in which
+     * case the writes since the last commit are lost.
+     */
+    bool flush();
     ~KeyValueStore() noexcept(false);
     static bool commit(std::unique_ptr<KeyValueStore>);
+    /**
+     * Rewrites the database at `path` without the space that removed entries left, which LMDB otherwise keeps and
+     * reuses but never gives back. No other process may have the database open meanwhile.
+     */
+    static void compact(const std::string &path);
+    /**
+     * Caches are shared between machines, such as CI runners, through a directory they all see, like a network share
+     * or a mounted object storage bucket. They are shared whole, not entry by entry: the trees in a cache refer to
+     * names by their ids in the name table it stores, so they can only be read with that name table.
+     *
+     * `seed` copies the database `sharedPath` holds for `version` into `path`, unless `path` already has one, and
+     * returns whether it did. `publish` replaces what `sharedPath` holds for `version` with a compacted copy of the
+     * database at `path`, which no process may be writing meanwhile. Several processes can seed and publish at once.
+     */
+    static bool seed(const std::string &version, const std::string &path, const std::string &sharedPath);
+    static void publish(const std::string &version, const std::string &path, const std::string &sharedPath);
 };
 } // namespace sorbet
 
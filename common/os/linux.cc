@@ -5,6 +5,8 @@
 #include <csignal>
 #include <cstdio>
 #include <cstring>
+#include <fstream>
+#include <malloc.h>
 #include <sstream>
 #include <string>
 #include <sys/stat.h>
@@ -12,6 +14,10 @@
 
 using namespace std;
 
+// Provided by jemalloc, when it is linked in.
+extern "C" int mallctl(const char *name, void *oldp, size_t *oldlenp, void *newp, size_t newlen)
+    __attribute__((weak));
+
 extern "C" {
 // If we are linked against the LLVM sanitizers, this symbol will be
 // replaced with the definition from the sanitizer runtime
@@ -108,4 +114,72 @@ bool bindThreadToCore(pthread_t handle, int coreId) {
     int rc = pthread_setaffinity_np(handle, sizeof(cpu_set_t), &cpuset);
     return rc == 0;
 }
+
+bool bindThreadToCores(pthread_t handle, const vector<int> &coreIds) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (auto coreId : coreIds) {
+        CPU_SET(coreId, &cpuset);
+    }
+    int rc = pthread_setaffinity_np(handle, sizeof(cpu_set_t), &cpuset);
+    return rc == 0;
+}
+
+// Reads a list of ranges like `0-3,8-11`, the way sysfs lists cores and nodes.
+static vector<int> readRangeList(const string &path) {
+    vector<int> result;
+    ifstream in(path);
+    string range;
+    while (getline(in, range, ',')) {
+        int first, last;
+        auto matched = sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (matched < 1) {
+            continue;
+        }
+        if (matched == 1) {
+            last = first;
+        }
+        for (int i = first; i <= last; i++) {
+            result.emplace_back(i);
+        }
+    }
+    return result;
+}
+
+vector<vector<int>> numaNodeCores() {
+    vector<vector<int>> nodes;
+    for (auto node : readRangeList("/sys/devices/system/node/online")) {
+        auto cores = readRangeList("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+        // Nodes can have memory but no cores.
+        if (!cores.empty()) {
+            nodes.emplace_back(move(cores));
+        }
+    }
+    if (nodes.size() < 2) {
+        nodes.clear();
+    }
+    return nodes;
+}
+
+size_t residentMemoryBytes() {
+    // The second field is the resident set size, in pages.
+    ifstream statm("/proc/self/statm");
+    size_t total = 0;
+    size_t resident = 0;
+    if (!(statm >> total >> resident)) {
+        return 0;
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+void releaseFreeMemory() {
+    if (mallctl != nullptr) {
+        // 4096 is MALLCTL_ARENAS_ALL: purge the unused dirty pages of every arena.
+        mallctl("arena.4096.purge", nullptr, nullptr, nullptr, 0);
+        return;
+    }
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+}
 #endif
@@ -4,7 +4,9 @@
 #include <cstdio>
 #include <mach-o/dyld.h> /* _NSGetExecutablePath */
 
+#import <mach/mach.h>
 #import <mach/thread_act.h>
+#include <malloc/malloc.h>
 #include <string>
 #include <sys/sysctl.h>
 #include <sys/types.h>
@@ -87,4 +89,26 @@ bool bindThreadToCore(pthread_t handle, int coreId) {
     auto ret = thread_policy_set(mach_thread, THREAD_AFFINITY_POLICY, (thread_policy_t)&policy, 1);
     return ret == 0;
 }
+
+bool bindThreadToCores(pthread_t handle, const vector<int> &coreIds) {
+    // Affinity tags only hint at which threads should share a cache; there is no way to pick the cores.
+    return false;
+}
+
+vector<vector<int>> numaNodeCores() {
+    return {};
+}
+
+size_t residentMemoryBytes() {
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.resident_size;
+}
+
+void releaseFreeMemory() {
+    malloc_zone_pressure_relief(nullptr, 0);
+}
 #endif
@@ -5,6 +5,7 @@
 #include <optional>
 #include <pthread.h>
 #include <string>
+#include <vector>
 
 std::string addr2line(std::string_view programName, void const *const *addr, int count);
 
@@ -37,6 +38,14 @@ std::unique_ptr<Joinable> runInAThread(std::string_view threadName, std::functio
                                        std::optional<int> bindToCore = std::nullopt);
 bool setCurrentThreadName(std::string_view name);
 bool bindThreadToCore(pthread_t handle, int coreId);
+bool bindThreadToCores(pthread_t handle, const std::vector<int> &coreIds);
+// The cores of each NUMA node, or nothing if there is only one or we can't tell.
+std::vector<std::vector<int>> numaNodeCores();
+
+// How much memory the process has resident, in bytes, or 0 if we can't tell.
+size_t residentMemoryBytes();
+// Gives the memory the allocator kept around after it was freed back to the OS, where we know how to ask it to.
+void releaseFreeMemory();
 
 /** The should trigger debugger breakpoint if the debugger is attached, if no debugger is attach, it should do nothing
  *  This allows to:
@@ -27,16 +27,15 @@ class StatsdClientWrapper {
     void addMetric(string_view name, size_t value, string_view type) {
         // spec: https://github.com/etsy/statsd/blob/master/docs/metric_types.md#multi-metric-packets
         auto newLine = fmt::format("{}{}:{}|{}", link->ns ? link->ns : "", cleanMetricName(name), value, type);
-        if (packet.size() + newLine.size() + 1 < PKT_LEN) {
-            packet = packet + '\n' + newLine;
+        if (!packet.empty() && packet.size() + newLine.size() + 1 >= PKT_LEN) {
+            statsd_send(link, packet.c_str());
+            packet.clear();
+        }
+        if (packet.empty()) {
+            // the line itself might be bigger than MTU, in which case it goes out alone
+            packet = move(newLine);
         } else {
-            if (!packet.empty()) {
-                statsd_send(link, packet.c_str());
-                packet = move(newLine);
-            } else {
-                // the packet itself might be bigger than MTU
-                statsd_send(link, newLine.c_str());
-            }
+            absl::StrAppend(&packet, "\n", newLine);
         }
     }
 
@@ -89,6 +88,18 @@ bool StatsD::submitCounters(const CounterState &counters, string_view host, int
         statsd.gauge(e.first, e.second);
     }
 
+    for (auto &latency : counters.counters->latencies) {
+        statsd.gauge(absl::StrCat(latency.first, ".latency_ns.p50"),
+                     CounterImpl::latencyPercentile(latency.second, 50));
+        statsd.gauge(absl::StrCat(latency.first, ".latency_ns.p90"),
+                     CounterImpl::latencyPercentile(latency.second, 90));
+        statsd.gauge(absl::StrCat(latency.first, ".latency_ns.p99"),
+                     CounterImpl::latencyPercentile(latency.second, 99));
+        statsd.gauge(absl::StrCat(latency.first, ".latency_ns.count"),
+                     absl::c_accumulate(latency.second, CounterImpl::CounterType(0),
+                                        [](auto sum, const auto &e) { return sum + e.second; }));
+    }
+
     UnorderedMap<int, CounterImpl::Timing> flowStarts;
     for (const auto &e : counters.counters->timings) {
         statsd.timing(e);
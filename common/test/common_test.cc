@@ -1,7 +1,17 @@
 #include "gtest/gtest.h"
 // violates our requirements, thus has to go first
+#include "common/BitSet.h"
+#include "common/FileOps.h"
+#include "common/Counters.h"
+#include "common/Counters_impl.h"
 #include "common/Levenstein.h"
+#include "common/SmallObjectPool.h"
+#include "common/UTF8.h"
 #include "common/common.h"
+#include <cstring>
+#include <thread>
+
+using namespace std;
 
 namespace sorbet::common {
 
@@ -10,6 +20,136 @@ TEST(CommonTest, Levenstein) { // NOLINT
     EXPECT_EQ(5, Levenstein::distance("Ruby", "Scala", 10));
     EXPECT_EQ(3, Levenstein::distance("Java", "Scala", 10));
     EXPECT_EQ(INT_MAX, Levenstein::distance("Java", "S", 1));
+    EXPECT_EQ(INT_MAX, Levenstein::distance("Ruby", "Scala", 3));
+    EXPECT_EQ(0, Levenstein::distance("", "", 0));
+    EXPECT_EQ(2, Levenstein::distance("", "ab", 2));
+
+    // Longer than a machine word, which takes the slow path.
+    string long1(70, 'a');
+    string long2 = long1;
+    long2[3] = 'b';
+    long2 += "c";
+    EXPECT_EQ(2, Levenstein::distance(long1, long2, 10));
+    EXPECT_EQ(2, Levenstein::distance(long1.substr(0, 64), long2.substr(0, 65), 10));
+    EXPECT_EQ(INT_MAX, Levenstein::distance(long1, string(70, 'b'), 10));
+}
+
+TEST(CommonTest, UTF8) { // NOLINT
+    EXPECT_TRUE(UTF8::isAscii(""));
+    EXPECT_TRUE(UTF8::isAscii("longer than a machine word"));
+    EXPECT_FALSE(UTF8::isAscii("longer than a machine word, \u00e9"));
+    EXPECT_TRUE(UTF8::isValid("h\u00e9llo w\u00f6rld \u65e5\u672c \U0001F600 \U0010FFFF"));
+
+    EXPECT_EQ(3, UTF8::firstInvalid("abc\xC0\xAF"));             // overlong
+    EXPECT_EQ(10, UTF8::firstInvalid("0123456789\xED\xA0\x80")); // surrogate
+    EXPECT_EQ(0, UTF8::firstInvalid("\xF4\x90\x80\x80"));        // past U+10FFFF
+    EXPECT_EQ(2, UTF8::firstInvalid("ok\xE6\x97"));              // truncated
+    EXPECT_EQ(1, UTF8::firstInvalid("x\x80"));                   // stray continuation byte
+}
+
+TEST(CommonTest, StaticCounter) { // NOLINT
+    static StaticCounter counter("test.static_counter");
+    counter.add(41);
+    thread([]() { counter.inc(); }).join();
+    counter.inc();
+    EXPECT_NE(string::npos, getCounterStatistics({"test.static_counter"}).find(":             42\n"));
+}
+
+TEST(CommonTest, LatencyPercentiles) { // NOLINT
+    for (u8 nanos : {0ul, 3ul, 4ul, 7ul, 8ul, 1000ul, 123456789ul, 1ul << 62}) {
+        auto bucket = CounterImpl::latencyBucket(nanos);
+        EXPECT_LE(nanos, CounterImpl::latencyBucketMax(bucket));
+        EXPECT_LE(CounterImpl::latencyBucketMax(bucket) - nanos, nanos / CounterImpl::LATENCY_SUB_BUCKETS);
+        if (bucket > 0) {
+            EXPECT_LT(CounterImpl::latencyBucketMax(bucket - 1), nanos);
+        }
+    }
+
+    UnorderedMap<int, CounterImpl::CounterType> buckets;
+    for (u8 micros = 1; micros <= 100; micros++) {
+        buckets[CounterImpl::latencyBucket(micros * 1000)]++;
+    }
+    for (double percentile : {50.0, 90.0, 99.0}) {
+        auto nanos = CounterImpl::latencyPercentile(buckets, percentile);
+        EXPECT_GE(nanos, percentile * 1000);
+        EXPECT_LE(nanos, percentile * 1000 * (1.0 + 1.0 / CounterImpl::LATENCY_SUB_BUCKETS));
+    }
+}
+
+TEST(CommonTest, SmallObjectPool) { // NOLINT
+    vector<void *> objects;
+    for (size_t size = 1; size <= SmallObjectPool::MAX_SIZE * 2; size += 7) {
+        auto *object = SmallObjectPool::allocate(size);
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(object) % alignof(max_align_t));
+        memset(object, 0xab, size);
+        objects.emplace_back(object);
+    }
+    UnorderedSet<void *> distinct(objects.begin(), objects.end());
+    EXPECT_EQ(objects.size(), distinct.size());
+
+    // Free everything on another thread, which then exits and hands those objects back.
+    thread freer([&objects]() {
+        size_t size = 1;
+        for (auto *object : objects) {
+            SmallObjectPool::deallocate(object, size);
+            size += 7;
+        }
+    });
+    freer.join();
+    for (int i = 0; i < 1000; i++) {
+        auto *object = SmallObjectPool::allocate(24);
+        memset(object, 0xcd, 24);
+        SmallObjectPool::deallocate(object, 24);
+    }
+}
+
+TEST(CommonTest, BitSet) { // NOLINT
+    BitSet set;
+    EXPECT_TRUE(set.empty());
+    EXPECT_TRUE(set.add(3));
+    EXPECT_FALSE(set.add(3));
+    EXPECT_TRUE(set.add(130));
+    EXPECT_TRUE(set.contains(130));
+    EXPECT_FALSE(set.contains(64));
+    EXPECT_FALSE(set.contains(1000));
+    EXPECT_EQ(2, set.size());
+
+    BitSet other(200);
+    other.add(3);
+    other.add(64);
+    EXPECT_TRUE(set.addAll(other));
+    EXPECT_FALSE(set.addAll(other));
+
+    vector<int> elements;
+    set.forEach([&](int i) { elements.emplace_back(i); });
+    EXPECT_EQ((vector<int>{3, 64, 130}), elements);
+
+    set.retainAll(other);
+    set.remove(3);
+    elements.clear();
+    set.forEach([&](int i) { elements.emplace_back(i); });
+    EXPECT_EQ((vector<int>{64}), elements);
+}
+
+TEST(CommonTest, ListFilesInDir) { // NOLINT
+    char dirTemplate[] = "/tmp/sorbet-list-files-XXXXXX";
+    string root = mkdtemp(dirTemplate);
+    for (auto dir : {"/a", "/a/b", "/a/vendor", "/a/vendored", "/c", "/c/b"}) {
+        FileOps::createDir(root + dir);
+    }
+    for (auto file : {"/x.rb", "/y.txt", "/a/b/x.rb", "/a/vendor/x.rb", "/a/vendored/x.rb", "/c/x.rbi", "/c/b/x.rb"}) {
+        FileOps::write(root + file, "");
+    }
+
+    EXPECT_EQ((vector<string>{root + "/a/b/x.rb", root + "/a/vendor/x.rb", root + "/a/vendored/x.rb",
+                              root + "/c/b/x.rb", root + "/c/x.rbi", root + "/x.rb"}),
+              FileOps::listFilesInDir(root, {".rb", ".rbi"}, true, {}, {}));
+    EXPECT_EQ((vector<string>{root + "/x.rb"}), FileOps::listFilesInDir(root, {".rb", ".rbi"}, false, {}, {}));
+    // An absolute pattern only matches from the root, a relative one anywhere, and both only match whole names.
+    EXPECT_EQ((vector<string>{root + "/a/vendored/x.rb", root + "/c/x.rbi"}),
+              FileOps::listFilesInDir(root, {".rb", ".rbi"}, true, {"/a/b", "/x.rb"}, {"/vendor", "/c/b"}));
+    EXPECT_THROW(FileOps::listFilesInDir(root + "/x.rb", {".rb"}, true, {}, {}), FileNotDirException);
+    EXPECT_THROW(FileOps::listFilesInDir(root + "/missing", {".rb"}, true, {}, {}), FileNotFoundException);
 }
 
 } // namespace sorbet::common
@@ -39,10 +39,18 @@ struct argtype_extractor<ReturnType (ClassType::*)(ArgType *) const>
     using arg_type = ArgType;
 };
 
+// How `typecase` checks whether `base` is a `To`. Hierarchies that can tell their classes apart more cheaply than RTTI
+// (like `core::Type`, or `ast::Expression`) specialize this for the classes deriving from their root.
+template <typename Base, typename To, typename Enable = void> struct TypecaseCast {
+    static To *cast(Base *base) {
+        return fast_cast<Base, To>(base);
+    }
+};
+
 template <typename Base, typename FUNC> bool typecaseHelper(Base *base, FUNC &&func) {
     typedef argtype_extractor<std::function<get_signature<FUNC>>> traits;
     typedef typename traits::arg_type ArgType;
-    if (ArgType *first = fast_cast<Base, ArgType>(base)) {
+    if (ArgType *first = TypecaseCast<Base, ArgType>::cast(base)) {
         func(first);
         return true;
     } else {
@@ -2,6 +2,7 @@
 #include "common/FileOps.h"
 
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/str_replace.h"
 #include "common/Counters_impl.h"
 #include "common/web_tracer_framework/tracing.h"
@@ -11,12 +12,44 @@
 #include <unistd.h>
 using namespace std;
 namespace sorbet::web_tracer_framework {
-bool Tracing::storeTraces(const CounterState &counters, string_view fileName) {
-    fmt::memory_buffer result;
+namespace {
+// Guards appending to trace files, which TraceStream's writer does concurrently with `storeTraces`.
+absl::Mutex fileMutex;
+
+string timingEvent(const CounterImpl::Timing &e, int pid) {
+    string maybeArgs;
+    if (!e.args.empty()) {
+        maybeArgs = fmt::format(",\"args\":{{{}}}", fmt::map_join(e.args, ",", [](const auto &nameValue) -> string {
+                                    return fmt::format("\"{}\":\"{}\"", nameValue.first, nameValue.second);
+                                }));
+    }
+
+    string maybeFlow;
+    if (e.self.id != 0) {
+        ENFORCE(e.prev.id == 0);
+        maybeFlow = fmt::format(",\"bind_id\":{},\"flow_out\":true", e.self.id);
+    } else if (e.prev.id != 0) {
+        maybeFlow = fmt::format(",\"bind_id\":{},\"flow_in\":true", e.prev.id);
+    }
+
+    return fmt::format("{{\"name\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":{},\"tid\":{}{}{}}},\n",
+                       e.measure, (std::chrono::duration<double, std::micro>(e.start.time_since_epoch())).count(),
+                       (std::chrono::duration<double, std::micro>(e.end - e.start)).count(), pid, e.threadId,
+                       maybeArgs, maybeFlow);
+}
 
+// Starts `fileName` if it doesn't exist yet. Must hold fileMutex.
+void appendTrace(string_view fileName, string_view events) {
     if (!FileOps::exists(fileName)) {
-        fmt::format_to(result, "[\n");
+        FileOps::append(fileName, "[\n");
     }
+    FileOps::append(fileName, events);
+}
+} // namespace
+
+bool Tracing::storeTraces(const CounterState &counters, string_view fileName) {
+    fmt::memory_buffer result;
+
     auto now = std::chrono::duration<double, std::micro>(chrono::steady_clock::now().time_since_epoch()).count();
 
     auto pid = getpid();
@@ -49,30 +82,66 @@ bool Tracing::storeTraces(const CounterState &counters, string_view fileName) {
     // }
 
     for (const auto &e : counters.counters->timings) {
-        string maybeArgs;
-        if (!e.args.empty()) {
-            maybeArgs = fmt::format(",\"args\":{{{}}}", fmt::map_join(e.args, ",", [](const auto &nameValue) -> string {
-                                        return fmt::format("\"{}\":\"{}\"", nameValue.first, nameValue.second);
-                                    }));
-        }
-
-        string maybeFlow;
-        if (e.self.id != 0) {
-            ENFORCE(e.prev.id == 0);
-            maybeFlow = fmt::format(",\"bind_id\":{},\"flow_out\":true", e.self.id);
-        } else if (e.prev.id != 0) {
-            maybeFlow = fmt::format(",\"bind_id\":{},\"flow_in\":true", e.prev.id);
-        }
-
-        fmt::format_to(result,
-                       "{{\"name\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":{},\"tid\":{}{}{}}},\n",
-                       e.measure, (std::chrono::duration<double, std::micro>(e.start.time_since_epoch())).count(),
-                       (std::chrono::duration<double, std::micro>(e.end - e.start)).count(), pid, e.threadId, maybeArgs,
-                       maybeFlow);
+        fmt::format_to(result, "{}", timingEvent(e, pid));
     }
 
     fmt::format_to(result, "\n");
-    FileOps::append(fileName, to_string(result));
+    absl::MutexLock lck(&fileMutex);
+    appendTrace(fileName, to_string(result));
     return true;
 }
+
+TraceStream::TraceStream(string fileName, int sampleEvery)
+    : fileName(move(fileName)), sampleEvery(max(sampleEvery, 1)) {
+    writer = runInAThread("traceWriter", [this]() -> void { writeBuffered(); });
+    setTimingSink(this);
+}
+
+TraceStream::~TraceStream() {
+    setTimingSink(nullptr);
+    {
+        absl::MutexLock lck(&mutex);
+        stopping = true;
+    }
+    // Joins the writer once it has written everything still buffered.
+    writer.reset();
+}
+
+void TraceStream::add(const CounterImpl::Timing &timing) {
+    // Events about one file (like typecheckOne) dwarf all others in number. Events that are part of a flow are kept,
+    // since dropping one end would leave the other dangling.
+    const bool isFileEvent =
+        absl::c_any_of(timing.args, [](const auto &arg) -> bool { return string_view(arg.first) == "file"; });
+    if (isFileEvent && timing.self.id == 0 && timing.prev.id == 0 && fileEventsSeen.fetch_add(1) % sampleEvery != 0) {
+        return;
+    }
+    auto event = timingEvent(timing, getpid());
+
+    absl::MutexLock lck(&mutex);
+    mutex.Await(absl::Condition(
+        +[](TraceStream *stream) -> bool { return stream->buffered.size() < MAX_BUFFERED_EVENTS || stream->stopping; },
+        this));
+    buffered.emplace_back(move(event));
+}
+
+void TraceStream::writeBuffered() {
+    while (true) {
+        vector<string> events;
+        bool stopped;
+        {
+            absl::MutexLock lck(&mutex);
+            mutex.Await(absl::Condition(
+                +[](TraceStream *stream) -> bool { return !stream->buffered.empty() || stream->stopping; }, this));
+            events.swap(buffered);
+            stopped = stopping;
+        }
+        if (!events.empty()) {
+            absl::MutexLock lck(&fileMutex);
+            appendTrace(fileName, absl::StrJoin(events, ""));
+        }
+        if (stopped) {
+            return;
+        }
+    }
+}
 } // namespace sorbet::web_tracer_framework
@@ -1,6 +1,9 @@
 #ifndef SORBET_CORE_WEB_TRACER_FRAMEWORK_TRACING_H
 #define SORBET_CORE_WEB_TRACER_FRAMEWORK_TRACING_H
 
+#include "absl/synchronization/mutex.h"
+#include "common/Counters_impl.h"
+#include "common/os/os.h"
 #include "core/core.h"
 
 namespace sorbet::web_tracer_framework {
@@ -10,6 +13,35 @@ public:
 
     static bool storeTraces(const CounterState &counters, std::string_view fileName);
 };
+
+/**
+ * Streams timings to a trace file while they are recorded, instead of them piling up in memory until `storeTraces`
+ * writes them at exit. Events are formatted on the thread that recorded them and appended to the file by a background
+ * thread; threads that get more than MAX_BUFFERED_EVENTS ahead of it wait for it to catch up.
+ *
+ * Installs itself as the TimingSink for as long as it lives.
+ */
+class TraceStream final : public TimingSink {
+    const std::string fileName;
+    // Only one in this many events that are about a single file is written, see `add`.
+    const int sampleEvery;
+    std::atomic<u8> fileEventsSeen{0};
+    absl::Mutex mutex;
+    std::vector<std::string> buffered GUARDED_BY(mutex);
+    bool stopping GUARDED_BY(mutex) = false;
+    std::unique_ptr<Joinable> writer;
+
+    void writeBuffered();
+
+public:
+    static constexpr int MAX_BUFFERED_EVENTS = 4096;
+
+    TraceStream(std::string fileName, int sampleEvery);
+    ~TraceStream();
+    TraceStream(const TraceStream &) = delete;
+
+    void add(const CounterImpl::Timing &timing) override;
+};
 } // namespace sorbet::web_tracer_framework
 
 #endif
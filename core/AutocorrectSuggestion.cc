@@ -5,11 +5,10 @@ using namespace std;
 
 namespace sorbet::core {
 
-bool hasSeen(const UnorderedSet<Loc> &seen, Loc loc) {
-    for (auto &seenLoc : seen) {
-        if (seenLoc.file() != loc.file()) {
-            continue;
-        }
+namespace {
+bool overlapsApplied(const vector<const AutocorrectSuggestion::Edit *> &applied, Loc loc) {
+    for (auto *edit : applied) {
+        auto &seenLoc = edit->loc;
         // Check exactly equal for zero-width locs
         if (seenLoc == loc) {
             return true;
@@ -24,47 +23,57 @@ bool hasSeen(const UnorderedSet<Loc> &seen, Loc loc) {
     }
     return false;
 }
+} // namespace
 
 UnorderedMap<FileRef, string> AutocorrectSuggestion::apply(vector<AutocorrectSuggestion> autocorrects,
                                                            UnorderedMap<FileRef, string> sources) {
-    vector<AutocorrectSuggestion::Edit> edits;
-    for (auto &autocorrect : autocorrects) {
-        move(autocorrect.edits.begin(), autocorrect.edits.end(), back_inserter(edits));
+    UnorderedMap<FileRef, string> ret;
+    for (auto &[file, edits] : editsByFile(move(autocorrects))) {
+        ret[file] = applyEdits(edits, sources[file]);
     }
+    return ret;
+}
 
-    // Sort the locs backwards
-    auto compare = [](const AutocorrectSuggestion::Edit &left, const AutocorrectSuggestion::Edit &right) {
-        if (left.loc.file() != right.loc.file()) {
-            return left.loc.file().id() > right.loc.file().id();
-        }
-
-        auto a = left.loc.beginPos();
-        auto b = right.loc.beginPos();
-        if (a != b) {
-            return a > b;
+UnorderedMap<FileRef, vector<AutocorrectSuggestion::Edit>>
+AutocorrectSuggestion::editsByFile(vector<AutocorrectSuggestion> autocorrects) {
+    UnorderedMap<FileRef, vector<AutocorrectSuggestion::Edit>> ret;
+    for (auto &autocorrect : autocorrects) {
+        for (auto &edit : autocorrect.edits) {
+            ret[edit.loc.file()].emplace_back(move(edit));
         }
+    }
+    // Sort the locs backwards
+    for (auto &[file, edits] : ret) {
+        fast_sort(edits, [](const AutocorrectSuggestion::Edit &left, const AutocorrectSuggestion::Edit &right) {
+            return left.loc.beginPos() > right.loc.beginPos();
+        });
+    }
+    return ret;
+}
 
-        return false;
-    };
-    fast_sort(edits, compare);
-
-    UnorderedSet<Loc> seen; // used to make sure nothing overlaps
-    UnorderedMap<FileRef, string> ret;
+string AutocorrectSuggestion::applyEdits(const vector<AutocorrectSuggestion::Edit> &edits, string_view source) {
+    // Going backwards, an edit is applied unless it overlaps one that already was, which leaves edits that don't
+    // overlap (or that insert right before another one). So they can all be spliced in with a single pass forwards,
+    // instead of copying the whole source for each one.
+    vector<const AutocorrectSuggestion::Edit *> applied;
     for (auto &edit : edits) {
-        core::Loc loc = edit.loc;
-        if (!ret.count(loc.file())) {
-            ret[loc.file()] = sources[loc.file()];
-        }
-        auto source = ret[loc.file()];
-        auto start = loc.beginPos();
-        auto end = loc.endPos();
-
-        if (hasSeen(seen, loc)) {
+        ENFORCE(edit.loc.file() == edits.front().loc.file());
+        if (overlapsApplied(applied, edit.loc)) {
             continue;
         }
-        seen.emplace(loc);
-        ret[loc.file()] = absl::StrCat(source.substr(0, start), edit.replacement, source.substr(end, -1));
+        applied.emplace_back(&edit);
+    }
+
+    string ret;
+    ret.reserve(source.size());
+    u4 copiedUpTo = 0;
+    for (auto it = applied.rbegin(); it != applied.rend(); ++it) {
+        auto &edit = **it;
+        ENFORCE(copiedUpTo <= edit.loc.beginPos());
+        absl::StrAppend(&ret, source.substr(copiedUpTo, edit.loc.beginPos() - copiedUpTo), edit.replacement);
+        copiedUpTo = edit.loc.endPos();
     }
+    absl::StrAppend(&ret, source.substr(copiedUpTo));
     return ret;
 }
 
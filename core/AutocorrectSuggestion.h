@@ -17,6 +17,11 @@ struct AutocorrectSuggestion {
     AutocorrectSuggestion(std::string title, std::vector<Edit> edits) : title(title), edits(edits) {}
     static UnorderedMap<FileRef, std::string> apply(std::vector<AutocorrectSuggestion> autocorrects,
                                                     UnorderedMap<FileRef, std::string> sources);
+    // The edits of `autocorrects`, grouped by file, in the order `applyEdits` takes them.
+    static UnorderedMap<FileRef, std::vector<Edit>> editsByFile(std::vector<AutocorrectSuggestion> autocorrects);
+    // Returns `source` with `edits`, all in the same file, applied. An edit that overlaps one applied before it is
+    // skipped.
+    static std::string applyEdits(const std::vector<Edit> &edits, std::string_view source);
 };
 
 } // namespace sorbet::core
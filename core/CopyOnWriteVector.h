@@ -0,0 +1,215 @@
+#ifndef SORBET_CORE_COPYONWRITEVECTOR_H
+#define SORBET_CORE_COPYONWRITEVECTOR_H
+
+#include "common/common.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace sorbet::core {
+
+/**
+ * A vector stored as fixed-size chunks that copies of it share. Copying the vector is O(chunks); a shared chunk is
+ * copied (using `T::copy()`) the first time it is accessed through a non-const reference, so a copy that is then only
+ * partially modified only pays for the chunks it touched.
+ *
+ * Elements never move while their chunk is unshared, so references to them stay valid across `emplace_back`. A
+ * reference obtained through a const accessor may point into a chunk that is shared with another copy, and goes stale
+ * (but stays readable) once this copy writes to that chunk.
+ *
+ * Const accessors are safe to call concurrently. Like `std::vector`, nothing else is, except for what
+ * `allowConcurrentAppends` allows.
+ */
+template <class T, int ChunkBits = 10> class CopyOnWriteVector final {
+    static constexpr u4 CHUNK_SIZE = 1 << ChunkBits;
+    static constexpr u4 CHUNK_MASK = CHUNK_SIZE - 1;
+    using Chunk = std::vector<T>;
+
+    std::vector<std::shared_ptr<Chunk>> chunks;
+    // The first element of every chunk along with its index in `chunks`, ordered by address. Used by `indexOf`.
+    std::vector<std::pair<const T *, u4>> chunksByAddress;
+    // Atomic only so that readers may check bounds while another thread appends, see `allowConcurrentAppends`.
+    std::atomic<u4> size_ = 0;
+    u4 capacity_ = 0;
+    bool concurrentAppends = false;
+
+    static bool addressLess(const std::pair<const T *, u4> &left, const std::pair<const T *, u4> &right) {
+        return std::less<const T *>()(left.first, right.first);
+    }
+
+    void indexChunk(u4 chunkIdx) {
+        std::pair<const T *, u4> entry(chunks[chunkIdx]->data(), chunkIdx);
+        chunksByAddress.insert(absl::c_upper_bound(chunksByAddress, entry, addressLess), entry);
+    }
+
+    void unindexChunk(u4 chunkIdx) {
+        std::pair<const T *, u4> entry(chunks[chunkIdx]->data(), chunkIdx);
+        auto it = absl::c_lower_bound(chunksByAddress, entry, addressLess);
+        ENFORCE(it != chunksByAddress.end() && it->second == chunkIdx);
+        chunksByAddress.erase(it);
+    }
+
+    Chunk &mutableChunk(u4 chunkIdx) {
+        auto &chunk = chunks[chunkIdx];
+        if (chunk.use_count() > 1) {
+            auto copy = std::make_shared<Chunk>();
+            copy->reserve(CHUNK_SIZE);
+            for (auto &element : *chunk) {
+                copy->emplace_back(element.copy());
+            }
+            unindexChunk(chunkIdx);
+            chunk = std::move(copy);
+            indexChunk(chunkIdx);
+        }
+        return *chunk;
+    }
+
+public:
+    class const_iterator final {
+        const CopyOnWriteVector *vec;
+        u4 idx;
+
+    public:
+        const_iterator(const CopyOnWriteVector *vec, u4 idx) : vec(vec), idx(idx) {}
+        const T &operator*() const {
+            return (*vec)[idx];
+        }
+        const T *operator->() const {
+            return &(*vec)[idx];
+        }
+        const_iterator &operator++() {
+            idx++;
+            return *this;
+        }
+        bool operator==(const const_iterator &rhs) const {
+            return idx == rhs.idx;
+        }
+        bool operator!=(const const_iterator &rhs) const {
+            return idx != rhs.idx;
+        }
+    };
+
+    CopyOnWriteVector() = default;
+    CopyOnWriteVector(const CopyOnWriteVector &other)
+        : chunks(other.chunks), chunksByAddress(other.chunksByAddress), size_(other.size()),
+          capacity_(other.capacity_) {}
+    CopyOnWriteVector(CopyOnWriteVector &&other) noexcept
+        : chunks(std::move(other.chunks)), chunksByAddress(std::move(other.chunksByAddress)), size_(other.size()),
+          capacity_(other.capacity_) {}
+    CopyOnWriteVector &operator=(const CopyOnWriteVector &other) {
+        chunks = other.chunks;
+        chunksByAddress = other.chunksByAddress;
+        size_ = other.size();
+        capacity_ = other.capacity_;
+        return *this;
+    }
+    CopyOnWriteVector &operator=(CopyOnWriteVector &&other) noexcept {
+        chunks = std::move(other.chunks);
+        chunksByAddress = std::move(other.chunksByAddress);
+        size_ = other.size();
+        capacity_ = other.capacity_;
+        return *this;
+    }
+
+    u4 size() const {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    // Only bookkeeping, since chunks are allocated as they fill up: callers use it to decide when to grow structures
+    // kept alongside, like GlobalState::namesByHash.
+    u4 capacity() const {
+        return capacity_;
+    }
+
+    void reserve(u4 capacity) {
+        if (capacity > capacity_) {
+            capacity_ = capacity;
+            chunks.reserve((capacity + CHUNK_MASK) >> ChunkBits);
+        }
+    }
+
+    void clear() {
+        ENFORCE(!concurrentAppends);
+        chunks.clear();
+        chunksByAddress.clear();
+        size_ = 0;
+    }
+
+    const T &operator[](u4 idx) const {
+        ENFORCE(idx < size());
+        return (*chunks[idx >> ChunkBits])[idx & CHUNK_MASK];
+    }
+
+    T &operator[](u4 idx) {
+        ENFORCE(idx < size());
+        return mutableChunk(idx >> ChunkBits)[idx & CHUNK_MASK];
+    }
+
+    template <class... Args> T &emplace_back(Args &&... args) {
+        const u4 newSize = size() + 1;
+        if (((newSize - 1) & CHUNK_MASK) == 0) {
+            if (concurrentAppends && chunks.size() == chunks.capacity()) {
+                // Growing `chunks` would move it out from under concurrent readers.
+                Exception::raise("CopyOnWriteVector outgrew the size passed to allowConcurrentAppends");
+            }
+            auto &chunk = chunks.emplace_back(std::make_shared<Chunk>());
+            chunk->reserve(CHUNK_SIZE);
+            indexChunk(chunks.size() - 1);
+        }
+        auto &chunk = mutableChunk(chunks.size() - 1);
+        auto &result = chunk.emplace_back(std::forward<Args>(args)...);
+        size_.store(newSize, std::memory_order_relaxed);
+        if (newSize > capacity_) {
+            capacity_ = std::max(newSize, capacity_ * 2);
+        }
+        return result;
+    }
+
+    /**
+     * Until `disallowConcurrentAppends`, accessors other than `indexOf` may be called concurrently with `emplace_back`
+     * and with writes to the element it returned, as long as the vector stays below `maxSize` elements, callers make
+     * sure there's only one writer at a time, and no two threads access the same element unless one only reads it.
+     * Readers must learn about a new element's index through something that synchronizes them with its writer.
+     *
+     * Copies every chunk still shared with another vector first, so that non-const access never has to.
+     */
+    void allowConcurrentAppends(u4 maxSize) {
+        concurrentAppends = true;
+        chunks.reserve((maxSize + CHUNK_MASK) >> ChunkBits);
+        for (u4 chunkIdx = 0; chunkIdx < chunks.size(); chunkIdx++) {
+            mutableChunk(chunkIdx);
+        }
+    }
+
+    void disallowConcurrentAppends() {
+        concurrentAppends = false;
+    }
+
+    /** Returns the index of `element`, which must be stored in this vector. O(log(chunks)). Not safe to call
+     * concurrently with appends. */
+    u4 indexOf(const T &element) const {
+        std::pair<const T *, u4> entry(&element, 0);
+        auto it = absl::c_upper_bound(chunksByAddress, entry, addressLess);
+        ENFORCE(it != chunksByAddress.begin());
+        --it;
+        auto offset = &element - it->first;
+        ENFORCE(offset >= 0 && offset < CHUNK_SIZE, "element is not stored in this vector");
+        return (it->second << ChunkBits) + offset;
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, size());
+    }
+};
+
+} // namespace sorbet::core
+
+#endif // SORBET_CORE_COPYONWRITEVECTOR_H
@@ -2,6 +2,7 @@
 #include "rang.hpp"
 
 #include "absl/strings/str_replace.h"
+#include "common/JSON.h"
 #include "core/Context.h"
 #include "core/Error.h"
 #include "core/ErrorQueue.h"
@@ -105,6 +106,48 @@ string Error::toString(const GlobalState &gs) const {
     return buf.str();
 }
 
+namespace {
+void locToJSON(fmt::memory_buffer &buf, const GlobalState &gs, Loc loc) {
+    if (!loc.file().exists()) {
+        fmt::format_to(buf, "\"file\":null");
+        return;
+    }
+    fmt::format_to(buf, "\"file\":\"{}\"", JSON::escape(string(gs.getPrintablePath(loc.file().data(gs).path()))));
+    if (loc.exists()) {
+        auto pos = loc.position(gs);
+        fmt::format_to(buf, ",\"start\":{{\"line\":{},\"column\":{}}},\"end\":{{\"line\":{},\"column\":{}}}",
+                       pos.first.line, pos.first.column, pos.second.line, pos.second.column);
+    }
+}
+
+string messageToJSON(string_view message) {
+    return JSON::escape(_replaceAll(message, REVERT_COLOR_SIGIL, ""));
+}
+} // namespace
+
+string Error::toJSON(const GlobalState &gs) const {
+    fmt::memory_buffer buf;
+    fmt::format_to(buf, "{{\"code\":{},", what.code);
+    locToJSON(buf, gs, loc);
+    fmt::format_to(buf, ",\"header\":\"{}\",\"sections\":[", messageToJSON(header));
+    bool firstSection = true;
+    for (auto &section : this->sections) {
+        fmt::format_to(buf, "{}{{\"header\":\"{}\",\"lines\":[", firstSection ? "" : ",",
+                       messageToJSON(section.header));
+        firstSection = false;
+        bool firstLine = true;
+        for (auto &line : section.messages) {
+            fmt::format_to(buf, "{}{{", firstLine ? "" : ",");
+            firstLine = false;
+            locToJSON(buf, gs, line.loc);
+            fmt::format_to(buf, ",\"message\":\"{}\"}}", messageToJSON(line.formattedMessage));
+        }
+        fmt::format_to(buf, "]}}");
+    }
+    fmt::format_to(buf, "]}}");
+    return to_string(buf);
+}
+
 ErrorRegion::~ErrorRegion() {
     gs.errorQueue->markFileForFlushing(this->f);
 }
@@ -141,6 +184,31 @@ void ErrorBuilder::addAutocorrect(AutocorrectSuggestion &&autocorrect) {
     this->autocorrects.emplace_back(move(autocorrect));
 }
 
+void ErrorBuilder::addDeferred(DeferredErrorRender &&render) {
+    ENFORCE(state == State::WillBuild);
+    this->deferred.emplace_back(move(render));
+}
+
+unique_ptr<Error> ErrorBuilder::renderDeferred(const GlobalState &gs, unique_ptr<Error> error) {
+    if (error->deferred.empty()) {
+        return error;
+    }
+    if (error->isSilenced) {
+        error->deferred.clear();
+        return error;
+    }
+    ErrorBuilder builder(gs, true, error->loc, error->what);
+    builder.header = error->header;
+    for (auto &section : error->sections) {
+        builder.sections.emplace_back(section);
+    }
+    builder.autocorrects = move(error->autocorrects);
+    for (auto &render : error->deferred) {
+        render(gs, builder);
+    }
+    return builder.build();
+}
+
 // This will sometimes be bypassed in lieu of just calling build() so put your
 // logic in build() instead.
 ErrorBuilder::~ErrorBuilder() {
@@ -157,6 +225,7 @@ unique_ptr<Error> ErrorBuilder::build() {
 
     unique_ptr<Error> err = make_unique<Error>(this->loc, this->what, move(this->header), move(this->sections),
                                                move(this->autocorrects), isSilenced);
+    err->deferred = move(this->deferred);
     return err;
 }
 
@@ -5,6 +5,7 @@
 #include "core/Loc.h"
 #include "core/StrictLevel.h"
 #include "spdlog/fmt/fmt.h"
+#include <functional>
 #include <initializer_list>
 #include <memory>
 
@@ -66,6 +67,10 @@ struct ErrorSection {
     std::string toString(const GlobalState &gs) const;
 };
 
+class ErrorBuilder;
+// Adds the parts of an error that are only worth computing once it's reported, see `ErrorBuilder::addDeferred`.
+using DeferredErrorRender = std::function<void(const GlobalState &gs, ErrorBuilder &e)>;
+
 class Error {
 public:
     const Loc loc;
@@ -74,9 +79,14 @@ public:
     const bool isSilenced;
     std::vector<AutocorrectSuggestion> autocorrects;
     const std::vector<ErrorSection> sections;
+    // Run by `GlobalState::_error`, which replaces this error with one that includes what they add.
+    std::vector<DeferredErrorRender> deferred;
 
     bool isCritical() const;
     std::string toString(const GlobalState &gs) const;
+    // Renders this error as a single-line JSON object with its code, location, header and sections, without the
+    // source snippets or colors of `toString`.
+    std::string toJSON(const GlobalState &gs) const;
     Error(Loc loc, ErrorClass what, std::string header, std::vector<ErrorSection> sections,
           std::vector<AutocorrectSuggestion> autocorrects, bool isSilenced)
         : loc(loc), what(what), header(move(header)), isSilenced(isSilenced), autocorrects(move(autocorrects)),
@@ -133,6 +143,7 @@ class ErrorBuilder {
     std::string header;
     std::vector<ErrorSection> sections;
     std::vector<AutocorrectSuggestion> autocorrects;
+    std::vector<DeferredErrorRender> deferred;
     void _setHeader(std::string &&header);
 
 public:
@@ -157,6 +168,14 @@ public:
     }
 
     void addAutocorrect(AutocorrectSuggestion &&autocorrect);
+    // Postpones whatever `render` adds to this error (header, sections or autocorrects) until the error is reported
+    // with `GlobalState::_error`, so that errors that get dropped before then, like those of the components of an
+    // intersection type that `dispatchCall` doesn't use, don't pay for formatting types or finding suggestions.
+    // `render` must only capture what will still be alive when the error is reported; it runs after what was added
+    // directly, and never for silenced errors.
+    void addDeferred(DeferredErrorRender &&render);
+    // Returns `error` with its deferred parts rendered.
+    static std::unique_ptr<Error> renderDeferred(const GlobalState &gs, std::unique_ptr<Error> error);
     template <typename... Args>
     void replaceWith(const std::string &title, Loc loc, ConstExprStr replacement, const Args &... args) {
         std::string formatted = fmt::format(replacement.str, args...);
@@ -1,13 +1,15 @@
 #include "core/ErrorFlusher.h"
 #include "common/FileSystem.h"
+#include "common/concurrency/WorkerPool.h"
 #include "core/lsp/QueryResponse.h"
 
 using namespace std;
 
 namespace sorbet::core {
 
-void ErrorFlusher::flushErrors(spdlog::logger &logger, vector<unique_ptr<ErrorQueueMessage>> errors) {
+void ErrorFlusher::flushErrors(spdlog::logger &logger, vector<unique_ptr<ErrorQueueMessage>> errors, bool oneLine) {
     fmt::memory_buffer critical, nonCritical;
+    const string_view separator = oneLine ? "\n"sv : "\n\n"sv;
     for (auto &error : errors) {
         if (error->kind == ErrorQueueMessage::Kind::Error) {
             if (error->error->isSilenced) {
@@ -18,7 +20,7 @@ void ErrorFlusher::flushErrors(spdlog::logger &logger, vector<unique_ptr<ErrorQu
 
             auto &out = error->error->isCritical() ? critical : nonCritical;
             if (out.size() != 0) {
-                fmt::format_to(out, "\n\n");
+                fmt::format_to(out, "{}", separator);
             }
             ENFORCE(error->text.has_value());
             fmt::format_to(out, "{}", error->text.value_or(""));
@@ -30,7 +32,7 @@ void ErrorFlusher::flushErrors(spdlog::logger &logger, vector<unique_ptr<ErrorQu
     }
 
     if (critical.size() != 0) {
-        if (!printedAtLeastOneError) {
+        if (!printedAtLeastOneError || oneLine) {
             logger.log(spdlog::level::critical, "{}", to_string(critical));
             printedAtLeastOneError = true;
         } else {
@@ -38,7 +40,7 @@ void ErrorFlusher::flushErrors(spdlog::logger &logger, vector<unique_ptr<ErrorQu
         }
     }
     if (nonCritical.size() != 0) {
-        if (!printedAtLeastOneError) {
+        if (!printedAtLeastOneError || oneLine) {
             logger.log(spdlog::level::err, "{}", to_string(nonCritical));
             printedAtLeastOneError = true;
         } else {
@@ -55,22 +57,51 @@ void ErrorFlusher::flushErrorCount(spdlog::logger &logger, int count) {
     }
 }
 
-void ErrorFlusher::flushAutocorrects(const GlobalState &gs, FileSystem &fs) {
-    UnorderedMap<FileRef, string> sources;
-    for (auto &autocorrect : autocorrects) {
-        for (auto &edit : autocorrect.edits) {
-            auto file = edit.loc.file();
-            if (!sources.count(file)) {
-                sources[file] = fs.readFile(file.data(gs).path());
+void ErrorFlusher::flushAutocorrects(const GlobalState &gs, FileSystem &fs, WorkerPool *workers) {
+    struct FileEdits {
+        FileRef file;
+        vector<AutocorrectSuggestion::Edit> edits;
+        // Only set if the edits change the file.
+        optional<string> edited;
+        exception_ptr exception;
+    };
+    vector<FileEdits> files;
+    for (auto &[file, edits] : AutocorrectSuggestion::editsByFile(move(autocorrects))) {
+        files.emplace_back(FileEdits{file, move(edits), nullopt, nullptr});
+    }
+    autocorrects.clear();
+
+    auto editFile = [&gs, &fs](FileEdits &fileEdits) {
+        try {
+            auto source = fs.readFile(fileEdits.file.data(gs).path());
+            auto edited = AutocorrectSuggestion::applyEdits(fileEdits.edits, source);
+            if (edited != source) {
+                fileEdits.edited = move(edited);
             }
+        } catch (...) {
+            fileEdits.exception = current_exception();
+        }
+    };
+    if (workers != nullptr && files.size() > 1) {
+        WorkerPool::TaskGroup group;
+        for (auto &fileEdits : files) {
+            workers->submit(group, [&editFile, &fileEdits]() { editFile(fileEdits); });
+        }
+        workers->wait(group);
+    } else {
+        for (auto &fileEdits : files) {
+            editFile(fileEdits);
         }
     }
 
-    auto toWrite = AutocorrectSuggestion::apply(autocorrects, sources);
-    for (auto &entry : toWrite) {
-        fs.writeFile(entry.first.data(gs).path(), entry.second);
+    for (auto &fileEdits : files) {
+        if (fileEdits.exception) {
+            rethrow_exception(fileEdits.exception);
+        }
+        if (fileEdits.edited) {
+            fs.writeFile(fileEdits.file.data(gs).path(), *fileEdits.edited);
+        }
     }
-    autocorrects.clear();
 }
 
 } // namespace sorbet::core
@@ -7,6 +7,7 @@
 
 namespace sorbet {
 class FileSystem;
+class WorkerPool;
 namespace core {
 
 class ErrorFlusher {
@@ -16,9 +17,12 @@ private:
 
 public:
     ErrorFlusher() = default;
-    void flushErrors(spdlog::logger &logger, std::vector<std::unique_ptr<ErrorQueueMessage>> error);
+    // With `oneLine`, errors are separated by a single newline rather than a blank line.
+    void flushErrors(spdlog::logger &logger, std::vector<std::unique_ptr<ErrorQueueMessage>> error,
+                     bool oneLine = false);
     void flushErrorCount(spdlog::logger &logger, int count);
-    void flushAutocorrects(const GlobalState &gs, FileSystem &fs);
+    // If `workers` is given, files are read and edited in parallel on it.
+    void flushAutocorrects(const GlobalState &gs, FileSystem &fs, WorkerPool *workers = nullptr);
 };
 
 } // namespace core
@@ -7,6 +7,24 @@ namespace sorbet::core {
 
 using namespace std;
 
+namespace {
+// The capture installed by the innermost live ErrorQueue::CaptureErrors on this thread, if any.
+thread_local ErrorQueue *capturingQueue = nullptr;
+thread_local vector<ErrorQueueMessage> *capturedErrors = nullptr;
+} // namespace
+
+ErrorQueue::CaptureErrors::CaptureErrors(ErrorQueue &queue, vector<ErrorQueueMessage> &into)
+    : queue(queue), previous(capturedErrors), previousQueue(capturingQueue) {
+    capturingQueue = &queue;
+    capturedErrors = &into;
+}
+
+ErrorQueue::CaptureErrors::~CaptureErrors() {
+    ENFORCE(capturingQueue == &queue);
+    capturingQueue = previousQueue;
+    capturedErrors = previous;
+}
+
 ErrorQueue::ErrorQueue(spdlog::logger &logger, spdlog::logger &tracer)
     : owner(this_thread::get_id()), logger(logger), tracer(tracer){};
 
@@ -64,15 +82,15 @@ void ErrorQueue::flushErrors(bool all) {
     } else {
         errors = drainFlushed();
     }
-    errorFlusher.flushErrors(logger, move(errors));
+    errorFlusher.flushErrors(logger, move(errors), jsonErrors);
 }
 
 void ErrorQueue::flushErrorCount() {
     errorFlusher.flushErrorCount(logger, nonSilencedErrorCount);
 }
 
-void ErrorQueue::flushAutocorrects(const GlobalState &gs, FileSystem &fs) {
-    errorFlusher.flushAutocorrects(gs, fs);
+void ErrorQueue::flushAutocorrects(const GlobalState &gs, FileSystem &fs, WorkerPool *workers) {
+    errorFlusher.flushAutocorrects(gs, fs, workers);
 }
 
 void ErrorQueue::pushError(const core::GlobalState &gs, unique_ptr<core::Error> error) {
@@ -82,12 +100,27 @@ void ErrorQueue::pushError(const core::GlobalState &gs, unique_ptr<core::Error>
     if (!error->isSilenced) {
         this->nonSilencedErrorCount.fetch_add(1);
         // Serializing errors is expensive, so we only serialize them if the error isn't silenced.
-        msg.text = error->toString(gs);
+        msg.text = jsonErrors ? error->toJSON(gs) : error->toString(gs);
     }
     msg.error = move(error);
+    if (capturingQueue == this) {
+        capturedErrors->emplace_back(move(msg));
+        return;
+    }
     this->queue.push(move(msg), 1);
 }
 
+void ErrorQueue::pushCapturedErrors(vector<ErrorQueueMessage> errors) {
+    for (auto &msg : errors) {
+        // Captures may nest, in which case the errors go to the enclosing one.
+        if (capturingQueue == this) {
+            capturedErrors->emplace_back(move(msg));
+            continue;
+        }
+        this->queue.push(move(msg), 1);
+    }
+}
+
 void ErrorQueue::collectForFile(core::FileRef whatFile, vector<unique_ptr<core::ErrorQueueMessage>> &out) {
     auto it = collected.find(whatFile);
     if (it == collected.end()) {
@@ -28,11 +28,31 @@ public:
     std::atomic<bool> hadCritical{false};
     std::atomic<int> nonSilencedErrorCount{0};
     bool ignoreFlushes{false};
+    // Render errors with `Error::toJSON` instead of `Error::toString`, and flush them one per line.
+    bool jsonErrors{false};
 
     ErrorQueue(spdlog::logger &logger, spdlog::logger &tracer);
 
+    /**
+     * While alive, errors pushed to `queue` from the current thread are appended to `into` instead of being reported.
+     * Work that is split across threads uses this to report errors in a deterministic order via `pushCapturedErrors`.
+     */
+    class CaptureErrors {
+        ErrorQueue &queue;
+        std::vector<ErrorQueueMessage> *const previous;
+        ErrorQueue *const previousQueue;
+
+    public:
+        CaptureErrors(ErrorQueue &queue, std::vector<ErrorQueueMessage> &into);
+        ~CaptureErrors();
+        CaptureErrors(const CaptureErrors &) = delete;
+        CaptureErrors &operator=(const CaptureErrors &) = delete;
+    };
+
     /** register a new error to be reported */
     void pushError(const GlobalState &gs, std::unique_ptr<Error> error);
+    /** report errors previously held back by a `CaptureErrors`, in order */
+    void pushCapturedErrors(std::vector<ErrorQueueMessage> errors);
     void pushQueryResponse(std::unique_ptr<lsp::QueryResponse> response);
     /** indicate that errors for `file` should be flushed on next call to to flushErrors */
     void markFileForFlushing(FileRef file);
@@ -45,7 +65,7 @@ public:
 
     void flushErrors(bool all = false);
     void flushErrorCount();
-    void flushAutocorrects(const GlobalState &gs, FileSystem &fs);
+    void flushAutocorrects(const GlobalState &gs, FileSystem &fs, WorkerPool *workers = nullptr);
 };
 
 } // namespace core
@@ -3,6 +3,8 @@
 
 #include "core/Names.h"
 #include "core/StrictLevel.h"
+#include <functional>
+#include <mutex>
 #include <string>
 
 namespace sorbet::core {
@@ -75,6 +77,11 @@ public:
     friend class ::sorbet::core::serialize::SerializerImpl;
 
     static StrictLevel fileSigil(std::string_view source);
+    // What `lineBreaks()` returns for a file with contents `source`.
+    static std::vector<int> findLineBreaks(std::string_view source);
+    // Replaces `source[begin, end)` with `text`, and updates `lineBreaks`, which must be `findLineBreaks(source)`, to
+    // match. Only looks at the contents that changed, so that editors can send changes to a large file cheaply.
+    static void edit(std::string &source, std::vector<int> &lineBreaks, int begin, int end, std::string_view text);
 
     std::string_view path() const;
     std::string_view source() const;
@@ -85,21 +92,50 @@ public:
     bool isStdlib() const;
 
     File(std::string &&path_, std::string &&source_, Type sourceType);
+    // Contents that a file references instead of owning. They must outlive the file and every copy of it.
+    struct BorrowedSource {
+        std::string_view source;
+    };
+    File(std::string &&path_, BorrowedSource source, Type sourceType);
+    // Contents that are only produced once something asks for them, e.g. by decompressing them. `load` runs at most
+    // once, on whichever thread first needs the contents, and copies of the file share what it returns. `sigil` is
+    // what `fileSigil` would find in them.
+    struct LazySource {
+        std::function<std::string()> load;
+        StrictLevel sigil;
+    };
+    File(std::string &&path_, LazySource source, Type sourceType);
     File(File &&other) = delete;
     File(const File &other) = delete;
     File() = delete;
     std::unique_ptr<File> deepCopy(GlobalState &) const;
     std::vector<int> &lineBreaks() const;
+    // Makes `lineBreaks()` return `lineBreaks`, which must be what it would have computed, instead of searching the
+    // contents for them.
+    void setLineBreaks(std::shared_ptr<std::vector<int>> lineBreaks);
     int lineCount() const;
     StrictLevel minErrorLevel() const;
+    // A 16 byte digest of `source()`, for keying caches by the contents of the file. Computed on first use and kept,
+    // so that every cache looked up for the file hashes its contents only once.
+    std::string_view contentHash() const;
 
     /** Given a 1-based line number, returns a string view of the line. */
     std::string_view getLine(int i);
 
 private:
     const std::string path_;
+    struct LoadedSource {
+        std::once_flag loaded;
+        std::function<std::string()> load;
+        std::string source;
+    };
+    // Empty if the contents are borrowed or loaded on demand.
     const std::string source_;
+    const std::string_view sourceView_;
+    // Set if the contents are loaded on demand.
+    std::shared_ptr<LoadedSource> lazySource_;
     mutable std::shared_ptr<std::vector<int>> lineBreaks_;
+    mutable std::shared_ptr<std::array<u1, 16>> contentHash_;
     mutable StrictLevel minErrorLevel_ = StrictLevel::Max;
 
 public:
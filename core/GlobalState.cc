@@ -1,6 +1,8 @@
 #include "GlobalState.h"
 
+#include "common/SmallObjectPool.h"
 #include "common/Timer.h"
+#include "common/typecase.h"
 #include "core/Error.h"
 #include "core/Hashing.h"
 #include "core/NameHash.h"
@@ -44,11 +46,12 @@ SymbolRef GlobalState::synthesizeClass(NameRef nameId, u4 superclass, bool isMod
 }
 
 atomic<int> globalStateIdCounter(1);
+atomic<u8> symbolTableVersionCounter(1);
 const int Symbols::MAX_PROC_ARITY;
 
 GlobalState::GlobalState(shared_ptr<ErrorQueue> errorQueue)
     : globalStateId(globalStateIdCounter.fetch_add(1)), errorQueue(std::move(errorQueue)),
-      lspQuery(lsp::Query::noQuery()) {
+      lspQuery(lsp::Query::noQuery()), symbolTableVersion(symbolTableVersionCounter.fetch_add(1)) {
     // Empirically determined to be the smallest powers of two larger than the
     // values required by the payload
     unsigned int maxNameCount = 8192;
@@ -579,6 +582,116 @@ void GlobalState::reserveMemory(u4 kb) {
                        " names=", names.capacity()));
 }
 
+void GlobalState::reserveTables(u4 nameCount, u4 symbolCount, u4 fileCount) {
+    if (nameCount > names.capacity()) {
+        // `namesByHash` has to stay a power of two, so grow both by the same power of two.
+        expandNames(nextPowerOfTwo((nameCount + names.capacity() - 1) / names.capacity()));
+    }
+    symbols.reserve(symbolCount);
+    files.reserve(fileCount);
+    sanityCheck();
+
+    trace(absl::StrCat("Reserved tables for symbols=", symbols.capacity(), " names=", names.capacity(),
+                       " files=", files.capacity()));
+}
+
+namespace {
+template <class T, size_t N> u8 heapBytes(const InlinedVector<T, N> &vec) {
+    return vec.capacity() > N ? vec.capacity() * sizeof(T) : 0;
+}
+
+template <class T> u8 heapBytes(const vector<T> &vec) {
+    return vec.capacity() * sizeof(T);
+}
+
+// Adds the size of `type`, and of the types it is made of that haven't been `seen` yet, to `bytes`.
+void addTypeBytes(const TypePtr &type, UnorderedSet<const Type *> &seen, u8 &bytes) {
+    if (type == nullptr || !seen.insert(type.get()).second) {
+        return;
+    }
+    typecase(
+        type.get(),
+        [&](OrType *orType) {
+            bytes += sizeof(OrType);
+            addTypeBytes(orType->left, seen, bytes);
+            addTypeBytes(orType->right, seen, bytes);
+        },
+        [&](AndType *andType) {
+            bytes += sizeof(AndType);
+            addTypeBytes(andType->left, seen, bytes);
+            addTypeBytes(andType->right, seen, bytes);
+        },
+        [&](AppliedType *applied) {
+            bytes += sizeof(AppliedType) + heapBytes(applied->targs);
+            for (auto &targ : applied->targs) {
+                addTypeBytes(targ, seen, bytes);
+            }
+        },
+        [&](ShapeType *shape) {
+            bytes += sizeof(ShapeType) + heapBytes(shape->keys) + heapBytes(shape->values);
+            for (auto &value : shape->values) {
+                addTypeBytes(value, seen, bytes);
+            }
+        },
+        [&](TupleType *tuple) {
+            bytes += sizeof(TupleType) + heapBytes(tuple->elems);
+            for (auto &elem : tuple->elems) {
+                addTypeBytes(elem, seen, bytes);
+            }
+        },
+        [&](MetaType *meta) {
+            bytes += sizeof(MetaType);
+            addTypeBytes(meta->wrapped, seen, bytes);
+        },
+        [&](LambdaParam *param) {
+            bytes += sizeof(LambdaParam);
+            addTypeBytes(param->lowerBound, seen, bytes);
+            addTypeBytes(param->upperBound, seen, bytes);
+        },
+        [&](LiteralType *) { bytes += sizeof(LiteralType); },
+        [&](ClassType *) { bytes += sizeof(ClassType); },
+        // The rest only refer to symbols, and are all about as big.
+        [&](Type *) { bytes += sizeof(TypeVar); });
+}
+} // namespace
+
+MemoryUsage GlobalState::memoryUsage() const {
+    MemoryUsage usage;
+    usage.names = sizeof(Name) * names.capacity() + heapBytes(namesByHash);
+    for (auto &page : strings) {
+        usage.strings += page->capacity();
+    }
+    usage.strings += heapBytes(strings);
+
+    UnorderedSet<const Type *> seenTypes;
+    usage.symbols = sizeof(Symbol) * symbols.capacity();
+    for (auto &symbol : symbols) {
+        usage.symbols += symbol.members().heapBytes() + heapBytes(symbol.arguments()) + heapBytes(symbol.mixins_) +
+                         heapBytes(symbol.typeParams) + heapBytes(symbol.locs_);
+        addTypeBytes(symbol.resultType, seenTypes, usage.types);
+        for (auto &arg : symbol.arguments()) {
+            addTypeBytes(arg.type, seenTypes, usage.types);
+        }
+    }
+
+    usage.files = heapBytes(files) + fileRefByPath.capacity() * (sizeof(decltype(fileRefByPath)::value_type) + 1);
+    for (auto &[path, _] : fileRefByPath) {
+        usage.files += path.capacity();
+    }
+    for (auto &file : files) {
+        if (file == nullptr) {
+            continue;
+        }
+        usage.files += sizeof(File) + file->path_.capacity() + file->source_.capacity();
+        if (file->lineBreaks_ != nullptr) {
+            usage.files += heapBytes(*file->lineBreaks_);
+        }
+    }
+
+    usage.trees = SmallObjectPool::slabBytes();
+    return usage;
+}
+
 constexpr decltype(GlobalState::STRINGS_PAGE_SIZE) GlobalState::STRINGS_PAGE_SIZE;
 
 // look up a symbol whose flags match the desired flags. This might look through mangled names to discover one whose
@@ -592,10 +705,9 @@ SymbolRef GlobalState::lookupSymbolWithFlags(SymbolRef owner, NameRef name, u4 f
     NameRef lookupName = name;
     u2 unique = 1;
     auto res = ownerScope->members().find(lookupName);
-    while (res != ownerScope->members().end()) {
-        ENFORCE(res->second.exists());
-        if ((res->second.data(*this)->flags & flags) == flags) {
-            return res->second;
+    while (res.exists()) {
+        if ((res.data(*this)->flags & flags) == flags) {
+            return res;
         }
         lookupName = lookupNameUnique(UniqueNameKind::MangleRename, name, unique);
         if (!lookupName.exists()) {
@@ -794,8 +906,59 @@ string_view GlobalState::enterString(string_view nm) {
     return string_view(from, nm.size());
 }
 
+namespace {
+// Like absl::MutexLockMaybe, but shared.
+class ReaderMutexLockMaybe {
+    absl::Mutex *const mu;
+
+public:
+    explicit ReaderMutexLockMaybe(absl::Mutex *mu) : mu(mu) {
+        if (mu != nullptr) {
+            mu->ReaderLock();
+        }
+    }
+    ~ReaderMutexLockMaybe() {
+        if (mu != nullptr) {
+            mu->ReaderUnlock();
+        }
+    }
+    ReaderMutexLockMaybe(const ReaderMutexLockMaybe &) = delete;
+    ReaderMutexLockMaybe &operator=(const ReaderMutexLockMaybe &) = delete;
+};
+} // namespace
+
+NameRef GlobalState::lookupNameUTF8(unsigned int hs, string_view nm) const {
+    ReaderMutexLockMaybe lock(concurrentNamesMutex.get());
+    unsigned int mask = namesByHash.size() - 1;
+    auto bucketId = hs & mask;
+    unsigned int probeCount = 1;
+
+    while (namesByHash[bucketId].second != 0u) {
+        auto &bucket = namesByHash[bucketId];
+        if (bucket.first == hs) {
+            auto &nm2 = names[bucket.second];
+            if (nm2.kind == NameKind::UTF8 && nm2.raw.utf8 == nm) {
+                counterInc("names.utf8.hit");
+                histogramInc("names.utf8.probes", probeCount);
+                return NameRef(*this, bucket.second);
+            }
+        }
+        bucketId = (bucketId + probeCount) & mask;
+        probeCount++;
+    }
+    return NameRef::noName();
+}
+
 NameRef GlobalState::enterNameUTF8(string_view nm) {
     const auto hs = _hash(nm);
+    if (concurrentNamesMutex != nullptr) {
+        // Most names have been entered before, and other threads can look for them at the same time.
+        auto found = lookupNameUTF8(hs, nm);
+        if (found.exists()) {
+            return found;
+        }
+    }
+    absl::MutexLockMaybe lock(concurrentNamesMutex.get());
     unsigned int hashTableSize = namesByHash.size();
     unsigned int mask = hashTableSize - 1;
     auto bucketId = hs & mask;
@@ -808,7 +971,8 @@ NameRef GlobalState::enterNameUTF8(string_view nm) {
             auto &nm2 = names[nameId];
             if (nm2.kind == NameKind::UTF8 && nm2.raw.utf8 == nm) {
                 counterInc("names.utf8.hit");
-                return nm2.ref(*this);
+                histogramInc("names.utf8.probes", probeCount);
+                return NameRef(*this, nameId);
             } else {
                 counterInc("names.hash_collision.utf8");
             }
@@ -832,6 +996,7 @@ NameRef GlobalState::enterNameUTF8(string_view nm) {
         }
     }
 
+    histogramInc("names.utf8.probes", probeCount);
     auto idx = names.size();
     auto &bucket = namesByHash[bucketId];
     bucket.first = hs;
@@ -856,6 +1021,13 @@ NameRef GlobalState::enterNameConstant(NameRef original) {
             "making a constant name over wrong name kind");
 
     const auto hs = _hash_mix_constant(CONSTANT, original.id());
+    if (concurrentNamesMutex != nullptr) {
+        auto found = lookupNameConstant(hs, original);
+        if (found.exists()) {
+            return found;
+        }
+    }
+    absl::MutexLockMaybe lock(concurrentNamesMutex.get());
     unsigned int hashTableSize = namesByHash.size();
     unsigned int mask = hashTableSize - 1;
     auto bucketId = hs & mask;
@@ -867,7 +1039,7 @@ NameRef GlobalState::enterNameConstant(NameRef original) {
             auto &nm2 = names[bucket.second];
             if (nm2.kind == CONSTANT && nm2.cnst.original == original) {
                 counterInc("names.constant.hit");
-                return nm2.ref(*this);
+                return NameRef(*this, bucket.second);
             } else {
                 counterInc("names.hash_collision.constant");
             }
@@ -908,6 +1080,28 @@ NameRef GlobalState::enterNameConstant(NameRef original) {
     return NameRef(*this, idx);
 }
 
+NameRef GlobalState::lookupNameConstant(unsigned int hs, NameRef original) const {
+    ReaderMutexLockMaybe lock(concurrentNamesMutex.get());
+    unsigned int hashTableSize = namesByHash.size();
+    unsigned int mask = hashTableSize - 1;
+    auto bucketId = hs & mask;
+    unsigned int probeCount = 1;
+
+    while (namesByHash[bucketId].second != 0 && probeCount < hashTableSize) {
+        auto &bucket = namesByHash[bucketId];
+        if (bucket.first == hs) {
+            auto &nm2 = names[bucket.second];
+            if (nm2.kind == CONSTANT && nm2.cnst.original == original) {
+                counterInc("names.constant.hit");
+                return NameRef(*this, bucket.second);
+            }
+        }
+        bucketId = (bucketId + probeCount) & mask;
+        probeCount++;
+    }
+    return NameRef::noName();
+}
+
 NameRef GlobalState::enterNameConstant(string_view original) {
     return enterNameConstant(enterNameUTF8(original));
 }
@@ -934,6 +1128,7 @@ void moveNames(pair<unsigned int, unsigned int> *from, pair<unsigned int, unsign
 
 void GlobalState::expandNames(int growBy) {
     sanityCheck();
+    // Runs with `concurrentNamesMutex` held exclusively, if set, so nobody is probing `namesByHash`.
 
     names.reserve(names.capacity() * growBy);
     vector<pair<unsigned int, unsigned int>> new_namesByHash(namesByHash.capacity() * growBy);
@@ -944,6 +1139,7 @@ void GlobalState::expandNames(int growBy) {
 NameRef GlobalState::lookupNameUnique(UniqueNameKind uniqueNameKind, NameRef original, u2 num) const {
     ENFORCE(num > 0, "num == 0, name overflow");
     const auto hs = _hash_mix_unique((u2)uniqueNameKind, UNIQUE, num, original.id());
+    ReaderMutexLockMaybe lock(concurrentNamesMutex.get());
     unsigned int hashTableSize = namesByHash.size();
     unsigned int mask = hashTableSize - 1;
     auto bucketId = hs & mask;
@@ -956,7 +1152,7 @@ NameRef GlobalState::lookupNameUnique(UniqueNameKind uniqueNameKind, NameRef ori
             if (nm2.kind == UNIQUE && nm2.unique.uniqueNameKind == uniqueNameKind && nm2.unique.num == num &&
                 nm2.unique.original == original) {
                 counterInc("names.unique.hit");
-                return nm2.ref(*this);
+                return NameRef(*this, bucket.second);
             } else {
                 counterInc("names.hash_collision.unique");
             }
@@ -969,7 +1165,14 @@ NameRef GlobalState::lookupNameUnique(UniqueNameKind uniqueNameKind, NameRef ori
 
 NameRef GlobalState::freshNameUnique(UniqueNameKind uniqueNameKind, NameRef original, u2 num) {
     ENFORCE(num > 0, "num == 0, name overflow");
+    if (concurrentNamesMutex != nullptr) {
+        auto found = lookupNameUnique(uniqueNameKind, original, num);
+        if (found.exists()) {
+            return found;
+        }
+    }
     const auto hs = _hash_mix_unique((u2)uniqueNameKind, UNIQUE, num, original.id());
+    absl::MutexLockMaybe lock(concurrentNamesMutex.get());
     unsigned int hashTableSize = namesByHash.size();
     unsigned int mask = hashTableSize - 1;
     auto bucketId = hs & mask;
@@ -982,7 +1185,7 @@ NameRef GlobalState::freshNameUnique(UniqueNameKind uniqueNameKind, NameRef orig
             if (nm2.kind == UNIQUE && nm2.unique.uniqueNameKind == uniqueNameKind && nm2.unique.num == num &&
                 nm2.unique.original == original) {
                 counterInc("names.unique.hit");
-                return nm2.ref(*this);
+                return NameRef(*this, bucket.second);
             } else {
                 counterInc("names.hash_collision.unique");
             }
@@ -1069,16 +1272,14 @@ void GlobalState::mangleRenameSymbol(SymbolRef what, NameRef origName) {
     auto owner = whatData->owner;
     auto ownerData = owner.data(*this);
     auto &ownerMembers = ownerData->members();
-    auto fnd = ownerMembers.find(origName);
-    ENFORCE(fnd != ownerMembers.end());
-    ENFORCE(fnd->second == what);
+    ENFORCE(ownerMembers.find(origName) == what);
     ENFORCE(whatData->name == origName);
     u2 collisionCount = 1;
     NameRef name;
     do {
         name = freshNameUnique(UniqueNameKind::MangleRename, origName, collisionCount++);
     } while (ownerData->findMember(*this, name).exists());
-    ownerMembers.erase(fnd);
+    ownerMembers.erase(origName);
     ownerMembers[name] = what;
     whatData->name = name;
     if (whatData->isClass()) {
@@ -1089,6 +1290,74 @@ void GlobalState::mangleRenameSymbol(SymbolRef what, NameRef origName) {
     }
 }
 
+absl::Span<const SymbolRef> GlobalState::AncestorCache::range(const vector<SymbolRef> &of, SymbolRef klass) const {
+    if (klass._id + 1 >= offsets.size()) {
+        return absl::Span<const SymbolRef>();
+    }
+    auto begin = offsets[klass._id];
+    return absl::Span<const SymbolRef>(of.data() + begin, offsets[klass._id + 1] - begin);
+}
+
+void GlobalState::computeAncestorCache() {
+    Timer timeit(tracer(), "GlobalState::computeAncestorCache");
+    // Same limit as findMemberTransitive, which reports longer chains as loops.
+    constexpr int maxDepth = 100;
+    auto cache = make_shared<AncestorCache>();
+    const auto &constSymbols = symbols;
+    cache->offsets.reserve(constSymbols.size() + 1);
+    cache->offsets.emplace_back(0);
+    for (u4 i = 0; i < constSymbols.size(); i++) {
+        auto &linearization = cache->linearization;
+        auto begin = linearization.size();
+        if (constSymbols[i].isClass() && constSymbols[i].isClassLinearizationComputed()) {
+            SymbolRef cursor(this, i);
+            int depth = 0;
+            while (cursor.exists()) {
+                const auto &data = constSymbols[cursor._id];
+                if (!data.isClassLinearizationComputed() || ++depth > maxDepth) {
+                    // Leave this class to the uncached paths, which know how to deal with it.
+                    linearization.resize(begin);
+                    break;
+                }
+                linearization.emplace_back(cursor);
+                linearization.insert(linearization.end(), data.mixins().begin(), data.mixins().end());
+                cursor = data.superClass();
+            }
+        }
+        cache->offsets.emplace_back(linearization.size());
+    }
+
+    cache->sorted.reserve(cache->linearization.size());
+    vector<SymbolRef> ancestors;
+    for (u4 i = 0; i + 1 < cache->offsets.size(); i++) {
+        auto range = cache->range(cache->linearization, SymbolRef(this, i));
+        ancestors.assign(range.begin(), range.end());
+        fast_sort(ancestors, [](SymbolRef left, SymbolRef right) { return left._id < right._id; });
+        cache->sorted.insert(cache->sorted.end(), ancestors.begin(), ancestors.end());
+    }
+    counterAdd("resolve.ancestor_cache.entries", cache->linearization.size());
+    ancestorCache = move(cache);
+}
+
+void GlobalState::clearAncestorCache() {
+    ancestorCache = nullptr;
+}
+
+const void *GlobalState::hierarchyVersion() const {
+    return ancestorCache.get();
+}
+
+shared_ptr<const void> GlobalState::pinHierarchyVersion() const {
+    return ancestorCache;
+}
+
+u8 GlobalState::frozenSymbolTableVersion() const {
+    if (!symbolTableFrozen || ancestorCache == nullptr) {
+        return 0;
+    }
+    return symbolTableVersion;
+}
+
 unsigned int GlobalState::symbolsUsed() const {
     return symbols.size();
 }
@@ -1114,9 +1383,13 @@ void GlobalState::sanityCheck() const {
         return;
     }
 
+    if (concurrentNamesMutex != nullptr) {
+        // Other threads may be entering names. ~UnfreezeTablesForIndexing checks once they're done.
+        return;
+    }
+
     Timer timeit(tracer(), "GlobalState::sanityCheck");
     ENFORCE(!names.empty(), "empty name table size");
-    ENFORCE(!strings.empty(), "empty string table size");
     ENFORCE(!namesByHash.empty(), "empty name hash table size");
     ENFORCE((namesByHash.size() & (namesByHash.size() - 1)) == 0, "name hash table size is not a power of two");
     ENFORCE(names.capacity() * 2 == namesByHash.capacity(),
@@ -1126,7 +1399,7 @@ void GlobalState::sanityCheck() const {
     int i = -1;
     for (auto &nm : names) {
         i++;
-        if (i != 0) {
+        if (i != 0 && inSanityCheckSample(i)) {
             nm.sanityCheck(*this);
         }
     }
@@ -1134,12 +1407,12 @@ void GlobalState::sanityCheck() const {
     i = -1;
     for (auto &sym : symbols) {
         i++;
-        if (i != 0) {
+        if (i != 0 && inSanityCheckSample(i)) {
             sym.sanityCheck(*this);
         }
     }
     for (auto &ent : namesByHash) {
-        if (ent.second == 0) {
+        if (ent.second == 0 || !inSanityCheckSample(ent.second)) {
             continue;
         }
         const Name &nm = names[ent.second];
@@ -1148,12 +1421,19 @@ void GlobalState::sanityCheck() const {
 }
 
 bool GlobalState::freezeNameTable() {
+    if (concurrentNamesMutex != nullptr) {
+        // Unfrozen for all threads by UnfreezeTablesForIndexing.
+        return false;
+    }
     bool old = this->nameTableFrozen;
     this->nameTableFrozen = true;
     return old;
 }
 
 bool GlobalState::freezeFileTable() {
+    if (concurrentNamesMutex != nullptr) {
+        return false;
+    }
     bool old = this->fileTableFrozen;
     this->fileTableFrozen = true;
     return old;
@@ -1166,12 +1446,18 @@ bool GlobalState::freezeSymbolTable() {
 }
 
 bool GlobalState::unfreezeNameTable() {
+    if (concurrentNamesMutex != nullptr) {
+        return true;
+    }
     bool old = this->nameTableFrozen;
     this->nameTableFrozen = false;
     return old;
 }
 
 bool GlobalState::unfreezeFileTable() {
+    if (concurrentNamesMutex != nullptr) {
+        return true;
+    }
     bool old = this->fileTableFrozen;
     this->fileTableFrozen = false;
     return old;
@@ -1180,6 +1466,7 @@ bool GlobalState::unfreezeFileTable() {
 bool GlobalState::unfreezeSymbolTable() {
     bool old = this->symbolTableFrozen;
     this->symbolTableFrozen = false;
+    this->symbolTableVersion = symbolTableVersionCounter.fetch_add(1);
     return old;
 }
 
@@ -1194,6 +1481,10 @@ unique_ptr<GlobalState> GlobalState::deepCopy(bool keepId) const {
     result->ensureCleanStrings = this->ensureCleanStrings;
     result->runningUnderAutogen = this->runningUnderAutogen;
     result->censorForSnapshotTests = this->censorForSnapshotTests;
+    result->typecheckShard = this->typecheckShard;
+    result->typecheckShardCount = this->typecheckShardCount;
+    result->sanityCheckSample = this->sanityCheckSample;
+    result->sanityCheckSeed = this->sanityCheckSeed;
 
     if (keepId) {
         result->globalStateId = this->globalStateId;
@@ -1212,23 +1503,24 @@ unique_ptr<GlobalState> GlobalState::deepCopy(bool keepId) const {
     result->onlyErrorClasses = this->onlyErrorClasses;
     result->dslPlugins = this->dslPlugins;
     result->dslRubyExtraArgs = this->dslRubyExtraArgs;
-    result->names.reserve(this->names.capacity());
+    result->ancestorCache = this->ancestorCache;
     if (keepId) {
-        result->names.resize(this->names.size());
-        ::memcpy(result->names.data(), this->names.data(), this->names.size() * sizeof(Name));
+        // Names and symbols refer to each other by id only, so the copy can share them until either side writes.
+        result->names = this->names;
+        result->symbols = this->symbols;
     } else {
+        result->names.reserve(this->names.capacity());
         for (auto &nm : this->names) {
             result->names.emplace_back(nm.deepCopy(*result));
         }
+        result->symbols.reserve(this->symbols.size());
+        for (auto &sym : this->symbols) {
+            result->symbols.emplace_back(sym.deepCopy(*result));
+        }
     }
 
     result->namesByHash.reserve(this->namesByHash.size());
     result->namesByHash = this->namesByHash;
-
-    result->symbols.reserve(this->symbols.size());
-    for (auto &sym : this->symbols) {
-        result->symbols.emplace_back(sym.deepCopy(*result, keepId));
-    }
     result->pathPrefix = this->pathPrefix;
     for (auto &semanticExtension : this->semanticExtensions) {
         result->semanticExtensions.emplace_back(semanticExtension->deepCopy(*this, *result));
@@ -1254,6 +1546,7 @@ int GlobalState::totalErrors() const {
 }
 
 void GlobalState::_error(unique_ptr<Error> error) const {
+    error = ErrorBuilder::renderDeferred(*this, move(error));
     if (error->isCritical()) {
         errorQueue->hadCritical = true;
     }
@@ -1309,6 +1602,24 @@ bool GlobalState::hasAnyDslPlugin() const {
     return !dslPlugins.empty();
 }
 
+bool GlobalState::inTypecheckShard(FileRef file) const {
+    if (typecheckShardCount <= 1) {
+        return true;
+    }
+    if (!file.exists()) {
+        return typecheckShard == 0;
+    }
+    return _hash(file.data(*this).path()) % typecheckShardCount == typecheckShard;
+}
+
+bool GlobalState::inSanityCheckSample(u4 id) const {
+    if (sanityCheckSample <= 1) {
+        return true;
+    }
+    // Multiplying by an odd constant spreads consecutive ids over the high bits, so that the sample isn't a stride.
+    return (((id ^ sanityCheckSeed) * 0x9E3779B1u) >> 8) % sanityCheckSample == 0;
+}
+
 bool GlobalState::shouldReportErrorOn(Loc loc, ErrorClass what) const {
     if (what.minLevel == StrictLevel::Internal) {
         return true;
@@ -1316,6 +1627,9 @@ bool GlobalState::shouldReportErrorOn(Loc loc, ErrorClass what) const {
     if (this->silenceErrors) {
         return false;
     }
+    if (!inTypecheckShard(loc.file())) {
+        return false;
+    }
     StrictLevel level = StrictLevel::Strong;
     if (loc.file().exists()) {
         level = loc.file().data(*this).strictLevel;
@@ -1400,16 +1714,23 @@ u4 patchHash(u4 hash) {
 unique_ptr<GlobalStateHash> GlobalState::hash() const {
     constexpr bool DEBUG_HASHING_TAIL = false;
     u4 hierarchyHash = 0;
+    u4 classHierarchyHash = 0;
     UnorderedMap<NameHash, u4> methodHashes;
+    UnorderedMap<NameHash, u4> methodShapeHashes;
     int counter = 0;
     for (const auto &sym : this->symbols) {
         if (!sym.ignoreInHashing(*this)) {
             if (sym.isMethod()) {
-                auto &target = methodHashes[NameHash(*this, sym.name.data(*this))];
+                NameHash name(*this, sym.name.data(*this));
+                auto &target = methodHashes[name];
                 target = mix(target, sym.hash(*this));
-                hierarchyHash = mix(hierarchyHash, sym.methodShapeHash(*this));
+                auto shapeHash = sym.methodShapeHash(*this);
+                hierarchyHash = mix(hierarchyHash, shapeHash);
+                auto &shapeTarget = methodShapeHashes[name];
+                shapeTarget = mix(shapeTarget, shapeHash);
             } else {
                 hierarchyHash = mix(hierarchyHash, sym.hash(*this));
+                classHierarchyHash = mix(classHierarchyHash, sym.hashIgnoringMethods(*this));
             }
         }
         counter++;
@@ -1421,7 +1742,11 @@ unique_ptr<GlobalStateHash> GlobalState::hash() const {
     for (const auto &e : methodHashes) {
         result->methodHashes[e.first] = patchHash(e.second);
     }
+    for (const auto &e : methodShapeHashes) {
+        result->methodShapeHashes[e.first] = patchHash(e.second);
+    }
     result->hierarchyHash = patchHash(hierarchyHash);
+    result->classHierarchyHash = patchHash(classHierarchyHash);
     return result;
 }
 
@@ -1,11 +1,14 @@
 #ifndef SORBET_GLOBAL_STATE_H
 #define SORBET_GLOBAL_STATE_H
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "core/CopyOnWriteVector.h"
 
 #include "core/Error.h"
 #include "core/ErrorQueue.h"
 #include "core/Files.h"
 #include "core/Loc.h"
+#include "core/MemoryUsage.h"
 #include "core/Names.h"
 #include "core/Symbols.h"
 #include "core/lsp/Query.h"
@@ -41,6 +44,7 @@ class GlobalState final {
     friend serialize::Serializer;
     friend serialize::SerializerImpl;
     friend class UnfreezeNameTable;
+    friend class UnfreezeTablesForIndexing;
     friend class UnfreezeSymbolTable;
     friend class UnfreezeFileTable;
     friend struct NameRefDebugCheck;
@@ -54,6 +58,11 @@ public:
     // Expand tables to use approximate `kb` KiB of memory. Can be used prior to
     // operation to avoid table resizes.
     void reserveMemory(u4 kb);
+    // Expand tables to hold at least this many names, symbols and files without growing, e.g. sized after a previous
+    // run over the same codebase.
+    void reserveTables(u4 nameCount, u4 symbolCount, u4 fileCount);
+    // Walks the tables of this GlobalState, see MemoryUsage. O(symbols + files).
+    MemoryUsage memoryUsage() const;
 
     GlobalState(const GlobalState &) = delete;
     GlobalState(GlobalState &&) = delete;
@@ -107,6 +116,22 @@ public:
     FileRef findFileByPath(std::string_view path) const;
 
     void mangleRenameSymbol(SymbolRef what, NameRef origName);
+
+    // Flattens the ancestors of every class whose linearization has been computed, so that `SymbolRef::derivesFrom`
+    // and `Symbol::findMemberTransitive` don't have to walk them. Called by the resolver once it's done changing
+    // superclasses and mixins; the result is shared by copies of this GlobalState. `clearAncestorCache` must be
+    // called before the hierarchy changes again.
+    void computeAncestorCache();
+    void clearAncestorCache();
+    // Identifies the class hierarchy that the ancestor cache was computed from, or null when there is none, so that
+    // results that only depend on the hierarchy can be memoized. Holding on to the pinned version keeps its address
+    // from being reused for another one.
+    const void *hierarchyVersion() const;
+    std::shared_ptr<const void> pinHierarchyVersion() const;
+    // Identifies the contents of the symbol table while it is frozen and `hierarchyVersion` is set, so that lookups
+    // into it can be memoized, and is 0 otherwise. No two symbol tables share a version, even across copies.
+    u8 frozenSymbolTableVersion() const;
+
     spdlog::logger &tracer() const;
     unsigned int namesUsed() const;
 
@@ -166,6 +191,22 @@ public:
     bool runningUnderAutogen = false;
     bool censorForSnapshotTests = false;
 
+    // Only files in shard `typecheckShard` of `typecheckShardCount` are typechecked and report errors, so that separate
+    // processes can split one run between them. Queries still typecheck the files they're about, so that each of several
+    // language servers can answer them for the whole workspace while only publishing diagnostics for its shard.
+    u4 typecheckShard = 0;
+    u4 typecheckShardCount = 1;
+    // Files go to shards by a hash of their path, so that every process agrees on the split; errors without a file
+    // belong to shard 0.
+    bool inTypecheckShard(FileRef file) const;
+
+    // In debug builds, `sanityCheck` and the resolver's sanity check only look at about one in `sanityCheckSample` of
+    // the names, symbols and files, picked by a hash of their ids seeded with `sanityCheckSeed`, so that checking
+    // invariants stays affordable on large codebases. Different seeds check different parts of the tables.
+    u4 sanityCheckSample = 1;
+    u4 sanityCheckSeed = 0;
+    bool inSanityCheckSample(u4 id) const;
+
     std::unique_ptr<GlobalState> deepCopy(bool keepId = false) const;
     mutable std::shared_ptr<ErrorQueue> errorQueue;
 
@@ -214,9 +255,10 @@ private:
     std::vector<std::shared_ptr<std::vector<char>>> strings;
     std::string_view enterString(std::string_view nm);
     u2 stringsLastPageUsed = STRINGS_PAGE_SIZE + 1;
-    std::vector<Name> names;
+    // Copy-on-write, so that `deepCopy(true)` shares them with the copy rather than copying every name and symbol.
+    CopyOnWriteVector<Name> names;
     UnorderedMap<std::string, FileRef> fileRefByPath;
-    std::vector<Symbol> symbols;
+    CopyOnWriteVector<Symbol> symbols;
     std::vector<std::pair<unsigned int, unsigned int>> namesByHash;
     std::vector<std::shared_ptr<File>> files;
     UnorderedSet<int> suppressedErrorClasses;
@@ -233,9 +275,32 @@ private:
     bool nameTableFrozen = true;
     bool symbolTableFrozen = true;
     bool fileTableFrozen = true;
+    // Set to a value that no GlobalState has had before whenever the symbol table is unfrozen, see
+    // `frozenSymbolTableVersion`.
+    u8 symbolTableVersion;
 
     void expandNames(int growBy = 2);
 
+    // Only set while an UnfreezeTablesForIndexing is alive. Writers to `names`, `namesByHash` and `strings` then hold it
+    // exclusively, and lookups in `namesByHash` hold it shared. Looking up a name by id never needs it.
+    std::unique_ptr<absl::Mutex> concurrentNamesMutex;
+    NameRef lookupNameUTF8(unsigned int hs, std::string_view nm) const;
+    NameRef lookupNameConstant(unsigned int hs, NameRef original) const;
+
+    struct AncestorCache {
+        // The ancestors of the class with id `i` are at `[offsets[i], offsets[i + 1])` in both vectors below. Classes
+        // that didn't have a computed linearization, or that were entered afterwards, have none.
+        std::vector<u4> offsets;
+        // The class itself, its mixins, then the same for its superclass and so on: the order in which
+        // `findMemberTransitive` looks for members.
+        std::vector<SymbolRef> linearization;
+        // The same, sorted by id.
+        std::vector<SymbolRef> sorted;
+
+        absl::Span<const SymbolRef> range(const std::vector<SymbolRef> &of, SymbolRef klass) const;
+    };
+    std::shared_ptr<const AncestorCache> ancestorCache;
+
     SymbolRef synthesizeClass(NameRef nameID, u4 superclass = Symbols::todo()._id, bool isModule = false);
     SymbolRef enterSymbol(Loc loc, SymbolRef owner, NameRef name, u4 flags);
 
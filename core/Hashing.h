@@ -2,6 +2,7 @@
 #define SORBET_HASHING_H
 
 #include "core/Names.h"
+#include <cstring>
 
 namespace sorbet::core {
 static constexpr unsigned int HASH_MULT = 65599; // sdbm
@@ -19,20 +20,42 @@ inline unsigned int _hash_mix_constant(NameKind nk, unsigned int id) {
     return id * HASH_MULT2 + _NameKind2Id_CONSTANT(nk);
 }
 
-inline unsigned int _hash(std::string_view utf8) {
-    // TODO: replace with http://www.sanmayce.com/Fastest_Hash/, see https://www.strchr.com/hash_functions
-    // and https://github.com/rurban/smhasher
-    auto end = utf8.end();
-    unsigned int res = 0;
-    auto it = utf8.begin();
-#ifndef HAS_SANITIZER
-#pragma clang loop unroll(enable)
-#endif
-    for (; it != end; it++) {
-        res = mix(res, *it - '!'); // "!" is the first printable letter in ASCII.
-        // This will help Latin1 but may harm utf8 multibyte
+// Folds 8 bytes of a string into `acc`, like a block of MurmurHash3's x64 variant.
+inline u8 _hash_mix_word(u8 acc, u8 word) {
+    word *= 0x87c37b91114253d5ULL;
+    word = (word << 31) | (word >> 33);
+    word *= 0x4cf5ad432745937fULL;
+    acc ^= word;
+    acc = (acc << 27) | (acc >> 37);
+    return acc * 5 + 0x52dce729;
+}
+
+// Reads the string a word at a time, and ends with MurmurHash3's finalizer, so that every bit of the result depends on
+// every byte.
+inline u8 _hash64(std::string_view utf8) {
+    const char *it = utf8.data();
+    size_t left = utf8.size();
+    u8 acc = utf8.size();
+    for (; left >= 8; it += 8, left -= 8) {
+        u8 word;
+        memcpy(&word, it, 8);
+        acc = _hash_mix_word(acc, word);
+    }
+    if (left > 0) {
+        u8 word = 0;
+        memcpy(&word, it, left);
+        acc = _hash_mix_word(acc, word);
     }
-    return res * HASH_MULT2 + _NameKind2Id_UTF8(UTF8);
+    acc ^= acc >> 33;
+    acc *= 0xff51afd7ed558ccdULL;
+    acc ^= acc >> 33;
+    acc *= 0xc4ceb9fe1a85ec53ULL;
+    acc ^= acc >> 33;
+    return acc;
+}
+
+inline unsigned int _hash(std::string_view utf8) {
+    return static_cast<unsigned int>(_hash64(utf8)) * HASH_MULT2 + _NameKind2Id_UTF8(UTF8);
 }
 } // namespace sorbet::core
 #endif // SORBET_HASHING_H
@@ -0,0 +1,208 @@
+#ifndef SORBET_CORE_MEMBERTABLE_H
+#define SORBET_CORE_MEMBERTABLE_H
+
+#include "common/common.h"
+#include "core/NameRef.h"
+#include "core/SymbolRef.h"
+
+namespace sorbet::core {
+
+/**
+ * The members of a Symbol, by name.
+ *
+ * Most symbols have no members, and most classes only a handful, for which a hash map is mostly overhead: its smallest
+ * allocation holds 3 entries plus control bytes, and a lookup hashes and probes. Tables up to MAX_SMALL_SIZE entries
+ * are kept as a flat vector (the first two inline) and scanned without branching on each entry instead, which is at
+ * least as fast as hashing at that size. Larger tables switch to an UnorderedMap for good.
+ *
+ * Iteration order is unspecified, like UnorderedMap's.
+ */
+class MemberTable final {
+    using Entry = std::pair<NameRef, SymbolRef>;
+    static constexpr size_t INLINE_SIZE = 2;
+    using Small = InlinedVector<Entry, INLINE_SIZE>;
+    using Large = UnorderedMap<NameRef, SymbolRef>;
+
+    static constexpr size_t MAX_SMALL_SIZE = 8;
+
+    Small small;
+    // Set once the table outgrows `small`, which is then empty.
+    std::unique_ptr<Large> large;
+
+    const Entry *findSmall(NameRef name) const {
+        for (auto &entry : small) {
+            if (entry.first == name) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    Entry *findSmall(NameRef name) {
+        return const_cast<Entry *>(std::as_const(*this).findSmall(name));
+    }
+
+    void makeLarge(size_t capacity) {
+        large = std::make_unique<Large>();
+        large->reserve(capacity);
+        for (auto &entry : small) {
+            large->emplace(entry.first, entry.second);
+        }
+        Small().swap(small);
+    }
+
+public:
+    class const_iterator final {
+        const Entry *smallIt;
+        Large::const_iterator largeIt;
+        bool isLarge;
+
+    public:
+        const_iterator(const Entry *smallIt) : smallIt(smallIt), isLarge(false) {}
+        const_iterator(Large::const_iterator largeIt) : smallIt(nullptr), largeIt(largeIt), isLarge(true) {}
+        Entry operator*() const {
+            if (isLarge) {
+                return Entry(largeIt->first, largeIt->second);
+            }
+            return *smallIt;
+        }
+        const_iterator &operator++() {
+            if (isLarge) {
+                ++largeIt;
+            } else {
+                ++smallIt;
+            }
+            return *this;
+        }
+        bool operator==(const const_iterator &rhs) const {
+            return isLarge ? largeIt == rhs.largeIt : smallIt == rhs.smallIt;
+        }
+        bool operator!=(const const_iterator &rhs) const {
+            return !(*this == rhs);
+        }
+    };
+
+    MemberTable() = default;
+    MemberTable(const MemberTable &other)
+        : small(other.small), large(other.large ? std::make_unique<Large>(*other.large) : nullptr) {}
+    MemberTable(MemberTable &&other) = default;
+    MemberTable &operator=(const MemberTable &other) {
+        small = other.small;
+        large = other.large ? std::make_unique<Large>(*other.large) : nullptr;
+        return *this;
+    }
+    MemberTable &operator=(MemberTable &&other) = default;
+
+    size_t size() const {
+        return large ? large->size() : small.size();
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // Approximate bytes allocated outside of the table itself.
+    size_t heapBytes() const {
+        if (large) {
+            return sizeof(Large) + large->capacity() * (sizeof(Large::value_type) + 1);
+        }
+        return small.capacity() > INLINE_SIZE ? small.capacity() * sizeof(Entry) : 0;
+    }
+
+    // Returns the member called `name`, or `noSymbol()` if there is none.
+    SymbolRef find(NameRef name) const {
+        if (large) {
+            auto fnd = large->find(name);
+            return fnd == large->end() ? SymbolRef() : fnd->second;
+        }
+        // Names are unique, so at most one entry matches. Not exiting early lets this compile to conditional moves.
+        SymbolRef result;
+        for (auto &entry : small) {
+            result = entry.first == name ? entry.second : result;
+        }
+        return result;
+    }
+
+    // Like `find`, but the member must exist.
+    SymbolRef at(NameRef name) const {
+        ENFORCE(contains(name), "no member called {}", name.id());
+        return find(name);
+    }
+
+    bool contains(NameRef name) const {
+        if (large) {
+            return large->contains(name);
+        }
+        return findSmall(name) != nullptr;
+    }
+
+    // Like `std::map::operator[]`: adds a `noSymbol()` member called `name` if there is none. The reference is
+    // invalidated by the next insertion or erasure.
+    SymbolRef &operator[](NameRef name) {
+        if (large) {
+            return (*large)[name];
+        }
+        if (auto entry = findSmall(name)) {
+            return entry->second;
+        }
+        if (small.size() < MAX_SMALL_SIZE) {
+            return small.emplace_back(name, SymbolRef()).second;
+        }
+        makeLarge(MAX_SMALL_SIZE * 2);
+        return (*large)[name];
+    }
+
+    void erase(NameRef name) {
+        if (large) {
+            large->erase(name);
+        } else if (auto entry = findSmall(name)) {
+            *entry = small.back();
+            small.pop_back();
+        }
+    }
+
+    void reserve(size_t size) {
+        if (large) {
+            large->reserve(size);
+        } else if (size > MAX_SMALL_SIZE) {
+            makeLarge(size);
+        } else {
+            small.reserve(size);
+        }
+    }
+
+    // Returns a copy with every name replaced by `fn(name)`, e.g. to rebind them to another GlobalState.
+    template <class F> MemberTable withNames(F fn) const {
+        MemberTable result;
+        if (large) {
+            result.makeLarge(large->size());
+            for (auto &entry : *large) {
+                result.large->emplace(fn(entry.first), entry.second);
+            }
+        } else {
+            result.small.reserve(small.size());
+            for (auto &entry : small) {
+                result.small.emplace_back(fn(entry.first), entry.second);
+            }
+        }
+        return result;
+    }
+
+    const_iterator begin() const {
+        if (large) {
+            return const_iterator(large->begin());
+        }
+        return const_iterator(small.data());
+    }
+
+    const_iterator end() const {
+        if (large) {
+            return const_iterator(large->end());
+        }
+        return const_iterator(small.data() + small.size());
+    }
+};
+
+} // namespace sorbet::core
+
+#endif // SORBET_CORE_MEMBERTABLE_H
@@ -0,0 +1,37 @@
+#include "core/MemoryUsage.h"
+#include "common/Counters.h"
+
+using namespace std;
+
+namespace sorbet::core {
+
+u8 MemoryUsage::total() const {
+    return names + strings + symbols + files + types + trees + fileHashes;
+}
+
+string MemoryUsage::toString() const {
+    fmt::memory_buffer buf;
+    for (auto &[category, bytes] : vector<pair<string_view, u8>>{{"names", names},
+                                                                  {"strings", strings},
+                                                                  {"symbols", symbols},
+                                                                  {"files", files},
+                                                                  {"types", types},
+                                                                  {"trees", trees},
+                                                                  {"fileHashes", fileHashes},
+                                                                  {"total", total()}}) {
+        fmt::format_to(buf, "{:<10} {:>10} KiB\n", category, bytes / 1024);
+    }
+    return to_string(buf);
+}
+
+void MemoryUsage::addToCounters() const {
+    prodCategoryCounterAdd("memory_bytes", "names", names);
+    prodCategoryCounterAdd("memory_bytes", "strings", strings);
+    prodCategoryCounterAdd("memory_bytes", "symbols", symbols);
+    prodCategoryCounterAdd("memory_bytes", "files", files);
+    prodCategoryCounterAdd("memory_bytes", "types", types);
+    prodCategoryCounterAdd("memory_bytes", "trees", trees);
+    prodCategoryCounterAdd("memory_bytes", "fileHashes", fileHashes);
+}
+
+} // namespace sorbet::core
@@ -0,0 +1,40 @@
+#ifndef SORBET_CORE_MEMORYUSAGE_H
+#define SORBET_CORE_MEMORYUSAGE_H
+
+#include "common/common.h"
+
+namespace sorbet::core {
+
+/**
+ * Approximately how many bytes the largest structures of a process take, to tell what its RSS is made of. Counts what
+ * the structures allocated (capacity rather than size), but not the allocator's own overhead.
+ */
+struct MemoryUsage {
+    // The name table, including its hash index.
+    u8 names = 0;
+    // The pages holding the text of names.
+    u8 strings = 0;
+    // The symbol table, including members, arguments and locations.
+    u8 symbols = 0;
+    // The paths and contents of files, and the index by path.
+    u8 files = 0;
+    // Types reachable from the symbol table, each counted once.
+    u8 types = 0;
+    // What SmallObjectPool holds, which allocates parse trees and ASTs (live or freed for reuse) for every
+    // GlobalState in the process.
+    u8 trees = 0;
+    // What LSP keeps of every file's hashes between edits, for the fast path. Only LSP fills it in.
+    u8 fileHashes = 0;
+
+    u8 total() const;
+
+    // One line per category, in KiB.
+    std::string toString() const;
+
+    // Adds every category to the `memory_bytes` counters, to be submitted as gauges.
+    void addToCounters() const;
+};
+
+} // namespace sorbet::core
+
+#endif // SORBET_CORE_MEMORYUSAGE_H
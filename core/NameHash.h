@@ -31,7 +31,9 @@ public:
         return this->_hashValue < rhs._hashValue;
     }
 
-    u4 _hashValue;
+    // 64 bits, so that names that merely collide (of which a large codebase has plenty at 32 bits) don't make LSP's fast
+    // path treat unrelated files as dependent on each other.
+    u8 _hashValue;
 };
 
 template <typename H> H AbslHashValue(H h, const NameHash &m) {
@@ -45,6 +47,10 @@ struct GlobalStateHash {
     static constexpr int HASH_STATE_INVALID_COLLISION_AVOID = 3;
     u4 hierarchyHash = HASH_STATE_NOT_COMPUTED;
     UnorderedMap<NameHash, u4> methodHashes;
+    // `hierarchyHash` split into the part that doesn't depend on methods, and the method shapes it mixes in, by name.
+    // Lets LSP tell a change that only adds methods apart from one that changes existing definitions.
+    u4 classHierarchyHash = HASH_STATE_NOT_COMPUTED;
+    UnorderedMap<NameHash, u4> methodShapeHashes;
 };
 
 struct UsageHash {
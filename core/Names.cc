@@ -176,8 +176,7 @@ void Name::sanityCheck(const GlobalState &gs) const {
 }
 
 NameRef Name::ref(const GlobalState &gs) const {
-    auto distance = this - gs.names.data();
-    return NameRef(gs, distance);
+    return NameRef(gs, gs.names.indexOf(*this));
 }
 
 bool Name::isClassName(const GlobalState &gs) const {
@@ -293,6 +292,12 @@ NameRef NameRef::prepend(GlobalState &gs, string_view s) const {
     return gs.enterNameUTF8(nameEq);
 }
 
+Name Name::copy() const {
+    Name out;
+    ::memcpy(&out, this, sizeof(Name));
+    return out;
+}
+
 Name Name::deepCopy(const GlobalState &to) const {
     Name out;
     out.kind = this->kind;
@@ -104,6 +104,8 @@ public:
     NameRef ref(const GlobalState &gs) const;
 
     Name deepCopy(const GlobalState &to) const;
+    // Copies this name for use in the same GlobalState (or one that shares its ids), e.g. by CopyOnWriteVector.
+    Name copy() const;
 
 private:
     unsigned int hash(const GlobalState &gs) const;
@@ -44,6 +44,9 @@ public:
 
     bool isSynthetic() const;
 
+    // Same as `data(gs)->derivesFrom(gs, sym)`, but uses GlobalState's ancestor cache when this class is in it.
+    bool derivesFrom(const GlobalState &gs, SymbolRef sym) const;
+
     SymbolData data(GlobalState &gs) const;
     const SymbolData data(const GlobalState &gs) const;
     SymbolData dataAllowingNone(GlobalState &gs) const;
@@ -88,6 +88,17 @@ TypePtr Symbol::externalType(const GlobalState &gs) const {
     return resultType;
 }
 
+bool SymbolRef::derivesFrom(const GlobalState &gs, SymbolRef sym) const {
+    if (gs.ancestorCache != nullptr && *this != sym) {
+        auto ancestors = gs.ancestorCache->range(gs.ancestorCache->sorted, *this);
+        if (!ancestors.empty()) {
+            return absl::c_binary_search(ancestors, sym,
+                                         [](SymbolRef left, SymbolRef right) { return left._id < right._id; });
+        }
+    }
+    return data(gs)->derivesFrom(gs, sym);
+}
+
 bool Symbol::derivesFrom(const GlobalState &gs, SymbolRef sym) const {
     if (isClassLinearizationComputed()) {
         for (SymbolRef a : mixins()) {
@@ -97,20 +108,19 @@ bool Symbol::derivesFrom(const GlobalState &gs, SymbolRef sym) const {
         }
     } else {
         for (SymbolRef a : mixins()) {
-            if (a == sym || a.data(gs)->derivesFrom(gs, sym)) {
+            if (a == sym || a.derivesFrom(gs, sym)) {
                 return true;
             }
         }
     }
     if (this->superClass().exists()) {
-        return sym == this->superClass() || this->superClass().data(gs)->derivesFrom(gs, sym);
+        return sym == this->superClass() || this->superClass().derivesFrom(gs, sym);
     }
     return false;
 }
 
 SymbolRef Symbol::ref(const GlobalState &gs) const {
-    auto distance = this - gs.symbols.data();
-    return SymbolRef(gs, distance);
+    return SymbolRef(gs, gs.symbols.indexOf(*this));
 }
 
 SymbolData SymbolRef::data(GlobalState &gs) const {
@@ -190,15 +200,63 @@ SymbolRef Symbol::findMember(const GlobalState &gs, NameRef name) const {
 
 SymbolRef Symbol::findMemberNoDealias(const GlobalState &gs, NameRef name) const {
     histogramInc("find_member_scope_size", members().size());
-    auto fnd = members().find(name);
-    if (fnd == members().end()) {
-        return Symbols::noSymbol();
-    }
-    return fnd->second;
+    return members().find(name);
 }
 
+namespace {
+StaticCounter memberMemoHits("symbols.memo.find_member_transitive.hit");
+StaticCounter memberMemoMisses("symbols.memo.find_member_transitive.miss");
+
+// Results of `findMemberTransitive` by class and name. They depend on the members of the class and its ancestors, so
+// they stay valid until GlobalState::frozenSymbolTableVersion changes.
+class MemberMemo {
+    static constexpr size_t MAX_SIZE = 1 << 16;
+
+    u8 symbolTableVersion = 0;
+    UnorderedMap<u8, SymbolRef> entries;
+
+public:
+    // Returns this thread's memo table, emptied if it was filled for another version of the symbol table.
+    static MemberMemo &get(u8 symbolTableVersion) {
+        thread_local MemberMemo memo;
+        if (memo.symbolTableVersion != symbolTableVersion) {
+            memo.entries.clear();
+            memo.symbolTableVersion = symbolTableVersion;
+        }
+        return memo;
+    }
+
+    // `key` packs the ids of the class and the name.
+    const SymbolRef *find(u8 key) const {
+        auto fnd = entries.find(key);
+        return fnd == entries.end() ? nullptr : &fnd->second;
+    }
+
+    void insert(u8 key, SymbolRef result) {
+        if (entries.size() >= MAX_SIZE) {
+            // Like TypeMemoTable, dropping everything keeps this simple.
+            entries.clear();
+        }
+        entries.emplace(key, result);
+    }
+};
+} // namespace
+
 SymbolRef Symbol::findMemberTransitive(const GlobalState &gs, NameRef name) const {
-    return findMemberTransitiveInternal(gs, name, Flags::NONE, Flags::NONE, 100);
+    auto version = gs.frozenSymbolTableVersion();
+    if (version == 0) {
+        return findMemberTransitiveInternal(gs, name, Flags::NONE, Flags::NONE, 100);
+    }
+    auto &memo = MemberMemo::get(version);
+    const u8 key = (static_cast<u8>(ref(gs)._id) << 32) | static_cast<u4>(name.id());
+    if (auto *cached = memo.find(key)) {
+        memberMemoHits.inc();
+        return *cached;
+    }
+    memberMemoMisses.inc();
+    auto result = findMemberTransitiveInternal(gs, name, Flags::NONE, Flags::NONE, 100);
+    memo.insert(key, result);
+    return result;
 }
 
 SymbolRef Symbol::findConcreteMethodTransitive(const GlobalState &gs, NameRef name) const {
@@ -231,6 +289,19 @@ SymbolRef Symbol::findMemberTransitiveInternal(const GlobalState &gs, NameRef na
         Exception::raise("findMemberTransitive hit a loop while resolving");
     }
 
+    if (gs.ancestorCache != nullptr) {
+        auto ancestors = gs.ancestorCache->range(gs.ancestorCache->linearization, ref(gs));
+        if (!ancestors.empty()) {
+            for (auto ancestor : ancestors) {
+                auto result = ancestor.data(gs)->findMember(gs, name);
+                if (result.exists() && (mask == 0 || (result.data(gs)->flags & mask) == flags)) {
+                    return result;
+                }
+            }
+            return Symbols::noSymbol();
+        }
+    }
+
     SymbolRef result = findMember(gs, name);
     if (result.exists()) {
         if (mask == 0 || (result.data(gs)->flags & mask) == flags) {
@@ -946,27 +1017,34 @@ void ArgInfo::ArgFlags::setFromU1(u1 flags) {
     isBlock = flags & 16;
 }
 
-Symbol Symbol::deepCopy(const GlobalState &to, bool keepGsId) const {
+Symbol Symbol::copy() const {
+    return copyImpl(nullptr);
+}
+
+Symbol Symbol::deepCopy(const GlobalState &to) const {
+    return copyImpl(&to);
+}
+
+Symbol Symbol::copyImpl(const GlobalState *to) const {
     Symbol result;
     result.owner = this->owner;
     result.flags = this->flags;
     result.mixins_ = this->mixins_;
     result.resultType = this->resultType;
-    result.name = NameRef(to, this->name.id());
+    result.name = to == nullptr ? this->name : NameRef(*to, this->name.id());
     result.locs_ = this->locs_;
     result.typeParams = this->typeParams;
-    if (keepGsId) {
+    if (to == nullptr) {
         result.members_ = this->members_;
     } else {
-        result.members_.reserve(this->members().size());
-        for (auto &mem : this->members_) {
-            result.members_[NameRef(to, mem.first.id())] = mem.second;
-        }
+        result.members_ = this->members_.withNames([&](NameRef name) { return NameRef(*to, name.id()); });
     }
     result.arguments_.reserve(this->arguments_.size());
     for (auto &mem : this->arguments_) {
         auto &store = result.arguments_.emplace_back(mem.deepCopy());
-        store.name = NameRef(to, mem.name.id());
+        if (to != nullptr) {
+            store.name = NameRef(*to, mem.name.id());
+        }
     }
     result.superClassOrRebind = this->superClassOrRebind;
     result.uniqueCounter = this->uniqueCounter;
@@ -994,7 +1072,7 @@ void Symbol::sanityCheck(const GlobalState &gs) const {
         SymbolRef current2 =
             const_cast<GlobalState &>(gs).enterSymbol(this->loc(), this->owner, this->name, this->flags);
         ENFORCE(current == current2);
-        for (auto &e : members()) {
+        for (const auto &e : members()) {
             ENFORCE(e.first.exists(), "symbol without a name in scope");
             ENFORCE(e.second.exists(), "name corresponding to a <none> in scope");
         }
@@ -1032,6 +1110,14 @@ SymbolRef Symbol::enclosingClass(const GlobalState &gs) const {
 }
 
 u4 Symbol::hash(const GlobalState &gs) const {
+    return hash(gs, true);
+}
+
+u4 Symbol::hashIgnoringMethods(const GlobalState &gs) const {
+    return hash(gs, false);
+}
+
+u4 Symbol::hash(const GlobalState &gs, bool includeMethods) const {
     u4 result = _hash(name.data(gs)->shortName(gs));
     result = mix(result, !this->resultType ? 0 : this->resultType->hash(gs));
     result = mix(result, this->flags);
@@ -1039,7 +1125,8 @@ u4 Symbol::hash(const GlobalState &gs) const {
     result = mix(result, this->superClassOrRebind._id);
     // argumentsOrMixins, typeParams, typeAliases
     for (auto e : membersStableOrderSlow(gs)) {
-        if (e.second.exists() && !e.second.data(gs)->ignoreInHashing(gs)) {
+        if (e.second.exists() && !e.second.data(gs)->ignoreInHashing(gs) &&
+            (includeMethods || !e.second.data(gs)->isMethod())) {
             result = mix(result, _hash(e.second.data(gs)->name.data(gs)->shortName(gs)));
         }
     }
@@ -3,6 +3,7 @@
 
 #include "common/common.h"
 #include "core/Loc.h"
+#include "core/MemberTable.h"
 #include "core/Names.h"
 #include "core/SymbolRef.h"
 #include "core/Types.h"
@@ -107,6 +108,8 @@ public:
 
     u4 hash(const GlobalState &gs) const;
     u4 methodShapeHash(const GlobalState &gs) const;
+    // Like `hash`, but without the names of member methods, which their `methodShapeHash`es cover.
+    u4 hashIgnoringMethods(const GlobalState &gs) const;
 
     std::vector<TypePtr> selfTypeArgs(const GlobalState &gs) const;
 
@@ -553,6 +556,9 @@ public:
 
     bool ignoreInHashing(const GlobalState &gs) const;
 
+    // Fields are declared hottest first, so that dispatch and subtyping, which look at many symbols, touch as few cache
+    // lines of each as they can: everything up to `mixins_` fits in the first 128 bytes. `typeParams` follows, and
+    // `locs_`, which only errors and LSP read, comes last.
     SymbolRef owner;
     SymbolRef superClassOrRebind; // method arugments store rebind here
 
@@ -580,19 +586,22 @@ public:
     u4 uniqueCounter = 1; // used as a counter inside the namer
     NameRef name;         // todo: move out? it should not matter but it's important for name resolution
     TypePtr resultType;
+    // All `IntrinsicMethod`s in sorbet should be statically-allocated, which is
+    // why raw pointers are safe.
+    const IntrinsicMethod *intrinsic = nullptr;
 
     bool hasSig() const {
         ENFORCE(isMethod());
         return resultType != nullptr;
     }
 
-    UnorderedMap<NameRef, SymbolRef> members_;
+    MemberTable members_;
     std::vector<ArgInfo> arguments_;
 
-    UnorderedMap<NameRef, SymbolRef> &members() {
+    MemberTable &members() {
         return members_;
     };
-    const UnorderedMap<NameRef, SymbolRef> &members() const {
+    const MemberTable &members() const {
         return members_;
     };
 
@@ -606,20 +615,23 @@ public:
 
     std::vector<std::pair<NameRef, SymbolRef>> membersStableOrderSlow(const GlobalState &gs) const;
 
-    Symbol deepCopy(const GlobalState &to, bool keepGsId = false) const;
+    Symbol deepCopy(const GlobalState &to) const;
+    // Copies this symbol for use in the same GlobalState (or one that shares its ids), e.g. by CopyOnWriteVector.
+    Symbol copy() const;
     void sanityCheck(const GlobalState &gs) const;
     SymbolRef enclosingMethod(const GlobalState &gs) const;
 
     SymbolRef enclosingClass(const GlobalState &gs) const;
 
-    // All `IntrinsicMethod`s in sorbet should be statically-allocated, which is
-    // why raw pointers are safe.
-    const IntrinsicMethod *intrinsic = nullptr;
-
 private:
+    u4 hash(const GlobalState &gs, bool includeMethods) const;
+
     friend class serialize::SerializerImpl;
     friend class GlobalState;
 
+    // `to` is null when copying within GlobalStates that share ids, in which case refs are copied as-is.
+    Symbol copyImpl(const GlobalState *to) const;
+
     std::string toStringWithOptions(const GlobalState &gs, int tabs = 0, bool showFull = false,
                                     bool showRaw = false) const;
 
@@ -1,6 +1,7 @@
 #ifndef SORBET_TYPECONSTRAINT_H
 #define SORBET_TYPECONSTRAINT_H
 
+#include "common/SmallObjectPool.h"
 #include "core/Context.h"
 #include "core/SymbolRef.h"
 #include "core/TypePtr.h"
@@ -8,9 +9,11 @@ namespace sorbet::core {
 
 class TypeConstraint {
     static TypeConstraint makeEmptyFrozenConstraint();
-    std::vector<std::pair<SymbolRef, TypePtr>> upperBounds;
-    std::vector<std::pair<SymbolRef, TypePtr>> lowerBounds;
-    std::vector<std::pair<SymbolRef, TypePtr>> solution;
+    // Most generic methods have one or two type parameters, so their bounds fit without allocating.
+    using Bounds = InlinedVector<std::pair<SymbolRef, TypePtr>, 2>;
+    Bounds upperBounds;
+    Bounds lowerBounds;
+    Bounds solution;
     bool wasSolved = false;
     bool cantSolve = false;
     TypePtr &findUpperBound(SymbolRef forWhat);
@@ -21,6 +24,13 @@ public:
     TypeConstraint() = default;
     TypeConstraint(const TypeConstraint &) = delete;
     TypeConstraint(TypeConstraint &&) = default;
+    // Every generic method call makes one, and inference makes one for each method whose return type it guesses.
+    static void *operator new(size_t size) {
+        return SmallObjectPool::allocate(size);
+    }
+    static void operator delete(void *ptr, size_t size) {
+        SmallObjectPool::deallocate(ptr, size);
+    }
     void defineDomain(Context ctx, const InlinedVector<SymbolRef, 4> &typeParams);
     bool hasUpperBound(SymbolRef forWhat) const;
     bool hasLowerBound(SymbolRef forWhat) const;
@@ -2,10 +2,12 @@
 #define SORBET_TYPES_H
 
 #include "common/Counters.h"
+#include "common/typecase.h"
 #include "core/Context.h"
 #include "core/Error.h"
 #include "core/SymbolRef.h"
 #include "core/TypeConstraint.h"
+#include <atomic>
 #include <memory>
 #include <optional>
 #include <string>
@@ -13,6 +15,7 @@ namespace sorbet::core {
 /** Dmitry: unlike in Dotty, those types are always dealiased. For now */
 class Type;
 class AppliedType;
+class ClassType;
 class IntrinsicMethod;
 class TypeConstraint;
 struct DispatchArgs;
@@ -64,7 +67,11 @@ public:
 CheckSize(ArgInfo, 40, 8);
 
 template <class T, class... Args> TypePtr make_type(Args &&... args) {
-    return TypePtr(std::make_shared<T>(std::forward<Args>(args)...));
+    if constexpr (std::is_same_v<T, ClassType>) {
+        return T::intern(std::forward<Args>(args)...);
+    } else {
+        return TypePtr(std::make_shared<T>(std::forward<Args>(args)...));
+    }
 }
 
 class Types final {
@@ -164,9 +171,35 @@ struct Intrinsic {
 };
 extern const std::vector<Intrinsic> intrinsicMethods;
 
+// Names the concrete class of a `Type`, so that `cast_type` and `typecase` can check it rather than asking RTTI. The
+// subclasses of `GroundType`, `ProxyType` and `ClassType` are each listed next to each other, so that checking for one
+// of those is a range check.
+enum class TypeTag : u1 {
+    // GroundType
+    ClassType,
+    BlamedUntyped,
+    UnresolvedClassType,
+    OrType,
+    AndType,
+    // ProxyType
+    LiteralType,
+    ShapeType,
+    TupleType,
+    MetaType,
+
+    LambdaParam,
+    SelfTypeParam,
+    AliasType,
+    SelfType,
+    TypeVar,
+    AppliedType,
+};
+
 class Type {
 public:
-    Type() = default;
+    const TypeTag tag;
+
+    Type(TypeTag tag) : tag(tag) {}
     Type(const Type &obj) = delete;
     virtual ~Type() = default;
     // Internal printer.
@@ -207,31 +240,58 @@ public:
     virtual TypePtr _approximate(Context ctx, const TypeConstraint &tc);
     unsigned int hash(const GlobalState &gs) const;
 };
-CheckSize(Type, 8, 8);
+CheckSize(Type, 16, 8);
+
+// Whether a type tagged `tag` is a `To`. Final classes name their own tag as `TAG`, and the others the range of tags of
+// their subclasses as `FIRST_TAG` to `LAST_TAG`.
+template <class To> constexpr bool hasTypeTag(TypeTag tag) {
+    if constexpr (std::is_same<To, Type>::value) {
+        return true;
+    } else if constexpr (std::is_final<To>::value) {
+        return tag == To::TAG;
+    } else {
+        return To::FIRST_TAG <= tag && tag <= To::LAST_TAG;
+    }
+}
 
 template <class To> To *cast_type(Type *what) {
     static_assert(!std::is_pointer<To>::value, "To has to be a pointer");
     static_assert(std::is_assignable<Type *&, To *>::value, "Ill Formed To, has to be a subclass of Type");
-    return fast_cast<Type, To>(what);
+    if (what == nullptr || !hasTypeTag<To>(what->tag)) {
+        return nullptr;
+    }
+    return static_cast<To *>(what);
 }
 
 template <class To> const To *cast_type(const Type *what) {
     static_assert(!std::is_pointer<To>::value, "To has to be a pointer");
     static_assert(std::is_assignable<Type *&, To *>::value, "Ill Formed To, has to be a subclass of Type");
-    return fast_cast<const Type, const To>(what);
+    if (what == nullptr || !hasTypeTag<To>(what->tag)) {
+        return nullptr;
+    }
+    return static_cast<const To *>(what);
 }
 
 template <class To> bool isa_type(Type *what) {
     return cast_type<To>(what) != nullptr;
 }
 
-class GroundType : public Type {};
+class GroundType : public Type {
+public:
+    static constexpr TypeTag FIRST_TAG = TypeTag::ClassType;
+    static constexpr TypeTag LAST_TAG = TypeTag::AndType;
+
+    GroundType(TypeTag tag) : Type(tag) {}
+};
 
 class ProxyType : public Type {
 public:
+    static constexpr TypeTag FIRST_TAG = TypeTag::LiteralType;
+    static constexpr TypeTag LAST_TAG = TypeTag::MetaType;
+
     // TODO: use shared pointers that use inline counter
     virtual TypePtr underlying() const = 0;
-    ProxyType() = default;
+    ProxyType(TypeTag tag) : Type(tag) {}
 
     virtual DispatchResult dispatchCall(Context ctx, DispatchArgs args) override;
     virtual TypePtr getCallArguments(Context ctx, NameRef name) override;
@@ -239,12 +299,18 @@ public:
 
     void _sanityCheck(Context ctx) override;
 };
-CheckSize(ProxyType, 8, 8);
+CheckSize(ProxyType, 16, 8);
 
 class ClassType : public GroundType {
 public:
-    SymbolRef symbol;
+    static constexpr TypeTag FIRST_TAG = TypeTag::ClassType;
+    static constexpr TypeTag LAST_TAG = TypeTag::UnresolvedClassType;
+
+    const SymbolRef symbol;
     ClassType(SymbolRef symbol);
+    // There is one ClassType per symbol id, shared by every GlobalState: it's all a ClassType holds, so two of them
+    // are equal exactly when they are the same object. `make_type<ClassType>` calls this.
+    static TypePtr intern(SymbolRef symbol);
     virtual int kind() final;
 
     virtual std::string toStringWithTabs(const GlobalState &gs, int tabs = 0) const override;
@@ -259,6 +325,9 @@ public:
                                  const std::vector<TypePtr> &targs) override final;
     virtual bool isFullyDefined() final;
     virtual bool hasUntyped() override final;
+
+protected:
+    ClassType(TypeTag tag, SymbolRef symbol);
 };
 CheckSize(ClassType, 16, 8);
 
@@ -268,6 +337,7 @@ CheckSize(ClassType, 16, 8);
  */
 class LambdaParam final : public Type {
 public:
+    static constexpr TypeTag TAG = TypeTag::LambdaParam;
     SymbolRef definition;
 
     // The type bounds provided in the definition of the type_member or
@@ -295,6 +365,7 @@ CheckSize(LambdaParam, 48, 8);
 
 class SelfTypeParam final : public Type {
 public:
+    static constexpr TypeTag TAG = TypeTag::SelfTypeParam;
     SymbolRef definition;
 
     SelfTypeParam(const SymbolRef definition);
@@ -317,6 +388,7 @@ CheckSize(SelfTypeParam, 16, 8);
 
 class AliasType final : public Type {
 public:
+    static constexpr TypeTag TAG = TypeTag::AliasType;
     AliasType(SymbolRef other);
     virtual std::string toStringWithTabs(const GlobalState &gs, int tabs = 0) const final;
     virtual std::string show(const GlobalState &gs) const final;
@@ -341,6 +413,7 @@ CheckSize(AliasType, 16, 8);
  */
 class SelfType final : public Type {
 public:
+    static constexpr TypeTag TAG = TypeTag::SelfType;
     SelfType();
     virtual std::string toStringWithTabs(const GlobalState &gs, int tabs = 0) const final;
     virtual std::string show(const GlobalState &gs) const final;
@@ -358,10 +431,11 @@ public:
     virtual TypePtr getCallArguments(Context ctx, NameRef name) final;
     virtual bool derivesFrom(const GlobalState &gs, SymbolRef klass) const final;
 };
-CheckSize(SelfType, 8, 8);
+CheckSize(SelfType, 16, 8);
 
 class LiteralType final : public ProxyType {
 public:
+    static constexpr TypeTag TAG = TypeTag::LiteralType;
     union {
         const int64_t value;
         const double floatval;
@@ -387,13 +461,14 @@ public:
                                  const std::vector<TypePtr> &targs) override;
     virtual int kind() final;
 };
-CheckSize(LiteralType, 24, 8);
+CheckSize(LiteralType, 32, 8);
 
 /*
  * TypeVars are the used for the type parameters of generic methods.
  */
 class TypeVar final : public Type {
 public:
+    static constexpr TypeTag TAG = TypeTag::TypeVar;
     SymbolRef sym;
     TypeVar(SymbolRef sym);
     virtual std::string toStringWithTabs(const GlobalState &gs, int tabs = 0) const final;
@@ -415,6 +490,7 @@ CheckSize(TypeVar, 16, 8);
 
 class OrType final : public GroundType {
 public:
+    static constexpr TypeTag TAG = TypeTag::OrType;
     TypePtr left;
     TypePtr right;
     virtual int kind() final;
@@ -459,10 +535,11 @@ private:
 
     static TypePtr make_shared(const TypePtr &left, const TypePtr &right);
 };
-CheckSize(OrType, 40, 8);
+CheckSize(OrType, 48, 8);
 
 class AndType final : public GroundType {
 public:
+    static constexpr TypeTag TAG = TypeTag::AndType;
     TypePtr left;
     TypePtr right;
     virtual int kind() final;
@@ -501,10 +578,11 @@ private:
 
     static TypePtr make_shared(const TypePtr &left, const TypePtr &right);
 };
-CheckSize(AndType, 40, 8);
+CheckSize(AndType, 48, 8);
 
 class ShapeType final : public ProxyType {
 public:
+    static constexpr TypeTag TAG = TypeTag::ShapeType;
     std::vector<TypePtr> keys; // TODO: store sorted by whatever
     std::vector<TypePtr> values;
     const TypePtr underlying_;
@@ -526,13 +604,15 @@ public:
     virtual TypePtr _instantiate(Context ctx, const TypeConstraint &tc) override;
     virtual TypePtr underlying() const override;
 };
-CheckSize(ShapeType, 72, 8);
+CheckSize(ShapeType, 80, 8);
 
 class TupleType final : public ProxyType {
 private:
     TupleType() = delete;
 
 public:
+    static constexpr TypeTag TAG = TypeTag::TupleType;
+
     std::vector<TypePtr> elems;
     const TypePtr underlying_;
 
@@ -558,10 +638,11 @@ public:
     TypePtr elementType() const;
     virtual TypePtr underlying() const override;
 };
-CheckSize(TupleType, 48, 8);
+CheckSize(TupleType, 56, 8);
 
 class AppliedType final : public Type {
 public:
+    static constexpr TypeTag TAG = TypeTag::AppliedType;
     SymbolRef klass;
     std::vector<TypePtr> targs;
     AppliedType(SymbolRef klass, std::vector<TypePtr> targs);
@@ -596,6 +677,7 @@ CheckSize(AppliedType, 40, 8);
 // user-written types in the source code.
 class MetaType final : public ProxyType {
 public:
+    static constexpr TypeTag TAG = TypeTag::MetaType;
     TypePtr wrapped;
 
     MetaType(const TypePtr &wrapped);
@@ -616,7 +698,7 @@ public:
     virtual TypePtr _approximate(Context ctx, const TypeConstraint &tc) override;
     virtual TypePtr underlying() const override;
 };
-CheckSize(MetaType, 24, 8);
+CheckSize(MetaType, 32, 8);
 
 class SendAndBlockLink {
     SendAndBlockLink(const SendAndBlockLink &) = default;
@@ -632,10 +714,100 @@ public:
     std::shared_ptr<SendAndBlockLink> duplicate();
 };
 
+/**
+ * The locations a value may have come from, as carried around by inference. Every assignment copies its right-hand
+ * side's list and every merge of environments unions them, so they are copied far more often than they change: a
+ * single location is stored inline and anything longer lives in an immutable, reference-counted buffer that copies
+ * share, which is only copied when a shared list is appended to.
+ */
+class Origins final {
+    struct Shared {
+        std::atomic<u4> refs{1};
+        std::vector<Loc> locs;
+    };
+
+    Loc inlined;
+    // Set once there is more than one location, which are then all stored here.
+    Shared *shared = nullptr;
+    u4 size_ = 0;
+
+    void release() noexcept {
+        if (shared != nullptr && shared->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete shared;
+        }
+        shared = nullptr;
+    }
+
+public:
+    Origins() = default;
+    Origins(std::initializer_list<Loc> locs) {
+        for (auto loc : locs) {
+            emplace_back(loc);
+        }
+    }
+    Origins(const Origins &other) : inlined(other.inlined), shared(other.shared), size_(other.size_) {
+        if (shared != nullptr) {
+            shared->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    Origins(Origins &&other) noexcept : inlined(other.inlined), shared(other.shared), size_(other.size_) {
+        other.shared = nullptr;
+        other.size_ = 0;
+    }
+    Origins &operator=(const Origins &other) {
+        if (this != &other) {
+            Origins copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+    Origins &operator=(Origins &&other) noexcept {
+        if (this != &other) {
+            release();
+            inlined = other.inlined;
+            shared = other.shared;
+            size_ = other.size_;
+            other.shared = nullptr;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+    ~Origins() noexcept {
+        release();
+    }
+
+    u4 size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    const Loc *begin() const {
+        return shared != nullptr ? shared->locs.data() : &inlined;
+    }
+
+    const Loc *end() const {
+        return begin() + size_;
+    }
+
+    Loc operator[](u4 idx) const {
+        ENFORCE(idx < size_);
+        return begin()[idx];
+    }
+
+    void emplace_back(Loc loc);
+
+    // Appends the locations of `other` that are not already in this list.
+    void addAll(const Origins &other);
+};
+CheckSize(Origins, 24, 8);
+
 class TypeAndOrigins final {
 public:
     TypePtr type;
-    InlinedVector<Loc, 2> origins;
+    Origins origins;
     std::vector<ErrorLine> origins2Explanations(Context ctx) const;
     ~TypeAndOrigins() noexcept;
     TypeAndOrigins() = default;
@@ -652,6 +824,9 @@ struct CallLocs final {
     InlinedVector<Loc, 2> &args;
 };
 
+// The arguments a call passes. Few calls pass more than fit inline, so dispatching one seldom allocates.
+using DispatchArgList = InlinedVector<const TypeAndOrigins *, 4>;
+
 struct DispatchArgs {
     /*
      * A note on selfType vs fullType: Because of proxies, AndType, and OrType,
@@ -672,7 +847,7 @@ struct DispatchArgs {
 
     NameRef name;
     const CallLocs &locs;
-    InlinedVector<const TypeAndOrigins *, 2> &args;
+    DispatchArgList &args;
     const TypePtr &selfType;
     const TypePtr &fullType;
     const std::shared_ptr<const SendAndBlockLink> &block;
@@ -713,20 +888,32 @@ struct DispatchResult {
 
 class BlamedUntyped final : public ClassType {
 public:
+    static constexpr TypeTag TAG = TypeTag::BlamedUntyped;
     const core::SymbolRef blame;
-    BlamedUntyped(SymbolRef whoToBlame) : ClassType(core::Symbols::untyped()), blame(whoToBlame){};
+    BlamedUntyped(SymbolRef whoToBlame)
+        : ClassType(TypeTag::BlamedUntyped, core::Symbols::untyped()), blame(whoToBlame){};
 };
 
 class UnresolvedClassType final : public ClassType {
 public:
+    static constexpr TypeTag TAG = TypeTag::UnresolvedClassType;
     const core::SymbolRef scope;
     const std::vector<core::NameRef> names;
     UnresolvedClassType(SymbolRef scope, std::vector<core::NameRef> names)
-        : ClassType(core::Symbols::untyped()), scope(scope), names(names){};
+        : ClassType(TypeTag::UnresolvedClassType, core::Symbols::untyped()), scope(scope), names(names){};
     virtual std::string toStringWithTabs(const GlobalState &gs, int tabs = 0) const final;
     virtual std::string show(const GlobalState &gs) const final;
     virtual std::string typeName() const final;
 };
 
 } // namespace sorbet::core
+
+namespace sorbet {
+template <typename Base, typename To>
+struct TypecaseCast<Base, To, std::enable_if_t<std::is_base_of<core::Type, Base>::value>> {
+    static To *cast(Base *base) {
+        return core::cast_type<To>(base);
+    }
+};
+} // namespace sorbet
 #endif // SORBET_TYPES_H
@@ -18,7 +18,7 @@ vector<ErrorLine> TypeAndOrigins::origins2Explanations(Context ctx) const {
         }
         return false;
     };
-    auto sortedOrigins = origins;
+    vector<Loc> sortedOrigins(origins.begin(), origins.end());
     fast_sort(sortedOrigins, compare);
     Loc last;
     for (auto o : sortedOrigins) {
@@ -31,6 +31,35 @@ vector<ErrorLine> TypeAndOrigins::origins2Explanations(Context ctx) const {
     return result;
 }
 
+void Origins::emplace_back(Loc loc) {
+    if (size_ == 0) {
+        inlined = loc;
+    } else {
+        if (shared == nullptr) {
+            shared = new Shared();
+            shared->locs.emplace_back(inlined);
+        } else if (shared->refs.load(std::memory_order_acquire) > 1) {
+            auto copy = new Shared();
+            copy->locs = shared->locs;
+            release();
+            shared = copy;
+        }
+        shared->locs.emplace_back(loc);
+    }
+    size_++;
+}
+
+void Origins::addAll(const Origins &other) {
+    if (other.shared != nullptr && other.shared == shared) {
+        return;
+    }
+    for (auto loc : other) {
+        if (!absl::c_linear_search(*this, loc)) {
+            emplace_back(loc);
+        }
+    }
+}
+
 TypeAndOrigins::~TypeAndOrigins() noexcept {
     histogramInc("TypeAndOrigins.origins.size", origins.size());
 }
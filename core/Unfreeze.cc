@@ -29,4 +29,30 @@ UnfreezeFileTable::~UnfreezeFileTable() {
     gs.freezeFileTable();
 }
 
+namespace {
+// Name ids are u4s, but every GlobalState so far has stayed well below this. Reserving room for this many names up
+// front costs one pointer per 1024 of them.
+constexpr u4 MAX_NAMES_WHILE_INDEXING = 1 << 24;
+} // namespace
+
+UnfreezeTablesForIndexing::UnfreezeTablesForIndexing(GlobalState &gs) : gs(gs) {
+    ENFORCE(gs.concurrentNamesMutex == nullptr);
+    auto oldNames = gs.unfreezeNameTable();
+    auto oldFiles = gs.unfreezeFileTable();
+    ENFORCE(oldNames && oldFiles);
+    gs.names.allowConcurrentAppends(MAX_NAMES_WHILE_INDEXING);
+    // Indexing doesn't enter symbols, but does look them up through a non-const GlobalState.
+    gs.symbols.allowConcurrentAppends(gs.symbols.size());
+    gs.concurrentNamesMutex = std::make_unique<absl::Mutex>();
+}
+
+UnfreezeTablesForIndexing::~UnfreezeTablesForIndexing() {
+    gs.concurrentNamesMutex = nullptr;
+    gs.names.disallowConcurrentAppends();
+    gs.symbols.disallowConcurrentAppends();
+    gs.freezeFileTable();
+    gs.freezeNameTable();
+    gs.sanityCheck();
+}
+
 } // namespace sorbet::core
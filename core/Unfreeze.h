@@ -28,5 +28,19 @@ public:
     ~UnfreezeFileTable();
 };
 
+/**
+ * Unfreezes the name and file tables for several threads at once, so that they can all index into the same
+ * GlobalState: names can be entered concurrently, and files reserved with `reserveFileRef` filled in with
+ * `enterNewFileAt`. UnfreezeNameTable and UnfreezeFileTable do nothing while this is alive. Nothing else about `gs`
+ * may be modified until it is destroyed, which must happen on the thread that created it once the others are done.
+ */
+class UnfreezeTablesForIndexing {
+    GlobalState &gs;
+
+public:
+    UnfreezeTablesForIndexing(GlobalState &gs);
+    ~UnfreezeTablesForIndexing();
+};
+
 } // namespace sorbet::core
 #endif // SORBET_UNFREEZING_H
@@ -4,5 +4,6 @@
 
 namespace sorbet::core::errors::Parser {
 constexpr ErrorClass ParserError{2001, StrictLevel::False};
+constexpr ErrorClass InvalidUTF8{2002, StrictLevel::False};
 } // namespace sorbet::core::errors::Parser
 #endif
@@ -27,15 +27,48 @@ Query Query::createVarQuery(core::SymbolRef owner, core::LocalVariable variable)
     return Query(Query::Kind::VAR, core::Loc::none(), owner, variable);
 }
 
+Query Query::createFileQuery(core::FileRef file) {
+    ENFORCE(file.exists());
+    return Query(Query::Kind::FILE, core::Loc(file, 0, 0), core::Symbols::noSymbol(), core::LocalVariable());
+}
+
+Query Query::createMethodQuery(core::Loc methodLoc) {
+    ENFORCE(methodLoc.exists());
+    return Query(Query::Kind::METHOD, methodLoc, core::Symbols::noSymbol(), core::LocalVariable());
+}
+
+Query Query::createAllSymbolsQuery() {
+    return Query(Query::Kind::ALL_SYMBOLS, core::Loc::none(), core::Symbols::noSymbol(), core::LocalVariable());
+}
+
 bool Query::matchesSymbol(const core::SymbolRef &symbol) const {
-    return kind == Query::Kind::SYMBOL && this->symbol == symbol;
+    switch (kind) {
+        case Query::Kind::SYMBOL:
+            return this->symbol == symbol;
+        case Query::Kind::ALL_SYMBOLS:
+            return symbol.exists();
+        default:
+            return false;
+    }
 }
 
 bool Query::matchesLoc(const core::Loc &loc) const {
     // N.B.: Sorbet inserts zero-length Locs for items that are implicitly inserted during parsing.
     // Example: `foo` may be translated into `self.foo`, where `self.` has a 0-length loc.
     // We disregard these in LSP matches, as they don't correspond to source text that the user is pointing at.
-    return kind == Query::Kind::LOC && (loc.endPos() - loc.beginPos()) > 0 && loc.contains(this->loc);
+    if ((loc.endPos() - loc.beginPos()) == 0) {
+        return false;
+    }
+    switch (kind) {
+        case Query::Kind::LOC:
+            return loc.contains(this->loc);
+        case Query::Kind::FILE:
+            return loc.file() == this->loc.file();
+        case Query::Kind::METHOD:
+            return this->loc.contains(loc);
+        default:
+            return false;
+    }
 }
 
 bool Query::matchesVar(const core::SymbolRef &owner, const core::LocalVariable &var) const {
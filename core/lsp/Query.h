@@ -19,7 +19,15 @@ public:
         // Looking for all references to the given symbol.
         SYMBOL,
         // Looking for all references to the given variable.
-        VAR
+        VAR,
+        // Looking for every item within a file. Matches everything a LOC query anywhere in `loc.file()` would, so
+        // its responses can be used to answer those.
+        FILE,
+        // Looking for every item within the method definition that spans `loc`. Only that method is typechecked, but
+        // it matches everything a LOC query within `loc` would.
+        METHOD,
+        // Looking for all references to every symbol. Matches everything a SYMBOL query for any symbol would.
+        ALL_SYMBOLS
     };
 
     Kind kind;
@@ -33,6 +41,9 @@ public:
     static Query createLocQuery(core::Loc loc);
     static Query createSymbolQuery(core::SymbolRef symbol);
     static Query createVarQuery(core::SymbolRef owner, core::LocalVariable variable);
+    static Query createFileQuery(core::FileRef file);
+    static Query createMethodQuery(core::Loc methodLoc);
+    static Query createAllSymbolsQuery();
 
     bool matchesSymbol(const core::SymbolRef &symbol) const;
     bool matchesLoc(const core::Loc &loc) const;
@@ -13,20 +13,72 @@ using namespace std;
 
 namespace sorbet::core {
 
-com::stripe::rubytyper::Name Proto::toProto(const GlobalState &gs, NameRef name) {
-    com::stripe::rubytyper::Name protoName;
-    protoName.set_name(name.show(gs));
+namespace {
+com::stripe::rubytyper::Name::Kind nameKind(const GlobalState &gs, NameRef name) {
     switch (name.data(gs)->kind) {
         case UTF8:
-            protoName.set_kind(com::stripe::rubytyper::Name::UTF8);
-            break;
+            return com::stripe::rubytyper::Name::UTF8;
         case UNIQUE:
-            protoName.set_kind(com::stripe::rubytyper::Name::UNIQUE);
-            break;
+            return com::stripe::rubytyper::Name::UNIQUE;
         case CONSTANT:
-            protoName.set_kind(com::stripe::rubytyper::Name::CONSTANT);
-            break;
+            return com::stripe::rubytyper::Name::CONSTANT;
+    }
+    return com::stripe::rubytyper::Name::UNKNOWN_KIND;
+}
+
+com::stripe::rubytyper::Symbol::Kind symbolKind(const Symbol &data) {
+    if (data.isClass()) {
+        return com::stripe::rubytyper::Symbol::CLASS;
+    } else if (data.isStaticField()) {
+        return com::stripe::rubytyper::Symbol::STATIC_FIELD;
+    } else if (data.isField()) {
+        return com::stripe::rubytyper::Symbol::FIELD;
+    } else if (data.isMethod()) {
+        return com::stripe::rubytyper::Symbol::METHOD;
+    } else if (data.isTypeMember()) {
+        return com::stripe::rubytyper::Symbol::TYPE_MEMBER;
+    } else if (data.isTypeArgument()) {
+        return com::stripe::rubytyper::Symbol::TYPE_ARGUMENT;
     }
+    return com::stripe::rubytyper::Symbol::UNKNOWN_TYPE;
+}
+
+// The members of `sym` that go in its `children`, in the order they're printed.
+vector<SymbolRef> printedChildren(const GlobalState &gs, SymbolRef sym, bool showFull) {
+    vector<SymbolRef> children;
+    for (auto pair : sym.data(gs)->membersStableOrderSlow(gs)) {
+        if (pair.first == Names::singleton() || pair.first == Names::attached() ||
+            pair.first == Names::classMethods()) {
+            continue;
+        }
+
+        if (!pair.second.exists()) {
+            continue;
+        }
+
+        if (!showFull && pair.second.data(gs)->isHiddenFromPrinting(gs)) {
+            bool hadPrintableChild = false;
+            for (auto childPair : pair.second.data(gs)->members()) {
+                if (!childPair.second.data(gs)->isHiddenFromPrinting(gs)) {
+                    hadPrintableChild = true;
+                    break;
+                }
+            }
+            if (!hadPrintableChild) {
+                continue;
+            }
+        }
+
+        children.emplace_back(pair.second);
+    }
+    return children;
+}
+} // namespace
+
+com::stripe::rubytyper::Name Proto::toProto(const GlobalState &gs, NameRef name) {
+    com::stripe::rubytyper::Name protoName;
+    protoName.set_name(name.show(gs));
+    protoName.set_kind(nameKind(gs, name));
     return protoName;
 }
 
@@ -48,19 +100,7 @@ com::stripe::rubytyper::Symbol Proto::toProto(const GlobalState &gs, SymbolRef s
     symbolProto.set_id(sym._id);
     *symbolProto.mutable_name() = toProto(gs, data->name);
 
-    if (data->isClass()) {
-        symbolProto.set_kind(com::stripe::rubytyper::Symbol::CLASS);
-    } else if (data->isStaticField()) {
-        symbolProto.set_kind(com::stripe::rubytyper::Symbol::STATIC_FIELD);
-    } else if (data->isField()) {
-        symbolProto.set_kind(com::stripe::rubytyper::Symbol::FIELD);
-    } else if (data->isMethod()) {
-        symbolProto.set_kind(com::stripe::rubytyper::Symbol::METHOD);
-    } else if (data->isTypeMember()) {
-        symbolProto.set_kind(com::stripe::rubytyper::Symbol::TYPE_MEMBER);
-    } else if (data->isTypeArgument()) {
-        symbolProto.set_kind(com::stripe::rubytyper::Symbol::TYPE_ARGUMENT);
-    }
+    symbolProto.set_kind(symbolKind(*data));
 
     if (data->isClass() || data->isMethod()) {
         if (data->isClass()) {
@@ -84,30 +124,8 @@ com::stripe::rubytyper::Symbol Proto::toProto(const GlobalState &gs, SymbolRef s
         }
     }
 
-    for (auto pair : data->membersStableOrderSlow(gs)) {
-        if (pair.first == Names::singleton() || pair.first == Names::attached() ||
-            pair.first == Names::classMethods()) {
-            continue;
-        }
-
-        if (!pair.second.exists()) {
-            continue;
-        }
-
-        if (!showFull && pair.second.data(gs)->isHiddenFromPrinting(gs)) {
-            bool hadPrintableChild = false;
-            for (auto childPair : pair.second.data(gs)->members()) {
-                if (!childPair.second.data(gs)->isHiddenFromPrinting(gs)) {
-                    hadPrintableChild = true;
-                    break;
-                }
-            }
-            if (!hadPrintableChild) {
-                continue;
-            }
-        }
-
-        *symbolProto.add_children() = toProto(gs, pair.second, showFull);
+    for (auto child : printedChildren(gs, sym, showFull)) {
+        *symbolProto.add_children() = toProto(gs, child, showFull);
     }
 
     return symbolProto;
@@ -375,4 +393,228 @@ void Proto::toJSON(const google::protobuf::Message &message, ostream &out) {
     }
 }
 
+namespace {
+// Writes a symbol table as JSON, the way `Proto::toJSON` would print the message `Proto::toProto` makes for it: one
+// space of indentation per level, fields in the order of their numbers in Symbol.proto, and fields with their default
+// value left out.
+class SymbolJSONWriter {
+    // Once this much is buffered, it is handed to `out`.
+    static constexpr size_t FLUSH_SIZE = 1 << 16;
+
+    const GlobalState &gs;
+    const bool showFull;
+    const function<void(string_view)> &out;
+    fmt::memory_buffer buf;
+    int depth = 0;
+    // Whether nothing has been written yet in the innermost object or array.
+    bool empty = true;
+
+    void newline() {
+        buf.push_back('\n');
+        for (int i = 0; i < depth; i++) {
+            buf.push_back(' ');
+        }
+    }
+
+    void element() {
+        if (!empty) {
+            buf.push_back(',');
+        }
+        newline();
+        empty = false;
+    }
+
+    void key(string_view name) {
+        element();
+        fmt::format_to(buf, "\"{}\": ", name);
+    }
+
+    void start(char open) {
+        buf.push_back(open);
+        depth++;
+        empty = true;
+    }
+
+    void end(char close) {
+        depth--;
+        if (!empty) {
+            newline();
+        }
+        buf.push_back(close);
+        empty = false;
+    }
+
+    // Escapes the same characters protobuf's JSON printer does.
+    static bool needsEscape(u4 cp) {
+        return cp < 0x20 || (cp >= 0x7f && cp <= 0x9f) || cp == 0xad || (cp >= 0x600 && cp <= 0x603) || cp == 0x6dd ||
+               cp == 0x70f || cp == 0x17b4 || cp == 0x17b5 || (cp >= 0x200b && cp <= 0x200f) ||
+               (cp >= 0x2028 && cp <= 0x202e) || (cp >= 0x2060 && cp <= 0x2064) || (cp >= 0x206a && cp <= 0x206f) ||
+               cp == 0xfeff || (cp >= 0xfff9 && cp <= 0xfffb) || (cp >= 0xe0000 && cp <= 0xe0fff);
+    }
+
+    void writeString(string_view str) {
+        buf.push_back('"');
+        for (size_t i = 0; i < str.size();) {
+            auto c = static_cast<unsigned char>(str[i]);
+            int len = c < 0x80 ? 1 : (c & 0xe0) == 0xc0 ? 2 : (c & 0xf0) == 0xe0 ? 3 : (c & 0xf8) == 0xf0 ? 4 : 0;
+            u4 cp = len == 1 ? c : len == 2 ? (c & 0x1f) : len == 3 ? (c & 0x0f) : (c & 0x07);
+            for (int j = 1; j < len; j++) {
+                auto cont = i + j < str.size() ? static_cast<unsigned char>(str[i + j]) : 0;
+                if ((cont & 0xc0) != 0x80) {
+                    len = 0;
+                    break;
+                }
+                cp = (cp << 6) | (cont & 0x3f);
+            }
+            if (len == 0) {
+                // Bytes that aren't UTF-8 are copied as they are.
+                buf.push_back(str[i]);
+                i++;
+                continue;
+            }
+
+            if (c == '"' || c == '\\') {
+                buf.push_back('\\');
+                buf.push_back(c);
+            } else if (c == '<' || c == '>') {
+                fmt::format_to(buf, "\\u{:04x}", cp);
+            } else if (c == '\b') {
+                fmt::format_to(buf, "\\b");
+            } else if (c == '\t') {
+                fmt::format_to(buf, "\\t");
+            } else if (c == '\n') {
+                fmt::format_to(buf, "\\n");
+            } else if (c == '\f') {
+                fmt::format_to(buf, "\\f");
+            } else if (c == '\r') {
+                fmt::format_to(buf, "\\r");
+            } else if (needsEscape(cp) && cp > 0xffff) {
+                cp -= 0x10000;
+                fmt::format_to(buf, "\\u{:04x}\\u{:04x}", 0xd800 + (cp >> 10), 0xdc00 + (cp & 0x3ff));
+            } else if (needsEscape(cp)) {
+                fmt::format_to(buf, "\\u{:04x}", cp);
+            } else {
+                buf.append(str.data() + i, str.data() + i + len);
+            }
+            i += len;
+        }
+        buf.push_back('"');
+    }
+
+    void writeName(NameRef name) {
+        start('{');
+        key("kind");
+        writeString(com::stripe::rubytyper::Name::Kind_Name(nameKind(gs, name)));
+        auto shown = name.show(gs);
+        if (!shown.empty()) {
+            key("name");
+            writeString(shown);
+        }
+        end('}');
+    }
+
+    void writeBool(string_view field, bool value) {
+        if (value) {
+            key(field);
+            fmt::format_to(buf, "true");
+        }
+    }
+
+    void writeArgument(const ArgInfo &arg) {
+        start('{');
+        key("name");
+        writeName(arg.name);
+        writeBool("isKeyword", arg.flags.isKeyword);
+        writeBool("isRepeated", arg.flags.isRepeated);
+        writeBool("isDefault", arg.flags.isDefault);
+        writeBool("isShadow", arg.flags.isShadow);
+        writeBool("isBlock", arg.flags.isBlock);
+        end('}');
+    }
+
+    void writeSymbol(SymbolRef sym) {
+        const auto data = sym.data(gs);
+        start('{');
+        if (sym._id != 0) {
+            key("id");
+            fmt::format_to(buf, "{}", sym._id);
+        }
+        key("name");
+        writeName(data->name);
+        auto kind = symbolKind(*data);
+        if (kind != com::stripe::rubytyper::Symbol::UNKNOWN_TYPE) {
+            key("kind");
+            writeString(com::stripe::rubytyper::Symbol::Kind_Name(kind));
+        }
+
+        if (data->isClass() && data->superClass().exists()) {
+            key("superClass");
+            fmt::format_to(buf, "{}", data->superClass()._id);
+        }
+        if (data->isClass() && !data->mixins().empty()) {
+            key("mixins");
+            start('[');
+            for (auto mixin : data->mixins()) {
+                element();
+                fmt::format_to(buf, "{}", mixin._id);
+            }
+            end(']');
+        }
+
+        auto children = printedChildren(gs, sym, showFull);
+        if (!children.empty()) {
+            key("children");
+            start('[');
+            for (auto child : children) {
+                element();
+                writeSymbol(child);
+            }
+            end(']');
+        }
+
+        if (data->isStaticField()) {
+            if (auto type = core::cast_type<core::AliasType>(data->resultType.get())) {
+                if (type->symbol._id != 0) {
+                    key("aliasTo");
+                    fmt::format_to(buf, "{}", type->symbol._id);
+                }
+            }
+        }
+        if (data->isMethod() && !data->arguments().empty()) {
+            key("arguments");
+            start('[');
+            for (auto &arg : data->arguments()) {
+                element();
+                writeArgument(arg);
+            }
+            end(']');
+        }
+        end('}');
+
+        if (buf.size() >= FLUSH_SIZE) {
+            flush();
+        }
+    }
+
+    void flush() {
+        out(string_view(buf.data(), buf.size()));
+        buf.clear();
+    }
+
+public:
+    SymbolJSONWriter(const GlobalState &gs, bool showFull, const function<void(string_view)> &out)
+        : gs(gs), showFull(showFull), out(out) {}
+
+    void write(SymbolRef root) {
+        writeSymbol(root);
+        buf.push_back('\n');
+        flush();
+    }
+};
+} // namespace
+
+void Proto::toJSON(const GlobalState &gs, SymbolRef root, bool showFull, const function<void(string_view)> &out) {
+    SymbolJSONWriter(gs, showFull, out).write(root);
+}
+
 } // namespace sorbet::core
@@ -11,6 +11,7 @@
 
 #include "core/core.h"
 #include <fstream>
+#include <functional>
 
 namespace sorbet::core {
 class Proto {
@@ -33,6 +34,11 @@ public:
 
     static std::string toJSON(const google::protobuf::Message &message);
     static void toJSON(const google::protobuf::Message &message, std::ostream &out);
+
+    // Writes the JSON `toJSON(toProto(gs, root, showFull))` would, without making the messages first. It is handed to
+    // `out` a piece at a time, so the whole symbol table is never in memory at once.
+    static void toJSON(const GlobalState &gs, SymbolRef root, bool showFull,
+                       const std::function<void(std::string_view)> &out);
 };
 } // namespace sorbet::core
 
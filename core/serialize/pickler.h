@@ -3,6 +3,10 @@
 
 #include "common/common.h"
 
+namespace sorbet {
+class WorkerPool;
+}
+
 namespace sorbet::core::serialize {
 class Pickler {
     std::vector<u1> data;
@@ -10,24 +14,44 @@ class Pickler {
 
 public:
     void putU4(u4 u);
+    void putU8(u8 u);
     void putU1(const u1 u);
     void putS8(const int64_t i);
     void putStr(std::string_view s);
-    std::vector<u1> result(int compressionDegree);
+    // Appends everything put into `other`, as if it had been put into this one instead. Lets independent parts of the
+    // data be pickled in parallel.
+    void append(Pickler &&other);
+    // With a `compressionDegree` of NO_COMPRESSION, the data is stored as-is and UnPickler reads it in place. If
+    // `workers` is given, blocks are compressed in parallel on it.
+    std::vector<u1> result(int compressionDegree, WorkerPool *workers = nullptr);
     Pickler() = default;
+
+    static constexpr int NO_COMPRESSION = 0;
+    // Compressed data is split into blocks of this many bytes, see `result`.
+    static constexpr int BLOCK_SIZE = 1 << 20;
 };
 
 class UnPickler {
     int pos;
     u1 zeroCounter = 0;
-    std::vector<u1> data;
+    // Only used if the data was compressed.
+    std::vector<u1> decompressed;
+    const u1 *data;
 
 public:
     u4 getU4();
+    u8 getU8();
     u1 getU1();
     int64_t getS8();
     std::string_view getStr();
-    explicit UnPickler(const u1 *const compressed, spdlog::logger &tracer);
+    // Whether the data is read where it was given rather than from a decompressed copy, so that views returned by
+    // `getStr` live as long as that.
+    bool readsInPlace() const {
+        return decompressed.empty();
+    }
+    // If `workers` is given, blocks of compressed data are decompressed in parallel on it.
+    explicit UnPickler(const u1 *const compressed, spdlog::logger &tracer, WorkerPool *workers = nullptr);
+    UnPickler(const UnPickler &) = delete;
 };
 
 } // namespace sorbet::core::serialize
@@ -3,9 +3,11 @@
 #include "absl/types/span.h"
 #include "ast/Helpers.h"
 #include "common/Timer.h"
+#include "common/concurrency/WorkerPool.h"
 #include "common/typecase.h"
 #include "core/Error.h"
 #include "core/GlobalState.h"
+#include "core/NameHash.h"
 #include "core/Symbols.h"
 #include "core/serialize/pickler.h"
 #include "lib/lizard_compress.h"
@@ -19,13 +21,15 @@ namespace sorbet::core::serialize {
 const u4 Serializer::VERSION;
 const u1 Serializer::GLOBAL_STATE_COMPRESSION_DEGREE;
 const u1 Serializer::FILE_COMPRESSION_DEGREE;
+const u1 Serializer::KVSTORE_GLOBAL_STATE_COMPRESSION_DEGREE;
 
 // These helper methods are declared in a class inside of an anonymous namespace
 // or inline so that `GlobalState` can forward-declare and `friend` the entire
 // class.
 class SerializerImpl {
 public:
-    static Pickler pickle(const GlobalState &gs, bool payloadOnly = false);
+    // If `workers` is given, the tables are pickled in parallel on it.
+    static Pickler pickle(const GlobalState &gs, bool payloadOnly = false, WorkerPool *workers = nullptr);
     static void pickle(Pickler &p, const File &what);
     static void pickle(Pickler &p, const Name &what);
     static void pickle(Pickler &p, Type *what);
@@ -33,15 +37,19 @@ public:
     static void pickle(Pickler &p, const Symbol &what);
     static void pickle(Pickler &p, FileRef file, const unique_ptr<ast::Expression> &what);
     static void pickle(Pickler &p, core::Loc loc);
+    // For locs in a tree, which are all in the file the tree is pickled with.
+    static void pickleInFile(Pickler &p, core::Loc loc);
 
     template <class T> static void pickleTree(Pickler &p, FileRef file, unique_ptr<T> &t);
 
-    static shared_ptr<File> unpickleFile(UnPickler &p);
-    static Name unpickleName(UnPickler &p, GlobalState &gs);
+    // With `borrow`, strings reference the pickled data instead of being copied.
+    static shared_ptr<File> unpickleFile(UnPickler &p, bool borrow);
+    static Name unpickleName(UnPickler &p, GlobalState &gs, bool borrow);
     static TypePtr unpickleType(UnPickler &p, GlobalState *gs);
     static ArgInfo unpickleArgInfo(UnPickler &p, GlobalState *gs);
     static Symbol unpickleSymbol(UnPickler &p, GlobalState *gs);
-    static void unpickleGS(UnPickler &p, GlobalState &result);
+    static void unpickleGS(UnPickler &p, GlobalState &result, bool borrow);
+    static Loc unpickleLoc(UnPickler &p);
     static Loc unpickleLoc(UnPickler &p, FileRef file);
     static unique_ptr<ast::Expression> unpickleExpr(UnPickler &p, GlobalState &, FileRef file);
     static NameRef unpickleNameRef(UnPickler &p, GlobalState &);
@@ -62,48 +70,137 @@ void Pickler::putStr(string_view s) {
 
 constexpr size_t SIZE_BYTES = sizeof(int) / sizeof(u1);
 
-vector<u1> Pickler::result(int compressionDegree) {
+// Layout of a pickled blob, all sizes being `int`s:
+//
+//   blockCount, uncompressedSize
+//   if blockCount == 0: the data itself, uncompressed
+//   otherwise:          blockSize, blockCount compressed block sizes, then the compressed blocks
+//
+// Every block but the last decompresses to exactly `blockSize` bytes. Blocks are compressed independently, so they
+// can be decompressed in parallel.
+vector<u1> Pickler::result(int compressionDegree, WorkerPool *workers) {
     if (zeroCounter != 0) {
         data.emplace_back(zeroCounter);
         zeroCounter = 0;
     }
-    const size_t maxDstSize = Lizard_compressBound(data.size());
-    vector<u1> compressedData;
-    compressedData.resize(2048 + maxDstSize); // give extra room for compression
-                                              // Lizard_compressBound returns size of data if compression
-                                              // succeeds. It seems to be written for big inputs
-                                              // and returns too small sizes for small inputs,
-                                              // where compressed size is bigger than original size
-    int resultCode = Lizard_compress((const char *)data.data(), (char *)(compressedData.data() + SIZE_BYTES * 2),
-                                     data.size(), (compressedData.size() - SIZE_BYTES * 2), compressionDegree);
-    if (resultCode == 0) {
-        // did not compress!
-        Exception::raise("incompressible pickler?");
+    int uncompressedSize = data.size();
+    if (compressionDegree == NO_COMPRESSION || data.empty()) {
+        vector<u1> storedData(SIZE_BYTES * 2 + data.size());
+        int blockCount = 0;
+        memcpy(storedData.data(), &blockCount, SIZE_BYTES);
+        memcpy(storedData.data() + SIZE_BYTES, &uncompressedSize, SIZE_BYTES);
+        memcpy(storedData.data() + SIZE_BYTES * 2, data.data(), data.size());
+        return storedData;
+    }
+
+    const int blockCount = (data.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    vector<vector<u1>> blocks(blockCount);
+    auto compress = [this, uncompressedSize, compressionDegree, &blocks](int i) {
+        const int blockStart = i * BLOCK_SIZE;
+        const int blockLength = min(BLOCK_SIZE, uncompressedSize - blockStart);
+        auto &block = blocks[i];
+        // give extra room for compression. Lizard_compressBound returns size of data if compression succeeds. It
+        // seems to be written for big inputs and returns too small sizes for small inputs, where compressed size is
+        // bigger than original size
+        block.resize(2048 + Lizard_compressBound(blockLength));
+        int resultCode = Lizard_compress((const char *)data.data() + blockStart, (char *)block.data(), blockLength,
+                                         block.size(), compressionDegree);
+        // 0 means it did not compress, which is reported once all blocks are done.
+        block.resize(resultCode);
+    };
+    if (workers != nullptr && blockCount > 1) {
+        WorkerPool::TaskGroup group;
+        for (int i = 0; i < blockCount; i++) {
+            workers->submit(group, [&compress, i]() { compress(i); });
+        }
+        workers->wait(group);
     } else {
-        memcpy(compressedData.data(), &resultCode, SIZE_BYTES); // ~200K of our stdlib
-        int uncompressedSize = data.size();
-        memcpy(compressedData.data() + SIZE_BYTES, &uncompressedSize,
-               SIZE_BYTES);                                     // 172817 ints(x4), ~675K of our stdlib
-        int actualCompressedSize = resultCode + SIZE_BYTES * 2; // SIZE_BYTES * 2 are for sizes
-        compressedData.resize(actualCompressedSize);
+        for (int i = 0; i < blockCount; i++) {
+            compress(i);
+        }
+    }
+
+    const size_t headerSize = SIZE_BYTES * (3 + blockCount);
+    size_t totalSize = headerSize;
+    for (auto &block : blocks) {
+        if (block.empty()) {
+            Exception::raise("incompressible pickler?");
+        }
+        totalSize += block.size();
+    }
+    vector<u1> compressedData(headerSize);
+    compressedData.reserve(totalSize);
+    memcpy(compressedData.data(), &blockCount, SIZE_BYTES);
+    memcpy(compressedData.data() + SIZE_BYTES, &uncompressedSize, SIZE_BYTES);
+    int blockSize = BLOCK_SIZE;
+    memcpy(compressedData.data() + SIZE_BYTES * 2, &blockSize, SIZE_BYTES);
+    for (int i = 0; i < blockCount; i++) {
+        int compressedSize = blocks[i].size();
+        memcpy(compressedData.data() + SIZE_BYTES * (3 + i), &compressedSize, SIZE_BYTES);
+        compressedData.insert(compressedData.end(), blocks[i].begin(), blocks[i].end());
+        vector<u1>().swap(blocks[i]);
     }
     return compressedData;
 }
 
-UnPickler::UnPickler(const u1 *const compressed, spdlog::logger &tracer) : pos(0) {
+UnPickler::UnPickler(const u1 *const compressed, spdlog::logger &tracer, WorkerPool *workers) : pos(0) {
     Timer timeit(tracer, "Unpickler::UnPickler");
-    int compressedSize;
-    memcpy(&compressedSize, compressed, SIZE_BYTES);
+    int blockCount;
+    memcpy(&blockCount, compressed, SIZE_BYTES);
     int uncompressedSize;
     memcpy(&uncompressedSize, compressed + SIZE_BYTES, SIZE_BYTES);
 
-    data.resize(uncompressedSize);
+    if (blockCount == 0) {
+        // Stored uncompressed. Reading it in place means that if it lives in a memory map (the KeyValueStore's, or
+        // the executable's), only the pages we actually touch get read in.
+        data = compressed + 2 * SIZE_BYTES;
+        return;
+    }
 
-    int resultCode = Lizard_decompress_safe((const char *)(compressed + 2 * SIZE_BYTES), (char *)this->data.data(),
-                                            compressedSize, uncompressedSize);
-    if (resultCode != uncompressedSize) {
-        Exception::raise("incomplete decompression");
+    int blockSize;
+    memcpy(&blockSize, compressed + SIZE_BYTES * 2, SIZE_BYTES);
+    struct Block {
+        const u1 *compressed;
+        int compressedSize;
+        int uncompressedStart;
+        int uncompressedSize;
+        bool failed = false;
+    };
+    vector<Block> blocks(blockCount);
+    const u1 *nextBlock = compressed + SIZE_BYTES * (3 + blockCount);
+    for (int i = 0; i < blockCount; i++) {
+        auto &block = blocks[i];
+        memcpy(&block.compressedSize, compressed + SIZE_BYTES * (3 + i), SIZE_BYTES);
+        block.compressed = nextBlock;
+        block.uncompressedStart = i * blockSize;
+        block.uncompressedSize = min(blockSize, uncompressedSize - block.uncompressedStart);
+        nextBlock += block.compressedSize;
+    }
+
+    decompressed.resize(uncompressedSize);
+    auto decompress = [this](Block &block) {
+        int resultCode = Lizard_decompress_safe((const char *)block.compressed,
+                                                (char *)this->decompressed.data() + block.uncompressedStart,
+                                                block.compressedSize, block.uncompressedSize);
+        block.failed = resultCode != block.uncompressedSize;
+    };
+    if (workers != nullptr && blockCount > 1) {
+        WorkerPool::TaskGroup group;
+        for (auto &block : blocks) {
+            workers->submit(group, [&decompress, &block]() { decompress(block); });
+        }
+        workers->wait(group);
+    } else {
+        for (auto &block : blocks) {
+            decompress(block);
+        }
     }
+    for (auto &block : blocks) {
+        if (block.failed) {
+            Exception::raise("incomplete decompression");
+        }
+    }
+    data = decompressed.data();
 }
 
 string_view UnPickler::getStr() {
@@ -114,6 +211,25 @@ string_view UnPickler::getStr() {
     return result;
 }
 
+void Pickler::append(Pickler &&other) {
+    if (other.data.empty()) {
+        return;
+    }
+    // Runs of zeroes are self-delimiting, so ending ours here and starting over with `other`'s keeps the data readable.
+    if (zeroCounter != 0) {
+        data.emplace_back(zeroCounter);
+        zeroCounter = 0;
+    }
+    if (data.empty()) {
+        data = move(other.data);
+    } else {
+        data.insert(data.end(), other.data.begin(), other.data.end());
+    }
+    zeroCounter = other.zeroCounter;
+    other.data.clear();
+    other.zeroCounter = 0;
+}
+
 void Pickler::putU1(u1 u) {
     if (zeroCounter != 0) {
         data.emplace_back(zeroCounter);
@@ -202,8 +318,7 @@ u4 UnPickler::getU4() {
     }
 }
 
-void Pickler::putS8(const int64_t i) {
-    auto u = absl::bit_cast<u8>(i);
+void Pickler::putU8(u8 u) {
     while (u > 127) {
         putU1((u & 127) | 128);
         u = u >> 7;
@@ -211,7 +326,7 @@ void Pickler::putS8(const int64_t i) {
     putU1(u & 127);
 }
 
-int64_t UnPickler::getS8() {
+u8 UnPickler::getU8() {
     u8 res = 0;
     u8 vle = 128;
     int i = 0;
@@ -220,18 +335,82 @@ int64_t UnPickler::getS8() {
         res |= (vle & 127) << (i * 7);
         i++;
     }
-    return absl::bit_cast<int64_t>(res);
+    return res;
 }
 
+void Pickler::putS8(const int64_t i) {
+    putU8(absl::bit_cast<u8>(i));
+}
+
+int64_t UnPickler::getS8() {
+    return absl::bit_cast<int64_t>(getU8());
+}
+
+namespace {
+// Payload contents are only read to show them, e.g. in error snippets, so they're compressed one file at a time and
+// only decompressed when first asked for. Most are never shown, and stay compressed for the life of the process.
+bool compressesSource(File::Type type) {
+    return type == File::Type::PayloadGeneration || type == File::Type::Payload;
+}
+
+string compressSource(string_view source) {
+    string compressed;
+    // See Pickler::result for the extra room.
+    compressed.resize(2048 + Lizard_compressBound(source.size()));
+    int compressedSize = Lizard_compress(source.data(), compressed.data(), source.size(), compressed.size(),
+                                         Serializer::FILE_COMPRESSION_DEGREE);
+    if (compressedSize == 0) {
+        Exception::raise("incompressible file?");
+    }
+    compressed.resize(compressedSize);
+    return compressed;
+}
+
+string decompressSource(string_view compressed, u4 size) {
+    string source(size, '\0');
+    int resultCode = Lizard_decompress_safe(compressed.data(), source.data(), compressed.size(), size);
+    if (resultCode != (int)size) {
+        Exception::raise("incomplete decompression");
+    }
+    return source;
+}
+} // namespace
+
 void SerializerImpl::pickle(Pickler &p, const File &what) {
     p.putU1((u1)what.sourceType);
     p.putStr(what.path());
-    p.putStr(what.source());
+    if (!compressesSource(what.sourceType)) {
+        p.putStr(what.source());
+        return;
+    }
+    auto source = what.source();
+    p.putU1((u1)what.originalSigil);
+    p.putU4(source.size());
+    p.putStr(source.empty() ? "" : compressSource(source));
 }
 
-shared_ptr<File> SerializerImpl::unpickleFile(UnPickler &p) {
+shared_ptr<File> SerializerImpl::unpickleFile(UnPickler &p, bool borrow) {
     auto t = (File::Type)p.getU1();
     auto path = string(p.getStr());
+    if (compressesSource(t)) {
+        auto sigil = (StrictLevel)p.getU1();
+        auto size = p.getU4();
+        auto compressed = p.getStr();
+        if (size == 0) {
+            return make_shared<File>(std::move(path), string(), t);
+        }
+        // Borrowed data outlives the state, so the compressed contents can stay where they are.
+        function<string()> load;
+        if (borrow) {
+            load = [compressed, size]() { return decompressSource(compressed, size); };
+        } else {
+            load = [copy = string(compressed), size]() { return decompressSource(copy, size); };
+        }
+        return make_shared<File>(std::move(path), File::LazySource{std::move(load), sigil}, t);
+    }
+    if (borrow) {
+        return make_shared<File>(std::move(path), File::BorrowedSource{p.getStr()}, t);
+    }
     auto source = string(p.getStr());
     auto ret = make_shared<File>(std::move(path), std::move(source), t);
     return ret;
@@ -254,13 +433,13 @@ void SerializerImpl::pickle(Pickler &p, const Name &what) {
     }
 }
 
-Name SerializerImpl::unpickleName(UnPickler &p, GlobalState &gs) {
+Name SerializerImpl::unpickleName(UnPickler &p, GlobalState &gs, bool borrow) {
     Name result;
     result.kind = (NameKind)p.getU1();
     switch (result.kind) {
         case NameKind::UTF8:
             result.kind = NameKind::UTF8;
-            result.raw.utf8 = gs.enterString(p.getStr());
+            result.raw.utf8 = borrow ? p.getStr() : gs.enterString(p.getStr());
             break;
         case NameKind::UNIQUE:
             result.unique.uniqueNameKind = (UniqueNameKind)p.getU1();
@@ -434,13 +613,7 @@ ArgInfo SerializerImpl::unpickleArgInfo(UnPickler &p, GlobalState *gs) {
     ArgInfo result;
     result.name = core::NameRef(*gs, p.getU4());
     result.rebind = core::SymbolRef(gs, p.getU4());
-    {
-        core::Loc loc;
-        auto low = p.getU4();
-        auto high = p.getU4();
-        loc.setFrom2u4(low, high);
-        result.loc = loc;
-    }
+    result.loc = unpickleLoc(p);
     {
         u1 flags = p.getU1();
         result.flags.setFromU1(flags);
@@ -449,6 +622,21 @@ ArgInfo SerializerImpl::unpickleArgInfo(UnPickler &p, GlobalState *gs) {
     return result;
 }
 
+namespace {
+// Intrinsics are pickled as one more than their index in `intrinsicMethods`, or as 0 for none, so that loaded states
+// don't need `GlobalState::installIntrinsics`.
+u4 intrinsicIndex(const Symbol &method) {
+    if (method.intrinsic == nullptr) {
+        return 0;
+    }
+    auto it = absl::c_find_if(intrinsicMethods, [&](const auto &entry) {
+        return entry.impl == method.intrinsic && entry.method == method.name;
+    });
+    ENFORCE(it != intrinsicMethods.end());
+    return it - intrinsicMethods.begin() + 1;
+}
+} // namespace
+
 void SerializerImpl::pickle(Pickler &p, const Symbol &what) {
     p.putU4(what.owner._id);
     p.putU4(what.name._id);
@@ -489,6 +677,7 @@ void SerializerImpl::pickle(Pickler &p, const Symbol &what) {
     for (auto &loc : what.locs()) {
         pickle(p, loc);
     }
+    p.putU4(intrinsicIndex(what));
 }
 
 Symbol SerializerImpl::unpickleSymbol(UnPickler &p, GlobalState *gs) {
@@ -514,6 +703,7 @@ Symbol SerializerImpl::unpickleSymbol(UnPickler &p, GlobalState *gs) {
 
     if (result.isMethod()) {
         int argsSize = p.getU4();
+        result.arguments().reserve(argsSize);
         for (int i = 0; i < argsSize; i++) {
             result.arguments().emplace_back(unpickleArgInfo(p, gs));
         }
@@ -531,17 +721,29 @@ Symbol SerializerImpl::unpickleSymbol(UnPickler &p, GlobalState *gs) {
     }
     result.resultType = unpickleType(p, gs);
     auto locCount = p.getU4();
+    result.locs_.reserve(locCount);
     for (int i = 0; i < locCount; i++) {
-        core::Loc loc;
-        auto low = p.getU4();
-        auto high = p.getU4();
-        loc.setFrom2u4(low, high);
-        result.locs_.emplace_back(loc);
+        result.locs_.emplace_back(unpickleLoc(p));
+    }
+    if (auto intrinsic = p.getU4()) {
+        // Catches states stored by a build with other intrinsics.
+        if (intrinsic > intrinsicMethods.size() || intrinsicMethods[intrinsic - 1].method != result.name) {
+            Exception::raise("Payload intrinsics mismatch");
+        }
+        result.intrinsic = intrinsicMethods[intrinsic - 1].impl;
     }
     return result;
 }
 
-Pickler SerializerImpl::pickle(const GlobalState &gs, bool payloadOnly) {
+namespace {
+// How many entries of each table are pickled together when pickling in parallel. Files are mostly their contents, so
+// fewer of them make a section.
+constexpr int FILES_PER_SECTION = 64;
+constexpr int NAMES_PER_SECTION = 1 << 14;
+constexpr int SYMBOLS_PER_SECTION = 1 << 12;
+} // namespace
+
+Pickler SerializerImpl::pickle(const GlobalState &gs, bool payloadOnly, WorkerPool *workers) {
     Timer timeit(gs.tracer(), "pickleGlobalState");
     Pickler result;
     result.putU4(Serializer::VERSION);
@@ -556,27 +758,53 @@ Pickler SerializerImpl::pickle(const GlobalState &gs, bool payloadOnly) {
         wantFiles = absl::Span<const shared_ptr<File>>(gs.files.data(), gs.files.size());
     }
 
-    result.putU4(wantFiles.size());
-    int i = -1;
-    for (auto &f : wantFiles) {
-        ++i;
-        if (i != 0) {
-            pickle(result, *f);
+    // The tables are pickled in sections of consecutive entries, each into a Pickler of its own, which are then
+    // appended in order. The result is the same as pickling everything in one go.
+    struct Section {
+        Pickler pickler;
+        function<void(Pickler &)> fill;
+    };
+    vector<Section> sections;
+    // Each table is its size, then its entries.
+    auto addSections = [&sections](int size, int perSection, auto pickleEntry) {
+        sections.emplace_back().fill = [size](Pickler &p) { p.putU4(size); };
+        for (int begin = 0; begin < size; begin += perSection) {
+            int end = min(size, begin + perSection);
+            sections.emplace_back().fill = [begin, end, pickleEntry](Pickler &p) {
+                for (int i = begin; i < end; i++) {
+                    pickleEntry(p, i);
+                }
+            };
         }
-    }
+    };
 
-    result.putU4(gs.names.size());
-    i = -1;
-    for (const Name &n : gs.names) {
-        ++i;
+    // Entry 0 of the files and names tables is a placeholder that isn't pickled.
+    addSections(wantFiles.size(), FILES_PER_SECTION, [&wantFiles](Pickler &p, int i) {
         if (i != 0) {
-            pickle(result, n);
+            pickle(p, *wantFiles[i]);
+        }
+    });
+    addSections(gs.names.size(), NAMES_PER_SECTION, [&gs](Pickler &p, int i) {
+        if (i != 0) {
+            pickle(p, gs.names[i]);
+        }
+    });
+    addSections(gs.symbols.size(), SYMBOLS_PER_SECTION, [&gs](Pickler &p, int i) { pickle(p, gs.symbols[i]); });
+
+    if (workers != nullptr && sections.size() > 1) {
+        WorkerPool::TaskGroup group;
+        for (auto &section : sections) {
+            workers->submit(group, [&section]() { section.fill(section.pickler); });
+        }
+        workers->wait(group);
+    } else {
+        for (auto &section : sections) {
+            section.fill(section.pickler);
         }
     }
 
-    result.putU4(gs.symbols.size());
-    for (const Symbol &s : gs.symbols) {
-        pickle(result, s);
+    for (auto &section : sections) {
+        result.append(move(section.pickler));
     }
 
     result.putU4(gs.namesByHash.size());
@@ -595,7 +823,7 @@ int nearestPowerOf2(int from) {
     return i;
 }
 
-void SerializerImpl::unpickleGS(UnPickler &p, GlobalState &result) {
+void SerializerImpl::unpickleGS(UnPickler &p, GlobalState &result, bool borrow) {
     Timer timeit(result.tracer(), "unpickleGS");
     result.creation = timeit.getFlowEdge();
     if (p.getU4() != Serializer::VERSION) {
@@ -604,9 +832,9 @@ void SerializerImpl::unpickleGS(UnPickler &p, GlobalState &result) {
 
     vector<shared_ptr<File>> files(std::move(result.files));
     files.clear();
-    vector<Name> names(std::move(result.names));
+    auto names(std::move(result.names));
     names.clear();
-    vector<Symbol> symbols(std::move(result.symbols));
+    auto symbols(std::move(result.symbols));
     symbols.clear();
     vector<pair<unsigned int, unsigned int>> namesByHash(std::move(result.namesByHash));
     namesByHash.clear();
@@ -619,7 +847,7 @@ void SerializerImpl::unpickleGS(UnPickler &p, GlobalState &result) {
             if (i == 0) {
                 files.emplace_back();
             } else {
-                files.emplace_back(unpickleFile(p));
+                files.emplace_back(unpickleFile(p, borrow));
             }
         }
     }
@@ -636,13 +864,17 @@ void SerializerImpl::unpickleGS(UnPickler &p, GlobalState &result) {
                 inserted.kind = NameKind::UTF8;
                 inserted.raw.utf8 = string_view();
             } else {
-                names.emplace_back(unpickleName(p, result));
+                names.emplace_back(unpickleName(p, result, borrow));
             }
         }
     }
 
     {
         Timer timeit(result.tracer(), "readSymbols");
+        // Symbols are materialized eagerly. Every run goes through whole-table passes (Resolver::finalizeSymbols,
+        // GlobalState::hash, sanityCheck, deepCopy) that would force any lazily-loaded symbol anyway, and
+        // SymbolRef::data is called concurrently on a const GlobalState during typechecking, so loading on first
+        // access would put a synchronization point on every symbol lookup.
 
         int symbolSize = p.getU4();
         ENFORCE(symbolSize > 0);
@@ -684,37 +916,45 @@ void SerializerImpl::unpickleGS(UnPickler &p, GlobalState &result) {
     result.sanityCheck();
 }
 
+// Locs are pickled as their begin and their length, which as varints mostly take 3 bytes and 1, where the two u4s of
+// `getAs2u4` hold the file id in their low bits and so take 4 bytes each.
 void SerializerImpl::pickle(Pickler &p, Loc loc) {
-    auto [low, high] = loc.getAs2u4();
-    p.putU4(low);
-    p.putU4(high);
+    p.putU4(loc.file().id());
+    pickleInFile(p, loc);
+}
+
+void SerializerImpl::pickleInFile(Pickler &p, Loc loc) {
+    p.putU4(loc.beginPos());
+    p.putU4(loc.endPos() - loc.beginPos());
+}
+
+Loc SerializerImpl::unpickleLoc(UnPickler &p) {
+    FileRef file(p.getU4());
+    return unpickleLoc(p, file);
 }
 
 Loc SerializerImpl::unpickleLoc(UnPickler &p, FileRef file) {
-    Loc loc;
-    auto low = p.getU4();
-    auto high = p.getU4();
-    loc.setFrom2u4(low, high);
-    loc.setFile(file);
-    return loc;
+    auto begin = p.getU4();
+    auto length = p.getU4();
+    return Loc(file, begin, begin + length);
 }
 
-vector<u1> Serializer::store(GlobalState &gs) {
-    Pickler p = SerializerImpl::pickle(gs);
-    return p.result(GLOBAL_STATE_COMPRESSION_DEGREE);
+vector<u1> Serializer::store(GlobalState &gs, bool compressed, WorkerPool *workers) {
+    Pickler p = SerializerImpl::pickle(gs, false, workers);
+    return p.result(compressed ? GLOBAL_STATE_COMPRESSION_DEGREE : Pickler::NO_COMPRESSION, workers);
 }
 
-vector<u1> Serializer::storePayloadAndNameTable(GlobalState &gs) {
+vector<u1> Serializer::storePayloadAndNameTable(GlobalState &gs, WorkerPool *workers) {
     Timer timeit(gs.tracer(), "Serializer::storePayloadAndNameTable");
-    Pickler p = SerializerImpl::pickle(gs, true);
-    return p.result(GLOBAL_STATE_COMPRESSION_DEGREE);
+    Pickler p = SerializerImpl::pickle(gs, true, workers);
+    return p.result(KVSTORE_GLOBAL_STATE_COMPRESSION_DEGREE, workers);
 }
 
-void Serializer::loadGlobalState(GlobalState &gs, const u1 *const data) {
+void Serializer::loadGlobalState(GlobalState &gs, const u1 *const data, WorkerPool *workers,
+                                 bool dataOutlivesState) {
     ENFORCE(gs.files.empty() && gs.names.empty() && gs.symbols.empty(), "Can't load into a non-empty state");
-    UnPickler p(data, gs.tracer());
-    SerializerImpl::unpickleGS(p, gs);
-    gs.installIntrinsics();
+    UnPickler p(data, gs.tracer(), workers);
+    SerializerImpl::unpickleGS(p, gs, dataOutlivesState && p.readsInPlace());
 }
 
 template <class T> void SerializerImpl::pickleTree(Pickler &p, FileRef file, unique_ptr<T> &t) {
@@ -727,7 +967,7 @@ template <class T> void SerializerImpl::pickleTree(Pickler &p, FileRef file, uni
 
 void SerializerImpl::pickleAstHeader(Pickler &p, u1 tag, ast::Expression *tree) {
     p.putU1(tag);
-    pickle(p, tree->loc);
+    pickleInFile(p, tree->loc);
 }
 
 void SerializerImpl::pickle(Pickler &p, FileRef file, const unique_ptr<ast::Expression> &what) {
@@ -849,7 +1089,7 @@ void SerializerImpl::pickle(Pickler &p, FileRef file, const unique_ptr<ast::Expr
         [&](ast::EmptyTree *n) { pickleAstHeader(p, 20, n); },
         [&](ast::ClassDef *c) {
             pickleAstHeader(p, 21, c);
-            pickle(p, c->declLoc);
+            pickleInFile(p, c->declLoc);
             p.putU1(c->kind);
             p.putU4(c->symbol._id);
             p.putU4(c->ancestors.size());
@@ -868,7 +1108,7 @@ void SerializerImpl::pickle(Pickler &p, FileRef file, const unique_ptr<ast::Expr
         },
         [&](ast::MethodDef *c) {
             pickleAstHeader(p, 22, c);
-            pickle(p, c->declLoc);
+            pickleInFile(p, c->declLoc);
             p.putU4(c->flags);
             p.putU4(c->name._id);
             p.putU4(c->symbol._id);
@@ -1177,9 +1417,235 @@ vector<u1> Serializer::storeExpression(GlobalState &gs, unique_ptr<ast::Expressi
     return pickler.result(FILE_COMPRESSION_DEGREE);
 }
 
+namespace {
+// The file index under which storeErrors stores locs in the file they're relative to.
+constexpr u4 RELATIVE_FILE_INDEX = 0xFFFFFFFF;
+} // namespace
+
+vector<u1> Serializer::storeErrors(const GlobalState &gs, const GlobalStateHash &usedHashes,
+                                   const vector<const Error *> &errors, FileRef relativeTo, u4 base) {
+    Pickler p;
+    p.putU4(usedHashes.hierarchyHash);
+    vector<pair<NameHash, u4>> methodHashes(usedHashes.methodHashes.begin(), usedHashes.methodHashes.end());
+    fast_sort(methodHashes, [](const auto &lhs, const auto &rhs) -> bool { return lhs.first < rhs.first; });
+    p.putU4(methodHashes.size());
+    for (const auto &[name, hash] : methodHashes) {
+        p.putU8(name._hashValue);
+        p.putU4(hash);
+    }
+
+    // Index 0 is reserved for locs that don't point into any file.
+    vector<FileRef> files;
+    UnorderedMap<FileRef, u4> fileIndex;
+    auto indexOf = [&](Loc loc) -> u4 {
+        if (!loc.file().exists()) {
+            return 0;
+        }
+        if (loc.file() == relativeTo) {
+            return RELATIVE_FILE_INDEX;
+        }
+        auto [it, inserted] = fileIndex.try_emplace(loc.file(), files.size() + 1);
+        if (inserted) {
+            files.emplace_back(loc.file());
+        }
+        return it->second;
+    };
+    for (const auto *error : errors) {
+        indexOf(error->loc);
+        for (const auto &section : error->sections) {
+            for (const auto &line : section.messages) {
+                indexOf(line.loc);
+            }
+        }
+        for (const auto &autocorrect : error->autocorrects) {
+            for (const auto &edit : autocorrect.edits) {
+                indexOf(edit.loc);
+            }
+        }
+    }
+    p.putU4(files.size());
+    for (auto file : files) {
+        p.putStr(file.data(gs).path());
+        p.putStr(file.data(gs).contentHash());
+    }
+
+    auto pickleLoc = [&](Loc loc) {
+        auto index = indexOf(loc);
+        auto offset = index == RELATIVE_FILE_INDEX ? base : 0;
+        ENFORCE(loc.beginPos() >= offset);
+        p.putU4(index);
+        p.putU4(loc.beginPos() - offset);
+        p.putU4(loc.endPos() - offset);
+    };
+    p.putU4(errors.size());
+    for (const auto *error : errors) {
+        pickleLoc(error->loc);
+        p.putU4(error->what.code);
+        p.putU1((u1)error->what.minLevel);
+        p.putStr(error->header);
+        p.putU4(error->sections.size());
+        for (const auto &section : error->sections) {
+            p.putStr(section.header);
+            p.putU4(section.messages.size());
+            for (const auto &line : section.messages) {
+                pickleLoc(line.loc);
+                p.putStr(line.formattedMessage);
+            }
+        }
+        p.putU4(error->autocorrects.size());
+        for (const auto &autocorrect : error->autocorrects) {
+            p.putStr(autocorrect.title);
+            p.putU4(autocorrect.edits.size());
+            for (const auto &edit : autocorrect.edits) {
+                pickleLoc(edit.loc);
+                p.putStr(edit.replacement);
+            }
+        }
+    }
+    return p.result(FILE_COMPRESSION_DEGREE);
+}
+
+optional<vector<unique_ptr<Error>>> Serializer::loadErrors(const GlobalState &gs, const GlobalStateHash &currentHashes,
+                                                           const u1 *const data, FileRef relativeTo, u4 base) {
+    UnPickler p(data, gs.tracer());
+    if (p.getU4() != currentHashes.hierarchyHash) {
+        return nullopt;
+    }
+    int methodHashesSize = p.getU4();
+    for (int i = 0; i < methodHashesSize; i++) {
+        NameHash name;
+        name._hashValue = p.getU8();
+        auto hash = p.getU4();
+        auto fnd = currentHashes.methodHashes.find(name);
+        if ((fnd == currentHashes.methodHashes.end() ? 0 : fnd->second) != hash) {
+            return nullopt;
+        }
+    }
+
+    vector<FileRef> files;
+    int filesSize = p.getU4();
+    files.reserve(filesSize);
+    for (int i = 0; i < filesSize; i++) {
+        auto file = gs.findFileByPath(p.getStr());
+        auto hash = p.getStr();
+        if (!file.exists()) {
+            return nullopt;
+        }
+        if (hash != file.data(gs).contentHash()) {
+            return nullopt;
+        }
+        files.emplace_back(file);
+    }
+
+    auto unpickleLoc = [&]() -> Loc {
+        auto index = p.getU4();
+        auto begin = p.getU4();
+        auto end = p.getU4();
+        if (index == RELATIVE_FILE_INDEX) {
+            ENFORCE(relativeTo.exists());
+            return Loc{relativeTo, begin + base, end + base};
+        }
+        return Loc{index == 0 ? FileRef() : files[index - 1], begin, end};
+    };
+    vector<unique_ptr<Error>> result;
+    int errorsSize = p.getU4();
+    result.reserve(errorsSize);
+    for (int i = 0; i < errorsSize; i++) {
+        auto loc = unpickleLoc();
+        u2 code = p.getU4();
+        auto minLevel = (StrictLevel)p.getU1();
+        string header(p.getStr());
+        vector<ErrorSection> sections;
+        int sectionsSize = p.getU4();
+        for (int j = 0; j < sectionsSize; j++) {
+            string sectionHeader(p.getStr());
+            vector<ErrorLine> messages;
+            int messagesSize = p.getU4();
+            for (int k = 0; k < messagesSize; k++) {
+                auto lineLoc = unpickleLoc();
+                messages.emplace_back(lineLoc, string(p.getStr()));
+            }
+            sections.emplace_back(sectionHeader, messages);
+        }
+        vector<AutocorrectSuggestion> autocorrects;
+        int autocorrectsSize = p.getU4();
+        for (int j = 0; j < autocorrectsSize; j++) {
+            string title(p.getStr());
+            vector<AutocorrectSuggestion::Edit> edits;
+            int editsSize = p.getU4();
+            for (int k = 0; k < editsSize; k++) {
+                auto editLoc = unpickleLoc();
+                edits.emplace_back(AutocorrectSuggestion::Edit{editLoc, string(p.getStr())});
+            }
+            autocorrects.emplace_back(move(title), move(edits));
+        }
+        result.emplace_back(make_unique<Error>(loc, ErrorClass{code, minLevel}, move(header), move(sections),
+                                               move(autocorrects), false));
+    }
+    return result;
+}
+
+vector<u1> Serializer::storeFileHash(const FileHash &hash) {
+    Pickler p;
+    auto pickleHashes = [&](const UnorderedMap<NameHash, u4> &hashes) {
+        vector<pair<NameHash, u4>> sorted(hashes.begin(), hashes.end());
+        fast_sort(sorted, [](const auto &lhs, const auto &rhs) -> bool { return lhs.first < rhs.first; });
+        p.putU4(sorted.size());
+        for (const auto &[name, value] : sorted) {
+            p.putU8(name._hashValue);
+            p.putU4(value);
+        }
+    };
+    auto pickleNames = [&](const vector<NameHash> &names) {
+        p.putU4(names.size());
+        for (const auto &name : names) {
+            p.putU8(name._hashValue);
+        }
+    };
+    p.putU4(hash.definitions.hierarchyHash);
+    pickleHashes(hash.definitions.methodHashes);
+    p.putU4(hash.definitions.classHierarchyHash);
+    pickleHashes(hash.definitions.methodShapeHashes);
+    pickleNames(hash.usages.sends);
+    pickleNames(hash.usages.constants);
+    // Hashes don't compress, and this way they're read straight out of the KeyValueStore's memory map.
+    return p.result(Pickler::NO_COMPRESSION);
+}
+
+FileHash Serializer::loadFileHash(const u1 *const data, spdlog::logger &tracer) {
+    UnPickler p(data, tracer);
+    auto unpickleHashes = [&](UnorderedMap<NameHash, u4> &hashes) {
+        int size = p.getU4();
+        hashes.reserve(size);
+        for (int i = 0; i < size; i++) {
+            NameHash name;
+            name._hashValue = p.getU8();
+            hashes[name] = p.getU4();
+        }
+    };
+    auto unpickleNames = [&](vector<NameHash> &names) {
+        int size = p.getU4();
+        names.reserve(size);
+        for (int i = 0; i < size; i++) {
+            auto &name = names.emplace_back();
+            name._hashValue = p.getU8();
+        }
+    };
+    FileHash result;
+    result.definitions.hierarchyHash = p.getU4();
+    unpickleHashes(result.definitions.methodHashes);
+    result.definitions.classHierarchyHash = p.getU4();
+    unpickleHashes(result.definitions.methodShapeHashes);
+    unpickleNames(result.usages.sends);
+    unpickleNames(result.usages.constants);
+    return result;
+}
+
 NameRef SerializerImpl::unpickleNameRef(UnPickler &p, GlobalState &gs) {
     NameRef name(NameRef::WellKnown{}, p.getU4());
-    ENFORCE(name.data(gs)->ref(gs) == name);
+    // Other threads may be entering names into `gs` while trees are loaded from the cache, see
+    // UnfreezeTablesForIndexing, so this sticks to checking the id is in bounds rather than round-tripping it.
+    ENFORCE(name.id() < gs.namesUsed());
     return name;
 }
 
@@ -1,31 +1,68 @@
 #ifndef SORBET_SERIALIZE_H
 #define SORBET_SERIALIZE_H
 #include "ast/ast.h"
+#include "core/NameHash.h"
 #include "core/core.h"
 
+namespace sorbet {
+class WorkerPool;
+}
+
 namespace sorbet::core::serialize {
 class Serializer {
 public:
-    static const u4 VERSION = 4;
+    static const u4 VERSION = 8;
     static const u1 GLOBAL_STATE_COMPRESSION_DEGREE =
         10; // >20 introduce decompression slowdown, >10 introduces compression slowdown
     static const u1 FILE_COMPRESSION_DEGREE =
         10; // >20 introduce decompression slowdown, >10 introduces compression slowdown
+    // The payload in the KeyValueStore is stored uncompressed: the store hands out pointers into its memory map, so
+    // loading it then doesn't have to decompress and copy the whole thing up front.
+    static const u1 KVSTORE_GLOBAL_STATE_COMPRESSION_DEGREE = 0;
 
-    // Serialize a global state
-    static std::vector<u1> store(GlobalState &gs);
+    // Serialize a global state. Uncompressed, it is larger but can be loaded in place, see `loadGlobalState`. If
+    // `workers` is given, it is pickled and compressed in parallel on it.
+    static std::vector<u1> store(GlobalState &gs, bool compressed = true, WorkerPool *workers = nullptr);
 
     // Stores a GlobalState, but only includes `File`s with Type ==
     // Payload. This can be used in conjunction with `storeExpression` to store
     // a global state containing a name table along side a large number of
-    // individual cached files, which can be loaded independently.
-    static std::vector<u1> storePayloadAndNameTable(GlobalState &gs);
+    // individual cached files, which can be loaded independently. The result
+    // is uncompressed, see KVSTORE_GLOBAL_STATE_COMPRESSION_DEGREE. If `workers` is given, it is pickled in parallel
+    // on it.
+    static std::vector<u1> storePayloadAndNameTable(GlobalState &gs, WorkerPool *workers = nullptr);
     static std::vector<u1> storeExpression(GlobalState &gs, std::unique_ptr<ast::Expression> &e);
 
     // Loads an ast::Expression saved by storeExpression. Optionally overrides
     // the saved file ID to the caller-specified ID.
     static std::unique_ptr<ast::Expression> loadExpression(GlobalState &gs, const u1 *const p, u4 forceId = 0);
-    static void loadGlobalState(GlobalState &gs, const u1 *const data);
+    // If `workers` is given, the payload is decompressed in parallel on it. If `data` outlives `gs` and all its copies,
+    // like a payload embedded in the executable, and is stored uncompressed, names and file contents reference it
+    // instead of being copied, so that every process mapping it shares those pages.
+    static void loadGlobalState(GlobalState &gs, const u1 *const data, WorkerPool *workers = nullptr,
+                                bool dataOutlivesState = false);
+
+    // Stores the errors reported while typechecking a single file, along with the parts of the project's
+    // `GlobalStateHash` they were computed against. Locs are stored by path, together with a hash of the contents of
+    // every file they point into, so the result can be loaded into a later run that numbers files differently.
+    //
+    // If `relativeTo` is given, locs in it are stored as offsets from `base` instead, and its contents aren't hashed.
+    // They must not start before `base`.
+    static std::vector<u1> storeErrors(const GlobalState &gs, const GlobalStateHash &usedHashes,
+                                       const std::vector<const Error *> &errors, FileRef relativeTo = FileRef(),
+                                       u4 base = 0);
+
+    // Loads errors saved by storeErrors. Returns nullopt if `currentHashes` disagrees with what the errors were
+    // computed against, or if any file the errors point into is missing or has changed. Locs that were stored relative
+    // to a file are loaded as offsets from `base` in `relativeTo`.
+    static std::optional<std::vector<std::unique_ptr<Error>>>
+    loadErrors(const GlobalState &gs, const GlobalStateHash &currentHashes, const u1 *const data,
+               FileRef relativeTo = FileRef(), u4 base = 0);
+
+    // Stores the hashes computed for a single file, e.g. by `pipeline::computeFileHash`. They don't refer to anything
+    // in a GlobalState, so they can be loaded into any later run.
+    static std::vector<u1> storeFileHash(const FileHash &hash);
+    static FileHash loadFileHash(const u1 *const data, spdlog::logger &tracer);
 };
 }; // namespace sorbet::core::serialize
 
@@ -1,5 +1,9 @@
 #include "gtest/gtest.h"
 // has to go first as it violates are requirements
+#include "common/concurrency/WorkerPool.h"
+#include "core/Error.h"
+#include "core/GlobalState.h"
+#include "core/Unfreeze.h"
 #include "core/serialize/pickler.h"
 #include "core/serialize/serialize.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
@@ -78,4 +82,174 @@ TEST(SerializeTest, Strings) { // NOLINT
     EXPECT_EQ(u.getStr(), "\0\0\0\t\n\f\rНЯЯЯЯЯ");
 }
 
+TEST(SerializeTest, Uncompressed) { // NOLINT
+    Pickler p;
+    p.putU4(0);
+    p.putU4(0);
+    p.putStr("aaaaa");
+    p.putU1(1);
+    p.putS8(-1);
+    p.putU4(4294967295);
+    auto stored = p.result(Pickler::NO_COMPRESSION);
+    UnPickler u(stored.data(), *logger);
+    EXPECT_EQ(u.getU4(), 0);
+    EXPECT_EQ(u.getU4(), 0);
+    EXPECT_EQ(u.getStr(), "aaaaa");
+    EXPECT_EQ(u.getU1(), 1);
+    EXPECT_EQ(u.getS8(), -1);
+    EXPECT_EQ(u.getU4(), 4294967295);
+}
+
+TEST(SerializeTest, Blocks) { // NOLINT
+    // Large enough to span several compressed blocks.
+    const u4 count = Pickler::BLOCK_SIZE;
+    Pickler p;
+    for (u4 i = 0; i < count; i++) {
+        p.putU4(i);
+    }
+    auto compressed = p.result(Serializer::GLOBAL_STATE_COMPRESSION_DEGREE);
+    auto workers = WorkerPool::create(2, *logger);
+    for (auto *pool : {(WorkerPool *)nullptr, workers.get()}) {
+        UnPickler u(compressed.data(), *logger, pool);
+        for (u4 i = 0; i < count; i++) {
+            ASSERT_EQ(u.getU4(), i);
+        }
+    }
+}
+
+TEST(SerializeTest, FileHash) { // NOLINT
+    auto nameHash = [](u8 value) {
+        NameHash hash;
+        hash._hashValue = value;
+        return hash;
+    };
+    FileHash hash;
+    hash.definitions.hierarchyHash = 42;
+    hash.definitions.methodHashes[nameHash(7)] = 1;
+    hash.definitions.methodHashes[nameHash(4294967295)] = 0;
+    hash.definitions.methodHashes[nameHash(18446744073709551615ULL)] = 3;
+    hash.definitions.classHierarchyHash = 4294967295;
+    hash.definitions.methodShapeHashes[nameHash(3)] = 5;
+    hash.usages.sends = {nameHash(1), nameHash(2)};
+    hash.usages.constants = {nameHash(9)};
+
+    auto stored = Serializer::storeFileHash(hash);
+    auto loaded = Serializer::loadFileHash(stored.data(), *logger);
+    EXPECT_EQ(loaded.definitions.hierarchyHash, hash.definitions.hierarchyHash);
+    EXPECT_EQ(loaded.definitions.methodHashes, hash.definitions.methodHashes);
+    EXPECT_EQ(loaded.definitions.classHierarchyHash, hash.definitions.classHierarchyHash);
+    EXPECT_EQ(loaded.definitions.methodShapeHashes, hash.definitions.methodShapeHashes);
+    EXPECT_EQ(loaded.usages.sends, hash.usages.sends);
+    EXPECT_EQ(loaded.usages.constants, hash.usages.constants);
+}
+
+TEST(SerializeTest, RelativeErrors) { // NOLINT
+    auto errorQueue = make_shared<ErrorQueue>(*logger, *logger);
+    GlobalState gs(errorQueue);
+    gs.initEmpty();
+    FileRef edited;
+    FileRef other;
+    {
+        UnfreezeFileTable fileTableAccess(gs);
+        edited = gs.enterFile("edited.rb", "# typed: true\ndef foo; bar; end\n");
+        other = gs.enterFile("other.rb", "def bar; end\n");
+    }
+    vector<ErrorSection> sections{ErrorSection("", {ErrorLine(Loc(other, 0, 12), "defined here")})};
+    Error error(Loc(edited, 23, 26), ErrorClass{7003, StrictLevel::True}, "header", move(sections), {}, false);
+    GlobalStateHash hashes;
+    auto stored = Serializer::storeErrors(gs, hashes, {&error}, edited, 14);
+
+    // The method moved 10 characters further into the file.
+    auto loaded = Serializer::loadErrors(gs, hashes, stored.data(), edited, 24);
+    ASSERT_TRUE(loaded.has_value());
+    ASSERT_EQ(loaded->size(), 1);
+    EXPECT_EQ((*loaded)[0]->loc, Loc(edited, 33, 36));
+    EXPECT_EQ((*loaded)[0]->sections[0].messages[0].loc, Loc(other, 0, 12));
+}
+
+TEST(SerializeTest, BorrowedGlobalState) { // NOLINT
+    auto errorQueue = make_shared<ErrorQueue>(*logger, *logger);
+    GlobalState gs(errorQueue);
+    gs.initEmpty();
+    {
+        UnfreezeFileTable fileTableAccess(gs);
+        UnfreezeNameTable nameTableAccess(gs);
+        gs.enterFile("payload.rbi", "class Borrowed; end\n");
+        gs.enterNameUTF8("some_borrowed_name");
+    }
+    gs.markAsPayload();
+    auto stored = Serializer::store(gs, false);
+    auto within = [](const vector<u1> &data, string_view str) {
+        const auto *begin = (const char *)data.data();
+        return str.data() >= begin && str.data() + str.size() <= begin + data.size();
+    };
+
+    for (bool dataOutlivesState : {false, true}) {
+        GlobalState loaded(errorQueue);
+        Serializer::loadGlobalState(loaded, stored.data(), nullptr, dataOutlivesState);
+        auto file = loaded.findFileByPath("payload.rbi");
+        ASSERT_TRUE(file.exists());
+        EXPECT_EQ(file.data(loaded).source(), "class Borrowed; end\n");
+        {
+            UnfreezeNameTable nameTableAccess(loaded);
+            auto namesUsed = loaded.namesUsed();
+            auto name = loaded.enterNameUTF8("some_borrowed_name");
+            EXPECT_EQ(loaded.namesUsed(), namesUsed);
+            EXPECT_EQ(within(stored, name.data(loaded)->raw.utf8), dataOutlivesState);
+        }
+
+        // Copies share the contents, which are decompressed only once.
+        auto copy = loaded.deepCopy();
+        EXPECT_EQ(copy->findFileByPath("payload.rbi").data(*copy).source().data(), file.data(loaded).source().data());
+    }
+
+    // Compressed data is decompressed into a copy that doesn't outlive the load, so nothing is borrowed from it.
+    auto compressed = Serializer::store(gs);
+    GlobalState loaded(errorQueue);
+    Serializer::loadGlobalState(loaded, compressed.data(), nullptr, true);
+    EXPECT_EQ(loaded.findFileByPath("payload.rbi").data(loaded).source(), "class Borrowed; end\n");
+    auto namesUsed = loaded.namesUsed();
+    UnfreezeNameTable nameTableAccess(loaded);
+    EXPECT_FALSE(within(compressed, loaded.enterNameUTF8("some_borrowed_name").data(loaded)->raw.utf8));
+    EXPECT_EQ(loaded.namesUsed(), namesUsed);
+}
+
+TEST(SerializeTest, Append) { // NOLINT
+    Pickler first;
+    first.putU4(0);
+    first.putU4(0);
+    Pickler second;
+    second.putU4(0);
+    second.putStr("a");
+    second.putU4(0);
+    first.append(move(second));
+    first.putU4(0);
+    first.putU4(7);
+    UnPickler u(first.result(Serializer::GLOBAL_STATE_COMPRESSION_DEGREE).data(), *logger);
+    EXPECT_EQ(u.getU4(), 0);
+    EXPECT_EQ(u.getU4(), 0);
+    EXPECT_EQ(u.getU4(), 0);
+    EXPECT_EQ(u.getStr(), "a");
+    EXPECT_EQ(u.getU4(), 0);
+    EXPECT_EQ(u.getU4(), 0);
+    EXPECT_EQ(u.getU4(), 7);
+}
+
+TEST(SerializeTest, ParallelStore) { // NOLINT
+    auto errorQueue = make_shared<ErrorQueue>(*logger, *logger);
+    GlobalState gs(errorQueue);
+    gs.initEmpty();
+    {
+        UnfreezeFileTable fileTableAccess(gs);
+        for (int i = 0; i < 200; i++) {
+            gs.enterFile(fmt::format("file{}.rb", i), fmt::format("class C{}; end\n", i));
+        }
+    }
+    auto workers = WorkerPool::create(2, *logger);
+    for (bool compressed : {false, true}) {
+        EXPECT_EQ(Serializer::store(gs, compressed, workers.get()), Serializer::store(gs, compressed));
+    }
+    EXPECT_EQ(Serializer::storePayloadAndNameTable(gs, workers.get()), Serializer::storePayloadAndNameTable(gs));
+}
+
 } // namespace sorbet::core::serialize
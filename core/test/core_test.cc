@@ -7,6 +7,7 @@
 #include "core/errors/internal.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/spdlog.h"
+#include <thread>
 
 namespace spd = spdlog;
 using namespace std;
@@ -62,6 +63,35 @@ TEST(ASTTest, Errors) { // NOLINT
     ASSERT_EQ(1, errors.size());
 }
 
+TEST(ASTTest, DeferredErrorParts) { // NOLINT
+    GlobalState gs(errorQueue);
+    gs.initEmpty();
+    UnfreezeFileTable fileTableAccess(gs);
+    FileRef f = gs.enterFile(string("a/foo.rb"), string("def foo\n  hi\nend\n"));
+    int renders = 0;
+    unique_ptr<Error> dropped;
+    if (auto e = gs.beginError(Loc{f, 0, 3}, errors::Internal::InternalError)) {
+        e.addDeferred([&renders](const GlobalState &gs, ErrorBuilder &e) { renders++; });
+        dropped = e.build();
+    }
+    dropped = nullptr;
+    EXPECT_EQ(0, renders);
+
+    if (auto e = gs.beginError(Loc{f, 0, 3}, errors::Internal::InternalError)) {
+        e.addErrorSection(ErrorSection("added directly"));
+        e.addDeferred([&renders](const GlobalState &gs, ErrorBuilder &e) {
+            renders++;
+            e.setHeader("Rendered `{}`", "late");
+        });
+    }
+    EXPECT_EQ(1, renders);
+    auto errors = errorQueue->drainAllErrors();
+    ASSERT_EQ(1, errors.size());
+    EXPECT_EQ("Rendered `late`", errors[0]->header);
+    ASSERT_EQ(1, errors[0]->sections.size());
+    EXPECT_EQ("added directly", errors[0]->sections[0].header);
+}
+
 TEST(ASTTest, SymbolRef) { // NOLINT
     GlobalState gs(errorQueue);
     gs.initEmpty();
@@ -69,6 +99,177 @@ TEST(ASTTest, SymbolRef) { // NOLINT
     EXPECT_EQ(ref, ref.data(gs)->ref(gs));
 }
 
+TEST(ASTTest, DeepCopyKeepingIdSharesUntilWritten) { // NOLINT
+    GlobalState gs(errorQueue);
+    gs.initEmpty();
+    auto copy = gs.deepCopy(true);
+    const GlobalState &constGs = gs;
+    const GlobalState &constCopy = *copy;
+    SymbolRef ref = Symbols::Object();
+    auto address = [&](const GlobalState &from) -> const Symbol * { return ref.data(from).operator->(); };
+    EXPECT_EQ(address(constGs), address(constCopy));
+
+    SymbolRef entered;
+    NameRef name;
+    {
+        UnfreezeNameTable nameTableAccess(*copy);
+        UnfreezeSymbolTable symbolTableAccess(*copy);
+        name = copy->enterNameUTF8("copyOnly");
+        entered = copy->enterMethodSymbol(Loc::none(), ref, name);
+    }
+    EXPECT_NE(address(constGs), address(constCopy));
+    EXPECT_EQ(entered, ref.data(constCopy)->findMember(constCopy, name));
+    EXPECT_EQ(entered, entered.data(constCopy)->ref(constCopy));
+    EXPECT_FALSE(ref.data(constGs)->findMember(constGs, name).exists());
+    EXPECT_EQ(gs.symbolsUsed() + 1, copy->symbolsUsed());
+    EXPECT_EQ(ref, ref.data(constGs)->ref(constGs));
+}
+
+TEST(ASTTest, ConcurrentNameEntry) { // NOLINT
+    GlobalState gs(errorQueue);
+    gs.initEmpty();
+    NameRef existing;
+    {
+        UnfreezeNameTable nameTableAccess(gs);
+        existing = gs.enterNameUTF8("foo");
+    }
+    constexpr int threadCount = 4;
+    constexpr int nameCount = 5000;
+    vector<vector<NameRef>> entered(threadCount);
+    {
+        UnfreezeTablesForIndexing indexing(gs);
+        vector<thread> threads;
+        for (int t = 0; t < threadCount; t++) {
+            threads.emplace_back([&gs, &existing, &entered, t]() {
+                for (int i = 0; i < nameCount; i++) {
+                    EXPECT_EQ(existing, gs.enterNameUTF8("foo"));
+                    auto name = gs.enterNameConstant(gs.enterNameUTF8(to_string((i * (t + 1)) % nameCount)));
+                    EXPECT_EQ(name.data(gs)->kind, CONSTANT);
+                    entered[t].emplace_back(name);
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+    for (int t = 1; t < threadCount; t++) {
+        for (int i = 0; i < nameCount; i++) {
+            EXPECT_EQ(entered[0][(i * (t + 1)) % nameCount], entered[t][i]);
+        }
+    }
+    EXPECT_EQ("<C <U 42>>", entered[0][42].showRaw(gs));
+}
+
+TEST(ASTTest, MemberTable) { // NOLINT
+    GlobalState gs(errorQueue);
+    gs.initEmpty();
+    vector<NameRef> names;
+    {
+        UnfreezeNameTable nameTableAccess(gs);
+        for (int i = 0; i < 20; i++) {
+            names.emplace_back(gs.enterNameUTF8("member" + to_string(i)));
+        }
+    }
+    auto symbolFor = [](int i) { return SymbolRef(nullptr, 1000 + i); };
+
+    MemberTable members;
+    for (int i = 0; i < names.size(); i++) {
+        members[names[i]] = symbolFor(i);
+        EXPECT_EQ(i + 1, members.size());
+        for (int j = 0; j <= i; j++) {
+            EXPECT_EQ(symbolFor(j), members.find(names[j]));
+        }
+        if (i + 1 < names.size()) {
+            EXPECT_FALSE(members.find(names[i + 1]).exists());
+        }
+        if (i == 4) {
+            // Copies taken before and after the table outgrows its small representation both stand alone.
+            auto copy = members;
+            copy.erase(names[2]);
+            EXPECT_FALSE(copy.contains(names[2]));
+            EXPECT_EQ(symbolFor(4), copy.find(names[4]));
+            EXPECT_EQ(4, copy.size());
+        }
+    }
+    auto copy = members;
+    copy.erase(names[2]);
+    EXPECT_FALSE(copy.contains(names[2]));
+    EXPECT_EQ(symbolFor(2), members.at(names[2]));
+
+    UnorderedMap<NameRef, SymbolRef> seen;
+    for (auto [name, sym] : members) {
+        EXPECT_TRUE(seen.emplace(name, sym).second);
+    }
+    EXPECT_EQ(names.size(), seen.size());
+    for (int i = 0; i < names.size(); i++) {
+        EXPECT_EQ(symbolFor(i), seen[names[i]]);
+    }
+}
+
+TEST(ASTTest, AncestorCache) { // NOLINT
+    GlobalState gs(errorQueue);
+    gs.initEmpty();
+    SymbolRef base, mod, child, unlinearized, modFoo, baseFoo, baseBar;
+    NameRef foo, bar, baz;
+    {
+        UnfreezeNameTable nameTableAccess(gs);
+        UnfreezeSymbolTable symbolTableAccess(gs);
+        foo = gs.enterNameUTF8("foo");
+        bar = gs.enterNameUTF8("bar");
+        baz = gs.enterNameUTF8("baz");
+        auto enterClass = [&](string_view name, SymbolRef superClass) {
+            auto sym = gs.enterClassSymbol(Loc::none(), Symbols::root(), gs.enterNameConstant(name));
+            sym.data(gs)->setSuperClass(superClass);
+            return sym;
+        };
+        base = enterClass("Base", Symbols::noSymbol());
+        mod = enterClass("Mod", Symbols::noSymbol());
+        mod.data(gs)->setIsModule(true);
+        child = enterClass("Child", base);
+        child.data(gs)->mixins().emplace_back(mod);
+        unlinearized = enterClass("Unlinearized", child);
+        for (auto sym : {base, mod, child}) {
+            sym.data(gs)->setClassLinearizationComputed();
+        }
+        modFoo = gs.enterMethodSymbol(Loc::none(), mod, foo);
+        baseFoo = gs.enterMethodSymbol(Loc::none(), base, foo);
+        baseBar = gs.enterMethodSymbol(Loc::none(), base, bar);
+    }
+
+    auto check = [&]() {
+        EXPECT_TRUE(child.derivesFrom(gs, base));
+        EXPECT_TRUE(child.derivesFrom(gs, mod));
+        EXPECT_TRUE(unlinearized.derivesFrom(gs, mod));
+        EXPECT_FALSE(child.derivesFrom(gs, child));
+        EXPECT_FALSE(base.derivesFrom(gs, child));
+        EXPECT_FALSE(mod.derivesFrom(gs, base));
+        EXPECT_EQ(modFoo, child.data(gs)->findMemberTransitive(gs, foo));
+        EXPECT_EQ(baseBar, child.data(gs)->findMemberTransitive(gs, bar));
+        EXPECT_EQ(modFoo, unlinearized.data(gs)->findMemberTransitive(gs, foo));
+        EXPECT_EQ(baseFoo, base.data(gs)->findMemberTransitive(gs, foo));
+        EXPECT_FALSE(mod.data(gs)->findMemberTransitive(gs, bar).exists());
+    };
+    check();
+    gs.computeAncestorCache();
+    check();
+
+    // The cache only holds ancestors, so members entered afterwards are still found, even if looking them up failed
+    // (and was memoized) before.
+    EXPECT_FALSE(child.data(gs)->findMemberTransitive(gs, baz).exists());
+    SymbolRef baseBaz;
+    {
+        UnfreezeSymbolTable symbolTableAccess(gs);
+        baseBaz = gs.enterMethodSymbol(Loc::none(), base, baz);
+    }
+    EXPECT_EQ(baseBaz, child.data(gs)->findMemberTransitive(gs, baz));
+    auto copy = gs.deepCopy(true);
+    EXPECT_TRUE(child.derivesFrom(*copy, mod));
+    EXPECT_EQ(baseBaz, child.data(*copy)->findMemberTransitive(*copy, baz));
+    gs.clearAncestorCache();
+    check();
+}
+
 struct FileIsTypedCase {
     string_view src;
     StrictLevel strict;
@@ -99,6 +300,56 @@ TEST(CoreTest, FileIsTyped) { // NOLINT
     }
 }
 
+TEST(CoreTest, LineBreaks) { // NOLINT
+    // Long enough lines and files that newlines land on either side of any block a vectorized search looks at.
+    for (int lineLength : {0, 1, 15, 16, 17, 31, 32, 33, 100}) {
+        for (bool trailingNewline : {false, true}) {
+            string source;
+            vector<int> expected = {-1};
+            for (int line = 0; line < 10; line++) {
+                if (line > 0) {
+                    expected.emplace_back(source.size());
+                    source += '\n';
+                }
+                source += string(lineLength, 'a');
+            }
+            if (trailingNewline) {
+                expected.emplace_back(source.size());
+                source += '\n';
+            }
+            expected.emplace_back(source.size());
+
+            File file("test.rb", move(source), File::Normal);
+            EXPECT_EQ(expected, file.lineBreaks()) << lineLength << " " << trailingNewline;
+        }
+    }
+    File empty("empty.rb", "", File::Normal);
+    EXPECT_EQ(vector<int>({-1, 0}), empty.lineBreaks());
+}
+
+TEST(CoreTest, EditLineBreaks) { // NOLINT
+    struct Case {
+        int begin;
+        int end;
+        string text;
+    };
+    const string original = "a\nbb\n\nccc\n";
+    vector<Case> cases = {
+        {0, 0, ""},  {0, 0, "x"},        {0, 0, "\n"},      {1, 2, ""},        {1, 2, "\n\n"},
+        {0, 10, ""}, {0, 10, "\nz"},      {3, 7, "q"},       {10, 10, "end\n"}, {5, 6, "\n"},
+        {4, 9, ""},  {2, 5, "\nyy\nzz"},   {9, 10, "w"},
+    };
+    for (auto &tc : cases) {
+        string source = original;
+        auto lineBreaks = File::findLineBreaks(source);
+        File::edit(source, lineBreaks, tc.begin, tc.end, tc.text);
+        auto expected = original;
+        expected.replace(tc.begin, tc.end - tc.begin, tc.text);
+        EXPECT_EQ(expected, source);
+        EXPECT_EQ(File::findLineBreaks(expected), lineBreaks) << tc.begin << " " << tc.end << " " << tc.text;
+    }
+}
+
 TEST(CoreTest, Substitute) { // NOLINT
     GlobalState gs1(errorQueue);
     gs1.initEmpty();
@@ -132,6 +383,45 @@ TEST(CoreTest, Substitute) { // NOLINT
     ASSERT_EQ("<U other>", other2.showRaw(gs2));
 }
 
+TEST(CoreTest, InternedClassType) { // NOLINT
+    EXPECT_EQ(Types::Integer(), make_type<ClassType>(Symbols::Integer()));
+    EXPECT_NE(Types::Integer(), make_type<ClassType>(Symbols::String()));
+
+    constexpr int threadCount = 4;
+    SymbolRef sym(nullptr, 123456);
+    vector<TypePtr> interned(threadCount);
+    vector<thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&interned, sym, t]() { interned[t] = make_type<ClassType>(sym); });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (auto &type : interned) {
+        EXPECT_EQ(interned[0], type);
+    }
+    EXPECT_EQ(sym, cast_type<ClassType>(interned[0].get())->symbol);
+}
+
+TEST(CoreTest, TypeMemo) { // NOLINT
+    GlobalState gs(errorQueue);
+    gs.initEmpty();
+    gs.computeAncestorCache();
+    Context ctx(gs, Symbols::root());
+
+    auto nilableString = Types::any(ctx, Types::nilClass(), Types::String());
+    EXPECT_EQ(nilableString, Types::any(ctx, Types::nilClass(), Types::String()));
+    for (int i = 0; i < 2; i++) {
+        EXPECT_TRUE(Types::isSubType(ctx, Types::String(), nilableString));
+        EXPECT_FALSE(Types::isSubType(ctx, nilableString, Types::String()));
+        EXPECT_EQ(Types::String(), Types::all(ctx, nilableString, Types::String()));
+    }
+
+    gs.clearAncestorCache();
+    EXPECT_FALSE(Types::isSubType(ctx, nilableString, Types::String()));
+    EXPECT_TRUE(Types::isSubType(ctx, nilableString, Types::any(ctx, Types::String(), Types::nilClass())));
+}
+
 TEST(CoreTest, LocTest) { // NOLINT
     constexpr auto maxFileId = 0xffff - 1;
     constexpr auto maxOffset = 0xffffff - 1;
@@ -160,4 +450,59 @@ TEST(CoreTest, LocTest) { // NOLINT
     }
 }
 
+TEST(CoreTest, Origins) { // NOLINT
+    Loc a(FileRef(1), 0, 1);
+    Loc b(FileRef(1), 2, 3);
+    Loc c(FileRef(1), 4, 5);
+    Origins origins{a};
+    origins.emplace_back(b);
+    Origins copy = origins;
+    EXPECT_EQ(origins.begin(), copy.begin());
+
+    // Appending to a shared list leaves the other copies alone.
+    copy.emplace_back(c);
+    EXPECT_EQ(2, origins.size());
+    EXPECT_EQ(3, copy.size());
+    EXPECT_EQ(c, copy[2]);
+
+    origins.addAll(copy);
+    EXPECT_EQ((vector<Loc>{a, b, c}), vector<Loc>(origins.begin(), origins.end()));
+    Origins moved = move(origins);
+    EXPECT_TRUE(origins.empty());
+    EXPECT_EQ(3, moved.size());
+}
+
+TEST(CoreTest, MemoryUsage) { // NOLINT
+    GlobalState gs(errorQueue);
+    gs.initEmpty();
+    auto before = gs.memoryUsage();
+    EXPECT_GT(before.names, 0);
+    EXPECT_GT(before.strings, 0);
+    EXPECT_GT(before.symbols, 0);
+    EXPECT_GT(before.types, 0);
+    EXPECT_EQ(before.total(),
+              before.names + before.strings + before.symbols + before.files + before.types + before.trees);
+
+    string source(100'000, ' ');
+    {
+        UnfreezeFileTable fileTableAccess(gs);
+        gs.enterFile(string("a/big.rb"), source);
+    }
+    EXPECT_GE(gs.memoryUsage().files, before.files + source.size());
+}
+
+TEST(CoreTest, ReserveTables) { // NOLINT
+    GlobalState gs(errorQueue);
+    gs.initEmpty();
+    auto wantNames = gs.namesUsed() * 4;
+    gs.reserveTables(wantNames, gs.symbolsUsed() * 4, 100);
+    auto reserved = gs.memoryUsage().names;
+
+    UnfreezeNameTable nameTableAccess(gs);
+    for (int i = 0; gs.namesUsed() < wantNames; i++) {
+        gs.enterNameUTF8(fmt::format("reserved_{}", i));
+    }
+    EXPECT_EQ(reserved, gs.memoryUsage().names);
+}
+
 } // namespace sorbet::core
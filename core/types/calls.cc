@@ -25,13 +25,64 @@ TypePtr ProxyType::getCallArguments(Context ctx, NameRef name) {
     return underlying()->getCallArguments(ctx, name);
 }
 
+namespace {
+// Whether dispatching to `t1` and `t2` gives the same result.
+bool isSameDispatchReceiver(const TypePtr &t1, const TypePtr &t2) {
+    if (t1.get() == t2.get()) {
+        return true;
+    }
+    auto *c1 = cast_type<ClassType>(t1.get());
+    auto *c2 = cast_type<ClassType>(t2.get());
+    // BlamedUntyped and UnresolvedClassType are ClassTypes of `untyped`, which differ in what they carry.
+    return c1 != nullptr && c2 != nullptr && c1->symbol == c2->symbol && c1->symbol != Symbols::untyped();
+}
+} // namespace
+
 DispatchResult OrType::dispatchCall(Context ctx, DispatchArgs args) {
     categoryCounterInc("dispatch_call", "ortype");
-    auto leftRet = left->dispatchCall(ctx, args.withSelfRef(left));
-    auto rightRet = right->dispatchCall(ctx, args.withSelfRef(right));
-    DispatchResult ret{Types::any(ctx, leftRet.returnType, rightRet.returnType), move(leftRet.main),
-                       make_unique<DispatchResult>(move(rightRet)), DispatchResult::Combinator::OR};
-    return ret;
+    // Unions of many components are nested to the right, so this walks that spine instead of recursing down it. The
+    // result is what recursing would give: the main component of every left child's result, then the whole result of
+    // the last right child, with return types combined from the right. A left child that is the same receiver as an
+    // earlier one is not dispatched to again and only contributes its return type.
+    InlinedVector<const OrType *, 4> spine;
+    spine.emplace_back(this);
+    while (auto *next = cast_type<OrType>(spine.back()->right.get())) {
+        spine.emplace_back(next);
+    }
+
+    // Left to right, like recursing, since some errors are reported as soon as dispatch finds them.
+    vector<DispatchResult> leftRets;
+    leftRets.reserve(spine.size());
+    // For every left child that was already dispatched to, the index of the first one, and -1 otherwise.
+    InlinedVector<int, 4> duplicateOf;
+    for (int i = 0; i < spine.size(); i++) {
+        auto &component = spine[i]->left;
+        auto earlier = absl::c_find_if(spine, [&](const OrType *node) {
+            return node == spine[i] || isSameDispatchReceiver(node->left, component);
+        });
+        if (*earlier != spine[i]) {
+            counterInc("dispatch_call.ortype.duplicate");
+            duplicateOf.emplace_back(earlier - spine.begin());
+            leftRets.emplace_back();
+            continue;
+        }
+        duplicateOf.emplace_back(-1);
+        leftRets.emplace_back(component->dispatchCall(ctx, args.withSelfRef(component)));
+    }
+    auto &last = spine.back()->right;
+    auto result = last->dispatchCall(ctx, args.withSelfRef(last));
+
+    for (int i = spine.size() - 1; i >= 0; i--) {
+        if (duplicateOf[i] >= 0) {
+            result.returnType = Types::any(ctx, leftRets[duplicateOf[i]].returnType, result.returnType);
+            continue;
+        }
+        auto &leftRet = leftRets[i];
+        auto returnType = Types::any(ctx, leftRet.returnType, result.returnType);
+        result = DispatchResult{move(returnType), move(leftRet.main), make_unique<DispatchResult>(move(result)),
+                                DispatchResult::Combinator::OR};
+    }
+    return result;
 }
 
 TypePtr OrType::getCallArguments(Context ctx, NameRef name) {
@@ -196,9 +247,8 @@ int getArity(Context ctx, SymbolRef method) {
 
 // Guess overload. The way we guess is only arity based - we will return the overload that has the smallest number of
 // arguments that is >= args.size()
-SymbolRef guessOverload(Context ctx, SymbolRef inClass, SymbolRef primary,
-                        InlinedVector<const TypeAndOrigins *, 2> &args, const TypePtr &fullType, vector<TypePtr> &targs,
-                        bool hasBlock) {
+SymbolRef guessOverload(Context ctx, SymbolRef inClass, SymbolRef primary, DispatchArgList &args,
+                        const TypePtr &fullType, vector<TypePtr> &targs, bool hasBlock) {
     counterInc("calls.overloaded_invocations");
     ENFORCE(ctx.permitOverloadDefinitions(primary.data(ctx)->loc().file()), "overload not permitted here");
     SymbolRef fallback = primary;
@@ -463,12 +513,20 @@ DispatchResult dispatchCallSymbol(Context ctx, DispatchArgs args,
         }
         auto result = DispatchResult(Types::untypedUntracked(), std::move(args.selfType), Symbols::noSymbol());
         if (auto e = ctx.state.beginError(args.locs.call, errors::Infer::UnknownMethod)) {
-            string thisStr = thisType->show(ctx);
-            if (args.fullType.get() != thisType) {
-                e.setHeader("Method `{}` does not exist on `{}` component of `{}`", args.name.data(ctx)->show(ctx),
-                            thisType->show(ctx), args.fullType->show(ctx));
+            // Most of this error is rendered only once it's reported: AndType::dispatchCall drops it if another
+            // component has the method. `thisType` may not outlive this call, unlike `args.fullType`.
+            auto name = args.name;
+            auto fullType = args.fullType;
+            bool isComponent = fullType.get() != thisType;
+            if (isComponent) {
+                e.addDeferred([name, fullType, thisStr = thisType->show(ctx)](const GlobalState &gs, ErrorBuilder &e) {
+                    e.setHeader("Method `{}` does not exist on `{}` component of `{}`", name.data(gs)->show(gs),
+                                thisStr, fullType->show(gs));
+                });
             } else {
-                e.setHeader("Method `{}` does not exist on `{}`", args.name.data(ctx)->show(ctx), thisStr);
+                e.addDeferred([name, fullType](const GlobalState &gs, ErrorBuilder &e) {
+                    e.setHeader("Method `{}` does not exist on `{}`", name.data(gs)->show(gs), fullType->show(gs));
+                });
 
                 // catch the special case of `interface!`, `abstract!`, `final!`, or `sealed!` and
                 // suggest adding `extend T::Helpers`.
@@ -479,42 +537,45 @@ DispatchResult dispatchCallSymbol(Context ctx, DispatchArgs args,
                     }
                 }
             }
-            if (args.fullType.get() != thisType && symbol == Symbols::NilClass()) {
+            if (isComponent && symbol == Symbols::NilClass()) {
                 e.replaceWith("Add `T.must`", args.locs.receiver, "T.must({})", args.locs.receiver.source(ctx));
             } else {
-                if (symbol.data(ctx)->isClassModule()) {
-                    auto objMeth = core::Symbols::Object().data(ctx)->findMemberTransitive(ctx, args.name);
-                    if (objMeth.exists() && objMeth.data(ctx)->owner.data(ctx)->isClassModule()) {
-                        e.addErrorSection(
-                            ErrorSection(ErrorColors::format("Did you mean to `include {}` in this module?",
-                                                             objMeth.data(ctx)->owner.data(ctx)->name.show(ctx))));
+                e.addDeferred([name, symbol](const GlobalState &gs, ErrorBuilder &e) {
+                    if (symbol.data(gs)->isClassModule()) {
+                        auto objMeth = core::Symbols::Object().data(gs)->findMemberTransitive(gs, name);
+                        if (objMeth.exists() && objMeth.data(gs)->owner.data(gs)->isClassModule()) {
+                            e.addErrorSection(
+                                ErrorSection(ErrorColors::format("Did you mean to `include {}` in this module?",
+                                                                 objMeth.data(gs)->owner.data(gs)->name.show(gs))));
+                        }
                     }
-                }
-                auto alternatives = symbol.data(ctx)->findMemberFuzzyMatch(ctx, args.name);
-                if (!alternatives.empty()) {
-                    vector<ErrorLine> lines;
-                    lines.reserve(alternatives.size());
-                    for (auto alternative : alternatives) {
-                        auto possible_symbol = alternative.symbol.data(ctx);
-                        if (!possible_symbol->isClass() && !possible_symbol->isMethod()) {
-                            continue;
+                    auto alternatives = symbol.data(gs)->findMemberFuzzyMatch(gs, name);
+                    if (!alternatives.empty()) {
+                        vector<ErrorLine> lines;
+                        lines.reserve(alternatives.size());
+                        for (auto alternative : alternatives) {
+                            auto possible_symbol = alternative.symbol.data(gs);
+                            if (!possible_symbol->isClass() && !possible_symbol->isMethod()) {
+                                continue;
+                            }
+                            auto suggestedName = possible_symbol->isClass() ? alternative.symbol.show(gs) + ".new"
+                                                                            : alternative.symbol.show(gs);
+                            lines.emplace_back(ErrorLine::from(alternative.symbol.data(gs)->loc(),
+                                                               "Did you mean: `{}`?", suggestedName));
                         }
-                        auto suggestedName = possible_symbol->isClass() ? alternative.symbol.show(ctx) + ".new"
-                                                                        : alternative.symbol.show(ctx);
-                        lines.emplace_back(
-                            ErrorLine::from(alternative.symbol.data(ctx)->loc(), "Did you mean: `{}`?", suggestedName));
+                        e.addErrorSection(ErrorSection(lines));
                     }
-                    e.addErrorSection(ErrorSection(lines));
-                }
 
-                auto attached = symbol.data(ctx)->attachedClass(ctx);
-                if (attached.exists() && symbol.data(ctx)->derivesFrom(ctx, Symbols::Chalk_Tools_Accessible())) {
-                    e.addErrorSection(ErrorSection(
-                        "If this method is generated by Chalk::Tools::Accessible, you "
-                        "may need to re-generate the .rbi. Try running:\n" +
-                        ErrorColors::format("  scripts/bin/remote-script sorbet/shim_generation/make_accessible.rb {}",
-                                            attached.data(ctx)->showFullName(ctx))));
-                }
+                    auto attached = symbol.data(gs)->attachedClass(gs);
+                    if (attached.exists() && symbol.data(gs)->derivesFrom(gs, Symbols::Chalk_Tools_Accessible())) {
+                        e.addErrorSection(ErrorSection(
+                            "If this method is generated by Chalk::Tools::Accessible, you "
+                            "may need to re-generate the .rbi. Try running:\n" +
+                            ErrorColors::format(
+                                "  scripts/bin/remote-script sorbet/shim_generation/make_accessible.rb {}",
+                                attached.data(gs)->showFullName(gs))));
+                    }
+                });
             }
             result.main.errors.emplace_back(e.build());
         }
@@ -1166,10 +1227,19 @@ public:
     }
 } T_Generic_squareBrackets;
 
+// Hash and array literals with more entries than this are typed as plain hashes and arrays instead of as shapes and
+// tuples, which most operations on them walk entry by entry: huge ones, like the ones config files are made of, would
+// make inferring their method quadratic.
+constexpr int MAX_LITERAL_SIZE = 256;
+
 class Magic_buildHash : public IntrinsicMethod {
 public:
     void apply(Context ctx, DispatchArgs args, const Type *thisType, DispatchResult &res) const override {
         ENFORCE(args.args.size() % 2 == 0);
+        if (args.args.size() / 2 > MAX_LITERAL_SIZE) {
+            res.returnType = Types::hashOfUntyped();
+            return;
+        }
 
         vector<TypePtr> keys;
         vector<TypePtr> values;
@@ -1209,6 +1279,10 @@ public:
             }
         }
 
+        if (!isType && elems.size() > MAX_LITERAL_SIZE) {
+            res.returnType = Types::arrayOf(ctx, Types::dropLiteral(Types::lubAll(ctx, elems)));
+            return;
+        }
         auto tuple = TupleType::build(ctx, elems);
         if (isType) {
             tuple = make_type<MetaType>(move(tuple));
@@ -1267,8 +1341,8 @@ class Magic_callWithSplat : public IntrinsicMethod {
     friend class Magic_callWithSplatAndBlock;
 
 private:
-    static InlinedVector<const TypeAndOrigins *, 2>
-    generateSendArgs(TupleType *tuple, InlinedVector<TypeAndOrigins, 2> &sendArgStore, Loc argsLoc) {
+    static DispatchArgList generateSendArgs(TupleType *tuple, InlinedVector<TypeAndOrigins, 2> &sendArgStore,
+                                            Loc argsLoc) {
         sendArgStore.reserve(tuple->elems.size());
         for (auto &arg : tuple->elems) {
             TypeAndOrigins tao;
@@ -1276,7 +1350,7 @@ private:
             tao.origins.emplace_back(argsLoc);
             sendArgStore.emplace_back(std::move(tao));
         }
-        InlinedVector<const TypeAndOrigins *, 2> sendArgs;
+        DispatchArgList sendArgs;
         sendArgs.reserve(sendArgStore.size());
         for (auto &arg : sendArgStore) {
             sendArgs.emplace_back(&arg);
@@ -1318,8 +1392,7 @@ public:
         }
 
         InlinedVector<TypeAndOrigins, 2> sendArgStore;
-        InlinedVector<const TypeAndOrigins *, 2> sendArgs =
-            Magic_callWithSplat::generateSendArgs(tuple, sendArgStore, args.locs.args[2]);
+        DispatchArgList sendArgs = Magic_callWithSplat::generateSendArgs(tuple, sendArgStore, args.locs.args[2]);
         InlinedVector<Loc, 2> sendArgLocs(tuple->elems.size(), args.locs.args[2]);
         CallLocs sendLocs{args.locs.call, args.locs.args[0], sendArgLocs};
         DispatchArgs innerArgs{fn, sendLocs, sendArgs, receiver->type, receiver->type, args.block};
@@ -1357,7 +1430,7 @@ private:
         }
 
         NameRef to_proc = core::Names::to_proc();
-        InlinedVector<const TypeAndOrigins *, 2> sendArgs;
+        DispatchArgList sendArgs;
         InlinedVector<Loc, 2> sendArgLocs;
         CallLocs sendLocs{callLoc, receiverLoc, sendArgLocs};
         DispatchArgs innerArgs{to_proc, sendLocs, sendArgs, nonNilBlockType, nonNilBlockType, nullptr};
@@ -1530,7 +1603,7 @@ public:
             sendArgStore.emplace_back(*args.args[i]);
             sendArgLocs.emplace_back(args.locs.args[i]);
         }
-        InlinedVector<const TypeAndOrigins *, 2> sendArgs;
+        DispatchArgList sendArgs;
         sendArgs.reserve(sendArgStore.size());
         for (auto &arg : sendArgStore) {
             sendArgs.emplace_back(&arg);
@@ -1597,8 +1670,7 @@ public:
         }
 
         InlinedVector<TypeAndOrigins, 2> sendArgStore;
-        InlinedVector<const TypeAndOrigins *, 2> sendArgs =
-            Magic_callWithSplat::generateSendArgs(tuple, sendArgStore, args.locs.args[2]);
+        DispatchArgList sendArgs = Magic_callWithSplat::generateSendArgs(tuple, sendArgStore, args.locs.args[2]);
         InlinedVector<Loc, 2> sendArgLocs(tuple->elems.size(), args.locs.args[2]);
         CallLocs sendLocs{args.locs.call, args.locs.args[0], sendArgLocs};
 
@@ -1761,6 +1833,10 @@ public:
                 return;
             }
         }
+        if (elems.size() > MAX_LITERAL_SIZE) {
+            res.returnType = Types::arrayOf(ctx, Types::dropLiteral(Types::lubAll(ctx, elems)));
+            return;
+        }
         res.returnType = TupleType::build(ctx, std::move(elems));
     }
 } Tuple_concat;
@@ -1777,6 +1853,10 @@ public:
         if (rhs == nullptr || args.block != nullptr || args.args.size() > 1) {
             return;
         }
+        if (shape->keys.size() + rhs->keys.size() > MAX_LITERAL_SIZE) {
+            res.returnType = Types::hashOfUntyped();
+            return;
+        }
 
         auto keys = shape->keys;
         auto values = shape->values;
@@ -1927,7 +2007,7 @@ public:
             argLocs,
         };
         TypeAndOrigins myType{args.selfType, {args.locs.receiver}};
-        InlinedVector<const TypeAndOrigins *, 2> innerArgs{&myType};
+        DispatchArgList innerArgs{&myType};
 
         DispatchArgs dispatch{
             core::Names::enumerable_to_h(), locs, innerArgs, hash, hash, nullptr,
@@ -174,105 +174,58 @@ struct OrInfo {
     /// obove cases is present (Integer, for example).
     bool containsOther{false};
 
-    /// True when there are more than one non-NilClass types present in the
-    /// leaves of the OrTYpe.
-    bool containsMultiple{false};
+    /// How many non-NilClass leaves were shown.
+    int shown{0};
 
     bool isBoolean() const {
         return containsTrue && containsFalse && !containsOther;
     }
-
-    void markContainsMultiple() {
-        this->containsMultiple = true;
-    }
-
-    OrInfo() {}
-
-    static OrInfo nilInfo() {
-        OrInfo res;
-        res.containsNil = true;
-        return res;
-    }
-
-    static OrInfo trueInfo() {
-        OrInfo res;
-        res.containsTrue = true;
-        return res;
-    }
-
-    static OrInfo falseInfo() {
-        OrInfo res;
-        res.containsFalse = true;
-        return res;
-    }
-
-    static OrInfo otherInfo() {
-        OrInfo res;
-        res.containsOther = true;
-        return res;
-    }
-
-    static OrInfo merge(const OrInfo &left, const OrInfo &right) {
-        OrInfo res;
-        res.containsNil = left.containsNil || right.containsNil;
-        res.containsFalse = left.containsFalse || right.containsFalse;
-        res.containsTrue = left.containsTrue || right.containsTrue;
-        res.containsOther = left.containsOther || right.containsOther;
-        res.containsMultiple = left.containsMultiple || right.containsMultiple;
-        return res;
-    }
 };
 
-pair<OrInfo, optional<string>> showOrs(const GlobalState &, TypePtr, TypePtr);
-
-pair<OrInfo, optional<string>> showOrElem(const GlobalState &gs, TypePtr ty) {
-    if (auto classType = cast_type<ClassType>(ty.get())) {
-        if (classType->symbol == Symbols::NilClass()) {
-            return make_pair(OrInfo::nilInfo(), nullopt);
-        } else if (classType->symbol == Symbols::TrueClass()) {
-            return make_pair(OrInfo::trueInfo(), make_optional(classType->show(gs)));
-        } else if (classType->symbol == Symbols::FalseClass()) {
-            return make_pair(OrInfo::falseInfo(), make_optional(classType->show(gs)));
-        }
-    } else if (auto orType = cast_type<OrType>(ty.get())) {
-        return showOrs(gs, orType->left, orType->right);
+// Appends the non-NilClass leaves of `ty` to `buf`, separated by commas. Nested OrTypes are flattened into the one
+// buffer, so that showing a long union doesn't copy the leaves shown so far at every level.
+void showOrElems(const GlobalState &gs, const TypePtr &ty, OrInfo &info, fmt::memory_buffer &buf) {
+    if (auto orType = cast_type<OrType>(ty.get())) {
+        showOrElems(gs, orType->left, info, buf);
+        showOrElems(gs, orType->right, info, buf);
+        return;
     }
-
-    return make_pair(OrInfo::otherInfo(), make_optional(ty->show(gs)));
-}
-
-pair<OrInfo, optional<string>> showOrs(const GlobalState &gs, TypePtr left, TypePtr right) {
-    auto [leftInfo, leftStr] = showOrElem(gs, left);
-    auto [rightInfo, rightStr] = showOrElem(gs, right);
-
-    OrInfo merged = OrInfo::merge(leftInfo, rightInfo);
-
-    if (leftStr.has_value() && rightStr.has_value()) {
-        merged.markContainsMultiple();
-        return make_pair(merged, make_optional(fmt::format("{}, {}", *leftStr, *rightStr)));
-    } else if (leftStr.has_value()) {
-        return make_pair(merged, leftStr);
+    auto classType = cast_type<ClassType>(ty.get());
+    if (classType != nullptr && classType->symbol == Symbols::NilClass()) {
+        info.containsNil = true;
+        return;
+    } else if (classType != nullptr && classType->symbol == Symbols::TrueClass()) {
+        info.containsTrue = true;
+    } else if (classType != nullptr && classType->symbol == Symbols::FalseClass()) {
+        info.containsFalse = true;
     } else {
-        return make_pair(merged, rightStr);
+        info.containsOther = true;
+    }
+    if (info.shown++ > 0) {
+        fmt::format_to(buf, ", ");
     }
+    fmt::format_to(buf, "{}", ty->show(gs));
 }
 
 string OrType::show(const GlobalState &gs) const {
-    auto [info, str] = showOrs(gs, this->left, this->right);
+    OrInfo info;
+    fmt::memory_buffer buf;
+    showOrElems(gs, this->left, info, buf);
+    showOrElems(gs, this->right, info, buf);
 
-    // If str is empty at this point, all of the types present in the flattened
+    // If nothing was shown, all of the types present in the flattened
     // OrType are NilClass.
-    if (!str.has_value()) {
+    if (info.shown == 0) {
         return Symbols::NilClass().show(gs);
     }
 
     string res;
     if (info.isBoolean()) {
         res = "T::Boolean";
-    } else if (info.containsMultiple) {
-        res = fmt::format("T.any({})", *str);
+    } else if (info.shown > 1) {
+        res = fmt::format("T.any({})", to_string(buf));
     } else {
-        res = *str;
+        res = to_string(buf);
     }
 
     if (info.containsNil) {
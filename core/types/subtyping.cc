@@ -1,5 +1,6 @@
 #include "common/common.h"
 #include "common/typecase.h"
+#include "core/GlobalState.h"
 #include "core/Symbols.h"
 #include "core/TypeConstraint.h"
 #include "core/Types.h"
@@ -12,7 +13,83 @@ using namespace std;
 
 TypePtr lubGround(Context ctx, const TypePtr &t1, const TypePtr &t2);
 
+namespace {
+StaticCounter lubMemoHits("types.memo.lub.hit");
+StaticCounter lubMemoMisses("types.memo.lub.miss");
+StaticCounter glbMemoHits("types.memo.glb.hit");
+StaticCounter glbMemoMisses("types.memo.glb.miss");
+StaticCounter subtypeMemoHits("types.memo.subtype.hit");
+StaticCounter subtypeMemoMisses("types.memo.subtype.miss");
+
+// Results of `Types::any`, `Types::all` and `Types::isSubType` by pair of arguments. Without a TypeConstraint those
+// only depend on the arguments and the class hierarchy, so they stay valid until GlobalState::hierarchyVersion
+// changes. Entries hold on to their arguments, whose addresses are the keys.
+template <class Result> class TypeMemoTable {
+    static constexpr size_t MAX_SIZE = 1 << 14;
+
+    struct Entry {
+        TypePtr t1;
+        TypePtr t2;
+        Result result;
+    };
+    UnorderedMap<pair<const Type *, const Type *>, Entry> entries;
+
+public:
+    const Result *find(const TypePtr &t1, const TypePtr &t2) const {
+        auto fnd = entries.find(make_pair(t1.get(), t2.get()));
+        return fnd == entries.end() ? nullptr : &fnd->second.result;
+    }
+
+    void insert(const TypePtr &t1, const TypePtr &t2, Result result) {
+        if (entries.size() >= MAX_SIZE) {
+            // Dropping everything keeps this simple; the working set of a method is usually much smaller.
+            entries.clear();
+        }
+        entries.emplace(make_pair(t1.get(), t2.get()), Entry{t1, t2, move(result)});
+    }
+
+    void clear() {
+        entries.clear();
+    }
+};
+
+struct TypeMemo {
+    int globalStateId = 0;
+    shared_ptr<const void> hierarchyVersion;
+    TypeMemoTable<TypePtr> lub;
+    TypeMemoTable<TypePtr> glb;
+    TypeMemoTable<bool> isSubType;
+
+    // Returns this thread's memo tables if `t1` and `t2` are worth memoizing against `gs`, and null otherwise.
+    static TypeMemo *get(const GlobalState &gs, const TypePtr &t1, const TypePtr &t2) {
+        // Pairs of class types are settled by an ancestor lookup, which is as cheap as looking in the table.
+        if (t1.get() == t2.get() || (isa_type<ClassType>(t1.get()) && isa_type<ClassType>(t2.get())) ||
+            gs.hierarchyVersion() == nullptr) {
+            return nullptr;
+        }
+        thread_local TypeMemo memo;
+        if (memo.globalStateId != gs.globalStateId || memo.hierarchyVersion.get() != gs.hierarchyVersion()) {
+            memo.lub.clear();
+            memo.glb.clear();
+            memo.isSubType.clear();
+            memo.globalStateId = gs.globalStateId;
+            memo.hierarchyVersion = gs.pinHierarchyVersion();
+        }
+        return &memo;
+    }
+};
+} // namespace
+
 TypePtr Types::any(Context ctx, const TypePtr &t1, const TypePtr &t2) {
+    auto *memo = TypeMemo::get(ctx, t1, t2);
+    if (memo != nullptr) {
+        if (auto *cached = memo->lub.find(t1, t2)) {
+            lubMemoHits.inc();
+            return *cached;
+        }
+        lubMemoMisses.inc();
+    }
+
     auto ret = lub(ctx, t1, t2);
     ENFORCE(Types::isSubType(ctx, t1, ret), "\n{}\nis not a super type of\n{}\nwas lubbing with {}", ret->toString(ctx),
             t1->toString(ctx), t2->toString(ctx));
@@ -34,6 +111,9 @@ TypePtr Types::any(Context ctx, const TypePtr &t1, const TypePtr &t2) {
 
     ret->sanityCheck(ctx);
 
+    if (memo != nullptr) {
+        memo->lub.insert(t1, t2, ret);
+    }
     return ret;
 }
 
@@ -201,8 +281,8 @@ TypePtr Types::lub(Context ctx, const TypePtr &t1, const TypePtr &t2) {
             return OrType::make_shared(t1, t2);
         }
 
-        bool ltr = a1->klass == a2->klass || a2->klass.data(ctx)->derivesFrom(ctx, a1->klass);
-        bool rtl = !ltr && a1->klass.data(ctx)->derivesFrom(ctx, a2->klass);
+        bool ltr = a1->klass == a2->klass || a2->klass.derivesFrom(ctx, a1->klass);
+        bool rtl = !ltr && a1->klass.derivesFrom(ctx, a2->klass);
         if (!rtl && !ltr) {
             return OrType::make_shared(t1, t2);
         }
@@ -460,10 +540,10 @@ TypePtr lubGround(Context ctx, const TypePtr &t1, const TypePtr &t2) {
 
     SymbolRef sym1 = c1->symbol;
     SymbolRef sym2 = c2->symbol;
-    if (sym1 == sym2 || sym2.data(ctx)->derivesFrom(ctx, sym1)) {
+    if (sym1 == sym2 || sym2.derivesFrom(ctx, sym1)) {
         categoryCounterInc("lub.<class>.collapsed", "yes");
         return t1;
-    } else if (sym1.data(ctx)->derivesFrom(ctx, sym2)) {
+    } else if (sym1.derivesFrom(ctx, sym2)) {
         categoryCounterInc("lub.<class>.collapsed", "yes");
         return t2;
     } else {
@@ -506,10 +586,10 @@ TypePtr glbGround(Context ctx, const TypePtr &t1, const TypePtr &t2) {
 
     SymbolRef sym1 = c1->symbol;
     SymbolRef sym2 = c2->symbol;
-    if (sym1 == sym2 || sym1.data(ctx)->derivesFrom(ctx, sym2)) {
+    if (sym1 == sym2 || sym1.derivesFrom(ctx, sym2)) {
         categoryCounterInc("glb.<class>.collapsed", "yes");
         return t1;
-    } else if (sym2.data(ctx)->derivesFrom(ctx, sym1)) {
+    } else if (sym2.derivesFrom(ctx, sym1)) {
         categoryCounterInc("glb.<class>.collapsed", "yes");
         return t2;
     } else {
@@ -522,6 +602,15 @@ TypePtr glbGround(Context ctx, const TypePtr &t1, const TypePtr &t2) {
     }
 }
 TypePtr Types::all(Context ctx, const TypePtr &t1, const TypePtr &t2) {
+    auto *memo = TypeMemo::get(ctx, t1, t2);
+    if (memo != nullptr) {
+        if (auto *cached = memo->glb.find(t1, t2)) {
+            glbMemoHits.inc();
+            return *cached;
+        }
+        glbMemoMisses.inc();
+    }
+
     auto ret = glb(ctx, t1, t2);
     ret->sanityCheck(ctx);
 
@@ -543,6 +632,9 @@ TypePtr Types::all(Context ctx, const TypePtr &t1, const TypePtr &t2) {
     //            "we do pointer comparisons in order to see if one is subtype of another " + t1->toString(ctx) +
     //                " was glbbing with " + t2->toString(ctx) + " got " + ret->toString(ctx));
 
+    if (memo != nullptr) {
+        memo->glb.insert(t1, t2, ret);
+    }
     return ret;
 }
 
@@ -595,7 +687,7 @@ TypePtr Types::glb(Context ctx, const TypePtr &t1, const TypePtr &t2) {
 
     if (auto *p1 = cast_type<ProxyType>(t1.get())) {
         if (auto *p2 = cast_type<ProxyType>(t2.get())) {
-            if (typeid(*p1) != typeid(*p2)) {
+            if (p1->tag != p2->tag) {
                 return Types::bottom();
             }
             TypePtr result;
@@ -795,7 +887,7 @@ TypePtr Types::glb(Context ctx, const TypePtr &t1, const TypePtr &t2) {
             if (a1->klass.data(ctx)->isClassModule() || c2 == nullptr) {
                 return AndType::make_shared(t1, t2);
             }
-            if (a1->klass.data(ctx)->derivesFrom(ctx, c2->symbol)) {
+            if (a1->klass.derivesFrom(ctx, c2->symbol)) {
                 return t1;
             }
             if (c2->symbol.data(ctx)->isClassModule()) {
@@ -803,8 +895,8 @@ TypePtr Types::glb(Context ctx, const TypePtr &t1, const TypePtr &t2) {
             }
             return Types::bottom();
         }
-        bool rtl = a1->klass == a2->klass || a1->klass.data(ctx)->derivesFrom(ctx, a2->klass);
-        bool ltr = !rtl && a2->klass.data(ctx)->derivesFrom(ctx, a1->klass);
+        bool rtl = a1->klass == a2->klass || a1->klass.derivesFrom(ctx, a2->klass);
+        bool ltr = !rtl && a2->klass.derivesFrom(ctx, a1->klass);
         if (!rtl && !ltr) {
             return AndType::make_shared(t1, t2); // we can as well return nothing here?
         }
@@ -893,7 +985,7 @@ TypePtr Types::glb(Context ctx, const TypePtr &t1, const TypePtr &t2) {
 bool classSymbolIsAsGoodAs(Context ctx, SymbolRef c1, SymbolRef c2) {
     ENFORCE(c1.data(ctx)->isClass());
     ENFORCE(c2.data(ctx)->isClass());
-    return c1 == c2 || c1.data(ctx)->derivesFrom(ctx, c2);
+    return c1 == c2 || c1.derivesFrom(ctx, c2);
 }
 
 void compareToUntyped(Context ctx, TypeConstraint &constr, const TypePtr &ty, const TypePtr &blame) {
@@ -1224,7 +1316,27 @@ bool Types::isSubTypeUnderConstraint(Context ctx, TypeConstraint &constr, const
     return isSubTypeUnderConstraintSingle(ctx, constr, t1, t2); // 1
 }
 
+bool Types::isSubType(Context ctx, const TypePtr &t1, const TypePtr &t2) {
+    auto *memo = TypeMemo::get(ctx, t1, t2);
+    if (memo != nullptr) {
+        if (auto *cached = memo->isSubType.find(t1, t2)) {
+            subtypeMemoHits.inc();
+            return *cached;
+        }
+        subtypeMemoMisses.inc();
+    }
+
+    auto ret = isSubTypeUnderConstraint(ctx, TypeConstraint::EmptyFrozenConstraint, t1, t2);
+    if (memo != nullptr) {
+        memo->isSubType.insert(t1, t2, ret);
+    }
+    return ret;
+}
+
 bool Types::equiv(Context ctx, const TypePtr &t1, const TypePtr &t2) {
+    if (t1 == t2) {
+        return true;
+    }
     return isSubType(ctx, t1, t2) && isSubType(ctx, t2, t1);
 }
 
@@ -1236,7 +1348,7 @@ bool ClassType::derivesFrom(const GlobalState &gs, SymbolRef klass) const {
     if (symbol == Symbols::untyped() || symbol == klass) {
         return true;
     }
-    return symbol.data(gs)->derivesFrom(gs, klass);
+    return symbol.derivesFrom(gs, klass);
 }
 
 bool OrType::derivesFrom(const GlobalState &gs, SymbolRef klass) const {
@@ -1288,7 +1400,7 @@ TypePtr MetaType::_instantiate(Context ctx, const InlinedVector<SymbolRef, 4> &p
     Exception::raise("should never happen");
 }
 
-MetaType::MetaType(const TypePtr &wrapped) : wrapped(move(wrapped)) {
+MetaType::MetaType(const TypePtr &wrapped) : ProxyType(TypeTag::MetaType), wrapped(move(wrapped)) {
     categoryCounterInc("types.allocated", "metattype");
 }
 
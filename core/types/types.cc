@@ -7,6 +7,8 @@
 #include "core/Names.h"
 #include "core/Symbols.h"
 #include "core/TypeConstraint.h"
+#include <array>
+#include <atomic>
 #include <utility>
 
 #include "core/Types.h"
@@ -269,11 +271,51 @@ std::optional<int> Types::getProcArity(const AppliedType &type) {
     return std::nullopt;
 }
 
-ClassType::ClassType(SymbolRef symbol) : symbol(symbol) {
+ClassType::ClassType(SymbolRef symbol) : ClassType(TypeTag::ClassType, symbol) {}
+
+ClassType::ClassType(TypeTag tag, SymbolRef symbol) : GroundType(tag), symbol(symbol) {
     categoryCounterInc("types.allocated", "classtype");
     ENFORCE(symbol.exists());
 }
 
+namespace {
+// Interned ClassTypes by symbol id, in chunks that are allocated on first use and, like the types in them, live as
+// long as the process. Ids past the end of the table just get a fresh ClassType.
+constexpr u4 INTERNED_CLASS_TYPES_CHUNK_BITS = 12;
+constexpr u4 INTERNED_CLASS_TYPES_CHUNK_SIZE = 1 << INTERNED_CLASS_TYPES_CHUNK_BITS;
+constexpr u4 INTERNED_CLASS_TYPES_CHUNKS = 1024;
+using InternedClassTypesChunk = array<atomic<const TypePtr *>, INTERNED_CLASS_TYPES_CHUNK_SIZE>;
+array<atomic<InternedClassTypesChunk *>, INTERNED_CLASS_TYPES_CHUNKS> internedClassTypes;
+
+// Returns the value in `slot`, first storing `make()` there if it's still null. Threads that race to fill a slot all
+// return the value of the one that won.
+template <class T, class F> T *loadOrPublish(atomic<T *> &slot, F make) {
+    auto *value = slot.load(memory_order_acquire);
+    if (value == nullptr) {
+        auto *fresh = make();
+        if (slot.compare_exchange_strong(value, fresh, memory_order_acq_rel, memory_order_acquire)) {
+            value = fresh;
+        } else {
+            delete fresh;
+        }
+    }
+    return value;
+}
+} // namespace
+
+TypePtr ClassType::intern(SymbolRef symbol) {
+    auto chunkIdx = symbol._id >> INTERNED_CLASS_TYPES_CHUNK_BITS;
+    if (chunkIdx >= INTERNED_CLASS_TYPES_CHUNKS) {
+        categoryCounterInc("types.interned", "classtype.overflow");
+        return TypePtr(new ClassType(symbol));
+    }
+    // `new InternedClassTypesChunk()` value-initializes, i.e. nulls, every slot.
+    auto *chunk = loadOrPublish(internedClassTypes[chunkIdx], []() { return new InternedClassTypesChunk(); });
+    auto *interned = loadOrPublish((*chunk)[symbol._id & (INTERNED_CLASS_TYPES_CHUNK_SIZE - 1)],
+                                   [&]() { return new TypePtr(new ClassType(symbol)); });
+    return *interned;
+}
+
 void ProxyType::_sanityCheck(Context ctx) {
     ENFORCE(cast_type<ClassType>(this->underlying().get()) != nullptr ||
             cast_type<AppliedType>(this->underlying().get()) != nullptr);
@@ -299,22 +341,26 @@ bool Type::isBottom() const {
     return t != nullptr && t->symbol == Symbols::bottom();
 }
 
-LiteralType::LiteralType(int64_t val) : value(val), literalKind(LiteralTypeKind::Integer) {
+LiteralType::LiteralType(int64_t val)
+    : ProxyType(TypeTag::LiteralType), value(val), literalKind(LiteralTypeKind::Integer) {
     categoryCounterInc("types.allocated", "literaltype");
 }
 
-LiteralType::LiteralType(double val) : floatval(val), literalKind(LiteralTypeKind::Float) {
+LiteralType::LiteralType(double val)
+    : ProxyType(TypeTag::LiteralType), floatval(val), literalKind(LiteralTypeKind::Float) {
     categoryCounterInc("types.allocated", "literaltype");
 }
 
 LiteralType::LiteralType(SymbolRef klass, NameRef val)
-    : value(val._id), literalKind(klass == Symbols::String() ? LiteralTypeKind::String : LiteralTypeKind::Symbol) {
+    : ProxyType(TypeTag::LiteralType), value(val._id),
+      literalKind(klass == Symbols::String() ? LiteralTypeKind::String : LiteralTypeKind::Symbol) {
     categoryCounterInc("types.allocated", "literaltype");
     ENFORCE(klass == Symbols::String() || klass == Symbols::Symbol());
 }
 
 LiteralType::LiteralType(bool val)
-    : value(val ? 1 : 0), literalKind(val ? LiteralTypeKind::True : LiteralTypeKind::False) {
+    : ProxyType(TypeTag::LiteralType), value(val ? 1 : 0),
+      literalKind(val ? LiteralTypeKind::True : LiteralTypeKind::False) {
     categoryCounterInc("types.allocated", "literaltype");
 }
 
@@ -337,7 +383,7 @@ TypePtr LiteralType::underlying() const {
 }
 
 TupleType::TupleType(TypePtr underlying, vector<TypePtr> elements)
-    : elems(move(elements)), underlying_(std::move(underlying)) {
+    : ProxyType(TypeTag::TupleType), elems(move(elements)), underlying_(std::move(underlying)) {
     categoryCounterInc("types.allocated", "tupletype");
 }
 
@@ -346,7 +392,8 @@ TypePtr TupleType::build(Context ctx, vector<TypePtr> elements) {
     return make_type<TupleType>(move(underlying), move(elements));
 }
 
-AndType::AndType(const TypePtr &left, const TypePtr &right) : left(move(left)), right(move(right)) {
+AndType::AndType(const TypePtr &left, const TypePtr &right)
+    : GroundType(TypeTag::AndType), left(move(left)), right(move(right)) {
     categoryCounterInc("types.allocated", "andtype");
 }
 
@@ -362,7 +409,8 @@ bool LiteralType::equals(const LiteralType &rhs) const {
     return lklass->symbol == rklass->symbol;
 }
 
-OrType::OrType(const TypePtr &left, const TypePtr &right) : left(move(left)), right(move(right)) {
+OrType::OrType(const TypePtr &left, const TypePtr &right)
+    : GroundType(TypeTag::OrType), left(move(left)), right(move(right)) {
     categoryCounterInc("types.allocated", "ortype");
 }
 
@@ -373,12 +421,12 @@ void TupleType::_sanityCheck(Context ctx) {
     ENFORCE(applied->klass == Symbols::Array());
 }
 
-ShapeType::ShapeType() : underlying_(Types::hashOfUntyped()) {
+ShapeType::ShapeType() : ProxyType(TypeTag::ShapeType), underlying_(Types::hashOfUntyped()) {
     categoryCounterInc("types.allocated", "shapetype");
 }
 
 ShapeType::ShapeType(TypePtr underlying, vector<TypePtr> keys, vector<TypePtr> values)
-    : keys(move(keys)), values(move(values)), underlying_(std::move(underlying)) {
+    : ProxyType(TypeTag::ShapeType), keys(move(keys)), values(move(values)), underlying_(std::move(underlying)) {
     DEBUG_ONLY(for (auto &k : this->keys) { ENFORCE(cast_type<LiteralType>(k.get()) != nullptr); };);
     categoryCounterInc("types.allocated", "shapetype");
 }
@@ -402,7 +450,7 @@ void ShapeType::_sanityCheck(Context ctx) {
     }
 }
 
-AliasType::AliasType(SymbolRef other) : symbol(other) {
+AliasType::AliasType(SymbolRef other) : Type(TypeTag::AliasType), symbol(other) {
     categoryCounterInc("types.allocated", "aliastype");
 }
 
@@ -571,8 +619,12 @@ InlinedVector<SymbolRef, 4> Types::alignBaseTypeArgs(Context ctx, SymbolRef what
  * fromWhat - where the generic type was written
  * inWhat   - where the generic type is observed
  */
-TypePtr Types::resultTypeAsSeenFrom(Context ctx, TypePtr what, SymbolRef fromWhat, SymbolRef inWhat,
-                                    const vector<TypePtr> &targs) {
+namespace {
+StaticCounter asSeenFromMemoHits("types.memo.as_seen_from.hit");
+StaticCounter asSeenFromMemoMisses("types.memo.as_seen_from.miss");
+
+TypePtr resultTypeAsSeenFromUncached(Context ctx, const TypePtr &what, SymbolRef fromWhat, SymbolRef inWhat,
+                                     const vector<TypePtr> &targs) {
     SymbolRef originalOwner = fromWhat;
     ENFORCE(fromWhat.data(ctx)->isClass());
     ENFORCE(inWhat.data(ctx)->isClass());
@@ -588,11 +640,96 @@ TypePtr Types::resultTypeAsSeenFrom(Context ctx, TypePtr what, SymbolRef fromWha
                 fromWhat.data(ctx)->derivesFrom(ctx, inWhat),
             "\n{}\nis unrelated to\n\n{}", fromWhat.data(ctx)->toString(ctx), inWhat.data(ctx)->toString(ctx));
 
-    auto currentAlignment = alignBaseTypeArgs(ctx, originalOwner, targs, inWhat);
+    auto currentAlignment = Types::alignBaseTypeArgs(ctx, originalOwner, targs, inWhat);
+
+    return Types::instantiate(ctx, what, currentAlignment, targs);
+}
+
+// Results of `Types::resultTypeAsSeenFrom`, which only depend on the arguments and on the type members of classes, so
+// they stay valid until GlobalState::frozenSymbolTableVersion changes. The types in a method's signature and the type
+// arguments of a receiver are shared by every call through it, so their addresses make good keys; entries hold on to
+// them so that the addresses aren't reused.
+class AsSeenFromMemo {
+    static constexpr size_t MAX_SIZE = 1 << 14;
+
+    struct Key {
+        const Type *what;
+        SymbolRef fromWhat;
+        SymbolRef inWhat;
+        InlinedVector<const Type *, 2> targs;
+
+        bool operator==(const Key &rhs) const {
+            return what == rhs.what && fromWhat == rhs.fromWhat && inWhat == rhs.inWhat && targs == rhs.targs;
+        }
+
+        template <typename H> friend H AbslHashValue(H h, const Key &key) {
+            return H::combine(std::move(h), key.what, key.fromWhat, key.inWhat, key.targs);
+        }
+    };
+    struct Entry {
+        TypePtr what;
+        vector<TypePtr> targs;
+        TypePtr result;
+    };
+
+    u8 symbolTableVersion = 0;
+    UnorderedMap<Key, Entry> entries;
+
+    static Key key(const TypePtr &what, SymbolRef fromWhat, SymbolRef inWhat, const vector<TypePtr> &targs) {
+        Key key{what.get(), fromWhat, inWhat, {}};
+        for (auto &targ : targs) {
+            key.targs.emplace_back(targ.get());
+        }
+        return key;
+    }
+
+public:
+    // Returns this thread's memo table, emptied if it was filled for another version of the symbol table.
+    static AsSeenFromMemo &get(u8 symbolTableVersion) {
+        thread_local AsSeenFromMemo memo;
+        if (memo.symbolTableVersion != symbolTableVersion) {
+            memo.entries.clear();
+            memo.symbolTableVersion = symbolTableVersion;
+        }
+        return memo;
+    }
+
+    const TypePtr *find(const TypePtr &what, SymbolRef fromWhat, SymbolRef inWhat,
+                        const vector<TypePtr> &targs) const {
+        auto fnd = entries.find(key(what, fromWhat, inWhat, targs));
+        return fnd == entries.end() ? nullptr : &fnd->second.result;
+    }
 
-    return instantiate(ctx, what, currentAlignment, targs);
+    void insert(const TypePtr &what, SymbolRef fromWhat, SymbolRef inWhat, const vector<TypePtr> &targs,
+                TypePtr result) {
+        if (entries.size() >= MAX_SIZE) {
+            // Like TypeMemoTable, dropping everything keeps this simple.
+            entries.clear();
+        }
+        entries.emplace(key(what, fromWhat, inWhat, targs), Entry{what, targs, move(result)});
+    }
+};
+} // namespace
+
+TypePtr Types::resultTypeAsSeenFrom(Context ctx, TypePtr what, SymbolRef fromWhat, SymbolRef inWhat,
+                                    const vector<TypePtr> &targs) {
+    auto version = ctx.state.frozenSymbolTableVersion();
+    // Nothing to instantiate if `fromWhat` isn't generic, which is most of the time.
+    if (version == 0 || what == nullptr || fromWhat.data(ctx)->typeMembers().empty()) {
+        return resultTypeAsSeenFromUncached(ctx, what, fromWhat, inWhat, targs);
+    }
+    auto &memo = AsSeenFromMemo::get(version);
+    if (auto *cached = memo.find(what, fromWhat, inWhat, targs)) {
+        asSeenFromMemoHits.inc();
+        return *cached;
+    }
+    asSeenFromMemoMisses.inc();
+    auto result = resultTypeAsSeenFromUncached(ctx, what, fromWhat, inWhat, targs);
+    memo.insert(what, fromWhat, inWhat, targs, result);
+    return result;
 }
 
+
 TypePtr Types::getProcReturnType(Context ctx, const TypePtr &procType) {
     if (!procType->derivesFrom(ctx, Symbols::Proc())) {
         return Types::untypedUntracked();
@@ -605,10 +742,6 @@ TypePtr Types::getProcReturnType(Context ctx, const TypePtr &procType) {
     return applied->targs.front();
 }
 
-bool Types::isSubType(Context ctx, const TypePtr &t1, const TypePtr &t2) {
-    return isSubTypeUnderConstraint(ctx, TypeConstraint::EmptyFrozenConstraint, t1, t2);
-}
-
 bool TypeVar::isFullyDefined() {
     return false;
 }
@@ -621,7 +754,7 @@ bool TypeVar::derivesFrom(const GlobalState &gs, SymbolRef klass) const {
     Exception::raise("should never happen. You're missing a call to either Types::approximate or Types::instantiate");
 }
 
-TypeVar::TypeVar(SymbolRef sym) : sym(sym) {
+TypeVar::TypeVar(SymbolRef sym) : Type(TypeTag::TypeVar), sym(sym) {
     categoryCounterInc("types.allocated", "typevar");
 }
 
@@ -658,11 +791,11 @@ bool AppliedType::derivesFrom(const GlobalState &gs, SymbolRef klass) const {
 }
 
 LambdaParam::LambdaParam(const SymbolRef definition, TypePtr lowerBound, TypePtr upperBound)
-    : definition(definition), lowerBound(lowerBound), upperBound(upperBound) {
+    : Type(TypeTag::LambdaParam), definition(definition), lowerBound(lowerBound), upperBound(upperBound) {
     categoryCounterInc("types.allocated", "lambdatypeparam");
 }
 
-SelfTypeParam::SelfTypeParam(const SymbolRef definition) : definition(definition) {
+SelfTypeParam::SelfTypeParam(const SymbolRef definition) : Type(TypeTag::SelfTypeParam), definition(definition) {
     categoryCounterInc("types.allocated", "selftypeparam");
 }
 
@@ -784,10 +917,11 @@ TypePtr TupleType::elementType() const {
     return ap->targs.front();
 }
 
-SelfType::SelfType() {
+SelfType::SelfType() : Type(TypeTag::SelfType) {
     categoryCounterInc("types.allocated", "selftype");
 };
-AppliedType::AppliedType(SymbolRef klass, vector<TypePtr> targs) : klass(klass), targs(std::move(targs)) {
+AppliedType::AppliedType(SymbolRef klass, vector<TypePtr> targs)
+    : Type(TypeTag::AppliedType), klass(klass), targs(std::move(targs)) {
     categoryCounterInc("types.allocated", "appliedtype");
 }
 
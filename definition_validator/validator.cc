@@ -327,30 +327,37 @@ private:
     UnorderedMap<core::SymbolRef, vector<core::SymbolRef>> abstractCache;
 
     const vector<core::SymbolRef> &getAbstractMethods(const core::GlobalState &gs, core::SymbolRef klass) {
-        vector<core::SymbolRef> abstract;
         auto ent = abstractCache.find(klass);
         if (ent != abstractCache.end()) {
             return ent->second;
         }
 
+        // An abstract method reached through more than one ancestor (say, an interface that both the superclass and
+        // a mixin include) is only listed once, so that long hierarchies of interfaces don't make the lists, and the
+        // time it takes to build them, grow with every path to it.
+        vector<core::SymbolRef> abstract;
+        UnorderedSet<core::SymbolRef> seen;
+        auto addAll = [&](const vector<core::SymbolRef> &methods) {
+            for (auto method : methods) {
+                if (seen.insert(method).second) {
+                    abstract.emplace_back(method);
+                }
+            }
+        };
+
         auto superclass = klass.data(gs)->superClass();
         if (superclass.exists()) {
-            auto &superclassMethods = getAbstractMethods(gs, superclass);
-            // TODO(nelhage): This code could go quadratic or even exponential given
-            // pathological arrangements of interfaces and abstract methods. Switch
-            // to a better data structure if that is ever a problem.
-            abstract.insert(abstract.end(), superclassMethods.begin(), superclassMethods.end());
+            addAll(getAbstractMethods(gs, superclass));
         }
 
         for (auto ancst : klass.data(gs)->mixins()) {
-            auto fromMixin = getAbstractMethods(gs, ancst);
-            abstract.insert(abstract.end(), fromMixin.begin(), fromMixin.end());
+            addAll(getAbstractMethods(gs, ancst));
         }
 
         auto isAbstract = klass.data(gs)->isClassAbstract();
         if (isAbstract) {
             for (auto [name, sym] : klass.data(gs)->members()) {
-                if (sym.exists() && sym.data(gs)->isMethod() && sym.data(gs)->isAbstract()) {
+                if (sym.exists() && sym.data(gs)->isMethod() && sym.data(gs)->isAbstract() && seen.insert(sym).second) {
                     abstract.emplace_back(sym);
                 }
             }
@@ -49,10 +49,11 @@ vector<unique_ptr<ast::Expression>> ProtobufDescriptorPool::replaceDSL(core::Mut
 
     // Put the actual send in the tree too to require that the Protobuf constant / methods are actually there.
     // (also needed for autogen to be able to see the )
+    // The assignment is replaced by what this returns, so its parts can be moved rather than copied.
     ast::ClassDef::RHS_store rhs;
-    rhs.emplace_back(asgn->rhs->deepCopy());
+    rhs.emplace_back(std::move(asgn->rhs));
 
-    if (sendMsgclass->fun == core::Names::msgclass()) {
+    if (kind == ast::ClassDefKind::Class) {
         auto arg0 = ast::MK::Local(asgn->loc, core::Names::arg0());
         auto arg = ast::MK::OptionalArg(asgn->loc, std::move(arg0), ast::MK::Hash0(asgn->loc));
         rhs.emplace_back(
@@ -60,7 +61,7 @@ vector<unique_ptr<ast::Expression>> ProtobufDescriptorPool::replaceDSL(core::Mut
     }
 
     vector<unique_ptr<ast::Expression>> res;
-    res.emplace_back(ast::MK::Class(asgn->loc, asgn->loc, asgn->lhs->deepCopy(), {}, std::move(rhs), kind));
+    res.emplace_back(ast::MK::Class(asgn->loc, asgn->loc, std::move(asgn->lhs), {}, std::move(rhs), kind));
     return res;
 }
 
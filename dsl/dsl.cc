@@ -18,128 +18,217 @@
 #include "dsl/Struct.h"
 #include "dsl/attr_reader.h"
 #include "main/pipeline/semantic_extension/SemanticExtension.h"
+#include <chrono>
 
 using namespace std;
 
 namespace sorbet::dsl {
 
-class DSLReplacer {
-    friend class DSL;
+namespace {
+
+// Adds the time a rewriter takes to its counter in the `dsl.rewriter_ns` category, to see which DSLs are expensive.
+class RewriterTimer final {
+    ConstExprStr rewriter;
+    chrono::time_point<chrono::steady_clock> start;
 
 public:
-    unique_ptr<ast::ClassDef> postTransformClassDef(core::MutableContext ctx, unique_ptr<ast::ClassDef> classDef) {
-        Command::patchDSL(ctx, classDef.get());
-        Rails::patchDSL(ctx, classDef.get());
-        OpusEnum::patchDSL(ctx, classDef.get());
-        Prop::patchDSL(ctx, classDef.get());
-
-        ast::Expression *prevStat = nullptr;
-        UnorderedMap<ast::Expression *, vector<unique_ptr<ast::Expression>>> replaceNodes;
-        for (auto &stat : classDef->rhs) {
-            typecase(
-                stat.get(),
-                [&](ast::Assign *assign) {
-                    auto nodes = Struct::replaceDSL(ctx, assign);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
-
-                    nodes = ClassNew::replaceDSL(ctx, assign);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
-
-                    nodes = ProtobufDescriptorPool::replaceDSL(ctx, assign);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
-                },
-
-                [&](ast::Send *send) {
-                    vector<unique_ptr<ast::Expression>> nodes;
-
-                    for (auto &extension : ctx.state.semanticExtensions) {
-                        nodes = extension->replaceDSL(ctx.state, send);
-                        if (!nodes.empty()) {
-                            replaceNodes[stat.get()] = std::move(nodes);
-                            return;
-                        }
-                    }
-
-                    nodes = MixinEncryptedProp::replaceDSL(ctx, send);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
-
-                    nodes = Minitest::replaceDSL(ctx, send);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = move(nodes);
-                        return;
-                    }
-
-                    nodes = DSLBuilder::replaceDSL(ctx, send);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
-
-                    nodes = Private::replaceDSL(ctx, send);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
-
-                    nodes = Delegate::replaceDSL(ctx, send);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
-
-                    // This one is different: it gets an extra prevStat argument.
-                    nodes = AttrReader::replaceDSL(ctx, send, prevStat);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
-
-                    // This one is also a little different: it gets the ClassDef kind
-                    nodes = Mattr::replaceDSL(ctx, send, classDef->kind);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
-                },
-
-                [&](ast::Expression *e) {});
-
-            prevStat = stat.get();
+    RewriterTimer(ConstExprStr rewriter) : rewriter(rewriter), start(chrono::steady_clock::now()) {}
+    ~RewriterTimer() {
+        auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+        categoryCounterAdd("dsl.rewriter_ns", rewriter, elapsed.count());
+    }
+};
+
+enum class SendRewriter { None, MixinEncryptedProp, Minitest, DSLBuilder, Private, Delegate, AttrReader, Mattr };
+
+// Each rewriter of sends only handles calls to a few methods, and no two handle the same one, so a statement only ever
+// has to be shown to the rewriter its method name picks.
+SendRewriter sendRewriterFor(core::NameRef fun) {
+    switch (fun._id) {
+        case core::Names::encrypted_prop()._id:
+            return SendRewriter::MixinEncryptedProp;
+        case core::Names::before()._id:
+        case core::Names::describe()._id:
+        case core::Names::it()._id:
+            return SendRewriter::Minitest;
+        case core::Names::dslOptional()._id:
+        case core::Names::dslRequired()._id:
+            return SendRewriter::DSLBuilder;
+        case core::Names::private_()._id:
+        case core::Names::privateClassMethod()._id:
+            return SendRewriter::Private;
+        case core::Names::delegate()._id:
+            return SendRewriter::Delegate;
+        case core::Names::attr()._id:
+        case core::Names::attrReader()._id:
+        case core::Names::attrWriter()._id:
+        case core::Names::attrAccessor()._id:
+            return SendRewriter::AttrReader;
+        case core::Names::mattrReader()._id:
+        case core::Names::mattrWriter()._id:
+        case core::Names::mattrAccessor()._id:
+        case core::Names::cattrReader()._id:
+        case core::Names::cattrWriter()._id:
+        case core::Names::cattrAccessor()._id:
+        case core::Names::classAttribute()._id:
+            return SendRewriter::Mattr;
+        default:
+            return SendRewriter::None;
+    }
+}
+
+vector<unique_ptr<ast::Expression>> replaceAssign(core::MutableContext ctx, ast::Assign *assign) {
+    vector<unique_ptr<ast::Expression>> nodes;
+    {
+        RewriterTimer timer("Struct");
+        nodes = Struct::replaceDSL(ctx, assign);
+    }
+    if (nodes.empty()) {
+        RewriterTimer timer("ClassNew");
+        nodes = ClassNew::replaceDSL(ctx, assign);
+    }
+    if (nodes.empty()) {
+        RewriterTimer timer("ProtobufDescriptorPool");
+        nodes = ProtobufDescriptorPool::replaceDSL(ctx, assign);
+    }
+    return nodes;
+}
+
+vector<unique_ptr<ast::Expression>> replaceSend(core::MutableContext ctx, ast::Send *send,
+                                                const ast::Expression *prevStat, ast::ClassDefKind classDefKind) {
+    vector<unique_ptr<ast::Expression>> nodes;
+
+    if (!ctx.state.semanticExtensions.empty()) {
+        RewriterTimer timer("SemanticExtension");
+        for (auto &extension : ctx.state.semanticExtensions) {
+            nodes = extension->replaceDSL(ctx.state, send);
+            if (!nodes.empty()) {
+                return nodes;
+            }
+        }
+    }
+
+    switch (sendRewriterFor(send->fun)) {
+        case SendRewriter::None:
+            break;
+        case SendRewriter::MixinEncryptedProp: {
+            RewriterTimer timer("MixinEncryptedProp");
+            nodes = MixinEncryptedProp::replaceDSL(ctx, send);
+            break;
+        }
+        case SendRewriter::Minitest: {
+            RewriterTimer timer("Minitest");
+            nodes = Minitest::replaceDSL(ctx, send);
+            break;
+        }
+        case SendRewriter::DSLBuilder: {
+            RewriterTimer timer("DSLBuilder");
+            nodes = DSLBuilder::replaceDSL(ctx, send);
+            break;
+        }
+        case SendRewriter::Private: {
+            RewriterTimer timer("Private");
+            nodes = Private::replaceDSL(ctx, send);
+            break;
+        }
+        case SendRewriter::Delegate: {
+            RewriterTimer timer("Delegate");
+            nodes = Delegate::replaceDSL(ctx, send);
+            break;
+        }
+        case SendRewriter::AttrReader: {
+            // This one is different: it gets an extra prevStat argument.
+            RewriterTimer timer("AttrReader");
+            nodes = AttrReader::replaceDSL(ctx, send, prevStat);
+            break;
         }
-        if (replaceNodes.empty()) {
-            return classDef;
+        case SendRewriter::Mattr: {
+            // This one is also a little different: it gets the ClassDef kind
+            RewriterTimer timer("Mattr");
+            nodes = Mattr::replaceDSL(ctx, send, classDefKind);
+            break;
         }
+    }
+    return nodes;
+}
 
-        auto oldRHS = std::move(classDef->rhs);
-        classDef->rhs.clear();
-        classDef->rhs.reserve(oldRHS.size());
+} // namespace
+
+void DSL::patchClassDef(core::MutableContext ctx, ast::ClassDef *classDef) {
+    {
+        RewriterTimer timer("Command");
+        Command::patchDSL(ctx, classDef);
+    }
+    {
+        RewriterTimer timer("Rails");
+        Rails::patchDSL(ctx, classDef);
+    }
+    {
+        RewriterTimer timer("OpusEnum");
+        OpusEnum::patchDSL(ctx, classDef);
+    }
+    {
+        RewriterTimer timer("Prop");
+        Prop::patchDSL(ctx, classDef);
+    }
 
-        for (auto &stat : oldRHS) {
-            if (replaceNodes.find(stat.get()) == replaceNodes.end()) {
-                classDef->rhs.emplace_back(std::move(stat));
-            } else {
-                for (auto &newNode : replaceNodes.at(stat.get())) {
-                    classDef->rhs.emplace_back(std::move(newNode));
+    ast::Expression *prevStat = nullptr;
+    UnorderedMap<ast::Expression *, vector<unique_ptr<ast::Expression>>> replaceNodes;
+    for (auto &stat : classDef->rhs) {
+        typecase(
+            stat.get(),
+            [&](ast::Assign *assign) {
+                auto nodes = replaceAssign(ctx, assign);
+                if (!nodes.empty()) {
+                    replaceNodes[stat.get()] = std::move(nodes);
                 }
+            },
+
+            [&](ast::Send *send) {
+                auto nodes = replaceSend(ctx, send, prevStat, classDef->kind);
+                if (!nodes.empty()) {
+                    replaceNodes[stat.get()] = std::move(nodes);
+                }
+            },
+
+            [&](ast::Expression *e) {});
+
+        prevStat = stat.get();
+    }
+    if (replaceNodes.empty()) {
+        return;
+    }
+
+    auto oldRHS = std::move(classDef->rhs);
+    classDef->rhs.clear();
+    classDef->rhs.reserve(oldRHS.size());
+
+    for (auto &stat : oldRHS) {
+        if (replaceNodes.find(stat.get()) == replaceNodes.end()) {
+            classDef->rhs.emplace_back(std::move(stat));
+        } else {
+            for (auto &newNode : replaceNodes.at(stat.get())) {
+                classDef->rhs.emplace_back(std::move(newNode));
             }
         }
+    }
+}
+
+unique_ptr<ast::Expression> DSL::patchSend(core::MutableContext ctx, unique_ptr<ast::Send> send) {
+    return InterfaceWrapper::replaceDSL(ctx, std::move(send));
+}
+
+class DSLReplacer {
+    friend class DSL;
+
+public:
+    unique_ptr<ast::ClassDef> postTransformClassDef(core::MutableContext ctx, unique_ptr<ast::ClassDef> classDef) {
+        DSL::patchClassDef(ctx, classDef.get());
         return classDef;
     }
 
     unique_ptr<ast::Expression> postTransformSend(core::MutableContext ctx, unique_ptr<ast::Send> send) {
-        return InterfaceWrapper::replaceDSL(ctx, std::move(send));
+        return DSL::patchSend(ctx, std::move(send));
     }
 
 private:
@@ -9,6 +9,11 @@ class DSL final {
 public:
     static std::unique_ptr<ast::Expression> run(core::MutableContext ctx, std::unique_ptr<ast::Expression> tree);
 
+    // The rewrites `run` makes as it leaves a class and a send, for passes that walk the tree anyway and make them as
+    // they go. The bodies of nested classes and the arguments of the send have been rewritten already.
+    static void patchClassDef(core::MutableContext ctx, ast::ClassDef *classDef);
+    static std::unique_ptr<ast::Expression> patchSend(core::MutableContext ctx, std::unique_ptr<ast::Send> send);
+
     DSL() = delete;
 };
 
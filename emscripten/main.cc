@@ -1,5 +1,6 @@
+#include "core/Error.h"
+#include "main/embed/embed.h"
 #include "main/lsp/wrapper.h"
-#include "main/realmain.h"
 
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
@@ -11,9 +12,29 @@
 using namespace std;
 
 extern "C" {
+// Prints what `sorbet --color=always -e rubySrc` would. The payload is loaded by the first call, and every later call
+// starts from the state it left instead of loading it again.
 void EMSCRIPTEN_KEEPALIVE typecheck(const char *rubySrc) {
-    const char *argv[] = {"sorbet", "--color=always", "--silence-dev-message", "-e", rubySrc};
-    sorbet::realmain::realmain(size(argv), const_cast<char **>(argv));
+    static sorbet::realmain::embed::Typechecker *typechecker;
+    if (!typechecker) {
+        sorbet::core::ErrorColors::enableColors();
+        typechecker = new sorbet::realmain::embed::Typechecker();
+    }
+
+    string input = rubySrc;
+    if (sorbet::core::File::fileSigil(input) == sorbet::core::StrictLevel::None) {
+        // put it at the end so as to not upset line numbers
+        input += "\n# typed: true";
+    }
+    auto errors = typechecker->typecheck({{"-e", move(input)}});
+    for (int i = 0; i < errors.size(); i++) {
+        fmt::print(stderr, "{}{}", i == 0 ? "" : "\n\n", errors[i].text);
+    }
+    if (errors.empty()) {
+        fmt::print(stderr, "No errors! Great job.\n");
+    } else {
+        fmt::print(stderr, "\nErrors: {}\n", errors.size());
+    }
 }
 
 void EMSCRIPTEN_KEEPALIVE lsp(void (*respond)(const char *), const char *message) {
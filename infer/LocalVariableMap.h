@@ -0,0 +1,189 @@
+#ifndef SORBET_INFER_LOCALVARIABLEMAP_H
+#define SORBET_INFER_LOCALVARIABLEMAP_H
+
+#include "cfg/CFG.h"
+#include "common/common.h"
+#include "core/LocalVariable.h"
+#include <array>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace sorbet::infer {
+
+/**
+ * Numbers the local variables of the method being inferred densely, so that the state of every environment can be
+ * kept in flat vectors indexed by those numbers instead of one hash map per basic block. The variables the CFG writes
+ * to are numbered up front; any other one gets the next number the first time an environment stores it.
+ */
+class LocalVariableIds final {
+    UnorderedMap<core::LocalVariable, int> ids;
+
+public:
+    explicit LocalVariableIds(const cfg::CFG &cfg) {
+        ids.reserve(cfg.minLoops.size());
+        for (auto &entry : cfg.minLoops) {
+            idOf(entry.first);
+        }
+    }
+    LocalVariableIds(const LocalVariableIds &) = delete;
+
+    // Returns -1 if `var` has not been numbered yet.
+    int find(core::LocalVariable var) const {
+        auto fnd = ids.find(var);
+        return fnd == ids.end() ? -1 : fnd->second;
+    }
+
+    int idOf(core::LocalVariable var) {
+        return ids.emplace(var, ids.size()).first->second;
+    }
+
+    int size() const {
+        return ids.size();
+    }
+};
+
+/**
+ * A map from local variables to `T`, indexed by LocalVariableIds and stored in fixed-size chunks that copies of the map
+ * share. Copying a map is O(variables / CHUNK_SIZE); a shared chunk is copied the first time one of its entries is
+ * accessed through a non-const reference, so an environment that is copied and then only told a few things (like the
+ * ones `Environment::withCond` makes) costs O(changes).
+ *
+ * Iterating visits variables in the order they were numbered. Non-const iteration unshares every chunk.
+ */
+template <class T> class LocalVariableMap final {
+    static constexpr int CHUNK_BITS = 3;
+    static constexpr int CHUNK_SIZE = 1 << CHUNK_BITS;
+    static constexpr int CHUNK_MASK = CHUNK_SIZE - 1;
+    using Entry = std::pair<core::LocalVariable, std::optional<T>>;
+    using Chunk = std::array<Entry, CHUNK_SIZE>;
+
+    LocalVariableIds *ids;
+    // Null chunks have no entries.
+    std::vector<std::shared_ptr<Chunk>> chunks;
+    int count = 0;
+
+    const Entry *entry(int id) const {
+        auto chunkIdx = id >> CHUNK_BITS;
+        if (id < 0 || chunkIdx >= chunks.size() || chunks[chunkIdx] == nullptr) {
+            return nullptr;
+        }
+        return &(*chunks[chunkIdx])[id & CHUNK_MASK];
+    }
+
+    Chunk &mutableChunk(int chunkIdx) {
+        if (chunkIdx >= chunks.size()) {
+            chunks.resize(chunkIdx + 1);
+        }
+        auto &chunk = chunks[chunkIdx];
+        if (chunk == nullptr) {
+            chunk = std::make_shared<Chunk>();
+        } else if (chunk.use_count() > 1) {
+            chunk = std::make_shared<Chunk>(*chunk);
+        }
+        return *chunk;
+    }
+
+    template <class Map, class Value> class Iterator final {
+        Map *map;
+        int id;
+
+        void skipMissing() {
+            const int end = map->chunks.size() * CHUNK_SIZE;
+            while (id < end) {
+                auto *entry = map->entry(id);
+                if (entry == nullptr) {
+                    id = (id | CHUNK_MASK) + 1;
+                } else if (!entry->second.has_value()) {
+                    id++;
+                } else {
+                    break;
+                }
+            }
+        }
+
+    public:
+        Iterator(Map *map, int id) : map(map), id(id) {
+            skipMissing();
+        }
+        std::pair<core::LocalVariable, Value &> operator*() const {
+            auto &entry = (*map->chunks[id >> CHUNK_BITS])[id & CHUNK_MASK];
+            return {entry.first, *entry.second};
+        }
+        Iterator &operator++() {
+            id++;
+            skipMissing();
+            return *this;
+        }
+        bool operator!=(const Iterator &rhs) const {
+            return id != rhs.id;
+        }
+    };
+
+public:
+    explicit LocalVariableMap(LocalVariableIds &ids) : ids(&ids) {}
+
+    int size() const {
+        return count;
+    }
+
+    bool contains(core::LocalVariable var) const {
+        return find(var) != nullptr;
+    }
+
+    // Returns null if there is no entry for `var`.
+    const T *find(core::LocalVariable var) const {
+        auto *entry = this->entry(ids->find(var));
+        if (entry == nullptr || !entry->second.has_value()) {
+            return nullptr;
+        }
+        return &*entry->second;
+    }
+
+    T *find(core::LocalVariable var) {
+        auto id = ids->find(var);
+        if (std::as_const(*this).find(var) == nullptr) {
+            return nullptr;
+        }
+        return &*mutableChunk(id >> CHUNK_BITS)[id & CHUNK_MASK].second;
+    }
+
+    // Like `std::map::operator[]`. Entries don't move, but see the class comment about copies.
+    T &operator[](core::LocalVariable var) {
+        auto id = ids->idOf(var);
+        auto &entry = mutableChunk(id >> CHUNK_BITS)[id & CHUNK_MASK];
+        if (!entry.second.has_value()) {
+            entry.first = var;
+            entry.second.emplace();
+            count++;
+        }
+        return *entry.second;
+    }
+
+    void reserve(int size) {
+        chunks.reserve((std::max(size, ids->size()) + CHUNK_MASK) >> CHUNK_BITS);
+    }
+
+    Iterator<const LocalVariableMap, const T> begin() const {
+        return {this, 0};
+    }
+    Iterator<const LocalVariableMap, const T> end() const {
+        return {this, (int)chunks.size() * CHUNK_SIZE};
+    }
+    Iterator<LocalVariableMap, T> begin() {
+        for (int chunkIdx = 0; chunkIdx < chunks.size(); chunkIdx++) {
+            if (chunks[chunkIdx] != nullptr) {
+                mutableChunk(chunkIdx);
+            }
+        }
+        return {this, 0};
+    }
+    Iterator<LocalVariableMap, T> end() {
+        return {this, (int)chunks.size() * CHUNK_SIZE};
+    }
+};
+
+} // namespace sorbet::infer
+
+#endif // SORBET_INFER_LOCALVARIABLEMAP_H
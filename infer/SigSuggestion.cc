@@ -116,7 +116,7 @@ void extractSendArgumentKnowledge(core::Context ctx, core::Loc bindLoc, cfg::Sen
                                   const UnorderedMap<core::LocalVariable, InlinedVector<core::NameRef, 1>> &blockLocals,
                                   UnorderedMap<core::NameRef, core::TypePtr> &blockArgRequirements) {
     InlinedVector<unique_ptr<core::TypeAndOrigins>, 2> typeAndOriginsOwner;
-    InlinedVector<const core::TypeAndOrigins *, 2> args;
+    core::DispatchArgList args;
 
     args.reserve(snd->args.size());
     for (cfg::VariableUseSite &arg : snd->args) {
@@ -79,9 +79,7 @@ KnowledgeRef KnowledgeFact::under(core::Context ctx, const KnowledgeRef &what, c
         return copy;
     }
     bool enteringLoop = (bb->flags & cfg::CFG::LOOP_HEADER) != 0;
-    for (auto &pair : env.vars) {
-        auto local = pair.first;
-        auto &state = pair.second;
+    for (auto [local, state] : env.vars) {
         if (enteringLoop && bb->outerLoops <= inWhat.maxLoopWrite[local]) {
             continue;
         }
@@ -249,20 +247,20 @@ string Environment::toString(core::Context ctx) const {
 
 bool Environment::hasType(core::Context ctx, core::LocalVariable symbol) const {
     auto fnd = vars.find(symbol);
-    if (fnd == vars.end()) {
+    if (fnd == nullptr) {
         return false;
     }
     // We don't distinguish between nullptr and "not set"
-    return fnd->second.typeAndOrigins.type.get() != nullptr;
+    return fnd->typeAndOrigins.type.get() != nullptr;
 }
 
 const core::TypeAndOrigins &Environment::getTypeAndOrigin(core::Context ctx, core::LocalVariable symbol) const {
     auto fnd = vars.find(symbol);
-    if (fnd == vars.end()) {
+    if (fnd == nullptr) {
         return uninitialized;
     }
-    ENFORCE(fnd->second.typeAndOrigins.type.get() != nullptr);
-    return fnd->second.typeAndOrigins;
+    ENFORCE(fnd->typeAndOrigins.type.get() != nullptr);
+    return fnd->typeAndOrigins;
 }
 
 const core::TypeAndOrigins &Environment::getAndFillTypeAndOrigin(core::Context ctx,
@@ -274,10 +272,10 @@ const core::TypeAndOrigins &Environment::getAndFillTypeAndOrigin(core::Context c
 
 bool Environment::getKnownTruthy(core::LocalVariable var) const {
     auto fnd = vars.find(var);
-    if (fnd == vars.end()) {
+    if (fnd == nullptr) {
         return false;
     }
-    return fnd->second.knownTruthy;
+    return fnd->knownTruthy;
 }
 
 void Environment::propagateKnowledge(core::Context ctx, core::LocalVariable to, core::LocalVariable from,
@@ -306,9 +304,9 @@ void Environment::propagateKnowledge(core::Context ctx, core::LocalVariable to,
 }
 
 void Environment::clearKnowledge(core::Context ctx, core::LocalVariable reassigned, KnowledgeFilter &knowledgeFilter) {
-    for (auto &el : vars) {
-        auto &k = el.second.knowledge;
-        if (knowledgeFilter.isNeeded(el.first)) {
+    for (auto [var, state] : vars) {
+        auto &k = state.knowledge;
+        if (knowledgeFilter.isNeeded(var)) {
             auto &truthy = k.truthy.mutate();
             auto &falsy = k.falsy.mutate();
             truthy.yesTypeTests.erase(remove_if(truthy.yesTypeTests.begin(), truthy.yesTypeTests.end(),
@@ -327,8 +325,8 @@ void Environment::clearKnowledge(core::Context ctx, core::LocalVariable reassign
         }
     }
     auto fnd = vars.find(reassigned);
-    ENFORCE(fnd != vars.end());
-    fnd->second.knownTruthy = false;
+    ENFORCE(fnd != nullptr);
+    fnd->knownTruthy = false;
 }
 
 bool isSingleton(core::Context ctx, core::SymbolRef sym) {
@@ -345,11 +343,11 @@ void Environment::updateKnowledge(core::Context ctx, core::LocalVariable local,
         }
         auto &whoKnows = getKnowledge(local);
         auto fnd = vars.find(send->recv.variable);
-        if (fnd != vars.end()) {
-            whoKnows.truthy = fnd->second.knowledge.falsy;
-            whoKnows.falsy = fnd->second.knowledge.truthy;
-            fnd->second.knowledge.truthy.mutate().yesTypeTests.emplace_back(local, core::Types::falsyTypes());
-            fnd->second.knowledge.falsy.mutate().noTypeTests.emplace_back(local, core::Types::falsyTypes());
+        if (fnd != nullptr) {
+            whoKnows.truthy = fnd->knowledge.falsy;
+            whoKnows.falsy = fnd->knowledge.truthy;
+            fnd->knowledge.truthy.mutate().yesTypeTests.emplace_back(local, core::Types::falsyTypes());
+            fnd->knowledge.falsy.mutate().noTypeTests.emplace_back(local, core::Types::falsyTypes());
         }
         whoKnows.truthy.mutate().yesTypeTests.emplace_back(send->recv.variable, core::Types::falsyTypes());
         whoKnows.falsy.mutate().noTypeTests.emplace_back(send->recv.variable, core::Types::falsyTypes());
@@ -488,13 +486,13 @@ void Environment::updateKnowledge(core::Context ctx, core::LocalVariable local,
     }
 }
 
-void Environment::setTypeAndOrigin(core::LocalVariable symbol, const core::TypeAndOrigins &typeAndOrigins) {
+void Environment::setTypeAndOrigin(core::LocalVariable symbol, core::TypeAndOrigins typeAndOrigins) {
     ENFORCE(typeAndOrigins.type.get() != nullptr);
-    vars[symbol].typeAndOrigins = typeAndOrigins;
+    vars[symbol].typeAndOrigins = move(typeAndOrigins);
 }
 
 const Environment &Environment::withCond(core::Context ctx, const Environment &env, Environment &copy, bool isTrue,
-                                         const UnorderedMap<core::LocalVariable, VariableState> &filter) {
+                                         const LocalVariableMap<VariableState> &filter) {
     if (!env.bb->bexit.cond.variable.exists() || env.bb->bexit.cond.variable == core::LocalVariable::blockCall()) {
         return env;
     }
@@ -504,7 +502,7 @@ const Environment &Environment::withCond(core::Context ctx, const Environment &e
 }
 
 void Environment::assumeKnowledge(core::Context ctx, bool isTrue, core::LocalVariable cond, core::Loc loc,
-                                  const UnorderedMap<core::LocalVariable, VariableState> &filter) {
+                                  const LocalVariableMap<VariableState> &filter) {
     auto &thisKnowledge = getKnowledge(cond, false);
     thisKnowledge.sanityCheck();
     if (!isTrue) {
@@ -524,7 +522,7 @@ void Environment::assumeKnowledge(core::Context ctx, bool isTrue, core::LocalVar
                 return;
             }
         }
-        setTypeAndOrigin(cond, tp);
+        setTypeAndOrigin(cond, move(tp));
     } else {
         core::TypeAndOrigins tp = getTypeAndOrigin(ctx, cond);
         tp.origins.emplace_back(loc);
@@ -534,7 +532,7 @@ void Environment::assumeKnowledge(core::Context ctx, bool isTrue, core::LocalVar
             isDead = true;
             return;
         }
-        setTypeAndOrigin(cond, tp);
+        setTypeAndOrigin(cond, move(tp));
         vars[cond].knownTruthy = true;
     }
 
@@ -545,7 +543,7 @@ void Environment::assumeKnowledge(core::Context ctx, bool isTrue, core::LocalVar
     }
 
     for (auto &typeTested : knowledgeToChoose->yesTypeTests) {
-        if (filter.find(typeTested.first) == filter.end()) {
+        if (!filter.contains(typeTested.first)) {
             continue;
         }
         core::TypeAndOrigins tp = getTypeAndOrigin(ctx, typeTested.first);
@@ -561,15 +559,15 @@ void Environment::assumeKnowledge(core::Context ctx, bool isTrue, core::LocalVar
             }
             if (tp.type->isBottom()) {
                 isDead = true;
-                setTypeAndOrigin(typeTested.first, tp);
+                setTypeAndOrigin(typeTested.first, move(tp));
                 return;
             }
         }
-        setTypeAndOrigin(typeTested.first, tp);
+        setTypeAndOrigin(typeTested.first, move(tp));
     }
 
     for (auto &typeTested : knowledgeToChoose->noTypeTests) {
-        if (filter.find(typeTested.first) == filter.end()) {
+        if (!filter.contains(typeTested.first)) {
             continue;
         }
         core::TypeAndOrigins tp = getTypeAndOrigin(ctx, typeTested.first);
@@ -589,22 +587,17 @@ void Environment::assumeKnowledge(core::Context ctx, bool isTrue, core::LocalVar
 void Environment::mergeWith(core::Context ctx, const Environment &other, core::Loc loc, cfg::CFG &inWhat,
                             cfg::BasicBlock *bb, KnowledgeFilter &knowledgeFilter) {
     this->isDead |= other.isDead;
-    for (auto &pair : vars) {
-        auto var = pair.first;
+    for (auto [var, state] : vars) {
         const auto &otherTO = other.getTypeAndOrigin(ctx, var);
-        auto &thisTO = pair.second.typeAndOrigins;
+        auto &thisTO = state.typeAndOrigins;
         if (thisTO.type.get() != nullptr) {
             thisTO.type = core::Types::any(ctx, thisTO.type, otherTO.type);
             thisTO.type->sanityCheck(ctx);
-            for (auto origin : otherTO.origins) {
-                if (!absl::c_linear_search(thisTO.origins, origin)) {
-                    thisTO.origins.emplace_back(origin);
-                }
-            }
-            pair.second.knownTruthy = pair.second.knownTruthy && other.getKnownTruthy(var);
+            thisTO.origins.addAll(otherTO.origins);
+            state.knownTruthy = state.knownTruthy && other.getKnownTruthy(var);
         } else {
             thisTO = otherTO;
-            pair.second.knownTruthy = other.getKnownTruthy(var);
+            state.knownTruthy = other.getKnownTruthy(var);
         }
 
         if (((bb->flags & cfg::CFG::LOOP_HEADER) != 0) && bb->outerLoops <= inWhat.maxLoopWrite[var]) {
@@ -649,8 +642,7 @@ void Environment::computePins(core::Context ctx, const vector<Environment> &envs
         return;
     }
 
-    for (auto &pair : vars) {
-        auto var = pair.first;
+    for (auto [var, state] : as_const(vars)) {
         core::TypeAndOrigins tp;
 
         auto bindMinLoops = inWhat.minLoops.at(var);
@@ -661,17 +653,13 @@ void Environment::computePins(core::Context ctx, const vector<Environment> &envs
         for (cfg::BasicBlock *parent : bb->backEdges) {
             auto &other = envs[parent->id];
             auto otherPin = other.pinnedTypes.find(var);
-            if (otherPin != other.pinnedTypes.end()) {
+            if (otherPin != nullptr) {
                 if (tp.type != nullptr) {
-                    tp.type = core::Types::any(ctx, tp.type, otherPin->second.type);
-                    for (auto origin : otherPin->second.origins) {
-                        if (!absl::c_linear_search(tp.origins, origin)) {
-                            tp.origins.emplace_back(origin);
-                        }
-                    }
+                    tp.type = core::Types::any(ctx, tp.type, otherPin->type);
+                    tp.origins.addAll(otherPin->origins);
                     tp.type->sanityCheck(ctx);
                 } else {
-                    tp = otherPin->second;
+                    tp = *otherPin;
                 }
             }
         }
@@ -684,11 +672,10 @@ void Environment::computePins(core::Context ctx, const vector<Environment> &envs
 
 void Environment::populateFrom(core::Context ctx, const Environment &other) {
     this->isDead = other.isDead;
-    for (auto &pair : vars) {
-        auto var = pair.first;
-        pair.second.typeAndOrigins = other.getTypeAndOrigin(ctx, var);
-        pair.second.knowledge = other.getKnowledge(var, false);
-        pair.second.knownTruthy = other.getKnownTruthy(var);
+    for (auto [var, state] : vars) {
+        state.typeAndOrigins = other.getTypeAndOrigin(ctx, var);
+        state.knowledge = other.getKnowledge(var, false);
+        state.knownTruthy = other.getKnownTruthy(var);
     }
 
     this->pinnedTypes = other.pinnedTypes;
@@ -744,7 +731,7 @@ core::TypePtr flatmapHack(core::Context ctx, core::TypePtr receiver, core::TypeP
 
 core::TypePtr Environment::processBinding(core::Context ctx, cfg::Binding &bind, int loopCount, int bindMinLoops,
                                           KnowledgeFilter &knowledgeFilter, core::TypeConstraint &constr,
-                                          core::TypePtr &methodReturnType) {
+                                          core::TypePtr &methodReturnType, vector<CallEdge> *callEdges) {
     try {
         core::TypeAndOrigins tp;
         bool noLoopChecking = cfg::isa_instruction<cfg::Alias>(bind.value.get()) ||
@@ -758,7 +745,7 @@ core::TypePtr Environment::processBinding(core::Context ctx, cfg::Binding &bind,
         typecase(
             bind.value.get(),
             [&](cfg::Send *send) {
-                InlinedVector<const core::TypeAndOrigins *, 2> args;
+                core::DispatchArgList args;
 
                 args.reserve(send->args.size());
                 for (cfg::VariableUseSite &arg : send->args) {
@@ -783,6 +770,9 @@ core::TypePtr Environment::processBinding(core::Context ctx, cfg::Binding &bind,
                         ctx.state._error(std::move(err));
                     }
                     lspQueryMatch = lspQueryMatch || lspQuery.matchesSymbol(it->main.method);
+                    if (callEdges != nullptr && it->main.method.exists()) {
+                        callEdges->emplace_back(CallEdge{it->main.method, bind.loc});
+                    }
                     it = it->secondary.get();
                 }
                 shared_ptr<core::DispatchResult> retainedResult;
@@ -1086,8 +1076,7 @@ core::TypePtr Environment::processBinding(core::Context ctx, cfg::Binding &bind,
 
         if (!noLoopChecking && loopCount != bindMinLoops) {
             auto pin = pinnedTypes.find(bind.bind.variable);
-            const core::TypeAndOrigins &cur =
-                (pin != pinnedTypes.end()) ? pin->second : getTypeAndOrigin(ctx, bind.bind.variable);
+            const core::TypeAndOrigins &cur = (pin != nullptr) ? *pin : getTypeAndOrigin(ctx, bind.bind.variable);
 
             bool asGoodAs =
                 core::Types::isSubType(ctx, core::Types::dropLiteral(tp.type), core::Types::dropLiteral(cur.type));
@@ -1202,12 +1191,12 @@ void Environment::cloneFrom(const Environment &rhs) {
 
 const TestedKnowledge &Environment::getKnowledge(core::LocalVariable symbol, bool shouldFail) const {
     auto fnd = vars.find(symbol);
-    if (fnd == vars.end()) {
+    if (fnd == nullptr) {
         ENFORCE(!shouldFail, "Missing knowledge?");
         return TestedKnowledge::empty;
     }
-    fnd->second.knowledge.sanityCheck();
-    return fnd->second.knowledge;
+    fnd->knowledge.sanityCheck();
+    return fnd->knowledge;
 }
 
 core::TypeAndOrigins nilTypesWithOriginWithLoc(core::Loc loc) {
@@ -1220,7 +1209,8 @@ core::TypeAndOrigins nilTypesWithOriginWithLoc(core::Loc loc) {
     return ret;
 }
 
-Environment::Environment(core::Loc ownerLoc) : uninitialized(nilTypesWithOriginWithLoc(ownerLoc)) {}
+Environment::Environment(core::Loc ownerLoc, LocalVariableIds &localIds)
+    : uninitialized(nilTypesWithOriginWithLoc(ownerLoc)), vars(localIds), pinnedTypes(localIds) {}
 
 TestedKnowledge TestedKnowledge::empty;
 } // namespace sorbet::infer
@@ -10,6 +10,7 @@
 #include "core/errors/infer.h"
 #include "core/errors/internal.h"
 #include "core/lsp/QueryResponse.h"
+#include "infer/LocalVariableMap.h"
 #include "inference.h"
 #include <memory>
 #include <utility>
@@ -96,7 +97,7 @@ class Environment {
     const core::TypeAndOrigins uninitialized;
 
 public:
-    Environment(core::Loc ownerLoc);
+    Environment(core::Loc ownerLoc, LocalVariableIds &localIds);
     Environment(const Environment &rhs) = delete;
     Environment(Environment &&rhs) = default;
 
@@ -127,9 +128,9 @@ public:
         TestedKnowledge knowledge;
         bool knownTruthy;
     };
-    UnorderedMap<core::LocalVariable, VariableState> vars;
+    LocalVariableMap<VariableState> vars;
 
-    UnorderedMap<core::LocalVariable, core::TypeAndOrigins> pinnedTypes;
+    LocalVariableMap<core::TypeAndOrigins> pinnedTypes;
 
     std::string toString(core::Context ctx) const;
 
@@ -142,8 +143,15 @@ public:
     const TestedKnowledge &getKnowledge(core::LocalVariable symbol, bool shouldFail = true) const;
     bool getKnownTruthy(core::LocalVariable var) const;
 
+    // Unlike the const overload, this one has to go through `vars.find` so that it doesn't write to shared state.
     TestedKnowledge &getKnowledge(core::LocalVariable symbol, bool shouldFail = true) {
-        return const_cast<TestedKnowledge &>(const_cast<const Environment *>(this)->getKnowledge(symbol, shouldFail));
+        auto fnd = vars.find(symbol);
+        if (fnd == nullptr) {
+            ENFORCE(!shouldFail, "Missing knowledge?");
+            return TestedKnowledge::empty;
+        }
+        fnd->knowledge.sanityCheck();
+        return fnd->knowledge;
     }
 
     /* propagate knowledge on `to = from` */
@@ -157,7 +165,7 @@ public:
     void updateKnowledge(core::Context ctx, core::LocalVariable local, core::Loc loc, const cfg::Send *send,
                          KnowledgeFilter &knowledgeFilter);
 
-    void setTypeAndOrigin(core::LocalVariable symbol, const core::TypeAndOrigins &typeAndOrigins);
+    void setTypeAndOrigin(core::LocalVariable symbol, core::TypeAndOrigins typeAndOrigins);
 
     /*
      * Create an Environment out of this one that holds if final condition in
@@ -169,10 +177,10 @@ public:
      * then discard it, so the mixed lifetimes are not a problem in practice.
      */
     static const Environment &withCond(core::Context ctx, const Environment &env, Environment &copy, bool isTrue,
-                                       const UnorderedMap<core::LocalVariable, VariableState> &filter);
+                                       const LocalVariableMap<VariableState> &filter);
 
     void assumeKnowledge(core::Context ctx, bool isTrue, core::LocalVariable cond, core::Loc loc,
-                         const UnorderedMap<core::LocalVariable, VariableState> &filter);
+                         const LocalVariableMap<VariableState> &filter);
 
     void mergeWith(core::Context ctx, const Environment &other, core::Loc loc, cfg::CFG &inWhat, cfg::BasicBlock *bb,
                    KnowledgeFilter &knowledgeFilter);
@@ -188,7 +196,7 @@ public:
 
     core::TypePtr processBinding(core::Context ctx, cfg::Binding &bind, int loopCount, int bindMinLoops,
                                  KnowledgeFilter &knowledgeFilter, core::TypeConstraint &constr,
-                                 core::TypePtr &methodReturnType);
+                                 core::TypePtr &methodReturnType, std::vector<CallEdge> *callEdges);
 
     void ensureGoodCondition(core::Context ctx, core::LocalVariable cond) {}
     void ensureGoodAssignTarget(core::Context ctx, core::LocalVariable target) {}
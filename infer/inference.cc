@@ -9,12 +9,22 @@
 using namespace std;
 namespace sorbet::infer {
 
-unique_ptr<cfg::CFG> Inference::run(core::Context ctx, unique_ptr<cfg::CFG> cfg) {
+namespace {
+StaticCounter methodsTypechecked("types.input.methods.typechecked");
+StaticCounter methodsWithoutErrors("infer.methods_typechecked.no_errors");
+StaticCounter typedSends("types.input.sends.typed");
+StaticCounter totalSends("types.input.sends.total");
+} // namespace
+
+unique_ptr<cfg::CFG> Inference::run(core::Context ctx, unique_ptr<cfg::CFG> cfg, vector<CallEdge> *callEdges) {
     ENFORCE(cfg->symbol == ctx.owner);
     auto methodLoc = cfg->symbol.data(ctx)->loc();
-    prodCounterInc("types.input.methods.typechecked");
+    methodsTypechecked.inc();
     int typedSendCount = 0;
     int totalSendCount = 0;
+    // Every binding is processed at most once: blocks are visited once, in topological order, and loops are handled
+    // by pinning the types of the variables they write (see Environment::computePins) rather than by iterating.
+    int processedBindingCount = 0;
     const int startErrorCount = ctx.state.totalErrors();
     auto guessTypes = true;
     unique_ptr<core::TypeConstraint> _constr;
@@ -65,10 +75,11 @@ unique_ptr<cfg::CFG> Inference::run(core::Context ctx, unique_ptr<cfg::CFG> cfg)
         methodReturnType = core::Types::replaceSelfType(ctx, methodReturnType, enclosingClass.data(ctx)->selfType(ctx));
     }
 
+    LocalVariableIds localIds(*cfg);
     vector<Environment> outEnvironments;
     outEnvironments.reserve(cfg->maxBasicBlockId);
     for (int i = 0; i < cfg->maxBasicBlockId; i++) {
-        outEnvironments.emplace_back(methodLoc);
+        outEnvironments.emplace_back(methodLoc, localIds);
     }
     for (int i = 0; i < cfg->basicBlocks.size(); i++) {
         outEnvironments[cfg->forwardsTopoSort[i]->id].bb = cfg->forwardsTopoSort[i];
@@ -96,7 +107,7 @@ unique_ptr<cfg::CFG> Inference::run(core::Context ctx, unique_ptr<cfg::CFG> cfg)
             auto *parent = bb->backEdges[0];
             bool isTrueBranch = parent->bexit.thenb == bb;
             if (!outEnvironments[parent->id].isDead) {
-                Environment tempEnv(methodLoc);
+                Environment tempEnv(methodLoc, localIds);
                 auto &envAsSeenFromBranch =
                     Environment::withCond(ctx, outEnvironments[parent->id], tempEnv, isTrueBranch, current.vars);
                 current.populateFrom(ctx, envAsSeenFromBranch);
@@ -110,7 +121,7 @@ unique_ptr<cfg::CFG> Inference::run(core::Context ctx, unique_ptr<cfg::CFG> cfg)
                     continue;
                 }
                 bool isTrueBranch = parent->bexit.thenb == bb;
-                Environment tempEnv(methodLoc);
+                Environment tempEnv(methodLoc, localIds);
                 auto &envAsSeenFromBranch =
                     Environment::withCond(ctx, outEnvironments[parent->id], tempEnv, isTrueBranch, current.vars);
                 if (!envAsSeenFromBranch.isDead) {
@@ -122,12 +133,12 @@ unique_ptr<cfg::CFG> Inference::run(core::Context ctx, unique_ptr<cfg::CFG> cfg)
 
         current.computePins(ctx, outEnvironments, *cfg.get(), bb);
 
-        for (auto &uninitialized : current.vars) {
-            if (uninitialized.second.typeAndOrigins.type.get() == nullptr) {
-                uninitialized.second.typeAndOrigins.type = core::Types::nilClass();
-                uninitialized.second.typeAndOrigins.origins.emplace_back(cfg->symbol.data(ctx)->loc());
+        for (auto [var, state] : current.vars) {
+            if (state.typeAndOrigins.type.get() == nullptr) {
+                state.typeAndOrigins.type = core::Types::nilClass();
+                state.typeAndOrigins.origins.emplace_back(cfg->symbol.data(ctx)->loc());
             } else {
-                uninitialized.second.typeAndOrigins.type->sanityCheck(ctx);
+                state.typeAndOrigins.type->sanityCheck(ctx);
             }
         }
 
@@ -162,8 +173,9 @@ unique_ptr<cfg::CFG> Inference::run(core::Context ctx, unique_ptr<cfg::CFG> cfg)
             i++;
             if (!current.isDead) {
                 current.ensureGoodAssignTarget(ctx, bind.bind.variable);
+                processedBindingCount++;
                 bind.bind.type = current.processBinding(ctx, bind, bb->outerLoops, cfg->minLoops[bind.bind.variable],
-                                                        knowledgeFilter, *constr, methodReturnType);
+                                                        knowledgeFilter, *constr, methodReturnType, callEdges);
                 if (cfg::isa_instruction<cfg::Send>(bind.value.get())) {
                     totalSendCount++;
                     if (bind.bind.type && !bind.bind.type->isUntyped()) {
@@ -201,8 +213,8 @@ unique_ptr<cfg::CFG> Inference::run(core::Context ctx, unique_ptr<cfg::CFG> cfg)
             ENFORCE(bb->firstDeadInstructionIdx != -1);
         }
         histogramInc("infer.environment.size", current.vars.size());
-        for (auto &pair : current.vars) {
-            auto &k = pair.second.knowledge;
+        for (auto [var, state] : as_const(current.vars)) {
+            auto &k = state.knowledge;
             histogramInc("infer.knowledge.truthy.yes.size", k.truthy->yesTypeTests.size());
             histogramInc("infer.knowledge.truthy.no.size", k.truthy->noTypeTests.size());
             histogramInc("infer.knowledge.falsy.yes.size", k.falsy->yesTypeTests.size());
@@ -210,7 +222,7 @@ unique_ptr<cfg::CFG> Inference::run(core::Context ctx, unique_ptr<cfg::CFG> cfg)
         }
     }
     if (startErrorCount == ctx.state.totalErrors()) {
-        counterInc("infer.methods_typechecked.no_errors");
+        methodsWithoutErrors.inc();
     }
 
     if ((missingReturnType || cfg->symbol.data(ctx)->hasGeneratedSig()) && guessTypes) {
@@ -220,8 +232,9 @@ unique_ptr<cfg::CFG> Inference::run(core::Context ctx, unique_ptr<cfg::CFG> cfg)
         }
     }
 
-    prodCounterAdd("types.input.sends.typed", typedSendCount);
-    prodCounterAdd("types.input.sends.total", totalSendCount);
+    typedSends.add(typedSendCount);
+    totalSends.add(totalSendCount);
+    histogramInc("infer.bindings_processed", processedBindingCount);
 
     return cfg;
 }
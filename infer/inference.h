@@ -4,11 +4,21 @@
 #include "cfg/CFG.h"
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace sorbet::infer {
+// A call, from the method being inferred, that dispatched to `callee`.
+struct CallEdge {
+    core::SymbolRef callee;
+    core::Loc loc;
+};
+
 class Inference final {
 public:
-    static std::unique_ptr<cfg::CFG> run(core::Context ctx, std::unique_ptr<cfg::CFG> cfg);
+    // If `callEdges` is given, an edge is appended to it for every method a call dispatches to. A call on a union
+    // dispatches to one method per component; one on an untyped receiver, to none.
+    static std::unique_ptr<cfg::CFG> run(core::Context ctx, std::unique_ptr<cfg::CFG> cfg,
+                                         std::vector<CallEdge> *callEdges = nullptr);
 };
 } // namespace sorbet::infer
 
@@ -1,9 +1,11 @@
 #include "local_vars.h"
 #include "absl/strings/match.h"
 #include "ast/treemap/treemap.h"
+#include "ast/verifier/verifier.h"
 #include "common/typecase.h"
 #include "core/core.h"
 #include "core/errors/namer.h"
+#include "dsl/dsl.h"
 
 using namespace std;
 
@@ -17,6 +19,8 @@ class LocalNameInserter {
         core::LocalVariable local;
         core::Loc loc;
         unique_ptr<ast::Reference> expr;
+        // Whether the argument was named by an earlier walk over the same tree.
+        bool wasNamed = false;
     };
 
     // Map through the reference structure, naming the locals, and preserving
@@ -57,6 +61,7 @@ class LocalNameInserter {
                 named.local = enterLocal(named.name);
                 named.loc = arg->loc;
                 named.expr = make_unique<ast::Local>(local->loc, named.local);
+                named.wasNamed = true;
             });
 
         return named;
@@ -73,7 +78,9 @@ class LocalNameInserter {
             unique_ptr<ast::Reference> refExpImpl(refExp);
             arg.release();
             auto named = nameArg(move(refExpImpl));
-            if (nameSet.contains(named.name) && !absl::StartsWith(named.name.data(ctx)->shortName(ctx), "_")) {
+            // Names given again are only checked by the walk that gave them first.
+            if (nameSet.contains(named.name) && !(fixingUp && named.wasNamed) &&
+                !absl::StartsWith(named.name.data(ctx)->shortName(ctx), "_")) {
                 if (auto e = ctx.state.beginError(named.loc, core::errors::Namer::RepeatedArgument)) {
                     ENFORCE(!scopeStack.empty());
                     auto frame = scopeStack.back();
@@ -101,6 +108,9 @@ class LocalNameInserter {
         u4 localId = 0;
         bool insideBlock = false;
         bool insideMethod = false;
+        // Whether a `super` outside of a method was left for `postTransformClassDef` to look at again, because a DSL
+        // might move it into one.
+        bool hasZSuperOutsideMethod = false;
     };
 
     LocalFrame &pushBlockFrame(core::Loc loc, bool insideMethod) {
@@ -145,6 +155,10 @@ class LocalNameInserter {
     }
 
     vector<LocalFrame> scopeStack;
+    // Whether classes are rewritten by the DSL passes as they are left. The rewrites leave the statements they make for
+    // this walk to name, which it does by walking them again with `fixingUp` set.
+    const bool withDSL;
+    bool fixingUp = false;
     // The purpose of this counter is to ensure that every block within a method/class has a unique scope id.
     // For example, a possible assignment of ids is the following:
     //
@@ -200,6 +214,23 @@ public:
     }
 
     unique_ptr<ast::Expression> postTransformClassDef(core::MutableContext ctx, unique_ptr<ast::ClassDef> klass) {
+        if (withDSL && !fixingUp) {
+            UnorderedSet<ast::Expression *> named;
+            for (auto &stat : klass->rhs) {
+                named.insert(stat.get());
+            }
+            dsl::DSL::patchClassDef(ctx, klass.get());
+
+            // Names in statements that were moved into new ones are named again, where they are now.
+            auto all = scopeStack.back().hasZSuperOutsideMethod;
+            fixingUp = true;
+            for (auto &stat : klass->rhs) {
+                if (all || !named.contains(stat.get())) {
+                    stat = ast::TreeMap::apply(ctx, *this, move(stat));
+                }
+            }
+            fixingUp = false;
+        }
         exitScope();
         return klass;
     }
@@ -218,18 +249,29 @@ public:
 
     unique_ptr<ast::Expression> postTransformSend(core::MutableContext ctx, unique_ptr<ast::Send> original) {
         if (original->args.size() == 1 && ast::isa_tree<ast::ZSuperArgs>(original->args[0].get())) {
-            original->args.clear();
             if (scopeStack.back().insideMethod) {
+                original->args.clear();
                 for (auto arg : scopeStack.back().args) {
                     original->args.emplace_back(make_unique<ast::Local>(original->loc, arg));
                 }
+            } else if (withDSL && !fixingUp) {
+                // Blocks outside of methods are only ever in classes, and the class is the nearest frame that isn't
+                // a block.
+                auto classFrame = find_if(scopeStack.rbegin(), scopeStack.rend(),
+                                          [](const auto &frame) { return !frame.insideBlock; });
+                ENFORCE(classFrame != scopeStack.rend());
+                classFrame->hasZSuperOutsideMethod = true;
             } else {
+                original->args.clear();
                 if (auto e = ctx.state.beginError(original->loc, core::errors::Namer::SelfOutsideClass)) {
                     e.setHeader("`{}` outside of method", "super");
                 }
             }
         }
 
+        if (withDSL && !fixingUp) {
+            return dsl::DSL::patchSend(ctx, move(original));
+        }
         return original;
     }
 
@@ -259,29 +301,46 @@ public:
     unique_ptr<ast::Expression> postTransformUnresolvedIdent(core::MutableContext ctx,
                                                              unique_ptr<ast::UnresolvedIdent> nm) {
         if (nm->kind == ast::UnresolvedIdent::Local) {
-            auto &frame = scopeStack.back();
-            core::LocalVariable &cur = frame.locals[nm->name];
-            if (!cur.exists()) {
-                cur = enterLocal(nm->name);
-                frame.locals[nm->name] = cur;
-            }
-            return make_unique<ast::Local>(nm->loc, cur);
+            return make_unique<ast::Local>(nm->loc, lookupLocal(nm->name));
         } else {
             return nm;
         }
     }
 
+    unique_ptr<ast::Expression> postTransformLocal(core::MutableContext ctx, unique_ptr<ast::Local> local) {
+        if (fixingUp && local->localVariable != core::LocalVariable::selfVariable()) {
+            local->localVariable = lookupLocal(local->localVariable._name);
+        }
+        return local;
+    }
+
 private:
-    LocalNameInserter() {
+    LocalNameInserter(bool withDSL) : withDSL(withDSL) {
         // Setup a block frame that's outside of a method context as the base of
         // the scope stack.
         pushBlockFrame(core::Loc::none(), false);
     }
+
+    core::LocalVariable lookupLocal(core::NameRef name) {
+        auto &frame = scopeStack.back();
+        core::LocalVariable &cur = frame.locals[name];
+        if (!cur.exists()) {
+            cur = enterLocal(name);
+        }
+        return cur;
+    }
 };
 
 ast::ParsedFile LocalVars::run(core::MutableContext ctx, ast::ParsedFile tree) {
-    LocalNameInserter localNameInserter;
+    LocalNameInserter localNameInserter(false);
+    tree.tree = ast::TreeMap::apply(ctx, localNameInserter, move(tree.tree));
+    return tree;
+}
+
+ast::ParsedFile LocalVars::runWithDSL(core::MutableContext ctx, ast::ParsedFile tree) {
+    LocalNameInserter localNameInserter(true);
     tree.tree = ast::TreeMap::apply(ctx, localNameInserter, move(tree.tree));
+    tree.tree = ast::Verifier::run(ctx, move(tree.tree));
     return tree;
 }
 
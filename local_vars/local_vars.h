@@ -8,6 +8,8 @@ namespace sorbet::local_vars {
 class LocalVars final {
 public:
     static ast::ParsedFile run(core::MutableContext ctx, ast::ParsedFile tree);
+    // Like `dsl::DSL::run` followed by `run`, in one walk over the tree.
+    static ast::ParsedFile runWithDSL(core::MutableContext ctx, ast::ParsedFile tree);
 
     LocalVars() = delete;
 };
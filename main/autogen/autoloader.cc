@@ -328,6 +328,30 @@ DefTree DefTreeBuilder::merge(core::Context ctx, DefTree lhs, DefTree rhs) {
     return lhs;
 }
 
+DefTree DefTreeBuilder::merge(core::Context ctx, WorkerPool &workers, vector<DefTree> trees) {
+    if (trees.empty()) {
+        return DefTree();
+    }
+    return mergeRange(ctx, workers, trees, 0, trees.size());
+}
+
+DefTree DefTreeBuilder::mergeRange(core::Context ctx, WorkerPool &workers, vector<DefTree> &trees, int begin,
+                                   int end) {
+    if (end - begin == 1) {
+        return move(trees[begin]);
+    }
+    // Each merge costs O(size of its right-hand side), so a balanced tree of them does the same total work as
+    // merging the trees one at a time into an ever larger one, but in log(trees.size()) sequential steps.
+    int mid = begin + (end - begin) / 2;
+    DefTree lhs;
+    WorkerPool::TaskGroup group;
+    workers.submit(group,
+                   [ctx, &workers, &trees, &lhs, begin, mid]() { lhs = mergeRange(ctx, workers, trees, begin, mid); });
+    auto rhs = mergeRange(ctx, workers, trees, mid, end);
+    workers.wait(group);
+    return merge(ctx, move(lhs), move(rhs));
+}
+
 void DefTreeBuilder::updateNonBehaviorDef(core::Context ctx, DefTree &node, NamedDefinition ndef) {
     if (!node.namedDefs.empty()) {
         // Non behavior-defining definitions do not matter for nodes that have behavior. There is no
@@ -358,32 +382,98 @@ void DefTreeBuilder::collapseSameFileDefs(core::Context ctx, const AutoloaderCon
     }
 }
 
-void AutoloadWriter::writeAutoloads(core::Context ctx, const AutoloaderConfig &alCfg, const std::string &path,
-                                    const DefTree &root) {
+void DefTreeBuilder::collapseSameFileDefs(core::Context ctx, const AutoloaderConfig &alCfg, WorkerPool &workers,
+                                          DefTree &root) {
+    core::FileRef definingFile;
+    if (!root.namedDefs.empty()) {
+        definingFile = root.file();
+    }
+    if (!alCfg.sameFileCollapsable(root.nameParts)) {
+        return;
+    }
+
+    vector<core::NameRef> names;
+    names.reserve(root.children.size());
+    for (auto &[name, _] : root.children) {
+        names.emplace_back(name);
+    }
+    // Children are only erased once all tasks are done, since erasing would move the others around.
+    vector<char> collapse(names.size());
+    {
+        WorkerPool::TaskGroup group;
+        for (int i = 0; i < names.size(); i++) {
+            auto &child = *root.children[names[i]];
+            workers.submit(group, [ctx, &alCfg, &child, &collapse, definingFile, i]() {
+                if (child.hasDifferentFile(definingFile)) {
+                    collapseSameFileDefs(ctx, alCfg, child);
+                } else {
+                    collapse[i] = true;
+                }
+            });
+        }
+        workers.wait(group);
+    }
+    for (int i = 0; i < names.size(); i++) {
+        if (collapse[i]) {
+            root.children.erase(names[i]);
+        }
+    }
+}
+
+void AutoloadWriter::writeAutoloads(core::Context ctx, const AutoloaderConfig &alCfg, WorkerPool &workers,
+                                    const std::string &path, const DefTree &root) {
     UnorderedSet<string> toDelete; // Remove from this set as we write files
     if (FileOps::exists(path)) {
         vector<string> existingFiles = FileOps::listFilesInDir(path, {".rb"}, true, {}, {});
         toDelete.insert(make_move_iterator(existingFiles.begin()), make_move_iterator(existingFiles.end()));
     }
-    write(ctx, alCfg, path, toDelete, root);
+
+    // The root's children write to disjoint subdirectories, so each gets its own task and list of written files.
+    vector<const DefTree *> children;
+    children.reserve(root.children.size());
+    for (auto &[_, child] : root.children) {
+        children.emplace_back(child.get());
+    }
+    vector<vector<string>> written(children.size() + 1);
+    writeNode(ctx, alCfg, path, written.back(), root);
+    {
+        WorkerPool::TaskGroup group;
+        for (int i = 0; i < children.size(); i++) {
+            workers.submit(group, [ctx, &alCfg, &path, &children, &written, i]() {
+                write(ctx, alCfg, path, written[i], *children[i]);
+            });
+        }
+        workers.wait(group);
+    }
+
+    for (auto &files : written) {
+        for (auto &file : files) {
+            toDelete.erase(file);
+        }
+    }
     for (const auto &file : toDelete) {
         FileOps::removeFile(file);
     }
 }
 
-void AutoloadWriter::write(core::Context ctx, const AutoloaderConfig &alCfg, const std::string &path,
-                           UnorderedSet<std::string> &toDelete, const DefTree &node) {
+void AutoloadWriter::writeNode(core::Context ctx, const AutoloaderConfig &alCfg, const std::string &path,
+                               vector<string> &written, const DefTree &node) {
     string name = node.root() ? "root" : node.name().show(ctx);
     string filePath = join(path, fmt::format("{}.rb", name));
     FileOps::writeIfDifferent(filePath, node.renderAutoloadSrc(ctx, alCfg));
-    toDelete.erase(filePath);
+    written.emplace_back(move(filePath));
+}
+
+void AutoloadWriter::write(core::Context ctx, const AutoloaderConfig &alCfg, const std::string &path,
+                           vector<string> &written, const DefTree &node) {
+    writeNode(ctx, alCfg, path, written, node);
     if (!node.children.empty()) {
-        auto subdir = join(path, node.root() ? "" : name);
+        auto subdir = join(path, node.root() ? "" : node.name().show(ctx));
         if (!node.root() && !FileOps::dirExists(subdir)) {
             FileOps::createDir(subdir);
         }
         for (auto &[_, child] : node.children) {
-            write(ctx, alCfg, subdir, toDelete, *child);
+            write(ctx, alCfg, subdir, written, *child);
         }
     }
 }
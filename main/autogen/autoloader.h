@@ -1,6 +1,7 @@
 #ifndef AUTOGEN_AUTOLOADER_H
 #define AUTOGEN_AUTOLOADER_H
 #include "ast/ast.h"
+#include "common/concurrency/WorkerPool.h"
 #include "main/autogen/autogen.h"
 #include "main/options/options.h"
 #include <string_view>
@@ -101,20 +102,29 @@ public:
     static void addSingleDef(core::Context, const AutoloaderConfig &, std::unique_ptr<DefTree> &root, NamedDefinition);
 
     static DefTree merge(core::Context, DefTree lhs, DefTree rhs);
+    // Merges all of `trees` pairwise, as a balanced tree of merges whose independent halves run in parallel.
+    static DefTree merge(core::Context, WorkerPool &workers, std::vector<DefTree> trees);
     static void collapseSameFileDefs(core::Context, const AutoloaderConfig &, DefTree &root);
+    // Like the above, collapsing each of the root's children on a separate task.
+    static void collapseSameFileDefs(core::Context, const AutoloaderConfig &, WorkerPool &workers, DefTree &root);
 
 private:
     static void updateNonBehaviorDef(core::Context, DefTree &node, NamedDefinition ndef);
+    static DefTree mergeRange(core::Context, WorkerPool &workers, std::vector<DefTree> &trees, int begin, int end);
 };
 
 class AutoloadWriter {
 public:
-    static void writeAutoloads(core::Context ctx, const AutoloaderConfig &, const std::string &path,
-                               const DefTree &root);
+    // Writes the files for each of the root's children, i.e. each top-level namespace, on a separate task.
+    static void writeAutoloads(core::Context ctx, const AutoloaderConfig &, WorkerPool &workers,
+                               const std::string &path, const DefTree &root);
 
 private:
+    // Writes the files for `node` and everything under it, recording their paths in `written`.
     static void write(core::Context ctx, const AutoloaderConfig &, const std::string &path,
-                      UnorderedSet<std::string> &toDelete, const DefTree &node);
+                      std::vector<std::string> &written, const DefTree &node);
+    static void writeNode(core::Context ctx, const AutoloaderConfig &, const std::string &path,
+                          std::vector<std::string> &written, const DefTree &node);
 };
 
 } // namespace sorbet::autogen
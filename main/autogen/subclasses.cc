@@ -1,4 +1,5 @@
 #include "main/autogen/subclasses.h"
+#include "common/BitSet.h"
 #include "common/FileOps.h"
 
 using namespace std;
@@ -66,27 +67,6 @@ optional<Subclasses::Map> Subclasses::listAllSubclasses(core::Context ctx, Parse
     return out;
 }
 
-// Generate all descendants of a parent class
-// Recursively walks `childMap`, which stores the IMMEDIATE children of subclassed class.
-optional<Subclasses::Entries> Subclasses::descendantsOf(const Subclasses::Map &childMap, const string &parentName) {
-    auto fnd = childMap.find(parentName);
-    if (fnd == childMap.end()) {
-        return nullopt;
-    }
-    const Subclasses::Entries children = fnd->second;
-
-    Subclasses::Entries out;
-    out.insert(children.begin(), children.end());
-    for (const auto &[name, _type] : children) {
-        auto descendants = Subclasses::descendantsOf(childMap, name);
-        if (descendants) {
-            out.insert(descendants->begin(), descendants->end());
-        }
-    }
-
-    return out;
-}
-
 // Manually patch the child map to account for inheritance that happens at runtime `self.included`
 // Please do not add to this list.
 void Subclasses::patchChildMap(Subclasses::Map &childMap) {
@@ -94,36 +74,6 @@ void Subclasses::patchChildMap(Subclasses::Map &childMap) {
                                          childMap["Opus::Risk::Model::Mixins::RiskSafeMachine"].end());
 }
 
-vector<string> Subclasses::serializeSubclassMap(const Subclasses::Map &descendantsMap,
-                                                const vector<string> &parentNames) {
-    vector<string> descendantsMapSerialized;
-
-    for (const string &parentName : parentNames) {
-        auto fnd = descendantsMap.find(parentName);
-        if (fnd == descendantsMap.end()) {
-            continue;
-        }
-        const Subclasses::Entries children = fnd->second;
-
-        descendantsMapSerialized.emplace_back(parentName);
-
-        vector<string> serializedChildren;
-        for (const auto &[name, type] : children) {
-            // Ignore Modules
-            if (type != autogen::Definition::Type::Class) {
-                continue;
-            }
-            serializedChildren.emplace_back(fmt::format(" {}", name));
-        }
-
-        fast_sort(serializedChildren);
-        descendantsMapSerialized.insert(descendantsMapSerialized.end(), make_move_iterator(serializedChildren.begin()),
-                                        make_move_iterator(serializedChildren.end()));
-    }
-
-    return descendantsMapSerialized;
-}
-
 // Generate a list of strings representing the descendants of a given list of parent classes
 //
 // e.g.
@@ -138,26 +88,70 @@ vector<string> Subclasses::serializeSubclassMap(const Subclasses::Map &descendan
 vector<string> Subclasses::genDescendantsMap(Subclasses::Map &childMap, vector<string> &parentNames) {
     Subclasses::patchChildMap(childMap);
 
+    // Number every class that has children and every child entry, so that the closure below works on integers and
+    // visits each class at most once per parent, however many paths lead to it.
+    UnorderedMap<string_view, int> classIds;
+    vector<vector<int>> childEntries;
+    vector<const Entry *> entries;
+    vector<int> entryClassIds;
+    classIds.reserve(childMap.size());
+    for (const auto &[parentName, _] : childMap) {
+        classIds.emplace(parentName, classIds.size());
+    }
+    childEntries.resize(classIds.size());
+    for (const auto &[parentName, children] : childMap) {
+        auto &parentEntries = childEntries[classIds[parentName]];
+        for (const auto &entry : children) {
+            auto fnd = classIds.find(entry.first);
+            parentEntries.emplace_back(entries.size());
+            entries.emplace_back(&entry);
+            entryClassIds.emplace_back(fnd == classIds.end() ? -1 : fnd->second);
+        }
+    }
+
     // Generate descendants for each passed-in superclass
     fast_sort(parentNames);
-    Subclasses::Map descendantsMap;
+    vector<string> descendantsMapSerialized;
+    vector<int> stack;
     for (const string &parentName : parentNames) {
         // Skip parents that the user asked for but which don't
         // exist or are never subclassed.
-        auto fnd = childMap.find(parentName);
-        if (fnd == childMap.end()) {
+        auto fnd = classIds.find(parentName);
+        if (fnd == classIds.end()) {
             continue;
         }
 
-        auto descendants = Subclasses::descendantsOf(childMap, parentName);
-        if (!descendants) {
-            descendantsMap[parentName];
+        BitSet visited(classIds.size());
+        BitSet descendants(entries.size());
+        visited.add(fnd->second);
+        stack.emplace_back(fnd->second);
+        while (!stack.empty()) {
+            auto classId = stack.back();
+            stack.pop_back();
+            for (auto entryId : childEntries[classId]) {
+                descendants.add(entryId);
+                auto childClassId = entryClassIds[entryId];
+                if (childClassId >= 0 && visited.add(childClassId)) {
+                    stack.emplace_back(childClassId);
+                }
+            }
         }
 
-        descendantsMap.emplace(parentName, *descendants);
+        descendantsMapSerialized.emplace_back(parentName);
+        vector<string> serializedChildren;
+        descendants.forEach([&](int entryId) {
+            const auto &[name, type] = *entries[entryId];
+            // Ignore Modules
+            if (type == autogen::Definition::Type::Class) {
+                serializedChildren.emplace_back(fmt::format(" {}", name));
+            }
+        });
+        fast_sort(serializedChildren);
+        descendantsMapSerialized.insert(descendantsMapSerialized.end(), make_move_iterator(serializedChildren.begin()),
+                                        make_move_iterator(serializedChildren.end()));
     }
 
-    return Subclasses::serializeSubclassMap(descendantsMap, parentNames);
+    return descendantsMapSerialized;
 };
 
 } // namespace sorbet::autogen
@@ -20,9 +20,6 @@ private:
     static void patchChildMap(Subclasses::Map &childMap);
     static bool isFileIgnored(const std::string &path, const std::vector<std::string> &absoluteIgnorePatterns,
                               const std::vector<std::string> &relativeIgnorePatterns);
-    static std::optional<Entries> descendantsOf(const Subclasses::Map &childMap, const std::string &parents);
-    static std::vector<std::string> serializeSubclassMap(const Subclasses::Map &descendantsMap,
-                                                         const std::vector<std::string> &parentNames);
 };
 
 } // namespace sorbet::autogen
@@ -0,0 +1,145 @@
+#include "main/embed/embed.h"
+#include "common/Counters.h"
+#include "common/concurrency/WorkerPool.h"
+#include "common/kvstore/KeyValueStore.h"
+#include "core/Error.h"
+#include "core/ErrorQueue.h"
+#include "core/Unfreeze.h"
+#include "main/embed/sorbet_embed.h"
+#include "main/pipeline/pipeline.h"
+#include "payload/payload.h"
+#include "spdlog/sinks/null_sink.h"
+
+using namespace std;
+
+namespace sorbet::realmain::embed {
+namespace {
+Position toPosition(const core::GlobalState &gs, core::Loc loc) {
+    Position position;
+    if (!loc.file().exists()) {
+        return position;
+    }
+    position.path = string(loc.file().data(gs).path());
+    if (loc.exists()) {
+        auto [begin, end] = loc.position(gs);
+        position.line = begin.line;
+        position.column = begin.column;
+        position.endLine = end.line;
+        position.endColumn = end.column;
+    }
+    return position;
+}
+
+Error toError(const core::GlobalState &gs, const core::Error &error) {
+    Error result{error.what.code, toPosition(gs, error.loc), error.header, {}, error.toString(gs)};
+    for (auto &section : error.sections) {
+        auto &resultSection = result.sections.emplace_back();
+        resultSection.header = section.header;
+        for (auto &line : section.messages) {
+            resultSection.lines.push_back(ErrorLine{toPosition(gs, line.loc), line.formattedMessage});
+        }
+    }
+    return result;
+}
+} // namespace
+
+Typechecker::Typechecker(options::Options opts, string_view statePayload)
+    : logger(make_shared<spdlog::logger>("embed", make_shared<spdlog::sinks::null_sink_mt>())), opts(move(opts)) {
+    auto errorQueue = make_shared<core::ErrorQueue>(*logger, *logger);
+    if (statePayload.empty() && !this->opts.noStdlib) {
+        initialGS = payload::copyPayloadGlobalState(move(errorQueue));
+    } else {
+        initialGS = make_unique<core::GlobalState>(move(errorQueue));
+        unique_ptr<KeyValueStore> kvstore;
+        payload::createInitialGlobalState(initialGS, this->opts, kvstore, nullptr, statePayload);
+    }
+}
+
+Typechecker::~Typechecker() = default;
+
+vector<Error> Typechecker::typecheck(const vector<File> &files) const {
+    // Every call gets its own error queue, so that calls on different threads don't see each other's errors, and the
+    // queue belongs to the thread that drains it.
+    auto gs = initialGS->deepCopy();
+    gs->errorQueue = make_shared<core::ErrorQueue>(*logger, *logger);
+    gs->errorQueue->ignoreFlushes = true;
+    auto workers = WorkerPool::create(0, *logger);
+    unique_ptr<KeyValueStore> kvstore;
+
+    vector<core::FileRef> inputFiles;
+    {
+        core::UnfreezeFileTable fileTableAccess(*gs);
+        for (auto &file : files) {
+            auto fref = gs->enterFile(file.path, file.source);
+            fref.data(*gs).strictLevel = pipeline::decideStrictLevel(*gs, fref, opts);
+            inputFiles.emplace_back(fref);
+        }
+    }
+
+    auto indexed = pipeline::index(gs, inputFiles, opts, *workers, kvstore);
+    indexed = pipeline::resolve(gs, move(indexed), opts, *workers, kvstore);
+    indexed = pipeline::typecheck(gs, move(indexed), opts, *workers, kvstore);
+
+    vector<Error> result;
+    for (auto &error : gs->errorQueue->drainAllErrors()) {
+        if (!error->isSilenced) {
+            result.emplace_back(toError(*gs, *error));
+        }
+    }
+    // Nothing reads the counters the pipeline collected, so don't let them pile up across calls.
+    getAndClearThreadCounters();
+    return result;
+}
+
+} // namespace sorbet::realmain::embed
+
+using namespace sorbet::realmain::embed;
+
+struct sorbet_typechecker {
+    Typechecker typechecker;
+};
+
+struct sorbet_errors {
+    vector<Error> errors;
+};
+
+sorbet_typechecker *sorbet_typechecker_new(void) {
+    try {
+        return new sorbet_typechecker{};
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void sorbet_typechecker_free(sorbet_typechecker *typechecker) {
+    delete typechecker;
+}
+
+sorbet_errors *sorbet_typecheck(const sorbet_typechecker *typechecker, const char *const *paths,
+                                const char *const *sources, size_t count) {
+    vector<File> files;
+    files.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        files.push_back(File{paths[i], sources[i]});
+    }
+    return new sorbet_errors{typechecker->typechecker.typecheck(files)};
+}
+
+size_t sorbet_errors_count(const sorbet_errors *errors) {
+    return errors->errors.size();
+}
+
+sorbet_error sorbet_errors_get(const sorbet_errors *errors, size_t i) {
+    auto &error = errors->errors[i];
+    return sorbet_error{error.code,
+                        error.position.path.c_str(),
+                        error.position.line,
+                        error.position.column,
+                        error.position.endLine,
+                        error.position.endColumn,
+                        error.header.c_str()};
+}
+
+void sorbet_errors_free(sorbet_errors *errors) {
+    delete errors;
+}
@@ -0,0 +1,73 @@
+#ifndef SORBET_MAIN_EMBED_H
+#define SORBET_MAIN_EMBED_H
+
+#include "core/GlobalState.h"
+#include "main/options/options.h"
+#include "spdlog/spdlog.h"
+
+namespace sorbet::realmain::embed {
+
+// A part of a file an error points at. Lines and columns start at 1, like in the errors Sorbet prints.
+struct Position {
+    std::string path;
+    u4 line = 0;
+    u4 column = 0;
+    u4 endLine = 0;
+    u4 endColumn = 0;
+};
+
+struct ErrorLine {
+    Position position;
+    std::string message;
+};
+
+struct ErrorSection {
+    std::string header;
+    std::vector<ErrorLine> lines;
+};
+
+struct Error {
+    int code;
+    Position position;
+    std::string header;
+    std::vector<ErrorSection> sections;
+    // The error as Sorbet would print it, with the source it points at.
+    std::string text;
+};
+
+struct File {
+    std::string path;
+    std::string source;
+};
+
+/**
+ * Typechecks files in process, for tools that embed Sorbet rather than run it.
+ *
+ * The payload is loaded once, when the Typechecker is made, and every call to `typecheck` starts from a copy of the
+ * state it left, so that a call only pays for the files it's given. Nothing is logged: errors are returned instead of
+ * printed, and the logger every state uses discards what it's given.
+ *
+ * `typecheck` doesn't change the Typechecker, so several threads can call it at once. Each call typechecks its files
+ * on the calling thread.
+ */
+class Typechecker {
+    std::shared_ptr<spdlog::logger> logger;
+    options::Options opts;
+    std::unique_ptr<core::GlobalState> initialGS;
+
+public:
+    // If `statePayload` isn't empty, it is a state stored with `--store-state`, which is loaded in place of the
+    // payload built into the library.
+    Typechecker(options::Options opts = {}, std::string_view statePayload = "");
+    ~Typechecker();
+    Typechecker(const Typechecker &) = delete;
+    Typechecker &operator=(const Typechecker &) = delete;
+
+    // Returns the errors typechecking `files` together reports, in the order they were reported. Each file is
+    // checked at the strictness its sigil asks for, unless the Typechecker's options override it.
+    std::vector<Error> typecheck(const std::vector<File> &files) const;
+};
+
+} // namespace sorbet::realmain::embed
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef SORBET_MAIN_EMBED_C_H
+#define SORBET_MAIN_EMBED_C_H
+
+#include <stddef.h>
+
+// A C interface to `sorbet::realmain::embed::Typechecker`, for callers that can't use C++ (like Ruby extensions).
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sorbet_typechecker sorbet_typechecker;
+typedef struct sorbet_errors sorbet_errors;
+
+typedef struct {
+    int code;
+    const char *path;
+    unsigned int line;
+    unsigned int column;
+    unsigned int end_line;
+    unsigned int end_column;
+    const char *header;
+} sorbet_error;
+
+// Loads the payload built into the library. Returns NULL if that failed.
+sorbet_typechecker *sorbet_typechecker_new(void);
+void sorbet_typechecker_free(sorbet_typechecker *typechecker);
+
+// Typechecks the `count` files named by `paths`, with the contents in `sources`. Safe to call from several threads at
+// once. The result must be freed with `sorbet_errors_free`.
+sorbet_errors *sorbet_typecheck(const sorbet_typechecker *typechecker, const char *const *paths,
+                                const char *const *sources, size_t count);
+size_t sorbet_errors_count(const sorbet_errors *errors);
+// The strings it points to live as long as `errors`.
+sorbet_error sorbet_errors_get(const sorbet_errors *errors, size_t i);
+void sorbet_errors_free(sorbet_errors *errors);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
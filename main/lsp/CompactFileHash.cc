@@ -0,0 +1,88 @@
+#include "main/lsp/CompactFileHash.h"
+#include "absl/algorithm/container.h"
+
+using namespace std;
+
+namespace sorbet::realmain::lsp {
+
+namespace {
+vector<pair<core::NameHash, u4>> sortedByName(const UnorderedMap<core::NameHash, u4> &hashes) {
+    vector<pair<core::NameHash, u4>> result(hashes.begin(), hashes.end());
+    fast_sort(result, [](const auto &l, const auto &r) -> bool { return l.first < r.first; });
+    return result;
+}
+
+size_t contentHash(const core::UsageHash &usages) {
+    absl::Hash<vector<core::NameHash>> hasher;
+    return hasher(usages.sends) * 31 + hasher(usages.constants);
+}
+
+bool sameNames(const core::UsageHash &l, const core::UsageHash &r) {
+    return l.sends == r.sends && l.constants == r.constants;
+}
+
+u8 usageHashMemory(const core::UsageHash &usages) {
+    return sizeof(core::UsageHash) + (usages.sends.capacity() + usages.constants.capacity()) * sizeof(core::NameHash);
+}
+} // namespace
+
+CompactFileHash::CompactFileHash(const core::GlobalStateHash &definitions, shared_ptr<const core::UsageHash> usages)
+    : hierarchyHash(definitions.hierarchyHash), classHierarchyHash(definitions.classHierarchyHash),
+      methodHashes(sortedByName(definitions.methodHashes)),
+      methodShapeHashes(sortedByName(definitions.methodShapeHashes)), usages(move(usages)) {}
+
+optional<u4> CompactFileHash::findMethodHash(core::NameHash name) const {
+    auto it = absl::c_lower_bound(methodHashes, name, [](const auto &entry, auto name) { return entry.first < name; });
+    if (it == methodHashes.end() || it->first != name) {
+        return nullopt;
+    }
+    return it->second;
+}
+
+u8 CompactFileHash::memoryUsage() const {
+    return sizeof(CompactFileHash) +
+           (methodHashes.capacity() + methodShapeHashes.capacity()) * sizeof(pair<core::NameHash, u4>);
+}
+
+shared_ptr<const core::UsageHash> UsageHashInterner::intern(core::UsageHash usages) {
+    auto &copies = interned[contentHash(usages)];
+    shared_ptr<const core::UsageHash> found;
+    // Drop the copies no file uses anymore while looking, so that the table doesn't grow with every edit.
+    auto end = remove_if(copies.begin(), copies.end(), [&](const auto &weak) {
+        auto copy = weak.lock();
+        if (copy == nullptr) {
+            return true;
+        }
+        if (found == nullptr && sameNames(*copy, usages)) {
+            found = move(copy);
+        }
+        return false;
+    });
+    copies.erase(end, copies.end());
+    if (found == nullptr) {
+        usages.sends.shrink_to_fit();
+        usages.constants.shrink_to_fit();
+        found = make_shared<const core::UsageHash>(move(usages));
+        copies.emplace_back(found);
+    }
+    return found;
+}
+
+void UsageHashInterner::clear() {
+    interned.clear();
+}
+
+u8 UsageHashInterner::memoryUsage() const {
+    u8 result = interned.capacity() * sizeof(decltype(interned)::value_type);
+    for (auto &[_, copies] : interned) {
+        result += copies.capacity() * sizeof(weak_ptr<const core::UsageHash>);
+        for (auto &weak : copies) {
+            if (auto copy = weak.lock()) {
+                result += usageHashMemory(*copy);
+            }
+        }
+    }
+    return result;
+}
+
+}; // namespace sorbet::realmain::lsp
@@ -0,0 +1,49 @@
+#ifndef RUBY_TYPER_LSP_COMPACTFILEHASH_H
+#define RUBY_TYPER_LSP_COMPACTFILEHASH_H
+
+#include "common/common.h"
+#include "core/NameHash.h"
+
+namespace sorbet::realmain::lsp {
+
+/**
+ * A `core::FileHash` as LSP keeps it for every file in the workspace, between edits. Method hashes are kept as arrays
+ * sorted by name rather than as hash maps, and `usages` are shared by all the files that use exactly the same names
+ * (see `UsageHashInterner`), which in a large workspace is most of what the hashes take.
+ */
+struct CompactFileHash {
+    u4 hierarchyHash = core::GlobalStateHash::HASH_STATE_NOT_COMPUTED;
+    u4 classHierarchyHash = core::GlobalStateHash::HASH_STATE_NOT_COMPUTED;
+    // Name => hash, ascending by name.
+    std::vector<std::pair<core::NameHash, u4>> methodHashes;
+    std::vector<std::pair<core::NameHash, u4>> methodShapeHashes;
+    // Never null once the hash has been set.
+    std::shared_ptr<const core::UsageHash> usages;
+
+    CompactFileHash() = default;
+    CompactFileHash(const core::GlobalStateHash &definitions, std::shared_ptr<const core::UsageHash> usages);
+
+    /** Returns the hash `methodHashes` has for `name`, or nullopt if the file defines no method called that. */
+    std::optional<u4> findMethodHash(core::NameHash name) const;
+    /** The bytes this hash allocated, not counting `usages`. */
+    u8 memoryUsage() const;
+};
+
+/**
+ * Hands out one shared copy of each distinct `core::UsageHash`. A copy lives as long as some `CompactFileHash` uses it.
+ */
+class UsageHashInterner final {
+    // Content hash => copies with that hash.
+    UnorderedMap<size_t, std::vector<std::weak_ptr<const core::UsageHash>>> interned;
+
+public:
+    std::shared_ptr<const core::UsageHash> intern(core::UsageHash usages);
+    /** Forgets every copy handed out so far. The copies stay valid, but are no longer shared with new ones. */
+    void clear();
+    /** The bytes the live copies and the table take. */
+    u8 memoryUsage() const;
+};
+
+}; // namespace sorbet::realmain::lsp
+
+#endif // RUBY_TYPER_LSP_COMPACTFILEHASH_H
@@ -19,6 +19,10 @@ unique_ptr<ast::MethodDef> DefLocSaver::postTransformMethodDef(core::Context ctx
 
         // Check if it matches against a specific argument. If it does, send that instead;
         // it's more specific.
+        // FILE and METHOD queries want every argument as well as the definition. Responses are sorted most precise
+        // first, so a LOC query answered from them still sees the argument ahead of the definition.
+        const bool wantsAll =
+            lspQuery.kind == core::lsp::Query::Kind::FILE || lspQuery.kind == core::lsp::Query::Kind::METHOD;
         const int numArgs = methodDef->args.size();
 
         ENFORCE(numArgs == argTypes.size());
@@ -27,12 +31,16 @@ unique_ptr<ast::MethodDef> DefLocSaver::postTransformMethodDef(core::Context ctx
             auto &argType = argTypes[i];
             auto *localExp = ast::MK::arg2Local(arg.get());
             // localExp should never be null, but guard against the possibility.
-            if (localExp && lspQuery.matchesLoc(localExp->loc)) {
-                tp.type = argType.type;
-                tp.origins.emplace_back(localExp->loc);
+            if (localExp && lspQuery.matchesLoc(localExp->loc) &&
+                (!wantsAll || methodDef->declLoc.contains(localExp->loc))) {
+                core::TypeAndOrigins argTp;
+                argTp.type = argType.type;
+                argTp.origins.emplace_back(localExp->loc);
                 core::lsp::QueryResponse::pushQueryResponse(
-                    ctx, core::lsp::IdentResponse(methodDef->symbol, localExp->loc, localExp->localVariable, tp));
-                return methodDef;
+                    ctx, core::lsp::IdentResponse(methodDef->symbol, localExp->loc, localExp->localVariable, argTp));
+                if (!wantsAll) {
+                    return methodDef;
+                }
             }
         }
 
@@ -0,0 +1,75 @@
+#include "main/lsp/EvictedTrees.h"
+#include "common/Counters.h"
+#include "core/serialize/serialize.h"
+#include <unistd.h>
+
+using namespace std;
+
+namespace sorbet::realmain::lsp {
+
+EvictedTrees::EvictedTrees() : scratch(tmpfile()) {}
+
+EvictedTrees::~EvictedTrees() {
+    if (scratch != nullptr) {
+        fclose(scratch);
+    }
+}
+
+bool EvictedTrees::contains(core::FileRef file) const {
+    return stored.contains(file.id());
+}
+
+void EvictedTrees::evict(core::GlobalState &gs, const vector<ast::ParsedFile *> &trees, WorkerPool &workers) {
+    if (scratch == nullptr || trees.empty()) {
+        return;
+    }
+    vector<vector<u1>> serialized(trees.size());
+    {
+        WorkerPool::TaskGroup group;
+        for (int i = 0; i < trees.size(); i++) {
+            workers.submit(group, [&gs, &trees, &serialized, i]() {
+                serialized[i] = core::serialize::Serializer::storeExpression(gs, trees[i]->tree);
+            });
+        }
+        workers.wait(group);
+    }
+    const int fd = fileno(scratch);
+    int evicted = 0;
+    for (int i = 0; i < trees.size(); i++) {
+        auto &data = serialized[i];
+        if (pwrite(fd, data.data(), data.size(), scratchSize) != static_cast<ssize_t>(data.size())) {
+            prodCounterInc("lsp.evicted_trees.write_failed");
+            continue;
+        }
+        stored[trees[i]->file.id()] = {scratchSize, data.size()};
+        scratchSize += data.size();
+        trees[i]->tree = nullptr;
+        evicted++;
+    }
+    prodCounterAdd("lsp.evicted_trees", evicted);
+}
+
+unique_ptr<ast::Expression> EvictedTrees::load(core::GlobalState &gs, core::FileRef file) const {
+    auto fnd = stored.find(file.id());
+    ENFORCE(fnd != stored.end());
+    auto [offset, size] = fnd->second;
+    vector<u1> data(size);
+    if (pread(fileno(scratch), data.data(), size, offset) != static_cast<ssize_t>(size)) {
+        Exception::raise("Failed to read the evicted tree of {} back", file.data(gs).path());
+    }
+    return core::serialize::Serializer::loadExpression(gs, data.data(), file.id());
+}
+
+void EvictedTrees::erase(core::FileRef file) {
+    stored.erase(file.id());
+}
+
+void EvictedTrees::clear() {
+    stored.clear();
+    scratchSize = 0;
+    if (scratch != nullptr && ftruncate(fileno(scratch), 0) != 0) {
+        prodCounterInc("lsp.evicted_trees.truncate_failed");
+    }
+}
+
+}; // namespace sorbet::realmain::lsp
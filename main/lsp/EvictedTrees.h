@@ -0,0 +1,46 @@
+#ifndef RUBY_TYPER_LSP_EVICTEDTREES_H
+#define RUBY_TYPER_LSP_EVICTEDTREES_H
+
+#include "ast/ast.h"
+#include "common/common.h"
+#include "common/concurrency/WorkerPool.h"
+#include <cstdio>
+
+namespace sorbet::realmain::lsp {
+
+/**
+ * Indexed trees kept serialized in a temporary file rather than in memory, for the files nobody has open, which in a
+ * large workspace are most of them and are only needed again by the slow path.
+ *
+ * Trees refer to names by id, so a tree can only be loaded into the state it was evicted from or a copy of it. The
+ * space of a tree that is evicted again isn't reused until `clear`. The file is deleted once it's closed, or when the
+ * process exits, whichever comes first.
+ */
+class EvictedTrees final {
+    // Null if the temporary file couldn't be created, in which case nothing is evicted.
+    std::FILE *scratch;
+    u8 scratchSize = 0;
+    // File id => offset and size of its tree in `scratch`.
+    UnorderedMap<int, std::pair<u8, u8>> stored;
+
+public:
+    EvictedTrees();
+    ~EvictedTrees();
+    EvictedTrees(const EvictedTrees &) = delete;
+    EvictedTrees &operator=(const EvictedTrees &) = delete;
+
+    bool contains(core::FileRef file) const;
+    /** Stores each of `trees` (serializing them in parallel on `workers`) and drops their `tree`. A tree that couldn't
+     * be stored is left as it is. */
+    void evict(core::GlobalState &gs, const std::vector<ast::ParsedFile *> &trees, WorkerPool &workers);
+    /** Loads the tree of `file`, which must be contained, into `gs`. May be called from several threads at once. */
+    std::unique_ptr<ast::Expression> load(core::GlobalState &gs, core::FileRef file) const;
+    /** Forgets the tree of `file`, which was replaced. */
+    void erase(core::FileRef file);
+    /** Forgets every tree, and frees the space they took. */
+    void clear();
+};
+
+}; // namespace sorbet::realmain::lsp
+
+#endif // RUBY_TYPER_LSP_EVICTEDTREES_H
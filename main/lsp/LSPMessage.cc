@@ -55,14 +55,8 @@ unique_ptr<LSPMessage> makeSorbetError(LSPErrorCodes code, string_view message,
     }
 }
 
-unique_ptr<LSPMessage> LSPMessage::fromClient(const string &json) {
-    rapidjson::MemoryPoolAllocator<> alloc;
-    rapidjson::Document d(&alloc);
-    if (d.Parse(json.c_str()).HasParseError()) {
-        return makeSorbetError(LSPErrorCodes::ParseError,
-                               fmt::format("Last LSP request: `{}` is not a valid json object", json));
-    }
-
+namespace {
+unique_ptr<LSPMessage> fromParsedClient(rapidjson::Document &d) {
     // Grab ID before parsing, as the value may get moved out.
     optional<int> id;
     if (d.HasMember("id") && d["id"].IsInt()) {
@@ -86,6 +80,31 @@ unique_ptr<LSPMessage> LSPMessage::fromClient(const string &json) {
                                fmt::format("Unable to deserialize LSP request: {}", e.what()), id);
     }
 }
+} // namespace
+
+unique_ptr<LSPMessage> LSPMessage::fromClient(const string &json) {
+    rapidjson::MemoryPoolAllocator<> alloc;
+    rapidjson::Document d(&alloc);
+    if (d.Parse(json.c_str()).HasParseError()) {
+        return makeSorbetError(LSPErrorCodes::ParseError,
+                               fmt::format("Last LSP request: `{}` is not a valid json object", json));
+    }
+    return fromParsedClient(d);
+}
+
+unique_ptr<LSPMessage> LSPMessage::fromClient(string &&json) {
+    rapidjson::MemoryPoolAllocator<> alloc;
+    rapidjson::Document d(&alloc);
+    // `d` points into `json` until `fromParsedClient` has copied everything out of it.
+    if (d.ParseInsitu(json.data()).HasParseError()) {
+        // In-situ parsing terminates every string it decoded by overwriting its closing quote. Put the quotes back so
+        // the error shows (nearly) what the client sent; only strings containing escapes stay decoded.
+        replace(json.begin(), json.end(), '\0', '"');
+        return makeSorbetError(LSPErrorCodes::ParseError,
+                               fmt::format("Last LSP request: `{}` is not a valid json object", json));
+    }
+    return fromParsedClient(d);
+}
 
 LSPMessage::RawLSPMessage fromJSONValue(rapidjson::Document &d) {
     if (d.HasMember("id")) {
@@ -156,6 +175,8 @@ bool LSPMessage::isDelayable() const {
             return false;
         // VS Code requests document symbols automatically and in the background. It's OK to delay these requests.
         case LSPMethod::TextDocumentDocumentSymbol:
+        // Memory reports are polled by tooling rather than requested by the user.
+        case LSPMethod::SorbetMemoryReport:
         // Sorbet processes these requests before they hit the server's queue.
         case LSPMethod::$CancelRequest:
         // Sorbet produces SorbetErrors for a variety of common things, including when it receives a message type it
@@ -254,4 +275,16 @@ string LSPMessage::toJSON() const {
         Exception::raise("LSPMessage is not a request, notification, or a response.");
     }
 }
+
+void LSPMessage::writeJSON(rapidjson::Writer<rapidjson::StringBuffer> &writer) const {
+    if (isRequest()) {
+        asRequest().writeJSON(writer);
+    } else if (isNotification()) {
+        asNotification().writeJSON(writer);
+    } else if (isResponse()) {
+        asResponse().writeJSON(writer);
+    } else {
+        Exception::raise("LSPMessage is not a request, notification, or a response.");
+    }
+}
 } // namespace sorbet::realmain::lsp
\ No newline at end of file
@@ -50,6 +50,11 @@ public:
      * parsing succeeded.
      */
     static std::unique_ptr<LSPMessage> fromClient(const std::string &json);
+    /**
+     * Like the above, but parses `json` in-situ: strings are decoded into `json`'s own buffer instead of being copied
+     * into a separate allocation. Call this for large messages whose raw text isn't needed afterwards.
+     */
+    static std::unique_ptr<LSPMessage> fromClient(std::string &&json);
 
     LSPMessage(RawLSPMessage msg);
     LSPMessage(rapidjson::Document &d);
@@ -61,6 +66,8 @@ public:
     /** Used to calculate latency of message processing. May contain multiple timers if other messages were merged into
      * this one. */
     std::vector<std::unique_ptr<Timer>> timers;
+    /** When the message was queued, or the first of the messages merged into it was. */
+    std::chrono::time_point<std::chrono::steady_clock> enqueuedAt = std::chrono::steady_clock::now();
 
     /** Request counter. */
     int counter;
@@ -139,6 +146,11 @@ public:
      * Returns the message in JSON form.
      */
     std::string toJSON() const;
+
+    /**
+     * Writes the message in JSON form to `writer`, without building it as a rapidjson::Value first.
+     */
+    void writeJSON(rapidjson::Writer<rapidjson::StringBuffer> &writer) const;
 };
 } // namespace sorbet::realmain::lsp
 
@@ -0,0 +1,69 @@
+#include "main/lsp/NameUsageIndex.h"
+#include "absl/algorithm/container.h"
+
+using namespace std;
+
+namespace sorbet::realmain::lsp {
+
+namespace {
+// Only touches the names that `file` stopped or started using, so that an edit costs what it changed rather than what
+// the file uses.
+void updateNames(UnorderedMap<core::NameHash, vector<core::FileRef>> &index, core::FileRef file,
+                 const vector<core::NameHash> &before, const vector<core::NameHash> &after) {
+    vector<core::NameHash> removed;
+    vector<core::NameHash> added;
+    absl::c_set_difference(before, after, back_inserter(removed));
+    absl::c_set_difference(after, before, back_inserter(added));
+    for (auto name : removed) {
+        auto fnd = index.find(name);
+        if (fnd == index.end()) {
+            continue;
+        }
+        auto &files = fnd->second;
+        auto it = absl::c_lower_bound(files, file);
+        if (it != files.end() && *it == file) {
+            files.erase(it);
+        }
+        if (files.empty()) {
+            index.erase(fnd);
+        }
+    }
+    for (auto name : added) {
+        auto &files = index[name];
+        auto it = absl::c_lower_bound(files, file);
+        if (it == files.end() || *it != file) {
+            files.insert(it, file);
+        }
+    }
+}
+
+void filesUsing(const UnorderedMap<core::NameHash, vector<core::FileRef>> &index, const vector<core::NameHash> &names,
+                vector<core::FileRef> &out) {
+    for (auto name : names) {
+        auto fnd = index.find(name);
+        if (fnd != index.end()) {
+            out.insert(out.end(), fnd->second.begin(), fnd->second.end());
+        }
+    }
+}
+} // namespace
+
+void NameUsageIndex::update(core::FileRef file, const core::UsageHash &before, const core::UsageHash &after) {
+    updateNames(sends, file, before.sends, after.sends);
+    updateNames(constants, file, before.constants, after.constants);
+}
+
+void NameUsageIndex::clear() {
+    sends.clear();
+    constants.clear();
+}
+
+void NameUsageIndex::filesSending(const vector<core::NameHash> &names, vector<core::FileRef> &out) const {
+    filesUsing(sends, names, out);
+}
+
+void NameUsageIndex::filesUsingConstant(const vector<core::NameHash> &names, vector<core::FileRef> &out) const {
+    filesUsing(constants, names, out);
+}
+
+}; // namespace sorbet::realmain::lsp
@@ -0,0 +1,33 @@
+#ifndef RUBY_TYPER_LSP_NAMEUSAGEINDEX_H
+#define RUBY_TYPER_LSP_NAMEUSAGEINDEX_H
+
+#include "common/common.h"
+#include "core/NameHash.h"
+#include "core/core.h"
+
+namespace sorbet::realmain::lsp {
+
+/**
+ * Inverted index over the `usages` of the files' `core::FileHash`es: for each name, the files that send it, and the
+ * files that use it as a constant (or define a method with it). Used to find the files an edit affects without
+ * scanning the usages of every file in the workspace.
+ */
+class NameUsageIndex final {
+    // Name => files, ascending.
+    UnorderedMap<core::NameHash, std::vector<core::FileRef>> sends;
+    UnorderedMap<core::NameHash, std::vector<core::FileRef>> constants;
+
+public:
+    /** Replaces what `file` was indexed with, `before`, by `after`. Both must be sorted and deduplicated. */
+    void update(core::FileRef file, const core::UsageHash &before, const core::UsageHash &after);
+    /** Forgets everything indexed so far. */
+    void clear();
+    /** Appends the files that send one of `names` to `out`, in no particular order and possibly more than once. */
+    void filesSending(const std::vector<core::NameHash> &names, std::vector<core::FileRef> &out) const;
+    /** Like `filesSending`, but for files that use one of `names` as a constant or define a method with it. */
+    void filesUsingConstant(const std::vector<core::NameHash> &names, std::vector<core::FileRef> &out) const;
+};
+
+}; // namespace sorbet::realmain::lsp
+
+#endif // RUBY_TYPER_LSP_NAMEUSAGEINDEX_H
@@ -0,0 +1,105 @@
+#include "main/lsp/SymbolSearchIndex.h"
+
+using namespace std;
+
+namespace sorbet::realmain::lsp {
+
+namespace {
+u4 trigramAt(string_view str, int i) {
+    return ((u4)(u1)str[i] << 16) | ((u4)(u1)str[i + 1] << 8) | (u4)(u1)str[i + 2];
+}
+} // namespace
+
+void SymbolSearchIndex::update(const core::GlobalState &gs) {
+    for (; symbolsIndexed < gs.symbolsUsed(); symbolsIndexed++) {
+        core::SymbolRef ref(gs, symbolsIndexed);
+        auto name = ref.data(gs)->name;
+        auto fnd = entryForName.find(name);
+        if (fnd != entryForName.end()) {
+            entries[fnd->second].symbols.emplace_back(ref);
+            continue;
+        }
+
+        const u4 entry = entries.size();
+        entryForName[name] = entry;
+        entries.emplace_back(Entry{name, {ref}});
+        string_view shortName = name.data(gs)->shortName(gs);
+        for (int i = 0; i + 3 <= shortName.size(); i++) {
+            auto &posting = postings[trigramAt(shortName, i)];
+            // The same trigram can occur more than once in a name.
+            if (posting.empty() || posting.back() != entry) {
+                posting.emplace_back(entry);
+            }
+        }
+    }
+}
+
+void SymbolSearchIndex::clear() {
+    entries.clear();
+    entryForName.clear();
+    postings.clear();
+    symbolsIndexed = 1;
+}
+
+vector<core::SymbolRef> SymbolSearchIndex::search(const core::GlobalState &gs, string_view pattern) const {
+    // Every name containing `pattern` contains all of its trigrams, so the rarest one bounds the candidates.
+    const vector<u4> *candidates = nullptr;
+    for (int i = 0; i + 3 <= pattern.size(); i++) {
+        auto fnd = postings.find(trigramAt(pattern, i));
+        if (fnd == postings.end()) {
+            return {};
+        }
+        if (candidates == nullptr || fnd->second.size() < candidates->size()) {
+            candidates = &fnd->second;
+        }
+    }
+
+    struct Match {
+        int rank;
+        size_t length;
+        u4 entry;
+    };
+    vector<Match> matches;
+    auto tryMatch = [&](u4 entry) {
+        string_view shortName = entries[entry].name.data(gs)->shortName(gs);
+        auto pos = shortName.find(pattern);
+        if (pos == string_view::npos) {
+            return;
+        }
+        int rank = shortName.size() == pattern.size() ? 0 : (pos == 0 ? 1 : 2);
+        matches.emplace_back(Match{rank, shortName.size(), entry});
+    };
+    if (candidates != nullptr) {
+        for (auto entry : *candidates) {
+            tryMatch(entry);
+        }
+    } else {
+        // Patterns shorter than a trigram fall back to checking every distinct name.
+        for (u4 entry = 0; entry < entries.size(); entry++) {
+            tryMatch(entry);
+        }
+    }
+    fast_sort(matches, [](const Match &left, const Match &right) -> bool {
+        if (left.rank != right.rank) {
+            return left.rank < right.rank;
+        }
+        if (left.length != right.length) {
+            return left.length < right.length;
+        }
+        return left.entry < right.entry;
+    });
+
+    vector<core::SymbolRef> result;
+    for (auto &match : matches) {
+        auto &entry = entries[match.entry];
+        for (auto sym : entry.symbols) {
+            // Skip symbols that were renamed (e.g. mangled after a redefinition) since they were indexed.
+            if (sym.data(gs)->name == entry.name) {
+                result.emplace_back(sym);
+            }
+        }
+    }
+    return result;
+}
+
+} // namespace sorbet::realmain::lsp
@@ -0,0 +1,40 @@
+#ifndef RUBY_TYPER_LSP_SYMBOLSEARCHINDEX_H
+#define RUBY_TYPER_LSP_SYMBOLSEARCHINDEX_H
+
+#include "common/common.h"
+#include "core/core.h"
+
+namespace sorbet::realmain::lsp {
+
+/**
+ * Trigram index over the short names of the symbols in a GlobalState. Used to answer `workspace/symbol` without
+ * scanning the whole symbol table on every keystroke.
+ */
+class SymbolSearchIndex final {
+    struct Entry {
+        core::NameRef name;
+        // In the order they were indexed, which is the order they were entered.
+        std::vector<core::SymbolRef> symbols;
+    };
+    std::vector<Entry> entries;
+    UnorderedMap<core::NameRef, u4> entryForName;
+    // Trigram => indexes into `entries`, ascending.
+    UnorderedMap<u4, std::vector<u4>> postings;
+    // Symbols below this id have been indexed.
+    u4 symbolsIndexed = 1;
+
+public:
+    /** Indexes the symbols `gs` gained since the last call. Symbols must not have been renumbered in between. */
+    void update(const core::GlobalState &gs);
+    /** Forgets everything indexed so far. */
+    void clear();
+    /**
+     * Returns the symbols whose short name contains `pattern`: exact matches first, then prefix matches, then the
+     * rest, with shorter names first within each group.
+     */
+    std::vector<core::SymbolRef> search(const core::GlobalState &gs, std::string_view pattern) const;
+};
+
+}; // namespace sorbet::realmain::lsp
+
+#endif // RUBY_TYPER_LSP_SYMBOLSEARCHINDEX_H
@@ -80,12 +80,10 @@ InvalidTypeError::InvalidTypeError(string_view fieldName, string_view expectedTy
 const std::string JSONBaseType::defaultFieldName = "root";
 
 string JSONBaseType::toJSON() const {
-    rapidjson::MemoryPoolAllocator<> alloc;
-    auto v = toJSONValue(alloc);
     rapidjson::StringBuffer buffer;
     rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-    v->Accept(writer);
-    return buffer.GetString();
+    writeJSON(writer);
+    return string(buffer.GetString(), buffer.GetSize());
 }
 
 } // namespace sorbet::realmain::lsp
@@ -3,6 +3,8 @@
 
 #include "common/common.h"
 #include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
 
 #include <optional>
 #include <variant>
@@ -101,6 +103,11 @@ public:
      * Converts C++ object into a RapidJSON JSON value owned by the given rapidjson allocator.
      */
     virtual std::unique_ptr<rapidjson::Value> toJSONValue(rapidjson::MemoryPoolAllocator<> &alloc) const = 0;
+
+    /**
+     * Writes C++ object as JSON to the given rapidjson writer, without building a RapidJSON JSON value first.
+     */
+    virtual void writeJSON(rapidjson::Writer<rapidjson::StringBuffer> &writer) const = 0;
 };
 
 #include "main/lsp/lsp_messages_gen.h"
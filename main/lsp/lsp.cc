@@ -13,8 +13,8 @@ namespace sorbet::realmain::lsp {
 
 LSPLoop::LSPLoop(unique_ptr<core::GlobalState> gs, const options::Options &opts, const shared_ptr<spd::logger> &logger,
                  WorkerPool &workers, int inputFd, std::ostream &outputStream, bool skipConfigatron,
-                 bool disableFastPath)
-    : initialGS(std::move(gs)), opts(opts), logger(logger), workers(workers), inputFd(inputFd),
+                 bool disableFastPath, unique_ptr<KeyValueStore> kvstore)
+    : initialGS(std::move(gs)), opts(opts), kvstore(move(kvstore)), logger(logger), workers(workers), inputFd(inputFd),
       outputStream(outputStream), skipConfigatron(skipConfigatron), disableFastPath(disableFastPath),
       lastMetricUpdateTime(chrono::steady_clock::now()) {
     errorQueue = dynamic_pointer_cast<core::ErrorQueue>(initialGS->errorQueue);
@@ -27,6 +27,10 @@ LSPLoop::LSPLoop(unique_ptr<core::GlobalState> gs, const options::Options &opts,
         throw options::EarlyReturnWithCode(1);
     }
     rootPath = opts.rawInputDirNames.at(0);
+    payloadGS = initialGS->deepCopy();
+    // Overwritten by runLSP. Requests processed without it happen on the thread that created the loop.
+    mainThreadId = this_thread::get_id();
+    queryThreadWorkers = WorkerPool::create(0, *logger);
 }
 
 LSPLoop::QueryRun LSPLoop::setupLSPQueryByLoc(unique_ptr<core::GlobalState> gs, string_view uri, const Position &pos,
@@ -54,31 +58,92 @@ LSPLoop::QueryRun LSPLoop::setupLSPQueryByLoc(unique_ptr<core::GlobalState> gs,
         return LSPLoop::QueryRun{move(gs), {}, move(error)};
     }
 
-    return runQuery(move(gs), core::lsp::Query::createLocQuery(*loc.get()), {fref});
+    return runLocQuery(move(gs), *loc);
 }
 
-LSPLoop::QueryRun LSPLoop::setupLSPQueryBySymbol(unique_ptr<core::GlobalState> gs, core::SymbolRef sym) const {
-    Timer timeit(logger, "setupLSPQueryBySymbol");
+void LSPLoop::setGlobalStateHash(core::FileRef file, core::FileHash hash) {
+    if (file.id() >= globalStateHashes.size()) {
+        globalStateHashes.resize(file.id() + 1);
+    }
+    auto &entry = globalStateHashes[file.id()];
+    auto usages = usageHashInterner.intern(move(hash.usages));
+    nameUsageIndex.update(file, entry.usages == nullptr ? core::UsageHash{} : *entry.usages, *usages);
+    entry = CompactFileHash(hash.definitions, move(usages));
+}
+
+core::MemoryUsage LSPLoop::memoryUsage(const core::GlobalState &gs) const {
+    auto usage = gs.memoryUsage();
+    usage.fileHashes = globalStateHashes.capacity() * sizeof(CompactFileHash) + usageHashInterner.memoryUsage();
+    for (auto &hash : globalStateHashes) {
+        usage.fileHashes += hash.memoryUsage() - sizeof(CompactFileHash);
+    }
+    return usage;
+}
+
+vector<core::FileRef> LSPLoop::filesThatMayReference(const core::GlobalState &gs, core::SymbolRef sym) const {
     ENFORCE(sym.exists());
-    vector<core::FileRef> frefs;
-    const core::NameHash symNameHash(*gs, sym.data(*gs)->name.data(*gs));
+    vector<core::FileRef> candidates;
+    const vector<core::NameHash> symNameHash{core::NameHash(gs, sym.data(gs)->name.data(gs))};
     // Locate files that contain the same Name as the symbol. Is an overapproximation, but a good first filter.
-    int i = -1;
-    for (auto &hash : globalStateHashes) {
-        i++;
-        const auto &usedSends = hash.usages.sends;
-        const auto &usedConstants = hash.usages.constants;
-        auto ref = core::FileRef(i);
-
-        const bool fileIsValid = ref.exists() && ref.data(*gs).sourceType == core::File::Type::Normal;
-        if (fileIsValid &&
-            (std::find(usedSends.begin(), usedSends.end(), symNameHash) != usedSends.end() ||
-             std::find(usedConstants.begin(), usedConstants.end(), symNameHash) != usedConstants.end())) {
+    nameUsageIndex.filesSending(symNameHash, candidates);
+    nameUsageIndex.filesUsingConstant(symNameHash, candidates);
+    fast_sort(candidates);
+    candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+
+    vector<core::FileRef> frefs;
+    for (auto ref : candidates) {
+        if (ref.exists() && ref.data(gs).sourceType == core::File::Type::Normal) {
             frefs.emplace_back(ref);
         }
     }
+    return frefs;
+}
+
+unique_ptr<core::GlobalState> LSPLoop::indexReferences(unique_ptr<core::GlobalState> gs,
+                                                       const vector<core::FileRef> &files) const {
+    Timer timeit(logger, "indexReferences");
+    vector<core::FileRef> missing;
+    for (auto file : files) {
+        if (!referenceIndex.contains(file)) {
+            missing.emplace_back(file);
+        }
+    }
+    prodCategoryCounterAdd("lsp.reference_index", "hit", files.size() - missing.size());
+    prodCategoryCounterAdd("lsp.reference_index", "miss", missing.size());
+    if (missing.empty()) {
+        return gs;
+    }
 
-    return runQuery(move(gs), core::lsp::Query::createSymbolQuery(sym), frefs);
+    auto run = runQuery(move(gs), core::lsp::Query::createAllSymbolsQuery(), missing);
+    gs = move(run.gs);
+    for (auto file : missing) {
+        // Files that reference nothing still get an entry, so that they aren't typechecked again.
+        referenceIndex[file];
+    }
+    for (auto &q : run.responses) {
+        // Mirrors what `extractLocations` reports for a SYMBOL query.
+        core::Loc loc = q->getLoc();
+        if (!loc.exists() || !loc.file().exists()) {
+            continue;
+        }
+        auto fileIsTyped = loc.file().data(*gs).strictLevel >= core::StrictLevel::True;
+        auto &fileReferences = referenceIndex[loc.file()];
+        if (auto constResp = q->isConstant()) {
+            fileReferences[constResp->symbol].emplace_back(loc);
+        } else if (auto defResp = q->isDefinition()) {
+            fileReferences[defResp->symbol].emplace_back(loc);
+        } else if (auto sendResp = q->isSend()) {
+            if (!fileIsTyped) {
+                continue;
+            }
+            for (auto it = sendResp->dispatchResult.get(); it != nullptr; it = it->secondary.get()) {
+                if (it->main.method.exists()) {
+                    fileReferences[it->main.method].emplace_back(loc);
+                }
+            }
+        }
+    }
+    return gs;
 }
 
 bool LSPLoop::ensureInitialized(LSPMethod forMethod, const LSPMessage &msg,
@@ -90,6 +155,40 @@ bool LSPLoop::ensureInitialized(LSPMethod forMethod, const LSPMessage &msg,
     return false;
 }
 
+namespace {
+// Hashes everything `pushDiagnostics` sends for `errors`, so that diagnostics that didn't change aren't sent again.
+u4 hashDiagnostics(const core::GlobalState &gs, const vector<unique_ptr<core::Error>> &errors) {
+    u4 result = errors.size();
+    auto mixLoc = [&](core::Loc loc) {
+        if (!loc.exists()) {
+            result = core::mix(result, 0);
+            return;
+        }
+        auto [begin, end] = loc.position(gs);
+        result = core::mix(result, loc.file().id());
+        result = core::mix(result, begin.line);
+        result = core::mix(result, begin.column);
+        result = core::mix(result, end.line);
+        result = core::mix(result, end.column);
+    };
+    for (auto &e : errors) {
+        mixLoc(e->loc);
+        result = core::mix(result, e->what.code);
+        result = core::mix(result, core::_hash(e->header));
+        result = core::mix(result, e->sections.size());
+        for (auto &section : e->sections) {
+            result = core::mix(result, core::_hash(section.header));
+            result = core::mix(result, section.messages.size());
+            for (auto &errorLine : section.messages) {
+                mixLoc(errorLine.loc);
+                result = core::mix(result, core::_hash(errorLine.formattedMessage));
+            }
+        }
+    }
+    return result;
+}
+} // namespace
+
 LSPResult LSPLoop::pushDiagnostics(TypecheckRun run) {
     const core::GlobalState &gs = *run.gs;
     const auto &filesTypechecked = run.filesTypechecked;
@@ -103,6 +202,16 @@ LSPResult LSPLoop::pushDiagnostics(TypecheckRun run) {
             pathsTypechecked.emplace_back(f.data(gs).path());
         }
         auto sorbetTypecheckInfo = make_unique<SorbetTypecheckRunInfo>(run.tookFastPath, move(pathsTypechecked));
+        if (!run.fastPathDecision.empty()) {
+            sorbetTypecheckInfo->fastPathDecision = run.fastPathDecision;
+        }
+        if (!run.phaseTimes.empty()) {
+            vector<unique_ptr<SorbetTypecheckRunPhase>> phases;
+            for (auto &[name, durationMs] : run.phaseTimes) {
+                phases.emplace_back(make_unique<SorbetTypecheckRunPhase>(name, durationMs));
+            }
+            sorbetTypecheckInfo->phases = move(phases);
+        }
         responses.push_back(make_unique<LSPMessage>(
             make_unique<NotificationMessage>("2.0", LSPMethod::SorbetTypecheckRunInfo, move(sorbetTypecheckInfo))));
     }
@@ -146,6 +255,20 @@ LSPResult LSPLoop::pushDiagnostics(TypecheckRun run) {
 
     for (auto file : filesToUpdateErrorListFor) {
         if (file.exists()) {
+            auto fileErrors = errorsAccumulated.find(file);
+            if (fileErrors == errorsAccumulated.end()) {
+                // The file no longer has errors; it's sent an empty list once.
+                publishedDiagnosticsHashes.erase(file);
+            } else {
+                auto hash = hashDiagnostics(gs, fileErrors->second);
+                auto [published, inserted] = publishedDiagnosticsHashes.try_emplace(file, hash);
+                if (!inserted && published->second == hash) {
+                    prodCounterInc("lsp.diagnostics.unchanged");
+                    continue;
+                }
+                published->second = hash;
+            }
+
             string uri;
             { // uri
                 if (file.data(gs).sourceType == core::File::Type::Payload) {
@@ -158,8 +281,8 @@ LSPResult LSPLoop::pushDiagnostics(TypecheckRun run) {
             vector<unique_ptr<Diagnostic>> diagnostics;
             {
                 // diagnostics
-                if (errorsAccumulated.find(file) != errorsAccumulated.end()) {
-                    for (auto &e : errorsAccumulated[file]) {
+                if (fileErrors != errorsAccumulated.end()) {
+                    for (auto &e : fileErrors->second) {
                         auto range = loc2Range(gs, e->loc);
                         if (range == nullptr) {
                             continue;
@@ -201,14 +324,37 @@ LSPResult LSPLoop::pushDiagnostics(TypecheckRun run) {
                 }
             }
 
-            responses.push_back(make_unique<LSPMessage>(
+            auto publish = make_unique<LSPMessage>(
                 make_unique<NotificationMessage>("2.0", LSPMethod::TextDocumentPublishDiagnostics,
-                                                 make_unique<PublishDiagnosticsParams>(uri, move(diagnostics)))));
+                                                 make_unique<PublishDiagnosticsParams>(uri, move(diagnostics))));
+            if (opts.lspDiagnosticsCoalesceMs > 0) {
+                if (pendingDiagnostics.empty()) {
+                    pendingDiagnosticsDeadline =
+                        chrono::steady_clock::now() + chrono::milliseconds(opts.lspDiagnosticsCoalesceMs);
+                }
+                pendingDiagnostics[file] = move(publish);
+            } else {
+                responses.push_back(move(publish));
+            }
         }
     }
     return LSPResult{move(run.gs), move(responses)};
 }
 
+vector<unique_ptr<LSPMessage>> LSPLoop::takePendingDiagnostics() {
+    vector<pair<core::FileRef, unique_ptr<LSPMessage>>> pending;
+    for (auto &[file, publish] : pendingDiagnostics) {
+        pending.emplace_back(file, move(publish));
+    }
+    pendingDiagnostics.clear();
+    fast_sort(pending, [](const auto &left, const auto &right) -> bool { return left.first < right.first; });
+    vector<unique_ptr<LSPMessage>> result;
+    for (auto &[file, publish] : pending) {
+        result.emplace_back(move(publish));
+    }
+    return result;
+}
+
 constexpr chrono::minutes STATSD_INTERVAL = chrono::minutes(5);
 
 bool LSPLoop::shouldSendCountersToStatsd(chrono::time_point<chrono::steady_clock> currentTime) const {
@@ -220,14 +366,20 @@ void LSPLoop::sendCountersToStatsd(chrono::time_point<chrono::steady_clock> curr
     // Record rusage-related stats.
     StatsD::addRusageStats();
     auto counters = getAndClearThreadCounters();
+    if (!opts.webTraceFile.empty()) {
+        web_tracer_framework::Tracing::storeTraces(counters, opts.webTraceFile);
+    }
     if (!opts.statsdHost.empty()) {
         lastMetricUpdateTime = currentTime;
 
+        // Sending every counter takes a while, so it happens on its own thread rather than holding up the next
+        // request. The last batch went out STATSD_INTERVAL ago, so joining its thread doesn't wait.
+        statsdSubmitter = nullptr;
         auto prefix = fmt::format("{}.lsp.counters", opts.statsdPrefix);
-        StatsD::submitCounters(counters, opts.statsdHost, opts.statsdPort, prefix);
-    }
-    if (!opts.webTraceFile.empty()) {
-        web_tracer_framework::Tracing::storeTraces(counters, opts.webTraceFile);
+        statsdSubmitter = runInAThread("statsdSubmit", [counters = make_shared<CounterState>(move(counters)),
+                                                        host = opts.statsdHost, port = opts.statsdPort, prefix]() {
+            StatsD::submitCounters(*counters, host, port, prefix);
+        });
     }
 }
 
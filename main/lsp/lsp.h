@@ -1,14 +1,23 @@
 #ifndef RUBY_TYPER_LSPLOOP_H
 #define RUBY_TYPER_LSPLOOP_H
 
+#include "absl/synchronization/mutex.h"
 #include "ast/ast.h"
+#include "common/concurrency/ConcurrentQueue.h"
 #include "common/concurrency/WorkerPool.h"
 #include "common/kvstore/KeyValueStore.h"
+#include "common/os/os.h"
 #include "core/ErrorQueue.h"
 #include "core/NameHash.h"
 #include "core/core.h"
+#include "main/lsp/CompactFileHash.h"
+#include "main/lsp/EvictedTrees.h"
 #include "main/lsp/LSPMessage.h"
+#include "main/lsp/NameUsageIndex.h"
+#include "main/lsp/SymbolSearchIndex.h"
 #include "main/options/options.h"
+#include "main/pipeline/pipeline.h"
+#include <atomic>
 #include <chrono>
 #include <deque>
 #include <optional>
@@ -61,6 +70,24 @@ class LSPLoop {
         int errorCode = 0;
         // Counters collected from worker threads.
         CounterState counters;
+        // If set, incremented every time a file update is enqueued. See `LSPLoop::editEpoch`.
+        std::shared_ptr<std::atomic<int>> editEpoch;
+        // The last committed GlobalState, lent to the query thread while the main thread runs a slow path. See
+        // `LSPLoop::lendToQueryThread`.
+        std::unique_ptr<core::GlobalState> querySnapshot;
+        // URIs of the files the running slow path updates. Requests on them are left to the main thread, as their
+        // positions refer to contents `querySnapshot` doesn't have.
+        UnorderedSet<std::string> querySnapshotStaleUris;
+        // True while the query thread is answering a request with `querySnapshot`.
+        bool servingQuery = false;
+        // Watchman changes are held back until then, so that the rest of their burst can be merged with them. See
+        // `opts.watchmanSettleMs`.
+        std::chrono::time_point<std::chrono::steady_clock> watchmanSettleDeadline;
+        // Messages the reader and Watchman threads handed off without taking the lock, in the order each of them read
+        // them. Whichever thread takes the lock to wait for messages next merges them into `pendingRequests`. See
+        // `handOffRequest`.
+        ConcurrentUnBoundedQueue<std::unique_ptr<LSPMessage>> handedOff;
+        std::atomic<int> handedOffCount{0};
     };
 
     /**
@@ -89,14 +116,44 @@ class LSPLoop {
         ~ShowOperation();
     };
 
+    /** initialGS as it was before any file was indexed into it, to start over from in `compactNames`. Shares what it
+     * can with initialGS, see `GlobalState::deepCopy`. */
+    std::unique_ptr<core::GlobalState> payloadGS;
+    /** How many names initialGS had once every file was indexed into it. Every name it enters after that is entered
+     * for an edit, and stays behind once the edit is gone. */
+    u4 namesAfterIndexing = 0;
     /** Trees that have been indexed (with initialGS) and can be reused between different runs */
     std::vector<ast::ParsedFile> indexed;
+    /** The trees of `indexed` that were evicted, see `opts.lspEvictClosedTrees`. Their entries in `indexed` have no
+     * tree. */
+    EvictedTrees evictedTrees;
+    /** Set once the process went over `opts.lspMemoryCeilingMiB`, after which closed trees are always evicted. */
+    bool overMemoryCeiling = false;
     /** Trees that have been indexed (with finalGS) and can be reused between different runs */
     UnorderedMap<int, ast::ParsedFile> indexedFinalGS;
     /** Hashes of global states obtained by resolving every file in isolation. Used for fastpath. */
-    std::vector<core::FileHash> globalStateHashes;
+    std::vector<CompactFileHash> globalStateHashes;
+    /** The `usages` that `globalStateHashes` share. */
+    UsageHashInterner usageHashInterner;
+    /** The `usages` of `globalStateHashes`, by name. Kept in sync by `setGlobalStateHash`. */
+    NameUsageIndex nameUsageIndex;
+    /** What typechecking each method of the files typechecked on the fast path reported, so that the next edit to one
+     * of them only has to typecheck the methods it touched. Only kept for the contents files have in `initialGS`. */
+    UnorderedMap<core::FileRef, pipeline::TypecheckedMethods> typecheckedMethods;
+    /** Files that fast paths left to typecheck once idle, see `opts.lspDeferClosedDependents`, ascending. Cleared by
+     * the slow path, which typechecks every file. */
+    std::vector<core::FileRef> deferredFiles;
     /** List of files that have had errors in last run*/
     std::vector<core::FileRef> filesThatHaveErrors;
+    /** Hash of the diagnostics last published for each file in `filesThatHaveErrors`. See `pushDiagnostics`. */
+    UnorderedMap<core::FileRef, u4> publishedDiagnosticsHashes;
+    /**
+     * `publishDiagnostics` notifications held back by `opts.lspDiagnosticsCoalesceMs`, by file. A newer run's
+     * diagnostics for a file replace the held back ones.
+     */
+    UnorderedMap<core::FileRef, std::unique_ptr<LSPMessage>> pendingDiagnostics;
+    /** When the oldest of `pendingDiagnostics` was held back for long enough. */
+    std::chrono::time_point<std::chrono::steady_clock> pendingDiagnosticsDeadline;
     /** Root of LSP client workspace */
     std::string rootUri;
     /** File system root of LSP client workspace. May be empty if it is the current working directory. */
@@ -113,7 +170,8 @@ class LSPLoop {
      */
     std::unique_ptr<core::GlobalState> initialGS;
     const options::Options &opts;
-    std::unique_ptr<KeyValueStore> kvstore; // always null for now.
+    /** May be null. Caches parse trees and file hashes across restarts, but not typecheck results. */
+    std::unique_ptr<KeyValueStore> kvstore;
     std::shared_ptr<spdlog::logger> logger;
     WorkerPool &workers;
     /**
@@ -130,6 +188,8 @@ class LSPLoop {
     std::ostream &outputStream;
     /** If true, LSPLoop will skip configatron during type checking */
     const bool skipConfigatron;
+    /** Digest of the configatron files reIndexFromFileSystem entered into initialGS, or empty if it didn't. */
+    std::string configatronDigest;
     /** If true, all queries will hit the slow path. */
     const bool disableFastPath;
     /** The set of files currently open in the user's editor. */
@@ -156,8 +216,97 @@ class LSPLoop {
      * The time that LSP last sent metrics to statsd -- if `opts.statsdHost` was specified.
      */
     std::chrono::time_point<std::chrono::steady_clock> lastMetricUpdateTime;
+    /** The thread sending the last batch of metrics to statsd, if any. */
+    std::unique_ptr<Joinable> statsdSubmitter;
     /** ID of the main thread, which actually processes LSP requests and performs typechecking. */
     std::thread::id mainThreadId;
+    /** Queue of the running `runLSP`, if any. The query thread takes requests from it. */
+    QueueState *activeQueueState = nullptr;
+    /** Guards `*activeQueueState`. */
+    absl::Mutex *activeQueueMtx = nullptr;
+    /** Used by the query thread to typecheck, so that it doesn't wait on a slow path occupying `workers`. */
+    std::unique_ptr<WorkerPool> queryThreadWorkers;
+    /** Serializes writes to `outputStream`, which happen from both the main thread and the query thread. */
+    mutable absl::Mutex outputMtx;
+    /** Responses to a FILE or METHOD query, which answer every LOC query within the part of the file it covers. */
+    struct CachedQueryResponses {
+        core::lsp::Query query;
+        std::vector<std::unique_ptr<core::lsp::QueryResponse>> responses;
+    };
+    /**
+     * Responses to FILE and METHOD queries on each recently queried file, computed against the last committed
+     * GlobalState. LOC queries on these files are answered by filtering them instead of typechecking again. Cleared
+     * whenever a typecheck run is committed. Only used by the thread currently answering queries, see
+     * `lendToQueryThread`.
+     */
+    mutable UnorderedMap<core::FileRef, std::vector<CachedQueryResponses>> queryResponseCache;
+    /** Maximum number of files in `queryResponseCache`. */
+    static constexpr int MAX_QUERY_RESPONSE_CACHE_FILES = 16;
+    /**
+     * For every file that find-all-references has looked at, the locations in it that a SYMBOL query for each symbol
+     * would report. Computed against the last committed GlobalState: a fast path drops the entries of the files it
+     * typechecks, and a slow path drops all of them.
+     */
+    mutable UnorderedMap<core::FileRef, UnorderedMap<core::SymbolRef, std::vector<core::Loc>>> referenceIndex;
+    /** Names of the symbols in the last committed GlobalState, for `workspace/symbol`. */
+    mutable SymbolSearchIndex symbolSearchIndex;
+    /** The symbols `textDocument/documentSymbol` lists at the top level of each file. See `documentSymbolsIn`. */
+    struct DocumentSymbolIndex {
+        // In the order they were entered. Only meaningful if `built`.
+        UnorderedMap<core::FileRef, std::vector<core::SymbolRef>> symbols;
+        bool built = false;
+        // Files a fast path edited since, whose entries must be found again.
+        UnorderedSet<core::FileRef> stale;
+    };
+    /**
+     * Computed against the last committed GlobalState, with one pass over the symbol table for every file at once.
+     * A slow path drops it, and a fast path marks the files it edits stale.
+     */
+    mutable DocumentSymbolIndex documentSymbolIndex;
+    /** A method that completion offers on a class, with what completion shows for it rendered on first use. */
+    struct CompletionMember {
+        core::NameRef name;
+        core::SymbolRef method;
+        // Only rendered for receivers that need no type constraint, since the detail depends on it.
+        std::optional<std::string> detail;
+        bool documentationRendered = false;
+        std::optional<std::string> documentation;
+    };
+    struct CompletionClassMembers {
+        // The methods of the class and its ancestors, one per name, sorted like completion results are.
+        std::vector<CompletionMember> members;
+        // Files that define the class or one of its ancestors. Editing any of them can change `members`.
+        UnorderedSet<core::FileRef> files;
+    };
+    /**
+     * Flattened members of the classes that completion was recently requested on, computed against the last committed
+     * GlobalState. A slow path drops all of them, and a fast path drops the classes defined in the files it edits.
+     */
+    mutable UnorderedMap<core::SymbolRef, CompletionClassMembers> completionMemberIndex;
+    /** Maximum number of classes in `completionMemberIndex`. */
+    static constexpr int MAX_COMPLETION_INDEX_CLASSES = 64;
+    /**
+     * State hashes of files that Watchman reported changed, by path, computed on `workers` as soon as Watchman reports
+     * them and taken by `computeStateHashes` if the file still has the contents they were computed from. See
+     * `prewarmFileHashes`.
+     */
+    struct PrewarmedFileHashes {
+        absl::Mutex mtx;
+        UnorderedMap<std::string, std::pair<std::shared_ptr<core::File>, core::FileHash>> hashes; // guarded by mtx
+    };
+    mutable PrewarmedFileHashes prewarmedFileHashes;
+    /** Watchman updates with fewer files than this are cheap enough to hash when they are typechecked. */
+    static constexpr int MIN_FILES_TO_PREWARM = 16;
+    /**
+     * Bumped by the threads that enqueue requests every time a file update is enqueued. A cancelable slow path
+     * abandons typechecking as soon as it changes, since the update it is typechecking has already been superseded.
+     */
+    const std::shared_ptr<std::atomic<int>> editEpoch = std::make_shared<std::atomic<int>>(0);
+    /**
+     * If true, the last slow path was canceled, so the current finalGS has not been fully typechecked and the next
+     * update must take the slow path.
+     */
+    bool slowPathCanceled = false;
 
     /* Send the given message to client */
     void sendMessage(const LSPMessage &msg) const;
@@ -173,6 +322,18 @@ class LSPLoop {
     /** Invalidate all currently cached trees and re-index them from file system.
      * This runs code that is not considered performance critical and this is expected to be slow */
     void reIndexFromFileSystem();
+    /** If `opts.lspEvictClosedTrees` is set, or the process went over `opts.lspMemoryCeilingMiB`, evicts the trees
+     * `indexed` has for those of `files` that aren't open. */
+    void evictClosedTrees(const std::vector<core::FileRef> &files);
+    /** Gives what the slow path freed back to the OS, and starts evicting closed trees if the process still uses more
+     * than `opts.lspMemoryCeilingMiB`. */
+    void releaseMemoryAfterSlowPath();
+    /** Whether enough of initialGS's names were left behind by edits to be worth `compactNames`. */
+    bool shouldCompactNames() const;
+    /** Rebuilds initialGS from `payloadGS` and the current contents of every file, dropping the names that edits
+     * entered and nothing uses anymore, and then runs the slow path so that the global state queries use is rebuilt
+     * too. Every file keeps its FileRef. */
+    LSPResult compactNames(std::unique_ptr<core::GlobalState> gs);
     struct TypecheckRun {
         std::vector<std::unique_ptr<core::Error>> errors;
         std::vector<core::FileRef> filesTypechecked;
@@ -181,6 +342,17 @@ class LSPLoop {
         // The edit applied to `gs`.
         LSPLoop::FileUpdates updates;
         bool tookFastPath = false;
+        // If true, typechecking was abandoned midway because a newer file update arrived. `errors` is empty, and `gs`
+        // must not be used for the fast path.
+        bool canceled = false;
+        // On the fast path, what typechecking recorded for each file in `filesTypechecked`.
+        UnorderedMap<core::FileRef, pipeline::TypecheckedMethods> typecheckedMethods = {};
+        // On the fast path, the files the edit affects that were left for `typecheckDeferredFiles`.
+        std::vector<core::FileRef> deferredFiles = {};
+        // Why the fast path was or wasn't taken, see `canTakeFastPath`. Empty if the run didn't decide.
+        std::string fastPathDecision = {};
+        // How long each phase of the run took, in milliseconds, in the order they ran.
+        std::vector<std::pair<std::string, double>> phaseTimes = {};
     };
     struct QueryRun {
         std::unique_ptr<core::GlobalState> gs;
@@ -189,22 +361,59 @@ class LSPLoop {
         std::unique_ptr<ResponseError> error = nullptr;
     };
 
-    /** Conservatively rerun entire pipeline without caching any trees */
-    TypecheckRun runSlowPath(FileUpdates updates) const;
-    /** Returns `true` if the given changes can run on the fast path. */
-    bool canTakeFastPath(const FileUpdates &updates, const std::vector<core::FileHash> &hashes) const;
+    /** Conservatively rerun entire pipeline without caching any trees. If `cancelable` is true, typechecking stops early
+     * once a newer file update is enqueued; see `editEpoch`. */
+    TypecheckRun runSlowPath(FileUpdates updates, bool cancelable = false) const;
+    /**
+     * Hands `gs`, the last committed GlobalState, to the query thread, which uses it to answer hover, definition,
+     * completion and document symbol requests on files that `updates` doesn't touch until `reclaimFromQueryThread` is
+     * called. Only the main thread mutates `indexed`, `indexedFinalGS` and `initialGS`, and it must not do so in
+     * between.
+     */
+    void lendToQueryThread(std::unique_ptr<core::GlobalState> gs, const FileUpdates &updates) const;
+    /** Waits for the query thread to finish the request it is answering, if any, and drops the lent GlobalState. */
+    void reclaimFromQueryThread() const;
+    /** Returns true if the request at the front of `state.pendingRequests` can be answered with `querySnapshot`. */
+    static bool canServeFromQuerySnapshot(const QueueState &state);
+    /** Returns `true` if the given changes can run on the fast path, and why or why not in `reason`. */
+    bool canTakeFastPath(const FileUpdates &updates, const std::vector<core::FileHash> &hashes,
+                         std::string &reason) const;
     /** Applies conservative heuristics to see if we can run incremental typechecking on the update. If not, it bails
      * out and takes slow path. */
     TypecheckRun runTypechecking(std::unique_ptr<core::GlobalState> gs, FileUpdates updates) const;
+    /** Indexes and typechecks `subset` on the fast path, on top of `gs` which `updates` were applied to. */
+    TypecheckRun typecheckOnFastPath(std::unique_ptr<core::GlobalState> gs, FileUpdates updates,
+                                     std::vector<core::FileRef> subset,
+                                     UnorderedMap<core::FileRef, pipeline::MethodReuse> methodReuse) const;
+    /** Typechecks the next batch of `deferredFiles` on top of `gs`, and publishes their diagnostics. */
+    LSPResult typecheckDeferredFiles(std::unique_ptr<core::GlobalState> gs);
     /** Runs the provided query against the given files, and returns matches. */
     QueryRun runQuery(std::unique_ptr<core::GlobalState> gs, const core::lsp::Query &q,
                       const std::vector<core::FileRef> &filesForQuery) const;
+    /**
+     * Returns what a LOC query for `loc` would, answering it from `queryResponseCache` where possible. Otherwise, if
+     * `typecheckedMethods` knows which method `loc` is in, only that method is typechecked.
+     */
+    QueryRun runLocQuery(std::unique_ptr<core::GlobalState> gs, core::Loc loc) const;
     /** Officially 'commits' the output of a `TypecheckRun` by updating the relevant state on LSPLoop and, if specified,
      * sending diagnostics to the editor. */
     LSPResult commitTypecheckRun(TypecheckRun run);
+    /**
+     * Publishes diagnostics for the files whose errors changed in `run`. If `opts.lspDiagnosticsCoalesceMs` is set,
+     * they are added to `pendingDiagnostics` instead of the result.
+     */
     LSPResult pushDiagnostics(TypecheckRun run);
+    /** Returns `pendingDiagnostics` in file order, and clears it. */
+    std::vector<std::unique_ptr<LSPMessage>> takePendingDiagnostics();
 
     std::vector<core::FileHash> computeStateHashes(const std::vector<std::shared_ptr<core::File>> &files) const;
+    /**
+     * Reads `files`, which Watchman reported changed, from disk and adds their state hashes to `prewarmed`, so that
+     * the update doesn't have to compute them once the main thread gets to it. Runs on the Watchman thread.
+     */
+    static void prewarmFileHashes(const options::Options &opts, std::string_view rootPath, WorkerPool &workers,
+                                  spdlog::logger &logger, PrewarmedFileHashes &prewarmed,
+                                  const std::vector<std::string> &files);
     bool ensureInitialized(const LSPMethod forMethod, const LSPMessage &msg,
                            const std::unique_ptr<core::GlobalState> &currentGs) const;
 
@@ -221,9 +430,19 @@ class LSPLoop {
     LSPLoop::QueryRun setupLSPQueryByLoc(std::unique_ptr<core::GlobalState> gs, std::string_view uri,
                                          const Position &pos, const LSPMethod forMethod,
                                          bool errorIfFileIsUntyped = true) const;
-    QueryRun setupLSPQueryBySymbol(std::unique_ptr<core::GlobalState> gs, core::SymbolRef symbol) const;
+    /** Replaces the hash of `file` in `globalStateHashes`, and what `nameUsageIndex` has for it. */
+    void setGlobalStateHash(core::FileRef file, core::FileHash hash);
+    /** What `gs` takes, along with what LSP keeps of it between edits. */
+    core::MemoryUsage memoryUsage(const core::GlobalState &gs) const;
+    /** Returns the files that may reference `symbol`, going by their `globalStateHashes`. */
+    std::vector<core::FileRef> filesThatMayReference(const core::GlobalState &gs, core::SymbolRef symbol) const;
+    /** Adds the given files to `referenceIndex`, typechecking the ones that are missing from it. */
+    std::unique_ptr<core::GlobalState> indexReferences(std::unique_ptr<core::GlobalState> gs,
+                                                       const std::vector<core::FileRef> &files) const;
     LSPResult handleTextDocumentHover(std::unique_ptr<core::GlobalState> gs, const MessageId &id,
                                       const TextDocumentPositionParams &params) const;
+    /** Returns the top-level symbols of `fref` from `documentSymbolIndex`, first bringing it up to date. */
+    const std::vector<core::SymbolRef> &documentSymbolsIn(const core::GlobalState &gs, core::FileRef fref) const;
     LSPResult handleTextDocumentDocumentSymbol(std::unique_ptr<core::GlobalState> gs, const MessageId &id,
                                                const DocumentSymbolParams &params) const;
     LSPResult handleWorkspaceSymbols(std::unique_ptr<core::GlobalState> gs, const MessageId &id,
@@ -239,9 +458,13 @@ class LSPLoop {
                                            const CompletionParams &params) const;
     LSPResult handleTextDocumentCodeAction(std::unique_ptr<core::GlobalState> gs, const MessageId &id,
                                            const CodeActionParams &params) const;
+    /** Returns the entry of `klass` in `completionMemberIndex`, computing it if it is missing. */
+    CompletionClassMembers &completionMembers(const core::GlobalState &gs, core::SymbolRef klass) const;
+    /** If `cached` is given, it is `what` in `completionMemberIndex`, and what it has already rendered is reused. */
     std::unique_ptr<CompletionItem> getCompletionItem(const core::GlobalState &gs, core::SymbolRef what,
                                                       core::TypePtr receiverType,
-                                                      const std::unique_ptr<core::TypeConstraint> &constraint) const;
+                                                      const std::unique_ptr<core::TypeConstraint> &constraint,
+                                                      CompletionMember *cached = nullptr) const;
     void findSimilarConstantOrIdent(const core::GlobalState &gs, const core::TypePtr receiverType,
                                     std::vector<std::unique_ptr<CompletionItem>> &items) const;
     void sendShowMessageNotification(MessageType messageType, std::string_view message) const;
@@ -254,6 +477,18 @@ class LSPLoop {
      */
     static void enqueueRequest(const std::shared_ptr<spd::logger> &logger, LSPLoop::QueueState &state,
                                std::unique_ptr<LSPMessage> msg, bool collectThreadCounters = false);
+    /**
+     * Like `enqueueRequest`, but without holding the lock that guards `state`: only starts timing `msg`, and adds it
+     * to `state.handedOff`. The caller must take and release the lock afterwards, so that threads waiting on it
+     * notice. Merging is left to `takeHandedOffRequests`, on the threads that consume the queue.
+     */
+    static void handOffRequest(const std::shared_ptr<spd::logger> &logger, LSPLoop::QueueState &state,
+                               std::unique_ptr<LSPMessage> msg);
+    /** The part of `enqueueRequest` that needs the lock: adds the already timed `msg` to `state`, merging it. */
+    static void enqueueTimedRequest(const std::shared_ptr<spd::logger> &logger, LSPLoop::QueueState &state,
+                                    std::unique_ptr<LSPMessage> msg);
+    /** Enqueues the messages in `state.handedOff`. Must hold the lock that guards `state`. */
+    static void takeHandedOffRequests(const std::shared_ptr<spd::logger> &logger, LSPLoop::QueueState &state);
 
     LSPResult processRequestInternal(std::unique_ptr<core::GlobalState> gs, const LSPMessage &msg);
 
@@ -262,6 +497,8 @@ class LSPLoop {
         std::string contents = "";
         bool newlyOpened = false;
         bool newlyClosed = false;
+        // The line breaks of `contents`, if they were kept up to date while applying changes to it.
+        std::shared_ptr<std::vector<int>> lineBreaks = nullptr;
     };
     void preprocessSorbetWorkspaceEdit(const DidChangeTextDocumentParams &changeParams,
                                        UnorderedMap<std::string, SorbetWorkspaceFileUpdate> &updates) const;
@@ -283,8 +520,6 @@ class LSPLoop {
                                             std::vector<std::unique_ptr<SorbetWorkspaceEdit>> &edits) const;
     TypecheckRun commitSorbetWorkspaceEdits(std::unique_ptr<core::GlobalState> gs,
                                             UnorderedMap<std::string, SorbetWorkspaceFileUpdate> &updates) const;
-    static std::string_view getFileContents(UnorderedMap<std::string, LSPLoop::SorbetWorkspaceFileUpdate> &updates,
-                                            const core::GlobalState &initialGS, std::string_view path);
 
     /** Returns `true` if 5 minutes have elapsed since LSP last sent counters to statsd. */
     bool shouldSendCountersToStatsd(std::chrono::time_point<std::chrono::steady_clock> currentTime) const;
@@ -294,7 +529,8 @@ class LSPLoop {
 public:
     LSPLoop(std::unique_ptr<core::GlobalState> gs, const options::Options &opts,
             const std::shared_ptr<spd::logger> &logger, WorkerPool &workers, int inputFd, std::ostream &output,
-            bool skipConfigatron = false, bool disableFastPath = false);
+            bool skipConfigatron = false, bool disableFastPath = false,
+            std::unique_ptr<KeyValueStore> kvstore = nullptr);
     std::unique_ptr<core::GlobalState> runLSP();
     LSPResult processRequest(std::unique_ptr<core::GlobalState> gs, const LSPMessage &msg);
     LSPResult processRequest(std::unique_ptr<core::GlobalState> gs, const std::string &json);
@@ -317,6 +553,7 @@ std::unique_ptr<Range> loc2Range(const core::GlobalState &gs, core::Loc loc);
 std::unique_ptr<core::Loc> range2Loc(const core::GlobalState &gs, const Range &range, core::FileRef file);
 int cmpPositions(const Position &a, const Position &b);
 int cmpRanges(const Range &a, const Range &b);
+void sortAndDedupeLocations(std::vector<std::unique_ptr<Location>> &locations);
 
 } // namespace sorbet::realmain::lsp
 #endif // RUBY_TYPER_LSPLOOP_H
@@ -182,7 +182,11 @@ LSPLoop::extractLocations(const core::GlobalState &gs,
             }
         }
     }
-    // Dedupe locations
+    sortAndDedupeLocations(locations);
+    return locations;
+}
+
+void sortAndDedupeLocations(vector<unique_ptr<Location>> &locations) {
     fast_sort(locations, [](const unique_ptr<Location> &a, const unique_ptr<Location> &b) -> bool {
         return cmpLocations(*a, *b) < 0;
     });
@@ -191,7 +195,6 @@ LSPLoop::extractLocations(const core::GlobalState &gs,
                                        [](const unique_ptr<Location> &a, const unique_ptr<Location> &b) -> bool {
                                            return cmpLocations(*a, *b) == 0;
                                        })));
-    return locations;
 }
 
 bool hideSymbol(const core::GlobalState &gs, core::SymbolRef sym) {
@@ -1,3 +1,4 @@
+#include "absl/strings/match.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/synchronization/notification.h"
 #include "common/FileOps.h"
@@ -13,68 +14,100 @@ using namespace std;
 namespace sorbet::realmain::lsp {
 
 /**
- * Attempts to read an LSP message from the file descriptor. Returns a nullptr if it fails.
- *
- * Extra bits read are stored into `buffer`.
- *
- * Throws an exception on read error or EOF.
+ * Reads LSP messages from a file descriptor. Once a message's headers have been read, its body is read straight into
+ * the string that `LSPMessage::fromClient` parses in place, so a large message is neither copied out of a shared
+ * buffer nor read again after a read that timed out partway through it.
  */
-unique_ptr<LSPMessage> getNewRequest(const shared_ptr<spd::logger> &logger, int inputFd, string &buffer) {
-    int length = -1;
-    string allRead;
-    {
-        // Break and return if a timeout occurs. Bound loop to prevent infinite looping here. There's typically only two
-        // lines in a header.
-        for (int i = 0; i < 10; i += 1) {
-            auto maybeLine = FileOps::readLineFromFd(inputFd, buffer);
-            if (!maybeLine) {
-                // Line not read. Abort. Store what was read thus far back into buffer
-                // for use in next call to function.
-                buffer = absl::StrCat(allRead, buffer);
-                return nullptr;
+class LSPInputReader {
+    const int inputFd;
+    // Read, but not yet part of a message body. Starts with the headers of the next message, if any.
+    string buffer;
+    // The body of the message whose headers have been read, `bodyRead` bytes of which have been read so far.
+    optional<string> body;
+    size_t bodyRead = 0;
+
+    static constexpr int READ_SIZE = 1024 * 8;
+
+    // Reads whatever is available into `buffer`. Returns false on timeout.
+    bool readIntoBuffer() {
+        auto oldSize = buffer.size();
+        buffer.resize(oldSize + READ_SIZE);
+        int result = FileOps::readFd(inputFd, buffer.data() + oldSize, READ_SIZE);
+        buffer.resize(oldSize + max(result, 0));
+        return result > 0;
+    }
+
+    // Consumes the headers at the start of `buffer` if they are complete, setting `body` to a string of the length
+    // they give. Returns false if more has to be read first.
+    bool readHeaders(spdlog::logger &logger) {
+        size_t lineBegin = 0;
+        int length = -1;
+        // There's typically only two lines in a header.
+        for (int i = 0; i < 10; i++) {
+            auto lineEnd = buffer.find('\n', lineBegin);
+            if (lineEnd == string::npos) {
+                return false;
             }
-            const string &line = *maybeLine;
-            absl::StrAppend(&allRead, line, "\n");
+            string_view line(buffer.data() + lineBegin, lineEnd - lineBegin);
+            lineBegin = lineEnd + 1;
             if (line == "\r") {
                 // End of headers.
                 break;
             }
-            sscanf(line.c_str(), "Content-Length: %i\r", &length);
+            sscanf(string(line).c_str(), "Content-Length: %i\r", &length);
         }
-        logger->trace("final raw read: {}, length: {}", allRead, length);
+        logger.trace("final raw read: {}, length: {}", string_view(buffer.data(), lineBegin), length);
+        buffer.erase(0, lineBegin);
+        if (length < 0) {
+            logger.trace("No \"Content-Length: %i\" header found.");
+            // Throw away what we've read and start over.
+            return false;
+        }
+        // What was read past the headers starts the body.
+        if (buffer.size() <= (size_t)length) {
+            bodyRead = buffer.size();
+            buffer.resize(length);
+            body = move(buffer);
+            buffer = string();
+        } else {
+            bodyRead = length;
+            body = buffer.substr(0, length);
+            buffer.erase(0, length);
+        }
+        return true;
     }
 
-    if (length < 0) {
-        logger->trace("No \"Content-Length: %i\" header found.");
-        // Throw away what we've read and start over.
-        return nullptr;
-    }
+public:
+    LSPInputReader(int inputFd) : inputFd(inputFd) {}
 
-    if (buffer.length() < length) {
-        // Need to read more.
-        int moreNeeded = length - buffer.length();
-        vector<char> buf(moreNeeded);
-        int result = FileOps::readFd(inputFd, buf);
-        if (result > 0) {
-            buffer.append(buf.begin(), buf.begin() + result);
-        }
-        if (result == -1) {
-            Exception::raise("Error reading file or EOF.");
+    /**
+     * Attempts to read an LSP message. Returns a nullptr if a read times out first, or if the headers lacked a length.
+     *
+     * Throws an exception on read error or EOF.
+     */
+    unique_ptr<LSPMessage> read(spdlog::logger &logger) {
+        if (!body) {
+            if (!readHeaders(logger)) {
+                if (!readIntoBuffer() || !readHeaders(logger)) {
+                    return nullptr;
+                }
+            }
         }
-        if (result != moreNeeded) {
-            // Didn't get enough data. Return read data to `buffer`.
-            buffer = absl::StrCat(allRead, buffer);
-            return nullptr;
+        while (bodyRead < body->size()) {
+            int result = FileOps::readFd(inputFd, body->data() + bodyRead, body->size() - bodyRead);
+            if (result == 0) {
+                // Timed out. Keep what was read for the next call.
+                return nullptr;
+            }
+            bodyRead += result;
         }
+        auto json = move(*body);
+        body = nullopt;
+        bodyRead = 0;
+        logger.debug("Read: {}\n", json);
+        return LSPMessage::fromClient(move(json));
     }
-
-    ENFORCE(buffer.length() >= length);
-
-    string json = buffer.substr(0, length);
-    buffer.erase(0, length);
-    logger->debug("Read: {}\n", json);
-    return LSPMessage::fromClient(json);
-}
+};
 
 class NotifyOnDestruction {
     absl::Mutex &mutex;
@@ -100,29 +133,82 @@ public:
     }
 };
 
+// Returns the file of a request about the cursor position, like hover and completion, or "" for other messages.
+string_view cursorRequestUri(const LSPMessage &msg) {
+    if (!msg.isRequest()) {
+        return "";
+    }
+    auto &params = msg.asRequest().params;
+    switch (msg.method()) {
+        case LSPMethod::TextDocumentHover:
+        case LSPMethod::TextDocumentDefinition:
+        case LSPMethod::TextDocumentSignatureHelp:
+            return get<unique_ptr<TextDocumentPositionParams>>(params)->textDocument->uri;
+        case LSPMethod::TextDocumentCompletion:
+            return get<unique_ptr<CompletionParams>>(params)->textDocument->uri;
+        default:
+            return "";
+    }
+}
+
+// Returns true if `msg` only updates files that changed on disk.
+bool isOnlyWatchmanChanges(const LSPMessage &msg) {
+    if (msg.isNotification() && msg.method() == LSPMethod::SorbetWatchmanFileChange) {
+        return true;
+    }
+    if (!msg.isNotification() || msg.method() != LSPMethod::SorbetWorkspaceEdit) {
+        return false;
+    }
+    auto &editParams = get<unique_ptr<SorbetWorkspaceEditParams>>(msg.asNotification().params);
+    return absl::c_all_of(editParams->changes,
+                          [](const auto &edit) { return edit->type == SorbetWorkspaceEditType::FileSystem; });
+}
+
 unique_ptr<core::GlobalState> LSPLoop::runLSP() {
     // Naming convention: thread that executes this function is called coordinator thread
     LSPLoop::QueueState guardedState{{}, false, false, 0};
+    guardedState.editEpoch = editEpoch;
     absl::Mutex mtx;
     absl::Notification initializedNotification;
+    // Merges the reader and Watchman threads' counters into `guardedState.counters`. Must hold `mtx`.
+    auto collectThreadCounters = [](LSPLoop::QueueState &state) {
+        if (!state.counters.hasNullCounters()) {
+            counterConsume(move(state.counters));
+        }
+        state.counters = getAndClearThreadCounters();
+    };
 
     unique_ptr<watchman::WatchmanProcess> watchmanProcess;
     if (!opts.disableWatchman) {
         if (opts.rawInputDirNames.size() == 1 && opts.rawInputFileNames.empty()) {
-            // The lambda below intentionally does not capture `this`.
+            // The lambda below intentionally does not capture `this`, only members that are safe to use from the
+            // Watchman thread.
             watchmanProcess = make_unique<watchman::WatchmanProcess>(
                 logger, opts.watchmanPath, opts.rawInputDirNames.at(0), vector<string>({"rb", "rbi"}),
-                [&guardedState, &mtx, logger = this->logger,
-                 &initializedNotification](std::unique_ptr<WatchmanQueryResponse> response) {
+                [&guardedState, &mtx, logger = this->logger, &initializedNotification, &opts = this->opts,
+                 &rootPath = this->rootPath, &workers = this->workers, &prewarmed = this->prewarmedFileHashes,
+                 settleMs = opts.watchmanSettleMs,
+                 collectThreadCounters](std::unique_ptr<WatchmanQueryResponse> response) {
+                    // Don't start enqueueing requests until LSP is initialized.
+                    initializedNotification.WaitForNotification();
+                    // Large updates, like those of a branch switch, likely take the slow path. Hash their files while
+                    // the main thread finishes whatever it is doing, rather than once it gets to them. The update is
+                    // enqueued afterwards, so that the main thread never hashes the same files at the same time.
+                    if (response->files.size() >= MIN_FILES_TO_PREWARM) {
+                        prewarmFileHashes(opts, rootPath, workers, *logger, prewarmed, response->files);
+                    }
                     auto notifMsg =
                         make_unique<NotificationMessage>("2.0", LSPMethod::SorbetWatchmanFileChange, move(response));
                     auto msg = make_unique<LSPMessage>(move(notifMsg));
-                    // Don't start enqueueing requests until LSP is initialized.
-                    initializedNotification.WaitForNotification();
+                    // Merged with any existing pending watchman file updates once a consumer takes it.
+                    handOffRequest(logger, guardedState, move(msg));
                     {
                         absl::MutexLock lck(&mtx); // guards guardedState
-                        // Merge with any existing pending watchman file updates.
-                        enqueueRequest(logger, guardedState, move(msg), true);
+                        collectThreadCounters(guardedState);
+                        if (settleMs > 0) {
+                            guardedState.watchmanSettleDeadline =
+                                chrono::steady_clock::now() + chrono::milliseconds(settleMs);
+                        }
                     }
                 },
                 [&guardedState, &mtx](int watchmanExitCode) {
@@ -142,25 +228,31 @@ unique_ptr<core::GlobalState> LSPLoop::runLSP() {
     }
 
     auto readerThread =
-        runInAThread("lspReader", [&guardedState, &mtx, logger = this->logger, inputFd = this->inputFd] {
+        runInAThread("lspReader", [&guardedState, &mtx, logger = this->logger, inputFd = this->inputFd,
+                                   collectThreadCounters] {
             // Thread that executes this lambda is called reader thread.
             // This thread _intentionally_ does not capture `this`.
             NotifyOnDestruction notify(mtx, guardedState.terminate);
-            string buffer;
+            LSPInputReader input(inputFd);
             try {
                 auto timeit = make_unique<Timer>(logger, "getNewRequest");
                 while (true) {
-                    auto msg = getNewRequest(logger, inputFd, buffer);
+                    auto msg = input.read(*logger);
+                    bool isExit = false;
+                    if (msg) {
+                        // Parsed and handed off without the lock, so that the main thread doesn't wait on it.
+                        isExit = msg->method() == LSPMethod::Exit;
+                        handOffRequest(logger, guardedState, move(msg));
+                        // Reset span now that we've found a request.
+                        timeit = make_unique<Timer>(logger, "getNewRequest");
+                    }
                     {
+                        // Only held long enough for threads waiting on the queue to notice the message.
                         absl::MutexLock lck(&mtx); // guards guardedState.
-                        if (msg) {
-                            enqueueRequest(logger, guardedState, move(msg), true);
-                            // Reset span now that we've found a request.
-                            timeit = make_unique<Timer>(logger, "getNewRequest");
-                        }
+                        collectThreadCounters(guardedState);
                         // Check if it's time to exit.
-                        if (guardedState.terminate) {
-                            // Another thread exited.
+                        if (guardedState.terminate || isExit) {
+                            // Another thread exited, or the client is about to.
                             break;
                         }
                     }
@@ -171,22 +263,99 @@ unique_ptr<core::GlobalState> LSPLoop::runLSP() {
         });
 
     mainThreadId = this_thread::get_id();
+    activeQueueState = &guardedState;
+    activeQueueMtx = &mtx;
+
+    // Answers hover, definition, completion and document symbol requests from `guardedState.querySnapshot` while the
+    // main thread is busy with a slow path. See `lendToQueryThread`.
+    auto queryThread = runInAThread("lspQuery", [this, &guardedState, &mtx] {
+        while (true) {
+            unique_ptr<LSPMessage> msg;
+            unique_ptr<core::GlobalState> gs;
+            {
+                absl::MutexLock lck(&mtx);
+                while (true) {
+                    mtx.Await(absl::Condition(
+                        +[](LSPLoop::QueueState *guardedState) -> bool {
+                            return guardedState->terminate || guardedState->handedOffCount > 0 ||
+                                   canServeFromQuerySnapshot(*guardedState);
+                        },
+                        &guardedState));
+                    // The main thread may be busy with a slow path, so take what has been handed off meanwhile.
+                    takeHandedOffRequests(logger, guardedState);
+                    if (guardedState.terminate || canServeFromQuerySnapshot(guardedState)) {
+                        break;
+                    }
+                }
+                if (guardedState.terminate) {
+                    break;
+                }
+                msg = move(guardedState.pendingRequests.front());
+                guardedState.pendingRequests.pop_front();
+                gs = move(guardedState.querySnapshot);
+                guardedState.servingQuery = true;
+            }
+            // Error queues can only be drained by the thread that created them.
+            auto mainErrorQueue = gs->errorQueue;
+            auto queryErrorQueue = make_shared<core::ErrorQueue>(mainErrorQueue->logger, mainErrorQueue->tracer);
+            queryErrorQueue->ignoreFlushes = true;
+            gs->errorQueue = queryErrorQueue;
+
+            prodCounterInc("lsp.messages.received");
+            prodCounterInc("lsp.messages.served_from_snapshot");
+            auto result = processRequest(move(gs), *msg);
+            gs = move(result.gs);
+            for (auto &msg : result.responses) {
+                sendMessage(*msg);
+            }
+            gs->errorQueue = mainErrorQueue;
+
+            {
+                absl::MutexLock lck(&mtx);
+                guardedState.querySnapshot = move(gs);
+                guardedState.servingQuery = false;
+                // Merge counters from this thread.
+                if (!guardedState.counters.hasNullCounters()) {
+                    counterConsume(move(guardedState.counters));
+                }
+                guardedState.counters = getAndClearThreadCounters();
+            }
+        }
+    });
+
     unique_ptr<core::GlobalState> gs;
     {
         // Ensure Watchman thread gets unstuck when thread exits.
         NotifyNotificationOnDestruction notify(initializedNotification);
+        // Ensure the query thread exits, too.
+        NotifyOnDestruction notifyQueryThread(mtx, guardedState.terminate);
         while (true) {
             unique_ptr<LSPMessage> msg;
             bool hasMoreMessages;
             {
                 absl::MutexLock lck(&mtx);
                 Timer timeit(logger, "idle");
-                mtx.Await(absl::Condition(
-                    +[](LSPLoop::QueueState *guardedState) -> bool {
-                        return guardedState->terminate ||
-                               (!guardedState->paused && !guardedState->pendingRequests.empty());
-                    },
-                    &guardedState));
+                while (true) {
+                    mtx.Await(absl::Condition(
+                        +[](LSPLoop::QueueState *guardedState) -> bool {
+                            return guardedState->terminate || guardedState->handedOffCount > 0 ||
+                                   (!guardedState->paused && !guardedState->pendingRequests.empty());
+                        },
+                        &guardedState));
+                    takeHandedOffRequests(logger, guardedState);
+                    if (!guardedState.terminate && (guardedState.paused || guardedState.pendingRequests.empty())) {
+                        continue;
+                    }
+                    // Watchman reports the changes of e.g. a branch switch in several bursts. Wait for the rest of them
+                    // rather than starting a slow path for each, unless editor changes are waiting along with them.
+                    auto now = chrono::steady_clock::now();
+                    if (guardedState.terminate || now >= guardedState.watchmanSettleDeadline ||
+                        !isOnlyWatchmanChanges(*guardedState.pendingRequests.front())) {
+                        break;
+                    }
+                    mtx.AwaitWithTimeout(absl::Condition(&guardedState.terminate),
+                                         absl::FromChrono(guardedState.watchmanSettleDeadline - now));
+                }
                 ENFORCE(!guardedState.paused);
                 if (guardedState.terminate) {
                     if (guardedState.errorCode != 0) {
@@ -199,7 +368,7 @@ unique_ptr<core::GlobalState> LSPLoop::runLSP() {
                 }
                 msg = move(guardedState.pendingRequests.front());
                 guardedState.pendingRequests.pop_front();
-                hasMoreMessages = !guardedState.pendingRequests.empty();
+                hasMoreMessages = !guardedState.pendingRequests.empty() || guardedState.handedOffCount > 0;
             }
             prodCounterInc("lsp.messages.received");
             auto result = processRequest(move(gs), *msg);
@@ -208,6 +377,36 @@ unique_ptr<core::GlobalState> LSPLoop::runLSP() {
                 sendMessage(*msg);
             }
 
+            auto isIdle = [&]() -> bool {
+                absl::MutexLock lck(&mtx);
+                return guardedState.pendingRequests.empty() && guardedState.handedOffCount <= 0;
+            };
+            if (!hasMoreMessages && shouldCompactNames() && isIdle()) {
+                auto result = compactNames(move(gs));
+                gs = move(result.gs);
+                for (auto &msg : result.responses) {
+                    sendMessage(*msg);
+                }
+            }
+            // Checked between batches, so that a request doesn't wait for all of them.
+            while (!deferredFiles.empty() && isIdle()) {
+                auto result = typecheckDeferredFiles(move(gs));
+                gs = move(result.gs);
+                for (auto &msg : result.responses) {
+                    sendMessage(*msg);
+                }
+            }
+
+            if (!pendingDiagnostics.empty()) {
+                // Keep holding diagnostics back while edits that may replace them are queued, but no longer than
+                // `opts.lspDiagnosticsCoalesceMs`.
+                if (isIdle() || chrono::steady_clock::now() >= pendingDiagnosticsDeadline) {
+                    for (auto &msg : takePendingDiagnostics()) {
+                        sendMessage(*msg);
+                    }
+                }
+            }
+
             if (initialized && !initializedNotification.HasBeenNotified()) {
                 initializedNotification.Notify();
             }
@@ -221,6 +420,8 @@ unique_ptr<core::GlobalState> LSPLoop::runLSP() {
                         counterConsume(move(guardedState.counters));
                     }
                 }
+                // RSS alone doesn't tell what a long-running server's memory grows with.
+                memoryUsage(gs ? *gs : *initialGS).addToCounters();
                 sendCountersToStatsd(currentTime);
             }
             if (!hasMoreMessages) {
@@ -229,6 +430,8 @@ unique_ptr<core::GlobalState> LSPLoop::runLSP() {
         }
     }
 
+    activeQueueState = nullptr;
+    activeQueueMtx = nullptr;
     if (gs) {
         return gs;
     } else {
@@ -236,6 +439,23 @@ unique_ptr<core::GlobalState> LSPLoop::runLSP() {
     }
 }
 
+bool LSPLoop::canServeFromQuerySnapshot(const LSPLoop::QueueState &state) {
+    if (state.paused || state.querySnapshot == nullptr || state.pendingRequests.empty()) {
+        return false;
+    }
+    auto &msg = *state.pendingRequests.front();
+    // Signature help isn't answered from the snapshot.
+    if (msg.method() == LSPMethod::TextDocumentSignatureHelp) {
+        return false;
+    }
+    auto uri = cursorRequestUri(msg);
+    if (msg.isRequest() && msg.method() == LSPMethod::TextDocumentDocumentSymbol) {
+        // Also served from the snapshot, so that outlines don't wait for the slow path either.
+        uri = get<unique_ptr<DocumentSymbolParams>>(msg.asRequest().params)->textDocument->uri;
+    }
+    return !uri.empty() && !state.querySnapshotStaleUris.contains(uri);
+}
+
 /**
  * Returns true if the given message's contents have been merged with the arguments of this function.
  */
@@ -331,6 +551,7 @@ void mergeFileChanges(deque<unique_ptr<LSPMessage>> &pendingRequests) {
             int firstMergedCounter = (*it)->counter;
             auto firstMergedTracers = move((*it)->startTracers);
             auto firstMergedTimers = move((*it)->timers);
+            auto firstMergedEnqueuedAt = (*it)->enqueuedAt;
             it = pendingRequests.erase(it);
             int skipped = 0;
             while (it != pendingRequests.end()) {
@@ -357,6 +578,7 @@ void mergeFileChanges(deque<unique_ptr<LSPMessage>> &pendingRequests) {
             mergedMessage->startTracers = firstMergedTracers;
             mergedMessage->counter = firstMergedCounter;
             mergedMessage->timers = move(firstMergedTimers);
+            mergedMessage->enqueuedAt = firstMergedEnqueuedAt;
             // Return to where first message was found.
             it -= skipped;
             // Replace first message with the merged message, and skip back ahead to where we were.
@@ -368,6 +590,81 @@ void mergeFileChanges(deque<unique_ptr<LSPMessage>> &pendingRequests) {
     ENFORCE(pendingRequests.size() + requestsMergedCounter == originalSize);
 }
 
+/**
+ * How urgently a queued message should be processed. Messages are processed in the order they arrive, except that a
+ * request the user is waiting on at the cursor moves ahead of queued updates to files on disk and background requests,
+ * as long as they don't change the file it is about.
+ */
+enum class QueuePriority {
+    // Requests about the cursor position, like hover and completion.
+    Interactive,
+    // Changes to files open in the editor, and every other message that nothing is moved ahead of.
+    Ordered,
+    // Changes to files on disk, which don't change the contents of files open in the editor.
+    FileSystemUpdate,
+    // Requests editors and tools make on their own, and messages that are skipped anyway.
+    Background,
+};
+
+QueuePriority queuePriority(const LSPMessage &msg) {
+    if (msg.isResponse() || msg.canceled) {
+        return QueuePriority::Background;
+    }
+    if (!cursorRequestUri(msg).empty()) {
+        return QueuePriority::Interactive;
+    }
+    if (isOnlyWatchmanChanges(msg)) {
+        return QueuePriority::FileSystemUpdate;
+    }
+    switch (msg.method()) {
+        case LSPMethod::TextDocumentDocumentSymbol:
+        case LSPMethod::WorkspaceSymbol:
+        case LSPMethod::SorbetMemoryReport:
+            return QueuePriority::Background;
+        default:
+            return QueuePriority::Ordered;
+    }
+}
+
+// Returns true if the file system update `msg` lists the file `uri` refers to.
+bool updatesFile(const LSPMessage &msg, string_view uri) {
+    auto listsFile = [uri](const WatchmanQueryResponse &response) -> bool {
+        // Watchman reports paths relative to the workspace root.
+        return absl::c_any_of(response.files, [uri](const string &file) -> bool {
+            return uri.size() > file.size() && absl::EndsWith(uri, file) && uri[uri.size() - file.size() - 1] == '/';
+        });
+    };
+    auto &params = msg.asNotification().params;
+    if (msg.method() == LSPMethod::SorbetWatchmanFileChange) {
+        return listsFile(*get<unique_ptr<WatchmanQueryResponse>>(params));
+    }
+    return absl::c_any_of(get<unique_ptr<SorbetWorkspaceEditParams>>(params)->changes, [&](const auto &edit) -> bool {
+        return listsFile(*get<unique_ptr<WatchmanQueryResponse>>(edit->contents));
+    });
+}
+
+// Moves the request at the back of `pendingRequests` ahead of the queued messages it takes priority over.
+void prioritizeLastRequest(deque<unique_ptr<LSPMessage>> &pendingRequests) {
+    if (pendingRequests.empty() || queuePriority(*pendingRequests.back()) != QueuePriority::Interactive) {
+        return;
+    }
+    auto uri = cursorRequestUri(*pendingRequests.back());
+    auto it = pendingRequests.end() - 1;
+    while (it != pendingRequests.begin()) {
+        auto &previous = **(it - 1);
+        auto priority = queuePriority(previous);
+        if (priority <= QueuePriority::Ordered ||
+            (priority == QueuePriority::FileSystemUpdate && updatesFile(previous, uri))) {
+            break;
+        }
+        it--;
+    }
+    if (it != pendingRequests.end() - 1) {
+        prodCounterInc("lsp.messages.prioritized");
+        rotate(it, pendingRequests.end() - 1, pendingRequests.end());
+    }
+}
+
 void cancelRequest(std::deque<std::unique_ptr<LSPMessage>> &pendingRequests, const CancelParams &cancelParams) {
     for (auto &current : pendingRequests) {
         if (current->isRequest()) {
@@ -383,12 +680,38 @@ void cancelRequest(std::deque<std::unique_ptr<LSPMessage>> &pendingRequests, con
     // and ignore.
 }
 
+namespace {
+// Starts timing `msg`, and lets a slow path that is currently running know if `msg` supersedes it.
+void startTiming(const shared_ptr<spd::logger> &logger, const shared_ptr<atomic<int>> &editEpoch, LSPMessage &msg) {
+    Timer timeit(logger, "enqueueRequest");
+    msg.startTracers.push_back(timeit.getFlowEdge());
+    msg.timers.push_back(make_unique<Timer>(logger, "processing_time"));
+    msg.enqueuedAt = chrono::steady_clock::now();
+
+    const LSPMethod method = msg.method();
+    if (editEpoch && (method == LSPMethod::TextDocumentDidOpen || method == LSPMethod::TextDocumentDidChange ||
+                      method == LSPMethod::TextDocumentDidClose || method == LSPMethod::SorbetWatchmanFileChange)) {
+        editEpoch->fetch_add(1);
+    }
+}
+} // namespace
+
 void LSPLoop::enqueueRequest(const shared_ptr<spd::logger> &logger, LSPLoop::QueueState &state,
                              std::unique_ptr<LSPMessage> msg, bool collectThreadCounters) {
-    Timer timeit(logger, "enqueueRequest");
+    startTiming(logger, state.editEpoch, *msg);
+    enqueueTimedRequest(logger, state, move(msg));
+
+    if (collectThreadCounters) {
+        if (!state.counters.hasNullCounters()) {
+            counterConsume(move(state.counters));
+        }
+        state.counters = getAndClearThreadCounters();
+    }
+}
+
+void LSPLoop::enqueueTimedRequest(const shared_ptr<spd::logger> &logger, LSPLoop::QueueState &state,
+                                  std::unique_ptr<LSPMessage> msg) {
     msg->counter = state.requestCounter++;
-    msg->startTracers.push_back(timeit.getFlowEdge());
-    msg->timers.push_back(make_unique<Timer>(logger, "processing_time"));
 
     const LSPMethod method = msg->method();
     if (method == LSPMethod::$CancelRequest) {
@@ -412,13 +735,26 @@ void LSPLoop::enqueueRequest(const shared_ptr<spd::logger> &logger, LSPLoop::Que
     } else {
         state.pendingRequests.push_back(move(msg));
         mergeFileChanges(state.pendingRequests);
+        prioritizeLastRequest(state.pendingRequests);
     }
+}
 
-    if (collectThreadCounters) {
-        if (!state.counters.hasNullCounters()) {
-            counterConsume(move(state.counters));
-        }
-        state.counters = getAndClearThreadCounters();
+void LSPLoop::handOffRequest(const shared_ptr<spd::logger> &logger, LSPLoop::QueueState &state,
+                             std::unique_ptr<LSPMessage> msg) {
+    startTiming(logger, state.editEpoch, *msg);
+    state.handedOff.push(move(msg), 1);
+    state.handedOffCount.fetch_add(1, std::memory_order_release);
+}
+
+void LSPLoop::takeHandedOffRequests(const shared_ptr<spd::logger> &logger, LSPLoop::QueueState &state) {
+    if (state.handedOffCount.load(std::memory_order_acquire) <= 0) {
+        return;
+    }
+    Timer timeit(logger, "takeHandedOffRequests");
+    unique_ptr<LSPMessage> msg;
+    while (state.handedOff.try_pop(msg).gotItem()) {
+        state.handedOffCount.fetch_sub(1, std::memory_order_relaxed);
+        enqueueTimedRequest(logger, state, move(msg));
     }
 }
 
@@ -456,10 +792,14 @@ void LSPLoop::sendMessage(const LSPMessage &msg) const {
     } else if (msg.isNotification()) {
         ENFORCE(isServerNotification(msg.method()));
     }
-    auto json = msg.toJSON();
-    string outResult = fmt::format("Content-Length: {}\r\n\r\n{}", json.length(), json);
+    // Serialize straight into a single buffer. It can't go to `outputStream` directly, since the header needs its size.
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    msg.writeJSON(writer);
+    string_view json(buffer.GetString(), buffer.GetSize());
     logger->debug("Write: {}\n", json);
-    outputStream << outResult << flush;
+    absl::MutexLock lck(&outputMtx);
+    outputStream << "Content-Length: " << json.length() << "\r\n\r\n" << json << flush;
 }
 
 } // namespace sorbet::realmain::lsp
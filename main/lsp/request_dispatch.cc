@@ -15,7 +15,13 @@ LSPResult LSPLoop::processRequest(unique_ptr<core::GlobalState> gs, const string
 LSPResult LSPLoop::processRequest(unique_ptr<core::GlobalState> gs, const LSPMessage &msg) {
     // TODO(jvilk): Make Timer accept multiple FlowIds so we can show merged messages correctly.
     Timer timeit(logger, "process_request");
-    return processRequestInternal(move(gs), msg);
+    const auto start = chrono::steady_clock::now();
+    auto result = processRequestInternal(move(gs), msg);
+    const auto end = chrono::steady_clock::now();
+    logger->debug("{} waited {:.1f}ms in the queue and took {:.1f}ms", convertLSPMethodToString(msg.method()),
+                  chrono::duration<double, milli>(start - msg.enqueuedAt).count(),
+                  chrono::duration<double, milli>(end - start).count());
+    return result;
 }
 
 LSPResult LSPLoop::processRequests(unique_ptr<core::GlobalState> gs, vector<unique_ptr<LSPMessage>> messages) {
@@ -99,7 +105,13 @@ LSPResult LSPLoop::processRequestInternal(unique_ptr<core::GlobalState> gs, cons
             ENFORCE(result.gs);
             if (!disableFastPath) {
                 ShowOperation stateHashOp(*this, "GlobalStateHash", "Finishing initialization...");
-                this->globalStateHashes = computeStateHashes(result.gs->getFiles());
+                auto hashes = computeStateHashes(result.gs->getFiles());
+                globalStateHashes.clear();
+                usageHashInterner.clear();
+                nameUsageIndex.clear();
+                for (int i = 0; i < hashes.size(); i++) {
+                    setGlobalStateHash(core::FileRef(i), move(hashes[i]));
+                }
             }
             initialized = true;
             return result;
@@ -173,7 +185,7 @@ LSPResult LSPLoop::processRequestInternal(unique_ptr<core::GlobalState> gs, cons
             }
 
             auto serverCap = make_unique<ServerCapabilities>();
-            serverCap->textDocumentSync = TextDocumentSyncKind::Full;
+            serverCap->textDocumentSync = TextDocumentSyncKind::Incremental;
             serverCap->definitionProvider = true;
             serverCap->documentSymbolProvider = opts.lspDocumentSymbolEnabled;
             serverCap->workspaceSymbolProvider = opts.lspWorkspaceSymbolsEnabled;
@@ -236,6 +248,12 @@ LSPResult LSPLoop::processRequestInternal(unique_ptr<core::GlobalState> gs, cons
                     fmt::format("Did not find file at uri {} in {}", params->uri, convertLSPMethodToString(method)));
             }
             return LSPResult::make(move(gs), move(response));
+        } else if (method == LSPMethod::SorbetMemoryReport) {
+            prodCategoryCounterInc("lsp.messages.processed", "sorbet/memoryReport");
+            auto usage = memoryUsage(*gs);
+            response->result = make_unique<SorbetMemoryReport>(
+                usage.names / 1024, usage.strings / 1024, usage.symbols / 1024, usage.files / 1024,
+                usage.types / 1024, usage.trees / 1024, usage.fileHashes / 1024, usage.total() / 1024);
         } else if (method == LSPMethod::Shutdown) {
             prodCategoryCounterInc("lsp.messages.processed", "shutdown");
             response->result = JSONNullObject();
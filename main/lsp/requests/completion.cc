@@ -68,6 +68,62 @@ UnorderedMap<core::NameRef, vector<core::SymbolRef>> findSimilarMethodsIn(const
     return result;
 }
 
+namespace {
+void collectCompletionMembers(const core::GlobalState &gs, core::SymbolRef klass,
+                              UnorderedMap<core::NameRef, core::SymbolRef> &methods,
+                              UnorderedSet<core::FileRef> &files) {
+    const auto &data = klass.data(gs);
+    for (auto &loc : data->locs()) {
+        files.insert(loc.file());
+    }
+    for (auto member : data->members()) {
+        auto sym = member.second;
+        if (sym.data(gs)->isMethod()) {
+            // Like `findSimilarMethodsIn`, offer the earliest entered method of each name.
+            auto &method = methods[sym.data(gs)->name];
+            if (!method.exists() || sym._id < method._id) {
+                method = sym;
+            }
+        }
+    }
+    for (auto mixin : data->mixins()) {
+        collectCompletionMembers(gs, mixin, methods, files);
+    }
+    if (data->superClass().exists()) {
+        collectCompletionMembers(gs, data->superClass(), methods, files);
+    }
+}
+} // namespace
+
+LSPLoop::CompletionClassMembers &LSPLoop::completionMembers(const core::GlobalState &gs, core::SymbolRef klass) const {
+    auto it = completionMemberIndex.find(klass);
+    if (it != completionMemberIndex.end()) {
+        prodCounterInc("lsp.completion.member_index.hit");
+        return it->second;
+    }
+    prodCounterInc("lsp.completion.member_index.miss");
+    if (completionMemberIndex.size() >= MAX_COMPLETION_INDEX_CLASSES) {
+        completionMemberIndex.clear();
+    }
+
+    CompletionClassMembers entry;
+    UnorderedMap<core::NameRef, core::SymbolRef> methods;
+    collectCompletionMembers(gs, klass, methods, entry.files);
+    entry.members.reserve(methods.size());
+    for (auto &[name, method] : methods) {
+        entry.members.push_back(CompletionMember{name, method});
+    }
+    fast_sort(entry.members, [&](const auto &left, const auto &right) -> bool {
+        auto leftShortName = left.name.data(gs)->shortName(gs);
+        auto rightShortName = right.name.data(gs)->shortName(gs);
+        if (leftShortName != rightShortName) {
+            return leftShortName < rightShortName;
+        }
+        return left.name._id < right.name._id;
+    });
+    return completionMemberIndex.emplace(klass, move(entry)).first->second;
+}
+
 string methodSnippet(const core::GlobalState &gs, core::SymbolRef method) {
     auto shortName = method.data(gs)->name.data(gs)->shortName(gs);
     vector<string> typeAndArgNames;
@@ -201,8 +257,10 @@ optional<string> findDocumentation(string_view sourceCode, int beginIndex) {
 
 unique_ptr<CompletionItem> LSPLoop::getCompletionItem(const core::GlobalState &gs, core::SymbolRef what,
                                                       core::TypePtr receiverType,
-                                                      const unique_ptr<core::TypeConstraint> &constraint) const {
+                                                      const unique_ptr<core::TypeConstraint> &constraint,
+                                                      CompletionMember *cached) const {
     ENFORCE(what.exists());
+    ENFORCE(cached == nullptr || cached->method == what);
     auto item = make_unique<CompletionItem>(string(what.data(gs)->name.data(gs)->shortName(gs)));
     auto resultType = what.data(gs)->resultType;
     if (!resultType) {
@@ -210,7 +268,12 @@ unique_ptr<CompletionItem> LSPLoop::getCompletionItem(const core::GlobalState &g
     }
     if (what.data(gs)->isMethod()) {
         item->kind = CompletionItemKind::Function;
-        if (what.exists()) {
+        if (cached != nullptr && constraint == nullptr) {
+            if (!cached->detail) {
+                cached->detail = methodDetail(gs, what, receiverType, nullptr, constraint);
+            }
+            item->detail = cached->detail;
+        } else {
             item->detail = methodDetail(gs, what, receiverType, nullptr, constraint);
         }
         if (clientCompletionItemSnippetSupport) {
@@ -222,9 +285,17 @@ unique_ptr<CompletionItem> LSPLoop::getCompletionItem(const core::GlobalState &g
         }
 
         optional<string> documentation = nullopt;
-        if (what.data(gs)->loc().file().exists()) {
-            documentation =
-                findDocumentation(what.data(gs)->loc().file().data(gs).source(), what.data(gs)->loc().beginPos());
+        if (cached != nullptr && cached->documentationRendered) {
+            documentation = cached->documentation;
+        } else {
+            if (what.data(gs)->loc().file().exists()) {
+                documentation =
+                    findDocumentation(what.data(gs)->loc().file().data(gs).source(), what.data(gs)->loc().beginPos());
+            }
+            if (cached != nullptr) {
+                cached->documentationRendered = true;
+                cached->documentation = documentation;
+            }
         }
         if (documentation) {
             if (documentation->find("@deprecated") != documentation->npos) {
@@ -291,24 +362,35 @@ LSPResult LSPLoop::handleTextDocumentCompletion(unique_ptr<core::GlobalState> gs
                 auto pattern = sendResp->callerSideName.data(*gs)->shortName(*gs);
                 auto receiverType = sendResp->dispatchResult->main.receiver;
                 logger->debug("Looking for method similar to {}", pattern);
-                UnorderedMap<core::NameRef, vector<core::SymbolRef>> methods =
-                    findSimilarMethodsIn(*gs, receiverType, pattern);
-                vector<pair<core::NameRef, vector<core::SymbolRef>>> methodsSorted;
-                methodsSorted.insert(methodsSorted.begin(), make_move_iterator(methods.begin()),
-                                     make_move_iterator(methods.end()));
-                fast_sort(methodsSorted, [&](auto leftPair, auto rightPair) -> bool {
-                    auto leftShortName = leftPair.first.data(*gs)->shortName(*gs);
-                    auto rightShortName = rightPair.first.data(*gs)->shortName(*gs);
-                    if (leftShortName != rightShortName) {
-                        return leftShortName < rightShortName;
+                if (auto klass = core::cast_type<core::ClassType>(receiverType.get())) {
+                    // The common case: filter the receiver's flattened members by name before rendering any of them.
+                    auto &index = completionMembers(*gs, klass->symbol);
+                    for (auto &member : index.members) {
+                        if (hasSimilarName(*gs, member.name, pattern)) {
+                            items.push_back(getCompletionItem(*gs, member.method, receiverType,
+                                                              sendResp->dispatchResult->main.constr, &member));
+                        }
                     }
-                    return leftPair.first._id < rightPair.first._id;
-                });
-                for (auto &entry : methodsSorted) {
-                    if (entry.second[0].exists()) {
-                        fast_sort(entry.second, [&](auto lhs, auto rhs) -> bool { return lhs._id < rhs._id; });
-                        items.push_back(getCompletionItem(*gs, entry.second[0], receiverType,
-                                                          sendResp->dispatchResult->main.constr));
+                } else {
+                    UnorderedMap<core::NameRef, vector<core::SymbolRef>> methods =
+                        findSimilarMethodsIn(*gs, receiverType, pattern);
+                    vector<pair<core::NameRef, vector<core::SymbolRef>>> methodsSorted;
+                    methodsSorted.insert(methodsSorted.begin(), make_move_iterator(methods.begin()),
+                                         make_move_iterator(methods.end()));
+                    fast_sort(methodsSorted, [&](auto leftPair, auto rightPair) -> bool {
+                        auto leftShortName = leftPair.first.data(*gs)->shortName(*gs);
+                        auto rightShortName = rightPair.first.data(*gs)->shortName(*gs);
+                        if (leftShortName != rightShortName) {
+                            return leftShortName < rightShortName;
+                        }
+                        return leftPair.first._id < rightPair.first._id;
+                    });
+                    for (auto &entry : methodsSorted) {
+                        if (entry.second[0].exists()) {
+                            fast_sort(entry.second, [&](auto lhs, auto rhs) -> bool { return lhs._id < rhs._id; });
+                            items.push_back(getCompletionItem(*gs, entry.second[0], receiverType,
+                                                              sendResp->dispatchResult->main.constr));
+                        }
                     }
                 }
             } else if (auto identResp = resp->isIdent()) {
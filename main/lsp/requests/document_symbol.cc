@@ -1,3 +1,4 @@
+#include "common/Timer.h"
 #include "core/lsp/QueryResponse.h"
 #include "main/lsp/lsp.h"
 
@@ -67,6 +68,42 @@ std::unique_ptr<DocumentSymbol> symbolRef2DocumentSymbol(const core::GlobalState
     return result;
 }
 
+const vector<core::SymbolRef> &LSPLoop::documentSymbolsIn(const core::GlobalState &gs, core::FileRef fref) const {
+    auto &index = documentSymbolIndex;
+    if (!index.built || !index.stale.empty()) {
+        Timer timeit(logger, "indexDocumentSymbols");
+        const bool allFiles = !index.built;
+        if (allFiles) {
+            index.symbols.clear();
+        }
+        for (auto file : index.stale) {
+            index.symbols.erase(file);
+        }
+        for (u4 idx = 1; idx < gs.symbolsUsed(); idx++) {
+            core::SymbolRef ref(gs, idx);
+            if (hideSymbol(gs, ref)) {
+                continue;
+            }
+            auto ownerFile = ref.data(gs)->owner.data(gs)->loc().file();
+            for (auto definitionLocation : ref.data(gs)->locs()) {
+                auto file = definitionLocation.file();
+                // a bit counter-intuitive, but this actually should be `!= file`, as it prevents duplicates.
+                if (!file.exists() || (ownerFile == file && ref.data(gs)->owner != core::Symbols::root()) ||
+                    !(allFiles || index.stale.contains(file))) {
+                    continue;
+                }
+                auto &symbols = index.symbols[file];
+                if (symbols.empty() || symbols.back() != ref) {
+                    symbols.emplace_back(ref);
+                }
+            }
+        }
+        index.built = true;
+        index.stale.clear();
+    }
+    return index.symbols[fref];
+}
+
 LSPResult LSPLoop::handleTextDocumentDocumentSymbol(unique_ptr<core::GlobalState> gs, const MessageId &id,
                                                     const DocumentSymbolParams &params) const {
     auto response = make_unique<ResponseMessage>("2.0", id, LSPMethod::TextDocumentDocumentSymbol);
@@ -81,19 +118,11 @@ LSPResult LSPLoop::handleTextDocumentDocumentSymbol(unique_ptr<core::GlobalState
     vector<unique_ptr<DocumentSymbol>> result;
     string_view uri = params.textDocument->uri;
     auto fref = uri2FileRef(uri);
-    for (u4 idx = 1; idx < gs->symbolsUsed(); idx++) {
-        core::SymbolRef ref(gs.get(), idx);
-        if (!hideSymbol(*gs, ref) &&
-            // a bit counter-intuitive, but this actually should be `!= fref`, as it prevents duplicates.
-            (ref.data(*gs)->owner.data(*gs)->loc().file() != fref || ref.data(*gs)->owner == core::Symbols::root())) {
-            for (auto definitionLocation : ref.data(*gs)->locs()) {
-                if (definitionLocation.file() == fref) {
-                    auto data = symbolRef2DocumentSymbol(*gs, ref, fref);
-                    if (data) {
-                        result.push_back(move(data));
-                        break;
-                    }
-                }
+    if (fref.exists()) {
+        for (auto ref : documentSymbolsIn(*gs, fref)) {
+            auto data = symbolRef2DocumentSymbol(*gs, ref, fref);
+            if (data) {
+                result.push_back(move(data));
             }
         }
     }
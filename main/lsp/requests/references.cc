@@ -10,9 +10,18 @@ pair<unique_ptr<core::GlobalState>, vector<unique_ptr<Location>>>
 LSPLoop::getReferencesToSymbol(unique_ptr<core::GlobalState> gs, core::SymbolRef symbol,
                                vector<unique_ptr<Location>> locations) const {
     if (symbol.exists()) {
-        auto run2 = setupLSPQueryBySymbol(move(gs), symbol);
-        gs = move(run2.gs);
-        locations = extractLocations(*gs, run2.responses, move(locations));
+        auto files = filesThatMayReference(*gs, symbol);
+        gs = indexReferences(move(gs), files);
+        for (auto file : files) {
+            auto &fileReferences = referenceIndex.at(file);
+            auto it = fileReferences.find(symbol);
+            if (it != fileReferences.end()) {
+                for (auto loc : it->second) {
+                    addLocIfExists(*gs, locations, loc);
+                }
+            }
+        }
+        sortAndDedupeLocations(locations);
     }
     return make_pair(move(gs), move(locations));
 }
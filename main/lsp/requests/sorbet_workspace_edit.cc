@@ -1,5 +1,6 @@
 #include "absl/strings/match.h"
 #include "common/FileOps.h"
+#include "common/Timer.h"
 #include "core/lsp/QueryResponse.h"
 #include "main/lsp/lsp.h"
 
@@ -19,18 +20,16 @@ string readFile(string_view path, const FileSystem &fs) {
     }
 }
 
-string_view LSPLoop::getFileContents(UnorderedMap<string, LSPLoop::SorbetWorkspaceFileUpdate> &updates,
-                                     const core::GlobalState &initialGS, string_view path) {
-    if (updates.find(path) != updates.end()) {
-        return updates[path].contents;
-    }
-
-    auto currentFileRef = initialGS.findFileByPath(path);
-    if (currentFileRef.exists()) {
-        return currentFileRef.data(initialGS).source();
-    } else {
-        return "";
+// Reads all of `paths` on `workers`. A branch switch changes thousands of files, most of which the page cache no longer
+// holds, and reading them one after another would wait on the disk for each of them in turn.
+vector<string> readFiles(const vector<string> &paths, const FileSystem &fs, WorkerPool &workers) {
+    vector<string> contents(paths.size());
+    WorkerPool::TaskGroup group;
+    for (int i = 0; i < paths.size(); i++) {
+        workers.submit(group, [&paths, &fs, &contents, i]() { contents[i] = readFile(paths[i], fs); });
     }
+    workers.wait(group);
+    return contents;
 }
 
 void LSPLoop::preprocessSorbetWorkspaceEdit(const DidChangeTextDocumentParams &changeParams,
@@ -41,26 +40,40 @@ void LSPLoop::preprocessSorbetWorkspaceEdit(const DidChangeTextDocumentParams &c
         if (FileOps::isFileIgnored(rootPath, localPath, opts.absoluteIgnorePatterns, opts.relativeIgnorePatterns)) {
             return;
         }
-        string fileContents = string(getFileContents(updates, *initialGS, localPath));
+        // Editors send changes as ranges of lines and columns, so keep the line breaks of the contents up to date as
+        // changes are applied, rather than finding them again in the whole file after each one.
+        string fileContents;
+        shared_ptr<vector<int>> lineBreaks;
+        auto it = updates.find(localPath);
+        if (it != updates.end()) {
+            fileContents = move(it->second.contents);
+            lineBreaks = move(it->second.lineBreaks);
+        } else if (auto file = initialGS->findFileByPath(localPath); file.exists()) {
+            fileContents = string(file.data(*initialGS).source());
+            // The file's line breaks are shared with its copies, so changes go to a copy of them.
+            lineBreaks = make_shared<vector<int>>(file.data(*initialGS).lineBreaks());
+        }
         for (auto &change : changeParams.contentChanges) {
             if (change->range) {
-                auto &range = *change->range;
                 // incremental update
-                core::Loc::Detail start, end;
-                start.line = range->start->line + 1;
-                start.column = range->start->character + 1;
-                end.line = range->end->line + 1;
-                end.column = range->end->character + 1;
-                core::File old(string(localPath), string(fileContents), core::File::Type::Normal);
-                auto startOffset = core::Loc::pos2Offset(old, start);
-                auto endOffset = core::Loc::pos2Offset(old, end);
-                fileContents = fileContents.replace(startOffset, endOffset - startOffset, change->text);
+                if (lineBreaks == nullptr) {
+                    lineBreaks = make_shared<vector<int>>(core::File::findLineBreaks(fileContents));
+                }
+                auto &range = *change->range;
+                auto offset = [&lineBreaks](const Position &pos) -> int {
+                    auto line = min<int>(pos.line, lineBreaks->size() - 2);
+                    return min((*lineBreaks)[line] + 1 + pos.character, lineBreaks->back());
+                };
+                auto startOffset = offset(*range->start);
+                auto endOffset = max(startOffset, offset(*range->end));
+                core::File::edit(fileContents, *lineBreaks, startOffset, endOffset, change->text);
             } else {
                 // replace
                 fileContents = change->text;
+                lineBreaks = nullptr;
             }
         }
-        updates[localPath] = {fileContents, /* newlyOpened */ false, /* newlyClosed */ false};
+        updates[localPath] = {move(fileContents), /* newlyOpened */ false, /* newlyClosed */ false, move(lineBreaks)};
     }
 }
 
@@ -89,6 +102,7 @@ void LSPLoop::preprocessSorbetWorkspaceEdit(const DidCloseTextDocumentParams &cl
 
 void LSPLoop::preprocessSorbetWorkspaceEdit(const WatchmanQueryResponse &queryResponse,
                                             UnorderedMap<string, LSPLoop::SorbetWorkspaceFileUpdate> &updates) const {
+    vector<string> toRead;
     for (auto file : queryResponse.files) {
         string localPath = absl::StrCat(rootPath, "/", file);
         if (!FileOps::isFileIgnored(rootPath, localPath, opts.absoluteIgnorePatterns, opts.relativeIgnorePatterns)) {
@@ -101,11 +115,55 @@ void LSPLoop::preprocessSorbetWorkspaceEdit(const WatchmanQueryResponse &queryRe
             }
             // Editor contents supercede file system updates.
             if (!isFileOpenInEditor) {
-                // File may have been closed and then updated on disk, so make sure we preserve the 'closed' flag.
-                updates[localPath] = {readFile(localPath, *opts.fs), /* newlyOpened */ false,
-                                      /* newlyClosed */ it != updates.end() ? it->second.newlyClosed : false};
+                toRead.emplace_back(move(localPath));
+            }
+        }
+    }
+    auto allContents = readFiles(toRead, *opts.fs, workers);
+    for (int i = 0; i < toRead.size(); i++) {
+        auto &localPath = toRead[i];
+        auto &contents = allContents[i];
+        auto it = updates.find(localPath);
+        if (it == updates.end()) {
+            // Watchman reports every file a `git checkout` touches, most of which often end up as they were.
+            // Those don't need to be typechecked again.
+            auto existing = initialGS->findFileByPath(localPath);
+            if (existing.exists() ? existing.data(*initialGS).source() == contents : contents.empty()) {
+                prodCounterInc("lsp.watchman.unchanged_files");
+                continue;
             }
         }
+        // File may have been closed and then updated on disk, so make sure we preserve the 'closed' flag.
+        updates[localPath] = {move(contents), /* newlyOpened */ false,
+                              /* newlyClosed */ it != updates.end() ? it->second.newlyClosed : false};
+    }
+}
+
+void LSPLoop::prewarmFileHashes(const options::Options &opts, string_view rootPath, WorkerPool &workers,
+                                spdlog::logger &logger, PrewarmedFileHashes &prewarmed,
+                                const vector<string> &changedFiles) {
+    Timer timeit(logger, "prewarmFileHashes");
+    vector<string> paths;
+    for (auto &file : changedFiles) {
+        string localPath = absl::StrCat(rootPath, "/", file);
+        if (!FileOps::isFileIgnored(rootPath, localPath, opts.absoluteIgnorePatterns, opts.relativeIgnorePatterns)) {
+            paths.emplace_back(move(localPath));
+        }
+    }
+    // Besides hashing them sooner, this leaves the files in the page cache for when the main thread reads them.
+    auto contents = readFiles(paths, *opts.fs, workers);
+    vector<shared_ptr<core::File>> files;
+    files.reserve(paths.size());
+    for (int i = 0; i < paths.size(); i++) {
+        files.emplace_back(make_shared<core::File>(move(paths[i]), move(contents[i]), core::File::Type::Normal));
+    }
+    // Only the main thread may write to the kvstore.
+    unique_ptr<KeyValueStore> noKvstore;
+    auto hashes = pipeline::computeFileHashes(files, logger, workers, noKvstore);
+    absl::MutexLock lck(&prewarmed.mtx);
+    for (int i = 0; i < files.size(); i++) {
+        auto path = string(files[i]->path());
+        prewarmed.hashes[move(path)] = make_pair(move(files[i]), move(hashes[i]));
     }
 }
 
@@ -118,6 +176,9 @@ LSPLoop::commitSorbetWorkspaceEdits(unique_ptr<core::GlobalState> gs,
         for (auto &update : updates) {
             auto file =
                 make_shared<core::File>(string(update.first), move(update.second.contents), core::File::Type::Normal);
+            if (update.second.lineBreaks) {
+                file->setLineBreaks(move(update.second.lineBreaks));
+            }
             if (update.second.newlyClosed) {
                 fileUpdates.closedFiles.push_back(string(file->path()));
             }
@@ -5,6 +5,9 @@ using namespace std;
 
 namespace sorbet::realmain::lsp {
 
+// Caps the work done per request; clients re-query as the user types.
+constexpr int MAX_WORKSPACE_SYMBOL_RESULTS = 50;
+
 unique_ptr<SymbolInformation> LSPLoop::symbolRef2SymbolInformation(const core::GlobalState &gs,
                                                                    core::SymbolRef symRef) const {
     auto sym = symRef.data(gs);
@@ -38,12 +41,13 @@ LSPResult LSPLoop::handleWorkspaceSymbols(unique_ptr<core::GlobalState> gs, cons
     string_view searchString = params.query;
     ShowOperation op(*this, "WorkspaceSymbols", fmt::format("Searching for symbol `{}`...", searchString));
 
-    for (u4 idx = 1; idx < gs->symbolsUsed(); idx++) {
-        core::SymbolRef ref(gs.get(), idx);
-        if (hasSimilarName(*gs, ref.data(*gs)->name, searchString)) {
-            auto data = symbolRef2SymbolInformation(*gs, ref);
-            if (data) {
-                result.push_back(move(data));
+    symbolSearchIndex.update(*gs);
+    for (auto ref : symbolSearchIndex.search(*gs, searchString)) {
+        auto data = symbolRef2SymbolInformation(*gs, ref);
+        if (data) {
+            result.push_back(move(data));
+            if (result.size() >= MAX_WORKSPACE_SYMBOL_RESULTS) {
+                break;
             }
         }
     }
@@ -241,6 +241,33 @@ TEST(GenerateLSPMessagesTest, DifferentLSPMessageTypes) {
     ASSERT_TRUE(LSPMessage(notification->toJSON()).isNotification());
 }
 
+// writeJSON skips the rapidjson::Value, but must produce exactly what serializing one would.
+TEST(GenerateLSPMessagesTest, WriteJSONMatchesToJSONValue) {
+    auto params = make_unique<SorbetErrorParams>(20, "Bad \"request\"");
+    auto notification = make_unique<NotificationMessage>("2.0", LSPMethod::SorbetError, move(params));
+    parseTest<NotificationMessage>(notification->toJSON(), [](auto &msg) -> void {
+        rapidjson::MemoryPoolAllocator<> alloc;
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        msg->toJSONValue(alloc)->Accept(writer);
+        ASSERT_EQ(msg->toJSON(), buffer.GetString());
+    });
+}
+
+TEST(GenerateLSPMessagesTest, FromClientInSitu) {
+    string json = "{\"jsonrpc\": \"2.0\", \"method\": \"exit\", \"params\": null}";
+    auto msg = LSPMessage::fromClient(string(json));
+    ASSERT_TRUE(msg->isNotification());
+    ASSERT_EQ(msg->method(), LSPMethod::Exit);
+
+    // Parse errors still show the message as sent.
+    auto invalid = json.substr(0, json.size() - 1);
+    auto error = LSPMessage::fromClient(string(invalid));
+    ASSERT_EQ(error->method(), LSPMethod::SorbetError);
+    auto &errorParams = get<unique_ptr<SorbetErrorParams>>(error->asNotification().params);
+    ASSERT_EQ(errorParams->message, fmt::format("Last LSP request: `{}` is not a valid json object", invalid));
+}
+
 string makeRequestMessage(LSPMethod method, optional<string_view> params) {
     return fmt::format("{{\"jsonrpc\": \"2.0\", \"id\": 0, \"method\": \"{}\"{}}}", convertLSPMethodToString(method),
                        (params ? fmt::format(", \"params\": {}", *params) : ""));
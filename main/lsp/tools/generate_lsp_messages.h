@@ -16,6 +16,8 @@ using namespace sorbet;
 // rapidjson::Allocator variable, which is assumed to be available in serialization and deserialization methods.
 // Used to copy things of type "any" from the JSON document into our C++ objects so we manage the memory.
 const std::string ALLOCATOR_VAR = "alloc";
+// rapidjson::Writer variable, which is assumed to be available in `writeJSON` methods.
+const std::string WRITER_VAR = "writer";
 
 // How this type appears in raw JSON or C++.
 // Primarily used to determine which types we can automatically discriminate in variant types.
@@ -32,6 +34,8 @@ enum class BaseKind {
 };
 
 typedef std::function<void(fmt::memory_buffer &out, std::string_view)> AssignLambda;
+// Emits what has to be written before a value, e.g. its key in an object.
+typedef std::function<void(fmt::memory_buffer &out)> WriteKeyLambda;
 
 class JSONType {
 public:
@@ -85,6 +89,14 @@ public:
     virtual void emitToJSONValue(fmt::memory_buffer &out, std::string_view from, AssignLambda assign,
                                  std::string_view fieldName) = 0;
 
+    /**
+     * Writes the C++ statements needed to write this type, currently stored in eval(`from`), to the
+     * rapidjson::Writer `WRITER_VAR` without building a rapidjson::Value first. Call `writeKey` right before writing
+     * the value, if there is one to write at all.
+     */
+    virtual void emitWriteJSON(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey,
+                               std::string_view fieldName) = 0;
+
 protected:
     void simpleDeserialization(fmt::memory_buffer &out, std::string_view from, AssignLambda assign,
                                std::string_view fieldName, std::string_view helperFunctionName) {
@@ -94,6 +106,12 @@ protected:
     void simpleSerialization(fmt::memory_buffer &out, std::string_view from, AssignLambda assign) {
         assign(out, from);
     }
+
+    void simpleWrite(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey,
+                     std::string_view writerMethod) {
+        writeKey(out);
+        fmt::format_to(out, "{}.{}({});\n", WRITER_VAR, writerMethod, from);
+    }
 };
 
 class JSONClassType : public JSONType {
@@ -150,6 +168,11 @@ public:
                          std::string_view fieldName) {
         assign(out, "rapidjson::Value(rapidjson::kNullType)");
     }
+
+    void emitWriteJSON(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey,
+                       std::string_view fieldName) {
+        simpleWrite(out, "", writeKey, "Null");
+    }
 };
 
 class JSONBooleanType final : public JSONType {
@@ -179,6 +202,11 @@ public:
                          std::string_view fieldName) {
         simpleSerialization(out, from, assign);
     }
+
+    void emitWriteJSON(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey,
+                       std::string_view fieldName) {
+        simpleWrite(out, from, writeKey, "Bool");
+    }
 };
 
 class JSONIntType final : public JSONType {
@@ -208,6 +236,11 @@ public:
                          std::string_view fieldName) {
         simpleSerialization(out, from, assign);
     }
+
+    void emitWriteJSON(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey,
+                       std::string_view fieldName) {
+        simpleWrite(out, from, writeKey, "Int");
+    }
 };
 
 class JSONDoubleType final : public JSONType {
@@ -237,6 +270,11 @@ public:
                          std::string_view fieldName) {
         simpleSerialization(out, from, assign);
     }
+
+    void emitWriteJSON(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey,
+                       std::string_view fieldName) {
+        simpleWrite(out, from, writeKey, "Double");
+    }
 };
 
 class JSONStringType final : public JSONType {
@@ -251,6 +289,15 @@ public:
         fmt::format_to(out, "}}\n");
     }
 
+    static void writeString(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey) {
+        // Create new scope for temp var, as `from` may be an expression.
+        fmt::format_to(out, "{{\n");
+        fmt::format_to(out, "const std::string &str = {};\n", from);
+        writeKey(out);
+        fmt::format_to(out, "{}.String(str.c_str(), str.length());\n", WRITER_VAR);
+        fmt::format_to(out, "}}\n");
+    }
+
     BaseKind getCPPBaseKind() const {
         return BaseKind::StringKind;
     }
@@ -276,6 +323,11 @@ public:
                          std::string_view fieldName) {
         serializeStringToJSONValue(out, from, assign);
     }
+
+    void emitWriteJSON(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey,
+                       std::string_view fieldName) {
+        writeString(out, from, writeKey);
+    }
 };
 
 // TODO: Emit an actual constant.
@@ -314,6 +366,14 @@ public:
         fmt::format_to(out, "}}\n");
         JSONStringType::serializeStringToJSONValue(out, from, assign);
     }
+
+    void emitWriteJSON(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey,
+                       std::string_view fieldName) {
+        fmt::format_to(out, "if ({} != \"{}\") {{\n", from, value);
+        fmt::format_to(out, "throw InvalidConstantValueError(\"{}\", \"{}\", {});\n", fieldName, value, from);
+        fmt::format_to(out, "}}\n");
+        JSONStringType::writeString(out, from, writeKey);
+    }
 };
 
 class JSONArrayType final : public JSONType {
@@ -384,6 +444,17 @@ public:
         assign(out, arrayVar);
         fmt::format_to(out, "}}\n");
     }
+
+    void emitWriteJSON(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey,
+                       std::string_view fieldName) {
+        writeKey(out);
+        fmt::format_to(out, "{}.StartArray();\n", WRITER_VAR);
+        fmt::format_to(out, "for (auto &element : {}) {{\n", from);
+        componentType->emitWriteJSON(
+            out, "element", [](fmt::memory_buffer &out) -> void {}, fieldName);
+        fmt::format_to(out, "}}\n");
+        fmt::format_to(out, "{}.EndArray();\n", WRITER_VAR);
+    }
 };
 
 class JSONIntEnumType final : public JSONClassType {
@@ -427,6 +498,11 @@ public:
         assign(out, fmt::format("(int)tryConvertTo{}((int){})", typeName, from));
     }
 
+    void emitWriteJSON(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey,
+                       std::string_view fieldName) {
+        simpleWrite(out, fmt::format("(int)tryConvertTo{}((int){})", typeName, from), writeKey, "Int");
+    }
+
     void emitDeclaration(fmt::memory_buffer &out) {
         fmt::format_to(out, "enum class {} {{\n", typeName);
         for (auto &value : enumValues) {
@@ -517,6 +593,11 @@ public:
         JSONStringType::serializeStringToJSONValue(out, fmt::format("convert{}ToString({})", typeName, from), assign);
     }
 
+    void emitWriteJSON(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey,
+                       std::string_view fieldName) {
+        JSONStringType::writeString(out, fmt::format("convert{}ToString({})", typeName, from), writeKey);
+    }
+
     void emitDeclaration(fmt::memory_buffer &out) {
         fmt::format_to(out, "enum class {} {{\n", typeName);
         for (std::string_view value : enumValues) {
@@ -627,6 +708,14 @@ public:
         innerType->emitToJSONValue(out, fmt::format("(*{})", from), assign, fieldName);
         fmt::format_to(out, "}}\n");
     }
+
+    void emitWriteJSON(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey,
+                       std::string_view fieldName) {
+        // Like in `emitToJSONValue`, missing values are left out entirely, key included.
+        fmt::format_to(out, "if ({}.has_value()) {{\n", from);
+        innerType->emitWriteJSON(out, fmt::format("(*{})", from), writeKey, fieldName);
+        fmt::format_to(out, "}}\n");
+    }
 };
 
 class JSONObjectType final : public JSONClassType {
@@ -678,6 +767,15 @@ public:
         assign(out, fmt::format("*({}->toJSONValue({}))", from, ALLOCATOR_VAR));
     }
 
+    void emitWriteJSON(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey,
+                       std::string_view fieldName) {
+        fmt::format_to(out, "if ({} == nullptr) {{\n", from);
+        fmt::format_to(out, "throw NullPtrError(\"{}\");\n", fieldName);
+        fmt::format_to(out, "}}\n");
+        writeKey(out);
+        fmt::format_to(out, "{}->writeJSON({});\n", from, WRITER_VAR);
+    }
+
     void emitDeclaration(fmt::memory_buffer &out) {
         fmt::format_to(out, "class {} final : public JSONBaseType {{\n", typeName);
         fmt::format_to(out, "public:\n");
@@ -698,6 +796,7 @@ public:
         }
         fmt::format_to(
             out, "std::unique_ptr<rapidjson::Value> toJSONValue(rapidjson::MemoryPoolAllocator<> &alloc) const;\n");
+        fmt::format_to(out, "void writeJSON(rapidjson::Writer<rapidjson::StringBuffer> &{}) const;\n", WRITER_VAR);
         fmt::format_to(out, "}};\n");
     }
 
@@ -773,6 +872,20 @@ public:
         }
         fmt::format_to(out, "return rv;\n");
         fmt::format_to(out, "}}\n");
+
+        // Writes fields in the same order as `toJSONValue` adds them.
+        fmt::format_to(out, "void {}::writeJSON(rapidjson::Writer<rapidjson::StringBuffer> &{}) const {{\n", typeName,
+                       WRITER_VAR);
+        fmt::format_to(out, "{}.StartObject();\n", WRITER_VAR);
+        for (std::shared_ptr<FieldDef> &fieldDef : fieldDefs) {
+            std::string fieldName = fmt::format("{}.{}", typeName, fieldDef->cppName);
+            WriteKeyLambda writeKey = [&fieldDef](fmt::memory_buffer &out) -> void {
+                fmt::format_to(out, "{}.Key(\"{}\");\n", WRITER_VAR, fieldDef->jsonName);
+            };
+            fieldDef->type->emitWriteJSON(out, fieldDef->cppName, writeKey, fieldName);
+        }
+        fmt::format_to(out, "{}.EndObject();\n", WRITER_VAR);
+        fmt::format_to(out, "}}\n");
     }
 
     /**
@@ -903,6 +1016,27 @@ public:
                        fieldName, fieldDef->cppName, enumType->getCPPType());
         fmt::format_to(out, "}}\n");
     }
+
+    void emitWriteJSON(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey,
+                       std::string_view fieldName) {
+        auto enumType = getDiscriminantType();
+        fmt::format_to(out, "switch ({}) {{\n", fieldDef->cppName);
+        for (auto &variant : variantsByDiscriminant) {
+            fmt::format_to(out, "case {}:\n", enumType->getEnumValue(variant.first));
+            fmt::format_to(out, "if (auto discVal = std::get_if<{}>(&{})) {{\n", variant.second->getCPPType(), from);
+            variant.second->emitWriteJSON(out, "(*discVal)", writeKey, fieldName);
+            fmt::format_to(out, "}} else {{\n");
+            fmt::format_to(
+                out, "throw InvalidDiscriminatedUnionValueError(\"{0}\", \"{1}\", convert{2}ToString({1}), \"{3}\");\n",
+                fieldName, fieldDef->cppName, enumType->getCPPType(), variant.second->getCPPType());
+            fmt::format_to(out, "}}\n");
+            fmt::format_to(out, "break;\n");
+        }
+        fmt::format_to(out, "default:\n");
+        fmt::format_to(out, "throw InvalidDiscriminantValueError(\"{0}\", \"{1}\", convert{2}ToString({1}));\n",
+                       fieldName, fieldDef->cppName, enumType->getCPPType());
+        fmt::format_to(out, "}}\n");
+    }
 };
 
 class JSONBasicVariantType final : public JSONVariantType {
@@ -996,6 +1130,24 @@ public:
         fmt::format_to(out, "throw MissingVariantValueError(\"{}\");\n", fieldName);
         fmt::format_to(out, "}}\n");
     }
+
+    void emitWriteJSON(fmt::memory_buffer &out, std::string_view from, WriteKeyLambda writeKey,
+                       std::string_view fieldName) {
+        bool first = true;
+        for (std::shared_ptr<JSONType> variant : variants) {
+            auto condition = fmt::format("auto val = std::get_if<{}>(&{})", variant->getCPPType(), from);
+            if (first) {
+                first = false;
+                fmt::format_to(out, "if ({}) {{\n", condition);
+            } else {
+                fmt::format_to(out, "}} else if ({}) {{\n", condition);
+            }
+            variant->emitWriteJSON(out, "(*val)", writeKey, fieldName);
+        }
+        fmt::format_to(out, "}} else {{\n");
+        fmt::format_to(out, "throw MissingVariantValueError(\"{}\");\n", fieldName);
+        fmt::format_to(out, "}}\n");
+    }
 };
 
 #endif // GENERATE_LSP_MESSAGES_H
@@ -1287,13 +1287,38 @@ void makeLSPTypes(vector<shared_ptr<JSONClassType>> &enumTypes, vector<shared_pt
                                                 },
                                                 classTypes);
 
+    // How long one phase of a typecheck run took.
+    auto SorbetTypecheckRunPhase = makeObject("SorbetTypecheckRunPhase",
+                                              {
+                                                  makeField("name", JSONString),
+                                                  makeField("durationMs", JSONDouble),
+                                              },
+                                              classTypes);
+
     auto SorbetTypecheckRunInfo = makeObject("SorbetTypecheckRunInfo",
                                              {
                                                  makeField("tookFastPath", JSONBool),
                                                  makeField("filesTypechecked", makeArray(JSONString)),
+                                                 // Why the fast path was or wasn't taken.
+                                                 makeField("fastPathDecision", makeOptional(JSONString)),
+                                                 makeField("phases", makeOptional(makeArray(SorbetTypecheckRunPhase))),
                                              },
                                              classTypes);
 
+    // Approximate memory usage of the server by category, in KiB. See core::MemoryUsage.
+    auto SorbetMemoryReport = makeObject("SorbetMemoryReport",
+                                         {
+                                             makeField("names", JSONInt),
+                                             makeField("strings", JSONInt),
+                                             makeField("symbols", JSONInt),
+                                             makeField("files", JSONInt),
+                                             makeField("types", JSONInt),
+                                             makeField("trees", JSONInt),
+                                             makeField("fileHashes", JSONInt),
+                                             makeField("total", JSONInt),
+                                         },
+                                         classTypes);
+
     /* Core LSPMessage objects */
     // N.B.: Only contains LSP methods that Sorbet actually cares about.
     // All others are ignored.
@@ -1307,6 +1332,7 @@ void makeLSPTypes(vector<shared_ptr<JSONClassType>> &enumTypes, vector<shared_pt
                                      "initialized",
                                      "shutdown",
                                      "sorbet/error",
+                                     "sorbet/memoryReport",
                                      "sorbet/readFile",
                                      "sorbet/showOperation",
                                      "sorbet/typecheckRunInfo",
@@ -1342,6 +1368,7 @@ void makeLSPTypes(vector<shared_ptr<JSONClassType>> &enumTypes, vector<shared_pt
                                                 {"textDocument/codeAction", CodeActionParams},
                                                 {"workspace/symbol", WorkspaceSymbolParams},
                                                 {"sorbet/error", SorbetErrorParams},
+                                                {"sorbet/memoryReport", makeOptional(JSONNull)},
                                                 {"sorbet/readFile", TextDocumentIdentifier},
                                             });
     auto RequestMessage =
@@ -1376,6 +1403,7 @@ void makeLSPTypes(vector<shared_ptr<JSONClassType>> &enumTypes, vector<shared_pt
             // {"textDocument/codeAction", makeVariant({JSONNull, makeArray(CodeAction), makeArray(Command)})},
             {"workspace/symbol", makeVariant({JSONNull, makeArray(SymbolInformation)})},
             {"sorbet/error", SorbetErrorParams},
+            {"sorbet/memoryReport", SorbetMemoryReport},
             {"sorbet/readFile", TextDocumentItem},
         });
     // N.B.: ResponseMessage.params must be optional, as it is not present when an error occurs.
@@ -1,5 +1,7 @@
+#include "absl/strings/match.h"
 #include "ast/treemap/treemap.h"
 #include "common/Timer.h"
+#include "common/os/os.h"
 #include "core/Error.h"
 #include "core/Files.h"
 #include "core/GlobalState.h"
@@ -15,6 +17,7 @@
 #include "main/lsp/LocalVarSaver.h"
 #include "main/pipeline/pipeline.h"
 #include "namer/namer.h"
+#include "payload/payload.h"
 #include "resolver/resolver.h"
 #include <algorithm> // std::unique, std::distance
 
@@ -41,7 +44,8 @@ LSPLoop::ShowOperation::~ShowOperation() {
 }
 
 pair<unique_ptr<core::GlobalState>, ast::ParsedFile>
-updateFile(unique_ptr<core::GlobalState> gs, const shared_ptr<core::File> &file, const options::Options &opts) {
+updateFile(unique_ptr<core::GlobalState> gs, const shared_ptr<core::File> &file, const options::Options &opts,
+           unique_ptr<KeyValueStore> &kvstore) {
     core::FileRef fref = gs->findFileByPath(file->path());
     if (fref.exists()) {
         gs = core::GlobalState::replaceFile(move(gs), fref, file);
@@ -49,7 +53,6 @@ updateFile(unique_ptr<core::GlobalState> gs, const shared_ptr<core::File> &file,
         fref = gs->enterFile(file);
     }
     fref.data(*gs).strictLevel = pipeline::decideStrictLevel(*gs, fref, opts);
-    std::unique_ptr<KeyValueStore> kvstore; // nullptr
     return make_pair(move(gs), pipeline::indexOne(opts, *gs, fref, kvstore));
 }
 
@@ -67,25 +70,78 @@ LSPResult LSPLoop::commitTypecheckRun(TypecheckRun run) {
         openFiles.insert(string(openedFile));
     }
 
+    // Cached query responses may point into or depend on any file that changed.
+    queryResponseCache.clear();
+
     // Clear out state associated with old finalGS.
     if (!run.tookFastPath) {
         indexedFinalGS.clear();
+        slowPathCanceled = run.canceled;
+        // Symbols are renumbered.
+        referenceIndex.clear();
+        symbolSearchIndex.clear();
+        completionMemberIndex.clear();
+        documentSymbolIndex = DocumentSymbolIndex();
+    } else {
+        // Methods that changed were re-entered, and every file that calls one was typechecked again, so only those
+        // files can reference different symbols.
+        for (auto &file : run.filesTypechecked) {
+            referenceIndex.erase(file);
+        }
+        // The class hierarchy is unchanged, but the edited files may have added, removed or changed methods of any
+        // class they define.
+        for (auto &file : updates.updatedFiles) {
+            auto fref = initialGS->findFileByPath(file->path());
+            documentSymbolIndex.stale.insert(fref);
+            for (auto it = completionMemberIndex.begin(); it != completionMemberIndex.end();) {
+                if (it->second.files.contains(fref)) {
+                    completionMemberIndex.erase(it++);
+                } else {
+                    ++it;
+                }
+            }
+        }
     }
 
     for (auto &ast : updates.updatedFileIndexes) {
         indexedFinalGS[ast.file.id()] = move(ast);
     }
 
+    // What was recorded for the edited files is only good for their new contents.
+    if (!run.tookFastPath) {
+        typecheckedMethods.clear();
+    }
+    for (auto &file : updates.updatedFiles) {
+        typecheckedMethods.erase(initialGS->findFileByPath(file->path()));
+    }
+    for (auto &[file, methods] : run.typecheckedMethods) {
+        typecheckedMethods[file] = move(methods);
+    }
+
+    if (!run.tookFastPath) {
+        deferredFiles.clear();
+    } else {
+        deferredFiles.insert(deferredFiles.end(), run.deferredFiles.begin(), run.deferredFiles.end());
+        fast_sort(deferredFiles);
+        deferredFiles.erase(unique(deferredFiles.begin(), deferredFiles.end()), deferredFiles.end());
+        auto typechecked = run.filesTypechecked;
+        fast_sort(typechecked);
+        deferredFiles.erase(remove_if(deferredFiles.begin(), deferredFiles.end(),
+                                      [&](auto file) { return absl::c_binary_search(typechecked, file); }),
+                            deferredFiles.end());
+    }
+
     {
         core::UnfreezeFileTable fileTableAccess(*initialGS);
         for (auto &file : updates.updatedFiles) {
             // Update initialGS and index.
-            auto rv = updateFile(move(initialGS), file, opts);
+            auto rv = updateFile(move(initialGS), file, opts, kvstore);
             initialGS = move(rv.first);
             const auto id = rv.second.file.id();
             if (id >= indexed.size()) {
                 indexed.resize(id + 1);
             }
+            evictedTrees.erase(rv.second.file);
             indexed[id] = move(rv.second);
         }
         // Drop any indexing errors produced during `updateFile`.
@@ -96,69 +152,66 @@ LSPResult LSPLoop::commitTypecheckRun(TypecheckRun run) {
     for (auto &entry : updates.updatedFileHashes) {
         auto fref = initialGS->findFileByPath(entry.first);
         ENFORCE(fref.exists());
-        const auto id = fref.id();
-        if (id >= globalStateHashes.size()) {
-            globalStateHashes.resize(id + 1);
+        setGlobalStateHash(fref, move(entry.second));
+    }
+
+    {
+        vector<core::FileRef> mayBeClosed;
+        for (auto &file : updates.updatedFiles) {
+            mayBeClosed.emplace_back(initialGS->findFileByPath(file->path()));
+        }
+        for (auto closedFile : updates.closedFiles) {
+            mayBeClosed.emplace_back(initialGS->findFileByPath(closedFile));
         }
-        globalStateHashes[fref.id()] = move(entry.second);
+        evictClosedTrees(mayBeClosed);
     }
 
+    if (opts.lspWorkspaceSymbolsEnabled) {
+        // Index new symbols now rather than on the next keystroke in a symbol search.
+        symbolSearchIndex.update(*run.gs);
+    }
+
+    if (!run.tookFastPath) {
+        releaseMemoryAfterSlowPath();
+    }
+
+    if (run.canceled) {
+        // The update that canceled this run is already queued, and will report diagnostics once it is typechecked.
+        return LSPResult{move(run.gs), {}};
+    }
     return pushDiagnostics(move(run));
 }
 
 vector<core::FileHash> LSPLoop::computeStateHashes(const vector<shared_ptr<core::File>> &files) const {
     Timer timeit(logger, "computeStateHashes");
-    vector<core::FileHash> res(files.size());
-    shared_ptr<ConcurrentBoundedQueue<int>> fileq = make_shared<ConcurrentBoundedQueue<int>>(files.size());
-    for (int i = 0; i < files.size(); i++) {
-        auto copy = i;
-        fileq->push(move(copy), 1);
-    }
-
     logger->debug("Computing state hashes for {} files", files.size());
-
-    res.resize(files.size());
-
-    shared_ptr<BlockingBoundedQueue<vector<pair<int, core::FileHash>>>> resultq =
-        make_shared<BlockingBoundedQueue<vector<pair<int, core::FileHash>>>>(files.size());
-    workers.multiplexJob("lspStateHash", [fileq, resultq, files, logger = this->logger]() {
-        vector<pair<int, core::FileHash>> threadResult;
-        int processedByThread = 0;
-        int job;
-        options::Options emptyOpts;
-        emptyOpts.runLSP = true;
-
-        {
-            for (auto result = fileq->try_pop(job); !result.done(); result = fileq->try_pop(job)) {
-                if (result.gotItem()) {
-                    processedByThread++;
-
-                    if (!files[job]) {
-                        threadResult.emplace_back(job, core::FileHash{});
-                        continue;
-                    }
-                    auto hash = pipeline::computeFileHash(files[job], *logger);
-                    threadResult.emplace_back(job, move(hash));
-                }
-            }
-        }
-
-        if (processedByThread > 0) {
-            resultq->push(move(threadResult), processedByThread);
-        }
-    });
-
+    vector<core::FileHash> prewarmed(files.size());
+    // Null for the files that were prewarmed, which `computeFileHashes` skips.
+    vector<shared_ptr<core::File>> toCompute(files.begin(), files.end());
     {
-        vector<pair<int, core::FileHash>> threadResult;
-        for (auto result = resultq->wait_pop_timed(threadResult, WorkerPool::BLOCK_INTERVAL(), *logger); !result.done();
-             result = resultq->wait_pop_timed(threadResult, WorkerPool::BLOCK_INTERVAL(), *logger)) {
-            if (result.gotItem()) {
-                for (auto &a : threadResult) {
-                    res[a.first] = move(a.second);
-                }
+        absl::MutexLock lck(&prewarmedFileHashes.mtx);
+        for (int i = 0; i < files.size() && !prewarmedFileHashes.hashes.empty(); i++) {
+            auto fnd = prewarmedFileHashes.hashes.find(files[i]->path());
+            if (fnd == prewarmedFileHashes.hashes.end()) {
+                continue;
+            }
+            if (fnd->second.first->source() == files[i]->source()) {
+                prewarmed[i] = move(fnd->second.second);
+                toCompute[i] = nullptr;
+                prodCounterInc("lsp.prewarmed_file_hashes.hit");
             }
+            prewarmedFileHashes.hashes.erase(fnd);
+        }
+    }
+    auto res = pipeline::computeFileHashes(toCompute, *logger, workers, kvstore);
+    for (int i = 0; i < files.size(); i++) {
+        if (toCompute[i] == nullptr) {
+            res[i] = move(prewarmed[i]);
         }
     }
+    if (kvstore && !kvstore->flush()) {
+        logger->debug("Failed to write file hashes to the cache");
+    }
     return res;
 }
 
@@ -166,6 +219,7 @@ void LSPLoop::reIndexFromFileSystem() {
     ShowOperation op(*this, "Indexing", "Indexing files...");
     Timer timeit(logger, "reIndexFromFileSystem");
     indexed.clear();
+    evictedTrees.clear();
     vector<core::FileRef> inputFiles = pipeline::reserveFiles(initialGS, opts.inputFileNames);
     for (auto &t : pipeline::index(initialGS, inputFiles, opts, workers, kvstore)) {
         int id = t.file.id();
@@ -174,6 +228,137 @@ void LSPLoop::reIndexFromFileSystem() {
         }
         indexed[id] = move(t);
     }
+    evictClosedTrees(inputFiles);
+    // The trees `index` just cached refer to names by id, so they can only be loaded into the name table they were
+    // created with.
+    if (kvstore) {
+        payload::writeGlobalState(*initialGS, *kvstore, &workers);
+    }
+    // Entered after writing out initialGS, which must stay loadable without configatron's options. Every slow path
+    // copies initialGS, so it only has to enter configatron again if its files changed since.
+    if (!skipConfigatron) {
+        configatronDigest = pipeline::enterConfigatron(*initialGS, opts, kvstore);
+    }
+    namesAfterIndexing = initialGS->namesUsed();
+    if (kvstore && !kvstore->flush()) {
+        logger->debug("Failed to write parse trees to the cache");
+    }
+}
+
+bool LSPLoop::shouldCompactNames() const {
+    // Edits only add a name or two per keystroke, so this takes days of editing to reach, and then rebuilding costs
+    // about what the initial indexing did.
+    constexpr double NAMES_LEFT_BEHIND_RATIO = 0.25;
+    return initialized && namesAfterIndexing > 0 &&
+           initialGS->namesUsed() - namesAfterIndexing > namesAfterIndexing * NAMES_LEFT_BEHIND_RATIO;
+}
+
+LSPResult LSPLoop::compactNames(unique_ptr<core::GlobalState> gs) {
+    ShowOperation op(*this, "CompactNames", "Compacting...");
+    Timer timeit(logger, "compact_names");
+    prodCounterInc("lsp.compact_names");
+    logger->debug("Compacting names: {} of {} were entered by edits", initialGS->namesUsed() - namesAfterIndexing,
+                  initialGS->namesUsed());
+    // Nothing may refer to the names of the old states once this returns.
+    gs = nullptr;
+    auto oldGS = move(initialGS);
+    initialGS = payloadGS->deepCopy();
+    vector<core::FileRef> inputFiles;
+    {
+        core::UnfreezeFileTable fileTableAccess(*initialGS);
+        auto &files = oldGS->getFiles();
+        for (u4 id = initialGS->filesUsed(); id < oldGS->filesUsed(); id++) {
+            auto fref = initialGS->enterFile(files[id]);
+            ENFORCE(fref.id() == id);
+            inputFiles.emplace_back(fref);
+        }
+    }
+    oldGS = nullptr;
+    indexed.clear();
+    evictedTrees.clear();
+    // Not from the cache: the trees in it refer to the names of the state reIndexFromFileSystem stored.
+    unique_ptr<KeyValueStore> noCache;
+    for (auto &t : pipeline::index(initialGS, inputFiles, opts, workers, noCache)) {
+        int id = t.file.id();
+        if (id >= indexed.size()) {
+            indexed.resize(id + 1);
+        }
+        indexed[id] = move(t);
+    }
+    evictClosedTrees(inputFiles);
+    if (!skipConfigatron) {
+        configatronDigest = pipeline::enterConfigatron(*initialGS, opts, kvstore);
+    }
+    namesAfterIndexing = initialGS->namesUsed();
+    return commitTypecheckRun(runSlowPath({}));
+}
+
+void LSPLoop::evictClosedTrees(const vector<core::FileRef> &files) {
+    if (!opts.lspEvictClosedTrees && !overMemoryCeiling) {
+        return;
+    }
+    Timer timeit(logger, "evictClosedTrees");
+    vector<ast::ParsedFile *> toEvict;
+    for (auto file : files) {
+        if (!file.exists() || file.id() >= indexed.size() || indexed[file.id()].tree == nullptr ||
+            openFiles.contains(file.data(*initialGS).path())) {
+            continue;
+        }
+        toEvict.emplace_back(&indexed[file.id()]);
+    }
+    evictedTrees.evict(*initialGS, toEvict, workers);
+}
+
+namespace {
+// Whether the savers below can find anything `gs.lspQuery` asks for in `file`, so that the files they can't needn't be
+// walked again. Only a method is known to be found only where it's defined: fields and constants are found wherever
+// they're used.
+bool queryMayMatchIn(const core::GlobalState &gs, core::FileRef file) {
+    auto &query = gs.lspQuery;
+    auto definedIn = [&](core::SymbolRef sym) {
+        return absl::c_any_of(sym.data(gs)->locs(), [&](const core::Loc &loc) { return loc.file() == file; });
+    };
+    switch (query.kind) {
+        case core::lsp::Query::Kind::LOC:
+        case core::lsp::Query::Kind::FILE:
+        case core::lsp::Query::Kind::METHOD:
+            return query.loc.file() == file;
+        case core::lsp::Query::Kind::VAR:
+            // Variables belong to the method they're in. Class bodies share a <static-init>, which only has the loc of
+            // the first one.
+            return query.symbol.data(gs)->name == core::Names::staticInit() || definedIn(query.symbol);
+        case core::lsp::Query::Kind::SYMBOL:
+            return !query.symbol.data(gs)->isMethod() || definedIn(query.symbol);
+        default:
+            return true;
+    }
+}
+} // namespace
+
+void LSPLoop::releaseMemoryAfterSlowPath() {
+    Timer timeit(logger, "releaseMemoryAfterSlowPath");
+    // A slow path copies every tree and the global state, and all of that is freed by now, but the allocator keeps the
+    // pages around for the next one.
+    const auto before = residentMemoryBytes();
+    releaseFreeMemory();
+    auto after = residentMemoryBytes();
+    prodHistogramInc("lsp.memory.resident_mib_before_release", before >> 20);
+    prodHistogramInc("lsp.memory.resident_mib_after_release", after >> 20);
+    logger->debug("Resident memory went from {} to {} MiB after the slow path", before >> 20, after >> 20);
+    if (opts.lspMemoryCeilingMiB == 0 || overMemoryCeiling || (after >> 20) <= opts.lspMemoryCeilingMiB) {
+        return;
+    }
+    logger->debug("Evicting the trees of closed files, as resident memory is over {} MiB", opts.lspMemoryCeilingMiB);
+    prodCounterInc("lsp.memory.over_ceiling");
+    overMemoryCeiling = true;
+    vector<core::FileRef> files;
+    for (auto &tree : indexed) {
+        if (tree.tree != nullptr) {
+            files.emplace_back(tree.file);
+        }
+    }
+    evictClosedTrees(files);
+    releaseFreeMemory();
 }
 
 void tryApplyLocalVarSaver(const core::GlobalState &gs, vector<ast::ParsedFile> &indexedCopies) {
@@ -181,6 +366,9 @@ void tryApplyLocalVarSaver(const core::GlobalState &gs, vector<ast::ParsedFile>
         return;
     }
     for (auto &t : indexedCopies) {
+        if (!queryMayMatchIn(gs, t.file)) {
+            continue;
+        }
         LocalVarSaver localVarSaver;
         core::Context ctx(gs, core::Symbols::root());
         t.tree = ast::TreeMap::apply(ctx, localVarSaver, move(t.tree));
@@ -188,22 +376,75 @@ void tryApplyLocalVarSaver(const core::GlobalState &gs, vector<ast::ParsedFile>
 }
 
 void tryApplyDefLocSaver(const core::GlobalState &gs, vector<ast::ParsedFile> &indexedCopies) {
-    if (gs.lspQuery.kind != core::lsp::Query::Kind::LOC && gs.lspQuery.kind != core::lsp::Query::Kind::SYMBOL) {
+    if (gs.lspQuery.kind != core::lsp::Query::Kind::LOC && gs.lspQuery.kind != core::lsp::Query::Kind::SYMBOL &&
+        gs.lspQuery.kind != core::lsp::Query::Kind::FILE && gs.lspQuery.kind != core::lsp::Query::Kind::METHOD &&
+        gs.lspQuery.kind != core::lsp::Query::Kind::ALL_SYMBOLS) {
         return;
     }
     for (auto &t : indexedCopies) {
+        if (!queryMayMatchIn(gs, t.file)) {
+            continue;
+        }
         DefLocSaver defLocSaver;
         core::Context ctx(gs, core::Symbols::root());
         t.tree = ast::TreeMap::apply(ctx, defLocSaver, move(t.tree));
     }
 }
 
-LSPLoop::TypecheckRun LSPLoop::runSlowPath(FileUpdates updates) const {
+namespace {
+// Measures the phases of a run one after another, for `TypecheckRun::phaseTimes`.
+class PhaseClock {
+    vector<pair<string, double>> &phaseTimes;
+    chrono::time_point<chrono::steady_clock> last = chrono::steady_clock::now();
+
+public:
+    PhaseClock(vector<pair<string, double>> &phaseTimes) : phaseTimes(phaseTimes) {}
+
+    // Ends the phase called `name`, which started when the last one ended.
+    void lap(string name) {
+        auto now = chrono::steady_clock::now();
+        phaseTimes.emplace_back(move(name), chrono::duration<double, milli>(now - last).count());
+        last = now;
+    }
+};
+
+// Copies each of `trees` in a task of its own on `workers`: copying the index of a whole workspace one tree after
+// another is a good part of the slow path.
+vector<ast::ParsedFile> copyTrees(WorkerPool &workers, const vector<const ast::ParsedFile *> &trees) {
+    vector<ast::ParsedFile> copies(trees.size());
+    WorkerPool::TaskGroup group;
+    for (int i = 0; i < trees.size(); i++) {
+        workers.submit(group, [&copies, &trees, i]() {
+            copies[i] = ast::ParsedFile{trees[i]->tree->deepCopy(), trees[i]->file};
+        });
+    }
+    workers.wait(group);
+    return copies;
+}
+
+vector<ast::ParsedFile> loadEvictedTrees(core::GlobalState &gs, WorkerPool &workers, const EvictedTrees &evictedTrees,
+                                         const vector<core::FileRef> &files) {
+    vector<ast::ParsedFile> loaded(files.size());
+    WorkerPool::TaskGroup group;
+    for (int i = 0; i < files.size(); i++) {
+        workers.submit(group, [&gs, &evictedTrees, &loaded, &files, i]() {
+            loaded[i] = ast::ParsedFile{evictedTrees.load(gs, files[i]), files[i]};
+        });
+    }
+    workers.wait(group);
+    return loaded;
+}
+} // namespace
+
+LSPLoop::TypecheckRun LSPLoop::runSlowPath(FileUpdates updates, bool cancelable) const {
     ShowOperation slowPathOp(*this, "SlowPath", "Typechecking...");
     Timer timeit(logger, "slow_path");
     ENFORCE(initialGS->errorQueue->isEmpty());
     prodCategoryCounterInc("lsp.updates", "slowpath");
     logger->debug("Taking slow path");
+    const int epoch = editEpoch->load();
+    vector<pair<string, double>> phaseTimes;
+    PhaseClock clock(phaseTimes);
 
     UnorderedSet<int> updatedFiles;
     vector<ast::ParsedFile> indexedCopies;
@@ -212,7 +453,7 @@ LSPLoop::TypecheckRun LSPLoop::runSlowPath(FileUpdates updates) const {
     {
         core::UnfreezeFileTable fileTableAccess(*finalGS);
         for (auto &file : updates.updatedFiles) {
-            auto pair = updateFile(move(finalGS), file, opts);
+            auto pair = updateFile(move(finalGS), file, opts, kvstore);
             finalGS = move(pair.first);
             auto &ast = pair.second;
             if (ast.tree) {
@@ -223,32 +464,144 @@ LSPLoop::TypecheckRun LSPLoop::runSlowPath(FileUpdates updates) const {
         }
     }
 
-    // Copy the indexes of unchanged files.
+    clock.lap("index");
+
+    // Copy the indexes of unchanged files, and load the ones that were evicted.
+    vector<const ast::ParsedFile *> unchanged;
+    vector<core::FileRef> unchangedEvicted;
     for (const auto &tree : indexed) {
+        if (updatedFiles.contains(tree.file.id())) {
+            continue;
+        }
         // Note: indexed entries for payload files don't have any contents.
-        if (tree.tree && !updatedFiles.contains(tree.file.id())) {
-            indexedCopies.emplace_back(ast::ParsedFile{tree.tree->deepCopy(), tree.file});
+        if (tree.tree) {
+            unchanged.emplace_back(&tree);
+        } else if (tree.file.exists() && evictedTrees.contains(tree.file)) {
+            unchangedEvicted.emplace_back(tree.file);
         }
     }
+    for (auto &copy : copyTrees(workers, unchanged)) {
+        indexedCopies.emplace_back(move(copy));
+    }
+    for (auto &loaded : loadEvictedTrees(*finalGS, workers, evictedTrees, unchangedEvicted)) {
+        indexedCopies.emplace_back(move(loaded));
+    }
+    clock.lap("copy_trees");
 
     ENFORCE(finalGS->lspQuery.isEmpty());
-    auto resolved = pipeline::resolve(finalGS, move(indexedCopies), opts, workers, skipConfigatron);
+    unique_ptr<KeyValueStore> noConfigatronCache;
+    // Configatron files that changed since reIndexFromFileSystem are entered on top of what initialGS has, so keys
+    // removed from them stay defined until the next restart.
+    const bool configatronEntered =
+        !configatronDigest.empty() && pipeline::configatronDigest(opts) == configatronDigest;
+    auto resolved = pipeline::resolve(finalGS, move(indexedCopies), opts, workers, noConfigatronCache,
+                                      skipConfigatron || configatronEntered);
+    clock.lap("resolve");
     vector<core::FileRef> affectedFiles;
     for (auto &tree : resolved) {
         ENFORCE(tree.file.exists());
         affectedFiles.push_back(tree.file);
     }
-    pipeline::typecheck(finalGS, move(resolved), opts, workers);
+    // Set by whichever worker first notices a newer update, so that a run that finished every file is never reported
+    // as canceled.
+    atomic<bool> canceled{false};
+    function<bool()> isCanceled;
+    if (cancelable) {
+        isCanceled = [&canceled, epoch, editEpoch = this->editEpoch]() -> bool {
+            if (!canceled.load() && editEpoch->load() != epoch) {
+                canceled.store(true);
+            }
+            return canceled.load();
+        };
+    }
+    // Errors are replayed from the cache for the files that neither changed nor depend on a definition that did since
+    // they were cached, which after a restart is most of them: its first slow path only has to resolve everything.
+    pipeline::typecheck(finalGS, move(resolved), opts, workers, kvstore, isCanceled);
+    if (kvstore && !kvstore->flush()) {
+        logger->debug("Failed to write typecheck results to the cache");
+    }
     auto out = initialGS->errorQueue->drainWithQueryResponses();
     finalGS->lspTypecheckCount++;
     finalGS->lspQuery = core::lsp::Query::noQuery();
-    return TypecheckRun{move(out.first), move(affectedFiles), move(finalGS), move(updates), false};
+    clock.lap("typecheck");
+    if (canceled.load()) {
+        prodCategoryCounterInc("lsp.updates", "slowpath_canceled");
+        logger->debug("Canceled slow path because a newer file update arrived");
+        TypecheckRun run{{}, {}, move(finalGS), move(updates), false, true};
+        run.phaseTimes = move(phaseTimes);
+        return run;
+    }
+    TypecheckRun run{move(out.first), move(affectedFiles), move(finalGS), move(updates), false};
+    run.phaseTimes = move(phaseTimes);
+    return run;
 }
 
-bool LSPLoop::canTakeFastPath(const FileUpdates &updates, const vector<core::FileHash> &hashes) const {
-    if (disableFastPath) {
-        logger->debug("Taking slow path because fast path is disabled.");
+namespace {
+// Whether `newHash` only changes methods of `oldHash`: classes, constants and fields stayed the same. The namer can
+// add such methods to the existing symbol table, once the ones the file removed or reshaped are deleted.
+bool onlyChangesMethods(const CompactFileHash &oldHash, const core::GlobalStateHash &newHash) {
+    return oldHash.classHierarchyHash == newHash.classHierarchyHash;
+}
+
+// The names of the methods in `oldHash` that are missing from `newHash` or have a different shape there.
+vector<core::NameHash> removedOrReshapedMethods(const CompactFileHash &oldHash, const core::GlobalStateHash &newHash) {
+    vector<core::NameHash> result;
+    for (auto &[name, shapeHash] : oldHash.methodShapeHashes) {
+        auto fnd = newHash.methodShapeHashes.find(name);
+        if (fnd == newHash.methodShapeHashes.end() || fnd->second != shapeHash) {
+            result.emplace_back(name);
+        }
+    }
+    core::NameHash::sortAndDedupe(result);
+    return result;
+}
+
+// Calls `fn` on every method called one of `names` (which must be sorted) that `file` defines.
+template <class F>
+void forEachMethodDefinedIn(const core::GlobalState &gs, core::FileRef file, const vector<core::NameHash> &names,
+                            F fn) {
+    if (names.empty()) {
+        return;
+    }
+    const auto symbolsUsed = gs.symbolsUsed();
+    for (u4 i = 1; i < symbolsUsed; i++) {
+        core::SymbolRef sym(gs, i);
+        auto data = sym.data(gs);
+        if (!data->isMethod() ||
+            absl::c_none_of(data->locs(), [&](const core::Loc &loc) { return loc.file() == file; })) {
+            continue;
+        }
+        if (absl::c_binary_search(names, core::NameHash(gs, data->name.data(gs)))) {
+            fn(sym);
+        }
+    }
+}
+
+// Deletes the methods `file` used to define under one of `names`, so that the namer enters them afresh from the new
+// contents of the file instead of reporting them as redefined, or not at all if they were removed. Like for a
+// redefinition, deleting means mangle-renaming them out of the way, so every symbol keeps its SymbolRef.
+void deleteMethodsDefinedIn(core::GlobalState &gs, core::FileRef file, const vector<core::NameHash> &names) {
+    vector<core::SymbolRef> toDelete;
+    forEachMethodDefinedIn(gs, file, names, [&](core::SymbolRef sym) { toDelete.emplace_back(sym); });
+    core::UnfreezeNameTable nameTableAccess(gs);
+    core::UnfreezeSymbolTable symbolTableAccess(gs);
+    for (auto sym : toDelete) {
+        gs.mangleRenameSymbol(sym, sym.data(gs)->name);
+    }
+}
+} // namespace
+
+bool LSPLoop::canTakeFastPath(const FileUpdates &updates, const vector<core::FileHash> &hashes, string &reason) const {
+    auto slowPath = [&](string why) {
+        logger->debug("Taking slow path because {}", why);
+        reason = move(why);
         return false;
+    };
+    if (disableFastPath) {
+        return slowPath("fast path is disabled");
+    }
+    if (slowPathCanceled) {
+        return slowPath("the last slow path was canceled");
     }
     auto &changedFiles = updates.updatedFiles;
     logger->debug("Trying to see if fast path is available after {} file changes", changedFiles.size());
@@ -260,22 +613,69 @@ bool LSPLoop::canTakeFastPath(const FileUpdates &updates, const vector<core::Fil
             ++i;
             auto fref = initialGS->findFileByPath(f->path());
             if (!fref.exists()) {
-                logger->debug("Taking slow path because {} is a new file", f->path());
-                return false;
+                return slowPath(fmt::format("{} is a new file", f->path()));
             } else {
                 auto &oldHash = globalStateHashes[fref.id()];
-                ENFORCE(oldHash.definitions.hierarchyHash != core::GlobalStateHash::HASH_STATE_NOT_COMPUTED);
+                ENFORCE(oldHash.hierarchyHash != core::GlobalStateHash::HASH_STATE_NOT_COMPUTED);
                 if (hashes[i].definitions.hierarchyHash != core::GlobalStateHash::HASH_STATE_INVALID &&
-                    hashes[i].definitions.hierarchyHash != oldHash.definitions.hierarchyHash) {
-                    logger->debug("Taking slow path because {} has changed definitions", f->path());
-                    return false;
+                    hashes[i].definitions.hierarchyHash != oldHash.hierarchyHash) {
+                    if (!onlyChangesMethods(oldHash, hashes[i].definitions)) {
+                        return slowPath(fmt::format("{} has changed definitions", f->path()));
+                    }
+                    // A method that other files define too can't be deleted and re-entered from this file alone.
+                    bool definedElsewhere = false;
+                    forEachMethodDefinedIn(*initialGS, fref,
+                                           removedOrReshapedMethods(oldHash, hashes[i].definitions),
+                                           [&](core::SymbolRef sym) {
+                                               definedElsewhere |= absl::c_any_of(
+                                                   sym.data(*initialGS)->locs(),
+                                                   [&](const core::Loc &loc) { return loc.file() != fref; });
+                                           });
+                    if (definedElsewhere) {
+                        return slowPath(fmt::format("{} changes a method defined in other files too", f->path()));
+                    }
+                    logger->debug("{} only changes methods, patching them into the symbol table", f->path());
                 }
             }
         }
     }
+    reason = "only methods changed";
     return true;
 }
 
+void LSPLoop::lendToQueryThread(unique_ptr<core::GlobalState> gs, const FileUpdates &updates) const {
+    if (activeQueueState == nullptr) {
+        // Not running `runLSP`, so there is no query thread.
+        return;
+    }
+    UnorderedSet<string> staleUris;
+    for (auto &f : updates.updatedFiles) {
+        if (absl::StartsWith(f->path(), rootPath)) {
+            staleUris.insert(localName2Remote(f->path(), false));
+            staleUris.insert(localName2Remote(f->path(), true));
+        }
+    }
+    absl::MutexLock lck(activeQueueMtx);
+    ENFORCE(activeQueueState->querySnapshot == nullptr);
+    activeQueueState->querySnapshot = move(gs);
+    activeQueueState->querySnapshotStaleUris = move(staleUris);
+}
+
+void LSPLoop::reclaimFromQueryThread() const {
+    if (activeQueueState == nullptr) {
+        return;
+    }
+    unique_ptr<core::GlobalState> snapshot;
+    {
+        absl::MutexLock lck(activeQueueMtx);
+        activeQueueMtx->Await(absl::Condition(
+            +[](LSPLoop::QueueState *state) -> bool { return !state->servingQuery; }, activeQueueState));
+        snapshot = move(activeQueueState->querySnapshot);
+        activeQueueState->querySnapshotStaleUris.clear();
+    }
+    // `snapshot` is destroyed outside of the lock.
+}
+
 LSPLoop::TypecheckRun LSPLoop::runTypechecking(unique_ptr<core::GlobalState> gs, FileUpdates updates) const {
     // We assume gs is a copy of initialGS, which has had the inferencer & resolver run.
     ENFORCE(gs->lspTypecheckCount > 0,
@@ -283,13 +683,21 @@ LSPLoop::TypecheckRun LSPLoop::runTypechecking(unique_ptr<core::GlobalState> gs,
 
     bool takeFastPath = false;
     vector<core::FileRef> subset;
+    // The part of each updated file that changed, for typechecking to reuse what it can. See `pipeline::MethodReuse`.
+    UnorderedMap<core::FileRef, pipeline::MethodReuse> methodReuse;
     vector<core::NameHash> changedHashes;
+    // Methods that were added or deleted. Besides their callers, files that define a method of the same name need
+    // rechecking, as it may now be an override or no longer be one.
+    vector<core::NameHash> addedHashes;
+    string fastPathDecision;
+    vector<pair<string, double>> phaseTimes;
+    PhaseClock clock(phaseTimes);
     {
         Timer timeit(logger, "fast_path_decision");
         auto hashes = computeStateHashes(updates.updatedFiles);
         logger->debug("Trying to see if fast path is available after {} file changes", updates.updatedFiles.size());
         ENFORCE(updates.updatedFiles.size() == hashes.size());
-        takeFastPath = canTakeFastPath(updates, hashes);
+        takeFastPath = canTakeFastPath(updates, hashes, fastPathDecision);
 
         int i = -1;
         for (auto &f : updates.updatedFiles) {
@@ -299,12 +707,38 @@ LSPLoop::TypecheckRun LSPLoop::runTypechecking(unique_ptr<core::GlobalState> gs,
                 // Update to existing file on fast path
                 auto &oldHash = globalStateHashes[fref.id()];
                 for (auto &p : hashes[i].definitions.methodHashes) {
-                    auto fnd = oldHash.definitions.methodHashes.find(p.first);
-                    ENFORCE(fnd != oldHash.definitions.methodHashes.end(), "definitionHash should have failed");
-                    if (fnd->second != p.second) {
+                    auto oldMethodHash = oldHash.findMethodHash(p.first);
+                    if (!oldMethodHash.has_value()) {
+                        changedHashes.emplace_back(p.first);
+                        addedHashes.emplace_back(p.first);
+                    } else if (*oldMethodHash != p.second) {
                         changedHashes.emplace_back(p.first);
                     }
                 }
+                auto deleted = removedOrReshapedMethods(oldHash, hashes[i].definitions);
+                changedHashes.insert(changedHashes.end(), deleted.begin(), deleted.end());
+                addedHashes.insert(addedHashes.end(), deleted.begin(), deleted.end());
+                deleteMethodsDefinedIn(*gs, fref, deleted);
+                auto oldSource = fref.data(*gs).source();
+                auto newSource = f->source();
+                auto &reuse = methodReuse[fref];
+                const u4 shorter = min(oldSource.size(), newSource.size());
+                u4 prefix = 0;
+                while (prefix < shorter && oldSource[prefix] == newSource[prefix]) {
+                    prefix++;
+                }
+                u4 suffix = 0;
+                while (suffix < shorter - prefix &&
+                       oldSource[oldSource.size() - 1 - suffix] == newSource[newSource.size() - 1 - suffix]) {
+                    suffix++;
+                }
+                if (core::File::fileSigil(oldSource) != core::File::fileSigil(newSource)) {
+                    // Every method may report different errors now.
+                    prefix = suffix = 0;
+                }
+                reuse.editBegin = prefix;
+                reuse.editOldEnd = oldSource.size() - suffix;
+                reuse.editNewEnd = newSource.size() - suffix;
                 gs = core::GlobalState::replaceFile(move(gs), fref, f);
                 subset.emplace_back(fref);
             }
@@ -312,48 +746,113 @@ LSPLoop::TypecheckRun LSPLoop::runTypechecking(unique_ptr<core::GlobalState> gs,
             updates.updatedFileHashes.push_back(make_pair(f->path(), hashes[i]));
         }
         core::NameHash::sortAndDedupe(changedHashes);
+        core::NameHash::sortAndDedupe(addedHashes);
     }
+    clock.lap("fast_path_decision");
 
     if (!takeFastPath) {
-        return runSlowPath(move(updates));
+        // The slow path starts over from initialGS, so `gs` can answer queries in the meantime.
+        lendToQueryThread(move(gs), updates);
+        auto run = runSlowPath(move(updates), true);
+        reclaimFromQueryThread();
+        run.fastPathDecision = move(fastPathDecision);
+        run.phaseTimes.insert(run.phaseTimes.begin(), phaseTimes.begin(), phaseTimes.end());
+        return run;
     }
 
     Timer timeit(logger, "fast_path");
-    int i = -1;
-    for (auto &oldHash : globalStateHashes) {
-        i++;
-        vector<core::NameHash> intersection;
-        std::set_intersection(changedHashes.begin(), changedHashes.end(), oldHash.usages.sends.begin(),
-                              oldHash.usages.sends.end(), std::back_inserter(intersection));
-        if (!intersection.empty()) {
-            auto ref = core::FileRef(i);
-            logger->debug("Added {} to update set as used a changed method", !ref.exists() ? "" : ref.data(*gs).path());
-            subset.emplace_back(ref);
+    vector<core::FileRef> dependents;
+    nameUsageIndex.filesSending(changedHashes, dependents);
+    // `usages.constants` includes the names of methods the file defines.
+    nameUsageIndex.filesUsingConstant(addedHashes, dependents);
+    fast_sort(dependents);
+    dependents.erase(std::unique(dependents.begin(), dependents.end()), dependents.end());
+    vector<core::FileRef> deferred;
+    for (auto ref : dependents) {
+        if (!gs->inTypecheckShard(ref)) {
+            // Another server typechecks it and publishes its diagnostics.
+            continue;
         }
+        if (opts.lspDeferClosedDependents && ref.exists() && !openFiles.contains(ref.data(*gs).path()) &&
+            absl::c_find(subset, ref) == subset.end()) {
+            logger->debug("Deferred {}, which uses a changed method but isn't open", ref.data(*gs).path());
+            deferred.emplace_back(ref);
+            continue;
+        }
+        logger->debug("Added {} to update set as used a changed method", !ref.exists() ? "" : ref.data(*gs).path());
+        subset.emplace_back(ref);
     }
     // Remove any duplicate files.
     fast_sort(subset);
     subset.resize(std::distance(subset.begin(), std::unique(subset.begin(), subset.end())));
 
+    // An edit that changed no definitions can only have changed what typechecking the methods it touched reports. What
+    // was recorded for a deferred file predates the edit that deferred it, though.
+    for (auto &f : subset) {
+        auto &reuse = methodReuse[f];
+        if (auto fnd = typecheckedMethods.find(f); fnd != typecheckedMethods.end() && changedHashes.empty() &&
+                                                   !absl::c_binary_search(deferredFiles, f)) {
+            reuse.before = &fnd->second;
+        }
+    }
+
     prodCategoryCounterInc("lsp.updates", "fastpath");
     logger->debug("Taking fast path");
+    clock.lap("find_dependents");
+    auto run = typecheckOnFastPath(move(gs), move(updates), move(subset), move(methodReuse));
+    run.deferredFiles = move(deferred);
+    run.fastPathDecision = move(fastPathDecision);
+    run.phaseTimes.insert(run.phaseTimes.begin(), phaseTimes.begin(), phaseTimes.end());
+    return run;
+}
+
+LSPLoop::TypecheckRun
+LSPLoop::typecheckOnFastPath(unique_ptr<core::GlobalState> gs, FileUpdates updates, vector<core::FileRef> subset,
+                             UnorderedMap<core::FileRef, pipeline::MethodReuse> methodReuse) const {
     ENFORCE(initialGS->errorQueue->isEmpty());
+    vector<pair<string, double>> phaseTimes;
+    PhaseClock clock(phaseTimes);
     vector<ast::ParsedFile> updatedIndexed;
     for (auto &f : subset) {
-        unique_ptr<KeyValueStore> kvstore; // nullptr
-        // TODO: Thread through kvstore.
-        ENFORCE(this->kvstore == nullptr);
+        // `gs` was copied from `initialGS`, so it has every name that trees cached by `reIndexFromFileSystem` use.
         auto t = pipeline::indexOne(opts, *gs, f, kvstore);
         updatedIndexed.emplace_back(ast::ParsedFile{t.tree->deepCopy(), t.file});
         updates.updatedFileIndexes.push_back(move(t));
     }
 
+    clock.lap("index");
+
     ENFORCE(gs->lspQuery.isEmpty());
-    auto resolved = pipeline::incrementalResolve(*gs, move(updatedIndexed), opts);
-    pipeline::typecheck(gs, move(resolved), opts, workers);
+    auto resolved = pipeline::incrementalResolve(*gs, move(updatedIndexed), opts, workers);
+    clock.lap("resolve");
+    unique_ptr<KeyValueStore> noKvstore; // typecheck results aren't cached in LSP.
+    pipeline::typecheck(gs, move(resolved), opts, workers, noKvstore, nullptr, &methodReuse);
     auto out = initialGS->errorQueue->drainWithQueryResponses();
     gs->lspTypecheckCount++;
-    return TypecheckRun{move(out.first), move(subset), move(gs), move(updates), true};
+    clock.lap("typecheck");
+    TypecheckRun run{move(out.first), move(subset), move(gs), move(updates), true};
+    run.phaseTimes = move(phaseTimes);
+    for (auto &[file, reuse] : methodReuse) {
+        run.typecheckedMethods[file] = move(reuse.after);
+    }
+    return run;
+}
+
+LSPResult LSPLoop::typecheckDeferredFiles(unique_ptr<core::GlobalState> gs) {
+    // A batch at a time, so that a request that arrives meanwhile waits for one batch at most.
+    constexpr size_t BATCH_SIZE = 100;
+    Timer timeit(logger, "fast_path_deferred");
+    prodCategoryCounterInc("lsp.updates", "fastpath_deferred");
+    const auto batchSize = min(BATCH_SIZE, deferredFiles.size());
+    vector<core::FileRef> batch(deferredFiles.end() - batchSize, deferredFiles.end());
+    deferredFiles.resize(deferredFiles.size() - batchSize);
+    logger->debug("Typechecking {} deferred files, {} left", batch.size(), deferredFiles.size());
+    // Reusing nothing, but recording what each method reports for the next edit to reuse.
+    UnorderedMap<core::FileRef, pipeline::MethodReuse> methodReuse;
+    for (auto file : batch) {
+        methodReuse[file];
+    }
+    return commitTypecheckRun(typecheckOnFastPath(move(gs), {}, move(batch), move(methodReuse)));
 }
 
 LSPLoop::QueryRun LSPLoop::runQuery(unique_ptr<core::GlobalState> gs, const core::lsp::Query &q,
@@ -364,7 +863,8 @@ LSPLoop::QueryRun LSPLoop::runQuery(unique_ptr<core::GlobalState> gs, const core
 
     Timer timeit(logger, "query");
     prodCategoryCounterInc("lsp.updates", "query");
-    ENFORCE(initialGS->errorQueue->isEmpty());
+    // On the query thread, `gs` has an error queue of its own; see `lendToQueryThread`.
+    ENFORCE(gs->errorQueue->isEmpty());
     vector<ast::ParsedFile> updatedIndexed;
     for (auto &f : filesForQuery) {
         const int id = f.id();
@@ -372,18 +872,85 @@ LSPLoop::QueryRun LSPLoop::runQuery(unique_ptr<core::GlobalState> gs, const core
         const auto &parsedFile = it == indexedFinalGS.end() ? indexed[id] : it->second;
         if (parsedFile.tree) {
             updatedIndexed.emplace_back(ast::ParsedFile{parsedFile.tree->deepCopy(), parsedFile.file});
+        } else if (it == indexedFinalGS.end() && evictedTrees.contains(f)) {
+            updatedIndexed.emplace_back(ast::ParsedFile{evictedTrees.load(*gs, f), f});
         }
     }
 
     ENFORCE(gs->lspQuery.isEmpty());
     gs->lspQuery = q;
-    auto resolved = pipeline::incrementalResolve(*gs, move(updatedIndexed), opts);
+    auto &queryWorkers = this_thread::get_id() == mainThreadId ? workers : *queryThreadWorkers;
+    auto resolved = pipeline::incrementalResolve(*gs, move(updatedIndexed), opts, queryWorkers);
     tryApplyDefLocSaver(*gs, resolved);
     tryApplyLocalVarSaver(*gs, resolved);
-    pipeline::typecheck(gs, move(resolved), opts, workers);
-    auto out = initialGS->errorQueue->drainWithQueryResponses();
+    pipeline::typecheck(gs, move(resolved), opts, queryWorkers, kvstore);
+    auto out = gs->errorQueue->drainWithQueryResponses();
     gs->lspTypecheckCount++;
     gs->lspQuery = core::lsp::Query::noQuery();
     return QueryRun{move(gs), move(out.second)};
 }
+
+namespace {
+// Returns the narrowest method range of `methods` around `loc`, if it has no other method within it. A range with
+// another within it is a <static-init> spanning the classes in it, whose code typechecking it alone would miss.
+optional<pair<u4, u4>> enclosingMethod(const pipeline::TypecheckedMethods &methods, core::Loc loc) {
+    optional<pair<u4, u4>> found;
+    for (auto &method : methods.methods) {
+        if (method.begin <= loc.beginPos() && loc.endPos() <= method.end &&
+            (!found || (found->first <= method.begin && method.end <= found->second))) {
+            found = make_pair(method.begin, method.end);
+        }
+    }
+    if (found) {
+        for (auto &method : methods.methods) {
+            if (found->first <= method.begin && method.end <= found->second &&
+                make_pair(method.begin, method.end) != *found) {
+                return nullopt;
+            }
+        }
+    }
+    return found;
+}
+
+bool coversLoc(const core::lsp::Query &query, core::Loc loc) {
+    return query.kind == core::lsp::Query::Kind::FILE || query.loc.contains(loc);
+}
+} // namespace
+
+LSPLoop::QueryRun LSPLoop::runLocQuery(unique_ptr<core::GlobalState> gs, core::Loc loc) const {
+    auto fref = loc.file();
+    auto &cached = queryResponseCache[fref];
+    auto it = absl::c_find_if(cached, [&](const auto &entry) -> bool { return coversLoc(entry.query, loc); });
+    if (it == cached.end()) {
+        auto query = core::lsp::Query::createFileQuery(fref);
+        auto methods = typecheckedMethods.find(fref);
+        if (methods != typecheckedMethods.end()) {
+            if (auto method = enclosingMethod(methods->second, loc)) {
+                query = core::lsp::Query::createMethodQuery(core::Loc(fref, method->first, method->second));
+            }
+        }
+        prodCategoryCounterInc("lsp.query_cache",
+                               query.kind == core::lsp::Query::Kind::METHOD ? "miss_method" : "miss");
+        auto run = runQuery(move(gs), query, {fref});
+        gs = move(run.gs);
+        if (queryResponseCache.size() > MAX_QUERY_RESPONSE_CACHE_FILES) {
+            queryResponseCache.clear();
+        }
+        auto &entries = queryResponseCache[fref];
+        entries.push_back(CachedQueryResponses{query, move(run.responses)});
+        it = entries.end() - 1;
+    } else {
+        prodCategoryCounterInc("lsp.query_cache", "hit");
+    }
+
+    // The cached responses are already sorted most precise first, and filtering preserves that.
+    auto q = core::lsp::Query::createLocQuery(loc);
+    vector<unique_ptr<core::lsp::QueryResponse>> responses;
+    for (auto &response : it->responses) {
+        if (q.matchesLoc(response->getLoc())) {
+            responses.emplace_back(make_unique<core::lsp::QueryResponse>(*response));
+        }
+    }
+    return QueryRun{move(gs), move(responses)};
+}
 } // namespace sorbet::realmain::lsp
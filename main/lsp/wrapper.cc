@@ -71,9 +71,16 @@ LSPWrapper::LSPWrapper(options::Options &&options, std::string_view rootPath, bo
     auto logger = make_shared<spd::logger>("console", stderrColorSink);
     typeErrorsConsole = make_shared<spd::logger>("typeDiagnostics", stderrColorSink);
     typeErrorsConsole->set_pattern("%v");
-    auto gs = make_unique<core::GlobalState>((make_shared<core::ErrorQueue>(*typeErrorsConsole, *logger)));
-    unique_ptr<KeyValueStore> kvstore;
-    payload::createInitialGlobalState(gs, opts, kvstore);
+    auto errorQueue = make_shared<core::ErrorQueue>(*typeErrorsConsole, *logger);
+    unique_ptr<core::GlobalState> gs;
+    if (opts.noStdlib) {
+        gs = make_unique<core::GlobalState>(move(errorQueue));
+        unique_ptr<KeyValueStore> kvstore;
+        payload::createInitialGlobalState(gs, opts, kvstore);
+    } else {
+        // Tests and tools create many wrappers in one process; only the first one pays for loading the payload.
+        gs = payload::copyPayloadGlobalState(move(errorQueue));
+    }
 
     // If we don't tell the errorQueue to ignore flushes, then we won't get diagnostic messages.
     gs->errorQueue->ignoreFlushes = true;
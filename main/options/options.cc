@@ -3,6 +3,7 @@
 #include "yaml-cpp/yaml.h"
 #include <cxxopts.hpp>
 
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_split.h"
 #include "common/FileOps.h"
 #include "common/Timer.h"
@@ -53,12 +54,15 @@ const vector<PrintOptions> print_options({
     {"cfg", &Printers::CFG, true},
     {"cfg-json", &Printers::CFGJson, true},
     {"cfg-proto", &Printers::CFGProto, true},
+    {"call-graph", &Printers::CallGraph, true},
     {"autogen", &Printers::Autogen, true},
     {"autogen-msgpack", &Printers::AutogenMsgPack, true},
     {"autogen-classlist", &Printers::AutogenClasslist, true},
     {"autogen-autoloader", &Printers::AutogenAutoloader, true, false},
     {"autogen-subclasses", &Printers::AutogenSubclasses, true},
     {"plugin-generated-code", &Printers::PluginGeneratedCode, true},
+    {"slow-report", &Printers::SlowReport, true},
+    {"memory-report", &Printers::MemoryReport, true},
 });
 
 PrinterConfig::PrinterConfig() : state(make_shared<GuardedState>()){};
@@ -108,12 +112,15 @@ vector<reference_wrapper<PrinterConfig>> Printers::printers() {
         CFG,
         CFGJson,
         CFGProto,
+        CallGraph,
         Autogen,
         AutogenMsgPack,
         AutogenClasslist,
         AutogenAutoloader,
         AutogenSubclasses,
         PluginGeneratedCode,
+        SlowReport,
+        MemoryReport,
     });
 }
 
@@ -307,6 +314,9 @@ buildOptions(const vector<pipeline::semantic_extension::SemanticExtensionProvide
                                     cxxopts::value<vector<string>>(), "path");
     options.add_options("advanced")("web-trace-file", "Web trace file. For use with chrome about://tracing",
                                     cxxopts::value<string>()->default_value(empty.webTraceFile), "file");
+    options.add_options("advanced")(
+        "web-trace-sample-every", "Only write one in this many events about individual files to --web-trace-file",
+        cxxopts::value<int>()->default_value(fmt::format("{}", empty.webTraceSampleEvery)), "n");
     options.add_options("advanced")("debug-log-file", "Path to debug log file",
                                     cxxopts::value<string>()->default_value(empty.debugLogFile), "file");
     options.add_options("advanced")("reserve-mem-kb",
@@ -321,17 +331,29 @@ buildOptions(const vector<pipeline::semantic_extension::SemanticExtensionProvide
     options.add_options("advanced")(
         "suggest-runtime-profiled",
         "When suggesting signatures in `typed: strict` mode, suggest `::T::Utils::RuntimeProfiled`");
+    options.add_options("advanced")("suggest-sigs-only",
+                                    "Only typecheck methods without a sig, to suggest sigs for them sooner");
     options.add_options("advanced")("P,progress", "Draw progressbar");
     options.add_options("advanced")("license", "Show license");
     options.add_options("advanced")("color", "Use color output", cxxopts::value<string>()->default_value("auto"),
                                     "{always,never,[auto]}");
     options.add_options("advanced")("lsp", "Start in language-server-protocol mode");
+    options.add_options("advanced")("lsp-socket",
+                                    "In language-server-protocol mode, serve sessions one after another on this Unix "
+                                    "domain socket instead of stdio, starting each from the same initial state",
+                                    cxxopts::value<string>()->default_value(empty.lspSocketPath), "path");
     options.add_options("advanced")("no-config", "Do not load the content of the `sorbet/config` file");
     options.add_options("advanced")("disable-watchman",
                                     "When in language-server-protocol mode, disable file watching via Watchman");
     options.add_options("advanced")("watchman-path",
                                     "Path to watchman executable. Defaults to using `watchman` on your PATH.",
                                     cxxopts::value<string>()->default_value(empty.watchmanPath));
+    options.add_options("advanced")(
+        "watchman-settle-ms",
+        "When in language-server-protocol mode, wait until Watchman has reported no file changes for this many "
+        "milliseconds before typechecking them, so that bursts of changes (e.g. from switching branches) are "
+        "typechecked together (0 to disable)",
+        cxxopts::value<int>()->default_value(to_string(empty.watchmanSettleMs)), "ms");
     options.add_options("advanced")("enable-experimental-lsp-autocomplete",
                                     "Enable experimental LSP feature: Autocomplete");
     options.add_options("advanced")("enable-experimental-lsp-workspace-symbols",
@@ -354,7 +376,34 @@ buildOptions(const vector<pipeline::semantic_extension::SemanticExtensionProvide
         "Directory prefixes that are not accessible editor-side. References to files in these directories will be sent "
         "as sorbet: URIs to clients that understand them.",
         cxxopts::value<vector<string>>(), "string");
+    options.add_options("advanced")(
+        "lsp-diagnostics-coalesce-ms",
+        "When in language-server-protocol mode, hold diagnostics back for up to this many milliseconds while more "
+        "requests are queued, and only send the latest ones for each file (0 to disable)",
+        cxxopts::value<int>()->default_value(to_string(empty.lspDiagnosticsCoalesceMs)), "ms");
+    options.add_options("advanced")("lsp-evict-closed-trees",
+                                    "When in language-server-protocol mode, keep the indexed trees of files that "
+                                    "aren't open in a temporary file rather than in memory");
+    options.add_options("advanced")("lsp-defer-closed-dependents",
+                                    "When in language-server-protocol mode, typecheck the files an edit affects that "
+                                    "aren't open only once no requests are waiting, after publishing diagnostics for "
+                                    "the open ones");
+    options.add_options("advanced")(
+        "lsp-memory-ceiling-mib",
+        "When in language-server-protocol mode, once a slow path leaves the process using more than this many MiB, "
+        "keep the indexed trees of files that aren't open in a temporary file from then on, like "
+        "--lsp-evict-closed-trees (0 for no limit)",
+        cxxopts::value<int>()->default_value(to_string(empty.lspMemoryCeilingMiB)), "MiB");
     options.add_options("advanced")("no-error-count", "Do not print the error count summary line");
+    options.add_options("advanced")("max-errors",
+                                    "Stop typechecking files once this many errors have been reported (0 for no "
+                                    "limit)",
+                                    cxxopts::value<int>()->default_value(to_string(empty.maxErrors)), "count");
+    options.add_options("advanced")(
+        "max-memory-mib",
+        "Once resolving leaves the process using more than this many MiB, keep the resolved trees in a temporary file "
+        "rather than in memory, and load each one back only to typecheck it (0 for no limit)",
+        cxxopts::value<int>()->default_value(to_string(empty.maxMemoryMiB)), "MiB");
     options.add_options("advanced")("autogen-version", "Autogen version to output", cxxopts::value<int>());
     options.add_options("advanced")("stripe-mode", "Enable Stripe specific error enforcement", cxxopts::value<bool>());
 
@@ -384,6 +433,15 @@ buildOptions(const vector<pipeline::semantic_extension::SemanticExtensionProvide
                                     "Error URL base string. If set, error URLs are generated by prefixing the "
                                     "error code with this string.",
                                     cxxopts::value<string>()->default_value(empty.errorUrlBase), "url-base");
+    options.add_options("advanced")("error-format",
+                                    "How to print errors: as text with source snippets, or as one JSON object per "
+                                    "line (which implies --no-error-count and --color=never)",
+                                    cxxopts::value<string>()->default_value("text"), "{[text],jsonl}");
+    options.add_options("advanced")("load-state",
+                                    "Start from a state stored with --store-state in place of the built-in payload, "
+                                    "e.g. one with the project's gem RBIs baked in. Files in it are not indexed or "
+                                    "typechecked again",
+                                    cxxopts::value<string>()->default_value(empty.loadState), "file");
     // Developer options
     options.add_options("dev")("p,print", to_string(all_prints), cxxopts::value<vector<string>>(), "type");
     options.add_options("dev")("autogen-subclasses-parent",
@@ -420,11 +478,45 @@ buildOptions(const vector<pipeline::semantic_extension::SemanticExtensionProvide
                                cxxopts::value<string>()->default_value(""), "filepath.yaml");
     options.add_options("dev")("store-state", "Store state into file",
                                cxxopts::value<string>()->default_value(empty.storeState), "file");
+    options.add_options("dev")("store-state-uncompressed",
+                               "Don't compress the state stored by --store-state. A payload built from it is larger, "
+                               "but is read in place, so processes running the same executable share its memory");
     options.add_options("dev")("cache-dir", "Use the specified folder to cache data",
                                cxxopts::value<string>()->default_value(empty.cacheDir), "dir");
+    options.add_options("dev")("cache-max-unused-runs",
+                               "Remove the cached entries that none of the last n runs with --cache-dir used (0 to "
+                               "keep them all)",
+                               cxxopts::value<int>()->default_value(to_string(empty.cacheMaxUnusedRuns)), "n");
+    options.add_options("dev")("compact-cache",
+                               "Compact the database in --cache-dir, to give back the space removed entries left, and "
+                               "exit. No other process may use the cache meanwhile");
+    options.add_options("dev")("print-affected-files-since",
+                               "Print the input files whose typecheck the changes to them since the checkout in dir "
+                               "could affect, one per line, and exit. Only hashes the files, reusing the hashes "
+                               "cached in --cache-dir",
+                               cxxopts::value<string>()->default_value(empty.affectedFilesSince), "dir");
+    options.add_options("dev")("changed-files",
+                               "Only typecheck the input files that the changes to these files since the last run "
+                               "with --changed-files could affect. Needs --cache-dir, which keeps what that run saw",
+                               cxxopts::value<vector<string>>(), "file");
+    options.add_options("dev")("shared-cache-dir",
+                               "Share caches with other runs, such as on other machines, through this folder. An "
+                               "empty --cache-dir starts as a copy of the last cache stored there, and the cache is "
+                               "stored there after each run",
+                               cxxopts::value<string>()->default_value(empty.sharedCacheDir), "dir");
+    options.add_options("dev")("shared-cache-read-only", "Don't store the cache in --shared-cache-dir after the run");
     options.add_options("dev")("suppress-non-critical", "Exit 0 unless there was a critical error");
     options.add_options("dev")("dsl-plugins", "YAML config that configures external DSL plugins",
                                cxxopts::value<string>()->default_value(""), "filepath.yaml");
+    options.add_options("dev")("typecheck-shard",
+                               "Only typecheck, and report errors in, the files of shard i out of n. The shards of a "
+                               "run together report the same errors as the whole run. Language-server-protocol mode "
+                               "still answers queries about every file",
+                               cxxopts::value<string>()->default_value("0/1"), "i/n");
+    options.add_options("dev")("sanity-check-sample",
+                               "In debug builds, only sanity check about one in n of the names, symbols and files, "
+                               "picked at random each run",
+                               cxxopts::value<int>()->default_value(to_string(empty.sanityCheckSample)), "n");
 
     int defaultThreads = thread::hardware_concurrency();
     if (defaultThreads == 0) {
@@ -433,6 +525,17 @@ buildOptions(const vector<pipeline::semantic_extension::SemanticExtensionProvide
 
     options.add_options("dev")("max-threads", "Set number of threads",
                                cxxopts::value<int>()->default_value(to_string(defaultThreads)), "int");
+    options.add_options("dev")("numa-workers",
+                               "Bind each worker thread to the CPUs of one NUMA node, and give the threads of each "
+                               "node their own allocator arena");
+    options.add_options("dev")("parallel-method-threshold",
+                               "Typecheck the methods of files with at least this many methods across all threads "
+                               "(0 to disable)",
+                               cxxopts::value<int>()->default_value(to_string(empty.parallelMethodThreshold)), "int");
+    options.add_options("dev")("slow-report-top",
+                               "How many of the slowest files or methods --print=slow-report lists per phase "
+                               "(0 for all of them)",
+                               cxxopts::value<int>()->default_value(to_string(empty.slowReportTop)), "int");
     options.add_options("dev")("counter", "Print internal counter", cxxopts::value<vector<string>>(), "counter");
     options.add_options("dev")("statsd-host", "StatsD sever hostname",
                                cxxopts::value<string>()->default_value(empty.statsdHost), "host");
@@ -664,6 +767,14 @@ void readOptions(Options &opts,
         opts.lspDocumentSymbolEnabled =
             enableAllLSPFeatures || raw["enable-experimental-lsp-document-symbol"].as<bool>();
         opts.lspSignatureHelpEnabled = enableAllLSPFeatures || raw["enable-experimental-lsp-signature-help"].as<bool>();
+        opts.lspDiagnosticsCoalesceMs = raw["lsp-diagnostics-coalesce-ms"].as<int>();
+        opts.lspEvictClosedTrees = raw["lsp-evict-closed-trees"].as<bool>();
+        opts.lspDeferClosedDependents = raw["lsp-defer-closed-dependents"].as<bool>();
+        opts.lspMemoryCeilingMiB = raw["lsp-memory-ceiling-mib"].as<int>();
+        if (opts.lspMemoryCeilingMiB < 0) {
+            logger->error("--lsp-memory-ceiling-mib must not be negative");
+            throw EarlyReturnWithCode(1);
+        }
 
         if (raw.count("lsp-directories-missing-from-client") > 0) {
             auto lspDirsMissingFromClient = raw["lsp-directories-missing-from-client"].as<vector<string>>();
@@ -678,6 +789,30 @@ void readOptions(Options &opts,
         }
 
         opts.cacheDir = raw["cache-dir"].as<string>();
+        opts.cacheMaxUnusedRuns = raw["cache-max-unused-runs"].as<int>();
+        if (opts.cacheMaxUnusedRuns < 0) {
+            logger->error("--cache-max-unused-runs must not be negative");
+            throw EarlyReturnWithCode(1);
+        }
+        opts.compactCache = raw["compact-cache"].as<bool>();
+        if (opts.compactCache && opts.cacheDir.empty()) {
+            logger->error("--compact-cache needs --cache-dir");
+            throw EarlyReturnWithCode(1);
+        }
+        opts.affectedFilesSince = raw["print-affected-files-since"].as<string>();
+        if (raw.count("changed-files") > 0) {
+            opts.changedFiles = raw["changed-files"].as<vector<string>>();
+            if (opts.cacheDir.empty()) {
+                logger->error("--changed-files needs --cache-dir");
+                throw EarlyReturnWithCode(1);
+            }
+        }
+        opts.sharedCacheDir = raw["shared-cache-dir"].as<string>();
+        opts.sharedCacheReadOnly = raw["shared-cache-read-only"].as<bool>();
+        if (!opts.sharedCacheDir.empty() && opts.cacheDir.empty()) {
+            logger->error("--shared-cache-dir needs --cache-dir");
+            throw EarlyReturnWithCode(1);
+        }
         if (!extractPrinters(raw, opts, logger)) {
             throw EarlyReturnWithCode(1);
         }
@@ -696,12 +831,14 @@ void readOptions(Options &opts,
         }
 
         opts.runLSP = raw["lsp"].as<bool>();
-        if (opts.runLSP && !opts.cacheDir.empty()) {
-            logger->error("lsp mode does not yet support caching.");
+        opts.lspSocketPath = raw["lsp-socket"].as<string>();
+        if (!opts.lspSocketPath.empty() && !opts.runLSP) {
+            logger->error("--lsp-socket must be used with --lsp");
             throw EarlyReturnWithCode(1);
         }
         opts.disableWatchman = raw["disable-watchman"].as<bool>();
         opts.watchmanPath = raw["watchman-path"].as<string>();
+        opts.watchmanSettleMs = raw["watchman-settle-ms"].as<int>();
         // Certain features only need certain passes
         if (opts.print.isAutogen() && (opts.stopAfterPhase != Phase::NAMER)) {
             logger->error(
@@ -732,11 +869,20 @@ void readOptions(Options &opts,
         }
 
         opts.noErrorCount = raw["no-error-count"].as<bool>();
+        opts.maxErrors = raw["max-errors"].as<int>();
+        opts.maxMemoryMiB = raw["max-memory-mib"].as<int>();
+        if (opts.maxMemoryMiB < 0) {
+            logger->error("--max-memory-mib must not be negative");
+            throw EarlyReturnWithCode(1);
+        }
         opts.noStdlib = raw["no-stdlib"].as<bool>();
         opts.stdoutHUPHack = raw["stdout-hup-hack"].as<bool>();
 
         opts.threads = opts.runLSP ? raw["max-threads"].as<int>()
                                    : min(raw["max-threads"].as<int>(), int(opts.inputFileNames.size() / 2));
+        opts.numaWorkers = raw["numa-workers"].as<bool>();
+        opts.parallelMethodThreshold = raw["parallel-method-threshold"].as<int>();
+        opts.slowReportTop = raw["slow-report-top"].as<int>();
 
         if (raw["h"].as<bool>()) {
             logger->info("{}", options.help({""}));
@@ -772,10 +918,28 @@ void readOptions(Options &opts,
         }
         opts.skipDSLPasses = raw["skip-dsl-passes"].as<bool>();
         opts.storeState = raw["store-state"].as<string>();
+        opts.storeStateUncompressed = raw["store-state-uncompressed"].as<bool>();
+        opts.loadState = raw["load-state"].as<string>();
+        {
+            auto shard = raw["typecheck-shard"].as<string>();
+            vector<string> parts = absl::StrSplit(shard, '/');
+            if (parts.size() != 2 || !absl::SimpleAtoi(parts[0], &opts.typecheckShard) ||
+                !absl::SimpleAtoi(parts[1], &opts.typecheckShardCount) ||
+                opts.typecheckShard >= opts.typecheckShardCount) {
+                logger->error("--typecheck-shard must be i/n with 0 <= i < n, got: {}", shard);
+                throw EarlyReturnWithCode(1);
+            }
+        }
+        opts.sanityCheckSample = raw["sanity-check-sample"].as<int>();
+        if (opts.sanityCheckSample < 1) {
+            logger->error("--sanity-check-sample must be at least 1, got: {}", opts.sanityCheckSample);
+            throw EarlyReturnWithCode(1);
+        }
         opts.suggestTyped = raw["suggest-typed"].as<bool>();
         opts.waitForDebugger = raw["wait-for-dbg"].as<bool>();
         opts.stressIncrementalResolver = raw["stress-incremental-resolver"].as<bool>();
         opts.suggestRuntimeProfiledType = raw["suggest-runtime-profiled"].as<bool>();
+        opts.suggestSigsOnly = raw["suggest-sigs-only"].as<bool>();
         opts.enableCounters = raw["counters"].as<bool>();
         opts.silenceDevMessage = raw["silence-dev-message"].as<bool>();
         opts.censorForSnapshotTests = raw["censor-for-snapshot-tests"].as<bool>();
@@ -789,6 +953,11 @@ void readOptions(Options &opts,
         opts.metricsPrefix = raw["metrics-prefix"].as<string>();
         opts.debugLogFile = raw["debug-log-file"].as<string>();
         opts.webTraceFile = raw["web-trace-file"].as<string>();
+        opts.webTraceSampleEvery = raw["web-trace-sample-every"].as<int>();
+        if (opts.webTraceSampleEvery < 1) {
+            logger->error("--web-trace-sample-every must be at least 1");
+            throw EarlyReturnWithCode(1);
+        }
         opts.reserveMemKiB = raw["reserve-mem-kb"].as<u8>();
         if (raw.count("autogen-version") > 0) {
             if (!opts.print.AutogenMsgPack.enabled) {
@@ -800,6 +969,14 @@ void readOptions(Options &opts,
         opts.stripeMode = raw["stripe-mode"].as<bool>();
         extractAutoloaderConfig(raw, opts, logger);
         opts.errorUrlBase = raw["error-url-base"].as<string>();
+        auto errorFormat = raw["error-format"].as<string>();
+        if (errorFormat == "jsonl") {
+            opts.jsonlErrors = true;
+            opts.noErrorCount = true;
+        } else if (errorFormat != "text") {
+            logger->error("Unknown --error-format option: {}\nValid values: text, jsonl", errorFormat);
+            throw EarlyReturnWithCode(1);
+        }
         if (raw.count("error-white-list") > 0) {
             auto rawList = raw["error-white-list"].as<vector<int>>();
             opts.errorCodeWhiteList = set<int>(rawList.begin(), rawList.end());
@@ -822,7 +999,7 @@ void readOptions(Options &opts,
             throw EarlyReturnWithCode(1);
         }
 
-        if ((raw["color"].as<string>() == "never") || opts.runLSP) {
+        if ((raw["color"].as<string>() == "never") || opts.runLSP || opts.jsonlErrors) {
             core::ErrorColors::disableColors();
         } else if (raw["color"].as<string>() == "auto") {
             if (rang::rang_implementation::isTerminal(cerr.rdbuf())) {
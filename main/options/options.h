@@ -73,6 +73,9 @@ struct Printers {
     // cfg-proto format outputs a binary MultiCFG for export to other tools.
     // See CFG.proto for details
     PrinterConfig CFGProto;
+    // call-graph format outputs every call inference resolves to a method, as fixed-size binary records.
+    // See printCallEdges in pipeline.cc for details
+    PrinterConfig CallGraph;
     PrinterConfig TypedSource;
     PrinterConfig Autogen;
     PrinterConfig AutogenMsgPack;
@@ -80,6 +83,8 @@ struct Printers {
     PrinterConfig AutogenAutoloader;
     PrinterConfig AutogenSubclasses;
     PrinterConfig PluginGeneratedCode;
+    PrinterConfig SlowReport;
+    PrinterConfig MemoryReport;
     // Ensure everything here is in PrinterConfig::printers().
 
     std::vector<std::reference_wrapper<PrinterConfig>> printers();
@@ -133,28 +138,70 @@ struct Options {
     bool runLSP = false;
     bool disableWatchman = false;
     std::string watchmanPath = "watchman";
+    // If set, LSP waits until Watchman has reported no changes for this many milliseconds before typechecking the ones
+    // it has, so that a burst of changes is typechecked once.
+    int watchmanSettleMs = 0;
+    // If set, LSP sessions are served one after another on this Unix domain socket instead of stdin and stdout.
+    std::string lspSocketPath;
     bool stressIncrementalResolver = false;
     bool noErrorCount = false;
+    // If set, files that haven't been typechecked by the time this many errors have been reported are skipped.
+    int maxErrors = 0;
+    // If set, and the process has more than this many MiB resident once resolving is done, the resolved trees are kept
+    // in a temporary file during typechecking, and each one is only loaded by the thread that typechecks it.
+    int maxMemoryMiB = 0;
     bool autocorrect = false;
     bool waitForDebugger = false;
     bool skipDSLPasses = false;
     bool suggestRuntimeProfiledType = false;
+    // Typecheck only the methods that would be given a suggested sig, skipping those that already have one.
+    bool suggestSigsOnly = false;
     bool censorForSnapshotTests = false;
     int threads = 0;
+    // Bind the worker threads to the cores of NUMA nodes, and give each node its own allocator arena.
+    bool numaWorkers = false;
+    // Files with at least this many methods get their methods typechecked as separate tasks. 0 disables splitting.
+    int parallelMethodThreshold = 0;
+    // How many of the slowest files or methods --print=slow-report lists per phase (0 for all of them).
+    int slowReportTop = 50;
     int logLevel = 0; // number of time -v was passed
     int autogenVersion = 0;
     bool stripeMode = false;
     std::string typedSource = "";
     std::string cacheDir = "";
+    // Remove the entries of --cache-dir that none of this many of the last runs used (0 to keep them all).
+    int cacheMaxUnusedRuns = 0;
+    // Compact the database in --cache-dir and exit.
+    bool compactCache = false;
+    // A checkout of the input files from before a change. If given, print the input files whose typecheck the change
+    // could affect and exit, see `pipeline::affectedFiles`.
+    std::string affectedFilesSince = "";
+    // Only typecheck the input files that changes to these paths since the last run with --changed-files may affect,
+    // see `pipeline::affectedFilesSinceLastRun`.
+    std::vector<std::string> changedFiles;
+    // A directory other machines see too, to share caches through, see `KeyValueStore::seed`.
+    std::string sharedCacheDir = "";
+    bool sharedCacheReadOnly = false;
     std::vector<std::string> configatronDirs;
     std::vector<std::string> configatronFiles;
     UnorderedMap<std::string, core::StrictLevel> strictnessOverrides;
     UnorderedMap<std::string, std::string> dslPluginTriggers;
     std::vector<std::string> dslRubyExtraArgs;
     std::string storeState = "";
+    // Store the state uncompressed, so that a payload built from it is read in place, see `Serializer::store`.
+    bool storeStateUncompressed = false;
+    // A state stored with --store-state, to start from instead of the payload built into the executable.
+    std::string loadState = "";
+    // See `core::GlobalState::typecheckShard`.
+    u4 typecheckShard = 0;
+    u4 typecheckShardCount = 1;
+    // See `core::GlobalState::sanityCheckSample`.
+    int sanityCheckSample = 1;
     bool enableCounters = false;
     std::vector<std::string> someCounters;
     std::string errorUrlBase = "https://srb.help/";
+    // Print errors as one JSON object per line, see `core::Error::toJSON`.
+    bool jsonlErrors = false;
     std::set<int> errorCodeWhiteList;
     std::set<int> errorCodeBlackList;
     /** Prefix to remove from all printed paths. */
@@ -198,10 +245,24 @@ struct Options {
     bool lspDocumentSymbolEnabled = false;
     bool lspSignatureHelpEnabled = false;
     bool lspHoverEnabled = false;
+    // If set, LSP holds diagnostics back for up to this many milliseconds while more requests are queued, so that it
+    // only sends the latest diagnostics for each file.
+    int lspDiagnosticsCoalesceMs = 0;
+    // If set, LSP serializes the indexed trees of files that aren't open to a temporary file, and reads them back when
+    // it needs them.
+    bool lspEvictClosedTrees = false;
+    // If set, the fast path only typechecks the edited files and the open files that depend on them before publishing
+    // diagnostics, and leaves the other dependents for when LSP is idle.
+    bool lspDeferClosedDependents = false;
+    // If set, LSP starts evicting the trees of files that aren't open, as with `lspEvictClosedTrees`, once the process
+    // has more than this many MiB resident after a slow path.
+    int lspMemoryCeilingMiB = 0;
 
     std::string inlineInput; // passed via -e
     std::string debugLogFile;
     std::string webTraceFile;
+    // Only one in this many events about individual files is written to webTraceFile.
+    int webTraceSampleEvery = 1;
 
     std::shared_ptr<FileSystem> fs = std::make_shared<OSFileSystem>();
 
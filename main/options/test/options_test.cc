@@ -37,7 +37,9 @@ TEST(OptionsTest, DefaultConstructorMatchesReadOptions) {
     EXPECT_EQ(empty.waitForDebugger, opts.waitForDebugger);
     EXPECT_EQ(empty.skipDSLPasses, opts.skipDSLPasses);
     EXPECT_EQ(empty.suggestRuntimeProfiledType, opts.suggestRuntimeProfiledType);
+    EXPECT_EQ(empty.suggestSigsOnly, opts.suggestSigsOnly);
     EXPECT_EQ(empty.threads, opts.threads);
+    EXPECT_EQ(empty.slowReportTop, opts.slowReportTop);
     EXPECT_EQ(empty.logLevel, opts.logLevel);
     EXPECT_EQ(empty.autogenVersion, opts.autogenVersion);
     EXPECT_EQ(empty.typedSource, opts.typedSource);
@@ -76,4 +78,5 @@ TEST(OptionsTest, DefaultConstructorMatchesReadOptions) {
     EXPECT_EQ(empty.inlineInput, opts.inlineInput);
     EXPECT_EQ(empty.debugLogFile, opts.debugLogFile);
     EXPECT_EQ(empty.webTraceFile, opts.webTraceFile);
+    EXPECT_EQ(empty.webTraceSampleEvery, opts.webTraceSampleEvery);
 }
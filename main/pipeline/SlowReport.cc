@@ -0,0 +1,125 @@
+#include "main/pipeline/SlowReport.h"
+#include "absl/synchronization/mutex.h"
+#include "common/JSON.h"
+#include <atomic>
+
+#ifdef __linux__
+// Provided by jemalloc, when it is linked in.
+extern "C" int mallctl(const char *name, void *oldp, size_t *oldlenp, void *newp, size_t newlen)
+    __attribute__((weak));
+#endif
+
+using namespace std;
+
+namespace sorbet::realmain::pipeline {
+namespace {
+struct Totals {
+    u8 nanos = 0;
+    u8 allocatedBytes = 0;
+    int count = 0;
+};
+
+atomic<bool> isEnabled{false};
+absl::Mutex mutex;
+// By phase, then by file or method.
+UnorderedMap<string, UnorderedMap<string, Totals>> totals GUARDED_BY(mutex);
+// Whether `allocatedBytes` means anything.
+atomic<bool> countsAllocations{false};
+
+// The number of bytes the current thread has allocated so far, which the allocator keeps up to date. Null if it doesn't
+// count them.
+const u8 *threadAllocatedCounter() {
+#ifdef __linux__
+    thread_local const u8 *counter = []() -> const u8 * {
+        u8 *counter = nullptr;
+        size_t size = sizeof(counter);
+        if (mallctl == nullptr || mallctl("thread.allocatedp", &counter, &size, nullptr, 0) != 0) {
+            return nullptr;
+        }
+        return counter;
+    }();
+    return counter;
+#else
+    return nullptr;
+#endif
+}
+} // namespace
+
+SlowReport::Scope::Scope(ConstExprStr phase, string subject)
+    : phase(phase), subject(move(subject)), start(chrono::steady_clock::now()) {
+    allocatedCounter = threadAllocatedCounter();
+    if (allocatedCounter != nullptr) {
+        startAllocated = *allocatedCounter;
+    }
+}
+
+SlowReport::Scope::Scope(ConstExprStr phase, const core::GlobalState &gs, core::FileRef file)
+    : Scope(phase, isEnabled.load() ? string(file.data(gs).path()) : string()) {}
+
+SlowReport::Scope::Scope(ConstExprStr phase, const core::GlobalState &gs, core::SymbolRef method)
+    : Scope(phase, isEnabled.load() ? method.data(gs)->show(gs) : string()) {}
+
+SlowReport::Scope::~Scope() {
+    if (!isEnabled.load()) {
+        return;
+    }
+    auto nanos = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    // Scopes don't move between threads, so the counter is the same one the constructor read.
+    u8 allocated = allocatedCounter != nullptr ? *allocatedCounter - startAllocated : 0;
+    absl::MutexLock lck(&mutex);
+    auto &entry = totals[phase.str][subject];
+    entry.nanos += nanos;
+    entry.allocatedBytes += allocated;
+    entry.count++;
+}
+
+void SlowReport::enable() {
+    countsAllocations.store(threadAllocatedCounter() != nullptr);
+    isEnabled.store(true);
+}
+
+string SlowReport::toJSON(int topN) {
+    absl::MutexLock lck(&mutex);
+    vector<string> phases;
+    for (auto &[phase, _] : totals) {
+        phases.emplace_back(phase);
+    }
+    fast_sort(phases);
+
+    const bool withAllocations = countsAllocations.load();
+    auto entryJSON = [&](string_view name, const Totals &entry) -> string {
+        string allocated = withAllocations ? fmt::format(",\"allocated_bytes\":{}", entry.allocatedBytes) : "";
+        return fmt::format("{{\"name\":\"{}\",\"ns\":{},\"count\":{}{}}}", JSON::escape(string(name)), entry.nanos,
+                           entry.count, allocated);
+    };
+
+    fmt::memory_buffer buf;
+    fmt::format_to(buf, "{{\"phases\":[");
+    for (auto &phase : phases) {
+        auto &entries = totals[phase];
+        vector<pair<string_view, Totals>> sorted(entries.begin(), entries.end());
+        fast_sort(sorted, [](const auto &left, const auto &right) -> bool {
+            if (left.second.nanos != right.second.nanos) {
+                return left.second.nanos > right.second.nanos;
+            }
+            return left.first < right.first;
+        });
+        Totals phaseTotals;
+        for (auto &[_, entry] : sorted) {
+            phaseTotals.nanos += entry.nanos;
+            phaseTotals.allocatedBytes += entry.allocatedBytes;
+            phaseTotals.count += entry.count;
+        }
+        if (topN > 0 && sorted.size() > topN) {
+            sorted.resize(topN);
+        }
+        auto slowest =
+            fmt::map_join(sorted, ",", [&](const auto &e) -> string { return entryJSON(e.first, e.second); });
+        fmt::format_to(buf, "{}{{\"phase\":\"{}\",\"total\":{},\"slowest\":[{}]}}",
+                       &phase == &phases.front() ? "" : ",", phase, entryJSON("<all>", phaseTotals), slowest);
+    }
+    fmt::format_to(buf, "]}}");
+    return to_string(buf);
+}
+
+} // namespace sorbet::realmain::pipeline
@@ -0,0 +1,44 @@
+#ifndef SORBET_PIPELINE_SLOWREPORT_H
+#define SORBET_PIPELINE_SLOWREPORT_H
+
+#include "core/core.h"
+#include <chrono>
+
+namespace sorbet::realmain::pipeline {
+
+/**
+ * Collects how long each file spends in each phase and each method spends in inference, for `--print=slow-report`.
+ * When the allocator keeps count (jemalloc does, in release builds), also how many bytes each of them allocated.
+ *
+ * Nothing is recorded until `enable` is called. Scopes that end after that may be on any thread.
+ */
+class SlowReport final {
+public:
+    // Records how long it lived under `phase`, for a file or a method.
+    class Scope final {
+        const ConstExprStr phase;
+        std::string subject;
+        const std::chrono::time_point<std::chrono::steady_clock> start;
+        const u8 *allocatedCounter = nullptr;
+        u8 startAllocated = 0;
+
+        Scope(ConstExprStr phase, std::string subject);
+
+    public:
+        Scope(ConstExprStr phase, const core::GlobalState &gs, core::FileRef file);
+        Scope(ConstExprStr phase, const core::GlobalState &gs, core::SymbolRef method);
+        ~Scope();
+        Scope(const Scope &) = delete;
+    };
+
+    SlowReport() = delete;
+
+    static void enable();
+
+    // Totals per phase, along with the `topN` files or methods that took longest in each (all of them if 0), as JSON.
+    static std::string toJSON(int topN);
+};
+
+} // namespace sorbet::realmain::pipeline
+
+#endif // SORBET_PIPELINE_SLOWREPORT_H
@@ -10,18 +10,23 @@
 #include <sstream>
 #endif
 #include "ProgressIndicator.h"
+#include "SlowReport.h"
 #include "absl/strings/escaping.h" // BytesToHexString
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "ast/Helpers.h"
 #include "ast/desugar/Desugar.h"
-#include "ast/substitute/substitute.h"
+#include "ast/treemap/parallel.h"
 #include "ast/treemap/treemap.h"
 #include "cfg/CFG.h"
 #include "cfg/builder/builder.h"
 #include "common/FileOps.h"
 #include "common/Timer.h"
+#include "common/UTF8.h"
 #include "common/concurrency/ConcurrentQueue.h"
 #include "common/crypto_hashing/crypto_hashing.h"
-#include "core/GlobalSubstitution.h"
+#include "common/os/os.h"
 #include "core/Unfreeze.h"
 #include "core/errors/parser.h"
 #include "core/serialize/serialize.h"
@@ -35,28 +40,70 @@
 #include "parser/parser.h"
 #include "pipeline.h"
 #include "resolver/resolver.h"
+#include "spdlog/sinks/null_sink.h"
+#include <charconv>
+#include <numeric>
 
 using namespace std;
 
 namespace sorbet::realmain::pipeline {
 
+// Prints the calls `caller` made, as five little-endian u4s each: the ids of `caller` and of the method the call
+// dispatched to (see --print=symbol-table-full-json), the id of the file the call is in (its position in
+// --print=file-table-json, counting from 1), and the offsets the call begins and ends at in that file.
+void printCallEdges(const options::PrinterConfig &print, core::SymbolRef caller, const vector<infer::CallEdge> &edges) {
+    string buf;
+    buf.reserve(edges.size() * 5 * sizeof(u4));
+    auto append = [&buf](u4 value) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            buf.push_back(static_cast<char>((value >> shift) & 0xff));
+        }
+    };
+    for (auto &edge : edges) {
+        append(caller._id);
+        append(edge.callee._id);
+        append(edge.loc.file().id());
+        append(edge.loc.beginPos());
+        append(edge.loc.endPos());
+    }
+    print.print(buf);
+}
+
 class CFGCollectorAndTyper {
     const options::Options &opts;
+    // If set, methods are only collected here, in tree order, for the caller to typecheck with `typecheckCollected`.
+    vector<ast::MethodDef *> *methodsToTypecheck;
 
 public:
-    CFGCollectorAndTyper(const options::Options &opts) : opts(opts){};
+    CFGCollectorAndTyper(const options::Options &opts, vector<ast::MethodDef *> *methodsToTypecheck = nullptr)
+        : opts(opts), methodsToTypecheck(methodsToTypecheck){};
 
     unique_ptr<ast::MethodDef> preTransformMethodDef(core::Context ctx, unique_ptr<ast::MethodDef> m) {
         if (m->loc.file().data(ctx).strictLevel < core::StrictLevel::True || m->symbol.data(ctx)->isOverloaded()) {
             return m;
         }
+        if (opts.suggestSigsOnly && m->symbol.data(ctx)->resultType != nullptr &&
+            !m->symbol.data(ctx)->hasGeneratedSig()) {
+            // Inference only suggests a sig for methods without one, see `Inference::run`.
+            return m;
+        }
+        if (methodsToTypecheck != nullptr) {
+            methodsToTypecheck->emplace_back(m.get());
+            return m;
+        }
         auto &print = opts.print;
+        SlowReport::Scope slowReport("infer", ctx.state, m->symbol);
         auto cfg = cfg::CFGBuilder::buildFor(ctx.withOwner(m->symbol), *m);
 
         if (opts.stopAfterPhase == options::Phase::CFG) {
             return m;
         }
-        cfg = infer::Inference::run(ctx.withOwner(cfg->symbol), move(cfg));
+        vector<infer::CallEdge> callEdges;
+        cfg = infer::Inference::run(ctx.withOwner(cfg->symbol), move(cfg),
+                                    print.CallGraph.enabled ? &callEdges : nullptr);
+        if (print.CallGraph.enabled) {
+            printCallEdges(print.CallGraph, m->symbol, callEdges);
+        }
         if (cfg) {
             for (auto &extension : ctx.state.semanticExtensions) {
                 extension->typecheck(ctx.state, *cfg, m);
@@ -80,22 +127,393 @@ public:
 #endif
         return m;
     }
+
+    // Only valid when there are no semantic extensions and CFGs are not being printed, as neither of those are
+    // safe to do out of tree order.
+    void typecheckCollected(core::Context ctx, ast::MethodDef &m) const {
+        SlowReport::Scope slowReport("infer", ctx.state, m.symbol);
+        auto cfg = cfg::CFGBuilder::buildFor(ctx.withOwner(m.symbol), m);
+        if (opts.stopAfterPhase == options::Phase::CFG) {
+            return;
+        }
+        auto &print = opts.print;
+        vector<infer::CallEdge> callEdges;
+        infer::Inference::run(ctx.withOwner(cfg->symbol), move(cfg), print.CallGraph.enabled ? &callEdges : nullptr);
+        if (print.CallGraph.enabled) {
+            printCallEdges(print.CallGraph, m.symbol, callEdges);
+        }
+    }
+};
+
+struct MethodResult {
+    vector<core::ErrorQueueMessage> errors;
+    CounterState counters;
+    exception_ptr exception;
+};
+
+// Typechecks `methods`, as separate tasks on `workers` if given, capturing the errors each one reports.
+vector<MethodResult> typecheckMethodsCapturingErrors(core::Context ctx, const CFGCollectorAndTyper &collector,
+                                                     const vector<ast::MethodDef *> &methods, WorkerPool *workers) {
+    vector<MethodResult> results(methods.size());
+    auto typecheckMethod = [ctx, &collector, &methods, &results](int i) {
+        auto &result = results[i];
+        core::ErrorQueue::CaptureErrors capture(*ctx.state.errorQueue, result.errors);
+        try {
+            collector.typecheckCollected(ctx, *methods[i]);
+        } catch (SorbetException &) {
+            result.exception = current_exception();
+        }
+    };
+    if (workers == nullptr) {
+        for (int i = 0; i < methods.size(); i++) {
+            typecheckMethod(i);
+        }
+        return results;
+    }
+    {
+        WorkerPool::TaskGroup group;
+        for (int i = 0; i < methods.size(); i++) {
+            workers->submit(group, [&typecheckMethod, &results, i]() {
+                typecheckMethod(i);
+                results[i].counters = getAndClearThreadCounters();
+            });
+        }
+        workers->wait(group);
+    }
+    prodCounterAdd("typecheck.parallel_methods", methods.size());
+    for (auto &result : results) {
+        counterConsume(move(result.counters));
+    }
+    return results;
+}
+
+// Typechecks `methods` as separate tasks on `workers`, reporting their errors in the same order the serial tree walk
+// would have.
+void typecheckMethodsInParallel(core::Context ctx, const CFGCollectorAndTyper &collector,
+                                const vector<ast::MethodDef *> &methods, WorkerPool &workers) {
+    auto results = typecheckMethodsCapturingErrors(ctx, collector, methods, &workers);
+    for (auto &result : results) {
+        ctx.state.errorQueue->pushCapturedErrors(move(result.errors));
+        if (result.exception) {
+            // The serial walk would have stopped at this method.
+            rethrow_exception(result.exception);
+        }
+    }
+}
+
+// Returns a copy of `error` in which every position in `file` from `from` on moved by `delta`.
+unique_ptr<core::Error> copyErrorMovingLocs(const core::Error &error, core::FileRef file, u4 from, int delta) {
+    auto moved = [file, from, delta](core::Loc loc) -> core::Loc {
+        if (!loc.exists() || loc.file() != file || loc.beginPos() < from) {
+            return loc;
+        }
+        return core::Loc(file, loc.beginPos() + delta, loc.endPos() + delta);
+    };
+    vector<core::ErrorSection> sections;
+    for (auto &section : error.sections) {
+        vector<core::ErrorLine> messages;
+        for (auto &line : section.messages) {
+            messages.emplace_back(moved(line.loc), line.formattedMessage);
+        }
+        sections.emplace_back(section.header, messages);
+    }
+    vector<core::AutocorrectSuggestion> autocorrects;
+    for (auto &autocorrect : error.autocorrects) {
+        vector<core::AutocorrectSuggestion::Edit> edits;
+        for (auto &edit : autocorrect.edits) {
+            edits.emplace_back(core::AutocorrectSuggestion::Edit{moved(edit.loc), edit.replacement});
+        }
+        autocorrects.emplace_back(autocorrect.title, move(edits));
+    }
+    return make_unique<core::Error>(moved(error.loc), error.what, error.header, move(sections), move(autocorrects),
+                                    error.isSilenced);
+}
+
+// Reports `error`, which was reported before, again.
+void reportAgain(core::Context ctx, const core::Error &error) {
+    if (auto e = ctx.state.beginError(error.loc, error.what)) {
+        e.setHeader("{}", error.header);
+        for (auto &section : error.sections) {
+            e.addErrorSection(core::ErrorSection(section));
+        }
+        for (auto &autocorrect : error.autocorrects) {
+            e.addAutocorrect(core::AutocorrectSuggestion(autocorrect));
+        }
+    }
+}
+
+// Whether `pred` holds for every loc `error` points to.
+template <typename Pred> bool allLocs(const core::Error &error, Pred pred) {
+    if (!pred(error.loc)) {
+        return false;
+    }
+    for (auto &section : error.sections) {
+        for (auto &line : section.messages) {
+            if (!pred(line.loc)) {
+                return false;
+            }
+        }
+    }
+    for (auto &autocorrect : error.autocorrects) {
+        for (auto &edit : autocorrect.edits) {
+            if (!pred(edit.loc)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Returns what typechecking the method that spans `[begin, end)` of the edited file reported before the edit, if it
+// was recorded and the edit can't have changed it: the method and everything its errors point to in the file must be
+// outside of the edit, with at least a character in between so that no token that ends or starts there changed.
+const TypecheckedMethods::Method *findUnchangedMethod(const MethodReuse &reuse, core::FileRef file, u4 begin,
+                                                      u4 end) {
+    if (reuse.before == nullptr) {
+        return nullptr;
+    }
+    if (end < reuse.editBegin) {
+        // Before the edit, so it hasn't moved.
+    } else if (begin > reuse.editNewEnd) {
+        const int delta = reuse.editNewEnd - reuse.editOldEnd;
+        begin -= delta;
+        end -= delta;
+    } else {
+        return nullptr;
+    }
+    auto &methods = reuse.before->methods;
+    auto first = lower_bound(methods.begin(), methods.end(), make_pair(begin, end),
+                             [](const auto &method, pair<u4, u4> range) -> bool {
+                                 return make_pair(method.begin, method.end) < range;
+                             });
+    auto sameRange = [begin, end](const auto &method) -> bool { return method.begin == begin && method.end == end; };
+    if (first == methods.end() || !sameRange(*first) || (first + 1 != methods.end() && sameRange(*(first + 1)))) {
+        // Never typechecked, or the range doesn't tell which method it was.
+        return nullptr;
+    }
+    auto outsideOfEdit = [&reuse, file](core::Loc loc) -> bool {
+        return !loc.exists() || loc.file() != file || loc.endPos() < reuse.editBegin ||
+               loc.beginPos() > reuse.editOldEnd;
+    };
+    for (auto &error : first->errors) {
+        if (!allLocs(*error, outsideOfEdit)) {
+            return nullptr;
+        }
+    }
+    return &*first;
+}
+
+bool byRange(const TypecheckedMethods::Method &lhs, const TypecheckedMethods::Method &rhs) {
+    return make_pair(lhs.begin, lhs.end) < make_pair(rhs.begin, rhs.end);
+}
+
+// Typechecks the `methods` of a file that `reuse.before` has no usable record of, replays the errors of the others,
+// and records all of them in `reuse.after`. Errors are reported in the same order the serial tree walk would have.
+void typecheckMethodsReusing(core::Context ctx, const CFGCollectorAndTyper &collector,
+                             const vector<ast::MethodDef *> &methods, WorkerPool *workers, int parallelMethodThreshold,
+                             MethodReuse &reuse) {
+    UnorderedMap<pair<u4, u4>, int> rangeCounts;
+    for (auto *method : methods) {
+        rangeCounts[{method->loc.beginPos(), method->loc.endPos()}]++;
+    }
+    vector<const TypecheckedMethods::Method *> unchanged(methods.size());
+    vector<ast::MethodDef *> changed;
+    for (int i = 0; i < methods.size(); i++) {
+        auto loc = methods[i]->loc;
+        if (rangeCounts[{loc.beginPos(), loc.endPos()}] == 1) {
+            unchanged[i] = findUnchangedMethod(reuse, loc.file(), loc.beginPos(), loc.endPos());
+        }
+        if (unchanged[i] == nullptr) {
+            changed.emplace_back(methods[i]);
+        }
+    }
+    prodCounterAdd("typecheck.reused_methods", methods.size() - changed.size());
+    auto results = typecheckMethodsCapturingErrors(
+        ctx, collector, changed,
+        parallelMethodThreshold > 0 && changed.size() >= parallelMethodThreshold ? workers : nullptr);
+
+    auto &after = reuse.after.methods;
+    after.clear();
+    const int delta = reuse.editNewEnd - reuse.editOldEnd;
+    int nextChanged = 0;
+    for (int i = 0; i < methods.size(); i++) {
+        auto &recorded = after.emplace_back();
+        recorded.begin = methods[i]->loc.beginPos();
+        recorded.end = methods[i]->loc.endPos();
+        if (unchanged[i] != nullptr) {
+            for (auto &error : unchanged[i]->errors) {
+                recorded.errors.emplace_back(
+                    copyErrorMovingLocs(*error, methods[i]->loc.file(), reuse.editOldEnd, delta));
+                reportAgain(ctx, *recorded.errors.back());
+            }
+            continue;
+        }
+        auto &result = results[nextChanged++];
+        for (auto &msg : result.errors) {
+            recorded.errors.emplace_back(copyErrorMovingLocs(*msg.error, core::FileRef(), 0, 0));
+        }
+        ctx.state.errorQueue->pushCapturedErrors(move(result.errors));
+        if (result.exception) {
+            // The serial walk would have stopped at this method. What it reported may be incomplete.
+            after.pop_back();
+            fast_sort(after, byRange);
+            rethrow_exception(result.exception);
+        }
+    }
+    fast_sort(after, byRange);
+}
+
+core::UsageHash getAllNames(const core::GlobalState &gs, unique_ptr<ast::Expression> &tree);
+
+// The part of `currentHashes` that something using the names in `usages` depends on. Constants are covered by the
+// hierarchy hash; methods are tracked by name.
+core::GlobalStateHash usedHashesFor(const core::UsageHash &usages, const core::GlobalStateHash &currentHashes) {
+    core::GlobalStateHash usedHashes;
+    usedHashes.hierarchyHash = currentHashes.hierarchyHash;
+    for (auto *names : {&usages.sends, &usages.constants}) {
+        for (auto name : *names) {
+            auto fnd = currentHashes.methodHashes.find(name);
+            usedHashes.methodHashes[name] = fnd == currentHashes.methodHashes.end() ? 0 : fnd->second;
+        }
+    }
+    return usedHashes;
+}
+
+// The errors in `captured` that are worth caching, or nullopt if any of them is critical. Silenced errors only matter
+// for the `minErrorLevel` of the file they're in (which is what --suggest-typed reports, with every other error
+// silenced), so one of them per file and level is enough to replay.
+optional<vector<const core::Error *>> errorsToCache(const vector<core::ErrorQueueMessage> &captured) {
+    vector<const core::Error *> errors;
+    UnorderedSet<pair<core::FileRef, core::StrictLevel>> silencedLevels;
+    for (auto &msg : captured) {
+        if (msg.error->isCritical()) {
+            return nullopt;
+        }
+        if (msg.error->isSilenced && !silencedLevels.emplace(msg.error->loc.file(), msg.error->what.minLevel).second) {
+            continue;
+        }
+        errors.emplace_back(msg.error.get());
+    }
+    return errors;
+}
+
+// Lets typechecking a file whose contents changed replay the errors of the methods in it that a previous run already
+// typechecked, as long as neither they nor anything they depend on changed since.
+struct MethodCache {
+    KeyValueStore &kvstore;
+    const core::GlobalStateHash &currentHashes;
+    // What, besides the method itself, decides which errors typechecking it reports, see `typecheckOptionsKey`.
+    string optionsKey;
+    // (key, value) pairs for the main thread to write to the KeyValueStore.
+    vector<pair<string, vector<u1>>> &cacheEntries;
 };
 
-string fileKey(core::GlobalState &gs, core::FileRef file) {
-    auto path = file.data(gs).path();
+// The key the errors of `method` are cached under. Its tree, in which every constant is resolved, decides what
+// inference does with it, and its source text what the locs of the errors it reports are.
+string methodCacheKey(core::Context ctx, const ast::MethodDef &method, string_view optionsKey) {
+    auto digest = crypto_hashing::hash16(absl::StrCat(method.loc.source(ctx), "//", method.toString(ctx)));
+    return fmt::format("typecheck_method//{}//{}//{}", method.symbol.data(ctx)->showFullName(ctx),
+                       absl::BytesToHexString(string_view((const char *)digest.data(), digest.size())), optionsKey);
+}
+
+// The part of `currentHashes` that typechecking `method` depends on: the hierarchy, the method itself, and every
+// method it calls.
+core::GlobalStateHash methodUsedHashes(core::Context ctx, ast::MethodDef &method,
+                                       const core::GlobalStateHash &currentHashes) {
+    auto usages = getAllNames(ctx, method.rhs);
+    for (auto &arg : method.args) {
+        auto argUsages = getAllNames(ctx, arg);
+        usages.sends.insert(usages.sends.end(), argUsages.sends.begin(), argUsages.sends.end());
+        usages.constants.insert(usages.constants.end(), argUsages.constants.begin(), argUsages.constants.end());
+    }
+    usages.sends.emplace_back(ctx, method.name.data(ctx));
+    return usedHashesFor(usages, currentHashes);
+}
+
+// Typechecks the `methods` of a file that `cache` has no record of, replays the errors of the others, and records
+// those it can in `cache`. Errors are reported in the same order the serial tree walk would have.
+void typecheckMethodsCached(core::Context ctx, const CFGCollectorAndTyper &collector,
+                            const vector<ast::MethodDef *> &methods, WorkerPool *workers, int parallelMethodThreshold,
+                            MethodCache &cache) {
+    vector<string> keys;
+    keys.reserve(methods.size());
+    vector<optional<vector<unique_ptr<core::Error>>>> cached(methods.size());
+    vector<ast::MethodDef *> changed;
+    vector<core::GlobalStateHash> changedHashes;
+    for (int i = 0; i < methods.size(); i++) {
+        auto &method = *methods[i];
+        keys.emplace_back(methodCacheKey(ctx, method, cache.optionsKey));
+        if (auto maybeCached = cache.kvstore.read(keys.back())) {
+            cached[i] = core::serialize::Serializer::loadErrors(ctx, cache.currentHashes, maybeCached,
+                                                                method.loc.file(), method.loc.beginPos());
+        }
+        if (!cached[i]) {
+            changed.emplace_back(&method);
+            // Before typechecking, which is free to change the tree.
+            changedHashes.emplace_back(methodUsedHashes(ctx, method, cache.currentHashes));
+        }
+    }
+    prodCounterAdd("types.input.methods.typecheck_cache.hit", methods.size() - changed.size());
+    prodCounterAdd("types.input.methods.typecheck_cache.miss", changed.size());
+    auto results = typecheckMethodsCapturingErrors(
+        ctx, collector, changed,
+        parallelMethodThreshold > 0 && changed.size() >= parallelMethodThreshold ? workers : nullptr);
+
+    int nextChanged = 0;
+    for (int i = 0; i < methods.size(); i++) {
+        if (cached[i]) {
+            for (auto &error : *cached[i]) {
+                reportAgain(ctx, *error);
+            }
+            continue;
+        }
+        auto &method = *changed[nextChanged];
+        auto &usedHashes = changedHashes[nextChanged];
+        auto &result = results[nextChanged++];
+        // Errors that point elsewhere into the file depend on more than the method, e.g. on its sig.
+        auto insideMethod = [&method](core::Loc loc) -> bool {
+            return !loc.exists() || loc.file() != method.loc.file() ||
+                   (loc.beginPos() >= method.loc.beginPos() && loc.endPos() <= method.loc.endPos());
+        };
+        auto errors = result.exception ? nullopt : errorsToCache(result.errors);
+        auto cacheable = [&insideMethod](const core::Error *error) { return allLocs(*error, insideMethod); };
+        if (errors && all_of(errors->begin(), errors->end(), cacheable)) {
+            cache.cacheEntries.emplace_back(move(keys[i]),
+                                            core::serialize::Serializer::storeErrors(
+                                                ctx, usedHashes, *errors, method.loc.file(), method.loc.beginPos()));
+        }
+        ctx.state.errorQueue->pushCapturedErrors(move(result.errors));
+        if (result.exception) {
+            // The serial walk would have stopped at this method.
+            rethrow_exception(result.exception);
+        }
+    }
+}
+
+string fileKey(const core::File &file) {
+    auto path = file.path();
     string key(path.begin(), path.end());
     key += "//";
-    auto hashBytes = sorbet::crypto_hashing::hash64(file.data(gs).source());
-    key += absl::BytesToHexString(string_view{(char *)hashBytes.data(), size(hashBytes)});
+    key += absl::BytesToHexString(file.contentHash());
     return key;
 }
 
+string fileKey(const core::GlobalState &gs, core::FileRef file) {
+    return fileKey(file.data(gs));
+}
+
+// Trees are cached by what they are made from rather than by path, so that a file that was moved or renamed, or is
+// checked out somewhere else, still finds its tree. Their locations name the file they are loaded into, see
+// `Serializer::loadExpression`. The only thing about the path desugaring looks at is whether it is an RBI.
+string treeKey(const core::GlobalState &gs, core::FileRef file) {
+    auto &data = file.data(gs);
+    return fmt::format("tree//{}//{}", data.isRBI() ? "rbi" : "rb", absl::BytesToHexString(data.contentHash()));
+}
+
 unique_ptr<ast::Expression> fetchTreeFromCache(core::GlobalState &gs, core::FileRef file,
                                                const unique_ptr<KeyValueStore> &kvstore) {
     if (kvstore && file.id() < gs.filesUsed()) {
-        string fileHashKey = fileKey(gs, file);
-        auto maybeCached = kvstore->read(fileHashKey);
+        auto maybeCached = kvstore->read(treeKey(gs, file));
         if (maybeCached) {
             prodCounterInc("types.input.files.kvstore.hit");
             auto cachedTree = core::serialize::Serializer::loadExpression(gs, maybeCached, file.id());
@@ -109,21 +527,44 @@ unique_ptr<ast::Expression> fetchTreeFromCache(core::GlobalState &gs, core::File
     return nullptr;
 }
 
-void cacheTrees(core::GlobalState &gs, unique_ptr<KeyValueStore> &kvstore, vector<ast::ParsedFile> &trees) {
+// Serializes the trees in parallel on `workers`, then writes them all from this thread, which is the only one allowed
+// to write to `kvstore`. Called once indexing is done rather than while merging, so that merging never waits on it.
+//
+// Only trees from before the namer are cached. Naming and resolving a file is mostly entering symbols into, and
+// looking them up in, the one GlobalState every file shares, so a resolved tree is only meaningful next to the symbol
+// table it was resolved against; replaying one would still require entering all of its definitions. What can be
+// skipped for an unchanged file and its dependencies is typechecking it, see `typecheckOneCached`.
+void cacheTrees(core::GlobalState &gs, unique_ptr<KeyValueStore> &kvstore, vector<ast::ParsedFile> &trees,
+                WorkerPool &workers) {
     if (!kvstore) {
         return;
     }
-    for (auto &tree : trees) {
-        if (tree.file.data(gs).cachedParseTree || tree.file.data(gs).hasParseErrors) {
-            continue;
+    Timer timeit(gs.tracer(), "cacheTrees");
+    vector<pair<string, vector<u1>>> entries(trees.size());
+    {
+        WorkerPool::TaskGroup group;
+        for (int i = 0; i < trees.size(); i++) {
+            auto &tree = trees[i];
+            if (tree.file.data(gs).cachedParseTree || tree.file.data(gs).hasParseErrors) {
+                continue;
+            }
+            workers.submit(group, [&gs, &tree, &entry = entries[i]]() {
+                entry.first = treeKey(gs, tree.file);
+                entry.second = core::serialize::Serializer::storeExpression(gs, tree.tree);
+            });
+        }
+        workers.wait(group);
+    }
+    for (auto &[key, value] : entries) {
+        if (!key.empty()) {
+            kvstore->write(key, value);
         }
-        string fileHashKey = fileKey(gs, tree.file);
-        kvstore->write(fileHashKey, core::serialize::Serializer::storeExpression(gs, tree.tree));
     }
 }
 
 unique_ptr<parser::Node> runParser(core::GlobalState &gs, core::FileRef file, const options::Printers &print) {
     Timer timeit(gs.tracer(), "runParser", {{"file", (string)file.data(gs).path()}});
+    SlowReport::Scope slowReport("parse", gs, file);
     unique_ptr<parser::Node> nodes;
     {
         core::UnfreezeNameTable nameTableAccess(gs); // enters strings from source code as names
@@ -144,6 +585,7 @@ unique_ptr<parser::Node> runParser(core::GlobalState &gs, core::FileRef file, co
 unique_ptr<ast::Expression> runDesugar(core::GlobalState &gs, core::FileRef file, unique_ptr<parser::Node> parseTree,
                                        const options::Printers &print) {
     Timer timeit(gs.tracer(), "runDesugar", {{"file", (string)file.data(gs).path()}});
+    SlowReport::Scope slowReport("desugar", gs, file);
     unique_ptr<ast::Expression> ast;
     core::MutableContext ctx(gs, core::Symbols::root());
     {
@@ -163,6 +605,7 @@ unique_ptr<ast::Expression> runDesugar(core::GlobalState &gs, core::FileRef file
 unique_ptr<ast::Expression> runDSL(core::GlobalState &gs, core::FileRef file, unique_ptr<ast::Expression> ast) {
     core::MutableContext ctx(gs, core::Symbols::root());
     Timer timeit(gs.tracer(), "runDSL", {{"file", (string)file.data(gs).path()}});
+    SlowReport::Scope slowReport("dsl", gs, file);
     core::UnfreezeNameTable nameTableAccess(gs); // creates temporaries during desugaring
     core::ErrorRegion errs(gs, file);
     return dsl::DSL::run(ctx, move(ast));
@@ -170,14 +613,67 @@ unique_ptr<ast::Expression> runDSL(core::GlobalState &gs, core::FileRef file, un
 
 ast::ParsedFile runLocalVars(core::GlobalState &gs, ast::ParsedFile tree) {
     Timer timeit(gs.tracer(), "runLocalVars", {{"file", (string)tree.file.data(gs).path()}});
+    SlowReport::Scope slowReport("local_vars", gs, tree.file);
     core::MutableContext ctx(gs, core::Symbols::root());
     return sorbet::local_vars::LocalVars::run(ctx, move(tree));
 }
 
+// Runs the DSL passes and names locals in the same walk.
+ast::ParsedFile runDSLAndLocalVars(core::GlobalState &gs, ast::ParsedFile tree) {
+    Timer timeit(gs.tracer(), "runDSLAndLocalVars", {{"file", (string)tree.file.data(gs).path()}});
+    SlowReport::Scope slowReport("dsl_and_local_vars", gs, tree.file);
+    core::MutableContext ctx(gs, core::Symbols::root());
+    core::UnfreezeNameTable nameTableAccess(gs); // the DSL passes create temporaries
+    core::ErrorRegion errs(gs, tree.file);
+    return sorbet::local_vars::LocalVars::runWithDSL(ctx, move(tree));
+}
+
 ast::ParsedFile emptyParsedFile(core::FileRef file) {
     return {make_unique<ast::EmptyTree>(), file};
 }
 
+// Ruby reads a file as UTF-8 unless a magic comment on its first line (or its second, after a shebang) names another
+// encoding.
+bool declaresOtherEncoding(string_view source) {
+    for (int line = 0; line < 2 && !source.empty(); line++) {
+        auto end = min(source.find('\n'), source.size());
+        auto text = source.substr(0, end);
+        source.remove_prefix(min(end + 1, source.size()));
+        if (text.empty() || text[0] != '#') {
+            continue;
+        }
+        auto coding = text.find("coding");
+        if (coding == string_view::npos || coding + 6 >= text.size() ||
+            (text[coding + 6] != ':' && text[coding + 6] != '=')) {
+            continue;
+        }
+        auto name = text.substr(coding + 7);
+        name.remove_prefix(min(name.find_first_not_of(' '), name.size()));
+        name = name.substr(0, name.find_first_of(" \t\r;"));
+        string lower;
+        for (auto c : name) {
+            lower += tolower(c);
+        }
+        return lower != "utf-8" && lower != "utf8";
+    }
+    return false;
+}
+
+// Reports files that aren't valid UTF-8 before they get to the parser, which would otherwise take their bytes apart
+// piece by piece.
+bool hasValidEncoding(core::GlobalState &gs, core::FileRef file) {
+    auto source = file.data(gs).source();
+    auto offset = UTF8::firstInvalid(source);
+    if (offset == source.size() || declaresOtherEncoding(source)) {
+        return true;
+    }
+    if (auto e = gs.beginError(core::Loc(file, offset, offset + 1), core::errors::Parser::InvalidUTF8)) {
+        auto byte = static_cast<unsigned char>(source[offset]);
+        e.setHeader("Invalid UTF-8 byte `{}`", absl::StrCat("\\x", absl::Hex(byte, absl::kZeroPad2)));
+    }
+    return false;
+}
+
 ast::ParsedFile indexOne(const options::Options &opts, core::GlobalState &lgs, core::FileRef file,
                          unique_ptr<KeyValueStore> &kvstore) {
     auto &print = opts.print;
@@ -193,6 +689,9 @@ ast::ParsedFile indexOne(const options::Options &opts, core::GlobalState &lgs, c
             if (file.data(lgs).strictLevel == core::StrictLevel::Ignore) {
                 return emptyParsedFile(file);
             }
+            if (!hasValidEncoding(lgs, file)) {
+                return emptyParsedFile(file);
+            }
             auto parseTree = runParser(lgs, file, print);
             if (opts.stopAfterPhase == options::Phase::PARSER) {
                 return emptyParsedFile(file);
@@ -201,10 +700,11 @@ ast::ParsedFile indexOne(const options::Options &opts, core::GlobalState &lgs, c
             if (opts.stopAfterPhase == options::Phase::DESUGARER) {
                 return emptyParsedFile(file);
             }
-            if (!opts.skipDSLPasses) {
-                tree = runDSL(lgs, file, move(tree));
+            if (opts.skipDSLPasses) {
+                tree = runLocalVars(lgs, ast::ParsedFile{move(tree), file}).tree;
+            } else {
+                tree = runDSLAndLocalVars(lgs, ast::ParsedFile{move(tree), file}).tree;
             }
-            tree = runLocalVars(lgs, ast::ParsedFile{move(tree), file}).tree;
             if (opts.stopAfterPhase == options::Phase::LOCAL_VARS) {
                 return emptyParsedFile(file);
             }
@@ -234,9 +734,66 @@ pair<ast::ParsedFile, vector<shared_ptr<core::File>>> emptyPluginFile(core::File
     return {emptyParsedFile(file), vector<shared_ptr<core::File>>()};
 }
 
-pair<ast::ParsedFile, vector<shared_ptr<core::File>>> indexOneWithPlugins(const options::Options &opts,
-                                                                          core::GlobalState &gs, core::FileRef file,
-                                                                          unique_ptr<KeyValueStore> &kvstore) {
+string pluginFilesKey(const core::GlobalState &gs, core::FileRef file) {
+    return "pluginfiles//" + fileKey(gs, file);
+}
+
+// Each file as its path and source, both preceded by their size and a newline.
+string encodePluginFiles(const vector<shared_ptr<core::File>> &files) {
+    string result;
+    for (auto &file : files) {
+        for (auto part : {file->path(), file->source()}) {
+            result += to_string(part.size());
+            result += '\n';
+            result += part;
+        }
+    }
+    return result;
+}
+
+optional<vector<shared_ptr<core::File>>> decodePluginFiles(string_view encoded) {
+    vector<shared_ptr<core::File>> result;
+    auto nextPart = [&encoded]() -> optional<string> {
+        auto newline = encoded.find('\n');
+        if (newline == string_view::npos) {
+            return nullopt;
+        }
+        size_t size = 0;
+        auto parsed = from_chars(encoded.data(), encoded.data() + newline, size);
+        if (parsed.ec != errc() || parsed.ptr != encoded.data() + newline || size > encoded.size() - newline - 1) {
+            return nullopt;
+        }
+        string part(encoded.substr(newline + 1, size));
+        encoded.remove_prefix(newline + 1 + size);
+        return part;
+    };
+    while (!encoded.empty()) {
+        auto path = nextPart();
+        auto source = path ? nextPart() : nullopt;
+        if (!source) {
+            return nullopt;
+        }
+        auto file = make_shared<core::File>(move(*path), move(*source), core::File::Normal);
+        file->pluginGenerated = true;
+        result.emplace_back(move(file));
+    }
+    return result;
+}
+
+// A cached tree doesn't include what DSL plugins generated for it, so it's only usable along with the plugin files
+// cached next to it.
+optional<vector<shared_ptr<core::File>>> fetchPluginFilesFromCache(core::GlobalState &gs, core::FileRef file,
+                                                                   const unique_ptr<KeyValueStore> &kvstore) {
+    auto key = pluginFilesKey(gs, file);
+    if (kvstore->read(key) == nullptr) {
+        return nullopt;
+    }
+    return decodePluginFiles(kvstore->readString(key));
+}
+
+pair<ast::ParsedFile, vector<shared_ptr<core::File>>>
+indexOneWithPlugins(const options::Options &opts, core::GlobalState &gs, core::FileRef file,
+                    unique_ptr<KeyValueStore> &kvstore, vector<pair<string, string>> &pluginOutputsToCache) {
     auto &print = opts.print;
     ast::ParsedFile dslsInlined{nullptr, file};
     vector<shared_ptr<core::File>> resultPluginFiles;
@@ -244,12 +801,23 @@ pair<ast::ParsedFile, vector<shared_ptr<core::File>>> indexOneWithPlugins(const
     Timer timeit(gs.tracer(), "indexOneWithPlugins", {{"file", (string)file.data(gs).path()}});
     try {
         unique_ptr<ast::Expression> tree = fetchTreeFromCache(gs, file, kvstore);
+        if (tree && gs.hasAnyDslPlugin()) {
+            if (auto cachedPluginFiles = fetchPluginFilesFromCache(gs, file, kvstore)) {
+                resultPluginFiles = move(*cachedPluginFiles);
+            } else {
+                tree = nullptr;
+                file.data(gs).cachedParseTree = false;
+            }
+        }
 
         if (!tree) {
             // tree isn't cached. Need to start from parser
             if (file.data(gs).strictLevel == core::StrictLevel::Ignore) {
                 return emptyPluginFile(file);
             }
+            if (!hasValidEncoding(gs, file)) {
+                return emptyPluginFile(file);
+            }
             auto parseTree = runParser(gs, file, print);
             if (opts.stopAfterPhase == options::Phase::PARSER) {
                 return emptyPluginFile(file);
@@ -265,9 +833,13 @@ pair<ast::ParsedFile, vector<shared_ptr<core::File>>> indexOneWithPlugins(const
                 core::MutableContext ctx(gs, core::Symbols::root());
                 core::ErrorRegion errs(gs, file);
 
-                auto [pluginTree, pluginFiles] = plugin::SubprocessTextPlugin::run(ctx, move(tree));
+                auto [pluginTree, pluginFiles] =
+                    plugin::SubprocessTextPlugin::run(ctx, move(tree), kvstore, pluginOutputsToCache);
                 tree = move(pluginTree);
                 resultPluginFiles = move(pluginFiles);
+                if (kvstore && gs.hasAnyDslPlugin()) {
+                    pluginOutputsToCache.emplace_back(pluginFilesKey(gs, file), encodePluginFiles(resultPluginFiles));
+                }
             }
 #endif
             if (!opts.skipDSLPasses) {
@@ -307,7 +879,7 @@ pair<ast::ParsedFile, vector<shared_ptr<core::File>>> indexOneWithPlugins(const
 }
 
 vector<ast::ParsedFile> incrementalResolve(core::GlobalState &gs, vector<ast::ParsedFile> what,
-                                           const options::Options &opts) {
+                                           const options::Options &opts, WorkerPool &workers) {
     try {
         core::MutableContext ctx(gs, core::Symbols::root());
         {
@@ -315,7 +887,7 @@ vector<ast::ParsedFile> incrementalResolve(core::GlobalState &gs, vector<ast::Pa
             core::UnfreezeSymbolTable symbolTable(gs);
             core::UnfreezeNameTable nameTable(gs);
 
-            what = sorbet::namer::Namer::run(ctx, move(what));
+            what = sorbet::namer::Namer::run(ctx, move(what), workers);
         }
 
         {
@@ -325,7 +897,7 @@ vector<ast::ParsedFile> incrementalResolve(core::GlobalState &gs, vector<ast::Pa
             core::UnfreezeSymbolTable symbolTable(gs);
             core::UnfreezeNameTable nameTable(gs);
 
-            what = sorbet::resolver::Resolver::runTreePasses(ctx, move(what));
+            what = sorbet::resolver::Resolver::runTreePasses(ctx, move(what), workers);
         }
     } catch (SorbetException &) {
         if (auto e = gs.beginError(sorbet::core::Loc::none(), sorbet::core::errors::Internal::InternalError)) {
@@ -350,30 +922,30 @@ vector<core::FileRef> reserveFiles(unique_ptr<core::GlobalState> &gs, const vect
     return ret;
 }
 
-core::StrictLevel decideStrictLevel(const core::GlobalState &gs, const core::FileRef file,
-                                    const options::Options &opts) {
-    auto &fileData = file.data(gs);
-
-    core::StrictLevel level;
-    string filePath = string(fileData.path());
+namespace {
+optional<core::StrictLevel> findStrictnessOverride(string_view path, const options::Options &opts) {
+    string filePath = string(path);
     // make sure all relative file paths start with ./
     if (!absl::StartsWith(filePath, "/") && !absl::StartsWith(filePath, "./")) {
         filePath.insert(0, "./");
     }
     auto fnd = opts.strictnessOverrides.find(filePath);
-    if (fnd != opts.strictnessOverrides.end()) {
-        if (fnd->second == fileData.originalSigil) {
-            core::ErrorRegion errs(gs, file);
-            if (auto e = gs.beginError(sorbet::core::Loc::none(file), core::errors::Parser::ParserError)) {
-                e.setHeader("Useless override of strictness level");
-            }
-        }
-        level = fnd->second;
+    if (fnd == opts.strictnessOverrides.end()) {
+        return nullopt;
+    }
+    return fnd->second;
+}
+
+core::StrictLevel strictLevelFor(const core::GlobalState &gs, optional<core::StrictLevel> strictnessOverride,
+                                 core::StrictLevel originalSigil, const options::Options &opts) {
+    core::StrictLevel level;
+    if (strictnessOverride.has_value()) {
+        level = *strictnessOverride;
     } else {
-        if (fileData.originalSigil == core::StrictLevel::None) {
+        if (originalSigil == core::StrictLevel::None) {
             level = core::StrictLevel::False;
         } else {
-            level = fileData.originalSigil;
+            level = originalSigil;
         }
     }
 
@@ -391,6 +963,30 @@ core::StrictLevel decideStrictLevel(const core::GlobalState &gs, const core::Fil
     return level;
 }
 
+// How much of a file is read to look for its sigil in before reading the rest.
+constexpr size_t SIGIL_PROBE_BYTES = 4096;
+
+// The lines at the start of `head`, leaving out the last one if it isn't whole. If `core::File::fileSigil` finds a
+// sigil in them, it's the one it finds in the whole file.
+string_view sigilProbeLines(string_view head) {
+    auto end = head.rfind('\n');
+    return end == string_view::npos ? string_view() : head.substr(0, end + 1);
+}
+} // namespace
+
+core::StrictLevel decideStrictLevel(const core::GlobalState &gs, const core::FileRef file,
+                                    const options::Options &opts) {
+    auto &fileData = file.data(gs);
+    auto strictnessOverride = findStrictnessOverride(fileData.path(), opts);
+    if (strictnessOverride == fileData.originalSigil) {
+        core::ErrorRegion errs(gs, file);
+        if (auto e = gs.beginError(sorbet::core::Loc::none(file), core::errors::Parser::ParserError)) {
+            e.setHeader("Useless override of strictness level");
+        }
+    }
+    return strictLevelFor(gs, strictnessOverride, fileData.originalSigil, opts);
+}
+
 void incrementStrictLevelCounter(core::StrictLevel level) {
     switch (level) {
         case core::StrictLevel::None:
@@ -426,17 +1022,33 @@ void incrementStrictLevelCounter(core::StrictLevel level) {
     }
 }
 
-void readFileWithStrictnessOverrides(unique_ptr<core::GlobalState> &gs, core::FileRef file,
-                                     const options::Options &opts) {
-    if (file.dataAllowingUnsafe(*gs).sourceType != core::File::NotYetRead) {
+void readFileWithStrictnessOverrides(core::GlobalState &gs, core::FileRef file, const options::Options &opts) {
+    if (file.dataAllowingUnsafe(gs).sourceType != core::File::NotYetRead) {
         return;
     }
-    auto fileName = file.dataAllowingUnsafe(*gs).path();
-    Timer timeit(gs->tracer(), "readFileWithStrictnessOverrides", {{"file", (string)fileName}});
+    auto fileName = file.dataAllowingUnsafe(gs).path();
+    Timer timeit(gs.tracer(), "readFileWithStrictnessOverrides", {{"file", (string)fileName}});
     string src;
     bool fileFound = true;
     try {
-        src = opts.fs->readFile(fileName);
+        if (opts.runLSP || !opts.storeState.empty()) {
+            // The language server hands out the sources of the files it knows, and a payload stores them.
+            src = opts.fs->readFile(fileName);
+        } else {
+            // Most of what an ignored file holds is never looked at, so if its first lines show it's ignored, only
+            // they are read.
+            bool skippedRest = false;
+            src = opts.fs->readFileOrHead(fileName, SIGIL_PROBE_BYTES, [&](string_view head) -> bool {
+                auto sigil = core::File::fileSigil(sigilProbeLines(head));
+                skippedRest = sigil != core::StrictLevel::None &&
+                              strictLevelFor(gs, findStrictnessOverride(fileName, opts), sigil, opts) ==
+                                  core::StrictLevel::Ignore;
+                return skippedRest;
+            });
+            if (skippedRest) {
+                src.resize(sigilProbeLines(src).size());
+            }
+        }
     } catch (FileNotFoundException e) {
         // continue with an empty source, because the
         // assertion below requires every input file to map
@@ -447,18 +1059,18 @@ void readFileWithStrictnessOverrides(unique_ptr<core::GlobalState> &gs, core::Fi
     prodCounterInc("types.input.files");
 
     {
-        core::UnfreezeFileTable unfreezeFiles(*gs);
-        auto entered = gs->enterNewFileAt(
+        core::UnfreezeFileTable unfreezeFiles(gs);
+        auto entered = gs.enterNewFileAt(
             make_shared<core::File>(string(fileName.begin(), fileName.end()), move(src), core::File::Normal), file);
         ENFORCE(entered == file);
     }
     if (enable_counters) {
-        counterAdd("types.input.lines", file.data(*gs).lineCount());
+        counterAdd("types.input.lines", file.data(gs).lineCount());
     }
 
-    auto &fileData = file.data(*gs);
+    auto &fileData = file.data(gs);
     if (!fileFound) {
-        if (auto e = gs->beginError(sorbet::core::Loc::none(file), core::errors::Internal::FileNotFound)) {
+        if (auto e = gs.beginError(sorbet::core::Loc::none(file), core::errors::Internal::FileNotFound)) {
             e.setHeader("File Not Found");
         }
     }
@@ -467,7 +1079,7 @@ void readFileWithStrictnessOverrides(unique_ptr<core::GlobalState> &gs, core::Fi
         fileData.sourceType = core::File::PayloadGeneration;
     }
 
-    auto level = decideStrictLevel(*gs, file, opts);
+    auto level = decideStrictLevel(gs, file, opts);
     fileData.strictLevel = level;
     incrementStrictLevelCounter(level);
 }
@@ -476,96 +1088,123 @@ struct IndexResult {
     unique_ptr<core::GlobalState> gs;
     vector<ast::ParsedFile> trees;
     vector<shared_ptr<core::File>> pluginGeneratedFiles;
+    vector<pair<string, string>> pluginOutputsToCache;
 };
 
 struct IndexThreadResultPack {
     CounterState counters;
-    IndexResult res;
+    vector<ast::ParsedFile> trees;
+    vector<shared_ptr<core::File>> pluginGeneratedFiles;
+    vector<pair<string, string>> pluginOutputsToCache;
 };
 
-IndexResult mergeIndexResults(const shared_ptr<core::GlobalState> cgs, const options::Options &opts,
-                              shared_ptr<BlockingBoundedQueue<IndexThreadResultPack>> input,
-                              unique_ptr<KeyValueStore> &kvstore) {
+void cachePluginOutputs(unique_ptr<KeyValueStore> &kvstore, vector<pair<string, string>> &outputs) {
+    if (!kvstore) {
+        return;
+    }
+    for (auto &[key, output] : outputs) {
+        kvstore->writeString(key, output);
+    }
+    outputs.clear();
+}
+
+// Collects what the workers indexed. They all index into `gs` itself, under a `core::UnfreezeTablesForIndexing`, so
+// there is nothing to substitute. Naming still can't be overlapped with this: the workers don't expect symbols to be
+// entered underneath them, and naming files as they arrive would make symbol IDs depend on thread scheduling.
+IndexResult mergeIndexResults(core::GlobalState &gs, const options::Options &opts,
+                              shared_ptr<BlockingBoundedQueue<IndexThreadResultPack>> input) {
     ProgressIndicator progress(opts.showProgress, "Indexing", input->bound);
-    Timer timeit(cgs->tracer(), "mergeIndexResults");
+    Timer timeit(gs.tracer(), "mergeIndexResults");
     IndexThreadResultPack threadResult;
     IndexResult ret;
-    for (auto result = input->wait_pop_timed(threadResult, WorkerPool::BLOCK_INTERVAL(), cgs->tracer()); !result.done();
-         result = input->wait_pop_timed(threadResult, WorkerPool::BLOCK_INTERVAL(), cgs->tracer())) {
+    for (auto result = input->wait_pop_timed(threadResult, WorkerPool::BLOCK_INTERVAL(), gs.tracer()); !result.done();
+         result = input->wait_pop_timed(threadResult, WorkerPool::BLOCK_INTERVAL(), gs.tracer())) {
         if (result.gotItem()) {
             counterConsume(move(threadResult.counters));
-            if (ret.gs == nullptr) {
-                ret.gs = move(threadResult.res.gs);
-                ENFORCE(ret.trees.empty());
-                ret.trees = move(threadResult.res.trees);
-                ret.pluginGeneratedFiles = move(threadResult.res.pluginGeneratedFiles);
-                cacheTrees(*ret.gs, kvstore, ret.trees);
-            } else {
-                core::GlobalSubstitution substitution(*threadResult.res.gs, *ret.gs, cgs.get());
-                core::MutableContext ctx(*ret.gs, core::Symbols::root());
-                {
-                    Timer timeit(cgs->tracer(), "substituteTrees");
-                    for (auto &tree : threadResult.res.trees) {
-                        auto file = tree.file;
-                        core::ErrorRegion errs(*ret.gs, file);
-                        if (!file.data(*ret.gs).cachedParseTree) {
-                            tree.tree = ast::Substitute::run(ctx, substitution, move(tree.tree));
-                        }
-                    }
-                }
-                cacheTrees(*ret.gs, kvstore, threadResult.res.trees);
-                ret.trees.insert(ret.trees.end(), make_move_iterator(threadResult.res.trees.begin()),
-                                 make_move_iterator(threadResult.res.trees.end()));
-
-                ret.pluginGeneratedFiles.insert(ret.pluginGeneratedFiles.end(),
-                                                make_move_iterator(threadResult.res.pluginGeneratedFiles.begin()),
-                                                make_move_iterator(threadResult.res.pluginGeneratedFiles.end()));
-            }
+            ret.trees.insert(ret.trees.end(), make_move_iterator(threadResult.trees.begin()),
+                             make_move_iterator(threadResult.trees.end()));
+            ret.pluginGeneratedFiles.insert(ret.pluginGeneratedFiles.end(),
+                                            make_move_iterator(threadResult.pluginGeneratedFiles.begin()),
+                                            make_move_iterator(threadResult.pluginGeneratedFiles.end()));
+            ret.pluginOutputsToCache.insert(ret.pluginOutputsToCache.end(),
+                                            make_move_iterator(threadResult.pluginOutputsToCache.begin()),
+                                            make_move_iterator(threadResult.pluginOutputsToCache.end()));
             progress.reportProgress(input->doneEstimate());
-            ret.gs->errorQueue->flushErrors();
+            gs.errorQueue->flushErrors();
         }
     }
     return ret;
 }
 
-IndexResult indexSuppliedFiles(const shared_ptr<core::GlobalState> &baseGs, vector<core::FileRef> &files,
+// How many files an indexing thread claims at once while there are plenty left. Most files index in well under a
+// millisecond, so claiming them one by one would mostly be contending on the queue.
+constexpr size_t INDEX_CHUNK_SIZE = 16;
+
+IndexResult indexSuppliedFiles(unique_ptr<core::GlobalState> gs, vector<core::FileRef> &files,
                                const options::Options &opts, WorkerPool &workers, unique_ptr<KeyValueStore> &kvstore) {
-    Timer timeit(baseGs->tracer(), "indexSuppliedFiles");
+    Timer timeit(gs->tracer(), "indexSuppliedFiles");
     auto resultq = make_shared<BlockingBoundedQueue<IndexThreadResultPack>>(files.size());
     auto fileq = make_shared<ConcurrentBoundedQueue<core::FileRef>>(files.size());
+    vector<string> unreadPaths;
     for (auto &file : files) {
-        fileq->push(move(file), 1);
+        auto &fileData = file.dataAllowingUnsafe(*gs);
+        if (fileData.sourceType == core::File::NotYetRead) {
+            unreadPaths.emplace_back(fileData.path());
+        }
     }
+    fileq->push_bulk(vector<core::FileRef>(files));
 
-    workers.multiplexJob("indexSuppliedFiles", [baseGs, &opts, fileq, resultq, &kvstore]() {
-        Timer timeit(baseGs->tracer(), "indexSuppliedFilesWorker");
-        unique_ptr<core::GlobalState> localGs = baseGs->deepCopy();
-        IndexThreadResultPack threadResult;
+    IndexResult ret;
+    {
+        // Cold reads can be slow, e.g. on network file systems. Asking for every file up front, in the order the
+        // workers pop them, lets the OS load them while the workers index the ones before.
+        atomic<bool> prefetchCancelled = false;
+        unique_ptr<Joinable> prefetcher;
+#ifndef EMSCRIPTEN
+        if (unreadPaths.size() > 1) {
+            prefetcher = runInAThread("prefetchFiles", [&opts, &unreadPaths, &prefetchCancelled]() {
+                for (auto &path : unreadPaths) {
+                    if (prefetchCancelled) {
+                        return;
+                    }
+                    opts.fs->prefetchFile(path);
+                }
+            });
+        }
+#endif
+        core::UnfreezeTablesForIndexing indexing(*gs);
+        workers.multiplexJob("indexSuppliedFiles", [&sharedGs = *gs, &opts, fileq, resultq, &kvstore]() {
+            Timer timeit(sharedGs.tracer(), "indexSuppliedFilesWorker");
+            IndexThreadResultPack threadResult;
 
-        {
-            core::FileRef job;
-            for (auto result = fileq->try_pop(job); !result.done(); result = fileq->try_pop(job)) {
-                if (result.gotItem()) {
-                    core::FileRef file = job;
-                    readFileWithStrictnessOverrides(localGs, file, opts);
-                    auto [parsedFile, pluginFiles] = indexOneWithPlugins(opts, *localGs, file, kvstore);
-                    threadResult.res.pluginGeneratedFiles.insert(threadResult.res.pluginGeneratedFiles.end(),
+            {
+                vector<core::FileRef> jobs;
+                for (auto result = fileq->try_pop_bulk(jobs, fileq->chunkSize(INDEX_CHUNK_SIZE)); !result.done();
+                     result = fileq->try_pop_bulk(jobs, fileq->chunkSize(INDEX_CHUNK_SIZE))) {
+                    for (auto file : jobs) {
+                        readFileWithStrictnessOverrides(sharedGs, file, opts);
+                        auto [parsedFile, pluginFiles] = indexOneWithPlugins(opts, sharedGs, file, kvstore,
+                                                                             threadResult.pluginOutputsToCache);
+                        threadResult.pluginGeneratedFiles.insert(threadResult.pluginGeneratedFiles.end(),
                                                                  make_move_iterator(pluginFiles.begin()),
                                                                  make_move_iterator(pluginFiles.end()));
-                    threadResult.res.trees.emplace_back(move(parsedFile));
+                        threadResult.trees.emplace_back(move(parsedFile));
+                    }
                 }
             }
-        }
 
-        if (!threadResult.res.trees.empty()) {
-            threadResult.counters = getAndClearThreadCounters();
-            threadResult.res.gs = move(localGs);
-            auto computedTreesCount = threadResult.res.trees.size();
-            resultq->push(move(threadResult), computedTreesCount);
-        }
-    });
+            if (!threadResult.trees.empty()) {
+                threadResult.counters = getAndClearThreadCounters();
+                auto computedTreesCount = threadResult.trees.size();
+                resultq->push(move(threadResult), computedTreesCount);
+            }
+        });
 
-    return mergeIndexResults(baseGs, opts, resultq, kvstore);
+        ret = mergeIndexResults(*gs, opts, resultq);
+        prefetchCancelled = true;
+    }
+    ret.gs = move(gs);
+    return ret;
 }
 
 IndexResult indexPluginFiles(IndexResult firstPass, const options::Options &opts, WorkerPool &workers,
@@ -578,55 +1217,37 @@ IndexResult indexPluginFiles(IndexResult firstPass, const options::Options &opts
     auto pluginFileq = make_shared<ConcurrentBoundedQueue<core::FileRef>>(firstPass.pluginGeneratedFiles.size());
     {
         core::UnfreezeFileTable unfreezeFiles(*firstPass.gs);
+        vector<core::FileRef> generatedFiles;
         for (const auto &file : firstPass.pluginGeneratedFiles) {
-            auto generatedFile = firstPass.gs->enterFile(file);
-            pluginFileq->push(move(generatedFile), 1);
+            generatedFiles.emplace_back(firstPass.gs->enterFile(file));
         }
+        pluginFileq->push_bulk(move(generatedFiles));
     }
-    const shared_ptr<core::GlobalState> protoGs = move(firstPass.gs);
-    workers.multiplexJob("indexPluginFiles", [protoGs, &opts, pluginFileq, resultq, &kvstore]() {
-        Timer timeit(protoGs->tracer(), "indexPluginFilesWorker");
-        auto localGs = protoGs->deepCopy();
+
+    core::UnfreezeTablesForIndexing indexing(*firstPass.gs);
+    workers.multiplexJob("indexPluginFiles", [&sharedGs = *firstPass.gs, &opts, pluginFileq, resultq, &kvstore]() {
+        Timer timeit(sharedGs.tracer(), "indexPluginFilesWorker");
         IndexThreadResultPack threadResult;
-        core::FileRef job;
+        vector<core::FileRef> jobs;
 
-        for (auto result = pluginFileq->try_pop(job); !result.done(); result = pluginFileq->try_pop(job)) {
-            if (result.gotItem()) {
-                core::FileRef file = job;
-                file.data(*localGs).strictLevel = decideStrictLevel(*localGs, file, opts);
-                threadResult.res.trees.emplace_back(indexOne(opts, *localGs, file, kvstore));
+        for (auto result = pluginFileq->try_pop_bulk(jobs, pluginFileq->chunkSize(INDEX_CHUNK_SIZE)); !result.done();
+             result = pluginFileq->try_pop_bulk(jobs, pluginFileq->chunkSize(INDEX_CHUNK_SIZE))) {
+            for (auto file : jobs) {
+                file.data(sharedGs).strictLevel = decideStrictLevel(sharedGs, file, opts);
+                threadResult.trees.emplace_back(indexOne(opts, sharedGs, file, kvstore));
             }
         }
 
-        if (!threadResult.res.trees.empty()) {
+        if (!threadResult.trees.empty()) {
             threadResult.counters = getAndClearThreadCounters();
-            threadResult.res.gs = move(localGs);
-            auto sizeIncrement = threadResult.res.trees.size();
+            auto sizeIncrement = threadResult.trees.size();
             resultq->push(move(threadResult), sizeIncrement);
         }
     });
-    auto indexedPluginFiles = mergeIndexResults(protoGs, opts, resultq, kvstore);
-    IndexResult suppliedFilesAndPluginFiles;
-    if (indexedPluginFiles.trees.empty()) {
-        return firstPass;
-    }
-    suppliedFilesAndPluginFiles.gs = move(indexedPluginFiles.gs);
-
-    {
-        Timer timeit(suppliedFilesAndPluginFiles.gs->tracer(), "incremental_resolve");
-        core::GlobalSubstitution substitution(*protoGs, *suppliedFilesAndPluginFiles.gs, protoGs.get());
-        core::MutableContext ctx(*suppliedFilesAndPluginFiles.gs, core::Symbols::root());
-        for (auto &tree : firstPass.trees) {
-            auto file = tree.file;
-            core::ErrorRegion errs(*suppliedFilesAndPluginFiles.gs, file);
-            tree.tree = ast::Substitute::run(ctx, substitution, move(tree.tree));
-        }
-    }
-    suppliedFilesAndPluginFiles.trees = move(firstPass.trees);
-    suppliedFilesAndPluginFiles.trees.insert(suppliedFilesAndPluginFiles.trees.end(),
-                                             make_move_iterator(indexedPluginFiles.trees.begin()),
-                                             make_move_iterator(indexedPluginFiles.trees.end()));
-    return suppliedFilesAndPluginFiles;
+    auto indexedPluginFiles = mergeIndexResults(*firstPass.gs, opts, resultq);
+    firstPass.trees.insert(firstPass.trees.end(), make_move_iterator(indexedPluginFiles.trees.begin()),
+                           make_move_iterator(indexedPluginFiles.trees.end()));
+    return firstPass;
 }
 
 vector<ast::ParsedFile> index(unique_ptr<core::GlobalState> &gs, vector<core::FileRef> files,
@@ -644,9 +1265,10 @@ vector<ast::ParsedFile> index(unique_ptr<core::GlobalState> &gs, vector<core::Fi
     if (files.size() < 3) {
         // Run singlethreaded if only using 2 files
         size_t pluginFileCount = 0;
+        vector<pair<string, string>> pluginOutputsToCache;
         for (auto file : files) {
-            readFileWithStrictnessOverrides(gs, file, opts);
-            auto [parsedFile, pluginFiles] = indexOneWithPlugins(opts, *gs, file, kvstore);
+            readFileWithStrictnessOverrides(*gs, file, opts);
+            auto [parsedFile, pluginFiles] = indexOneWithPlugins(opts, *gs, file, kvstore, pluginOutputsToCache);
             ret.emplace_back(move(parsedFile));
             pluginFileCount += pluginFiles.size();
             for (auto &pluginFile : pluginFiles) {
@@ -658,27 +1280,78 @@ vector<ast::ParsedFile> index(unique_ptr<core::GlobalState> &gs, vector<core::Fi
                 }
                 ret.emplace_back(indexOne(opts, *gs, pluginFileRef, kvstore));
             }
-            cacheTrees(*gs, kvstore, ret);
         }
         ENFORCE(files.size() + pluginFileCount == ret.size());
+        cachePluginOutputs(kvstore, pluginOutputsToCache);
     } else {
         auto firstPass = indexSuppliedFiles(move(gs), files, opts, workers, kvstore);
+        cachePluginOutputs(kvstore, firstPass.pluginOutputsToCache);
         auto pluginPass = indexPluginFiles(move(firstPass), opts, workers, kvstore);
         gs = move(pluginPass.gs);
         ret = move(pluginPass.trees);
     }
+    cacheTrees(*gs, kvstore, ret, workers);
 
     fast_sort(ret, [](ast::ParsedFile const &a, ast::ParsedFile const &b) { return a.file < b.file; });
     return ret;
 }
 
-ast::ParsedFile typecheckOne(core::Context ctx, ast::ParsedFile resolved, const options::Options &opts) {
+// The codes of the errors each phase of `typecheckOne` can report, internal errors aside. The definition validator only
+// reports resolver errors, and CFG building and inference only CFG and inference errors, see core/errors.
+constexpr pair<int, int> DEFINITION_VALIDATOR_ERRORS{5000, 6000};
+constexpr pair<int, int> CFG_AND_INFERENCE_ERRORS{6000, 8000};
+
+// Whether `opts` asks to only be shown errors whose codes are outside of `codes`, so that a phase that reports none
+// but those can be skipped. --suggest-typed needs every error, even the ones it doesn't show, to pick the sigil.
+bool onlyShowsErrorsOutside(const options::Options &opts, pair<int, int> codes) {
+    if (opts.errorCodeWhiteList.empty() || opts.suggestTyped) {
+        return false;
+    }
+    auto first = opts.errorCodeWhiteList.lower_bound(codes.first);
+    return first == opts.errorCodeWhiteList.end() || *first >= codes.second;
+}
+
+// See `typecheckOne`. If `methodCache` is given, methods are typechecked with it, see `typecheckMethodsCached`. It must
+// not be combined with `reuse`.
+ast::ParsedFile typecheckOneWith(core::Context ctx, ast::ParsedFile resolved, const options::Options &opts,
+                                 WorkerPool *workers, MethodReuse *reuse, MethodCache *methodCache) {
+    ENFORCE(reuse == nullptr || methodCache == nullptr);
     ast::ParsedFile result{make_unique<ast::EmptyTree>(), resolved.file};
     core::FileRef f = resolved.file;
 
-    resolved = definition_validator::runOne(ctx, std::move(resolved));
+    if (onlyShowsErrorsOutside(opts, DEFINITION_VALIDATOR_ERRORS)) {
+        counterInc("types.input.files.typecheck.skipped_validator");
+    } else {
+        resolved = definition_validator::runOne(ctx, std::move(resolved));
+    }
+    // When nothing but errors is asked for, and none that CFG building and inference report would be shown, the
+    // methods need not be typechecked.
+    auto &print = opts.print;
+    bool skipMethods = onlyShowsErrorsOutside(opts, CFG_AND_INFERENCE_ERRORS) && ctx.state.lspQuery.isEmpty() &&
+                       ctx.state.semanticExtensions.empty() && !print.CFG.enabled && !print.CFGJson.enabled &&
+                       !print.CFGProto.enabled && !print.CallGraph.enabled;
+
+    // Methods in files below `typed: true` are never typechecked (see CFGCollectorAndTyper), and flattening reports
+    // no errors, so unless something asked to see the trees or CFGs there is nothing left to do for them.
+    if (f.data(ctx).strictLevel < core::StrictLevel::True && !opts.print.FlattenedTree.enabled &&
+        !opts.print.FlattenedTreeRaw.enabled && !opts.print.CFG.enabled) {
+        counterInc("types.input.files.typecheck.skipped_untyped");
+        return result;
+    }
+    // For the same reason, stopping before CFG building leaves nothing to flatten for.
+    if ((opts.stopAfterPhase == options::Phase::NAMER || opts.stopAfterPhase == options::Phase::RESOLVER ||
+         skipMethods) &&
+        !opts.print.FlattenedTree.enabled && !opts.print.FlattenedTreeRaw.enabled) {
+        if (skipMethods) {
+            counterInc("types.input.files.typecheck.skipped_methods");
+        }
+        return result;
+    }
 
-    resolved = flatten::runOne(ctx, move(resolved));
+    {
+        Timer timeit(ctx.state.tracer(), "flatten", {{"file", (string)f.data(ctx).path()}});
+        resolved = flatten::runOne(ctx, move(resolved));
+    }
 
     if (opts.print.FlattenedTree.enabled) {
         opts.print.FlattenedTree.fmt("{}\n", resolved.tree->toString(ctx));
@@ -687,7 +1360,8 @@ ast::ParsedFile typecheckOne(core::Context ctx, ast::ParsedFile resolved, const
         opts.print.FlattenedTreeRaw.fmt("{}\n", resolved.tree->showRaw(ctx));
     }
 
-    if (opts.stopAfterPhase == options::Phase::NAMER || opts.stopAfterPhase == options::Phase::RESOLVER) {
+    if (opts.stopAfterPhase == options::Phase::NAMER || opts.stopAfterPhase == options::Phase::RESOLVER ||
+        skipMethods) {
         return result;
     }
     if (f.data(ctx).isRBI()) {
@@ -695,14 +1369,48 @@ ast::ParsedFile typecheckOne(core::Context ctx, ast::ParsedFile resolved, const
     }
 
     Timer timeit(ctx.state.tracer(), "typecheckOne", {{"file", (string)f.data(ctx).path()}});
+    SlowReport::Scope slowReport("typecheck", ctx.state, f);
     try {
         if (opts.print.CFG.enabled) {
             opts.print.CFG.fmt("digraph \"{}\" {{\n", FileOps::getFileName(f.data(ctx).path()));
         }
-        CFGCollectorAndTyper collector(opts);
+        bool canCollectMethods = ctx.state.semanticExtensions.empty() && !print.CFG.enabled &&
+                                 !print.CFGJson.enabled && !print.CFGProto.enabled;
+        bool canSplitMethods = canCollectMethods && workers != nullptr && opts.parallelMethodThreshold > 0;
+        bool reuseMethods = canCollectMethods && reuse != nullptr;
+        bool cacheMethods = canCollectMethods && methodCache != nullptr;
+        // A METHOD query only needs the method it asks about.
+        const auto &lspQuery = ctx.state.lspQuery;
+        bool onlyQueriedMethod = canCollectMethods && lspQuery.kind == core::lsp::Query::Kind::METHOD;
+        vector<ast::MethodDef *> methods;
+        CFGCollectorAndTyper collector(
+            opts, canSplitMethods || reuseMethods || cacheMethods || onlyQueriedMethod ? &methods : nullptr);
         {
             core::ErrorRegion errs(ctx, f);
             result.tree = ast::TreeMap::apply(ctx, collector, move(resolved.tree));
+            if (onlyQueriedMethod) {
+                int skipped = 0;
+                for (auto *method : methods) {
+                    if (method->loc == lspQuery.loc) {
+                        collector.typecheckCollected(ctx, *method);
+                    } else {
+                        skipped++;
+                    }
+                }
+                prodCounterAdd("lsp.query.skipped_methods", skipped);
+            } else if (reuseMethods) {
+                typecheckMethodsReusing(ctx, collector, methods, canSplitMethods ? workers : nullptr,
+                                        opts.parallelMethodThreshold, *reuse);
+            } else if (cacheMethods) {
+                typecheckMethodsCached(ctx, collector, methods, canSplitMethods ? workers : nullptr,
+                                       opts.parallelMethodThreshold, *methodCache);
+            } else if (canSplitMethods && methods.size() >= opts.parallelMethodThreshold) {
+                typecheckMethodsInParallel(ctx, collector, methods, *workers);
+            } else {
+                for (auto *method : methods) {
+                    collector.typecheckCollected(ctx, *method);
+                }
+            }
         }
         if (opts.print.CFG.enabled) {
             opts.print.CFG.fmt("}}\n\n");
@@ -716,39 +1424,130 @@ ast::ParsedFile typecheckOne(core::Context ctx, ast::ParsedFile resolved, const
     return result;
 }
 
+ast::ParsedFile typecheckOne(core::Context ctx, ast::ParsedFile resolved, const options::Options &opts,
+                             WorkerPool *workers, MethodReuse *reuse) {
+    return typecheckOneWith(ctx, move(resolved), opts, workers, reuse, nullptr);
+}
+
+// Whether errors reported by typecheckOne can be cached in and replayed from the KeyValueStore. Anything that makes
+// typechecking do more than report errors rules caching out.
+bool canCacheTypecheckResults(const core::GlobalState &gs, const options::Options &opts) {
+    auto &print = opts.print;
+    return opts.stopAfterPhase == options::Phase::INFERENCER && gs.semanticExtensions.empty() &&
+           gs.lspQuery.isEmpty() && !print.FlattenedTree.enabled && !print.FlattenedTreeRaw.enabled &&
+           !print.CFG.enabled && !print.CFGJson.enabled && !print.CFGProto.enabled && !print.CallGraph.enabled &&
+           !print.SlowReport.enabled;
+}
+
+// Besides a file's contents, these decide which errors typechecking it reports and which of them are silenced.
+string typecheckOptionsKey(const core::GlobalState &gs, core::FileRef file, const options::Options &opts) {
+    return fmt::format("{}//{}//{}//{}//{}//{}//{}//{}//{}/{}", (int)file.data(gs).strictLevel, opts.suggestSig,
+                       opts.suggestRuntimeProfiledType, opts.suggestSigsOnly, opts.supressNonCriticalErrors,
+                       opts.silenceErrors, absl::StrJoin(opts.errorCodeWhiteList, ","),
+                       absl::StrJoin(opts.errorCodeBlackList, ","), gs.typecheckShard, gs.typecheckShardCount);
+}
+
+string typecheckCacheKey(const core::GlobalState &gs, core::FileRef file, const options::Options &opts) {
+    return fmt::format("typecheck//{}//{}", fileKey(gs, file), typecheckOptionsKey(gs, file, opts));
+}
+
+// Typechecks `resolved`, unless a previous run already did so for the same file contents and every definition the
+// file refers to still hashes the same in `currentHashes`, in which case the errors that run reported are replayed
+// instead. On a miss, the same goes for each method of the file, and the errors are appended to `cacheEntries` for the
+// main thread to write back.
+ast::ParsedFile typecheckOneCached(core::Context ctx, ast::ParsedFile resolved, const options::Options &opts,
+                                   WorkerPool &workers, KeyValueStore &kvstore,
+                                   const core::GlobalStateHash &currentHashes,
+                                   vector<pair<string, vector<u1>>> &cacheEntries) {
+    core::FileRef file = resolved.file;
+    auto key = typecheckCacheKey(ctx, file, opts);
+    if (auto maybeCached = kvstore.read(key)) {
+        if (auto errors = core::serialize::Serializer::loadErrors(ctx, currentHashes, maybeCached)) {
+            prodCounterInc("types.input.files.typecheck_cache.hit");
+            core::ErrorRegion errs(ctx, file);
+            for (auto &error : *errors) {
+                reportAgain(ctx, *error);
+            }
+            return resolved;
+        }
+    }
+    prodCounterInc("types.input.files.typecheck_cache.miss");
+
+    // `constants` also holds the names of methods this file defines, which matter for override checks.
+    auto usedHashes = usedHashesFor(getAllNames(ctx, resolved.tree), currentHashes);
+
+    ast::ParsedFile result;
+    // Flush only once the captured errors have been handed back to the queue.
+    core::ErrorRegion errs(ctx, file);
+    vector<core::ErrorQueueMessage> captured;
+    {
+        core::ErrorQueue::CaptureErrors capture(*ctx.state.errorQueue, captured);
+        MethodCache methodCache{kvstore, currentHashes, typecheckOptionsKey(ctx, file, opts), cacheEntries};
+        result = typecheckOneWith(ctx, move(resolved), opts, &workers, nullptr, &methodCache);
+    }
+    if (auto errors = errorsToCache(captured)) {
+        prodCounterAdd("types.input.files.typecheck_cache.dropped_silenced", captured.size() - errors->size());
+        cacheEntries.emplace_back(move(key), core::serialize::Serializer::storeErrors(ctx, usedHashes, *errors));
+    }
+    ctx.state.errorQueue->pushCapturedErrors(move(captured));
+    return result;
+}
+
 struct typecheck_thread_result {
-    vector<ast::ParsedFile> trees;
+    vector<core::FileRef> files;
     CounterState counters;
+    chrono::time_point<chrono::steady_clock> finishedAt;
+    // (key, value) pairs for the main thread to write to the KeyValueStore.
+    vector<pair<string, vector<u1>>> cacheEntries;
+    // The errors reported while typechecking each file, for the main thread to hand to the error queue, so that
+    // workers don't contend on it for every error.
+    vector<pair<core::FileRef, vector<core::ErrorQueueMessage>>> errors;
 };
 
+string enterConfigatron(core::GlobalState &gs, const options::Options &opts,
+                        const unique_ptr<KeyValueStore> &kvstore) {
+#ifndef SORBET_REALMAIN_MIN
+    Timer timeit(gs.tracer(), "enterConfigatron");
+    core::UnfreezeNameTable nameTableAccess(gs);     // creates names from config
+    core::UnfreezeSymbolTable symbolTableAccess(gs); // creates methods for them
+    return namer::configatron::fillInFromFileSystem(gs, opts.configatronDirs, opts.configatronFiles, kvstore);
+#else
+    return "";
+#endif
+}
+
+string configatronDigest(const options::Options &opts) {
+#ifndef SORBET_REALMAIN_MIN
+    return namer::configatron::hashFiles(opts.configatronDirs, opts.configatronFiles);
+#else
+    return "";
+#endif
+}
+
 vector<ast::ParsedFile> name(core::GlobalState &gs, vector<ast::ParsedFile> what, const options::Options &opts,
-                             bool skipConfigatron) {
+                             WorkerPool &workers, const unique_ptr<KeyValueStore> &kvstore, bool skipConfigatron) {
     Timer timeit(gs.tracer(), "name");
     if (!skipConfigatron) {
-#ifndef SORBET_REALMAIN_MIN
-        core::UnfreezeNameTable nameTableAccess(gs);     // creates names from config
-        core::UnfreezeSymbolTable symbolTableAccess(gs); // creates methods for them
-        namer::configatron::fillInFromFileSystem(gs, opts.configatronDirs, opts.configatronFiles);
-#endif
+        enterConfigatron(gs, opts, kvstore);
     }
 
     {
         core::MutableContext ctx(gs, core::Symbols::root());
         core::UnfreezeNameTable nameTableAccess(gs);     // creates singletons and class names
         core::UnfreezeSymbolTable symbolTableAccess(gs); // enters symbols
-        what = namer::Namer::run(ctx, move(what));
+        what = namer::Namer::run(ctx, move(what), workers);
         gs.errorQueue->flushErrors();
     }
     return what;
 }
 class GatherUnresolvedConstantsWalk {
 public:
-    vector<string> unresolvedConstants;
-    unique_ptr<ast::Expression> postTransformConstantLit(core::MutableContext ctx,
-                                                         unique_ptr<ast::ConstantLit> original) {
+    // A constant is usually missing in many places, so each thread only keeps one copy of it.
+    UnorderedSet<string> unresolvedConstants;
+    unique_ptr<ast::Expression> postTransformConstantLit(core::Context ctx, unique_ptr<ast::ConstantLit> original) {
         auto unresolvedPath = original->fullUnresolvedPath(ctx);
         if (unresolvedPath.has_value()) {
-            unresolvedConstants.emplace_back(fmt::format(
+            unresolvedConstants.emplace(fmt::format(
                 "{}::{}",
                 unresolvedPath->first != core::Symbols::root() ? unresolvedPath->first.data(ctx)->show(ctx) : "",
                 fmt::map_join(unresolvedPath->second,
@@ -759,15 +1558,21 @@ public:
 };
 
 vector<ast::ParsedFile> printMissingConstants(core::GlobalState &gs, const options::Options &opts,
-                                              vector<ast::ParsedFile> what) {
+                                              vector<ast::ParsedFile> what, WorkerPool &workers) {
     Timer timeit(gs.tracer(), "printMissingConstants");
-    core::MutableContext ctx(gs, core::Symbols::root());
-    GatherUnresolvedConstantsWalk walk;
-    for (auto &resolved : what) {
-        resolved.tree = ast::TreeMap::apply(ctx, walk, move(resolved.tree));
-    }
-    fast_sort(walk.unresolvedConstants);
-    opts.print.MissingConstants.fmt("{}\n", fmt::join(walk.unresolvedConstants, "\n"));
+    core::Context ctx(gs, core::Symbols::root());
+    vector<string> unresolvedConstants;
+    what = ast::parallelTreeMap(
+        ctx, workers, move(what), "printMissingConstants", []() { return GatherUnresolvedConstantsWalk(); },
+        [&unresolvedConstants](GatherUnresolvedConstantsWalk &walk) {
+            unresolvedConstants.insert(unresolvedConstants.end(), walk.unresolvedConstants.begin(),
+                                       walk.unresolvedConstants.end());
+        });
+    // Threads can still have found the same constant.
+    fast_sort(unresolvedConstants);
+    unresolvedConstants.erase(unique(unresolvedConstants.begin(), unresolvedConstants.end()),
+                              unresolvedConstants.end());
+    opts.print.MissingConstants.fmt("{}\n", fmt::join(unresolvedConstants, "\n"));
     return what;
 }
 
@@ -821,9 +1626,10 @@ ast::ParsedFile checkNoDefinitionsInsideProhibitedLines(core::GlobalState &gs, a
 }
 
 vector<ast::ParsedFile> resolve(unique_ptr<core::GlobalState> &gs, vector<ast::ParsedFile> what,
-                                const options::Options &opts, WorkerPool &workers, bool skipConfigatron) {
+                                const options::Options &opts, WorkerPool &workers,
+                                const unique_ptr<KeyValueStore> &kvstore, bool skipConfigatron) {
     try {
-        what = name(*gs, move(what), opts, skipConfigatron);
+        what = name(*gs, move(what), opts, workers, kvstore, skipConfigatron);
 
         for (auto &named : what) {
             if (opts.print.NameTree.enabled) {
@@ -866,7 +1672,7 @@ vector<ast::ParsedFile> resolve(unique_ptr<core::GlobalState> &gs, vector<ast::P
                 auto reIndexed = indexOne(opts, *gs, f.file, kvstore);
                 vector<ast::ParsedFile> toBeReResolved;
                 toBeReResolved.emplace_back(move(reIndexed));
-                auto reresolved = pipeline::incrementalResolve(*gs, move(toBeReResolved), opts);
+                auto reresolved = pipeline::incrementalResolve(*gs, move(toBeReResolved), opts, workers);
                 ENFORCE(reresolved.size() == 1);
                 f = checkNoDefinitionsInsideProhibitedLines(*gs, move(reresolved[0]), 0, prohibitedLines);
             }
@@ -892,19 +1698,44 @@ vector<ast::ParsedFile> resolve(unique_ptr<core::GlobalState> &gs, vector<ast::P
         }
     }
     if (opts.print.MissingConstants.enabled) {
-        what = printMissingConstants(*gs, opts, move(what));
+        what = printMissingConstants(*gs, opts, move(what), workers);
     }
 
     return what;
 }
 
 vector<ast::ParsedFile> typecheck(unique_ptr<core::GlobalState> &gs, vector<ast::ParsedFile> what,
-                                  const options::Options &opts, WorkerPool &workers) {
+                                  const options::Options &opts, WorkerPool &workers,
+                                  const unique_ptr<KeyValueStore> &kvstore, const function<bool()> &isCanceled,
+                                  UnorderedMap<core::FileRef, MethodReuse> *methodReuse,
+                                  const function<unique_ptr<ast::Expression>(core::FileRef)> &loadTree) {
+    ENFORCE(methodReuse == nullptr || kvstore == nullptr);
     vector<ast::ParsedFile> typecheck_result;
 
     {
         Timer timeit(gs->tracer(), "typecheck");
 
+        // A query typechecks the files it's about whichever shard they're in, to find what it asks for.
+        if (gs->typecheckShardCount > 1 && gs->lspQuery.isEmpty()) {
+            vector<ast::ParsedFile> inShard;
+            for (auto &resolved : what) {
+                if (gs->inTypecheckShard(resolved.file)) {
+                    inShard.emplace_back(move(resolved));
+                } else {
+                    // Another process typechecks this file and reports its errors.
+                    typecheck_result.emplace_back(ast::ParsedFile{make_unique<ast::EmptyTree>(), resolved.file});
+                }
+            }
+            prodCounterAdd("types.input.files.typecheck.other_shards", what.size() - inShard.size());
+            what = move(inShard);
+        }
+
+        shared_ptr<core::GlobalStateHash> currentHashes;
+        if (kvstore && canCacheTypecheckResults(*gs, opts)) {
+            Timer timeit(gs->tracer(), "typecheck.hashGlobalState");
+            currentHashes = gs->hash();
+        }
+
         shared_ptr<ConcurrentBoundedQueue<ast::ParsedFile>> fileq;
         shared_ptr<BlockingBoundedQueue<typecheck_thread_result>> resultq;
 
@@ -915,13 +1746,30 @@ vector<ast::ParsedFile> typecheck(unique_ptr<core::GlobalState> &gs, vector<ast:
 
         core::Context ctx(*gs, core::Symbols::root());
 
-        for (auto &resolved : what) {
-            fileq->push(move(resolved), 1);
-        }
+        // Hand out the most expensive files first (longest-processing-time-first), so that a huge file doesn't get
+        // picked up at the very end while every other thread sits idle. Source size is a decent proxy for the cost
+        // of cfg+infer; RBIs are not inferred at all.
+        auto cost = [&gs](const ast::ParsedFile &pf) -> size_t {
+            auto &file = pf.file.data(*gs);
+            return file.isRBI() ? 0 : file.source().size();
+        };
+        fast_sort(what, [&cost](const auto &lhs, const auto &rhs) -> bool {
+            auto lhsCost = cost(lhs);
+            auto rhsCost = cost(rhs);
+            if (lhsCost != rhsCost) {
+                return lhsCost > rhsCost;
+            }
+            return lhs.file < rhs.file;
+        });
+
+        // Files are still claimed one at a time: the first are the most expensive, and claiming several of them at
+        // once would leave one thread with all of them.
+        fileq->push_bulk(move(what));
 
         {
-            ProgressIndicator cfgInferProgress(opts.showProgress, "CFG+Inference", what.size());
-            workers.multiplexJob("typecheck", [ctx, &opts, fileq, resultq]() {
+            ProgressIndicator cfgInferProgress(opts.showProgress, "CFG+Inference", fileq->bound);
+            workers.multiplexJob("typecheck", [ctx, &opts, fileq, resultq, &workers, &kvstore, currentHashes,
+                                               &isCanceled, methodReuse, &loadTree]() {
                 typecheck_thread_result threadResult;
                 ast::ParsedFile job;
                 int processedByThread = 0;
@@ -929,38 +1777,96 @@ vector<ast::ParsedFile> typecheck(unique_ptr<core::GlobalState> &gs, vector<ast:
                 {
                     for (auto result = fileq->try_pop(job); !result.done(); result = fileq->try_pop(job)) {
                         if (result.gotItem()) {
+                            if (!threadResult.errors.empty()) {
+                                // Hand over what has errors so far, so that they're reported while the rest of the
+                                // files are typechecked. The last result pushed also carries the counters.
+                                resultq->push(move(threadResult), processedByThread);
+                                threadResult = typecheck_thread_result();
+                                processedByThread = 0;
+                            }
                             processedByThread++;
+                            if (isCanceled && isCanceled()) {
+                                // Keep draining the queue so that `resultq` still sees every file accounted for.
+                                continue;
+                            }
                             core::FileRef file = job.file;
-                            try {
-                                threadResult.trees.emplace_back(typecheckOne(ctx, move(job), opts));
-                            } catch (SorbetException &) {
-                                Exception::failInFuzzer();
-                                ctx.state.tracer().error("Exception typing file: {} (backtrace is above)",
-                                                         file.data(ctx).path());
+                            vector<core::ErrorQueueMessage> fileErrors;
+                            {
+                                core::ErrorQueue::CaptureErrors capture(*ctx.state.errorQueue, fileErrors);
+                                try {
+                                    if (job.tree == nullptr && loadTree) {
+                                        job.tree = loadTree(file);
+                                    }
+                                    // Nothing after typechecking looks at the trees, so they are freed here, on the
+                                    // worker, as soon as each file is done, instead of all being held until the end.
+                                    if (currentHashes) {
+                                        typecheckOneCached(ctx, move(job), opts, workers, *kvstore, *currentHashes,
+                                                           threadResult.cacheEntries);
+                                    } else {
+                                        MethodReuse *reuse = nullptr;
+                                        if (methodReuse != nullptr) {
+                                            auto fnd = methodReuse->find(file);
+                                            reuse = fnd == methodReuse->end() ? nullptr : &fnd->second;
+                                        }
+                                        typecheckOne(ctx, move(job), opts, &workers, reuse);
+                                    }
+                                    threadResult.files.emplace_back(file);
+                                } catch (SorbetException &) {
+                                    Exception::failInFuzzer();
+                                    ctx.state.tracer().error("Exception typing file: {} (backtrace is above)",
+                                                             file.data(ctx).path());
+                                }
+                            }
+                            if (!fileErrors.empty()) {
+                                threadResult.errors.emplace_back(file, move(fileErrors));
                             }
                         }
                     }
                 }
                 if (processedByThread > 0) {
                     threadResult.counters = getAndClearThreadCounters();
+                    threadResult.finishedAt = chrono::steady_clock::now();
                     resultq->push(move(threadResult), processedByThread);
                 }
             });
 
             typecheck_thread_result threadResult;
+            vector<chrono::time_point<chrono::steady_clock>> threadFinishTimes;
             {
                 for (auto result = resultq->wait_pop_timed(threadResult, WorkerPool::BLOCK_INTERVAL(), gs->tracer());
                      !result.done();
                      result = resultq->wait_pop_timed(threadResult, WorkerPool::BLOCK_INTERVAL(), gs->tracer())) {
                     if (result.gotItem()) {
+                        if (threadResult.finishedAt != chrono::steady_clock::time_point()) {
+                            threadFinishTimes.emplace_back(threadResult.finishedAt);
+                        }
                         counterConsume(move(threadResult.counters));
-                        typecheck_result.insert(typecheck_result.end(), make_move_iterator(threadResult.trees.begin()),
-                                                make_move_iterator(threadResult.trees.end()));
+                        for (auto &[file, errors] : threadResult.errors) {
+                            gs->errorQueue->pushCapturedErrors(move(errors));
+                            gs->errorQueue->markFileForFlushing(file);
+                        }
+                        for (auto &[key, value] : threadResult.cacheEntries) {
+                            kvstore->write(key, value);
+                        }
+                        for (auto file : threadResult.files) {
+                            typecheck_result.emplace_back(ast::ParsedFile{make_unique<ast::EmptyTree>(), file});
+                        }
                     }
                     cfgInferProgress.reportProgress(fileq->doneEstimate());
                     gs->errorQueue->flushErrors();
                 }
             }
+
+            // Time threads spent idle between finishing their last file and the last thread finishing, i.e. how
+            // badly the tail of this phase was balanced.
+            if (!threadFinishTimes.empty()) {
+                auto lastFinish = *absl::c_max_element(threadFinishTimes);
+                unsigned long tailIdleMs = 0;
+                for (auto finishedAt : threadFinishTimes) {
+                    tailIdleMs += chrono::duration_cast<chrono::milliseconds>(lastFinish - finishedAt).count();
+                }
+                prodCounterAdd("typecheck.tail_idle_ms", tailIdleMs);
+            }
         }
 
         if (opts.print.SymbolTable.enabled) {
@@ -972,29 +1878,23 @@ vector<ast::ParsedFile> typecheck(unique_ptr<core::GlobalState> &gs, vector<ast:
 
 #ifndef SORBET_REALMAIN_MIN
         if (opts.print.SymbolTableJson.enabled) {
-            auto root = core::Proto::toProto(*gs, core::Symbols::root(), false);
-            if (opts.print.SymbolTableJson.outputPath.empty()) {
-                core::Proto::toJSON(root, cout);
-            } else {
-                stringstream buf;
-                core::Proto::toJSON(root, buf);
-                opts.print.SymbolTableJson.print(buf.str());
-            }
+            core::Proto::toJSON(*gs, core::Symbols::root(), false,
+                                [&](string_view json) { opts.print.SymbolTableJson.print(json); });
         }
         if (opts.print.SymbolTableFullJson.enabled) {
-            auto root = core::Proto::toProto(*gs, core::Symbols::root(), true);
-            if (opts.print.SymbolTableJson.outputPath.empty()) {
-                core::Proto::toJSON(root, cout);
-            } else {
-                stringstream buf;
-                core::Proto::toJSON(root, buf);
-                opts.print.SymbolTableJson.print(buf.str());
-            }
+            core::Proto::toJSON(*gs, core::Symbols::root(), true,
+                                [&](string_view json) { opts.print.SymbolTableFullJson.print(json); });
         }
 #endif
         if (opts.print.SymbolTableFull.enabled) {
             opts.print.SymbolTableFull.fmt("{}\n", gs->toStringFull());
         }
+        if (opts.print.SlowReport.enabled) {
+            opts.print.SlowReport.fmt("{}\n", SlowReport::toJSON(opts.slowReportTop));
+        }
+        if (opts.print.MemoryReport.enabled) {
+            opts.print.MemoryReport.fmt("{}", gs->memoryUsage().toString());
+        }
         if (opts.print.SymbolTableFullRaw.enabled) {
             opts.print.SymbolTableFullRaw.fmt("{}\n", gs->showRawFull());
         }
@@ -1020,69 +1920,162 @@ vector<ast::ParsedFile> typecheck(unique_ptr<core::GlobalState> &gs, vector<ast:
 
 class AllNamesCollector {
 public:
+    const core::GlobalState &gs;
     core::UsageHash acc;
-    unique_ptr<ast::Send> preTransformSend(core::Context ctx, unique_ptr<ast::Send> original) {
-        acc.sends.emplace_back(ctx.state, original->fun.data(ctx));
-        return original;
-    }
 
-    unique_ptr<ast::MethodDef> postTransformMethodDef(core::Context ctx, unique_ptr<ast::MethodDef> original) {
-        acc.constants.emplace_back(ctx.state, original->name.data(ctx.state));
-        return original;
-    }
+    AllNamesCollector(const core::GlobalState &gs) : gs(gs) {}
 
-    void handleUnresolvedConstantLit(core::Context ctx, ast::UnresolvedConstantLit *expr) {
+    void handleUnresolvedConstantLit(ast::UnresolvedConstantLit *expr) {
         while (expr) {
-            acc.constants.emplace_back(ctx.state, expr->cnst.data(ctx));
+            acc.constants.emplace_back(gs, expr->cnst.data(gs));
             // Handle references to 'Foo' in 'Foo::Bar'.
             expr = ast::cast_tree<ast::UnresolvedConstantLit>(expr->scope.get());
         }
     }
 
-    unique_ptr<ast::ClassDef> postTransformClassDef(core::Context ctx, unique_ptr<ast::ClassDef> original) {
-        acc.constants.emplace_back(ctx.state, original->symbol.data(ctx)->name.data(ctx));
-        original->name->showRaw(ctx.state);
+    void visit(ast::Expression *what) {
+        switch (what->tag) {
+            case ast::Tag::Send:
+                acc.sends.emplace_back(gs, static_cast<ast::Send *>(what)->fun.data(gs));
+                break;
+            case ast::Tag::MethodDef:
+                acc.constants.emplace_back(gs, static_cast<ast::MethodDef *>(what)->name.data(gs));
+                break;
+            case ast::Tag::ClassDef: {
+                auto *klass = static_cast<ast::ClassDef *>(what);
+                acc.constants.emplace_back(gs, klass->symbol.data(gs)->name.data(gs));
+                handleUnresolvedConstantLit(ast::cast_tree<ast::UnresolvedConstantLit>(klass->name.get()));
+
+                // Grab names of superclasses. (N.B. `include` and `extend` are captured as ConstantLits.)
+                for (auto &ancst : klass->ancestors) {
+                    handleUnresolvedConstantLit(ast::cast_tree<ast::UnresolvedConstantLit>(ancst.get()));
+                }
+                break;
+            }
+            case ast::Tag::UnresolvedConstantLit:
+                handleUnresolvedConstantLit(static_cast<ast::UnresolvedConstantLit *>(what));
+                break;
+            case ast::Tag::UnresolvedIdent: {
+                auto *id = static_cast<ast::UnresolvedIdent *>(what);
+                if (id->kind != ast::UnresolvedIdent::Local) {
+                    acc.constants.emplace_back(gs, id->name.data(gs));
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+};
+
+core::UsageHash getAllNames(const core::GlobalState &gs, unique_ptr<ast::Expression> &tree) {
+    AllNamesCollector collector(gs);
+    ast::TreeWalk::visit(tree.get(), [&](ast::Expression *what) { collector.visit(what); });
+    core::NameHash::sortAndDedupe(collector.acc.sends);
+    core::NameHash::sortAndDedupe(collector.acc.constants);
+    return move(collector.acc);
+};
 
-        handleUnresolvedConstantLit(ctx, ast::cast_tree<ast::UnresolvedConstantLit>(original->name.get()));
+// Moves out of a method body whatever the namer and resolver could enter symbols for, and drops everything else. Kept
+// expressions stay in the order they appeared in, which is the order symbols get entered in.
+class MethodBodyDefinitions {
+    ast::InsSeq::STATS_store kept;
 
-        // Grab names of superclasses. (N.B. `include` and `extend` are captured as ConstantLits.)
-        for (auto &ancst : original->ancestors) {
-            handleUnresolvedConstantLit(ctx, ast::cast_tree<ast::UnresolvedConstantLit>(ancst.get()));
+    static bool definesSymbols(ast::Expression *expr) {
+        if (ast::isa_tree<ast::MethodDef>(expr) || ast::isa_tree<ast::ClassDef>(expr)) {
+            return true;
         }
-
-        return original;
+        if (auto *id = ast::cast_tree<ast::UnresolvedIdent>(expr)) {
+            // Globals are entered wherever they are mentioned.
+            return id->kind == ast::UnresolvedIdent::Global;
+        }
+        if (auto *assign = ast::cast_tree<ast::Assign>(expr)) {
+            // `@x = T.let(...)` and `@@x = T.let(...)` declare fields.
+            auto *id = ast::cast_tree<ast::UnresolvedIdent>(assign->lhs.get());
+            return id != nullptr && id->kind != ast::UnresolvedIdent::Local;
+        }
+        if (auto *send = ast::cast_tree<ast::Send>(expr)) {
+            if (!send->recv->isSelfReference()) {
+                return false;
+            }
+            switch (send->fun._id) {
+                case core::Names::private_()._id:
+                case core::Names::privateClassMethod()._id:
+                case core::Names::protected_()._id:
+                case core::Names::public_()._id:
+                case core::Names::moduleFunction()._id:
+                case core::Names::aliasMethod()._id:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+        return false;
     }
 
-    unique_ptr<ast::UnresolvedConstantLit>
-    postTransformUnresolvedConstantLit(core::Context ctx, unique_ptr<ast::UnresolvedConstantLit> original) {
-        handleUnresolvedConstantLit(ctx, original.get());
-        return original;
+public:
+    unique_ptr<ast::Expression> preTransformExpression(core::Context ctx, unique_ptr<ast::Expression> expr) {
+        if (!definesSymbols(expr.get())) {
+            return expr;
+        }
+        kept.emplace_back(std::move(expr));
+        return ast::MK::EmptyTree();
     }
 
-    unique_ptr<ast::UnresolvedIdent> postTransformUnresolvedIdent(core::Context ctx,
-                                                                  unique_ptr<ast::UnresolvedIdent> id) {
-        if (id->kind != ast::UnresolvedIdent::Local) {
-            acc.constants.emplace_back(ctx.state, id->name.data(ctx));
+    static unique_ptr<ast::Expression> run(core::Context ctx, unique_ptr<ast::Expression> body) {
+        MethodBodyDefinitions collector;
+        auto loc = body->loc;
+        ast::TreeMap::apply(ctx, collector, std::move(body));
+        if (collector.kept.empty()) {
+            return ast::MK::EmptyTree();
         }
-        return id;
+        auto last = std::move(collector.kept.back());
+        collector.kept.pop_back();
+        return ast::MK::InsSeq(loc, std::move(collector.kept), std::move(last));
     }
 };
 
-core::UsageHash getAllNames(const core::GlobalState &gs, unique_ptr<ast::Expression> &tree) {
-    AllNamesCollector collector;
-    tree = ast::TreeMap::apply(core::Context(gs, core::Symbols::root()), collector, move(tree));
-    core::NameHash::sortAndDedupe(collector.acc.sends);
-    core::NameHash::sortAndDedupe(collector.acc.constants);
-    return move(collector.acc);
+// `GlobalState::hash` only looks at symbols, and all that method bodies contribute to those are the few kinds of
+// expressions MethodBodyDefinitions keeps. Dropping the rest of them before naming and resolving a file just to hash it
+// saves most of the work, since that's where most of the code is.
+class DefinitionsOnly {
+public:
+    unique_ptr<ast::MethodDef> preTransformMethodDef(core::Context ctx, unique_ptr<ast::MethodDef> original) {
+        original->rhs = MethodBodyDefinitions::run(ctx, move(original->rhs));
+        return original;
+    }
 };
 
+unique_ptr<ast::Expression> keepOnlyDefinitions(const core::GlobalState &gs, unique_ptr<ast::Expression> tree) {
+    DefinitionsOnly definitionsOnly;
+    return ast::TreeMap::apply(core::Context(gs, core::Symbols::root()), definitionsOnly, move(tree));
+}
+
+namespace {
+// What hashing a file starts from on this thread: an empty global state, and a pool to resolve with on this thread
+// alone. Copying the state is much cheaper than making it again with `initEmpty`, which hashing every file would do.
+struct HashingBase {
+    shared_ptr<spdlog::logger> logger;
+    unique_ptr<core::GlobalState> gs;
+    unique_ptr<WorkerPool> workers;
+
+    HashingBase() {
+        logger = make_shared<spdlog::logger>("hashing", make_shared<spdlog::sinks::null_sink_mt>());
+        gs = make_unique<core::GlobalState>(make_shared<core::ErrorQueue>(*logger, *logger));
+        gs->initEmpty();
+        gs->silenceErrors = true;
+        workers = WorkerPool::create(0, *logger);
+    }
+};
+} // namespace
+
 core::FileHash computeFileHash(shared_ptr<core::File> forWhat, spdlog::logger &logger) {
     Timer timeit(logger, "computeFileHash");
     const static options::Options emptyOpts{};
-    unique_ptr<core::GlobalState> lgs = make_unique<core::GlobalState>((make_shared<core::ErrorQueue>(logger, logger)));
-    lgs->initEmpty();
+    thread_local HashingBase base;
+    unique_ptr<core::GlobalState> lgs = base.gs->deepCopy();
+    lgs->errorQueue = make_shared<core::ErrorQueue>(logger, logger);
     lgs->errorQueue->ignoreFlushes = true;
-    lgs->silenceErrors = true;
     core::FileRef fref;
     {
         core::UnfreezeFileTable fileTableAccess(*lgs);
@@ -1095,17 +2088,181 @@ core::FileHash computeFileHash(shared_ptr<core::File> forWhat, spdlog::logger &l
     single.emplace_back(pipeline::indexOne(emptyOpts, *lgs, fref, kvstore));
     auto errs = lgs->errorQueue->drainAllErrors();
     for (auto &e : errs) {
-        if (e->what == core::errors::Parser::ParserError) {
+        if (e->what == core::errors::Parser::ParserError || e->what == core::errors::Parser::InvalidUTF8) {
             core::GlobalStateHash invalid;
             invalid.hierarchyHash = core::GlobalStateHash::HASH_STATE_INVALID;
             return {move(invalid), {}};
         }
     }
     auto allNames = getAllNames(*lgs, single[0].tree);
-    auto workers = WorkerPool::create(0, lgs->tracer());
-    pipeline::resolve(lgs, move(single), emptyOpts, *workers, true);
+    single[0].tree = keepOnlyDefinitions(*lgs, move(single[0].tree));
+    unique_ptr<KeyValueStore> noKvstore;
+    pipeline::resolve(lgs, move(single), emptyOpts, *base.workers, noKvstore, true);
 
     return {move(*lgs->hash()), move(allNames)};
 }
 
+vector<core::FileHash> computeFileHashes(const vector<shared_ptr<core::File>> &files, spdlog::logger &logger,
+                                         WorkerPool &workers, const unique_ptr<KeyValueStore> &kvstore) {
+    Timer timeit(logger, "computeFileHashes");
+    vector<core::FileHash> res(files.size());
+    // Hashes that weren't cached. Written from this thread once the workers are done, as only it may write.
+    vector<pair<string, vector<u1>>> entries(files.size());
+
+    // One task per file, so that a single huge file doesn't leave the other workers idle at the end.
+    WorkerPool::TaskGroup group;
+    for (int i = 0; i < files.size(); i++) {
+        if (!files[i]) {
+            continue;
+        }
+        workers.submit(group, [&res, &entries, &files, &logger, &kvstore, i]() {
+            if (!kvstore) {
+                res[i] = computeFileHash(files[i], logger);
+                return;
+            }
+            // Hashing only looks at the file itself, so its path and contents determine the result.
+            auto key = "filehash//" + fileKey(*files[i]);
+            if (auto maybeCached = kvstore->read(key)) {
+                prodCounterInc("types.input.filehash.kvstore.hit");
+                res[i] = core::serialize::Serializer::loadFileHash(maybeCached, logger);
+                return;
+            }
+            prodCounterInc("types.input.filehash.kvstore.miss");
+            res[i] = computeFileHash(files[i], logger);
+            entries[i] = {move(key), core::serialize::Serializer::storeFileHash(res[i])};
+        });
+    }
+    workers.wait(group);
+
+    if (kvstore) {
+        for (auto &[key, value] : entries) {
+            if (!key.empty()) {
+                kvstore->write(key, value);
+            }
+        }
+    }
+    return res;
+}
+
+namespace {
+// `affectedFiles`, given the hashes of `files` and of the previous versions of the ones at the indexes in `changed`
+// (sorted), or nullopt for the ones that are new.
+vector<int> affectedFilesByHash(const vector<shared_ptr<core::File>> &files, const vector<core::FileHash> &hashes,
+                                const vector<int> &changed, const vector<optional<core::FileHash>> &oldHashes,
+                                spdlog::logger &logger) {
+    vector<int> all(files.size());
+    iota(all.begin(), all.end(), 0);
+    vector<core::NameHash> changedHashes;
+    vector<core::NameHash> addedHashes;
+    for (auto i : changed) {
+        if (!oldHashes[i].has_value()) {
+            logger.debug("Every file is affected because {} is a new file", files[i]->path());
+            return all;
+        }
+        auto &newHash = hashes[i].definitions;
+        auto &oldHash = oldHashes[i]->definitions;
+        if (newHash.hierarchyHash != core::GlobalStateHash::HASH_STATE_INVALID &&
+            newHash.hierarchyHash != oldHash.hierarchyHash &&
+            newHash.classHierarchyHash != oldHash.classHierarchyHash) {
+            logger.debug("Every file is affected because {} has changed definitions", files[i]->path());
+            return all;
+        }
+        for (auto &[name, methodHash] : newHash.methodHashes) {
+            auto fnd = oldHash.methodHashes.find(name);
+            if (fnd == oldHash.methodHashes.end()) {
+                changedHashes.emplace_back(name);
+                addedHashes.emplace_back(name);
+            } else if (fnd->second != methodHash) {
+                changedHashes.emplace_back(name);
+            }
+        }
+        // Methods that were removed or reshaped, which may no longer be overrides or have other callers' arguments.
+        for (auto &[name, shapeHash] : oldHash.methodShapeHashes) {
+            auto fnd = newHash.methodShapeHashes.find(name);
+            if (fnd == newHash.methodShapeHashes.end() || fnd->second != shapeHash) {
+                changedHashes.emplace_back(name);
+                addedHashes.emplace_back(name);
+            }
+        }
+    }
+    core::NameHash::sortAndDedupe(changedHashes);
+    core::NameHash::sortAndDedupe(addedHashes);
+
+    auto usesAny = [](const vector<core::NameHash> &usages, const vector<core::NameHash> &names) {
+        return absl::c_any_of(usages, [&](const auto &name) { return absl::c_binary_search(names, name); });
+    };
+    vector<int> result;
+    for (int i = 0; i < files.size(); i++) {
+        // `usages.constants` includes the names of methods the file defines.
+        if (absl::c_binary_search(changed, i) || usesAny(hashes[i].usages.sends, changedHashes) ||
+            usesAny(hashes[i].usages.constants, addedHashes)) {
+            result.emplace_back(i);
+        }
+    }
+    return result;
+}
+
+string lastRunKey(const core::File &file) {
+    return "lastrun//" + string(file.path());
+}
+} // namespace
+
+vector<int> affectedFiles(const vector<shared_ptr<core::File>> &files, const vector<shared_ptr<core::File>> &oldFiles,
+                          spdlog::logger &logger, WorkerPool &workers, const unique_ptr<KeyValueStore> &kvstore) {
+    Timer timeit(logger, "affectedFiles");
+    ENFORCE(files.size() == oldFiles.size());
+    vector<int> changed;
+    vector<shared_ptr<core::File>> changedOldFiles(files.size());
+    for (int i = 0; i < files.size(); i++) {
+        if (!oldFiles[i] || oldFiles[i]->source() != files[i]->source()) {
+            changed.emplace_back(i);
+            changedOldFiles[i] = oldFiles[i];
+        }
+    }
+    if (changed.empty()) {
+        return changed;
+    }
+    auto hashes = computeFileHashes(files, logger, workers, kvstore);
+    auto computedOldHashes = computeFileHashes(changedOldFiles, logger, workers, kvstore);
+    vector<optional<core::FileHash>> oldHashes(files.size());
+    for (auto i : changed) {
+        if (oldFiles[i]) {
+            oldHashes[i] = move(computedOldHashes[i]);
+        }
+    }
+    return affectedFilesByHash(files, hashes, changed, oldHashes, logger);
+}
+
+vector<int> affectedFilesSinceLastRun(const vector<shared_ptr<core::File>> &files, const vector<string> &changedPaths,
+                                      spdlog::logger &logger, WorkerPool &workers,
+                                      const unique_ptr<KeyValueStore> &kvstore) {
+    Timer timeit(logger, "affectedFilesSinceLastRun");
+    ENFORCE(kvstore);
+    auto hashes = computeFileHashes(files, logger, workers, kvstore);
+    vector<int> changed;
+    vector<optional<core::FileHash>> oldHashes(files.size());
+    for (int i = 0; i < files.size(); i++) {
+        if (!absl::c_linear_search(changedPaths, files[i]->path())) {
+            continue;
+        }
+        changed.emplace_back(i);
+        // The hash of the version the last run recorded, if it's still cached.
+        if (auto lastFileKey = kvstore->read(lastRunKey(*files[i]))) {
+            if (auto oldHash = kvstore->read(absl::StrCat("filehash//", (const char *)lastFileKey))) {
+                oldHashes[i] = core::serialize::Serializer::loadFileHash(oldHash, logger);
+            }
+        }
+    }
+    return affectedFilesByHash(files, hashes, changed, oldHashes, logger);
+}
+
+void recordLastRun(const vector<shared_ptr<core::File>> &files, KeyValueStore &kvstore) {
+    for (auto &file : files) {
+        auto key = fileKey(*file);
+        vector<u1> value(key.begin(), key.end());
+        value.emplace_back(0);
+        kvstore.write(lastRunKey(*file), value);
+    }
+}
+
 } // namespace sorbet::realmain::pipeline
@@ -5,6 +5,7 @@
 #include "common/common.h"
 #include "common/concurrency/WorkerPool.h"
 #include "common/kvstore/KeyValueStore.h"
+#include "core/Error.h"
 #include "core/NameHash.h"
 #include "main/options/options.h"
 
@@ -14,7 +15,8 @@ ast::ParsedFile indexOne(const options::Options &opts, core::GlobalState &lgs, c
 
 std::pair<ast::ParsedFile, std::vector<std::shared_ptr<core::File>>>
 indexOneWithPlugins(const options::Options &opts, core::GlobalState &lgs, core::FileRef file,
-                    std::unique_ptr<KeyValueStore> &kvstore);
+                    std::unique_ptr<KeyValueStore> &kvstore,
+                    std::vector<std::pair<std::string, std::string>> &pluginOutputsToCache);
 
 std::vector<core::FileRef> reserveFiles(std::unique_ptr<core::GlobalState> &gs, const std::vector<std::string> &files);
 
@@ -22,22 +24,111 @@ std::vector<ast::ParsedFile> index(std::unique_ptr<core::GlobalState> &gs, std::
                                    const options::Options &opts, WorkerPool &workers,
                                    std::unique_ptr<KeyValueStore> &kvstore);
 
+// `kvstore` is passed on to `name`.
 std::vector<ast::ParsedFile> resolve(std::unique_ptr<core::GlobalState> &gs, std::vector<ast::ParsedFile> what,
-                                     const options::Options &opts, WorkerPool &workers, bool skipConfigatron = false);
+                                     const options::Options &opts, WorkerPool &workers,
+                                     const std::unique_ptr<KeyValueStore> &kvstore, bool skipConfigatron = false);
 
 std::vector<ast::ParsedFile> incrementalResolve(core::GlobalState &gs, std::vector<ast::ParsedFile> what,
-                                                const options::Options &opts);
+                                                const options::Options &opts, WorkerPool &workers);
 
+// Unless `skipConfigatron`, first enters configatron like `enterConfigatron`.
 std::vector<ast::ParsedFile> name(core::GlobalState &gs, std::vector<ast::ParsedFile> what,
-                                  const options::Options &opts, bool skipConfigatron = false);
+                                  const options::Options &opts, WorkerPool &workers,
+                                  const std::unique_ptr<KeyValueStore> &kvstore, bool skipConfigatron = false);
 
-std::vector<ast::ParsedFile> typecheck(std::unique_ptr<core::GlobalState> &gs, std::vector<ast::ParsedFile> what,
-                                       const options::Options &opts, WorkerPool &workers);
+// Enters the configatron methods described by the files `opts` names. If `kvstore` is given, what was parsed from them
+// is cached in it until they change. Returns `configatronDigest(opts)`.
+std::string enterConfigatron(core::GlobalState &gs, const options::Options &opts,
+                             const std::unique_ptr<KeyValueStore> &kvstore);
 
-ast::ParsedFile typecheckOne(core::Context ctx, ast::ParsedFile resolved, const options::Options &opts);
+// A digest of the configatron files `opts` names, which changes whenever what `enterConfigatron` enters does.
+std::string configatronDigest(const options::Options &opts);
+
+// The errors that typechecking each method of a file reported.
+struct TypecheckedMethods {
+    struct Method {
+        // The part of the file the method's definition spans.
+        u4 begin;
+        u4 end;
+        std::vector<std::unique_ptr<core::Error>> errors;
+    };
+    // Sorted by `begin`, then `end`.
+    std::vector<Method> methods;
+};
+
+// Lets typechecking a file after an edit that changed no definitions skip the methods the edit didn't touch, reporting
+// the errors they reported before instead.
+struct MethodReuse {
+    // What typechecking the file before the edit recorded, if anything.
+    const TypecheckedMethods *before = nullptr;
+    // The edit replaced `[editBegin, editOldEnd)` of the old contents with `[editBegin, editNewEnd)` of the new ones.
+    u4 editBegin = 0;
+    u4 editOldEnd = 0;
+    u4 editNewEnd = 0;
+    // What typechecking the file recorded, for the next edit.
+    TypecheckedMethods after;
+};
+
+// If `kvstore` is given, errors reported for files whose contents and dependencies haven't changed since they were
+// last typechecked with it are replayed from it instead of running cfg+infer again.
+//
+// Each file's tree is freed as soon as it has been typechecked; the trees returned are empty, and only say which files
+// were typechecked.
+//
+// If `isCanceled` is given, it is polled before each file. Once it returns `true`, the remaining files are skipped and
+// only the files typechecked so far are returned.
+//
+// If `methodReuse` is given, files it has an entry for are typechecked with that entry, see `typecheckOne`. It must
+// not be combined with `kvstore`.
+//
+// If `loadTree` is given, files in `what` may come without a tree, and `loadTree` is called for their tree by the
+// thread that typechecks them, right before it does.
+std::vector<ast::ParsedFile>
+typecheck(std::unique_ptr<core::GlobalState> &gs, std::vector<ast::ParsedFile> what, const options::Options &opts,
+          WorkerPool &workers, const std::unique_ptr<KeyValueStore> &kvstore,
+          const std::function<bool()> &isCanceled = nullptr,
+          UnorderedMap<core::FileRef, MethodReuse> *methodReuse = nullptr,
+          const std::function<std::unique_ptr<ast::Expression>(core::FileRef)> &loadTree = nullptr);
+
+// If `workers` is given, files with at least `opts.parallelMethodThreshold` methods have their methods typechecked in
+// parallel on it.
+//
+// If `reuse` is given, the errors each method reports are recorded in `reuse->after`, and methods that `reuse->before`
+// has a record of and that lie outside of the edit aren't typechecked again.
+ast::ParsedFile typecheckOne(core::Context ctx, ast::ParsedFile resolved, const options::Options &opts,
+                             WorkerPool *workers = nullptr, MethodReuse *reuse = nullptr);
 
 core::FileHash computeFileHash(std::shared_ptr<core::File> forWhat, spdlog::logger &logger);
 
+// Runs `computeFileHash` on every non-null file in `files`, in parallel on `workers`. If `kvstore` is given, hashes of
+// files it has seen with the same path and contents are read from it instead, and the others are written to it. The
+// caller commits them.
+std::vector<core::FileHash> computeFileHashes(const std::vector<std::shared_ptr<core::File>> &files,
+                                              spdlog::logger &logger, WorkerPool &workers,
+                                              const std::unique_ptr<KeyValueStore> &kvstore);
+
+// The indexes of the files in `files` whose typecheck may be affected by changing them from `oldFiles`, which holds
+// the previous version of each file at the same index, or null if it is new. Like LSP's fast path, these are the files
+// that changed and the files that use a method they changed, added or removed; all of them if a change went beyond
+// methods. Only needs the hashes of the files, see `computeFileHashes`.
+std::vector<int> affectedFiles(const std::vector<std::shared_ptr<core::File>> &files,
+                               const std::vector<std::shared_ptr<core::File>> &oldFiles, spdlog::logger &logger,
+                               WorkerPool &workers, const std::unique_ptr<KeyValueStore> &kvstore);
+
+// `affectedFiles`, for the files in `files` whose paths are in `changedPaths` having changed from the versions
+// `recordLastRun` last recorded in `kvstore`. A changed file it has no version of counts as new.
+std::vector<int> affectedFilesSinceLastRun(const std::vector<std::shared_ptr<core::File>> &files,
+                                           const std::vector<std::string> &changedPaths, spdlog::logger &logger,
+                                           WorkerPool &workers, const std::unique_ptr<KeyValueStore> &kvstore);
+
+// Records `files` as the versions the next `affectedFilesSinceLastRun` compares against. Their hashes must be cached
+// in `kvstore` already.
+void recordLastRun(const std::vector<std::shared_ptr<core::File>> &files, KeyValueStore &kvstore);
+
+// The key under which what was derived from `file` alone is cached: its path and a hash of its contents.
+std::string fileKey(const core::GlobalState &gs, core::FileRef file);
+
 core::StrictLevel decideStrictLevel(const core::GlobalState &gs, const core::FileRef file,
                                     const options::Options &opts);
 
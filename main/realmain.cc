@@ -13,15 +13,20 @@
 #include "main/lsp/lsp.h"
 #endif
 
+#include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "common/FileOps.h"
 #include "common/Timer.h"
+#include "common/crypto_hashing/crypto_hashing.h"
+#include "common/os/os.h"
 #include "core/Error.h"
 #include "core/Files.h"
 #include "core/Unfreeze.h"
 #include "core/errors/errors.h"
 #include "core/lsp/QueryResponse.h"
 #include "core/serialize/serialize.h"
+#include "main/pipeline/SlowReport.h"
 #include "main/pipeline/pipeline.h"
 #include "main/realmain.h"
 #include "payload/payload.h"
@@ -32,6 +37,10 @@
 
 #include <csignal>
 #include <poll.h>
+#include <random>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 namespace spd = spdlog;
 
@@ -173,59 +182,212 @@ struct AutogenResult {
     CounterState counters;
     vector<pair<int, Serialized>> prints;
     unique_ptr<autogen::DefTree> defTree = make_unique<autogen::DefTree>();
+    // Freshly generated outputs to write back to the cache, which only the main thread may do.
+    vector<pair<string, string>> cacheEntries;
 };
 
+// A file's autogen outputs depend on its own contents, on the options below, and on how its constants resolve, which
+// the class hierarchy hash covers. The autoloader is left out: it needs every file's full autogen::ParsedFile.
+string autogenCacheKeyPrefix(core::Context ctx, const options::Options &opts) {
+    auto &print = opts.print;
+    return fmt::format("autogen//{}//{}{}{}{}//{}//{}//{}//", opts.autogenVersion, print.Autogen.enabled,
+                       print.AutogenMsgPack.enabled, print.AutogenClasslist.enabled, print.AutogenSubclasses.enabled,
+                       absl::StrJoin(opts.autogenSubclassesAbsoluteIgnorePatterns, ","),
+                       absl::StrJoin(opts.autogenSubclassesRelativeIgnorePatterns, ","),
+                       ctx.state.hash()->classHierarchyHash);
+}
+
+void appendCachedU4(string &out, u4 value) {
+    out.append((const char *)&value, sizeof(value));
+}
+
+void appendCachedString(string &out, string_view str) {
+    appendCachedU4(out, str.size());
+    out.append(str);
+}
+
+bool readCachedU4(string_view &in, u4 &value) {
+    if (in.size() < sizeof(value)) {
+        return false;
+    }
+    memcpy(&value, in.data(), sizeof(value));
+    in.remove_prefix(sizeof(value));
+    return true;
+}
+
+bool readCachedString(string_view &in, string &str) {
+    u4 size;
+    if (!readCachedU4(in, size) || in.size() < size) {
+        return false;
+    }
+    str = string(in.substr(0, size));
+    in.remove_prefix(size);
+    return true;
+}
+
+string storeAutogenOutputs(const AutogenResult::Serialized &serialized) {
+    string out;
+    appendCachedString(out, serialized.strval);
+    appendCachedString(out, serialized.msgpack);
+    appendCachedU4(out, serialized.classlist.size());
+    for (auto &klass : serialized.classlist) {
+        appendCachedString(out, klass);
+    }
+    appendCachedU4(out, serialized.subclasses.has_value());
+    if (serialized.subclasses) {
+        appendCachedU4(out, serialized.subclasses->size());
+        for (auto &[parentName, children] : *serialized.subclasses) {
+            appendCachedString(out, parentName);
+            appendCachedU4(out, children.size());
+            for (auto &[childName, type] : children) {
+                appendCachedString(out, childName);
+                appendCachedU4(out, type);
+            }
+        }
+    }
+    return out;
+}
+
+// Returns nullopt if `in` is not something `storeAutogenOutputs` wrote.
+optional<AutogenResult::Serialized> loadAutogenOutputs(string_view in) {
+    AutogenResult::Serialized serialized;
+    u4 count;
+    if (!readCachedString(in, serialized.strval) || !readCachedString(in, serialized.msgpack) ||
+        !readCachedU4(in, count)) {
+        return nullopt;
+    }
+    for (; count > 0; count--) {
+        if (!readCachedString(in, serialized.classlist.emplace_back())) {
+            return nullopt;
+        }
+    }
+    u4 hasSubclasses;
+    if (!readCachedU4(in, hasSubclasses)) {
+        return nullopt;
+    }
+    if (hasSubclasses != 0) {
+        auto &subclasses = serialized.subclasses.emplace();
+        if (!readCachedU4(in, count)) {
+            return nullopt;
+        }
+        for (; count > 0; count--) {
+            string parentName;
+            u4 childCount;
+            if (!readCachedString(in, parentName) || !readCachedU4(in, childCount)) {
+                return nullopt;
+            }
+            auto &children = subclasses[parentName];
+            for (; childCount > 0; childCount--) {
+                string childName;
+                u4 type;
+                if (!readCachedString(in, childName) || !readCachedU4(in, type)) {
+                    return nullopt;
+                }
+                children.emplace(move(childName), (autogen::Definition::Type)type);
+            }
+        }
+    }
+    if (!in.empty()) {
+        return nullopt;
+    }
+    return serialized;
+}
+
+// Most files take autogen little time, so workers claim a few at once rather than contending on the queue for each.
+constexpr size_t AUTOGEN_CHUNK_SIZE = 8;
+
+// If `kvstore` is given, the outputs of files that haven't changed since it last saw them are read from it instead of
+// generated again, unless the autoloader is being written.
 void runAutogen(core::Context ctx, options::Options &opts, const autogen::AutoloaderConfig &autoloaderCfg,
-                WorkerPool &workers, vector<ast::ParsedFile> &indexed) {
+                WorkerPool &workers, vector<ast::ParsedFile> &indexed, KeyValueStore *kvstore) {
     Timer timeit(logger, "autogen");
+    if (opts.print.AutogenAutoloader.enabled) {
+        kvstore = nullptr;
+    }
+    const string cacheKeyPrefix = kvstore != nullptr ? autogenCacheKeyPrefix(ctx, opts) : "";
 
     auto resultq = make_shared<BlockingBoundedQueue<AutogenResult>>(indexed.size());
     auto fileq = make_shared<ConcurrentBoundedQueue<int>>(indexed.size());
+    // Files that produce no outputs. Computed up front since workers move the trees around.
+    vector<bool> skipped(indexed.size());
+    vector<int> idxs(indexed.size());
     for (int i = 0; i < indexed.size(); ++i) {
-        fileq->push(move(i), 1);
+        skipped[i] = indexed[i].file.data(ctx).isRBI();
+        idxs[i] = i;
     }
+    fileq->push_bulk(move(idxs));
+    // Unless the autoloader needs each thread's whole DefTree, workers hand over every file's outputs as soon as they
+    // are done, so that they can be printed in order without holding on to all of them at once.
+    const bool streamResults = !opts.print.AutogenAutoloader.enabled;
 
-    workers.multiplexJob("runAutogen", [&ctx, &opts, &indexed, &autoloaderCfg, fileq, resultq]() {
+    workers.multiplexJob("runAutogen", [&ctx, &opts, &indexed, &autoloaderCfg, kvstore, &cacheKeyPrefix, &skipped,
+                                        streamResults, fileq, resultq]() {
         AutogenResult out;
         int n = 0;
         {
             Timer timeit(logger, "autogenWorker");
-            int idx = 0;
-
-            for (auto result = fileq->try_pop(idx); !result.done(); result = fileq->try_pop(idx)) {
-                ++n;
-                auto &tree = indexed[idx];
-                if (tree.file.data(ctx).isRBI()) {
-                    continue;
-                }
-                auto pf = autogen::Autogen::generate(ctx, move(tree));
-                tree = move(pf.tree);
-
-                AutogenResult::Serialized serialized;
-                if (opts.print.Autogen.enabled) {
-                    Timer timeit(logger, "autogenToString");
-                    serialized.strval = pf.toString(ctx);
-                }
-                if (opts.print.AutogenMsgPack.enabled) {
-                    Timer timeit(logger, "autogenToMsgpack");
-                    serialized.msgpack = pf.toMsgpack(ctx, opts.autogenVersion);
+            vector<int> jobs;
+
+            for (auto result = fileq->try_pop_bulk(jobs, fileq->chunkSize(AUTOGEN_CHUNK_SIZE)); !result.done();
+                 result = fileq->try_pop_bulk(jobs, fileq->chunkSize(AUTOGEN_CHUNK_SIZE))) {
+                for (int idx : jobs) {
+                    if (streamResults && !out.prints.empty()) {
+                        // Pushed only once there is another file, so that the last push, with the counters, always
+                        // accounts for at least one file and is never mistaken for the end of the queue.
+                        resultq->push(move(out), n);
+                        out = AutogenResult();
+                        n = 0;
+                    }
+                    ++n;
+                    auto &tree = indexed[idx];
+                    if (skipped[idx]) {
+                        continue;
+                    }
+                    string cacheKey;
+                    if (kvstore != nullptr) {
+                        cacheKey = cacheKeyPrefix + pipeline::fileKey(ctx, tree.file);
+                        auto cached = kvstore->readString(cacheKey);
+                        if (cached.data() != nullptr) {
+                            if (auto serialized = loadAutogenOutputs(cached)) {
+                                prodCounterInc("autogen.cache.hit");
+                                out.prints.emplace_back(make_pair(idx, move(*serialized)));
+                                continue;
+                            }
+                        }
+                        prodCounterInc("autogen.cache.miss");
+                    }
+                    auto pf = autogen::Autogen::generate(ctx, move(tree));
+                    tree = move(pf.tree);
+
+                    AutogenResult::Serialized serialized;
+                    if (opts.print.Autogen.enabled) {
+                        Timer timeit(logger, "autogenToString");
+                        serialized.strval = pf.toString(ctx);
+                    }
+                    if (opts.print.AutogenMsgPack.enabled) {
+                        Timer timeit(logger, "autogenToMsgpack");
+                        serialized.msgpack = pf.toMsgpack(ctx, opts.autogenVersion);
+                    }
+                    if (opts.print.AutogenClasslist.enabled) {
+                        Timer timeit(logger, "autogenClasslist");
+                        serialized.classlist = pf.listAllClasses(ctx);
+                    }
+                    if (opts.print.AutogenSubclasses.enabled) {
+                        Timer timeit(logger, "autogenSubclasses");
+                        serialized.subclasses = autogen::Subclasses::listAllSubclasses(
+                            ctx, pf, opts.autogenSubclassesAbsoluteIgnorePatterns,
+                            opts.autogenSubclassesRelativeIgnorePatterns);
+                    }
+                    if (opts.print.AutogenAutoloader.enabled) {
+                        Timer timeit(logger, "autogenNamedDefs");
+                        autogen::DefTreeBuilder::addParsedFileDefinitions(ctx, autoloaderCfg, out.defTree, pf);
+                    }
+
+                    if (kvstore != nullptr) {
+                        out.cacheEntries.emplace_back(move(cacheKey), storeAutogenOutputs(serialized));
+                    }
+                    out.prints.emplace_back(make_pair(idx, move(serialized)));
                 }
-                if (opts.print.AutogenClasslist.enabled) {
-                    Timer timeit(logger, "autogenClasslist");
-                    serialized.classlist = pf.listAllClasses(ctx);
-                }
-                if (opts.print.AutogenSubclasses.enabled) {
-                    Timer timeit(logger, "autogenSubclasses");
-                    serialized.subclasses =
-                        autogen::Subclasses::listAllSubclasses(ctx, pf, opts.autogenSubclassesAbsoluteIgnorePatterns,
-                                                               opts.autogenSubclassesRelativeIgnorePatterns);
-                }
-                if (opts.print.AutogenAutoloader.enabled) {
-                    Timer timeit(logger, "autogenNamedDefs");
-                    autogen::DefTreeBuilder::addParsedFileDefinitions(ctx, autoloaderCfg, out.defTree, pf);
-                }
-
-                out.prints.emplace_back(make_pair(idx, serialized));
             }
         }
 
@@ -233,39 +395,64 @@ void runAutogen(core::Context ctx, options::Options &opts, const autogen::Autolo
         resultq->push(move(out), n);
     });
 
-    autogen::DefTree root;
+    vector<autogen::DefTree> defTrees;
     AutogenResult out;
+    // In file order. The printed outputs are dropped once printed; the rest are merged below.
     vector<pair<int, AutogenResult::Serialized>> merged;
+    // Outputs of files that finished before some file preceding them.
+    UnorderedMap<int, AutogenResult::Serialized> pending;
+    int nextToPrint = 0;
     for (auto res = resultq->wait_pop_timed(out, chrono::seconds{1}, *logger); !res.done();
          res = resultq->wait_pop_timed(out, chrono::seconds{1}, *logger)) {
         if (!res.gotItem()) {
             continue;
         }
         counterConsume(move(out.counters));
-        merged.insert(merged.end(), make_move_iterator(out.prints.begin()), make_move_iterator(out.prints.end()));
-        if (opts.print.AutogenAutoloader.enabled) {
-            Timer timeit(logger, "autogenAutoloaderDefTreeMerge");
-            root = autogen::DefTreeBuilder::merge(ctx, move(root), move(*out.defTree));
+        for (auto &[key, value] : out.cacheEntries) {
+            kvstore->writeString(key, value);
         }
-    }
-    fast_sort(merged, [](const auto &lhs, const auto &rhs) -> bool { return lhs.first < rhs.first; });
-
-    for (auto &elem : merged) {
-        if (opts.print.Autogen.enabled) {
-            opts.print.Autogen.print(elem.second.strval);
+        for (auto &[idx, serialized] : out.prints) {
+            pending.emplace(idx, move(serialized));
+        }
+        for (; nextToPrint < indexed.size(); nextToPrint++) {
+            if (skipped[nextToPrint]) {
+                continue;
+            }
+            auto fnd = pending.find(nextToPrint);
+            if (fnd == pending.end()) {
+                break;
+            }
+            auto &serialized = fnd->second;
+            if (opts.print.Autogen.enabled) {
+                opts.print.Autogen.print(serialized.strval);
+                string().swap(serialized.strval);
+            }
+            if (opts.print.AutogenMsgPack.enabled) {
+                opts.print.AutogenMsgPack.print(serialized.msgpack);
+                string().swap(serialized.msgpack);
+            }
+            merged.emplace_back(nextToPrint, move(serialized));
+            pending.erase(fnd);
         }
-        if (opts.print.AutogenMsgPack.enabled) {
-            opts.print.AutogenMsgPack.print(elem.second.msgpack);
+        if (opts.print.AutogenAutoloader.enabled) {
+            defTrees.emplace_back(move(*out.defTree));
         }
     }
+    ENFORCE(pending.empty());
     if (opts.print.AutogenAutoloader.enabled) {
+        autogen::DefTree root;
+        {
+            Timer timeit(logger, "autogenAutoloaderDefTreeMerge");
+            root = autogen::DefTreeBuilder::merge(ctx, workers, move(defTrees));
+        }
         {
             Timer timeit(logger, "autogenAutoloaderPrune");
-            autogen::DefTreeBuilder::collapseSameFileDefs(ctx, autoloaderCfg, root);
+            autogen::DefTreeBuilder::collapseSameFileDefs(ctx, autoloaderCfg, workers, root);
         }
         {
             Timer timeit(logger, "autogenAutoloaderWrite");
-            autogen::AutoloadWriter::writeAutoloads(ctx, autoloaderCfg, opts.print.AutogenAutoloader.outputPath, root);
+            autogen::AutoloadWriter::writeAutoloads(ctx, autoloaderCfg, workers,
+                                                    opts.print.AutogenAutoloader.outputPath, root);
         }
     }
 
@@ -305,6 +492,98 @@ void runAutogen(core::Context ctx, options::Options &opts, const autogen::Autolo
             "{}\n", fmt::join(serializedDescendantsMap.begin(), serializedDescendantsMap.end(), "\n"));
     }
 }
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+// The socket is set to SO_NOSIGPIPE instead.
+constexpr int SEND_FLAGS = 0;
+#endif
+
+// Writes to a socket, without raising SIGPIPE once the peer has gone away.
+class SocketOutputBuf final : public streambuf {
+    const int fd;
+    bool failed = false;
+
+protected:
+    streamsize xsputn(const char *data, streamsize size) override {
+        streamsize written = 0;
+        while (!failed && written < size) {
+            auto result = send(fd, data + written, size - written, SEND_FLAGS);
+            if (result < 0 && errno != EINTR) {
+                failed = true;
+            } else if (result > 0) {
+                written += result;
+            }
+        }
+        return written;
+    }
+
+    int_type overflow(int_type ch) override {
+        if (ch == traits_type::eof()) {
+            return traits_type::not_eof(ch);
+        }
+        char c = traits_type::to_char_type(ch);
+        return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+    }
+
+public:
+    explicit SocketOutputBuf(int fd) : fd(fd) {}
+};
+
+// Serves LSP sessions on the Unix domain socket at `opts.lspSocketPath`, one connection at a time, until accepting one
+// fails. Every session starts from a copy of `gs`, so that tools invoking Sorbet repeatedly don't pay for process
+// startup, the payload and option processing each time; with `--cache-dir`, indexing is served from the cache too.
+unique_ptr<core::GlobalState> serveLSPOnSocket(unique_ptr<core::GlobalState> gs, const options::Options &opts,
+                                               WorkerPool &workers, unique_ptr<KeyValueStore> kvstore,
+                                               const string &kvstoreVersion, const string &kvstoreFlavor) {
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (opts.lspSocketPath.size() >= sizeof(addr.sun_path)) {
+        logger->error("--lsp-socket path is too long: {}", opts.lspSocketPath);
+        throw options::EarlyReturnWithCode(1);
+    }
+    strncpy(addr.sun_path, opts.lspSocketPath.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(addr.sun_path);
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0 || ::bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listenFd, 16) != 0) {
+        logger->error("Could not listen on {}: {}", opts.lspSocketPath, strerror(errno));
+        throw options::EarlyReturnWithCode(1);
+    }
+    logger->debug("Serving LSP sessions on {}", opts.lspSocketPath);
+
+    while (true) {
+        int connFd = accept(listenFd, nullptr, nullptr);
+        if (connFd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            logger->error("Could not accept a connection on {}: {}", opts.lspSocketPath, strerror(errno));
+            break;
+        }
+#ifdef SO_NOSIGPIPE
+        int noSigPipe = 1;
+        setsockopt(connFd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+        if (kvstore == nullptr && !opts.cacheDir.empty()) {
+            kvstore = make_unique<KeyValueStore>(kvstoreVersion, opts.cacheDir, kvstoreFlavor, opts.cacheMaxUnusedRuns);
+        }
+        prodCounterInc("lsp.socket.sessions");
+        SocketOutputBuf outputBuf(connFd);
+        ostream output(&outputBuf);
+        try {
+            lsp::LSPLoop loop(gs->deepCopy(true), opts, logger, workers, connFd, output, false, false, move(kvstore));
+            loop.runLSP();
+        } catch (options::EarlyReturnWithCode &e) {
+            // Ends this session only; the next one starts from `gs` again.
+            logger->debug("LSP session on {} ended with code {}", opts.lspSocketPath, e.returnCode);
+        }
+        close(connFd);
+    }
+    close(listenFd);
+    unlink(addr.sun_path);
+    return gs;
+}
 #endif
 
 int realmain(int argc, char *argv[]) {
@@ -388,25 +667,92 @@ int realmain(int argc, char *argv[]) {
                          "or set SORBET_SILENCE_DEV_MESSAGE=1 in your shell environment.\n");
         }
     }
-    unique_ptr<WorkerPool> workers = WorkerPool::create(opts.threads, *logger);
+    if (opts.compactCache) {
+        try {
+            KeyValueStore::compact(opts.cacheDir);
+        } catch (invalid_argument &e) {
+            return 1;
+        }
+        return 0;
+    }
+    if (opts.print.SlowReport.enabled) {
+        pipeline::SlowReport::enable();
+    }
+    unique_ptr<web_tracer_framework::TraceStream> traceStream;
+    if (!opts.webTraceFile.empty()) {
+        traceStream = make_unique<web_tracer_framework::TraceStream>(opts.webTraceFile, opts.webTraceSampleEvery);
+    }
+    unique_ptr<WorkerPool> workers = WorkerPool::create(opts.threads, *logger, opts.numaWorkers);
 
     unique_ptr<core::GlobalState> gs =
         make_unique<core::GlobalState>((make_shared<core::ErrorQueue>(*typeErrorsConsole, *logger)));
     gs->pathPrefix = opts.pathPrefix;
     gs->errorUrlBase = opts.errorUrlBase;
+    gs->errorQueue->jsonErrors = opts.jsonlErrors;
     gs->semanticExtensions = move(extensions);
     vector<ast::ParsedFile> indexed;
 
     logger->trace("building initial global state");
+    string loadedState;
+    string kvstoreVersion = Version::full_version_string;
+    if (!opts.loadState.empty()) {
+        try {
+            loadedState = FileOps::read(opts.loadState);
+        } catch (FileNotFoundException e) {
+            logger->error("File given to --load-state not found: {}", opts.loadState);
+            return 1;
+        }
+        // Trees cached against one state can't be loaded into another. The cache is cleared whenever it is opened
+        // with another version than it was written with, so each state gets a cache of its own.
+        auto stateHash = crypto_hashing::hash16(loadedState);
+        kvstoreVersion += "-" + absl::BytesToHexString(string_view{(char *)stateHash.data(), size(stateHash)});
+    }
     unique_ptr<KeyValueStore> kvstore;
+    const string kvstoreFlavor = opts.skipDSLPasses ? "nodsl" : "default";
+    if (!opts.cacheDir.empty() && !opts.sharedCacheDir.empty() &&
+        KeyValueStore::seed(kvstoreVersion, opts.cacheDir, opts.sharedCacheDir)) {
+        logger->debug("Copied the cache in {} into {}", opts.sharedCacheDir, opts.cacheDir);
+    }
     if (!opts.cacheDir.empty()) {
-        kvstore = make_unique<KeyValueStore>(Version::full_version_string, opts.cacheDir,
-                                             opts.skipDSLPasses ? "nodsl" : "default");
+        kvstore = make_unique<KeyValueStore>(kvstoreVersion, opts.cacheDir, kvstoreFlavor, opts.cacheMaxUnusedRuns);
     }
-    payload::createInitialGlobalState(gs, opts, kvstore);
+    if (!opts.affectedFilesSince.empty()) {
+        vector<shared_ptr<core::File>> files;
+        vector<shared_ptr<core::File>> oldFiles;
+        for (auto &path : opts.inputFileNames) {
+            try {
+                files.emplace_back(make_shared<core::File>(string(path), FileOps::read(path), core::File::Normal));
+            } catch (FileNotFoundException e) {
+                logger->error("File not found: {}", path);
+                return 1;
+            }
+            auto oldPath = fmt::format("{}/{}", opts.affectedFilesSince, path);
+            if (!FileOps::exists(oldPath)) {
+                // A file missing from the checkout is new.
+                oldFiles.emplace_back(nullptr);
+                continue;
+            }
+            auto oldSource = FileOps::read(oldPath);
+            oldFiles.emplace_back(make_shared<core::File>(string(path), move(oldSource), core::File::Normal));
+        }
+        for (auto i : pipeline::affectedFiles(files, oldFiles, *logger, *workers, kvstore)) {
+            cout << files[i]->path() << '\n';
+        }
+        if (kvstore) {
+            KeyValueStore::commit(move(kvstore));
+        }
+        return 0;
+    }
+    payload::createInitialGlobalState(gs, opts, kvstore, workers.get(), loadedState);
     if (opts.silenceErrors) {
         gs->silenceErrors = true;
     }
+    gs->typecheckShard = opts.typecheckShard;
+    gs->typecheckShardCount = opts.typecheckShardCount;
+    gs->sanityCheckSample = opts.sanityCheckSample;
+    if (opts.sanityCheckSample > 1) {
+        gs->sanityCheckSeed = random_device()();
+    }
     if (opts.autocorrect) {
         gs->autocorrect = true;
     }
@@ -421,6 +767,8 @@ int realmain(int argc, char *argv[]) {
     }
     if (opts.reserveMemKiB > 0) {
         gs->reserveMemory(opts.reserveMemKiB);
+    } else if (kvstore) {
+        payload::reserveTablesFromLastRun(*gs, *kvstore);
     }
     for (auto code : opts.errorCodeWhiteList) {
         gs->onlyShowErrorClass(code);
@@ -451,8 +799,12 @@ int realmain(int argc, char *argv[]) {
                       "If you're developing an LSP extension to some editor, make sure to run sorbet with `-v` flag,"
                       "it will enable outputing the LSP session to stderr(`Write: ` and `Read: ` log lines)",
                       Version::full_version_string);
-        lsp::LSPLoop loop(move(gs), opts, logger, *workers, STDIN_FILENO, cout);
-        gs = loop.runLSP();
+        if (!opts.lspSocketPath.empty()) {
+            gs = serveLSPOnSocket(move(gs), opts, *workers, move(kvstore), kvstoreVersion, kvstoreFlavor);
+        } else {
+            lsp::LSPLoop loop(move(gs), opts, logger, *workers, STDIN_FILENO, cout, false, false, move(kvstore));
+            gs = loop.runLSP();
+        }
 #endif
     } else {
         Timer timeall(logger, "wall_time");
@@ -460,6 +812,12 @@ int realmain(int argc, char *argv[]) {
         logger->trace("Files: ");
 
         { inputFiles = pipeline::reserveFiles(gs, opts.inputFileNames); }
+        // Files that came with the payload, or with the state given to --load-state, were indexed and resolved into it.
+        inputFiles.erase(remove_if(inputFiles.begin(), inputFiles.end(),
+                                   [&](core::FileRef file) {
+                                       return file.dataAllowingUnsafe(*gs).sourceType == core::File::Payload;
+                                   }),
+                         inputFiles.end());
 
         {
             core::UnfreezeFileTable fileTableAccess(*gs);
@@ -479,7 +837,11 @@ int realmain(int argc, char *argv[]) {
 
         { indexed = pipeline::index(gs, inputFiles, opts, *workers, kvstore); }
 
-        payload::retainGlobalState(gs, opts, kvstore);
+        payload::retainGlobalState(gs, opts, kvstore, workers.get());
+        if (!opts.cacheDir.empty() && !kvstore) {
+            // retainGlobalState committed the cached name table; typecheck results go in a fresh transaction.
+            kvstore = make_unique<KeyValueStore>(kvstoreVersion, opts.cacheDir, kvstoreFlavor, opts.cacheMaxUnusedRuns);
+        }
 
         if (gs->runningUnderAutogen) {
 #ifndef SORBET_REALMAIN_MIN
@@ -490,7 +852,7 @@ int realmain(int argc, char *argv[]) {
 
             core::MutableContext ctx(*gs, core::Symbols::root());
 
-            indexed = pipeline::name(*gs, move(indexed), opts);
+            indexed = pipeline::name(*gs, move(indexed), opts, *workers, kvstore);
             autogen::AutoloaderConfig autoloaderCfg;
             {
                 core::UnfreezeNameTable nameTableAccess(*gs);
@@ -505,11 +867,73 @@ int realmain(int argc, char *argv[]) {
                 autoloaderCfg = autogen::AutoloaderConfig::enterConfig(*gs, opts.autoloaderConfig);
             }
 
-            runAutogen(ctx, opts, autoloaderCfg, *workers, indexed);
+            runAutogen(ctx, opts, autoloaderCfg, *workers, indexed, kvstore.get());
+            if (kvstore && !gs->hadCriticalError()) {
+                KeyValueStore::commit(move(kvstore));
+            }
 #endif
         } else {
-            indexed = pipeline::resolve(gs, move(indexed), opts, *workers);
-            indexed = pipeline::typecheck(gs, move(indexed), opts, *workers);
+            indexed = pipeline::resolve(gs, move(indexed), opts, *workers, kvstore);
+            // With --changed-files, only the files the changes may affect are typechecked.
+            vector<shared_ptr<core::File>> lastRun;
+            vector<ast::ParsedFile> unaffected;
+            if (!opts.changedFiles.empty()) {
+                for (auto &file : indexed) {
+                    lastRun.emplace_back(gs->getFiles()[file.file.id()]);
+                }
+                auto affected =
+                    pipeline::affectedFilesSinceLastRun(lastRun, opts.changedFiles, *logger, *workers, kvstore);
+                vector<ast::ParsedFile> toTypecheck;
+                for (int i = 0; i < indexed.size(); i++) {
+                    if (absl::c_binary_search(affected, i)) {
+                        toTypecheck.emplace_back(move(indexed[i]));
+                    } else {
+                        unaffected.emplace_back(move(indexed[i]));
+                    }
+                }
+                prodCounterAdd("types.input.files.typecheck.unaffected", unaffected.size());
+                indexed = move(toTypecheck);
+            }
+            function<bool()> reachedMaxErrors;
+            if (opts.maxErrors > 0) {
+                reachedMaxErrors = [&gs, &opts]() -> bool { return gs->totalErrors() >= opts.maxErrors; };
+            }
+            // With --max-memory-mib, a process that is already over the limit keeps its trees on disk until a thread
+            // is ready to typecheck them, so that only as many trees as there are threads are in memory at once.
+            unique_ptr<lsp::EvictedTrees> spilled;
+            function<unique_ptr<ast::Expression>(core::FileRef)> loadTree;
+            if (opts.maxMemoryMiB > 0 && (residentMemoryBytes() >> 20) > opts.maxMemoryMiB) {
+                logger->debug("Keeping the resolved trees on disk, as resident memory is over {} MiB",
+                              opts.maxMemoryMiB);
+                spilled = make_unique<lsp::EvictedTrees>();
+                vector<ast::ParsedFile *> toSpill;
+                for (auto &tree : indexed) {
+                    toSpill.emplace_back(&tree);
+                }
+                spilled->evict(*gs, toSpill, *workers);
+                releaseFreeMemory();
+                loadTree = [&gs, &spilled](core::FileRef file) { return spilled->load(*gs, file); };
+            }
+            indexed = pipeline::typecheck(gs, move(indexed), opts, *workers, kvstore, reachedMaxErrors, nullptr,
+                                          loadTree);
+            move(unaffected.begin(), unaffected.end(), back_inserter(indexed));
+            if (kvstore && !gs->hadCriticalError()) {
+                payload::writeTableSizes(*gs, *kvstore);
+                if (!lastRun.empty()) {
+                    pipeline::recordLastRun(lastRun, *kvstore);
+                }
+                KeyValueStore::commit(move(kvstore));
+            }
+        }
+
+        if (!opts.cacheDir.empty() && !opts.sharedCacheDir.empty() && !opts.sharedCacheReadOnly && !kvstore &&
+            !gs->hadCriticalError()) {
+            try {
+                KeyValueStore::publish(kvstoreVersion, opts.cacheDir, opts.sharedCacheDir);
+            } catch (invalid_argument &e) {
+                // The run itself succeeded, and the next one will try again.
+                logger->warn("Could not store the cache in {}", opts.sharedCacheDir);
+            }
         }
 
         if (opts.suggestTyped) {
@@ -541,13 +965,14 @@ int realmain(int argc, char *argv[]) {
             gs->errorQueue->flushErrorCount();
         }
         if (opts.autocorrect) {
-            gs->errorQueue->flushAutocorrects(*gs, *opts.fs);
+            gs->errorQueue->flushAutocorrects(*gs, *opts.fs, workers.get());
         }
         logger->trace("sorbet done");
 
         if (!opts.storeState.empty()) {
             gs->markAsPayload();
-            FileOps::write(opts.storeState.c_str(), core::serialize::Serializer::store(*gs));
+            FileOps::write(opts.storeState.c_str(),
+                           core::serialize::Serializer::store(*gs, !opts.storeStateUncompressed, workers.get()));
         }
 
         auto untypedSources = getAndClearHistogram("untyped.sources");
@@ -595,6 +1020,8 @@ int realmain(int argc, char *argv[]) {
         StatsD::submitCounters(counters, opts.statsdHost, opts.statsdPort, prefix + ".counters");
     }
     if (!opts.webTraceFile.empty()) {
+        // Finishes writing out the timings before the counters go after them.
+        traceStream.reset();
         web_tracer_framework::Tracing::storeTraces(counters, opts.webTraceFile);
     }
 
@@ -640,6 +1067,17 @@ int realmain(int argc, char *argv[]) {
         intentionallyLeakMemory(gs.release());
     }
 
+    if (!sorbet::debug_mode && !sorbet::emscripten_build) {
+        // Everything has been written out by now, and tearing down what's left (the worker pool, the options, the
+        // name and type caches, static destructors) takes a noticeable amount of time on large codebases, so skip it.
+        // Debug builds still exit normally, so that leak checkers see a full teardown.
+        spdlog::apply_all([](const shared_ptr<spdlog::logger> &l) { l->flush(); });
+        cout.flush();
+        cerr.flush();
+        fflush(nullptr);
+        _exit(returnCode);
+    }
+
     // je_malloc_stats_print(nullptr, nullptr, nullptr); // uncomment this to print jemalloc statistics
 
     return returnCode;
@@ -1,10 +1,13 @@
 #include "yaml-cpp/yaml.h"
 // has to go first as it violates our poisions
 
+#include "absl/strings/escaping.h" // BytesToHexString
 #include "absl/strings/match.h"
 #include "common/FileOps.h"
+#include "common/crypto_hashing/crypto_hashing.h"
 #include "configatron.h"
 #include <cctype>
+#include <charconv>
 #include <sys/types.h>
 #include <utility>
 
@@ -38,28 +41,80 @@ StringKind classifyString(string_view str) {
     }
 }
 
-core::TypePtr getType(core::GlobalState &gs, const YAML::Node &node) {
+// What a scalar in the configuration can be typed as.
+enum class ValueType : u1 { Nil, Boolean, Integer, Float, String, Symbol, Untyped };
+
+constexpr int VALUE_TYPE_COUNT = (int)ValueType::Untyped + 1;
+
+ValueType getType(const YAML::Node &node) {
     ENFORCE(node.IsScalar());
     string value = node.as<string>();
     if (value == "true" || value == "false") {
-        return core::Types::Boolean();
+        return ValueType::Boolean;
     }
     switch (classifyString(value)) {
         case StringKind::Integer:
-            return core::Types::Integer();
+            return ValueType::Integer;
         case StringKind::Float:
-            return core::Types::Float();
+            return ValueType::Float;
         case StringKind::String:
-            return core::Types::String();
+            return ValueType::String;
         case StringKind::Symbol:
+            return ValueType::Symbol;
+    }
+}
+
+core::TypePtr toType(ValueType type) {
+    switch (type) {
+        case ValueType::Nil:
+            return core::Types::nilClass();
+        case ValueType::Boolean:
+            return core::Types::Boolean();
+        case ValueType::Integer:
+            return core::Types::Integer();
+        case ValueType::Float:
+            return core::Types::Float();
+        case ValueType::String:
+            return core::Types::String();
+        case ValueType::Symbol:
             return core::Types::Symbol();
+        case ValueType::Untyped:
+            return core::Types::untypedUntracked();
     }
 }
 
+// One value found at a path: a scalar, or an array of them. Parsing only records these, so that the result doesn't
+// depend on a GlobalState and can be cached; `Path::enter` turns them into types.
+struct Value {
+    bool isArray = false;
+    // The scalar's type, or those of the array's elements in order.
+    vector<ValueType> types;
+
+    core::TypePtr type(core::GlobalState &gs) const {
+        if (!isArray) {
+            return toType(types[0]);
+        }
+        core::TypePtr elemType;
+        for (auto elem : types) {
+            auto thisElemType = toType(elem);
+            if (elemType) {
+                elemType = core::Types::any(core::MutableContext(gs, core::Symbols::root()), elemType, thisElemType);
+            } else {
+                elemType = thisElemType;
+            }
+        }
+        if (!elemType) {
+            elemType = core::Types::bottom();
+        }
+        vector<core::TypePtr> elems{elemType};
+        return core::make_type<core::AppliedType>(core::Symbols::Array(), elems);
+    }
+};
+
 struct Path {
     Path *parent;
     string selector;
-    core::TypePtr myType;
+    vector<Value> values;
 
     Path(Path *parent, string selector) : parent(parent), selector(move(selector)){};
 
@@ -72,7 +127,7 @@ struct Path {
 
     string show(core::GlobalState &gs) {
         fmt::memory_buffer buf;
-        if (myType) {
+        if (auto myType = type(gs)) {
             fmt::format_to(buf, "{} -> {}", toString(), myType->toString(gs));
         }
         fmt::format_to(buf, "{}",
@@ -95,17 +150,23 @@ struct Path {
         return children.emplace_back(make_shared<Path>(this, string(name)));
     }
 
-    void setType(core::GlobalState &gs, core::TypePtr tp) {
-        if (myType) {
-            myType = core::Types::any(core::MutableContext(gs, core::Symbols::root()), myType, tp);
-        } else {
-            myType = tp;
+    // The union of the types of every value found at this path, or null if there is none.
+    core::TypePtr type(core::GlobalState &gs) const {
+        core::TypePtr result;
+        for (auto &value : values) {
+            auto tp = value.type(gs);
+            if (result) {
+                result = core::Types::any(core::MutableContext(gs, core::Symbols::root()), result, tp);
+            } else {
+                result = tp;
+            }
         }
+        return result;
     }
 
     void enter(core::GlobalState &gs, core::SymbolRef parent, core::SymbolRef owner) {
         if (children.empty()) {
-            parent.data(gs)->resultType = myType;
+            parent.data(gs)->resultType = type(gs);
         } else {
             auto classSym =
                 gs.enterClassSymbol(core::Loc::none(), owner, gs.enterNameConstant("configatron" + this->toString()));
@@ -130,39 +191,28 @@ struct Path {
     }
 };
 
-void recurse(core::GlobalState &gs, const YAML::Node &node, shared_ptr<Path> prefix) {
+void recurse(const YAML::Node &node, shared_ptr<Path> prefix) {
     switch (node.Type()) {
         case YAML::NodeType::Null:
-            prefix->setType(gs, core::Types::nilClass());
+            prefix->values.emplace_back(Value{false, {ValueType::Nil}});
             break;
         case YAML::NodeType::Scalar:
-            prefix->setType(gs, getType(gs, node));
+            prefix->values.emplace_back(Value{false, {getType(node)}});
             break;
         case YAML::NodeType::Sequence: {
-            core::TypePtr elemType;
+            auto &value = prefix->values.emplace_back(Value{true, {}});
             for (const auto &child : node) {
-                auto thisElemType = child.IsScalar() ? getType(gs, child) : core::Types::untypedUntracked();
-                if (elemType) {
-                    elemType =
-                        core::Types::any(core::MutableContext(gs, core::Symbols::root()), elemType, thisElemType);
-                } else {
-                    elemType = thisElemType;
-                }
-            }
-            if (!elemType) {
-                elemType = core::Types::bottom();
+                value.types.emplace_back(child.IsScalar() ? getType(child) : ValueType::Untyped);
             }
-            vector<core::TypePtr> elems{elemType};
-            prefix->setType(gs, core::make_type<core::AppliedType>(core::Symbols::Array(), elems));
             break;
         }
         case YAML::NodeType::Map:
             for (const auto &child : node) {
                 auto key = child.first.as<string>();
                 if (key != "<<") {
-                    recurse(gs, child.second, prefix->getChild(key));
+                    recurse(child.second, prefix->getChild(key));
                 } else {
-                    recurse(gs, child.second, prefix);
+                    recurse(child.second, prefix);
                 }
             }
 
@@ -172,24 +222,29 @@ void recurse(core::GlobalState &gs, const YAML::Node &node, shared_ptr<Path> pre
     }
 }
 
-void handleFile(core::GlobalState &gs, const string &file, shared_ptr<Path> rootNode) {
-    YAML::Node config = YAML::LoadFile(file);
+void handleFile(const string &contents, shared_ptr<Path> rootNode) {
+    YAML::Node config = YAML::Load(contents);
     switch (config.Type()) {
         case YAML::NodeType::Map:
             for (const auto &child : config) {
                 auto key = child.first.as<string>();
-                recurse(gs, child.second, rootNode);
+                recurse(child.second, rootNode);
             }
             break;
         default:
             break;
     }
 }
-} // namespace
 
-void configatron::fillInFromFileSystem(core::GlobalState &gs, const vector<string> &folders,
-                                       const vector<string> &files) {
-    auto rootNode = make_shared<Path>(nullptr, "");
+struct ConfigFile {
+    // Where the file goes in the configuration tree: under its path relative to its `--configatron-dir`, or at the
+    // root for a `--configatron-file`.
+    optional<string> prefix;
+    string contents;
+};
+
+vector<ConfigFile> readFiles(const vector<string> &folders, const vector<string> &files) {
+    vector<ConfigFile> result;
     for (auto &folder : folders) {
         auto files = FileOps::listFilesInDir(folder, {".yaml"}, true, {}, {});
         const int prefixLen = folder.length() + 1;
@@ -198,12 +253,138 @@ void configatron::fillInFromFileSystem(core::GlobalState &gs, const vector<strin
             string_view fileName(file.c_str(), file.size() - extLen);
             // Trim off folder + '/'
             fileName = fileName.substr(prefixLen);
-            auto innerNode = rootNode->getChild(fileName);
-            handleFile(gs, file, innerNode);
+            result.emplace_back(ConfigFile{string(fileName), FileOps::read(file)});
         }
     }
     for (auto &file : files) {
-        handleFile(gs, file, rootNode);
+        result.emplace_back(ConfigFile{nullopt, FileOps::read(file)});
+    }
+    return result;
+}
+
+string digestOf(const vector<ConfigFile> &files) {
+    string digestInput;
+    for (auto &file : files) {
+        if (file.prefix) {
+            digestInput += fmt::format("d{}\n{}", file.prefix->size(), *file.prefix);
+        } else {
+            digestInput += "f";
+        }
+        digestInput += fmt::format("{}\n{}", file.contents.size(), file.contents);
+    }
+    auto hashBytes = crypto_hashing::hash64(digestInput);
+    return absl::BytesToHexString(string_view{(char *)hashBytes.data(), size(hashBytes)});
+}
+
+// Paths are cached as their selector, values and children, each prefixed by its size and a newline.
+void encodePath(const Path &path, string &out) {
+    out += fmt::format("{}\n{}{}\n", path.selector.size(), path.selector, path.values.size());
+    for (auto &value : path.values) {
+        out += fmt::format("{}{}\n", value.isArray ? 'a' : 's', value.types.size());
+        for (auto type : value.types) {
+            out += (char)('0' + (int)type);
+        }
+    }
+    out += fmt::format("{}\n", path.children.size());
+    for (auto &child : path.children) {
+        encodePath(*child, out);
+    }
+}
+
+bool decodeSize(string_view &in, size_t &size) {
+    auto newline = in.find('\n');
+    if (newline == string_view::npos) {
+        return false;
+    }
+    auto [end, err] = std::from_chars(in.data(), in.data() + newline, size);
+    if (err != std::errc() || end != in.data() + newline) {
+        return false;
+    }
+    in.remove_prefix(newline + 1);
+    return true;
+}
+
+// Returns null if `in` is not something `encodePath` wrote.
+shared_ptr<Path> decodePath(string_view &in, Path *parent) {
+    size_t size;
+    if (!decodeSize(in, size) || in.size() < size) {
+        return nullptr;
+    }
+    auto path = make_shared<Path>(parent, string(in.substr(0, size)));
+    in.remove_prefix(size);
+
+    if (!decodeSize(in, size)) {
+        return nullptr;
+    }
+    path->values.resize(size);
+    for (auto &value : path->values) {
+        if (in.empty() || (in[0] != 'a' && in[0] != 's')) {
+            return nullptr;
+        }
+        value.isArray = in[0] == 'a';
+        in.remove_prefix(1);
+        if (!decodeSize(in, size) || in.size() < size || (!value.isArray && size != 1)) {
+            return nullptr;
+        }
+        for (auto c : in.substr(0, size)) {
+            if (c < '0' || c >= '0' + VALUE_TYPE_COUNT) {
+                return nullptr;
+            }
+            value.types.emplace_back((ValueType)(c - '0'));
+        }
+        in.remove_prefix(size);
+    }
+
+    if (!decodeSize(in, size)) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < size; i++) {
+        auto child = decodePath(in, path.get());
+        if (child == nullptr) {
+            return nullptr;
+        }
+        path->children.emplace_back(move(child));
+    }
+    return path;
+}
+
+shared_ptr<Path> parseFiles(const vector<ConfigFile> &files) {
+    auto rootNode = make_shared<Path>(nullptr, "");
+    for (auto &file : files) {
+        handleFile(file.contents, file.prefix ? rootNode->getChild(*file.prefix) : rootNode);
+    }
+    return rootNode;
+}
+} // namespace
+
+string configatron::hashFiles(const vector<string> &folders, const vector<string> &files) {
+    return digestOf(readFiles(folders, files));
+}
+
+string configatron::fillInFromFileSystem(core::GlobalState &gs, const vector<string> &folders,
+                                         const vector<string> &files, const unique_ptr<KeyValueStore> &kvstore) {
+    auto configFiles = readFiles(folders, files);
+    auto digest = digestOf(configFiles);
+    auto key = "configatron//" + digest;
+
+    shared_ptr<Path> rootNode;
+    if (kvstore && kvstore->read(key) != nullptr) {
+        auto cached = kvstore->readString(key);
+        rootNode = decodePath(cached, nullptr);
+        if (rootNode != nullptr && cached.empty()) {
+            prodCounterInc("types.input.configatron.kvstore.hit");
+        } else {
+            rootNode = nullptr;
+        }
+    }
+    if (rootNode == nullptr) {
+        rootNode = parseFiles(configFiles);
+        if (kvstore) {
+            prodCounterInc("types.input.configatron.kvstore.miss");
+            string encoded;
+            encodePath(*rootNode, encoded);
+            kvstore->writeString(key, encoded);
+        }
     }
 
     core::SymbolRef configatron =
@@ -212,5 +393,6 @@ void configatron::fillInFromFileSystem(core::GlobalState &gs, const vector<strin
 
     auto &blkArg = gs.enterMethodArgumentSymbol(core::Loc::none(), configatron, core::Names::blkArg());
     blkArg.flags.isBlock = true;
+    return digest;
 }
 } // namespace sorbet::namer
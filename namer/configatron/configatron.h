@@ -1,13 +1,21 @@
 #ifndef SORBET_CONFIGATRON_H
 #define SORBET_CONFIGATRON_H
 
+#include "common/kvstore/KeyValueStore.h"
 #include "core/core.h"
 namespace sorbet::namer {
 
 class configatron {
 public:
-    static void fillInFromFileSystem(core::GlobalState &gs, const std::vector<std::string> &folders,
-                                     const std::vector<std::string> &files);
+    // A digest of the paths and contents of the YAML files that `fillInFromFileSystem` loads from `folders` and
+    // `files`.
+    static std::string hashFiles(const std::vector<std::string> &folders, const std::vector<std::string> &files);
+
+    // If `kvstore` is given, caches the configuration parsed from the files in it, and reuses that for as long as they
+    // don't change. Returns their `hashFiles`.
+    static std::string fillInFromFileSystem(core::GlobalState &gs, const std::vector<std::string> &folders,
+                                            const std::vector<std::string> &files,
+                                            const std::unique_ptr<KeyValueStore> &kvstore);
 };
 } // namespace sorbet::namer
 
@@ -4,6 +4,7 @@
 #include "ast/ast.h"
 #include "ast/desugar/Desugar.h"
 #include "ast/treemap/treemap.h"
+#include "common/concurrency/ConcurrentQueue.h"
 #include "common/typecase.h"
 #include "core/Context.h"
 #include "core/Names.h"
@@ -16,6 +17,102 @@ using namespace std;
 
 namespace sorbet::namer {
 
+namespace {
+
+/**
+ * Finds the parts of a file that NameInserter has nothing to do in: class body statements and method bodies without
+ * any definitions, constant assignments, globals or `module_function` calls in them. Most of a tree is such method
+ * bodies. This only reads the tree, so it can look at every file in parallel before NameInserter enters their symbols
+ * one file at a time, which then doesn't have to walk them.
+ */
+class SkippableSubtreeFinder {
+    struct ClassFrame {
+        vector<const ast::Expression *> stats;
+        int current = -1;
+        u4 currentStart = 0;
+    };
+
+    // The number of nodes found so far that NameInserter acts on.
+    u4 definitions = 0;
+    vector<ClassFrame> classes;
+    vector<u4> methodStarts;
+
+    void finishStat(ClassFrame &frame) {
+        if (frame.current >= 0 && definitions == frame.currentStart) {
+            skippable.insert(frame.stats[frame.current]);
+        }
+    }
+
+public:
+    UnorderedSet<const ast::Expression *> skippable;
+
+    unique_ptr<ast::Expression> preTransformExpression(core::Context ctx, unique_ptr<ast::Expression> expr) {
+        // TreeMap has no hook between the statements of a class, so notice when it starts walking the next one.
+        if (!classes.empty()) {
+            auto &frame = classes.back();
+            if (frame.current + 1 < frame.stats.size() && expr.get() == frame.stats[frame.current + 1]) {
+                finishStat(frame);
+                frame.current++;
+                frame.currentStart = definitions;
+            }
+        }
+        return expr;
+    }
+
+    unique_ptr<ast::ClassDef> preTransformClassDef(core::Context ctx, unique_ptr<ast::ClassDef> klass) {
+        definitions++;
+        auto &frame = classes.emplace_back();
+        frame.stats.reserve(klass->rhs.size());
+        for (auto &stat : klass->rhs) {
+            frame.stats.emplace_back(stat.get());
+        }
+        return klass;
+    }
+
+    unique_ptr<ast::Expression> postTransformClassDef(core::Context ctx, unique_ptr<ast::ClassDef> klass) {
+        finishStat(classes.back());
+        classes.pop_back();
+        return klass;
+    }
+
+    unique_ptr<ast::MethodDef> preTransformMethodDef(core::Context ctx, unique_ptr<ast::MethodDef> method) {
+        definitions++;
+        methodStarts.emplace_back(definitions);
+        return method;
+    }
+
+    unique_ptr<ast::Expression> postTransformMethodDef(core::Context ctx, unique_ptr<ast::MethodDef> method) {
+        if (definitions == methodStarts.back()) {
+            skippable.insert(method->rhs.get());
+        }
+        methodStarts.pop_back();
+        return method;
+    }
+
+    unique_ptr<ast::Expression> postTransformSend(core::Context ctx, unique_ptr<ast::Send> send) {
+        if (send->fun == core::Names::moduleFunction()) {
+            definitions++;
+        }
+        return send;
+    }
+
+    unique_ptr<ast::Expression> postTransformAssign(core::Context ctx, unique_ptr<ast::Assign> asgn) {
+        if (ast::isa_tree<ast::UnresolvedConstantLit>(asgn->lhs.get())) {
+            definitions++;
+        }
+        return asgn;
+    }
+
+    unique_ptr<ast::Expression> postTransformUnresolvedIdent(core::Context ctx, unique_ptr<ast::UnresolvedIdent> nm) {
+        if (nm->kind == ast::UnresolvedIdent::Global) {
+            definitions++;
+        }
+        return nm;
+    }
+};
+
+} // namespace
+
 /**
  * Used with TreeMap to insert all the class and method symbols into the symbol
  * table.
@@ -128,8 +225,19 @@ class NameInserter {
 
     struct LocalFrame {
         bool moduleFunctionActive = false;
+        // What was taken out of the tree because it's in `skippable`, to be put back once TreeMap is done with the
+        // class or method.
+        vector<pair<int, unique_ptr<ast::Expression>>> skippedStats;
+        unique_ptr<ast::Expression> skippedBody;
     };
 
+    // Subtrees of the current file that SkippableSubtreeFinder found nothing to name in, if it was run.
+    const UnorderedSet<const ast::Expression *> *skippable = nullptr;
+
+    bool isSkippable(const unique_ptr<ast::Expression> &expr) const {
+        return skippable != nullptr && skippable->contains(expr.get());
+    }
+
     LocalFrame &enterScope() {
         auto &frame = scopeStack.emplace_back();
         return frame;
@@ -276,7 +384,13 @@ public:
                 klass->symbol.data(ctx)->setIsModule(isModule);
             }
         }
-        enterScope();
+        auto &frame = enterScope();
+        for (int i = 0; i < klass->rhs.size(); i++) {
+            if (isSkippable(klass->rhs[i])) {
+                frame.skippedStats.emplace_back(i, std::move(klass->rhs[i]));
+                klass->rhs[i] = ast::MK::EmptyTree();
+            }
+        }
         return klass;
     }
 
@@ -339,6 +453,9 @@ public:
     }
 
     unique_ptr<ast::Expression> postTransformClassDef(core::MutableContext ctx, unique_ptr<ast::ClassDef> klass) {
+        for (auto &[i, stat] : scopeStack.back().skippedStats) {
+            klass->rhs[i] = std::move(stat);
+        }
         exitScope();
         if (klass->kind == ast::Class && !klass->symbol.data(ctx)->superClass().exists() &&
             klass->symbol != core::Symbols::BasicObject()) {
@@ -583,7 +700,11 @@ public:
     }
 
     unique_ptr<ast::MethodDef> preTransformMethodDef(core::MutableContext ctx, unique_ptr<ast::MethodDef> method) {
-        enterScope();
+        auto &frame = enterScope();
+        if (isSkippable(method->rhs)) {
+            frame.skippedBody = std::move(method->rhs);
+            method->rhs = ast::MK::EmptyTree();
+        }
 
         core::SymbolRef owner = methodOwner(ctx);
 
@@ -622,6 +743,9 @@ public:
 
     unique_ptr<ast::MethodDef> postTransformMethodDef(core::MutableContext ctx, unique_ptr<ast::MethodDef> method) {
         ENFORCE(method->args.size() == method->symbol.data(ctx)->arguments().size());
+        if (scopeStack.back().skippedBody != nullptr) {
+            method->rhs = std::move(scopeStack.back().skippedBody);
+        }
         exitScope();
         if (scopeStack.back().moduleFunctionActive) {
             aliasModuleFunction(ctx, method->symbol.data(ctx)->loc(), method->symbol);
@@ -914,11 +1038,15 @@ private:
     UnorderedMap<core::SymbolRef, core::Loc> classBehaviorLocs;
 };
 
-std::vector<ast::ParsedFile> Namer::run(core::MutableContext ctx, std::vector<ast::ParsedFile> trees) {
+std::vector<ast::ParsedFile>
+Namer::runNameInserter(core::MutableContext ctx, std::vector<ast::ParsedFile> trees,
+                       const std::vector<UnorderedSet<const ast::Expression *>> *skippable) {
     NameInserter nameInserter;
-    for (auto &tree : trees) {
+    for (int i = 0; i < trees.size(); i++) {
+        auto &tree = trees[i];
         auto file = tree.file;
         nameInserter.enterScope();
+        nameInserter.skippable = skippable != nullptr ? &(*skippable)[i] : nullptr;
         try {
             ast::ParsedFile ast;
             {
@@ -938,4 +1066,52 @@ std::vector<ast::ParsedFile> Namer::run(core::MutableContext ctx, std::vector<as
     return trees;
 }
 
+std::vector<ast::ParsedFile> Namer::run(core::MutableContext ctx, std::vector<ast::ParsedFile> trees) {
+    return runNameInserter(ctx, std::move(trees), nullptr);
+}
+
+std::vector<ast::ParsedFile> Namer::run(core::MutableContext ctx, std::vector<ast::ParsedFile> trees,
+                                        WorkerPool &workers) {
+    vector<UnorderedSet<const ast::Expression *>> skippable(trees.size());
+    {
+        Timer timeit(ctx.state.tracer(), "naming.findSkippable");
+        core::Context ictx = ctx;
+        auto fileq = make_shared<ConcurrentBoundedQueue<int>>(trees.size());
+        auto resultq = make_shared<BlockingBoundedQueue<int>>(trees.size());
+        for (int i = 0; i < trees.size(); i++) {
+            fileq->push(move(i), 1);
+        }
+
+        // Each job only touches its own tree and its own entry of `skippable`, and both outlive the jobs because we
+        // wait for all of them below.
+        workers.multiplexJob("findSkippableNamerSubtrees", [ictx, fileq, resultq, &trees, &skippable]() {
+            int processedByThread = 0;
+            int job;
+            for (auto result = fileq->try_pop(job); !result.done(); result = fileq->try_pop(job)) {
+                if (result.gotItem()) {
+                    processedByThread++;
+                    try {
+                        SkippableSubtreeFinder finder;
+                        trees[job].tree = ast::TreeMap::apply(ictx, finder, std::move(trees[job].tree));
+                        skippable[job] = std::move(finder.skippable);
+                    } catch (SorbetException &) {
+                        // Naming this file will walk all of it, and report the problem if there still is one.
+                        Exception::failInFuzzer();
+                    }
+                }
+            }
+            if (processedByThread > 0) {
+                resultq->push(move(processedByThread), processedByThread);
+            }
+        });
+
+        int processed;
+        for (auto result = resultq->wait_pop_timed(processed, WorkerPool::BLOCK_INTERVAL(), ctx.state.tracer());
+             !result.done();
+             result = resultq->wait_pop_timed(processed, WorkerPool::BLOCK_INTERVAL(), ctx.state.tracer())) {
+        }
+    }
+    return runNameInserter(ctx, std::move(trees), &skippable);
+}
+
 }; // namespace sorbet::namer
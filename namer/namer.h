@@ -1,6 +1,7 @@
 #ifndef SORBET_NAMER_NAMER_H
 #define SORBET_NAMER_NAMER_H
 #include "ast/ast.h"
+#include "common/concurrency/WorkerPool.h"
 #include <memory>
 
 namespace sorbet::namer {
@@ -9,7 +10,18 @@ class Namer final {
 public:
     static std::vector<ast::ParsedFile> run(core::MutableContext ctx, std::vector<ast::ParsedFile> trees);
 
+    // Enters the same symbols in the same order, but first finds the parts of every file that don't define anything
+    // on `workers`, so that the single-threaded part doesn't have to walk them.
+    static std::vector<ast::ParsedFile> run(core::MutableContext ctx, std::vector<ast::ParsedFile> trees,
+                                            WorkerPool &workers);
+
     Namer() = delete;
+
+private:
+    // `skippable`, if given, holds what SkippableSubtreeFinder found in each of `trees`.
+    static std::vector<ast::ParsedFile>
+    runNameInserter(core::MutableContext ctx, std::vector<ast::ParsedFile> trees,
+                    const std::vector<UnorderedSet<const ast::Expression *>> *skippable);
 };
 
 } // namespace sorbet::namer
@@ -4,6 +4,7 @@
 #include "ast/ast.h"
 #include "ast/desugar/Desugar.h"
 #include "common/common.h"
+#include "common/concurrency/WorkerPool.h"
 #include "core/Error.h"
 #include "core/Unfreeze.h"
 #include "dsl/dsl.h"
@@ -144,4 +145,38 @@ TEST_F(NamerFixture, InsideClass) { // NOLINT
     ASSERT_EQ(fooSym, barSym.data(ctx)->owner);
 }
 
+TEST_F(NamerFixture, SkippingSubtreesKeepsResult) { // NOLINT
+    // Exercises every kind of node SkippableSubtreeFinder has to keep.
+    string source = "class Test\n"
+                    "  include Comparable\n"
+                    "  X = 1\n"
+                    "  puts(X)\n"
+                    "  def a(x, y = 2); z = x + y; [1, 2].map { |e| e + z }; end\n"
+                    "  def b; $global = 1; end\n"
+                    "  def c; Y = 1; end\n"
+                    "  def d; def nested; 1; end; end\n"
+                    "  private def e; 1; end\n"
+                    "  module_function\n"
+                    "  def f; 2; end\n"
+                    "  class Inner; def g; 3; end; end\n"
+                    "end\n";
+
+    auto workers = WorkerPool::create(0, *logger);
+    vector<string> results;
+    for (auto useWorkers : {false, true}) {
+        core::GlobalState gs(errorQueue);
+        gs.initEmpty();
+        core::MutableContext ctx(gs, core::Symbols::root());
+        vector<ast::ParsedFile> trees;
+        trees.emplace_back(sorbet::local_vars::LocalVars::run(ctx, getTree(gs, source)));
+        {
+            sorbet::core::UnfreezeNameTable nameTableAccess(gs);
+            sorbet::core::UnfreezeSymbolTable symbolTableAccess(gs);
+            trees = useWorkers ? namer::Namer::run(ctx, move(trees), *workers) : namer::Namer::run(ctx, move(trees));
+        }
+        results.emplace_back(gs.showRawFull() + trees[0].tree->showRaw(gs));
+    }
+    ASSERT_EQ(results[0], results[1]);
+}
+
 } // namespace sorbet::namer::test
@@ -69,6 +69,11 @@ public:
 
     vector<unique_ptr<Node>> foreignNodes_;
 
+    // The contents of the `String`s made by `string_internal` that haven't been entered as names yet. The lines of a
+    // `<<~` heredoc are only entered once they're dedented, so that the lines as written don't stay in the name table.
+    // The views point into the lexer's tokens, which live as long as the parse.
+    UnorderedMap<String *, std::string_view> pendingStrings_;
+
     u4 clamp(u4 off) {
         return std::min(off, maxOff_);
     }
@@ -151,7 +156,7 @@ public:
     }
 
     unique_ptr<Node> arg(const token *name) {
-        return make_unique<Arg>(tokLoc(name), gs_.enterNameUTF8(name->string()));
+        return make_unique<Arg>(tokLoc(name), gs_.enterNameUTF8(name->view()));
     }
 
     unique_ptr<Node> args(const token *begin, sorbet::parser::NodeVec args, const token *end, bool check_args) {
@@ -208,14 +213,14 @@ public:
     unique_ptr<Node> attrAsgn(unique_ptr<Node> receiver, const token *dot, const token *selector) {
         core::NameRef method = gs_.enterNameUTF8(selector->string() + "=");
         core::Loc loc = receiver->loc.join(tokLoc(selector));
-        if ((dot != nullptr) && dot->string() == "&.") {
+        if ((dot != nullptr) && dot->view() == "&.") {
             return make_unique<CSend>(loc, std::move(receiver), method, sorbet::parser::NodeVec());
         }
         return make_unique<Send>(loc, std::move(receiver), method, sorbet::parser::NodeVec());
     }
 
     unique_ptr<Node> backRef(const token *tok) {
-        return make_unique<Backref>(tokLoc(tok), gs_.enterNameUTF8(tok->string()));
+        return make_unique<Backref>(tokLoc(tok), gs_.enterNameUTF8(tok->view()));
     }
 
     unique_ptr<Node> begin(const token *begin, unique_ptr<Node> body, const token *end) {
@@ -295,7 +300,7 @@ public:
         sorbet::parser::NodeVec args;
         args.emplace_back(std::move(arg));
 
-        return make_unique<Send>(loc, std::move(receiver), gs_.enterNameUTF8(oper->string()), std::move(args));
+        return make_unique<Send>(loc, std::move(receiver), gs_.enterNameUTF8(oper->view()), std::move(args));
     }
 
     unique_ptr<Node> block(unique_ptr<Node> methodCall, const token *begin, unique_ptr<Node> args,
@@ -355,7 +360,7 @@ public:
 
         if (name != nullptr) {
             loc = tokLoc(name);
-            nm = gs_.enterNameUTF8(name->string());
+            nm = gs_.enterNameUTF8(name->view());
         } else {
             loc = tokLoc(amper);
             nm = gs_.freshNameUnique(core::UniqueNameKind::Parser, core::Names::ampersand(), ++uniqueCounter_);
@@ -395,10 +400,10 @@ public:
             // when the selector is missing, this is a use of the `call` method.
             method = core::Names::call();
         } else {
-            method = gs_.enterNameUTF8(selector->string());
+            method = gs_.enterNameUTF8(selector->view());
         }
 
-        if ((dot != nullptr) && dot->string() == "&.") {
+        if ((dot != nullptr) && dot->view() == "&.") {
             return make_unique<CSend>(loc, std::move(receiver), method, std::move(args));
         } else {
             return make_unique<Send>(loc, std::move(receiver), method, std::move(args));
@@ -412,7 +417,7 @@ public:
     }
 
     unique_ptr<Node> character(const token *char_) {
-        return make_unique<String>(tokLoc(char_), gs_.enterNameUTF8(char_->string()));
+        return make_unique<String>(tokLoc(char_), gs_.enterNameUTF8(char_->view()));
     }
 
     unique_ptr<Node> complex(const token *tok) {
@@ -462,17 +467,17 @@ public:
     }
 
     unique_ptr<Node> const_(const token *name) {
-        return make_unique<Const>(tokLoc(name), nullptr, gs_.enterNameConstant(name->string()));
+        return make_unique<Const>(tokLoc(name), nullptr, gs_.enterNameConstant(name->view()));
     }
 
     unique_ptr<Node> constFetch(unique_ptr<Node> scope, const token *colon, const token *name) {
         return make_unique<Const>(scope->loc.join(tokLoc(name)), std::move(scope),
-                                  gs_.enterNameConstant(name->string()));
+                                  gs_.enterNameConstant(name->view()));
     }
 
     unique_ptr<Node> constGlobal(const token *colon, const token *name) {
         return make_unique<Const>(tokLoc(colon).join(tokLoc(name)), make_unique<Cbase>(tokLoc(colon)),
-                                  gs_.enterNameConstant(name->string()));
+                                  gs_.enterNameConstant(name->view()));
     }
 
     unique_ptr<Node> constOpAssignable(unique_ptr<Node> node) {
@@ -480,39 +485,55 @@ public:
     }
 
     unique_ptr<Node> cvar(const token *tok) {
-        return make_unique<CVar>(tokLoc(tok), gs_.enterNameUTF8(tok->string()));
+        return make_unique<CVar>(tokLoc(tok), gs_.enterNameUTF8(tok->view()));
     }
 
-    unique_ptr<Node> dedentString(unique_ptr<Node> node, size_t dedentLevel) {
-        if (dedentLevel == 0) {
-            return node;
+    // Gives `s` its name, if it doesn't have one yet, dedenting its contents first if `dedenter` isn't null.
+    void enterString(String *s, Dedenter *dedenter) {
+        if (s->val.exists()) {
+            if (dedenter != nullptr) {
+                s->val = gs_.enterNameUTF8(dedenter->dedent(s->val.data(gs_)->shortName(gs_)));
+            }
+            return;
+        }
+        auto it = pendingStrings_.find(s);
+        ENFORCE(it != pendingStrings_.end());
+        if (dedenter != nullptr) {
+            s->val = gs_.enterNameUTF8(dedenter->dedent(it->second));
+        } else {
+            s->val = gs_.enterNameUTF8(it->second);
+        }
+        pendingStrings_.erase(it);
+    }
+
+    void enterStrings(sorbet::parser::NodeVec &parts, Dedenter *dedenter = nullptr) {
+        for (auto &p : parts) {
+            if (auto *s = parser::cast_node<String>(p.get())) {
+                enterString(s, dedenter);
+            }
         }
+    }
 
+    unique_ptr<Node> dedentString(unique_ptr<Node> node, size_t dedentLevel) {
         Dedenter dedenter(dedentLevel);
-        unique_ptr<Node> result;
+        Dedenter *maybeDedenter = dedentLevel == 0 ? nullptr : &dedenter;
 
         typecase(
             node.get(),
 
-            [&](String *s) {
-                std::string dedented = dedenter.dedent(s->val.data(gs_)->shortName(gs_));
-                result = make_unique<String>(s->loc, gs_.enterNameUTF8(dedented));
-            },
-
-            [&](DString *d) {
-                for (auto &p : d->nodes) {
-                    if (auto *s = parser::cast_node<String>(p.get())) {
-                        std::string dedented = dedenter.dedent(s->val.data(gs_)->shortName(gs_));
-                        unique_ptr<Node> newstr = make_unique<String>(s->loc, gs_.enterNameUTF8(dedented));
-                        p.swap(newstr);
-                    }
-                }
-                result = std::move(node);
-            },
+            [&](String *s) { enterString(s, maybeDedenter); },
 
-            [&](Node *n) { Exception::raise("Unexpected dedent node: {}", n->nodeName()); });
+            [&](DString *d) { enterStrings(d->nodes, maybeDedenter); },
 
-        return result;
+            [&](XString *x) { enterStrings(x->nodes, maybeDedenter); },
+
+            [&](Node *n) {
+                if (maybeDedenter != nullptr) {
+                    Exception::raise("Unexpected dedent node: {}", n->nodeName());
+                }
+            });
+
+        return node;
     }
 
     unique_ptr<Node> def_class(const token *class_, unique_ptr<Node> name, const token *lt_,
@@ -528,7 +549,7 @@ public:
         core::Loc declLoc = tokLoc(def, name).join(maybe_loc(args));
         core::Loc loc = tokLoc(def, end);
 
-        return make_unique<DefMethod>(loc, declLoc, gs_.enterNameUTF8(name->string()), std::move(args),
+        return make_unique<DefMethod>(loc, declLoc, gs_.enterNameUTF8(name->view()), std::move(args),
                                       std::move(body));
     }
 
@@ -552,7 +573,7 @@ public:
 
         // TODO: Ruby interprets (e.g.) def 1.method as a parser error; Do we
         // need to reject it here, or can we defer that until later analysis?
-        return make_unique<DefS>(loc, declLoc, std::move(definee), gs_.enterNameUTF8(name->string()), std::move(args),
+        return make_unique<DefS>(loc, declLoc, std::move(definee), gs_.enterNameUTF8(name->view()), std::move(args),
                                  std::move(body));
     }
 
@@ -583,11 +604,11 @@ public:
     }
 
     unique_ptr<Node> gvar(const token *tok) {
-        return make_unique<GVar>(tokLoc(tok), gs_.enterNameUTF8(tok->string()));
+        return make_unique<GVar>(tokLoc(tok), gs_.enterNameUTF8(tok->view()));
     }
 
     unique_ptr<Node> ident(const token *tok) {
-        return make_unique<Ident>(tokLoc(tok), gs_.enterNameUTF8(tok->string()));
+        return make_unique<Ident>(tokLoc(tok), gs_.enterNameUTF8(tok->view()));
     }
 
     unique_ptr<Node> index(unique_ptr<Node> receiver, const token *lbrack, sorbet::parser::NodeVec indexes,
@@ -607,7 +628,7 @@ public:
     }
 
     unique_ptr<Node> ivar(const token *tok) {
-        return make_unique<IVar>(tokLoc(tok), gs_.enterNameUTF8(tok->string()));
+        return make_unique<IVar>(tokLoc(tok), gs_.enterNameUTF8(tok->view()));
     }
 
     unique_ptr<Node> keywordBreak(const token *keyword, const token *lparen, sorbet::parser::NodeVec args,
@@ -663,11 +684,11 @@ public:
     }
 
     unique_ptr<Node> kwarg(const token *name) {
-        return make_unique<Kwarg>(tokLoc(name), gs_.enterNameUTF8(name->string()));
+        return make_unique<Kwarg>(tokLoc(name), gs_.enterNameUTF8(name->view()));
     }
 
     unique_ptr<Node> kwoptarg(const token *name, unique_ptr<Node> value) {
-        return make_unique<Kwoptarg>(tokLoc(name).join(value->loc), gs_.enterNameUTF8(name->string()), tokLoc(name),
+        return make_unique<Kwoptarg>(tokLoc(name).join(value->loc), gs_.enterNameUTF8(name->view()), tokLoc(name),
                                      std::move(value));
     }
 
@@ -677,7 +698,7 @@ public:
 
         if (name != nullptr) {
             loc = loc.join(tokLoc(name));
-            nm = gs_.enterNameUTF8(name->string());
+            nm = gs_.enterNameUTF8(name->view());
         } else {
             nm = gs_.freshNameUnique(core::UniqueNameKind::Parser, core::Names::starStar(), ++uniqueCounter_);
         }
@@ -726,7 +747,7 @@ public:
         core::Loc loc = receiver->loc.join(arg->loc);
         sorbet::parser::NodeVec args;
         args.emplace_back(std::move(arg));
-        return make_unique<Send>(loc, std::move(receiver), gs_.enterNameUTF8(oper->string()), std::move(args));
+        return make_unique<Send>(loc, std::move(receiver), gs_.enterNameUTF8(oper->view()), std::move(args));
     }
 
     unique_ptr<Node> multi_assign(unique_ptr<Node> mlhs, unique_ptr<Node> rhs) {
@@ -776,18 +797,18 @@ public:
             error(ruby_parser::dclass::BackrefAssignment, lhs->loc);
         }
 
-        if (op->string() == "&&") {
+        if (op->view() == "&&") {
             return make_unique<AndAsgn>(lhs->loc.join(rhs->loc), std::move(lhs), std::move(rhs));
         }
-        if (op->string() == "||") {
+        if (op->view() == "||") {
             return make_unique<OrAsgn>(lhs->loc.join(rhs->loc), std::move(lhs), std::move(rhs));
         }
-        return make_unique<OpAsgn>(lhs->loc.join(rhs->loc), std::move(lhs), gs_.enterNameUTF8(op->string()),
+        return make_unique<OpAsgn>(lhs->loc.join(rhs->loc), std::move(lhs), gs_.enterNameUTF8(op->view()),
                                    std::move(rhs));
     }
 
     unique_ptr<Node> optarg_(const token *name, const token *eql, unique_ptr<Node> value) {
-        return make_unique<Optarg>(tokLoc(name).join(value->loc), gs_.enterNameUTF8(name->string()), tokLoc(name),
+        return make_unique<Optarg>(tokLoc(name).join(value->loc), gs_.enterNameUTF8(name->view()), tokLoc(name),
                                    std::move(value));
     }
 
@@ -799,11 +820,12 @@ public:
         auto keyLoc = core::Loc{file_, clamp((u4)key->start()), clamp((u4)key->end() - 1)}; // drop the trailing :
 
         return make_unique<Pair>(tokLoc(key).join(value->loc),
-                                 make_unique<Symbol>(keyLoc, gs_.enterNameUTF8(key->string())), std::move(value));
+                                 make_unique<Symbol>(keyLoc, gs_.enterNameUTF8(key->view())), std::move(value));
     }
 
     unique_ptr<Node> pair_quoted(const token *begin, sorbet::parser::NodeVec parts, const token *end,
                                  unique_ptr<Node> value) {
+        enterStrings(parts);
         auto sym = make_unique<DSymbol>(tokLoc(begin).join(tokLoc(end)), std::move(parts));
         return make_unique<Pair>(tokLoc(begin).join(value->loc), std::move(sym), std::move(value));
     }
@@ -840,6 +862,7 @@ public:
 
     unique_ptr<Node> regexp_compose(const token *begin, sorbet::parser::NodeVec parts, const token *end,
                                     unique_ptr<Node> options) {
+        enterStrings(parts);
         core::Loc loc = tokLoc(begin).join(tokLoc(end)).join(maybe_loc(options));
         return make_unique<Regexp>(loc, std::move(parts), std::move(options));
     }
@@ -871,7 +894,7 @@ public:
         if (name != nullptr) {
             nameLoc = tokLoc(name);
             loc = loc.join(nameLoc);
-            nm = gs_.enterNameUTF8(name->string());
+            nm = gs_.enterNameUTF8(name->view());
         } else {
             // TODO: give example when this happens
             nm = gs_.freshNameUnique(core::UniqueNameKind::Parser, core::Names::star(), ++uniqueCounter_);
@@ -884,7 +907,7 @@ public:
     }
 
     unique_ptr<Node> shadowarg(const token *name) {
-        return make_unique<Shadowarg>(tokLoc(name), gs_.enterNameUTF8(name->string()));
+        return make_unique<Shadowarg>(tokLoc(name), gs_.enterNameUTF8(name->view()));
     }
 
     unique_ptr<Node> splat(const token *star, unique_ptr<Node> arg) {
@@ -897,28 +920,32 @@ public:
     }
 
     unique_ptr<Node> string(const token *string_) {
-        return make_unique<String>(tokLoc(string_), gs_.enterNameUTF8(string_->string()));
+        return make_unique<String>(tokLoc(string_), gs_.enterNameUTF8(string_->view()));
     }
 
+    // The `String`s in `parts` are given names by the `dedentString` that follows.
     unique_ptr<Node> string_compose(const token *begin, sorbet::parser::NodeVec parts, const token *end) {
         core::Loc loc = collectionLoc(begin, parts, end);
         return make_unique<DString>(loc, std::move(parts));
     }
 
     unique_ptr<Node> string_internal(const token *string_) {
-        return make_unique<String>(tokLoc(string_), gs_.enterNameUTF8(string_->string()));
+        auto result = make_unique<String>(tokLoc(string_), core::NameRef::noName());
+        pendingStrings_[result.get()] = string_->view();
+        return result;
     }
 
     unique_ptr<Node> symbol(const token *symbol) {
-        return make_unique<Symbol>(tokLoc(symbol), gs_.enterNameUTF8(symbol->string()));
+        return make_unique<Symbol>(tokLoc(symbol), gs_.enterNameUTF8(symbol->view()));
     }
 
     unique_ptr<Node> symbol_compose(const token *begin, sorbet::parser::NodeVec parts, const token *end) {
+        enterStrings(parts);
         return make_unique<DSymbol>(collectionLoc(begin, parts, end), std::move(parts));
     }
 
     unique_ptr<Node> symbol_internal(const token *symbol) {
-        return make_unique<Symbol>(tokLoc(symbol), gs_.enterNameUTF8(symbol->string()));
+        return make_unique<Symbol>(tokLoc(symbol), gs_.enterNameUTF8(symbol->view()));
     }
 
     unique_ptr<Node> symbols_compose(const token *begin, sorbet::parser::NodeVec parts, const token *end) {
@@ -964,12 +991,12 @@ public:
         }
 
         core::NameRef op;
-        if (oper->string() == "+") {
+        if (oper->view() == "+") {
             op = core::Names::unaryPlus();
-        } else if (oper->string() == "-") {
+        } else if (oper->view() == "-") {
             op = core::Names::unaryMinus();
         } else {
-            op = gs_.enterNameUTF8(oper->string());
+            op = gs_.enterNameUTF8(oper->view());
         }
 
         return make_unique<Send>(loc, std::move(receiver), op, sorbet::parser::NodeVec());
@@ -997,14 +1024,17 @@ public:
     }
 
     unique_ptr<Node> word(sorbet::parser::NodeVec parts) {
+        enterStrings(parts);
         core::Loc loc = collectionLoc(parts);
         return make_unique<DString>(loc, std::move(parts));
     }
 
     unique_ptr<Node> words_compose(const token *begin, sorbet::parser::NodeVec parts, const token *end) {
+        enterStrings(parts);
         return make_unique<Array>(collectionLoc(begin, parts, end), std::move(parts));
     }
 
+    // Like `string_compose`, the `String`s in `parts` are given names by the `dedentString` that follows.
     unique_ptr<Node> xstring_compose(const token *begin, sorbet::parser::NodeVec parts, const token *end) {
         return make_unique<XString>(collectionLoc(begin, parts, end), std::move(parts));
     }
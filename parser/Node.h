@@ -1,3 +1,4 @@
+#include "common/SmallObjectPool.h"
 #include "common/common.h"
 #include "core/core.h"
 #include <memory>
@@ -11,6 +12,14 @@ public:
         ENFORCE(loc.exists(), "Location of parser node is none");
     }
     virtual ~Node() = default;
+    // Desugaring frees every node right after turning it into an ast::Expression, which comes from the same pool, so
+    // a file's parse tree and its desugared tree mostly share the same memory instead of both being live at once.
+    static void *operator new(size_t size) {
+        return SmallObjectPool::allocate(size);
+    }
+    static void operator delete(void *ptr, size_t size) {
+        SmallObjectPool::deallocate(ptr, size);
+    }
     virtual std::string toStringWithTabs(const core::GlobalState &gs, int tabs = 0) const = 0;
     std::string toString(const core::GlobalState &gs) const {
         return toStringWithTabs(gs);
@@ -3,20 +3,23 @@
 #include "core/serialize/serialize.h"
 #include "payload/binary/binary.h"
 #include "payload/text/text.h"
+#include "spdlog/sinks/null_sink.h"
 
 using namespace std;
 
 namespace sorbet::payload {
 
 constexpr string_view GLOBAL_STATE_KEY = "GlobalState"sv;
+constexpr string_view TABLE_SIZES_KEY = "TableSizes"sv;
+constexpr int TABLE_SIZES_COUNT = 3;
 
 void createInitialGlobalState(unique_ptr<core::GlobalState> &gs, const realmain::options::Options &options,
-                              unique_ptr<KeyValueStore> &kvstore) {
+                              unique_ptr<KeyValueStore> &kvstore, WorkerPool *workers, string_view statePayload) {
     if (kvstore) {
         auto maybeGsBytes = kvstore->read(GLOBAL_STATE_KEY);
         if (maybeGsBytes) {
             Timer timeit(gs->tracer(), "read_global_state.kvstore");
-            core::serialize::Serializer::loadGlobalState(*gs, maybeGsBytes);
+            core::serialize::Serializer::loadGlobalState(*gs, maybeGsBytes, workers);
             for (unsigned int i = 1; i < gs->filesUsed(); i++) {
                 core::FileRef fref(i);
                 if (fref.dataAllowingUnsafe(*gs).sourceType == core::File::Type::Normal) {
@@ -26,6 +29,11 @@ void createInitialGlobalState(unique_ptr<core::GlobalState> &gs, const realmain:
             return;
         }
     }
+    if (!statePayload.empty()) {
+        Timer timeit(gs->tracer(), "read_global_state.load_state");
+        core::serialize::Serializer::loadGlobalState(*gs, (const u1 *)statePayload.data(), workers);
+        return;
+    }
     if (options.noStdlib) {
         gs->initEmpty();
         return;
@@ -37,16 +45,58 @@ void createInitialGlobalState(unique_ptr<core::GlobalState> &gs, const realmain:
         sorbet::rbi::polulateRBIsInto(gs);
     } else {
         Timer timeit(gs->tracer(), "read_global_state.binary");
-        core::serialize::Serializer::loadGlobalState(*gs, nameTablePayload);
+        // The payload is part of the executable, so it outlives `gs`.
+        core::serialize::Serializer::loadGlobalState(*gs, nameTablePayload, workers, true);
+    }
+}
+
+unique_ptr<core::GlobalState> copyPayloadGlobalState(shared_ptr<core::ErrorQueue> errorQueue) {
+    // Never changed once loaded. Copies only read it, which is safe from several threads at once.
+    static const unique_ptr<const core::GlobalState> payload = []() {
+        static auto logger = make_shared<spdlog::logger>("payload", make_shared<spdlog::sinks::null_sink_mt>());
+        auto gs = make_unique<core::GlobalState>(make_shared<core::ErrorQueue>(*logger, *logger));
+        realmain::options::Options emptyOpts;
+        unique_ptr<KeyValueStore> kvstore;
+        createInitialGlobalState(gs, emptyOpts, kvstore);
+        return unique_ptr<const core::GlobalState>(move(gs));
+    }();
+    auto gs = payload->deepCopy(true);
+    gs->errorQueue = move(errorQueue);
+    return gs;
+}
+
+bool writeGlobalState(core::GlobalState &gs, KeyValueStore &kvstore, WorkerPool *workers) {
+    if (!gs.wasModified() || gs.hadCriticalError()) {
+        return false;
     }
+    Timer timeit(gs.tracer(), "write_global_state.kvstore");
+    kvstore.write(GLOBAL_STATE_KEY, core::serialize::Serializer::storePayloadAndNameTable(gs, workers));
+    return true;
 }
 
 void retainGlobalState(unique_ptr<core::GlobalState> &gs, const realmain::options::Options &options,
-                       unique_ptr<KeyValueStore> &kvstore) {
-    if (kvstore && gs->wasModified() && !gs->hadCriticalError()) {
-        Timer timeit(gs->tracer(), "write_global_state.kvstore");
-        kvstore->write(GLOBAL_STATE_KEY, core::serialize::Serializer::storePayloadAndNameTable(*gs));
+                       unique_ptr<KeyValueStore> &kvstore, WorkerPool *workers) {
+    if (kvstore && writeGlobalState(*gs, *kvstore, workers)) {
         KeyValueStore::commit(move(kvstore));
     }
 }
+
+void writeTableSizes(const core::GlobalState &gs, KeyValueStore &kvstore) {
+    const u4 sizes[TABLE_SIZES_COUNT] = {gs.namesUsed(), gs.symbolsUsed(), gs.filesUsed()};
+    vector<u1> value(sizeof(sizes));
+    memcpy(value.data(), sizes, sizeof(sizes));
+    kvstore.write(TABLE_SIZES_KEY, value);
+}
+
+void reserveTablesFromLastRun(core::GlobalState &gs, KeyValueStore &kvstore) {
+    auto *value = kvstore.read(TABLE_SIZES_KEY);
+    if (value == nullptr) {
+        return;
+    }
+    u4 sizes[TABLE_SIZES_COUNT];
+    memcpy(sizes, value, sizeof(sizes));
+    // Leave some room for what was added since.
+    auto withSlack = [](u4 size) { return size + size / 8; };
+    gs.reserveTables(withSlack(sizes[0]), withSlack(sizes[1]), withSlack(sizes[2]));
+}
 } // namespace sorbet::payload
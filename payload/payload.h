@@ -1,5 +1,6 @@
 #ifndef RUBY_TYPER_PAYLOAD_H
 #define RUBY_TYPER_PAYLOAD_H
+#include "common/concurrency/WorkerPool.h"
 #include "common/kvstore/KeyValueStore.h"
 #include "core/GlobalState.h"
 #include "main/options/options.h"
@@ -7,10 +8,27 @@
 
 namespace sorbet::payload {
 
+// If `workers` is given, it is used to decompress the payload in parallel. If `statePayload` isn't empty, it is a state
+// stored with `--store-state`, which is loaded in place of the payload built into the executable.
 void createInitialGlobalState(std::unique_ptr<core::GlobalState> &gs, const realmain::options::Options &options,
-                              std::unique_ptr<KeyValueStore> &kvstore);
+                              std::unique_ptr<KeyValueStore> &kvstore, WorkerPool *workers = nullptr,
+                              std::string_view statePayload = "");
+// A new state with what `createInitialGlobalState` loads from the payload built into the executable, reporting to
+// `errorQueue`. The payload is only loaded by the first call in the process. Every state returned shares its names and
+// symbols with that one until it changes them, so later calls cost little more than allocating the state.
+std::unique_ptr<core::GlobalState> copyPayloadGlobalState(std::shared_ptr<core::ErrorQueue> errorQueue);
+// Writes the name table of `gs` to `kvstore` if it changed, so that the trees cached alongside it can be loaded by a
+// later run. Unlike retainGlobalState, leaves committing to the caller. Returns whether anything was written. If
+// `workers` is given, the name table is serialized in parallel on it.
+bool writeGlobalState(core::GlobalState &gs, KeyValueStore &kvstore, WorkerPool *workers = nullptr);
 void retainGlobalState(std::unique_ptr<core::GlobalState> &gs, const realmain::options::Options &options,
-                       std::unique_ptr<KeyValueStore> &kvstore);
+                       std::unique_ptr<KeyValueStore> &kvstore, WorkerPool *workers = nullptr);
+// Records how many names, symbols and files `gs` ended up with, for `reserveTablesFromLastRun`. Leaves committing to
+// the caller.
+void writeTableSizes(const core::GlobalState &gs, KeyValueStore &kvstore);
+// Pre-sizes the tables of `gs` for what the last run that called `writeTableSizes` on this cache ended up with, so
+// that indexing doesn't have to rehash names or grow the symbol table. Does nothing if no sizes were recorded.
+void reserveTablesFromLastRun(core::GlobalState &gs, KeyValueStore &kvstore);
 
 } // namespace sorbet::payload
 #endif // RUBY_TYPER_PAYLOAD_H
@@ -3,6 +3,7 @@
 #include "core/Unfreeze.h"
 #include "main/pipeline/pipeline.h"
 #include "payload/text/text.h"
+#include <thread>
 using namespace std;
 
 namespace sorbet::rbi {
@@ -20,10 +21,13 @@ void polulateRBIsInto(unique_ptr<core::GlobalState> &gs) {
         }
     }
     realmain::options::Options emptyOpts;
+    // Sized the way `--max-threads` sizes the pool for the files given on the command line. The default options have
+    // no threads, which would index and resolve every RBI on this thread alone.
+    emptyOpts.threads = min(int(thread::hardware_concurrency()), int(payloadFiles.size() / 2));
     unique_ptr<KeyValueStore> kvstore;
     auto workers = WorkerPool::create(emptyOpts.threads, gs->tracer());
     auto indexed = realmain::pipeline::index(gs, payloadFiles, emptyOpts, *workers, kvstore);
-    realmain::pipeline::resolve(gs, move(indexed), emptyOpts, *workers); // result is thrown away
+    realmain::pipeline::resolve(gs, move(indexed), emptyOpts, *workers, kvstore); // result is thrown away
     gs->ensureCleanStrings = false;
 }
 
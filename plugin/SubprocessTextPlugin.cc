@@ -1,7 +1,12 @@
 #include "plugin/SubprocessTextPlugin.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/str_replace.h"
 #include "ast/treemap/treemap.h"
+#include "common/FileOps.h"
 #include "common/Subprocess.h"
+#include "common/crypto_hashing/crypto_hashing.h"
+#include "common/kvstore/KeyValueStore.h"
 #include "core/errors/plugin.h"
 
 using namespace std;
@@ -41,11 +46,54 @@ private:
     }
 };
 
+string hexHash(string_view data) {
+    auto hashBytes = crypto_hashing::hash64(data);
+    return absl::BytesToHexString(string_view{(char *)hashBytes.data(), size(hashBytes)});
+}
+
 struct SpawningWalker {
     vector<shared_ptr<core::File>> subprocessResults;
     InlinedVector<Namespace, 5> nesting;
+    const unique_ptr<KeyValueStore> &kvstore;
+    vector<pair<string, string>> &outputsToCache;
+    // Hashes of the plugin scripts, which are part of the cache key so that editing a plugin invalidates its outputs.
+    UnorderedMap<string, string> commandHashes;
+
+    SpawningWalker(const unique_ptr<KeyValueStore> &kvstore, vector<pair<string, string>> &outputsToCache)
+        : kvstore(kvstore), outputsToCache(outputsToCache) {}
+
+    string_view commandHash(const string &command) {
+        auto &hash = commandHashes[command];
+        if (hash.empty()) {
+            string script;
+            try {
+                script = FileOps::read(command);
+            } catch (FileNotFoundException &) {
+                // Not a path to a script, so the command itself is all there is to hash.
+            }
+            hash = hexHash(script);
+        }
+        return hash;
+    }
 
-    SpawningWalker() {}
+    // Plugins are expected to be deterministic, so their output only depends on the plugin and its arguments.
+    optional<string> runPlugin(const string &command, vector<string> args) {
+        if (!kvstore) {
+            return Subprocess::spawn("ruby", move(args));
+        }
+        auto key =
+            fmt::format("dslplugin//{}//{}", commandHash(command), hexHash(absl::StrJoin(args, string(1, '\0'))));
+        if (kvstore->read(key) != nullptr) {
+            prodCounterInc("types.input.dslplugin.kvstore.hit");
+            return string(kvstore->readString(key));
+        }
+        prodCounterInc("types.input.dslplugin.kvstore.miss");
+        auto output = Subprocess::spawn("ruby", move(args));
+        if (output) {
+            outputsToCache.emplace_back(move(key), *output);
+        }
+        return output;
+    }
 
     unique_ptr<ast::ClassDef> preTransformClassDef(core::Context ctx, unique_ptr<ast::ClassDef> klass) {
         if (klass->symbol == core::Symbols::root()) {
@@ -77,7 +125,7 @@ struct SpawningWalker {
                 args.emplace_back("--source");
                 args.emplace_back(move(sendSource));
 
-                output = Subprocess::spawn("ruby", move(args));
+                output = runPlugin(string(*command), move(args));
             }
 
             if (output) {
@@ -128,12 +176,13 @@ struct SpawningWalker {
 };
 
 pair<unique_ptr<ast::Expression>, vector<shared_ptr<core::File>>>
-SubprocessTextPlugin::run(core::Context ctx, unique_ptr<ast::Expression> tree) {
+SubprocessTextPlugin::run(core::Context ctx, unique_ptr<ast::Expression> tree, const unique_ptr<KeyValueStore> &kvstore,
+                          vector<pair<string, string>> &outputsToCache) {
     if (!ctx.state.hasAnyDslPlugin()) {
         vector<shared_ptr<core::File>> empty;
         return {move(tree), empty};
     }
-    SpawningWalker walker;
+    SpawningWalker walker(kvstore, outputsToCache);
     return {ast::TreeMap::apply(ctx, walker, move(tree)), move(walker.subprocessResults)};
 }
 
@@ -2,12 +2,22 @@
 #define SORBET_PLUGIN_SUBPROCESS_TEXT_H
 #include "ast/ast.h"
 
+namespace sorbet {
+class KeyValueStore;
+}
+
 namespace sorbet::plugin {
 
 class SubprocessTextPlugin final {
 public:
+    /**
+     * Runs the DSL plugins for the calls in `tree` and returns the files they generated. If `kvstore` is given, plugins
+     * are only run for calls they haven't been run for before; the outputs of the ones that are run are appended to
+     * `outputsToCache` as key-value pairs, for the thread that created `kvstore` to write.
+     */
     static std::pair<std::unique_ptr<ast::Expression>, std::vector<std::shared_ptr<core::File>>>
-    run(core::Context ctx, std::unique_ptr<ast::Expression> tree);
+    run(core::Context ctx, std::unique_ptr<ast::Expression> tree, const std::unique_ptr<KeyValueStore> &kvstore,
+        std::vector<std::pair<std::string, std::string>> &outputsToCache);
 
     SubprocessTextPlugin() = delete;
 };
@@ -327,20 +327,129 @@ InlinedVector<core::SymbolRef, 4> ParentLinearizationInformation::fullLinearizat
     return res;
 }
 
-void computeLinearization(core::GlobalState &gs) {
+// How many classes of a level one task computes.
+constexpr int LINEARIZATION_CHUNK_SIZE = 64;
+
+// Classes are computed level by level, where a class's level is one more than the highest of its superclass's and
+// mixins', so that a level only reads the linearizations of lower levels and its classes can be computed concurrently.
+struct LinearizationSchedule {
+    static constexpr int UNVISITED = -1;
+    static constexpr int VISITING = -2;
+
+    // By symbol. 0 for classes whose linearization was already computed.
+    vector<int> levels;
+    // The classes to compute, in the order a depth-first walk of their parents finishes them. Errors are reported in
+    // this order, which is the order the serial computation would have reported them in.
+    vector<core::SymbolRef> order;
+    int maxLevel = 0;
+    // Set if some class is its own ancestor, which only the serial computation knows how to report.
+    bool hasLoop = false;
+
+    LinearizationSchedule(core::GlobalState &gs) : levels(gs.symbolsUsed(), UNVISITED) {
+        for (int i = 1; i < gs.symbolsUsed(); ++i) {
+            auto sym = core::SymbolRef(&gs, i);
+            if (sym.data(gs)->isClass()) {
+                visit(gs, sym);
+            }
+        }
+    }
+
+    int visit(core::GlobalState &gs, core::SymbolRef klass) {
+        // Also copies the part of the symbol table `klass` is in if another state shares it, which the workers
+        // computing linearizations mustn't do.
+        auto data = klass.data(gs);
+        if (levels[klass._id] == VISITING) {
+            hasLoop = true;
+            return 0;
+        }
+        if (levels[klass._id] != UNVISITED) {
+            return levels[klass._id];
+        }
+        if (data->isClassLinearizationComputed()) {
+            return levels[klass._id] = 0;
+        }
+        levels[klass._id] = VISITING;
+        int level = 1;
+        if (data->superClass().exists()) {
+            level = max(level, visit(gs, data->superClass()) + 1);
+        }
+        for (auto mixin : data->mixins()) {
+            level = max(level, visit(gs, mixin) + 1);
+        }
+        levels[klass._id] = level;
+        maxLevel = max(maxLevel, level);
+        order.emplace_back(klass);
+        return level;
+    }
+};
+
+struct LinearizationResult {
+    vector<core::ErrorQueueMessage> errors;
+    exception_ptr exception;
+};
+
+// TODO: this does not support `prepend`
+void computeLinearization(core::GlobalState &gs, WorkerPool &workers) {
     Timer timer(gs.errorQueue->logger, "resolver.compute_linearization");
 
-    // TODO: this does not support `prepend`
-    for (int i = 1; i < gs.symbolsUsed(); ++i) {
-        const auto &data = core::SymbolRef(&gs, i).data(gs);
-        if (!data->isClass()) {
-            continue;
+    LinearizationSchedule schedule(gs);
+    if (schedule.hasLoop) {
+        for (int i = 1; i < gs.symbolsUsed(); ++i) {
+            const auto &data = core::SymbolRef(&gs, i).data(gs);
+            if (!data->isClass()) {
+                continue;
+            }
+            computeLinearization(gs, core::SymbolRef(&gs, i));
+        }
+        return;
+    }
+
+    // Positions in `schedule.order`, by level.
+    vector<vector<int>> byLevel(schedule.maxLevel + 1);
+    for (int i = 0; i < schedule.order.size(); i++) {
+        byLevel[schedule.levels[schedule.order[i]._id]].emplace_back(i);
+    }
+    vector<LinearizationResult> results(schedule.order.size());
+    vector<CounterState> counters;
+    bool failed = false;
+    for (int level = 1; level <= schedule.maxLevel && !failed; level++) {
+        auto &classes = byLevel[level];
+        int chunks = (classes.size() + LINEARIZATION_CHUNK_SIZE - 1) / LINEARIZATION_CHUNK_SIZE;
+        vector<CounterState> levelCounters(chunks);
+        WorkerPool::TaskGroup group;
+        for (int chunk = 0; chunk < chunks; chunk++) {
+            workers.submit(group, [&gs, &schedule, &classes, &results, &levelCounters, chunk]() {
+                auto end = min<size_t>((chunk + 1) * LINEARIZATION_CHUNK_SIZE, classes.size());
+                for (int i = chunk * LINEARIZATION_CHUNK_SIZE; i < end; i++) {
+                    auto &result = results[classes[i]];
+                    core::ErrorQueue::CaptureErrors capture(*gs.errorQueue, result.errors);
+                    try {
+                        computeLinearization(gs, schedule.order[classes[i]]);
+                    } catch (SorbetException &) {
+                        result.exception = current_exception();
+                    }
+                }
+                levelCounters[chunk] = getAndClearThreadCounters();
+            });
+        }
+        workers.wait(group);
+        for (auto i : classes) {
+            failed = failed || results[i].exception != nullptr;
+        }
+        move(levelCounters.begin(), levelCounters.end(), back_inserter(counters));
+    }
+    for (auto &counter : counters) {
+        counterConsume(move(counter));
+    }
+    for (auto &result : results) {
+        gs.errorQueue->pushCapturedErrors(move(result.errors));
+        if (result.exception) {
+            rethrow_exception(result.exception);
         }
-        computeLinearization(gs, core::SymbolRef(&gs, i));
     }
 }
 
-void Resolver::finalizeSymbols(core::GlobalState &gs) {
+void Resolver::finalizeSymbols(core::GlobalState &gs, WorkerPool &workers) {
     Timer timer(gs.errorQueue->logger, "resolver.finalize_resolution");
     // TODO(nelhage): Properly this first loop should go in finalizeAncestors,
     // but we currently compute mixes_in_class_methods during the same AST walk
@@ -366,7 +475,8 @@ void Resolver::finalizeSymbols(core::GlobalState &gs) {
         }
     }
 
-    computeLinearization(gs);
+    computeLinearization(gs, workers);
+    gs.computeAncestorCache();
 
     vector<vector<pair<core::SymbolRef, core::SymbolRef>>> typeAliases;
     typeAliases.resize(gs.symbolsUsed());
@@ -2,6 +2,7 @@
 #include "ast/Helpers.h"
 #include "ast/Trees.h"
 #include "ast/ast.h"
+#include "ast/treemap/parallel.h"
 #include "ast/treemap/treemap.h"
 #include "core/Error.h"
 #include "core/Names.h"
@@ -638,6 +639,33 @@ public:
         return lhs.endPos() < rhs.endPos();
     }
 
+    static UnorderedSet<core::NameRef> collectDefinedConstantNames(const core::GlobalState &gs) {
+        UnorderedSet<core::NameRef> names;
+        for (int i = 1; i < gs.symbolsUsed(); ++i) {
+            for (auto member : core::SymbolRef(&gs, i).data(gs)->members()) {
+                if (member.first.data(gs)->kind == core::NameKind::CONSTANT) {
+                    names.insert(member.first);
+                }
+            }
+        }
+        return names;
+    }
+
+    // Whether `job`, which failed on its last attempt, could succeed now. A constant without a scope is looked up
+    // through the nesting and then the ancestors of the innermost scope, of which only the latter can change. Either
+    // kind may have found a type alias that had yet to be resolved. A scoped constant also depends on its scope, which
+    // is resolved by a job in this same list, so those are retried whenever anything made progress.
+    static bool mayHaveBecomeResolvable(const ResolutionItem &job, const UnorderedSet<core::NameRef> &definedNames,
+                                        bool ancestorsChanged, bool typeAliasesChanged) {
+        if (!definedNames.contains(job.out->original->cnst)) {
+            return false;
+        }
+        if (ast::isa_tree<ast::EmptyTree>(job.out->original->scope.get())) {
+            return ancestorsChanged || typeAliasesChanged;
+        }
+        return true;
+    }
+
     static vector<ast::ParsedFile> resolveConstants(core::MutableContext ctx, vector<ast::ParsedFile> trees,
                                                     WorkerPool &workers) {
         Timer timeit(ctx.state.errorQueue->logger, "resolver.resolve_constants");
@@ -709,11 +737,20 @@ public:
 
         Timer timeit1(ctx.state.errorQueue->logger, "resolver.resolve_constants.fixed_point");
 
+        // Namer has entered every constant there is, so a constant whose name is no member of anything will never
+        // resolve, however often we retry it.
+        auto definedConstantNames = todo.empty() ? UnorderedSet<core::NameRef>() : collectDefinedConstantNames(ctx);
+
         bool progress = true;
         bool first = true; // we need to run at least once to force class aliases and type aliases
+        // Whether the last iteration resolved a type alias, which a constant referring to it may have been waiting on.
+        bool typeAliasesChanged = true;
 
         while (progress && (first || !todo.empty() || !todoAncestors.empty())) {
+            // Before the first iteration, constants were only tried during the tree walk, before any ancestors were.
+            const bool retryAll = first;
             first = false;
+            bool ancestorsChanged;
             counterInc("resolve.constants.retries");
             {
                 Timer timeit(ctx.state.errorQueue->logger, "resolver.resolve_constants.fixed_point.ancestors");
@@ -730,17 +767,27 @@ public:
                         return resolved;
                     });
                 todoAncestors.erase(it, todoAncestors.end());
-                progress = (origSize != todoAncestors.size());
+                ancestorsChanged = (origSize != todoAncestors.size());
+                progress = ancestorsChanged;
                 categoryCounterAdd("resolve.constants.ancestor", "retry", origSize - todoAncestors.size());
             }
             {
                 Timer timeit(ctx.state.errorQueue->logger, "resolver.resolve_constants.fixed_point.constants");
                 int origSize = todo.size();
-                auto it = remove_if(todo.begin(), todo.end(),
-                                    [ctx](ResolutionItem &job) -> bool { return resolveJob(ctx, job); });
+                int skipped = 0;
+                auto it = remove_if(todo.begin(), todo.end(), [&](ResolutionItem &job) -> bool {
+                    if (!isAlreadyResolved(ctx, *job.out) &&
+                        !mayHaveBecomeResolvable(job, definedConstantNames, retryAll || ancestorsChanged,
+                                                 typeAliasesChanged)) {
+                        skipped++;
+                        return false;
+                    }
+                    return resolveJob(ctx, job);
+                });
                 todo.erase(it, todo.end());
                 progress = progress || (origSize != todo.size());
                 categoryCounterAdd("resolve.constants.nonancestor", "retry", origSize - todo.size());
+                categoryCounterAdd("resolve.constants.nonancestor", "skipped", skipped);
             }
             {
                 Timer timeit(ctx.state.errorQueue->logger, "resolver.resolve_constants.fixed_point.class_aliases");
@@ -764,7 +811,8 @@ public:
                     remove_if(todoTypeAliases.begin(), todoTypeAliases.end(),
                               [ctx](TypeAliasResolutionItem &it) -> bool { return resolveTypeAliasJob(ctx, it); });
                 todoTypeAliases.erase(it, todoTypeAliases.end());
-                progress = progress || (origSize != todoTypeAliases.size());
+                typeAliasesChanged = (origSize != todoTypeAliases.size());
+                progress = progress || typeAliasesChanged;
                 categoryCounterAdd("resolve.constants.typealiases", "retry", origSize - todoTypeAliases.size());
             }
         }
@@ -822,124 +870,344 @@ public:
     }
 };
 
+/*
+ * The passes below only mutate global state at a handful of well-defined points. We walk the trees in parallel with an
+ * immutable context, collecting the nodes that need those mutations, and then apply the collected items on the main
+ * thread in (file, position) order, which is exactly the order the old serial walk would have visited them. This keeps
+ * both the resulting symbol table and the order errors are reported in identical to a single-threaded run.
+ */
+template <class Walker> struct TreeWalkResult {
+    vector<typename Walker::Item> todo;
+    vector<ast::ParsedFile> trees;
+};
+
+template <class Walker>
+vector<typename Walker::Item> collectInParallel(core::MutableContext ctx, vector<ast::ParsedFile> &trees,
+                                                WorkerPool &workers, ConstExprStr jobName) {
+    core::Context ictx = ctx;
+    auto resultq = make_shared<BlockingBoundedQueue<TreeWalkResult<Walker>>>(trees.size());
+    auto fileq = make_shared<ConcurrentBoundedQueue<ast::ParsedFile>>(trees.size());
+    for (auto &tree : trees) {
+        fileq->push(move(tree), 1);
+    }
+
+    workers.multiplexJob(jobName, [ictx, fileq, resultq]() {
+        Walker walker;
+        vector<ast::ParsedFile> walkedTrees;
+        ast::ParsedFile job;
+        for (auto result = fileq->try_pop(job); !result.done(); result = fileq->try_pop(job)) {
+            if (result.gotItem()) {
+                job.tree = ast::TreeMap::apply(ictx, walker, std::move(job.tree));
+                walkedTrees.emplace_back(move(job));
+            }
+        }
+        if (!walkedTrees.empty()) {
+            TreeWalkResult<Walker> result{move(walker.todo_), move(walkedTrees)};
+            auto computedTreesCount = result.trees.size();
+            resultq->push(move(result), computedTreesCount);
+        }
+    });
+    trees.clear();
+
+    vector<typename Walker::Item> todo;
+    {
+        TreeWalkResult<Walker> threadResult;
+        for (auto result = resultq->wait_pop_timed(threadResult, WorkerPool::BLOCK_INTERVAL(), ctx.state.tracer());
+             !result.done();
+             result = resultq->wait_pop_timed(threadResult, WorkerPool::BLOCK_INTERVAL(), ctx.state.tracer())) {
+            if (result.gotItem()) {
+                todo.insert(todo.end(), make_move_iterator(threadResult.todo.begin()),
+                            make_move_iterator(threadResult.todo.end()));
+                trees.insert(trees.end(), make_move_iterator(threadResult.trees.begin()),
+                             make_move_iterator(threadResult.trees.end()));
+            }
+        }
+    }
+
+    fast_sort(todo, [](const auto &lhs, const auto &rhs) -> bool {
+        return ResolveConstantsWalk::locCompare(lhs.loc(), rhs.loc());
+    });
+    fast_sort(trees, [](const auto &lhs, const auto &rhs) -> bool {
+        return ResolveConstantsWalk::locCompare(lhs.tree->loc, rhs.tree->loc);
+    });
+    return todo;
+}
+
 class ResolveTypeParamsWalk {
 public:
-    unique_ptr<ast::Assign> postTransformAssign(core::MutableContext ctx, unique_ptr<ast::Assign> asgn) {
+    struct Item {
+        core::SymbolRef owner;
+        // Points into a tree owned by the caller of `collectInParallel`; the trees outlive the items.
+        ast::Assign *asgn;
+
+        core::Loc loc() const {
+            return asgn->loc;
+        }
+    };
+    vector<Item> todo_;
+
+    unique_ptr<ast::Assign> postTransformAssign(core::Context ctx, unique_ptr<ast::Assign> asgn) {
         auto *id = ast::cast_tree<ast::ConstantLit>(asgn->lhs.get());
         if (id == nullptr || !id->symbol.exists()) {
             return asgn;
         }
 
+        auto data = id->symbol.data(ctx);
+        if (!data->isTypeAlias() && data->isTypeMember()) {
+            todo_.emplace_back(Item{ctx.owner, asgn.get()});
+        }
+        return asgn;
+    }
+
+    static void resolveTypeMember(core::MutableContext ctx, ast::Assign *asgn) {
+        auto *id = ast::cast_tree<ast::ConstantLit>(asgn->lhs.get());
+        ENFORCE(id != nullptr && id->symbol.exists());
+
         auto sym = id->symbol;
         auto data = sym.data(ctx);
-        if (data->isTypeAlias()) {
-            return asgn;
+        ENFORCE(data->isTypeMember());
+        auto send = ast::cast_tree<ast::Send>(asgn->rhs.get());
+        ENFORCE(send->recv->isSelfReference());
+        ENFORCE(send->fun == core::Names::typeMember() || send->fun == core::Names::typeTemplate());
+        auto *memberType = core::cast_type<core::LambdaParam>(data->resultType.get());
+        ENFORCE(memberType != nullptr);
+
+        // NOTE: the resultType is set back in the namer to be a LambdaParam
+        // with `T.untyped` for its bounds. We fix that here by setting the
+        // bounds to top and bottom.
+        memberType->lowerBound = core::Types::bottom();
+        memberType->upperBound = core::Types::top();
+
+        core::LambdaParam *parentType = nullptr;
+        auto parentMember = data->owner.data(ctx)->superClass().data(ctx)->findMember(ctx, data->name);
+        if (parentMember.exists()) {
+            if (parentMember.data(ctx)->isTypeMember()) {
+                parentType = core::cast_type<core::LambdaParam>(parentMember.data(ctx)->resultType.get());
+                ENFORCE(parentType != nullptr);
+            } else if (auto e = ctx.state.beginError(send->loc, core::errors::Resolver::ParentTypeBoundsMismatch)) {
+                const auto parentShow = parentMember.data(ctx)->show(ctx);
+                e.setHeader("`{}` is a type member but `{}` is not a type member", data->show(ctx), parentShow);
+                e.addErrorLine(parentMember.data(ctx)->loc(), "`{}` definition", parentShow);
+            }
+        }
+
+        // When no args are supplied, this implies that the upper and lower
+        // bounds of the type parameter are top and bottom.
+        ast::Hash *hash = nullptr;
+        if (send->args.size() == 1) {
+            hash = ast::cast_tree<ast::Hash>(send->args[0].get());
+        } else if (send->args.size() == 2) {
+            hash = ast::cast_tree<ast::Hash>(send->args[1].get());
+        }
+
+        if (hash) {
+            int i = -1;
+            for (auto &keyExpr : hash->keys) {
+                i++;
+                auto lit = ast::cast_tree<ast::Literal>(keyExpr.get());
+                if (lit && lit->isSymbol(ctx)) {
+                    ParsedSig emptySig;
+                    auto allowSelfType = true;
+                    auto allowRebind = false;
+                    auto allowTypeMember = false;
+                    core::TypePtr resTy =
+                        TypeSyntax::getResultType(ctx, *(hash->values[i]), emptySig,
+                                                  TypeSyntaxArgs{allowSelfType, allowRebind, allowTypeMember, sym});
+
+                    switch (lit->asSymbol(ctx)._id) {
+                        case core::Names::fixed()._id:
+                            memberType->lowerBound = resTy;
+                            memberType->upperBound = resTy;
+                            break;
+
+                        case core::Names::lower()._id:
+                            memberType->lowerBound = resTy;
+                            break;
+
+                        case core::Names::upper()._id:
+                            memberType->upperBound = resTy;
+                            break;
+                    }
+                }
+            }
         }
 
-        if (data->isTypeMember()) {
-            auto send = ast::cast_tree<ast::Send>(asgn->rhs.get());
-            ENFORCE(send->recv->isSelfReference());
-            ENFORCE(send->fun == core::Names::typeMember() || send->fun == core::Names::typeTemplate());
-            auto *memberType = core::cast_type<core::LambdaParam>(data->resultType.get());
-            ENFORCE(memberType != nullptr);
-
-            // NOTE: the resultType is set back in the namer to be a LambdaParam
-            // with `T.untyped` for its bounds. We fix that here by setting the
-            // bounds to top and bottom.
-            memberType->lowerBound = core::Types::bottom();
-            memberType->upperBound = core::Types::top();
-
-            core::LambdaParam *parentType = nullptr;
-            auto parentMember = data->owner.data(ctx)->superClass().data(ctx)->findMember(ctx, data->name);
-            if (parentMember.exists()) {
-                if (parentMember.data(ctx)->isTypeMember()) {
-                    parentType = core::cast_type<core::LambdaParam>(parentMember.data(ctx)->resultType.get());
-                    ENFORCE(parentType != nullptr);
-                } else if (auto e = ctx.state.beginError(send->loc, core::errors::Resolver::ParentTypeBoundsMismatch)) {
-                    const auto parentShow = parentMember.data(ctx)->show(ctx);
-                    e.setHeader("`{}` is a type member but `{}` is not a type member", data->show(ctx), parentShow);
-                    e.addErrorLine(parentMember.data(ctx)->loc(), "`{}` definition", parentShow);
+        // If the parent bounds existis, validate the new bounds against
+        // those of the parent.
+        // NOTE: these errors could be better for cases involving
+        // `fixed`.
+        if (parentType != nullptr) {
+            if (!core::Types::isSubType(ctx, parentType->lowerBound, memberType->lowerBound)) {
+                if (auto e = ctx.state.beginError(send->loc, core::errors::Resolver::ParentTypeBoundsMismatch)) {
+                    e.setHeader("parent lower bound `{}` is not a subtype of lower bound `{}`",
+                                parentType->lowerBound->show(ctx), memberType->lowerBound->show(ctx));
+                }
+            }
+            if (!core::Types::isSubType(ctx, memberType->upperBound, parentType->upperBound)) {
+                if (auto e = ctx.state.beginError(send->loc, core::errors::Resolver::ParentTypeBoundsMismatch)) {
+                    e.setHeader("upper bound `{}` is not a subtype of parent upper bound `{}`",
+                                memberType->upperBound->show(ctx), parentType->upperBound->show(ctx));
                 }
             }
+        }
 
-            // When no args are supplied, this implies that the upper and lower
-            // bounds of the type parameter are top and bottom.
-            ast::Hash *hash = nullptr;
-            if (send->args.size() == 1) {
-                hash = ast::cast_tree<ast::Hash>(send->args[0].get());
-            } else if (send->args.size() == 2) {
-                hash = ast::cast_tree<ast::Hash>(send->args[1].get());
+        // Ensure that the new lower bound is a subtype of the upper
+        // bound. This will be a no-op in the case that the type member
+        // is fixed.
+        if (!core::Types::isSubType(ctx, memberType->lowerBound, memberType->upperBound)) {
+            if (auto e = ctx.state.beginError(send->loc, core::errors::Resolver::InvalidTypeMemberBounds)) {
+                e.setHeader("`{}` is not a subtype of `{}`", memberType->lowerBound->show(ctx),
+                            memberType->upperBound->show(ctx));
             }
+        }
+    }
+};
 
-            if (hash) {
-                int i = -1;
-                for (auto &keyExpr : hash->keys) {
-                    i++;
-                    auto lit = ast::cast_tree<ast::Literal>(keyExpr.get());
-                    if (lit && lit->isSymbol(ctx)) {
-                        ParsedSig emptySig;
-                        auto allowSelfType = true;
-                        auto allowRebind = false;
-                        auto allowTypeMember = false;
-                        core::TypePtr resTy =
-                            TypeSyntax::getResultType(ctx, *(hash->values[i]), emptySig,
-                                                      TypeSyntaxArgs{allowSelfType, allowRebind, allowTypeMember, sym});
-
-                        switch (lit->asSymbol(ctx)._id) {
-                            case core::Names::fixed()._id:
-                                memberType->lowerBound = resTy;
-                                memberType->upperBound = resTy;
-                                break;
-
-                            case core::Names::lower()._id:
-                                memberType->lowerBound = resTy;
-                                break;
-
-                            case core::Names::upper()._id:
-                                memberType->upperBound = resTy;
-                                break;
-                        }
-                    }
+class ResolveSignaturesWalk {
+private:
+    std::vector<int> nestedBlockCounts;
+
+    // Sigs that parsed without reporting any errors, by owner and `appendSigKey`. Most sigs in a codebase have one of a
+    // few shapes (`sig {void}`, `sig {returns(String)}`, ...), and parsing one of those again gives the same types.
+    UnorderedMap<string, ParsedSig> parsedSigs;
+
+    // Describes `expr` in `key`, so that sigs with the same key parse to the same types for the same owner. Returns
+    // false for syntax that isn't described, in which case the sig isn't cached.
+    static bool appendSigKey(core::Context ctx, ast::Expression *expr, string &key, bool &mentionsUntyped) {
+        bool ok = true;
+        typecase(
+            expr,
+            [&](ast::Send *send) {
+                if (send->fun == core::Names::untyped()) {
+                    mentionsUntyped = true;
                 }
-            }
+                absl::StrAppend(&key, "(", send->fun._id, " ");
+                ok = appendSigKey(ctx, send->recv.get(), key, mentionsUntyped);
+                for (auto &arg : send->args) {
+                    ok = ok && appendSigKey(ctx, arg.get(), key, mentionsUntyped);
+                }
+                if (send->block != nullptr) {
+                    ok = ok && appendSigKey(ctx, send->block.get(), key, mentionsUntyped);
+                }
+                key += ')';
+            },
+            [&](ast::Block *block) {
+                key += "B{";
+                ok = block->args.empty() && appendSigKey(ctx, block->body.get(), key, mentionsUntyped);
+                key += '}';
+            },
+            [&](ast::InsSeq *insSeq) {
+                key += "I[";
+                for (auto &stat : insSeq->stats) {
+                    ok = ok && appendSigKey(ctx, stat.get(), key, mentionsUntyped);
+                }
+                ok = ok && appendSigKey(ctx, insSeq->expr.get(), key, mentionsUntyped);
+                key += ']';
+            },
+            [&](ast::Hash *hash) {
+                key += "H{";
+                for (int i = 0; i < hash->keys.size(); i++) {
+                    ok = ok && appendSigKey(ctx, hash->keys[i].get(), key, mentionsUntyped) &&
+                         appendSigKey(ctx, hash->values[i].get(), key, mentionsUntyped);
+                }
+                key += '}';
+            },
+            [&](ast::Array *array) {
+                key += "A[";
+                for (auto &elem : array->elems) {
+                    ok = ok && appendSigKey(ctx, elem.get(), key, mentionsUntyped);
+                }
+                key += ']';
+            },
+            [&](ast::Literal *lit) {
+                auto shown = lit->value->show(ctx);
+                absl::StrAppend(&key, "L", shown.size(), ":", shown);
+            },
+            [&](ast::ConstantLit *cnst) {
+                // Constants that didn't resolve are all stubbed with the same symbol.
+                ok = cnst->symbol.exists() && cnst->symbol != core::Symbols::StubModule();
+                absl::StrAppend(&key, "C", cnst->symbol._id, " ");
+            },
+            [&](ast::Local *local) {
+                ok = local->isSelfReference();
+                key += 'S';
+            },
+            [&](ast::Expression *other) { ok = false; });
+        return ok;
+    }
 
-            // If the parent bounds existis, validate the new bounds against
-            // those of the parent.
-            // NOTE: these errors could be better for cases involving
-            // `fixed`.
-            if (parentType != nullptr) {
-                if (!core::Types::isSubType(ctx, parentType->lowerBound, memberType->lowerBound)) {
-                    if (auto e = ctx.state.beginError(send->loc, core::errors::Resolver::ParentTypeBoundsMismatch)) {
-                        e.setHeader("parent lower bound `{}` is not a subtype of lower bound `{}`",
-                                    parentType->lowerBound->show(ctx), memberType->lowerBound->show(ctx));
-                    }
+    // The locs parseSig gives the arguments of `sig`, in the order of `ParsedSig::argTypes`.
+    static vector<core::Loc> sigArgLocs(core::Context ctx, ast::Send *sig) {
+        vector<core::Loc> locs;
+        auto *block = ast::cast_tree<ast::Block>(sig->block.get());
+        vector<ast::Expression *> stats;
+        if (auto *insSeq = ast::cast_tree<ast::InsSeq>(block->body.get())) {
+            for (auto &stat : insSeq->stats) {
+                stats.emplace_back(stat.get());
+            }
+            stats.emplace_back(insSeq->expr.get());
+        } else {
+            stats.emplace_back(block->body.get());
+        }
+        for (auto *stat : stats) {
+            for (auto *send = ast::cast_tree<ast::Send>(stat); send != nullptr;
+                 send = ast::cast_tree<ast::Send>(send->recv.get())) {
+                if (send->fun != core::Names::params() || send->args.size() != 1) {
+                    continue;
+                }
+                auto *hash = ast::cast_tree<ast::Hash>(send->args[0].get());
+                if (hash == nullptr) {
+                    continue;
                 }
-                if (!core::Types::isSubType(ctx, memberType->upperBound, parentType->upperBound)) {
-                    if (auto e = ctx.state.beginError(send->loc, core::errors::Resolver::ParentTypeBoundsMismatch)) {
-                        e.setHeader("upper bound `{}` is not a subtype of parent upper bound `{}`",
-                                    memberType->upperBound->show(ctx), parentType->upperBound->show(ctx));
+                for (auto &key : hash->keys) {
+                    auto *lit = ast::cast_tree<ast::Literal>(key.get());
+                    if (lit && lit->isSymbol(ctx)) {
+                        locs.emplace_back(key->loc);
                     }
                 }
             }
+        }
+        return locs;
+    }
 
-            // Ensure that the new lower bound is a subtype of the upper
-            // bound. This will be a no-op in the case that the type member
-            // is fixed.
-            if (!core::Types::isSubType(ctx, memberType->lowerBound, memberType->upperBound)) {
-                if (auto e = ctx.state.beginError(send->loc, core::errors::Resolver::InvalidTypeMemberBounds)) {
-                    e.setHeader("`{}` is not a subtype of `{}`", memberType->lowerBound->show(ctx),
-                                memberType->upperBound->show(ctx));
+    ParsedSig parseSig(core::MutableContext ctx, ast::Send *sig, const ast::MethodDef &mdef) {
+        auto allowSelfType = true;
+        auto allowRebind = false;
+        auto allowTypeMember = true;
+        TypeSyntaxArgs args{allowSelfType, allowRebind, allowTypeMember, mdef.symbol};
+
+        string key = absl::StrCat(ctx.owner._id, ":");
+        bool mentionsUntyped = false;
+        // In debug builds, `T.untyped` is blamed on the method it's written for.
+        bool cacheable = appendSigKey(ctx, sig, key, mentionsUntyped) && !(debug_mode && mentionsUntyped);
+        if (cacheable) {
+            auto it = parsedSigs.find(key);
+            if (it != parsedSigs.end()) {
+                counterInc("types.sig.cached");
+                auto parsed = it->second;
+                auto locs = sigArgLocs(ctx, sig);
+                ENFORCE(locs.size() == parsed.argTypes.size());
+                for (int i = 0; i < locs.size(); i++) {
+                    parsed.argTypes[i].loc = locs[i];
                 }
+                return parsed;
             }
         }
 
-        return asgn;
+        // Silenced errors count too: the same sig in a file with a stricter sigil would have to show them.
+        vector<core::ErrorQueueMessage> errors;
+        ParsedSig parsed;
+        {
+            core::ErrorQueue::CaptureErrors capture(*ctx.state.errorQueue, errors);
+            parsed = TypeSyntax::parseSig(ctx, sig, nullptr, args);
+        }
+        // Type parameters carry the locs they're declared at.
+        if (cacheable && errors.empty() && parsed.typeArgs.empty()) {
+            parsedSigs.emplace(move(key), parsed);
+        }
+        ctx.state.errorQueue->pushCapturedErrors(move(errors));
+        return parsed;
     }
-};
-
-class ResolveSignaturesWalk {
-private:
-    std::vector<int> nestedBlockCounts;
 
     ast::Local *getArgLocal(core::Context ctx, const core::ArgInfo &argSym, const ast::MethodDef &mdef, int pos,
                             bool isOverloaded) {
@@ -1279,12 +1547,7 @@ private:
                     }
 
                     while (i < lastSigs.size()) {
-                        auto allowSelfType = true;
-                        auto allowRebind = false;
-                        auto allowTypeMember = true;
-                        auto sig = TypeSyntax::parseSig(
-                            ctx.withOwner(sigOwner), ast::cast_tree<ast::Send>(lastSigs[i]), nullptr,
-                            TypeSyntaxArgs{allowSelfType, allowRebind, allowTypeMember, mdef->symbol});
+                        auto sig = parseSig(ctx.withOwner(sigOwner), ast::cast_tree<ast::Send>(lastSigs[i]), *mdef);
                         core::SymbolRef overloadSym;
                         if (isOverloaded) {
                             vector<int> argsToKeep;
@@ -1653,7 +1916,18 @@ public:
 };
 
 class ResolveMixesInClassMethodsWalk {
-    void processMixesInClassMethods(core::MutableContext ctx, ast::Send *send) {
+public:
+    struct Item {
+        core::SymbolRef owner;
+        unique_ptr<ast::Send> send;
+
+        core::Loc loc() const {
+            return send->loc;
+        }
+    };
+    vector<Item> todo_;
+
+    static void processMixesInClassMethods(core::MutableContext ctx, ast::Send *send) {
         if (!ctx.owner.data(ctx)->isClass() || !ctx.owner.data(ctx)->isClassModule()) {
             if (auto e = ctx.state.beginError(send->loc, core::errors::Resolver::InvalidMixinDeclaration)) {
                 e.setHeader("`{}` can only be declared inside a module, not a class", send->fun.data(ctx)->show(ctx));
@@ -1701,10 +1975,9 @@ class ResolveMixesInClassMethodsWalk {
         ctx.owner.data(ctx)->members()[core::Names::classMethods()] = id->symbol;
     }
 
-public:
-    unique_ptr<ast::Expression> postTransformSend(core::MutableContext ctx, unique_ptr<ast::Send> original) {
+    unique_ptr<ast::Expression> postTransformSend(core::Context ctx, unique_ptr<ast::Send> original) {
         if (original->recv->isSelfReference() && original->fun == core::Names::mixesInClassMethods()) {
-            processMixesInClassMethods(ctx, original.get());
+            todo_.emplace_back(Item{ctx.owner, move(original)});
             return ast::MK::EmptyTree();
         }
         return original;
@@ -1713,7 +1986,7 @@ public:
 
 class ResolveSanityCheckWalk {
 public:
-    unique_ptr<ast::Expression> postTransformClassDef(core::MutableContext ctx, unique_ptr<ast::ClassDef> original) {
+    unique_ptr<ast::Expression> postTransformClassDef(core::Context ctx, unique_ptr<ast::ClassDef> original) {
         ENFORCE(original->symbol != core::Symbols::todo(), "These should have all been resolved: {}",
                 original->toString(ctx));
         if (original->symbol == core::Symbols::root()) {
@@ -1723,18 +1996,17 @@ public:
         }
         return original;
     }
-    unique_ptr<ast::Expression> postTransformMethodDef(core::MutableContext ctx, unique_ptr<ast::MethodDef> original) {
+    unique_ptr<ast::Expression> postTransformMethodDef(core::Context ctx, unique_ptr<ast::MethodDef> original) {
         ENFORCE(original->symbol != core::Symbols::todo(), "These should have all been resolved: {}",
                 original->toString(ctx));
         return original;
     }
-    unique_ptr<ast::Expression> postTransformUnresolvedConstantLit(core::MutableContext ctx,
+    unique_ptr<ast::Expression> postTransformUnresolvedConstantLit(core::Context ctx,
                                                                    unique_ptr<ast::UnresolvedConstantLit> original) {
         ENFORCE(false, "These should have all been removed: {}", original->toString(ctx));
         return original;
     }
-    unique_ptr<ast::ConstantLit> postTransformConstantLit(core::MutableContext ctx,
-                                                          unique_ptr<ast::ConstantLit> original) {
+    unique_ptr<ast::ConstantLit> postTransformConstantLit(core::Context ctx, unique_ptr<ast::ConstantLit> original) {
         ENFORCE(ResolveConstantsWalk::isAlreadyResolved(ctx, *original));
         return original;
     }
@@ -1742,22 +2014,25 @@ public:
 }; // namespace
 
 vector<ast::ParsedFile> Resolver::run(core::MutableContext ctx, vector<ast::ParsedFile> trees, WorkerPool &workers) {
+    // Ancestors are about to change; finalizeSymbols computes the cache again.
+    ctx.state.clearAncestorCache();
     trees = ResolveConstantsWalk::resolveConstants(ctx, std::move(trees), workers);
     finalizeAncestors(ctx.state);
-    trees = resolveMixesInClassMethods(ctx, std::move(trees));
-    finalizeSymbols(ctx.state);
-    trees = resolveTypeParams(ctx, std::move(trees));
+    trees = resolveMixesInClassMethods(ctx, std::move(trees), workers);
+    finalizeSymbols(ctx.state, workers);
+    trees = resolveTypeParams(ctx, std::move(trees), workers);
     trees = resolveSigs(ctx, std::move(trees));
-    sanityCheck(ctx, trees);
+    sanityCheck(ctx, trees, workers);
 
     return trees;
 }
 
-vector<ast::ParsedFile> Resolver::resolveTypeParams(core::MutableContext ctx, vector<ast::ParsedFile> trees) {
-    ResolveTypeParamsWalk sigs;
+vector<ast::ParsedFile> Resolver::resolveTypeParams(core::MutableContext ctx, vector<ast::ParsedFile> trees,
+                                                    WorkerPool &workers) {
     Timer timeit(ctx.state.errorQueue->logger, "resolver.type_params");
-    for (auto &tree : trees) {
-        tree.tree = ast::TreeMap::apply(ctx, sigs, std::move(tree.tree));
+    auto todo = collectInParallel<ResolveTypeParamsWalk>(ctx, trees, workers, "resolveTypeParamsWalk");
+    for (auto &job : todo) {
+        ResolveTypeParamsWalk::resolveTypeMember(ctx.withOwner(job.owner), job.asgn);
     }
 
     return trees;
@@ -1773,43 +2048,59 @@ vector<ast::ParsedFile> Resolver::resolveSigs(core::MutableContext ctx, vector<a
     return trees;
 }
 
-vector<ast::ParsedFile> Resolver::resolveMixesInClassMethods(core::MutableContext ctx, vector<ast::ParsedFile> trees) {
-    ResolveMixesInClassMethodsWalk mixesInClassMethods;
+vector<ast::ParsedFile> Resolver::resolveMixesInClassMethods(core::MutableContext ctx, vector<ast::ParsedFile> trees,
+                                                             WorkerPool &workers) {
     Timer timeit(ctx.state.errorQueue->logger, "resolver.mixes_in_class_methods");
-    for (auto &tree : trees) {
-        tree.tree = ast::TreeMap::apply(ctx, mixesInClassMethods, std::move(tree.tree));
+    auto todo =
+        collectInParallel<ResolveMixesInClassMethodsWalk>(ctx, trees, workers, "resolveMixesInClassMethodsWalk");
+    for (auto &job : todo) {
+        ResolveMixesInClassMethodsWalk::processMixesInClassMethods(ctx.withOwner(job.owner), job.send.get());
     }
     return trees;
 }
 
-void Resolver::sanityCheck(core::MutableContext ctx, vector<ast::ParsedFile> &trees) {
+void Resolver::sanityCheck(core::MutableContext ctx, vector<ast::ParsedFile> &trees, WorkerPool &workers) {
     if (debug_mode) {
         Timer timeit(ctx.state.errorQueue->logger, "resolver.sanity_check");
-        ResolveSanityCheckWalk sanity;
-        for (auto &tree : trees) {
-            tree.tree = ast::TreeMap::apply(ctx, sanity, std::move(tree.tree));
+        // Only walk the files in the sample, putting them back where they were once they've been checked.
+        vector<int> sampled;
+        vector<ast::ParsedFile> toCheck;
+        for (int i = 0; i < trees.size(); i++) {
+            if (ctx.state.inSanityCheckSample(trees[i].file.id())) {
+                sampled.emplace_back(i);
+                toCheck.emplace_back(move(trees[i]));
+            }
+        }
+        toCheck = ast::parallelTreeMap(
+            ctx, workers, move(toCheck), "resolveSanityCheckWalk", []() { return ResolveSanityCheckWalk(); },
+            [](ResolveSanityCheckWalk &) {});
+        for (int i = 0; i < sampled.size(); i++) {
+            trees[sampled[i]] = move(toCheck[i]);
         }
     }
 }
 
-vector<ast::ParsedFile> Resolver::runTreePasses(core::MutableContext ctx, vector<ast::ParsedFile> trees) {
-    auto workers = WorkerPool::create(0, ctx.state.tracer());
-    trees = ResolveConstantsWalk::resolveConstants(ctx, std::move(trees), *workers);
-    trees = resolveMixesInClassMethods(ctx, std::move(trees));
-    trees = resolveTypeParams(ctx, std::move(trees));
+vector<ast::ParsedFile> Resolver::runTreePasses(core::MutableContext ctx, vector<ast::ParsedFile> trees,
+                                                WorkerPool &workers) {
+    trees = ResolveConstantsWalk::resolveConstants(ctx, std::move(trees), workers);
+    trees = resolveMixesInClassMethods(ctx, std::move(trees), workers);
+    trees = resolveTypeParams(ctx, std::move(trees), workers);
     trees = resolveSigs(ctx, std::move(trees));
-    sanityCheck(ctx, trees);
-    // This check is FAR too slow to run on large codebases, especially with sanitizers on.
-    // But it can be super useful to uncomment when debugging certain issues.
-    // ctx.state.sanityCheck();
+    sanityCheck(ctx, trees, workers);
+    // This check is FAR too slow to run on large codebases, especially with sanitizers on, unless it only looks at a
+    // sample of the tables (see `GlobalState::sanityCheckSample`).
+    if (ctx.state.sanityCheckSample > 1) {
+        ctx.state.sanityCheck();
+    }
 
     return trees;
 }
 
 vector<ast::ParsedFile> Resolver::runConstantResolution(core::MutableContext ctx, vector<ast::ParsedFile> trees,
                                                         WorkerPool &workers) {
+    ctx.state.clearAncestorCache();
     trees = ResolveConstantsWalk::resolveConstants(ctx, std::move(trees), workers);
-    sanityCheck(ctx, trees);
+    sanityCheck(ctx, trees, workers);
 
     return trees;
 }
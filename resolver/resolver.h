@@ -16,7 +16,8 @@ public:
     /** Only runs tree passes, used for incremental changes that do not affect global state. Assumes that `run` was
      * called on a tree that contains same definitions before (LSP uses heuristics that should only have false negatives
      * to find this) */
-    static std::vector<ast::ParsedFile> runTreePasses(core::MutableContext ctx, std::vector<ast::ParsedFile> trees);
+    static std::vector<ast::ParsedFile> runTreePasses(core::MutableContext ctx, std::vector<ast::ParsedFile> trees,
+                                                      WorkerPool &workers);
 
     // used by autogen only
     static std::vector<ast::ParsedFile> runConstantResolution(core::MutableContext ctx,
@@ -24,12 +25,14 @@ public:
 
 private:
     static void finalizeAncestors(core::GlobalState &gs);
-    static void finalizeSymbols(core::GlobalState &gs);
-    static std::vector<ast::ParsedFile> resolveTypeParams(core::MutableContext ctx, std::vector<ast::ParsedFile> trees);
+    static void finalizeSymbols(core::GlobalState &gs, WorkerPool &workers);
+    static std::vector<ast::ParsedFile> resolveTypeParams(core::MutableContext ctx, std::vector<ast::ParsedFile> trees,
+                                                          WorkerPool &workers);
     static std::vector<ast::ParsedFile> resolveSigs(core::MutableContext ctx, std::vector<ast::ParsedFile> trees);
     static std::vector<ast::ParsedFile> resolveMixesInClassMethods(core::MutableContext ctx,
-                                                                   std::vector<ast::ParsedFile> trees);
-    static void sanityCheck(core::MutableContext ctx, std::vector<ast::ParsedFile> &trees);
+                                                                   std::vector<ast::ParsedFile> trees,
+                                                                   WorkerPool &workers);
+    static void sanityCheck(core::MutableContext ctx, std::vector<ast::ParsedFile> &trees, WorkerPool &workers);
 };
 
 } // namespace sorbet::resolver
@@ -764,7 +764,7 @@ TypeSyntax::ResultType TypeSyntax::getResultTypeAndBind(core::MutableContext ctx
             }
 
             InlinedVector<unique_ptr<core::TypeAndOrigins>, 2> holders;
-            InlinedVector<const core::TypeAndOrigins *, 2> targs;
+            core::DispatchArgList targs;
             InlinedVector<core::Loc, 2> argLocs;
             targs.reserve(s->args.size());
             argLocs.reserve(s->args.size());
@@ -0,0 +1,96 @@
+#include "test/benchmarks/CorpusGenerator.h"
+#include <random>
+
+using namespace std;
+
+namespace sorbet::test::benchmarks {
+namespace {
+bool isStruct(int klass) {
+    return klass % 5 == 0;
+}
+
+string generateConcern(int concern) {
+    fmt::memory_buffer buf;
+    fmt::format_to(buf, "# typed: true\nmodule Bench\n  module Concern{}\n    extend T::Sig\n\n", concern);
+    fmt::format_to(buf, "    sig {{params(value: Integer).returns(Integer)}}\n");
+    fmt::format_to(buf, "    def concern{}_helper(value)\n      value * {}\n    end\n", concern, concern + 1);
+    fmt::format_to(buf, "  end\nend\n");
+    return to_string(buf);
+}
+
+void generateStruct(fmt::memory_buffer &buf, int klass, mt19937 &rng) {
+    fmt::format_to(buf, "class Bench::Model{} < T::Struct\n", klass);
+    fmt::format_to(buf, "  prop :count, Integer\n  const :label, String\n");
+    if (klass > 0) {
+        // Struct indices are the multiples of 5 below `klass`.
+        int parent = uniform_int_distribution<int>(0, (klass - 1) / 5)(rng) * 5;
+        fmt::format_to(buf, "  prop :parent, T.nilable(Bench::Model{})\n", parent);
+    }
+    fmt::format_to(buf, "end\n\n");
+}
+
+void generateClass(fmt::memory_buffer &buf, int klass, const CorpusShape &shape, mt19937 &rng) {
+    // Half of the classes extend another one, defined in an earlier file or earlier in this one.
+    int superclass = -1;
+    if (klass > 1 && rng() % 2 == 0) {
+        superclass = uniform_int_distribution<int>(0, klass - 1)(rng);
+        if (isStruct(superclass)) {
+            superclass++;
+        }
+    }
+    const int concern = uniform_int_distribution<int>(0, shape.concerns - 1)(rng);
+    const int builtStruct = uniform_int_distribution<int>(0, klass / 5)(rng) * 5;
+
+    if (superclass >= 0 && superclass < klass) {
+        fmt::format_to(buf, "class Bench::Model{} < Bench::Model{}\n", klass, superclass);
+    } else {
+        fmt::format_to(buf, "class Bench::Model{}\n", klass);
+    }
+    fmt::format_to(buf, "  extend T::Sig\n  include Bench::Concern{}\n\n", concern);
+    fmt::format_to(buf, "  sig {{returns(T.nilable(String))}}\n  attr_accessor :name\n\n");
+
+    for (int method = 0; method < shape.methodsPerClass; method++) {
+        fmt::format_to(buf, "  sig {{params(value: Integer, label: String).returns(String)}}\n");
+        fmt::format_to(buf, "  def method{}(value, label)\n", method);
+        if (method == 0) {
+            fmt::format_to(buf, "    \"#{{label}}#{{value}}\"\n");
+        } else {
+            fmt::format_to(buf, "    if value > {}\n", method);
+            fmt::format_to(buf, "      label + concern{}_helper(value).to_s\n", concern);
+            fmt::format_to(buf, "    else\n      method{}(value + 1, label)\n    end\n", method - 1);
+        }
+        fmt::format_to(buf, "  end\n\n");
+    }
+
+    fmt::format_to(buf, "  sig {{returns(Bench::Model{})}}\n", builtStruct);
+    fmt::format_to(buf, "  def build_struct\n");
+    fmt::format_to(buf, "    Bench::Model{}.new(count: method0(1, \"a\").size, label: \"b\")\n  end\n", builtStruct);
+    fmt::format_to(buf, "end\n\n");
+}
+} // namespace
+
+vector<pair<string, string>> generateCorpus(const CorpusShape &shape) {
+    ENFORCE(shape.concerns > 0);
+    mt19937 rng(shape.seed);
+    vector<pair<string, string>> result;
+    result.reserve(shape.concerns + shape.files);
+    for (int concern = 0; concern < shape.concerns; concern++) {
+        result.emplace_back(fmt::format("concerns/concern_{}.rb", concern), generateConcern(concern));
+    }
+    int klass = 0;
+    for (int file = 0; file < shape.files; file++) {
+        fmt::memory_buffer buf;
+        fmt::format_to(buf, "# typed: true\n");
+        for (int i = 0; i < shape.classesPerFile; i++, klass++) {
+            if (isStruct(klass)) {
+                generateStruct(buf, klass, rng);
+            } else {
+                generateClass(buf, klass, shape, rng);
+            }
+        }
+        result.emplace_back(fmt::format("models/model_{}.rb", file), to_string(buf));
+    }
+    return result;
+}
+
+} // namespace sorbet::test::benchmarks
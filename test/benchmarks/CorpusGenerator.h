@@ -0,0 +1,30 @@
+#ifndef TEST_BENCHMARKS_CORPUSGENERATOR_H
+#define TEST_BENCHMARKS_CORPUSGENERATOR_H
+
+#include "common/common.h"
+
+namespace sorbet::test::benchmarks {
+
+// How big, and how tangled, a generated codebase is.
+struct CorpusShape {
+    int files = 2000;
+    int classesPerFile = 2;
+    int methodsPerClass = 8;
+    // Modules that classes include. Each gets a file of its own.
+    int concerns = 50;
+    u4 seed = 1;
+};
+
+/**
+ * Generates a `# typed: true` codebase that is shaped like a large application, as (relative path, contents) pairs:
+ * every method has a sig, classes inherit from and call into each other across files, include shared modules, and
+ * every fifth one is a `T::Struct` with props. It typechecks without errors, so that benchmarks measure the work of
+ * checking code rather than that of reporting errors.
+ *
+ * The same shape always generates the same corpus.
+ */
+std::vector<std::pair<std::string, std::string>> generateCorpus(const CorpusShape &shape);
+
+} // namespace sorbet::test::benchmarks
+
+#endif // TEST_BENCHMARKS_CORPUSGENERATOR_H
@@ -0,0 +1,124 @@
+#include "absl/strings/str_replace.h"
+#include "common/concurrency/WorkerPool.h"
+#include "common/kvstore/KeyValueStore.h"
+#include "core/ErrorQueue.h"
+#include "main/lsp/wrapper.h"
+#include "main/pipeline/pipeline.h"
+#include "payload/payload.h"
+#include "spdlog/sinks/null_sink.h"
+#include "test/benchmarks/CorpusGenerator.h"
+#include "test/helpers/MockFileSystem.h"
+#include "test/helpers/lsp.h"
+#include <chrono>
+#include <cxxopts.hpp>
+#include <sys/resource.h> // getrusage
+#include <thread>
+
+using namespace std;
+
+namespace sorbet::test::benchmarks {
+namespace {
+const string ROOT_PATH = "/benchmark";
+const string ROOT_URI = "file:///benchmark";
+
+long peakRssKiB() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+// Runs `fn`, and reports how long it took along with the peak RSS of the process so far.
+template <class F> void measure(string_view phase, F fn) {
+    auto start = chrono::steady_clock::now();
+    fn();
+    chrono::duration<double, milli> duration = chrono::steady_clock::now() - start;
+    fmt::print("{:<24} {:>12.1f} ms {:>10} MiB peak RSS\n", phase, duration.count(), peakRssKiB() / 1024);
+}
+
+void benchmarkPipeline(const shared_ptr<MockFileSystem> &fs, const vector<string> &paths, int threads) {
+    auto logger = make_shared<spdlog::logger>("null", make_shared<spdlog::sinks::null_sink_mt>());
+    realmain::options::Options opts;
+    opts.fs = fs;
+    opts.threads = threads;
+    auto gs = make_unique<core::GlobalState>(make_shared<core::ErrorQueue>(*logger, *logger));
+    unique_ptr<KeyValueStore> kvstore;
+    auto workers = WorkerPool::create(threads, *logger);
+
+    measure("payload", [&]() { payload::createInitialGlobalState(gs, opts, kvstore); });
+    vector<ast::ParsedFile> trees;
+    measure("index", [&]() {
+        auto files = realmain::pipeline::reserveFiles(gs, paths);
+        trees = realmain::pipeline::index(gs, files, opts, *workers, kvstore);
+    });
+    measure("resolve", [&]() { trees = realmain::pipeline::resolve(gs, move(trees), opts, *workers, kvstore, true); });
+    measure("typecheck", [&]() { trees = realmain::pipeline::typecheck(gs, move(trees), opts, *workers, kvstore); });
+    fmt::print("{:<24} {:>12}\n", "errors", gs->totalErrors());
+}
+
+void benchmarkLSP(const shared_ptr<MockFileSystem> &fs, const vector<string> &paths,
+                  const vector<pair<string, string>> &corpus) {
+    realmain::options::Options opts;
+    opts.fs = fs;
+    opts.inputFileNames = paths;
+    realmain::lsp::LSPWrapper lspWrapper(move(opts), ROOT_PATH);
+    int nextId = 1;
+    measure("lsp.initialize", [&]() { initializeLSP(ROOT_PATH, ROOT_URI, lspWrapper, nextId); });
+
+    // The last file is the one with the most classes to check dependencies against.
+    auto &[path, contents] = corpus.back();
+    auto uri = fmt::format("{}/{}", ROOT_URI, path);
+    auto bodyChange = absl::StrReplaceAll(contents, {{"value > ", "value >= "}});
+    measure("lsp.fast_path", [&]() { lspWrapper.getLSPResponsesFor(*makeDidChange(uri, bodyChange, 2)); });
+    auto newClass = bodyChange + "class Bench::Added\nend\n";
+    measure("lsp.slow_path", [&]() { lspWrapper.getLSPResponsesFor(*makeDidChange(uri, newClass, 3)); });
+}
+} // namespace
+
+int run(int argc, char *argv[]) {
+    CorpusShape shape;
+    cxxopts::Options options("benchmarks", "Times sorbet's phases over a generated codebase");
+    options.add_options()("files", "Files of classes to generate",
+                          cxxopts::value<int>()->default_value(to_string(shape.files)));
+    options.add_options()("classes-per-file", "Classes in each file",
+                          cxxopts::value<int>()->default_value(to_string(shape.classesPerFile)));
+    options.add_options()("methods-per-class", "Methods in each class",
+                          cxxopts::value<int>()->default_value(to_string(shape.methodsPerClass)));
+    options.add_options()("concerns", "Modules for classes to include",
+                          cxxopts::value<int>()->default_value(to_string(shape.concerns)));
+    options.add_options()("seed", "Seed for the generator", cxxopts::value<u4>()->default_value(to_string(shape.seed)));
+    options.add_options()("threads", "Worker threads for the batch pipeline",
+                          cxxopts::value<int>()->default_value(to_string(max(thread::hardware_concurrency(), 2u))));
+    options.add_options()("skip-lsp", "Only benchmark the batch pipeline");
+    auto raw = options.parse(argc, argv);
+    shape.files = raw["files"].as<int>();
+    shape.classesPerFile = raw["classes-per-file"].as<int>();
+    shape.methodsPerClass = raw["methods-per-class"].as<int>();
+    shape.concerns = raw["concerns"].as<int>();
+    shape.seed = raw["seed"].as<u4>();
+
+    vector<pair<string, string>> corpus;
+    measure("generate", [&]() { corpus = generateCorpus(shape); });
+    auto fs = make_shared<MockFileSystem>(ROOT_PATH);
+    fs->writeFiles(corpus);
+    vector<string> paths;
+    for (auto &[path, _] : corpus) {
+        paths.emplace_back(fmt::format("{}/{}", ROOT_PATH, path));
+    }
+
+    benchmarkPipeline(fs, paths, raw["threads"].as<int>());
+    if (!raw["skip-lsp"].as<bool>()) {
+        benchmarkLSP(fs, paths, corpus);
+    }
+    return 0;
+}
+} // namespace sorbet::test::benchmarks
+
+int main(int argc, char *argv[]) {
+    return sorbet::test::benchmarks::run(argc, argv);
+}
@@ -0,0 +1,60 @@
+#include "gtest/gtest.h"
+// has to go first as it violates our requirements
+
+#include "common/concurrency/WorkerPool.h"
+#include "common/kvstore/KeyValueStore.h"
+#include "core/ErrorQueue.h"
+#include "main/options/options.h"
+#include "main/pipeline/pipeline.h"
+#include "payload/payload.h"
+#include "spdlog/sinks/null_sink.h"
+#include "test/benchmarks/CorpusGenerator.h"
+#include "test/helpers/MockFileSystem.h"
+
+using namespace std;
+
+namespace sorbet::test::benchmarks {
+
+namespace {
+CorpusShape smallShape() {
+    CorpusShape shape;
+    shape.files = 20;
+    shape.concerns = 5;
+    return shape;
+}
+} // namespace
+
+TEST(CorpusGeneratorTest, IsDeterministic) { // NOLINT
+    EXPECT_EQ(generateCorpus(smallShape()), generateCorpus(smallShape()));
+
+    auto reseeded = smallShape();
+    reseeded.seed++;
+    EXPECT_NE(generateCorpus(smallShape()), generateCorpus(reseeded));
+}
+
+// Benchmarks would measure error reporting if the corpus stopped typechecking.
+TEST(CorpusGeneratorTest, Typechecks) { // NOLINT
+    auto corpus = generateCorpus(smallShape());
+    auto fs = make_shared<MockFileSystem>("/corpus");
+    fs->writeFiles(corpus);
+    vector<string> paths;
+    for (auto &[path, _] : corpus) {
+        paths.emplace_back(fmt::format("/corpus/{}", path));
+    }
+
+    auto logger = make_shared<spdlog::logger>("null", make_shared<spdlog::sinks::null_sink_mt>());
+    realmain::options::Options opts;
+    opts.fs = fs;
+    auto gs = make_unique<core::GlobalState>(make_shared<core::ErrorQueue>(*logger, *logger));
+    unique_ptr<KeyValueStore> kvstore;
+    auto workers = WorkerPool::create(0, *logger);
+    payload::createInitialGlobalState(gs, opts, kvstore);
+
+    auto files = realmain::pipeline::reserveFiles(gs, paths);
+    auto trees = realmain::pipeline::index(gs, files, opts, *workers, kvstore);
+    trees = realmain::pipeline::resolve(gs, move(trees), opts, *workers, kvstore, true);
+    trees = realmain::pipeline::typecheck(gs, move(trees), opts, *workers, kvstore);
+    EXPECT_EQ(0, gs->totalErrors());
+}
+
+} // namespace sorbet::test::benchmarks
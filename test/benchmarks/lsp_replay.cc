@@ -0,0 +1,182 @@
+#include "absl/strings/match.h"
+#include "absl/strings/str_split.h"
+#include "common/FileSystem.h"
+#include "main/lsp/LSPMessage.h"
+#include "main/lsp/lsp.h"
+#include "main/lsp/wrapper.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include <chrono>
+#include <ctime>
+#include <cxxopts.hpp>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+// Replays the messages a client sent to `sorbet --lsp` during a recorded session against a workspace, and reports how
+// long Sorbet took to process each kind of message and how often it took the fast path.
+//
+// Sessions are recorded with `sorbet --lsp -v --debug-log-file=<log>`, which logs every message it reads as
+//
+//   [T<thread>][<%Y-%m-%dT%T.%f>] Read: <json>
+//
+// Messages are handed to LSP one at a time as they were read, so unlike an editor session, edits that arrived while
+// Sorbet was busy are not merged.
+namespace sorbet::test::benchmarks {
+namespace {
+using namespace realmain::lsp;
+
+struct RecordedMessage {
+    // Microseconds since the epoch.
+    long timestamp;
+    string json;
+};
+
+// Returns -1 if `line` does not start with the prefix the debug log adds to every entry.
+long parseTimestamp(string_view line, size_t &prefixLength) {
+    auto timestampStart = line.find("][");
+    auto timestampEnd = line.find("] ", timestampStart);
+    if (line.empty() || line[0] != '[' || timestampStart == string_view::npos || timestampEnd == string_view::npos) {
+        return -1;
+    }
+    struct tm time = {};
+    double seconds = 0;
+    string timestamp(line.substr(timestampStart + 2, timestampEnd - timestampStart - 2));
+    if (sscanf(timestamp.c_str(), "%d-%d-%dT%d:%d:%lf", &time.tm_year, &time.tm_mon, &time.tm_mday, &time.tm_hour,
+               &time.tm_min, &seconds) != 6) {
+        return -1;
+    }
+    time.tm_year -= 1900;
+    time.tm_mon -= 1;
+    prefixLength = timestampEnd + 2;
+    return timegm(&time) * 1'000'000L + (long)(seconds * 1'000'000);
+}
+
+vector<RecordedMessage> readSession(string_view logFile) {
+    OSFileSystem fs;
+    vector<RecordedMessage> messages;
+    // Entries end where the next one begins, as messages may span several lines.
+    bool inMessage = false;
+    auto log = fs.readFile(logFile);
+    for (string_view line : absl::StrSplit(log, '\n')) {
+        size_t prefixLength;
+        auto timestamp = parseTimestamp(line, prefixLength);
+        if (timestamp == -1) {
+            if (inMessage) {
+                auto &json = messages.back().json;
+                json += '\n';
+                json += line;
+            }
+            continue;
+        }
+        auto entry = line.substr(prefixLength);
+        inMessage = absl::StartsWith(entry, "Read: ");
+        if (inMessage) {
+            messages.push_back(RecordedMessage{timestamp, string(entry.substr(strlen("Read: ")))});
+        }
+    }
+    return messages;
+}
+
+// Asks LSP to report whether each typechecking run took the fast path.
+void enableTypecheckInfo(LSPMessage &msg) {
+    if (!msg.isRequest() || msg.method() != LSPMethod::Initialize) {
+        return;
+    }
+    auto &params = get<unique_ptr<InitializeParams>>(msg.asRequest().params);
+    if (!params->initializationOptions) {
+        params->initializationOptions = make_unique<SorbetInitializationOptions>();
+    }
+    (*params->initializationOptions)->enableTypecheckInfo = true;
+}
+
+string describe(const LSPMessage &msg) {
+    if (msg.isResponse()) {
+        return "(response)";
+    }
+    return convertLSPMethodToString(msg.method());
+}
+
+void printLatencies(UnorderedMap<string, vector<double>> &latencies) {
+    vector<string> methods;
+    for (auto &[method, _] : latencies) {
+        methods.emplace_back(method);
+    }
+    fast_sort(methods);
+    fmt::print("{:<40} {:>7} {:>10} {:>10} {:>10} {:>10}\n", "message", "count", "p50 ms", "p90 ms", "p99 ms",
+               "max ms");
+    for (auto &method : methods) {
+        auto &samples = latencies[method];
+        fast_sort(samples);
+        auto percentile = [&](double p) { return samples[min(samples.size() - 1, (size_t)(samples.size() * p))]; };
+        fmt::print("{:<40} {:>7} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f}\n", method, samples.size(), percentile(0.5),
+                   percentile(0.9), percentile(0.99), samples.back());
+    }
+}
+} // namespace
+
+int replay(int argc, char *argv[]) {
+    cxxopts::Options options("lsp_replay", "Replays a recorded LSP session and reports per-message latencies");
+    options.add_options()("realtime", "Wait as long between messages as the client did");
+    options.add_options()("log", "Debug log of the session to replay", cxxopts::value<string>());
+    options.positional_help("--log=<debug log> -- <options the session's `sorbet --lsp` ran with>");
+    auto raw = options.parse(argc, argv);
+    if (raw.count("log") == 0) {
+        fmt::print(stderr, "{}\n", options.help());
+        return 1;
+    }
+    auto messages = readSession(raw["log"].as<string>());
+
+    // `cxxopts` leaves what follows `--` in argv, which configures the workspace like `sorbet --lsp` would.
+    auto logger = spdlog::stderr_color_mt("lsp_replay");
+    vector<unique_ptr<pipeline::semantic_extension::SemanticExtension>> extensions;
+    realmain::options::Options opts;
+    try {
+        realmain::options::readOptions(opts, extensions, argc, argv, {}, logger);
+    } catch (realmain::options::EarlyReturnWithCode &c) {
+        return c.returnCode;
+    }
+    if (opts.rawInputDirNames.size() != 1) {
+        logger->error("Pass the workspace the session ran in as the only directory after `--`");
+        return 1;
+    }
+    // LSPWrapper adds its root directory itself.
+    auto rootPath = opts.rawInputDirNames.front();
+    opts.rawInputDirNames.clear();
+    LSPWrapper lspWrapper(move(opts), rootPath);
+
+    UnorderedMap<string, vector<double>> latencies;
+    int fastPathRuns = 0;
+    int slowPathRuns = 0;
+    auto replayStart = chrono::steady_clock::now();
+    for (auto &recorded : messages) {
+        if (raw["realtime"].as<bool>()) {
+            this_thread::sleep_until(replayStart +
+                                     chrono::microseconds(recorded.timestamp - messages.front().timestamp));
+        }
+        auto msg = LSPMessage::fromClient(recorded.json);
+        enableTypecheckInfo(*msg);
+
+        auto start = chrono::steady_clock::now();
+        auto responses = lspWrapper.getLSPResponsesFor(*msg);
+        chrono::duration<double, milli> latency = chrono::steady_clock::now() - start;
+        latencies[describe(*msg)].emplace_back(latency.count());
+
+        for (auto &response : responses) {
+            if (response->isNotification() && response->method() == LSPMethod::SorbetTypecheckRunInfo) {
+                auto &info = get<unique_ptr<SorbetTypecheckRunInfo>>(response->asNotification().params);
+                (info->tookFastPath ? fastPathRuns : slowPathRuns)++;
+            }
+        }
+    }
+
+    printLatencies(latencies);
+    fmt::print("\nreplayed {} messages: {} fast path and {} slow path typechecking runs\n", messages.size(),
+               fastPathRuns, slowPathRuns);
+    return 0;
+}
+} // namespace sorbet::test::benchmarks
+
+int main(int argc, char *argv[]) {
+    return sorbet::test::benchmarks::replay(argc, argv);
+}
@@ -0,0 +1,172 @@
+#include "benchmark/benchmark.h"
+// has to go first as it violates our requirements
+
+#include "common/kvstore/KeyValueStore.h"
+#include "core/ErrorQueue.h"
+#include "core/TypeConstraint.h"
+#include "core/core.h"
+#include "main/options/options.h"
+#include "payload/payload.h"
+#include "spdlog/sinks/null_sink.h"
+
+using namespace std;
+
+// Micro-benchmarks for the type operations inference spends most of its time in, against the real payload. Like
+// inference, every iteration builds its types anew, so that they measure the whole operation rather than whatever a
+// pointer comparison fast path makes of repeating it on the same objects.
+namespace sorbet::test::benchmarks {
+namespace {
+using core::Types;
+
+const core::GlobalState &globalState() {
+    static auto gs = []() {
+        auto logger = make_shared<spdlog::logger>("null", make_shared<spdlog::sinks::null_sink_mt>());
+        auto gs = make_unique<core::GlobalState>(make_shared<core::ErrorQueue>(*logger, *logger));
+        realmain::options::Options opts;
+        unique_ptr<KeyValueStore> kvstore;
+        payload::createInitialGlobalState(gs, opts, kvstore);
+        return gs;
+    }();
+    return *gs;
+}
+
+core::Context context() {
+    return core::Context(globalState(), core::Symbols::root());
+}
+
+core::TypePtr arrayOf(const core::TypePtr &elem) {
+    return core::make_type<core::AppliedType>(core::Symbols::Array(), vector<core::TypePtr>{elem});
+}
+
+core::TypePtr hashOf(const core::TypePtr &key, const core::TypePtr &value) {
+    return core::make_type<core::AppliedType>(core::Symbols::Hash(), vector<core::TypePtr>{key, key, value});
+}
+
+// The first type argument of `Array#map`, i.e. its `T.type_parameter(:U)`.
+core::SymbolRef mapTypeArgument() {
+    static auto typeArgument = []() {
+        auto &gs = globalState();
+        for (auto [name, member] : core::Symbols::Array().data(gs)->members()) {
+            if (name.data(gs)->shortName(gs) == "map" && !member.data(gs)->typeArguments().empty()) {
+                return member.data(gs)->typeArguments().front();
+            }
+        }
+        Exception::raise("Array#map has no type parameters");
+    }();
+    return typeArgument;
+}
+
+core::DispatchResult dispatch(core::Context ctx, const core::TypePtr &recv, core::NameRef name) {
+    InlinedVector<core::Loc, 2> argLocs;
+    core::CallLocs locs{core::Loc::none(), core::Loc::none(), argLocs};
+    core::DispatchArgList args;
+    shared_ptr<core::SendAndBlockLink> block;
+    return recv->dispatchCall(ctx, {name, locs, args, recv, recv, block});
+}
+
+void lubOfClasses(benchmark::State &state) {
+    auto ctx = context();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Types::lub(ctx, Types::Integer(), Types::String()));
+    }
+}
+BENCHMARK(lubOfClasses);
+
+void lubOfUnions(benchmark::State &state) {
+    auto ctx = context();
+    for (auto _ : state) {
+        auto left = Types::any(ctx, Types::Integer(), Types::String());
+        auto right = Types::any(ctx, Types::Symbol(), Types::nilClass());
+        benchmark::DoNotOptimize(Types::lub(ctx, left, right));
+    }
+}
+BENCHMARK(lubOfUnions);
+
+void lubOfAppliedTypes(benchmark::State &state) {
+    auto ctx = context();
+    for (auto _ : state) {
+        auto left = hashOf(Types::Symbol(), arrayOf(Types::Integer()));
+        auto right = hashOf(Types::Symbol(), arrayOf(Types::String()));
+        benchmark::DoNotOptimize(Types::lub(ctx, left, right));
+    }
+}
+BENCHMARK(lubOfAppliedTypes);
+
+void glbOfUnions(benchmark::State &state) {
+    auto ctx = context();
+    for (auto _ : state) {
+        auto left = Types::any(ctx, Types::Integer(), Types::String());
+        auto right = Types::any(ctx, Types::String(), Types::nilClass());
+        benchmark::DoNotOptimize(Types::glb(ctx, left, right));
+    }
+}
+BENCHMARK(glbOfUnions);
+
+void isSubTypeOfUnion(benchmark::State &state) {
+    auto ctx = context();
+    for (auto _ : state) {
+        auto sub = arrayOf(Types::Integer());
+        auto super = arrayOf(Types::any(ctx, Types::Integer(), Types::String()));
+        benchmark::DoNotOptimize(
+            Types::isSubTypeUnderConstraint(ctx, core::TypeConstraint::EmptyFrozenConstraint, sub, super));
+    }
+}
+BENCHMARK(isSubTypeOfUnion);
+
+void isSubTypeOfTypeVariable(benchmark::State &state) {
+    auto ctx = context();
+    InlinedVector<core::SymbolRef, 4> domain{mapTypeArgument()};
+    for (auto _ : state) {
+        core::TypeConstraint constr;
+        constr.defineDomain(ctx, domain);
+        auto var = core::make_type<core::TypeVar>(mapTypeArgument());
+        benchmark::DoNotOptimize(Types::isSubTypeUnderConstraint(ctx, constr, Types::Integer(), var));
+    }
+}
+BENCHMARK(isSubTypeOfTypeVariable);
+
+void dispatchOnUnion(benchmark::State &state) {
+    auto ctx = context();
+    for (auto _ : state) {
+        auto recv = Types::any(ctx, Types::Integer(), Types::String());
+        benchmark::DoNotOptimize(dispatch(ctx, recv, core::Names::to_s()));
+    }
+}
+BENCHMARK(dispatchOnUnion);
+
+void dispatchOnAppliedType(benchmark::State &state) {
+    auto ctx = context();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dispatch(ctx, arrayOf(Types::Integer()), core::Names::first()));
+    }
+}
+BENCHMARK(dispatchOnAppliedType);
+
+void instantiateAndApproximate(benchmark::State &state) {
+    auto ctx = context();
+    InlinedVector<core::SymbolRef, 4> domain{mapTypeArgument()};
+    for (auto _ : state) {
+        core::TypeConstraint constr;
+        constr.defineDomain(ctx, domain);
+        auto var = core::make_type<core::TypeVar>(mapTypeArgument());
+        Types::isSubTypeUnderConstraint(ctx, constr, Types::Integer(), var);
+        auto generic = hashOf(Types::Symbol(), arrayOf(var));
+        benchmark::DoNotOptimize(Types::approximate(ctx, generic, constr));
+        constr.solve(ctx);
+        benchmark::DoNotOptimize(Types::instantiate(ctx, generic, constr));
+    }
+}
+BENCHMARK(instantiateAndApproximate);
+
+void instantiateTypeMembers(benchmark::State &state) {
+    auto ctx = context();
+    auto &elem = core::Symbols::Array().data(globalState())->typeMembers();
+    for (auto _ : state) {
+        auto generic = arrayOf(core::make_type<core::LambdaParam>(elem.front(), Types::bottom(), Types::top()));
+        vector<core::TypePtr> targs{Types::any(ctx, Types::Integer(), Types::String())};
+        benchmark::DoNotOptimize(Types::instantiate(ctx, generic, elem, targs));
+    }
+}
+BENCHMARK(instantiateTypeMembers);
+} // namespace
+} // namespace sorbet::test::benchmarks
@@ -0,0 +1,42 @@
+#!/bin/bash
+dir=$(mktemp -d)
+cleanup() {
+    rm -r "$dir"
+}
+trap cleanup EXIT
+set -e
+
+mkdir "$dir/old" "$dir/new"
+cat > "$dir/old/a.rb" <<RUBY
+# typed: true
+class A
+  def foo; 1; end
+end
+RUBY
+cat > "$dir/old/b.rb" <<RUBY
+# typed: true
+A.new.foo
+RUBY
+cat > "$dir/old/c.rb" <<RUBY
+# typed: true
+class C; end
+RUBY
+cp "$dir/old/"*.rb "$dir/new"
+sorbet="$PWD/main/sorbet"
+cd "$dir/new"
+
+echo "--- nothing changed"
+"$sorbet" --silence-dev-message --print-affected-files-since "$dir/old" a.rb b.rb c.rb 2>&1
+
+echo "--- a method changed"
+cat > a.rb <<RUBY
+# typed: true
+class A
+  def foo; 2; end
+end
+RUBY
+"$sorbet" --silence-dev-message --print-affected-files-since "$dir/old" a.rb b.rb c.rb 2>&1
+
+echo "--- a class changed"
+echo 'class D; end' >> c.rb
+"$sorbet" --silence-dev-message --print-affected-files-since "$dir/old" a.rb b.rb c.rb 2>&1
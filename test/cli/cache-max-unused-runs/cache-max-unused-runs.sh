@@ -0,0 +1,35 @@
+#!/bin/bash
+dir=$(mktemp -d)
+cleanup() {
+    rm -r "$dir"
+}
+trap cleanup EXIT
+set -e
+
+removed() {
+    if grep -q "cache.unused_entries_removed" "$dir/log"; then
+        echo "removed unused entries"
+    else
+        echo "removed nothing"
+    fi
+}
+
+mkdir "$dir/cache"
+echo 'puts("hi")' > "$dir/test.rb"
+main/sorbet --silence-dev-message --cache-dir "$dir/cache" --cache-max-unused-runs=1 \
+  --debug-log-file="$dir/log" "$dir/test.rb" 2>&1
+removed
+
+# The entries of the first version aren't used by this run...
+echo 'puts("bye")' > "$dir/test.rb"
+main/sorbet --silence-dev-message --cache-dir "$dir/cache" --cache-max-unused-runs=1 \
+  --debug-log-file="$dir/log" "$dir/test.rb" 2>&1
+removed
+
+# ...so this one removes them.
+main/sorbet --silence-dev-message --cache-dir "$dir/cache" --cache-max-unused-runs=1 \
+  --debug-log-file="$dir/log" "$dir/test.rb" 2>&1
+removed
+
+main/sorbet --silence-dev-message --cache-dir "$dir/cache" --compact-cache 2>&1
+main/sorbet --silence-dev-message --cache-dir "$dir/cache" "$dir/test.rb" 2>&1
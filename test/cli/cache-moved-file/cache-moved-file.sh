@@ -0,0 +1,30 @@
+#!/bin/bash
+dir=$(mktemp -d)
+cleanup() {
+    rm -r "$dir"
+}
+trap cleanup EXIT
+set -e
+
+hits() {
+    if grep -q "types.input.files.kvstore.hit" "$dir/log"; then
+        echo "tree loaded from the cache"
+    else
+        echo "tree not loaded from the cache"
+    fi
+}
+
+mkdir "$dir/cache" "$dir/a" "$dir/b"
+cat > "$dir/a/test.rb" <<EOF
+# typed: true
+class A
+  def foo; 1; end
+end
+EOF
+main/sorbet --silence-dev-message --cache-dir "$dir/cache" --debug-log-file="$dir/log" "$dir/a/test.rb" 2>&1
+hits
+
+# Cached trees don't depend on where their file is.
+mv "$dir/a/test.rb" "$dir/b/moved.rb"
+main/sorbet --silence-dev-message --cache-dir "$dir/cache" --debug-log-file="$dir/log" "$dir/b/moved.rb" 2>&1
+hits
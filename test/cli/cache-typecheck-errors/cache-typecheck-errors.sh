@@ -0,0 +1,45 @@
+#!/bin/bash
+set -euo pipefail
+
+dir=$(mktemp -d)
+cleanup() {
+    rm -r "$dir"
+}
+trap cleanup EXIT
+
+mkdir "$dir/cache"
+write_a() {
+    cat > "$dir/a.rb" <<EOF
+# typed: true
+class A
+  extend T::Sig
+  sig {returns($1)}
+  def foo; $2; end
+end
+EOF
+}
+write_a Integer 1
+cat > "$dir/b.rb" <<EOF
+# typed: true
+T.reveal_type(A.new.foo)
+A.new.bar
+EOF
+
+run() {
+    main/sorbet --silence-dev-message "$@" "$dir/a.rb" "$dir/b.rb" 2>&1 || true
+}
+
+run > "$dir/uncached.out"
+run --cache-dir "$dir/cache" > "$dir/cold.out"
+run --cache-dir "$dir/cache" > "$dir/warm.out"
+diff "$dir/uncached.out" "$dir/cold.out"
+diff "$dir/uncached.out" "$dir/warm.out"
+echo ====replayed errors match====
+
+# Changing the signature of A#foo must invalidate the cached errors for b.rb, which calls it.
+write_a String '"1"'
+run > "$dir/uncached.out"
+run --cache-dir "$dir/cache" > "$dir/warm.out"
+diff "$dir/uncached.out" "$dir/warm.out"
+grep -q 'Revealed type: `String`' "$dir/warm.out"
+echo ====dependency change invalidates====
@@ -0,0 +1,10 @@
+# typed: true
+class A
+  def foo
+    bar
+  end
+
+  def bar
+    1 + 2
+  end
+end
@@ -0,0 +1,8 @@
+#!/bin/bash
+# Prints the source of the calls the methods in call-graph.rb make.
+rb=test/cli/call-graph/call-graph.rb
+main/sorbet --no-error-count --silence-dev-message -p call-graph "$rb" | od -An -v -tu4 -w20 | \
+  while read -r _caller _callee _file begin end; do
+    tail -c +$((begin + 1)) "$rb" | head -c $((end - begin))
+    echo
+  done | grep -e '^bar$' -e '^1 + 2$' | sort
@@ -0,0 +1,6 @@
+# typed: true
+
+# Make this test not depend on anything in the stdlib so that snapshot output
+# never can change in response to things external to this test.
+T.reveal_type(true)
+T.reveal_type(1)
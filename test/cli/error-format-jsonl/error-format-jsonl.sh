@@ -0,0 +1,3 @@
+#!/bin/bash
+
+main/sorbet --silence-dev-message --error-format=jsonl test/cli/error-format-jsonl/error-format-jsonl.rb 2>&1
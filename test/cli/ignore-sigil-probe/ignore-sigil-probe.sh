@@ -0,0 +1,26 @@
+#!/bin/bash
+
+# Files longer than the part of them read to look for their sigil in.
+root="$PWD"
+dir="$(mktemp -d)"
+padding="$(for _ in $(seq 100); do echo "# $(printf '%060d' 0)"; done)"
+{
+  echo "# typed: ignore"
+  echo "$padding"
+  echo '1 + "s"'
+} > "$dir/ignored.rb"
+cp "$dir/ignored.rb" "$dir/overridden.rb"
+{
+  echo "$padding"
+  echo "# typed: ignore"
+  echo '1 + "s"'
+} > "$dir/late_sigil.rb"
+{
+  echo "true:"
+  echo "  - './overridden.rb'"
+} > "$dir/overrides.yaml"
+
+cd "$dir" || exit 1
+"$root/main/sorbet" --silence-dev-message --typed-override=overrides.yaml ignored.rb overridden.rb late_sigil.rb 2>&1
+cd "$root" || exit 1
+rm -r "$dir"
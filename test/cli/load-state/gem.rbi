@@ -0,0 +1,5 @@
+# typed: true
+
+module QuuxLoadStateGem
+  def self.version; end
+end
@@ -0,0 +1,12 @@
+#!/bin/bash
+dir=$(mktemp -d)
+cleanup() {
+    rm -r "$dir"
+}
+trap cleanup EXIT
+
+main/sorbet --silence-dev-message --store-state "$dir/state" test/cli/load-state/gem.rbi 2>&1
+echo "--- with the state"
+main/sorbet --silence-dev-message --load-state "$dir/state" test/cli/load-state/gem.rbi test/cli/load-state/main.rb 2>&1
+echo "--- without it"
+main/sorbet --silence-dev-message test/cli/load-state/main.rb 2>&1
@@ -0,0 +1,3 @@
+# typed: true
+
+QuuxLoadStateGem.version
@@ -0,0 +1,4 @@
+# typed: true
+
+# This file is larger than second.rb, so that it's typechecked first.
+T.reveal_type(true)
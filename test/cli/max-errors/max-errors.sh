@@ -0,0 +1,4 @@
+#!/bin/bash
+
+# Files are typechecked largest first, and with two files there's a single worker, so only the first is typechecked.
+main/sorbet --silence-dev-message --max-errors=1 test/cli/max-errors/first.rb test/cli/max-errors/second.rb 2>&1
@@ -0,0 +1,3 @@
+# typed: true
+
+T.reveal_type(1)
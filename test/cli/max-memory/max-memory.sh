@@ -0,0 +1,4 @@
+#!/bin/bash
+
+# Every process is over 1 MiB once resolving is done.
+main/sorbet --silence-dev-message --max-memory-mib=1 test/cli/max-memory/test.rb 2>&1
@@ -0,0 +1,4 @@
+# typed: true
+
+# Typechecked from a tree that was written to disk and read back.
+T.reveal_type(true)
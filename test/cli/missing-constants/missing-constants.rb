@@ -10,3 +10,4 @@ end
 A::C
 B
 
+A::C
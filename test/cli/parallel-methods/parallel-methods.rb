@@ -0,0 +1,33 @@
+# typed: true
+
+class A
+  extend T::Sig
+
+  sig {params(x: Integer).returns(String)}
+  def a(x)
+    x
+  end
+
+  sig {returns(Integer)}
+  def b
+    "not an integer"
+  end
+
+  def c
+    1 + "two"
+  end
+
+  def d
+    undefined_method
+  end
+
+  sig {params(y: String).void}
+  def e(y)
+    y.no_such_method
+    y + 1
+  end
+
+  def f
+    T.let(1, String)
+  end
+end
@@ -0,0 +1,20 @@
+#!/bin/bash
+dir=$(mktemp -d)
+cleanup() {
+    rm -r "$dir"
+}
+trap cleanup EXIT
+
+# Threads are capped at half the number of input files, so pad the input to actually get worker threads.
+for i in $(seq 8); do
+    echo "# typed: true" > "$dir/pad$i.rb"
+done
+
+input="test/cli/parallel-methods/parallel-methods.rb"
+main/sorbet --silence-dev-message --max-threads=4 "$input" "$dir"/pad*.rb > "$dir/serial.log" 2>&1
+main/sorbet --silence-dev-message --max-threads=4 --parallel-method-threshold=1 "$input" "$dir"/pad*.rb \
+    > "$dir/parallel.log" 2>&1
+
+if diff "$dir/serial.log" "$dir/parallel.log"; then
+    echo "--parallel-method-threshold OK"
+fi
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+# Sampling only changes which invariants a debug build checks, never the errors that are reported.
+echo "--- 1000"
+main/sorbet --silence-dev-message --sanity-check-sample=1000 test/cli/sanity-check-sample/test.rb 2>&1
+echo "--- 0"
+main/sorbet --silence-dev-message --sanity-check-sample=0 test/cli/sanity-check-sample/test.rb 2>&1
@@ -0,0 +1,7 @@
+# typed: true
+
+class SanityCheckSample
+  def foo
+    NoSuchConstantInSample
+  end
+end
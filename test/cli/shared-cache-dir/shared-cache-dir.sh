@@ -0,0 +1,36 @@
+#!/bin/bash
+dir=$(mktemp -d)
+cleanup() {
+    rm -r "$dir"
+}
+trap cleanup EXIT
+set -e
+
+hits() {
+    if grep -q "types.input.files.kvstore.hit" "$dir/log"; then
+        echo "tree loaded from the cache"
+    else
+        echo "tree not loaded from the cache"
+    fi
+}
+
+mkdir "$dir/shared" "$dir/first" "$dir/second" "$dir/third"
+echo 'puts("hi")' > "$dir/test.rb"
+
+main/sorbet --silence-dev-message --cache-dir "$dir/first" --shared-cache-dir "$dir/shared" --shared-cache-read-only \
+  --debug-log-file="$dir/log" "$dir/test.rb" 2>&1
+hits
+ls "$dir/shared"
+
+main/sorbet --silence-dev-message --cache-dir "$dir/first" --shared-cache-dir "$dir/shared" \
+  --debug-log-file="$dir/log" "$dir/test.rb" 2>&1
+hits
+ls "$dir/shared" | wc -l | tr -d ' '
+
+# Another machine starts from what the first one stored.
+main/sorbet --silence-dev-message --cache-dir "$dir/second" --shared-cache-dir "$dir/shared" \
+  --debug-log-file="$dir/log" "$dir/test.rb" 2>&1
+hits
+
+main/sorbet --silence-dev-message --cache-dir "$dir/third" --debug-log-file="$dir/log" "$dir/test.rb" 2>&1
+hits
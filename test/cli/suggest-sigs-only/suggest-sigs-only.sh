@@ -0,0 +1,3 @@
+#!/bin/bash
+# `typed` returns the wrong type, but it has a sig, so it isn't typechecked.
+main/sorbet --silence-dev-message --suggest-sigs-only -e $'# typed: strict\nclass A\n  extend T::Sig\n  sig {returns(Integer)}\n  def typed; ""; end\n  def untyped; 1; end\nend' 2>&1
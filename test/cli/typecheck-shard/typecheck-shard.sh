@@ -0,0 +1,9 @@
+#!/bin/bash
+
+# f.rb belongs to shard 1 and b.rb to shard 0.
+echo "--- 0/2"
+main/sorbet --silence-dev-message --typecheck-shard=0/2 test/cli/typecheck-shard/f.rb test/cli/typecheck-shard/b.rb 2>&1
+echo "--- 1/2"
+main/sorbet --silence-dev-message --typecheck-shard=1/2 test/cli/typecheck-shard/f.rb test/cli/typecheck-shard/b.rb 2>&1
+echo "--- 2/2"
+main/sorbet --silence-dev-message --typecheck-shard=2/2 test/cli/typecheck-shard/f.rb 2>&1
@@ -0,0 +1,44 @@
+#include "gtest/gtest.h"
+// has to go first as it violates are requirements
+
+#include "core/errors/infer.h"
+#include "main/embed/embed.h"
+#include "main/embed/sorbet_embed.h"
+
+using namespace std;
+
+namespace sorbet::realmain::embed {
+
+TEST(EmbedTest, ReportsErrors) { // NOLINT
+    Typechecker typechecker;
+    auto errors = typechecker.typecheck({{"a.rb", "# typed: true\n1 + 'a'\n"}});
+    ASSERT_EQ(1, errors.size());
+    EXPECT_EQ(core::errors::Infer::MethodArgumentMismatch.code, errors[0].code);
+    EXPECT_EQ("a.rb", errors[0].position.path);
+    EXPECT_EQ(2, errors[0].position.line);
+}
+
+TEST(EmbedTest, CallsDontSeeEachOther) { // NOLINT
+    Typechecker typechecker;
+    auto errors = typechecker.typecheck({{"a.rb", "# typed: true\nclass A; def self.foo; end; end\n"}});
+    EXPECT_TRUE(errors.empty());
+    errors = typechecker.typecheck({{"b.rb", "# typed: true\nA.foo\n"}});
+    ASSERT_EQ(1, errors.size());
+    EXPECT_EQ("b.rb", errors[0].position.path);
+}
+
+TEST(EmbedTest, CInterface) { // NOLINT
+    auto typechecker = sorbet_typechecker_new();
+    ASSERT_NE(nullptr, typechecker);
+    const char *paths[] = {"a.rb"};
+    const char *sources[] = {"# typed: false\nclass A < B; end\n"};
+    auto errors = sorbet_typecheck(typechecker, paths, sources, 1);
+    ASSERT_EQ(1, sorbet_errors_count(errors));
+    auto error = sorbet_errors_get(errors, 0);
+    EXPECT_EQ(string("a.rb"), error.path);
+    EXPECT_EQ(2, error.line);
+    sorbet_errors_free(errors);
+    sorbet_typechecker_free(typechecker);
+}
+
+} // namespace sorbet::realmain::embed
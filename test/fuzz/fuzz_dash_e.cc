@@ -70,7 +70,7 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
     }
 
     indexed = realmain::pipeline::index(gs, inputFiles, *opts, *workers, kvstore);
-    indexed = realmain::pipeline::resolve(gs, move(indexed), *opts, *workers);
+    indexed = realmain::pipeline::resolve(gs, move(indexed), *opts, *workers, kvstore);
     indexed = realmain::pipeline::typecheck(gs, move(indexed), *opts, *workers);
     return 0;
 }
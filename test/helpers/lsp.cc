@@ -149,7 +149,7 @@ void checkServerCapabilities(const ServerCapabilities &capabilities) {
     EXPECT_TRUE(capabilities.textDocumentSync.has_value());
     auto &textDocumentSync = *(capabilities.textDocumentSync);
     auto textDocumentSyncValue = get<TextDocumentSyncKind>(textDocumentSync);
-    EXPECT_EQ(TextDocumentSyncKind::Full, textDocumentSyncValue);
+    EXPECT_EQ(TextDocumentSyncKind::Incremental, textDocumentSyncValue);
 
     EXPECT_TRUE(capabilities.hoverProvider.value_or(false));
 
@@ -783,7 +783,8 @@ void FastPathAssertion::check(SorbetTypecheckRunInfo &info, string_view folder,
     string updateFile = fmt::format("{}.{}.rbupdate", filename.substr(0, -3), updateVersion);
     if (!info.tookFastPath) {
         ADD_FAILURE_AT(updateFile.c_str(), assertionLine)
-            << errorPrefix << "Expected file update to take fast path, but it took the slow path.";
+            << errorPrefix << "Expected file update to take fast path, but it took the slow path because "
+            << info.fastPathDecision.value_or("of an unknown reason") << ".";
     }
     if (expectedFiles.has_value()) {
         vector<string> expectedFilePaths;
@@ -245,6 +245,31 @@ TEST_F(ProtocolTest, DoesNotMergeFileChangesAcrossNonDelayableRequests) {
     }
 }
 
+// Requests about the cursor position don't wait for queued file system updates that don't change their file.
+TEST_F(ProtocolTest, AnswersCursorRequestsBeforeFileSystemUpdates) {
+    assertDiagnostics(initializeLSP(), {});
+    assertDiagnostics(send(*openFile("foo.rb", "# typed: true\nclass Foo\n  def foo; end\nend\nFoo.new.foo\n")), {});
+    writeFilesToFS({{"bar.rb", "# typed: true\nclass Bar\n  def branch\n    1 + \"stuff\"\n  end\nend\n"}});
+
+    vector<unique_ptr<LSPMessage>> requests;
+    requests.push_back(watchmanFileUpdate({"bar.rb"}));
+    requests.push_back(getDefinition("foo.rb", 4, 9));
+    auto msgs = send(move(requests));
+    ASSERT_EQ(msgs.size(), 2);
+    assertResponseMessage(nextId - 1, *msgs.at(0));
+    assertDiagnostics({}, {{"bar.rb", 3, "Expected `Integer`"}});
+
+    // An update to its own file still goes first.
+    requests.clear();
+    writeFilesToFS({{"bar.rb", "# typed: true\nclass Bar\n  def branch\n    1 + 2\n  end\nend\n"}});
+    requests.push_back(watchmanFileUpdate({"bar.rb"}));
+    requests.push_back(getDefinition("bar.rb", 1, 6));
+    msgs = send(move(requests));
+    ASSERT_EQ(msgs.size(), 2);
+    EXPECT_TRUE(msgs.at(0)->isNotification());
+    assertResponseMessage(nextId - 1, *msgs.at(1));
+}
+
 TEST_F(ProtocolTest, NotInitialized) {
     auto msgs = send(*getDefinition("foo.rb", 12, 24));
     ASSERT_EQ(msgs.size(), 1);
@@ -447,4 +472,134 @@ TEST_F(ProtocolTest, SorbetURIsWork) {
     ASSERT_EQ(readFile(myMethodDefLoc->uri), fileContents);
 }
 
+// Edits that don't change a file's errors shouldn't send its diagnostics again.
+TEST_F(ProtocolTest, DoesNotResendUnchangedDiagnostics) {
+    assertDiagnostics(initializeLSP(), {});
+    ExpectedDiagnostic yolo1Diagnostic = {"yolo1.rb", 3, "Expected `Integer`"};
+    assertDiagnostics(
+        send(*openFile("yolo1.rb", "# typed: true\nclass Foo1\n  def branch\n    1 + \"stuff\"\n  end\nend\n")),
+        {yolo1Diagnostic});
+
+    // Appending a comment leaves the error where it was.
+    auto responses = send(*changeFile(
+        "yolo1.rb", "# typed: true\nclass Foo1\n  def branch\n    1 + \"stuff\"\n  end\nend\n# hi\n", 2));
+    EXPECT_EQ(responses.size(), 0);
+    assertDiagnostics({}, {yolo1Diagnostic});
+
+    // Moving the error sends it again.
+    assertDiagnostics(
+        send(*changeFile("yolo1.rb", "# typed: true\nclass Foo1\n\n  def branch\n    1 + \"stuff\"\n  end\nend\n", 3)),
+        {{"yolo1.rb", 4, "Expected `Integer`"}});
+}
+
+// An edit inside one method typechecks only that method again. The errors of the others are reported again, moved
+// along with the code after the edit.
+TEST_F(ProtocolTest, ReportsErrorsOfMethodsAnEditDidNotTouch) {
+    assertDiagnostics(initializeLSP(), {});
+    assertDiagnostics(send(*openFile("yolo1.rb", "# typed: true\nclass Foo1\n  def a\n    1 + \"a\"\n  end\n\n  def b\n"
+                                                 "    1 + \"b\"\n  end\nend\n")),
+                      {{"yolo1.rb", 3, "\"a\""}, {"yolo1.rb", 7, "\"b\""}});
+    assertDiagnostics(send(*changeFile("yolo1.rb",
+                                       "# typed: true\nclass Foo1\n  def a\n    1 + \"a2\"\n  end\n\n  def b\n"
+                                       "    1 + \"b\"\n  end\nend\n",
+                                       2)),
+                      {{"yolo1.rb", 3, "\"a2\""}, {"yolo1.rb", 7, "\"b\""}});
+    assertDiagnostics(send(*changeFile("yolo1.rb",
+                                       "# typed: true\nclass Foo1\n  def a\n\n    1 + \"a3\"\n  end\n\n  def b\n"
+                                       "    1 + \"b\"\n  end\nend\n",
+                                       3)),
+                      {{"yolo1.rb", 4, "\"a3\""}, {"yolo1.rb", 8, "\"b\""}});
+}
+
+// Completion caches the members of each class. An edit that adds a method to one must show up in the next completion.
+TEST_F(ProtocolTest, CompletionSeesMethodsAddedByAnEdit) {
+    assertDiagnostics(initializeLSP(), {});
+    assertDiagnostics(send(*openFile("yolo1.rb", "# typed: true\nclass A\n  def foo; end\nend\nA.new.foo\n")), {});
+
+    auto completionLabels = [&](int line) -> vector<string> {
+        auto params = make_unique<CompletionParams>(make_unique<TextDocumentIdentifier>(getUri("yolo1.rb")),
+                                                    make_unique<Position>(line, 8));
+        params->context = make_unique<CompletionContext>(CompletionTriggerKind::Invoked);
+        auto responses = send(
+            LSPMessage(make_unique<RequestMessage>("2.0", nextId++, LSPMethod::TextDocumentCompletion, move(params))));
+        vector<string> labels;
+        EXPECT_EQ(responses.size(), 1);
+        if (responses.size() == 1 && responses.at(0)->isResponse()) {
+            auto &list = get<unique_ptr<CompletionList>>(*responses.at(0)->asResponse().result);
+            for (auto &item : list->items) {
+                labels.push_back(item->label);
+            }
+        }
+        return labels;
+    };
+
+    EXPECT_EQ(completionLabels(4), vector<string>({"foo"}));
+    assertDiagnostics(
+        send(*changeFile("yolo1.rb", "# typed: true\nclass A\n  def foo; end\n  def foobar; end\nend\nA.new.foo\n", 2)),
+        {});
+    EXPECT_EQ(completionLabels(5), vector<string>({"foo", "foobar"}));
+}
+
+// After an edit, a hover only typechecks the method it is in. Hovers in other methods must still see their own types.
+TEST_F(ProtocolTest, HoversInMethodsOfAnEditedFile) {
+    assertDiagnostics(initializeLSP(), {});
+    assertDiagnostics(send(*openFile("yolo1.rb", "# typed: true\nclass A\n  def a\n    x = 1\n  end\n\n  def b\n"
+                                                 "    y = \"b\"\n  end\nend\n")),
+                      {});
+    assertDiagnostics(send(*changeFile("yolo1.rb",
+                                       "# typed: true\nclass A\n  def a\n    x = 10\n  end\n\n  def b\n"
+                                       "    y = \"b\"\n  end\nend\n",
+                                       2)),
+                      {});
+
+    auto hoverText = [&](int line, int character) -> string {
+        auto responses = send(LSPMessage(make_unique<RequestMessage>(
+            "2.0", nextId++, LSPMethod::TextDocumentHover,
+            make_unique<TextDocumentPositionParams>(make_unique<TextDocumentIdentifier>(getUri("yolo1.rb")),
+                                                    make_unique<Position>(line, character)))));
+        EXPECT_EQ(responses.size(), 1);
+        if (responses.size() != 1 || !responses.at(0)->isResponse()) {
+            return "";
+        }
+        auto &hoverResult = get<variant<JSONNullObject, unique_ptr<Hover>>>(*responses.at(0)->asResponse().result);
+        auto hover = get_if<unique_ptr<Hover>>(&hoverResult);
+        return hover == nullptr ? "" : (*hover)->contents->value;
+    };
+
+    EXPECT_NE(hoverText(7, 4).find("String"), string::npos);
+    EXPECT_NE(hoverText(3, 4).find("Integer"), string::npos);
+    EXPECT_NE(hoverText(7, 4).find("String"), string::npos);
+}
+
+// Document symbols are indexed once per file. An edit that adds a method must show up in the next outline of the file.
+TEST_F(ProtocolTest, DocumentSymbolsSeeMethodsAddedByAnEdit) {
+    assertDiagnostics(initializeLSP(), {});
+    assertDiagnostics(send(*openFile("yolo1.rb", "# typed: true\nclass A\n  def foo; end\nend\n")), {});
+
+    auto methodNames = [&]() -> vector<string> {
+        auto responses = send(*documentSymbol("yolo1.rb"));
+        vector<string> names;
+        EXPECT_EQ(responses.size(), 1);
+        if (responses.size() == 1 && responses.at(0)->isResponse()) {
+            auto &symbolResult =
+                get<variant<JSONNullObject, vector<unique_ptr<DocumentSymbol>>>>(*responses.at(0)->asResponse().result);
+            for (auto &symbol : get<vector<unique_ptr<DocumentSymbol>>>(symbolResult)) {
+                if (symbol->name == "A" && symbol->children) {
+                    for (auto &child : *symbol->children) {
+                        names.push_back(child->name);
+                    }
+                }
+            }
+        }
+        return names;
+    };
+
+    EXPECT_EQ(methodNames(), vector<string>({"foo"}));
+    assertDiagnostics(send(*changeFile("yolo1.rb", "# typed: true\nclass A\n  def foo; end\n  def bar; end\nend\n", 2)),
+                      {});
+    auto names = methodNames();
+    fast_sort(names);
+    EXPECT_EQ(names, vector<string>({"bar", "foo"}));
+}
+
 } // namespace sorbet::test::lsp
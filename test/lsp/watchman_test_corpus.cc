@@ -120,4 +120,18 @@ TEST_F(ProtocolTest, MergesMultipleWatchmanUpdates) {
                        lspWrapper->getTypecheckCount());
 }
 
+// Sorbet does not typecheck files again when Watchman reports them but their contents did not change.
+TEST_F(ProtocolTest, IgnoresWatchmanUpdatesThatLeaveContentsAsTheyWere) {
+    assertDiagnostics(initializeLSP(), {});
+    ExpectedDiagnostic d = {"foo.rb", 3, "Expected `Integer`"};
+    writeFilesToFS({{"foo.rb", "# typed: true\nclass Foo1\n  def branch\n    1 + \"stuff\"\n  end\nend\n"}});
+    assertDiagnostics(send(*watchmanFileUpdate({"foo.rb"})), {d});
+    auto typecheckCount = lspWrapper->getTypecheckCount();
+
+    // E.g. switching to a branch and back again.
+    writeFilesToFS({{"foo.rb", "# typed: true\nclass Foo1\n  def branch\n    1 + \"stuff\"\n  end\nend\n"}});
+    assertDiagnostics(send(*watchmanFileUpdate({"foo.rb", "bar.rb"})), {d});
+    EXPECT_EQ(lspWrapper->getTypecheckCount(), typecheckCount);
+}
+
 } // namespace sorbet::test::lsp
\ No newline at end of file
@@ -0,0 +1,270 @@
+# typed: true
+
+# Literals with more than 256 entries are typed as plain hashes and arrays.
+
+small = [0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95, 96, 97, 98, 99, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111, 112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124, 125, 126, 127, 128, 129, 130, 131, 132, 133, 134, 135, 136, 137, 138, 139, 140, 141, 142, 143, 144, 145, 146, 147, 148, 149, 150, 151, 152, 153, 154, 155, 156, 157, 158, 159, 160, 161, 162, 163, 164, 165, 166, 167, 168, 169, 170, 171, 172, 173, 174, 175, 176, 177, 178, 179, 180, 181, 182, 183, 184, 185, 186, 187, 188, 189, 190, 191, 192, 193, 194, 195, 196, 197, 198, 199, 200, 201, 202, 203, 204, 205, 206, 207, 208, 209, 210, 211, 212, 213, 214, 215, 216, 217, 218, 219, 220, 221, 222, 223, 224, 225, 226, 227, 228, 229, 230, 231, 232, 233, 234, 235, 236, 237, 238, 239, 240, 241, 242, 243, 244, 245, 246, 247, 248, 249, 250, 251, 252, 253, 254, 255]
+T.reveal_type(small.first) # error: Revealed type: `Integer(0)`
+
+big = [0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95, 96, 97, 98, 99, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111, 112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124, 125, 126, 127, 128, 129, 130, 131, 132, 133, 134, 135, 136, 137, 138, 139, 140, 141, 142, 143, 144, 145, 146, 147, 148, 149, 150, 151, 152, 153, 154, 155, 156, 157, 158, 159, 160, 161, 162, 163, 164, 165, 166, 167, 168, 169, 170, 171, 172, 173, 174, 175, 176, 177, 178, 179, 180, 181, 182, 183, 184, 185, 186, 187, 188, 189, 190, 191, 192, 193, 194, 195, 196, 197, 198, 199, 200, 201, 202, 203, 204, 205, 206, 207, 208, 209, 210, 211, 212, 213, 214, 215, 216, 217, 218, 219, 220, 221, 222, 223, 224, 225, 226, 227, 228, 229, 230, 231, 232, 233, 234, 235, 236, 237, 238, 239, 240, 241, 242, 243, 244, 245, 246, 247, 248, 249, 250, 251, 252, 253, 254, 255, 256]
+T.reveal_type(big) # error: Revealed type: `T::Array[Integer]`
+
+config = {
+  key0: 0,
+  key1: 1,
+  key2: 2,
+  key3: 3,
+  key4: 4,
+  key5: 5,
+  key6: 6,
+  key7: 7,
+  key8: 8,
+  key9: 9,
+  key10: 10,
+  key11: 11,
+  key12: 12,
+  key13: 13,
+  key14: 14,
+  key15: 15,
+  key16: 16,
+  key17: 17,
+  key18: 18,
+  key19: 19,
+  key20: 20,
+  key21: 21,
+  key22: 22,
+  key23: 23,
+  key24: 24,
+  key25: 25,
+  key26: 26,
+  key27: 27,
+  key28: 28,
+  key29: 29,
+  key30: 30,
+  key31: 31,
+  key32: 32,
+  key33: 33,
+  key34: 34,
+  key35: 35,
+  key36: 36,
+  key37: 37,
+  key38: 38,
+  key39: 39,
+  key40: 40,
+  key41: 41,
+  key42: 42,
+  key43: 43,
+  key44: 44,
+  key45: 45,
+  key46: 46,
+  key47: 47,
+  key48: 48,
+  key49: 49,
+  key50: 50,
+  key51: 51,
+  key52: 52,
+  key53: 53,
+  key54: 54,
+  key55: 55,
+  key56: 56,
+  key57: 57,
+  key58: 58,
+  key59: 59,
+  key60: 60,
+  key61: 61,
+  key62: 62,
+  key63: 63,
+  key64: 64,
+  key65: 65,
+  key66: 66,
+  key67: 67,
+  key68: 68,
+  key69: 69,
+  key70: 70,
+  key71: 71,
+  key72: 72,
+  key73: 73,
+  key74: 74,
+  key75: 75,
+  key76: 76,
+  key77: 77,
+  key78: 78,
+  key79: 79,
+  key80: 80,
+  key81: 81,
+  key82: 82,
+  key83: 83,
+  key84: 84,
+  key85: 85,
+  key86: 86,
+  key87: 87,
+  key88: 88,
+  key89: 89,
+  key90: 90,
+  key91: 91,
+  key92: 92,
+  key93: 93,
+  key94: 94,
+  key95: 95,
+  key96: 96,
+  key97: 97,
+  key98: 98,
+  key99: 99,
+  key100: 100,
+  key101: 101,
+  key102: 102,
+  key103: 103,
+  key104: 104,
+  key105: 105,
+  key106: 106,
+  key107: 107,
+  key108: 108,
+  key109: 109,
+  key110: 110,
+  key111: 111,
+  key112: 112,
+  key113: 113,
+  key114: 114,
+  key115: 115,
+  key116: 116,
+  key117: 117,
+  key118: 118,
+  key119: 119,
+  key120: 120,
+  key121: 121,
+  key122: 122,
+  key123: 123,
+  key124: 124,
+  key125: 125,
+  key126: 126,
+  key127: 127,
+  key128: 128,
+  key129: 129,
+  key130: 130,
+  key131: 131,
+  key132: 132,
+  key133: 133,
+  key134: 134,
+  key135: 135,
+  key136: 136,
+  key137: 137,
+  key138: 138,
+  key139: 139,
+  key140: 140,
+  key141: 141,
+  key142: 142,
+  key143: 143,
+  key144: 144,
+  key145: 145,
+  key146: 146,
+  key147: 147,
+  key148: 148,
+  key149: 149,
+  key150: 150,
+  key151: 151,
+  key152: 152,
+  key153: 153,
+  key154: 154,
+  key155: 155,
+  key156: 156,
+  key157: 157,
+  key158: 158,
+  key159: 159,
+  key160: 160,
+  key161: 161,
+  key162: 162,
+  key163: 163,
+  key164: 164,
+  key165: 165,
+  key166: 166,
+  key167: 167,
+  key168: 168,
+  key169: 169,
+  key170: 170,
+  key171: 171,
+  key172: 172,
+  key173: 173,
+  key174: 174,
+  key175: 175,
+  key176: 176,
+  key177: 177,
+  key178: 178,
+  key179: 179,
+  key180: 180,
+  key181: 181,
+  key182: 182,
+  key183: 183,
+  key184: 184,
+  key185: 185,
+  key186: 186,
+  key187: 187,
+  key188: 188,
+  key189: 189,
+  key190: 190,
+  key191: 191,
+  key192: 192,
+  key193: 193,
+  key194: 194,
+  key195: 195,
+  key196: 196,
+  key197: 197,
+  key198: 198,
+  key199: 199,
+  key200: 200,
+  key201: 201,
+  key202: 202,
+  key203: 203,
+  key204: 204,
+  key205: 205,
+  key206: 206,
+  key207: 207,
+  key208: 208,
+  key209: 209,
+  key210: 210,
+  key211: 211,
+  key212: 212,
+  key213: 213,
+  key214: 214,
+  key215: 215,
+  key216: 216,
+  key217: 217,
+  key218: 218,
+  key219: 219,
+  key220: 220,
+  key221: 221,
+  key222: 222,
+  key223: 223,
+  key224: 224,
+  key225: 225,
+  key226: 226,
+  key227: 227,
+  key228: 228,
+  key229: 229,
+  key230: 230,
+  key231: 231,
+  key232: 232,
+  key233: 233,
+  key234: 234,
+  key235: 235,
+  key236: 236,
+  key237: 237,
+  key238: 238,
+  key239: 239,
+  key240: 240,
+  key241: 241,
+  key242: 242,
+  key243: 243,
+  key244: 244,
+  key245: 245,
+  key246: 246,
+  key247: 247,
+  key248: 248,
+  key249: 249,
+  key250: 250,
+  key251: 251,
+  key252: 252,
+  key253: 253,
+  key254: 254,
+  key255: 255,
+  key256: 256,
+}
+T.reveal_type(config) # error: Revealed type: `T::Hash[T.untyped, T.untyped]`
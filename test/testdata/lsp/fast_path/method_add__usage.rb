@@ -0,0 +1,5 @@
+# typed: true
+
+def main
+    A.new.foo # error: Method `foo` does not exist on `A`
+end
@@ -0,0 +1,13 @@
+# typed: true
+
+class A extend T::Sig
+  sig {params(x: Integer).returns(String)}
+  def bar(x)
+    x.to_s
+  end
+
+  sig {returns(Integer)}
+  def foo
+    1
+  end
+end
@@ -0,0 +1,5 @@
+# typed: true
+
+def main
+    A.new.foo
+end
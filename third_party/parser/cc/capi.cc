@@ -55,8 +55,8 @@ rbtoken_get_end(const ruby_parser::token* tok)
 size_t
 rbtoken_get_string(const ruby_parser::token* tok, const char** out_ptr)
 {
-	*out_ptr = tok->string().data();
-	return tok->string().size();
+	*out_ptr = tok->view().data();
+	return tok->view().size();
 }
 
 size_t
@@ -111,6 +111,7 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <ruby_parser/driver.hh>
 #include <cassert>
+#include <functional>
 #include "absl/strings/numbers.h"
 
 %% write data nofinal;
@@ -457,25 +458,49 @@ token_t lexer::advance_() {
 
   if (cs == lex_error) {
     size_t start = (size_t)(p - source_buffer.data());
-    return mempool.alloc(token_type::error, start, start + 1, std::string(p - 1, 1));
+    return mempool.alloc(token_type::error, start, start + 1, tok_view(p - 1, p));
   }
 
   return mempool.alloc(token_type::eof, source_buffer.size(), source_buffer.size(), "");
 }
 
 void lexer::emit(token_type type) {
-  emit(type, tok());
+  emit(type, tok_view(ts, te));
 }
 
-void lexer::emit(token_type type, const std::string& str) {
+void lexer::emit(token_type type, std::string_view str) {
   emit(type, str, ts, te);
 }
 
-void lexer::emit(token_type type, const std::string& str, const char* start, const char* end) {
+void lexer::emit(token_type type, std::string_view str, const char* start, const char* end) {
   size_t offset_start = (size_t)(start - source_buffer.data());
   size_t offset_end = (size_t)(end - source_buffer.data());
 
-  token_queue.push(mempool.alloc(type, offset_start, offset_end, str));
+  token_queue.push(mempool.alloc(type, offset_start, offset_end, stable_view(str, start, end)));
+}
+
+std::string_view lexer::tok_view(const char* start, const char* end) const {
+  assert(start <= end);
+
+  return std::string_view(start, (size_t)(end - start));
+}
+
+std::string_view lexer::stable_view(std::string_view str, const char* start, const char* end) {
+  // Most tokens are spelled exactly as they appear in the source, so they can
+  // point straight into it. Only text the lexer built up itself (unescaped
+  // strings, converted numbers, ...) needs a copy that outlives the caller.
+  std::less_equal<const char*> le;
+  if (le(source_buffer.data(), str.data()) && le(str.data() + str.size(), source_buffer.data() + source_buffer.size())) {
+    return str;
+  }
+  if (str.empty()) {
+    return std::string_view();
+  }
+  auto slice = tok_view(start, end);
+  if (slice == str) {
+    return slice;
+  }
+  return owned_strings.emplace_back(str);
 }
 
 void lexer::emit_do(bool do_block) {
@@ -489,7 +514,7 @@ void lexer::emit_do(bool do_block) {
 }
 
 void lexer::emit_table(const token_table_entry* table) {
-  auto value = tok();
+  auto value = tok_view(ts, te);
 
   for (; table->token; ++table) {
     if (value == table->token) {
@@ -1317,7 +1342,7 @@ void lexer::set_state_expr_value() {
 
       any
       => {
-        emit(token_type::tREGEXP_OPT, tok(ts, te - 1), ts, te - 1);
+        emit(token_type::tREGEXP_OPT, tok_view(ts, te - 1), ts, te - 1);
         fhold; fgoto expr_end;
       };
   *|;
@@ -1448,7 +1473,7 @@ void lexer::set_state_expr_value() {
       global_var
       => {
         if (ts[1] >= '1' && ts[1] <= '9') {
-          emit(token_type::tNTH_REF, tok(ts + 1));
+          emit(token_type::tNTH_REF, tok_view(ts + 1, te));
         } else if (ts[1] == '&' || ts[1] == '`' || ts[1] == '\'' || ts[1] == '+') {
           emit(token_type::tBACK_REF);
         } else {
@@ -1545,7 +1570,7 @@ void lexer::set_state_expr_value() {
   #
   expr_endfn := |*
       label ( any - ':' )
-      => { emit(token_type::tLABEL, tok(ts, te - 2), ts, te - 1);
+      => { emit(token_type::tLABEL, tok_view(ts, te - 2), ts, te - 1);
            fhold; fnext expr_labelarg; fbreak; };
 
       w_space_comment;
@@ -1570,7 +1595,7 @@ void lexer::set_state_expr_value() {
            fnext *arg_or_cmdarg(); fbreak; };
 
       bareword ambiguous_fid_suffix
-      => { emit(token_type::tFID, tok(ts, tm), ts, tm);
+      => { emit(token_type::tFID, tok_view(ts, tm), ts, tm);
            fnext *arg_or_cmdarg(); p = tm - 1; fbreak; };
 
       # See the comment in `expr_fname`.
@@ -1841,7 +1866,7 @@ void lexer::set_state_expr_value() {
       # +5, -5
       [+\-][0-9]
       => {
-        emit(token_type::tUNARY_OP, tok(ts, ts + 1), ts, ts + 1);
+        emit(token_type::tUNARY_OP, tok_view(ts, ts + 1), ts, ts + 1);
         fhold; fnext expr_end; fbreak;
       };
 
@@ -1992,7 +2017,7 @@ void lexer::set_state_expr_value() {
 
       ':' bareword ambiguous_symbol_suffix
       => {
-        emit(token_type::tSYMBOL, tok(ts + 1, tm), ts, tm);
+        emit(token_type::tSYMBOL, tok_view(ts + 1, tm), ts, tm);
         p = tm - 1;
         fnext expr_end; fbreak;
       };
@@ -2000,7 +2025,7 @@ void lexer::set_state_expr_value() {
       ':' ( bareword | global_var | class_var | instance_var |
             operator_fname | operator_arithmetic | operator_rest )
       => {
-        emit(token_type::tSYMBOL, tok(ts + 1), ts, te);
+        emit(token_type::tSYMBOL, tok_view(ts + 1, te), ts, te);
         fnext expr_end; fbreak;
       };
 
@@ -2125,7 +2150,7 @@ void lexer::set_state_expr_value() {
             fnext *arg_or_cmdarg();
           }
         } else {
-          emit(token_type::tLABEL, tok(ts, te - 2), ts, te - 1);
+          emit(token_type::tLABEL, tok_view(ts, te - 2), ts, te - 1);
           fnext expr_labelarg;
         }
 
@@ -2366,7 +2391,7 @@ void lexer::set_state_expr_value() {
         if (version == ruby_version::RUBY_18 || version == ruby_version::RUBY_19 || version == ruby_version::RUBY_20) {
           diagnostic_(dlevel::ERROR, dclass::TrailingInNumber, range(te - 1, te), tok(te-1, te));
         } else {
-          emit(token_type::tINTEGER, tok(ts, te - 1), ts, te - 1);
+          emit(token_type::tINTEGER, tok_view(ts, te - 1), ts, te - 1);
           fhold; fbreak;
         }
       };
@@ -2376,7 +2401,7 @@ void lexer::set_state_expr_value() {
         if (version == ruby_version::RUBY_18 || version == ruby_version::RUBY_19 || version == ruby_version::RUBY_20) {
           diagnostic_(dlevel::ERROR, dclass::TrailingInNumber, range(te - 1, te), tok(te - 1, te));
         } else {
-          emit(token_type::tFLOAT, tok(ts, te - 1), ts, te - 1);
+          emit(token_type::tFLOAT, tok_view(ts, te - 1), ts, te - 1);
           fhold; fbreak;
         }
       };
@@ -2426,7 +2451,7 @@ void lexer::set_state_expr_value() {
            fnext *arg_or_cmdarg(); fbreak; };
 
       constant ambiguous_const_suffix
-      => { emit(token_type::tCONSTANT, tok(ts, tm), ts, tm);
+      => { emit(token_type::tCONSTANT, tok_view(ts, tm), ts, tm);
            p = tm - 1; fbreak; };
 
       global_var | class_var_v | instance_var_v
@@ -2450,7 +2475,7 @@ void lexer::set_state_expr_value() {
           emit(token_type::tFID);
         } else {
           // Suffix was not consumed, e.g. foo!=
-          emit(token_type::tIDENTIFIER, tok(ts, tm), ts, tm);
+          emit(token_type::tIDENTIFIER, tok_view(ts, tm), ts, tm);
           p = tm - 1;
         }
         fnext expr_arg; fbreak;
@@ -2483,7 +2508,7 @@ void lexer::set_state_expr_value() {
       };
 
       operator_arithmetic '='
-      => { emit(token_type::tOP_ASGN, tok(ts, te - 1));
+      => { emit(token_type::tOP_ASGN, tok_view(ts, te - 1));
            fnext expr_beg; fbreak; };
 
       '?'
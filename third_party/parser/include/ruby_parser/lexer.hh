@@ -2,6 +2,8 @@
 #define RUBY_PARSER_LEXER_HH
 
 #include <string>
+#include <string_view>
+#include <deque>
 #include <stack>
 #include <queue>
 #include <set>
@@ -52,6 +54,10 @@ namespace ruby_parser {
     ruby_version version;
     const std::string source_buffer;
 
+    // Token text that isn't a slice of source_buffer. A deque, so that the
+    // strings (and the views tokens hold into them) never move.
+    std::deque<std::string> owned_strings;
+
     std::stack<environment> static_env;
     std::stack<literal> literal_stack;
     std::queue<token_t> token_queue;
@@ -106,9 +112,11 @@ namespace ruby_parser {
     std::string tok();
     std::string tok(const char* start);
     std::string tok(const char* start, const char* end);
+    std::string_view tok_view(const char* start, const char* end) const;
+    std::string_view stable_view(std::string_view str, const char* start, const char* end);
     void emit(token_type type);
-    void emit(token_type type, const std::string& str);
-    void emit(token_type type, const std::string& str, const char* start, const char* end);
+    void emit(token_type type, std::string_view str);
+    void emit(token_type type, std::string_view str, const char* start, const char* end);
     void emit_do(bool do_block = false);
     void emit_table(const token_table_entry* table);
     void emit_num(const std::string& num);